@@ -25,33 +25,78 @@
 #include <linux/can/error.h>
 #include <linux/can/raw.h>
 
+#include <set>
+
 namespace android::hardware::automotive::can::V1_0::implementation {
 
 /** Whether to log sent/received packets. */
 static constexpr bool kSuperVerbose = false;
 
-Return<Result> CanBus::send(const CanMessage& message) {
-    std::lock_guard<std::mutex> lck(mIsUpGuard);
-    if (!mIsUp) return Result::INTERFACE_DOWN;
+/**
+ * How many frame IDs to keep listeners for.
+ *
+ * A bus carries a fixed set of IDs, typically a few hundred, so this is only reached if the IDs
+ * keep changing. The index starts over then.
+ */
+static constexpr size_t kMaxIndexedIds = 4096;
 
+/**
+ * Convert a message to a SocketCAN frame.
+ *
+ * \param message Message to convert
+ * \param frame Frame to fill
+ * \return OK on success, or an error state if the message can't be sent
+ */
+static Result toFrame(const CanMessage& message, struct canfd_frame& frame) {
     if (UNLIKELY(kSuperVerbose)) {
         LOG(VERBOSE) << "Sending " << toString(message);
     }
 
     if (message.payload.size() > CAN_MAX_DLEN) return Result::PAYLOAD_TOO_LONG;
 
-    struct canfd_frame frame = {};
+    frame = {};
     frame.can_id = message.id;
     if (message.isExtendedId) frame.can_id |= CAN_EFF_FLAG;
     if (message.remoteTransmissionRequest) frame.can_id |= CAN_RTR_FLAG;
     frame.len = message.payload.size();
     memcpy(frame.data, message.payload.data(), message.payload.size());
+    return Result::OK;
+}
+
+Return<Result> CanBus::send(const CanMessage& message) {
+    std::lock_guard<std::mutex> lck(mIsUpGuard);
+    if (!mIsUp) return Result::INTERFACE_DOWN;
+
+    struct canfd_frame frame;
+    const auto result = toFrame(message, frame);
+    if (result != Result::OK) return result;
 
     if (!mSocket->send(frame)) return Result::TRANSMISSION_FAILURE;
 
     return Result::OK;
 }
 
+Result CanBus::sendBatch(const std::vector<CanMessage>& messages, size_t* sent) {
+    *sent = 0;
+    std::lock_guard<std::mutex> lck(mIsUpGuard);
+    if (!mIsUp) return Result::INTERFACE_DOWN;
+
+    // Only send the messages before the first invalid one, but report it after those are sent.
+    std::vector<struct canfd_frame> frames(messages.size());
+    auto result = Result::OK;
+    for (size_t i = 0; i < messages.size(); i++) {
+        result = toFrame(messages[i], frames[i]);
+        if (result != Result::OK) {
+            frames.resize(i);
+            break;
+        }
+    }
+
+    *sent = mSocket->send(frames);
+    if (*sent < frames.size()) return Result::TRANSMISSION_FAILURE;
+    return result;
+}
+
 Return<void> CanBus::listen(const hidl_vec<CanMessageFilter>& filter,
                             const sp<ICanMessageListener>& listenerCb, listen_cb _hidl_cb) {
     std::lock_guard<std::mutex> lck(mIsUpGuard);
@@ -70,6 +115,7 @@ Return<void> CanBus::listen(const hidl_vec<CanMessageFilter>& filter,
     sp<CloseHandle> closeHandle = new CloseHandle([this, listenerCb]() {
         std::lock_guard<std::mutex> lck(mMsgListenersGuard);
         std::erase_if(mMsgListeners, [&](const auto& e) { return e.callback == listenerCb; });
+        updateFilters();
     });
     mMsgListeners.emplace_back(CanMessageListener{listenerCb, filter, closeHandle});
     auto& listener = mMsgListeners.back();
@@ -77,6 +123,7 @@ Return<void> CanBus::listen(const hidl_vec<CanMessageFilter>& filter,
     // fix message IDs to have all zeros on bits not covered by mask
     std::for_each(listener.filter.begin(), listener.filter.end(),
                   [](auto& rule) { rule.id &= rule.mask; });
+    updateFilters();
 
     _hidl_cb(Result::OK, closeHandle);
     return {};
@@ -136,11 +183,16 @@ ICanController::Result CanBus::up() {
     using namespace std::placeholders;
     CanSocket::ReadCallback rdcb = std::bind(&CanBus::onRead, this, _1, _2);
     CanSocket::ErrorCallback errcb = std::bind(&CanBus::onError, this, _1);
-    mSocket = CanSocket::open(mIfname, rdcb, errcb);
-    if (!mSocket) {
+    auto socket = CanSocket::open(mIfname, rdcb, errcb);
+    if (!socket) {
         if (mDownAfterUse) netdevice::down(mIfname);
         return ICanController::Result::UNKNOWN_ERROR;
     }
+    {
+        std::lock_guard<std::mutex> lckListeners(mMsgListenersGuard);
+        mSocket = std::move(socket);
+        updateFilters();
+    }
 
     mIsUp = true;
     return ICanController::Result::OK;
@@ -203,7 +255,13 @@ bool CanBus::down() {
 
     clearMsgListeners();
     clearErrListeners();
-    mSocket.reset();
+    std::unique_ptr<CanSocket> socket;
+    {
+        std::lock_guard<std::mutex> lckListeners(mMsgListenersGuard);
+        socket = std::move(mSocket);
+    }
+    // Not holding mMsgListenersGuard, since the reader thread may need it to finish.
+    socket.reset();
 
     bool success = true;
 
@@ -264,6 +322,66 @@ static bool match(const hidl_vec<CanMessageFilter>& filter, CanMessageId id, boo
     return !anyNonExcludeRulePresent || anyNonExcludeRuleSatisfied;
 }
 
+/**
+ * Add a SocketCAN filter flag matching a FilterFlag.
+ *
+ * \param filterFlag FilterFlag to convert
+ * \param flag CAN ID flag the FilterFlag applies to
+ * \param sockFilter SocketCAN filter to add the flag to
+ */
+static void addFilterFlag(FilterFlag filterFlag, canid_t flag, struct can_filter& sockFilter) {
+    if (filterFlag != FilterFlag::SET && filterFlag != FilterFlag::NOT_SET) return;
+    sockFilter.can_mask |= flag;
+    if (filterFlag == FilterFlag::SET) sockFilter.can_id |= flag;
+}
+
+/**
+ * Convert a filter set to SocketCAN filters, passing at least the frames matching it.
+ *
+ * Exclude rules are left for match() to apply.
+ *
+ * \param filter Filter to convert
+ * \param sockFilters Set of (can_id, can_mask) pairs to add the SocketCAN filters to
+ * \return false if the filter set passes frames not selected by any of its rules
+ */
+static bool addSocketFilters(const hidl_vec<CanMessageFilter>& filter,
+                             std::set<std::pair<canid_t, canid_t>>& sockFilters) {
+    bool anyNonExcludeRulePresent = false;
+    for (auto& rule : filter) {
+        if (rule.exclude) continue;
+        anyNonExcludeRulePresent = true;
+
+        struct can_filter sockFilter = {};
+        sockFilter.can_id = rule.id & CAN_EFF_MASK;
+        sockFilter.can_mask = rule.mask & CAN_EFF_MASK;
+        addFilterFlag(rule.rtr, CAN_RTR_FLAG, sockFilter);
+        addFilterFlag(rule.extendedFormat, CAN_EFF_FLAG, sockFilter);
+        sockFilters.emplace(sockFilter.can_id, sockFilter.can_mask);
+    }
+    return anyNonExcludeRulePresent;
+}
+
+void CanBus::updateFilters() {
+    mMsgListenersById.clear();
+    if (!mSocket) return;
+
+    std::set<std::pair<canid_t, canid_t>> sockFilters;
+    for (auto& listener : mMsgListeners) {
+        if (!addSocketFilters(listener.filter, sockFilters)) {
+            sockFilters = {{0, 0}};
+            break;
+        }
+    }
+    if (sockFilters.size() > CAN_RAW_FILTER_MAX) sockFilters = {{0, 0}};
+
+    std::vector<struct can_filter> filters;
+    for (auto& [id, mask] : sockFilters) filters.push_back({id, mask});
+    if (mSocket->setFilters(filters)) return;
+
+    // Listeners may miss frames if the previous filters are narrower, so fall back to all of them.
+    mSocket->setFilters({{0, 0}});
+}
+
 void CanBus::notifyErrorListeners(ErrorEvent err, bool isFatal) {
     std::lock_guard<std::mutex> lck(mErrListenersGuard);
     for (auto& listener : mErrListeners) {
@@ -317,10 +435,23 @@ void CanBus::onRead(const struct canfd_frame& frame, std::chrono::nanoseconds ti
     }
 
     std::lock_guard<std::mutex> lck(mMsgListenersGuard);
-    for (auto& listener : mMsgListeners) {
-        if (!match(listener.filter, message.id, message.remoteTransmissionRequest,
-                   message.isExtendedId))
-            continue;
+    const canid_t indexedId = frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_EFF_MASK);
+    auto listenerIndices = mMsgListenersById.find(indexedId);
+    if (listenerIndices == mMsgListenersById.end()) {
+        if (mMsgListenersById.size() >= kMaxIndexedIds) mMsgListenersById.clear();
+
+        std::vector<size_t> indices;
+        for (size_t i = 0; i < mMsgListeners.size(); i++) {
+            if (match(mMsgListeners[i].filter, message.id, message.remoteTransmissionRequest,
+                      message.isExtendedId)) {
+                indices.push_back(i);
+            }
+        }
+        listenerIndices = mMsgListenersById.emplace(indexedId, std::move(indices)).first;
+    }
+
+    for (auto i : listenerIndices->second) {
+        auto& listener = mMsgListeners[i];
         if (!listener.callback->onReceive(message).isOk() && !listener.failedOnce) {
             listener.failedOnce = true;
             LOG(WARNING) << "Failed to notify listener about message";
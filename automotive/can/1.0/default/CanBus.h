@@ -25,6 +25,7 @@
 
 #include <atomic>
 #include <thread>
+#include <unordered_map>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
 
@@ -38,6 +39,18 @@ struct CanBus : public ICanBus {
                         const sp<ICanMessageListener>& listener, listen_cb _hidl_cb) override;
     Return<sp<ICloseHandle>> listenForErrors(const sp<ICanErrorListener>& listener) override;
 
+    /**
+     * Send several messages, batching the system calls.
+     *
+     * This is not part of ICanBus, it's meant for in-process users of the bus (such as
+     * diagnostics flashing) sending bursts of messages.
+     *
+     * \param messages Messages to send, in order
+     * \param sent Number of messages sent, sending stops at the first one that fails
+     * \return OK if all messages were sent, an error state otherwise
+     */
+    Result sendBatch(const std::vector<CanMessage>& messages, size_t* sent);
+
     void setErrorCallback(ErrorCallback errcb);
     ICanController::Result up();
     bool down();
@@ -84,6 +97,12 @@ struct CanBus : public ICanBus {
     void clearMsgListeners();
     void clearErrListeners();
 
+    /**
+     * Install the union of the listeners' filters on the socket, so the kernel drops frames no
+     * listener is interested in.
+     */
+    void updateFilters() REQUIRES(mMsgListenersGuard);
+
     void notifyErrorListeners(ErrorEvent err, bool isFatal);
 
     void onRead(const struct canfd_frame& frame, std::chrono::nanoseconds timestamp);
@@ -92,9 +111,20 @@ struct CanBus : public ICanBus {
     std::mutex mMsgListenersGuard;
     std::vector<CanMessageListener> mMsgListeners GUARDED_BY(mMsgListenersGuard);
 
+    /**
+     * Indices of the listeners in mMsgListeners matching a given frame ID (including EFF and RTR
+     * flags), filled as IDs are received and reset when the listeners change.
+     */
+    std::unordered_map<canid_t, std::vector<size_t>> mMsgListenersById
+            GUARDED_BY(mMsgListenersGuard);
+
     std::mutex mErrListenersGuard;
     std::vector<sp<ICanErrorListener>> mErrListeners GUARDED_BY(mErrListenersGuard);
 
+    /**
+     * Only set and reset while holding both mIsUpGuard and mMsgListenersGuard, so that either of
+     * them is enough to use it.
+     */
     std::unique_ptr<CanSocket> mSocket;
     bool mDownAfterUse;
 
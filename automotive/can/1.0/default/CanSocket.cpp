@@ -20,8 +20,15 @@
 #include <libnetdevice/can.h>
 #include <libnetdevice/libnetdevice.h>
 #include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <time.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
@@ -34,6 +41,69 @@ using namespace std::chrono_literals;
  *       down the interface. */
 static constexpr auto kReadPooling = 100ms;
 
+/* How many frames to receive with a single system call.
+ *
+ * A busy bus delivers frames faster than the read thread wakes up, so they are drained from the
+ * socket in batches rather than with a select(3) and read(3) pair per frame. */
+static constexpr size_t kReadBatchSize = 32;
+
+/* How many frames to send with a single system call. */
+static constexpr size_t kSendBatchSize = 32;
+
+/* How often the offset between the kernel timestamps clock and the time since boot is measured.
+ *
+ * The realtime clock may be adjusted at any time, so this bounds how long received frames are
+ * reported with a stale offset. */
+static constexpr auto kClockOffsetValidity = 1s;
+
+/* How many clock readings to take for a single offset measurement. */
+static constexpr int kClockOffsetSamples = 5;
+
+static std::chrono::nanoseconds toNanoseconds(const struct timespec& ts) {
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+static std::chrono::nanoseconds clockNow(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return toNanoseconds(ts);
+}
+
+/**
+ * Converts kernel receive timestamps (CLOCK_REALTIME) to the time since boot (CLOCK_BOOTTIME).
+ *
+ * There is no direct way to convert between these clocks, so the realtime clock is read between
+ * two readings of the boot clock, several times. The reading with the smallest window gives the
+ * offset with the best precision (typically well under a microsecond). It is measured again
+ * periodically, in case the realtime clock got adjusted.
+ */
+class BootClockConverter {
+  public:
+    std::chrono::nanoseconds toBoottime(const struct timespec& realtime,
+                                        std::chrono::nanoseconds now) {
+        if (now - mLastSync > kClockOffsetValidity) sync();
+        // A timestamp can't be from the future, unless the realtime clock was just set back.
+        return std::min(toNanoseconds(realtime) + mOffset, now);
+    }
+
+  private:
+    void sync() {
+        auto bestWindow = std::chrono::nanoseconds::max();
+        for (int i = 0; i < kClockOffsetSamples; i++) {
+            const auto before = clockNow(CLOCK_BOOTTIME);
+            const auto realtime = clockNow(CLOCK_REALTIME);
+            const auto after = clockNow(CLOCK_BOOTTIME);
+            if (after - before >= bestWindow) continue;
+            bestWindow = after - before;
+            mOffset = before + bestWindow / 2 - realtime;
+            mLastSync = after;
+        }
+    }
+
+    std::chrono::nanoseconds mOffset = {};
+    std::chrono::nanoseconds mLastSync = std::chrono::nanoseconds::min() / 2;
+};
+
 std::unique_ptr<CanSocket> CanSocket::open(const std::string& ifname, ReadCallback rdcb,
                                            ErrorCallback errcb) {
     auto sock = netdevice::can::socket(ifname);
@@ -46,11 +116,28 @@ std::unique_ptr<CanSocket> CanSocket::open(const std::string& ifname, ReadCallba
     return std::unique_ptr<CanSocket>(new CanSocket(std::move(sock), rdcb, errcb));
 }
 
+/**
+ * Have the kernel timestamp received frames in software, when they reach the network stack.
+ *
+ * \param sock Socket to configure
+ * \return true if frames will come with a timestamp, false otherwise
+ */
+static bool enableKernelTimestamps(const base::unique_fd& sock) {
+    const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        PLOG(WARNING) << "Kernel timestamps not available, falling back to read time";
+        return false;
+    }
+    return true;
+}
+
 CanSocket::CanSocket(base::unique_fd socket, ReadCallback rdcb, ErrorCallback errcb)
     : mReadCallback(rdcb),
       mErrorCallback(errcb),
       mSocket(std::move(socket)),
-      mReaderThread(&CanSocket::readerThread, this) {}
+      mKernelTimestamps(enableKernelTimestamps(mSocket)) {
+    mReaderThread = std::thread(&CanSocket::readerThread, this);
+}
 
 CanSocket::~CanSocket() {
     mStopReaderThread = true;
@@ -77,6 +164,49 @@ bool CanSocket::send(const struct canfd_frame& frame) {
     return true;
 }
 
+size_t CanSocket::send(const std::vector<struct canfd_frame>& frames) {
+    std::array<struct iovec, kSendBatchSize> iovecs;
+    std::array<struct mmsghdr, kSendBatchSize> msgs = {};
+
+    size_t sent = 0;
+    while (sent < frames.size()) {
+        const auto batchSize = std::min(frames.size() - sent, kSendBatchSize);
+        for (size_t i = 0; i < batchSize; i++) {
+            // sendmmsg(2) doesn't modify the frames, despite the non-const iov_base.
+            iovecs[i].iov_base = const_cast<struct canfd_frame*>(&frames[sent + i]);
+            iovecs[i].iov_len = CAN_MTU;
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const auto res = sendmmsg(mSocket.get(), msgs.data(), batchSize, 0);
+        if (res < 0) {
+            PLOG(DEBUG) << "CanSocket send failed after " << sent << " frames";
+            break;
+        }
+        for (int i = 0; i < res; i++) {
+            if (msgs[i].msg_len != CAN_MTU) {
+                LOG(DEBUG) << "CanSocket sent wrong number of bytes: " << msgs[i].msg_len;
+                return sent;
+            }
+            sent++;
+        }
+        // A partial batch means the socket can't take more frames right now.
+        if (static_cast<size_t>(res) < batchSize) break;
+    }
+    return sent;
+}
+
+bool CanSocket::setFilters(const std::vector<struct can_filter>& filters) {
+    const auto res = setsockopt(mSocket.get(), SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+                                filters.size() * sizeof(struct can_filter));
+    if (res < 0) {
+        PLOG(ERROR) << "Can't set " << filters.size() << " CAN filters";
+        return false;
+    }
+    return true;
+}
+
 static struct timeval toTimeval(std::chrono::microseconds t) {
     struct timeval tv;
     tv.tv_sec = t / 1s;
@@ -92,49 +222,101 @@ static int selectRead(const base::unique_fd& fd, std::chrono::microseconds timeo
     return select(fd.get() + 1, &readfds, nullptr, nullptr, &timeouttv);
 }
 
+/**
+ * Get the time a frame was received.
+ *
+ * \param msg Message header of the frame, with control messages if kernel timestamps are enabled
+ * \param readTime Time the frame was read, used if the frame has no kernel timestamp
+ * \param bootClock Converter for kernel timestamps
+ * \return Time since boot
+ */
+static std::chrono::nanoseconds receiveTime(const struct msghdr& msg,
+                                            std::chrono::nanoseconds readTime,
+                                            BootClockConverter& bootClock) {
+    if (msg.msg_control == nullptr) return readTime;
+    // CMSG_NXTHDR takes a non-const msghdr, but doesn't modify it.
+    auto& mutableMsg = const_cast<struct msghdr&>(msg);
+    for (auto cmsg = CMSG_FIRSTHDR(&mutableMsg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&mutableMsg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) continue;
+        const auto tss = reinterpret_cast<const struct scm_timestamping*>(CMSG_DATA(cmsg));
+        // ts[0] is the software timestamp, ts[2] would be a hardware one.
+        if (tss->ts[0].tv_sec == 0 && tss->ts[0].tv_nsec == 0) break;
+        return bootClock.toBoottime(tss->ts[0], readTime);
+    }
+    return readTime;
+}
+
 void CanSocket::readerThread() {
     LOG(VERBOSE) << "Reader thread started";
     int errnoCopy = 0;
 
+    std::array<struct canfd_frame, kReadBatchSize> frames;
+    std::array<struct iovec, kReadBatchSize> iovecs;
+    std::array<struct mmsghdr, kReadBatchSize> msgs = {};
+    union ControlBuffer {
+        char buf[CMSG_SPACE(sizeof(struct scm_timestamping))];
+        struct cmsghdr align;
+    };
+    std::array<ControlBuffer, kReadBatchSize> controls;
+    for (size_t i = 0; i < kReadBatchSize; i++) {
+        iovecs[i].iov_base = &frames[i];
+        iovecs[i].iov_len = CAN_MTU;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    BootClockConverter bootClock;
+
+    bool drained = true;
     while (!mStopReaderThread) {
         /* The ideal would be to have a blocking read(3) call and interrupt it with shutdown(3).
-         * This is unfortunately not supported for SocketCAN, so we need to rely on select(3). */
-        const auto sel = selectRead(mSocket, kReadPooling);
-        if (sel == 0) continue;  // timeout
-        if (sel == -1) {
-            PLOG(ERROR) << "Select failed";
-            break;
+         * This is unfortunately not supported for SocketCAN, so we need to rely on select(3).
+         * It's only needed once the socket was drained, a full batch suggests more frames are
+         * already waiting. */
+        if (drained) {
+            const auto sel = selectRead(mSocket, kReadPooling);
+            if (sel == 0) continue;  // timeout
+            if (sel == -1) {
+                PLOG(ERROR) << "Select failed";
+                break;
+            }
         }
 
-        struct canfd_frame frame;
-        const auto nbytes = read(mSocket.get(), &frame, CAN_MTU);
-
-        /* We could use SIOCGSTAMP to get a precise UNIX timestamp for a given packet, but what
-         * we really need is a time since boot. There is no direct way to convert between these
-         * clocks. We could implement a class to calculate the difference between the clocks
-         * (querying both several times and picking the smallest difference); apply the difference
-         * to a SIOCGSTAMP returned value; re-synchronize if the elapsed time is too much in the
-         * past (indicating the UNIX timestamp might have been adjusted).
-         *
-         * Apart from the added complexity, it's possible the added calculations and system calls
-         * would add so much time to the processing pipeline so the precision of the reported time
-         * was buried under the subsystem latency. Let's just use a local time since boot here and
-         * leave precise hardware timestamps for custom proprietary implementations (if needed). */
+        if (mKernelTimestamps) {
+            // The kernel shrinks msg_controllen to the size it used.
+            for (size_t i = 0; i < kReadBatchSize; i++) {
+                msgs[i].msg_hdr.msg_control = controls[i].buf;
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+            }
+        }
+        const auto nmsgs = recvmmsg(mSocket.get(), msgs.data(), kReadBatchSize, MSG_DONTWAIT,
+                                    nullptr);
+
+        /* Frames are reported with the time since boot. With kernel timestamps, that's the time
+         * the frame reached the network stack, converted from the realtime clock. Otherwise it's
+         * the time the batch was read, which includes the scheduling delay of this thread. */
         const std::chrono::nanoseconds ts(elapsedRealtimeNano());
 
-        if (nbytes != CAN_MTU) {
-            if (nbytes >= 0) {
-                LOG(ERROR) << "Failed to read CAN packet, got " << nbytes << " bytes";
-                break;
-            }
+        if (nmsgs < 0) {
+            drained = true;
             if (errno == EAGAIN) continue;
 
             errnoCopy = errno;
-            PLOG(ERROR) << "Failed to read CAN packet";
+            PLOG(ERROR) << "Failed to read CAN packets";
             break;
         }
+        drained = static_cast<size_t>(nmsgs) < kReadBatchSize;
 
-        mReadCallback(frame, ts);
+        bool malformed = false;
+        for (int i = 0; i < nmsgs; i++) {
+            if (msgs[i].msg_len != CAN_MTU) {
+                LOG(ERROR) << "Failed to read CAN packet, got " << msgs[i].msg_len << " bytes";
+                malformed = true;
+                break;
+            }
+            mReadCallback(frames[i], receiveTime(msgs[i].msg_hdr, ts, bootClock));
+        }
+        if (malformed) break;
     }
 
     bool failed = !mStopReaderThread;
@@ -23,6 +23,7 @@
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 namespace android::hardware::automotive::can::V1_0::implementation {
 
@@ -51,6 +52,27 @@ struct CanSocket {
      */
     bool send(const struct canfd_frame& frame);
 
+    /**
+     * Send CAN frames, with as few system calls as possible.
+     *
+     * Frames are sent in order, and sending stops at the first one that fails.
+     *
+     * \param frames Frames to send
+     * \return Number of frames sent
+     */
+    size_t send(const std::vector<struct canfd_frame>& frames);
+
+    /**
+     * Set the frames the kernel delivers to this socket.
+     *
+     * Error frames are not affected.
+     *
+     * \param filters SocketCAN filters, a frame is received if it matches any of them (an empty
+     *        list drops all frames)
+     * \return true in case of success, false otherwise
+     */
+    bool setFilters(const std::vector<struct can_filter>& filters);
+
   private:
     CanSocket(base::unique_fd socket, ReadCallback rdcb, ErrorCallback errcb);
     void readerThread();
@@ -63,6 +85,9 @@ struct CanSocket {
     std::atomic<bool> mStopReaderThread = false;
     std::atomic<bool> mReaderThreadFinished = false;
 
+    /** Whether the kernel timestamps received frames (see SO_TIMESTAMPING). */
+    const bool mKernelTimestamps;
+
     DISALLOW_COPY_AND_ASSIGN(CanSocket);
 };
 
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CanBusVirtual.h"
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+#include <libnetdevice/can.h>
+#include <linux/can.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <optional>
+#include <vector>
+
+namespace android::hardware::automotive::can::V1_0::implementation {
+
+/* Long enough to span several sendmmsg(2) batches, with a partial last one. */
+static constexpr size_t kBatchMessages = 70;
+
+/* The valid messages sent before the invalid one, ending in the middle of a batch. */
+static constexpr size_t kMessagesBeforeInvalid = 40;
+
+static const std::string kIfname = "vcanbatch0";
+
+static CanMessage makeMessage(uint32_t id, size_t payloadSize = CAN_MAX_DLEN) {
+    CanMessage message = {};
+    message.id = id;
+    message.payload.resize(payloadSize);
+    for (size_t i = 0; i < payloadSize; i++) message.payload[i] = id + i;
+    return message;
+}
+
+static std::vector<CanMessage> makeMessages(size_t count) {
+    std::vector<CanMessage> messages;
+    for (size_t i = 0; i < count; i++) messages.push_back(makeMessage(0x100 + i));
+    return messages;
+}
+
+class CanBusBatchTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mBus = new CanBusVirtual(kIfname);
+        ASSERT_EQ(ICanController::Result::OK, mBus->up());
+        mReceiver = netdevice::can::socket(kIfname);
+        ASSERT_TRUE(mReceiver.ok());
+        const struct timeval timeout = {.tv_sec = 0, .tv_usec = 100 * 1000};
+        ASSERT_EQ(0, setsockopt(mReceiver.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                                sizeof(timeout)));
+    }
+
+    void TearDown() override {
+        mReceiver.reset();
+        if (mBus != nullptr) EXPECT_TRUE(mBus->down());
+    }
+
+    /* Reads a frame looped back by vcan, or nullopt if none arrives in time. */
+    std::optional<struct can_frame> receive() {
+        struct can_frame frame;
+        const auto res = read(mReceiver.get(), &frame, sizeof(frame));
+        if (res != static_cast<ssize_t>(sizeof(frame))) return std::nullopt;
+        return frame;
+    }
+
+    void expectReceived(const std::vector<CanMessage>& messages) {
+        for (const auto& message : messages) {
+            const auto frame = receive();
+            ASSERT_TRUE(frame.has_value()) << "Message " << message.id << " not received";
+            EXPECT_EQ(message.id, frame->can_id);
+            ASSERT_EQ(message.payload.size(), frame->len);
+            EXPECT_EQ(0, memcmp(message.payload.data(), frame->data, frame->len));
+        }
+        EXPECT_FALSE(receive().has_value()) << "More frames received than sent";
+    }
+
+    sp<CanBusVirtual> mBus;
+    base::unique_fd mReceiver;
+};
+
+TEST_F(CanBusBatchTest, SendsEveryMessageInOrder) {
+    const auto messages = makeMessages(kBatchMessages);
+    size_t sent;
+    EXPECT_EQ(Result::OK, mBus->sendBatch(messages, &sent));
+    EXPECT_EQ(messages.size(), sent);
+    expectReceived(messages);
+}
+
+TEST_F(CanBusBatchTest, EmptyBatchSendsNothing) {
+    size_t sent = 1;
+    EXPECT_EQ(Result::OK, mBus->sendBatch({}, &sent));
+    EXPECT_EQ(0u, sent);
+    expectReceived({});
+}
+
+TEST_F(CanBusBatchTest, StopsAtInvalidMessage) {
+    auto messages = makeMessages(kBatchMessages);
+    messages[kMessagesBeforeInvalid].payload.resize(CAN_MAX_DLEN + 1);
+    size_t sent;
+    EXPECT_EQ(Result::PAYLOAD_TOO_LONG, mBus->sendBatch(messages, &sent));
+    EXPECT_EQ(kMessagesBeforeInvalid, sent);
+    messages.resize(kMessagesBeforeInvalid);
+    expectReceived(messages);
+}
+
+TEST_F(CanBusBatchTest, InvalidFirstMessageSendsNothing) {
+    auto messages = makeMessages(kBatchMessages);
+    messages.front().payload.resize(CAN_MAX_DLEN + 1);
+    size_t sent = 1;
+    EXPECT_EQ(Result::PAYLOAD_TOO_LONG, mBus->sendBatch(messages, &sent));
+    EXPECT_EQ(0u, sent);
+    expectReceived({});
+}
+
+TEST_F(CanBusBatchTest, BatchMatchesSingleSends) {
+    const auto messages = makeMessages(kBatchMessages);
+    for (const auto& message : messages) {
+        EXPECT_EQ(Result::OK, static_cast<Result>(mBus->send(message)));
+    }
+    expectReceived(messages);
+    size_t sent;
+    EXPECT_EQ(Result::OK, mBus->sendBatch(messages, &sent));
+    expectReceived(messages);
+}
+
+TEST(CanBusBatchDownTest, FailsWhileDown) {
+    sp<CanBusVirtual> bus = new CanBusVirtual(kIfname);
+    size_t sent = 1;
+    EXPECT_EQ(Result::INTERFACE_DOWN, bus->sendBatch(makeMessages(1), &sent));
+    EXPECT_EQ(0u, sent);
+}
+
+}  // namespace android::hardware::automotive::can::V1_0::implementation
@@ -31,6 +31,7 @@
 #include <utils/SystemClock.h>
 
 #include <chrono>
+#include <cmath>
 #include <thread>
 
 namespace android::hardware::automotive::can::V1_0::vts {
@@ -864,6 +865,144 @@ TEST_P(CanBusVirtualHalTest, FilterMixed) {
     ASSERT_EQ(expectedMixed, messagesMixed);
 }
 
+TEST_P(CanBusVirtualHalTest, FilterMultipleListeners) {
+    if (mBusNames.size() < 2u) GTEST_SKIP() << "Not testable with less than two CAN buses.";
+    auto bus1 = makeBus();
+    auto bus2 = makeBus();
+
+    /* clang-format off */
+    /*        id,    mask,  rtr,                   eff,                   exclude */
+    auto listenerRange = bus2.listen({
+            {0x100, 0x700, FilterFlag::DONT_CARE, FilterFlag::DONT_CARE, false},
+    });
+    auto listenerSingle = bus2.listen({
+            {0x7DF, 0x7FF, FilterFlag::NOT_SET,   FilterFlag::NOT_SET,   false},
+    });
+    auto listenerExclude = bus2.listen({
+            {0x123, 0x7FF, FilterFlag::DONT_CARE, FilterFlag::DONT_CARE, true},
+    });
+    /* clang-format on */
+
+    bus1.send(makeMessage(0x123, false, false));
+    bus1.send(makeMessage(0x1AB, true, false));
+    bus1.send(makeMessage(0x7DF, false, false));
+    bus1.send(makeMessage(0x7DF, true, false));
+    bus1.send(makeMessage(0x456, false, true));
+
+    std::vector<can::V1_0::CanMessage> expectedRange{
+            makeMessage(0x123, false, false),
+            makeMessage(0x1AB, true, false),
+    };
+    std::vector<can::V1_0::CanMessage> expectedSingle{
+            makeMessage(0x7DF, false, false),
+    };
+    std::vector<can::V1_0::CanMessage> expectedExclude{
+            makeMessage(0x1AB, true, false),
+            makeMessage(0x7DF, false, false),
+            makeMessage(0x7DF, true, false),
+            makeMessage(0x456, false, true),
+    };
+
+    auto messagesRange = listenerRange->fetchMessages(100ms, expectedRange.size());
+    clearTimestamps(messagesRange);
+    ASSERT_EQ(expectedRange, messagesRange);
+    auto messagesSingle = listenerSingle->fetchMessages(100ms, expectedSingle.size());
+    clearTimestamps(messagesSingle);
+    ASSERT_EQ(expectedSingle, messagesSingle);
+    auto messagesExclude = listenerExclude->fetchMessages(100ms, expectedExclude.size());
+    clearTimestamps(messagesExclude);
+    ASSERT_EQ(expectedExclude, messagesExclude);
+
+    // The remaining listeners still get their frames once the widest one is gone.
+    listenerExclude.clear();
+    bus1.send(makeMessage(0x456, false, true));
+    bus1.send(makeMessage(0x7DF, false, false));
+    bus1.send(makeMessage(0x123, false, false));
+
+    expectedRange = {makeMessage(0x123, false, false)};
+    messagesRange = listenerRange->fetchMessages(100ms, expectedRange.size());
+    clearTimestamps(messagesRange);
+    ASSERT_EQ(expectedRange, messagesRange);
+    messagesSingle = listenerSingle->fetchMessages(100ms, expectedSingle.size());
+    clearTimestamps(messagesSingle);
+    ASSERT_EQ(expectedSingle, messagesSingle);
+}
+
+TEST_P(CanBusVirtualHalTest, FilterBurst) {
+    if (mBusNames.size() < 2u) GTEST_SKIP() << "Not testable with less than two CAN buses.";
+    auto bus1 = makeBus();
+    auto bus2 = makeBus();
+
+    static constexpr unsigned kNumFrames = 5000;
+    static constexpr unsigned kMatchingEvery = 10;
+
+    auto listener = bus2.listen({
+            {0x7DF, 0x7FF, FilterFlag::DONT_CARE, FilterFlag::DONT_CARE, false},
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < kNumFrames; i++) {
+        auto msg = makeMessage(i % kMatchingEvery == 0 ? 0x7DF : 0x100 + i % 0x600, false, false);
+        msg.payload = {uint8_t(i), uint8_t(i >> 8)};
+        bus1.send(msg);
+    }
+    const auto messages = listener->fetchMessages(5s, kNumFrames / kMatchingEvery);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(kNumFrames / kMatchingEvery, messages.size());
+    for (unsigned i = 0; i < messages.size(); i++) {
+        const unsigned frame = i * kMatchingEvery;
+        ASSERT_EQ(0x7DFu, messages[i].id);
+        ASSERT_EQ(hidl_vec<uint8_t>({uint8_t(frame), uint8_t(frame >> 8)}), messages[i].payload);
+    }
+
+    const auto framesPerSecond = kNumFrames * 1s / elapsed;
+    RecordProperty("framesPerSecond", std::to_string(framesPerSecond));
+    LOG(INFO) << "Sent " << kNumFrames << " frames at " << framesPerSecond << " frames/s";
+}
+
+TEST_P(CanBusVirtualHalTest, RecvTimestamps) {
+    if (mBusNames.size() < 2u) GTEST_SKIP() << "Not testable with less than two CAN buses.";
+    auto bus1 = makeBus();
+    auto bus2 = makeBus();
+
+    static constexpr unsigned kNumFrames = 200;
+
+    auto listener = bus2.listen({});
+
+    std::vector<uint64_t> sendTimes;
+    for (unsigned i = 0; i < kNumFrames; i++) {
+        sendTimes.push_back(elapsedRealtimeNano());
+        bus1.send(makeMessage(0x123, false, false));
+        std::this_thread::sleep_for(1ms);
+    }
+    const auto messages = listener->fetchMessages(1s, kNumFrames);
+    ASSERT_EQ(kNumFrames, messages.size());
+
+    /* The timestamp is when the frame was received, so it's between the send call and the time
+     * of the next frame being sent, no matter how late the HAL gets to read it. */
+    double sum = 0;
+    double sumSquares = 0;
+    uint64_t maxLatency = 0;
+    for (unsigned i = 0; i < kNumFrames; i++) {
+        ASSERT_LE(sendTimes[i], messages[i].timestamp);
+        if (i + 1 < kNumFrames) ASSERT_GT(sendTimes[i + 1], messages[i].timestamp);
+
+        const auto latency = messages[i].timestamp - sendTimes[i];
+        sum += latency;
+        sumSquares += double(latency) * latency;
+        maxLatency = std::max(maxLatency, latency);
+    }
+    const auto meanLatency = sum / kNumFrames;
+    const auto jitter = std::sqrt(sumSquares / kNumFrames - meanLatency * meanLatency);
+
+    RecordProperty("meanLatencyNs", std::to_string(uint64_t(meanLatency)));
+    RecordProperty("maxLatencyNs", std::to_string(maxLatency));
+    RecordProperty("jitterNs", std::to_string(uint64_t(jitter)));
+    LOG(INFO) << "Loopback latency: mean " << uint64_t(meanLatency) << "ns, max " << maxLatency
+              << "ns, jitter " << uint64_t(jitter) << "ns";
+}
+
 /**
  * Example manual invocation:
  * adb shell /data/nativetest64/VtsHalCanBusVirtualV1_0TargetTest/VtsHalCanBusVirtualV1_0TargetTest
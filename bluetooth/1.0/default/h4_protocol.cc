@@ -78,63 +78,28 @@ size_t H4Protocol::Send(uint8_t type, const uint8_t* data, size_t length) {
   return bytes_written;
 }
 
-void H4Protocol::OnPacketReady() {
-  switch (hci_packet_type_) {
+void H4Protocol::OnPacketReady(HciPacketType type,
+                               const hidl_vec<uint8_t>& packet) {
+  switch (type) {
     case HCI_PACKET_TYPE_EVENT:
-      event_cb_(hci_packetizer_.GetPacket());
+      event_cb_(packet);
       break;
     case HCI_PACKET_TYPE_ACL_DATA:
-      acl_cb_(hci_packetizer_.GetPacket());
+      acl_cb_(packet);
       break;
     case HCI_PACKET_TYPE_SCO_DATA:
-      sco_cb_(hci_packetizer_.GetPacket());
+      sco_cb_(packet);
       break;
     case HCI_PACKET_TYPE_ISO_DATA:
-      iso_cb_(hci_packetizer_.GetPacket());
-      break;
-    case HCI_PACKET_TYPE_UNKNOWN:
-      ALOGE("%s: Unknown packet sent", __func__);
+      iso_cb_(packet);
       break;
     default:
       LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
-                       static_cast<int>(hci_packet_type_));
+                       static_cast<int>(type));
   }
-  // Get ready for the next type byte.
-  hci_packet_type_ = HCI_PACKET_TYPE_UNKNOWN;
 }
 
-void H4Protocol::OnDataReady(int fd) {
-  if (hci_packet_type_ == HCI_PACKET_TYPE_UNKNOWN) {
-    uint8_t buffer[1] = {0};
-    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, 1));
-    if (bytes_read != 1) {
-      if (bytes_read == 0) {
-        // This is only expected if the UART got closed when shutting down.
-        ALOGE("%s: Unexpected EOF reading the packet type!", __func__);
-        sleep(5);  // Expect to be shut down within 5 seconds.
-        return;
-      } else if (bytes_read < 0) {
-        LOG_ALWAYS_FATAL("%s: Read packet type error: %s", __func__,
-                         strerror(errno));
-      } else {
-        LOG_ALWAYS_FATAL("%s: More bytes read than expected (%u)!", __func__,
-                         static_cast<unsigned int>(bytes_read));
-      }
-    }
-    hci_packet_type_ = static_cast<HciPacketType>(buffer[0]);
-    if (hci_packet_type_ == HCI_PACKET_TYPE_UNKNOWN) {
-        ALOGE("%s: Unknown packet sent", __func__);
-    } else if (hci_packet_type_ != HCI_PACKET_TYPE_ACL_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_SCO_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_ISO_DATA &&
-        hci_packet_type_ != HCI_PACKET_TYPE_EVENT) {
-      LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
-                       static_cast<int>(hci_packet_type_));
-    }
-  } else {
-    hci_packetizer_.OnDataReady(fd, hci_packet_type_);
-  }
-}
+void H4Protocol::OnDataReady(int fd) { packet_reader_.OnDataReady(fd); }
 
 }  // namespace hci
 }  // namespace bluetooth
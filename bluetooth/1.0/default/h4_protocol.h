@@ -37,14 +37,21 @@ class H4Protocol : public HciProtocol {
         acl_cb_(acl_cb),
         sco_cb_(sco_cb),
         iso_cb_(iso_cb),
-        hci_packetizer_([this]() { OnPacketReady(); }) {}
+        packet_reader_(
+            [this](HciPacketType type, const hidl_vec<uint8_t>& packet) {
+              OnPacketReady(type, packet);
+            }) {}
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnPacketReady();
+  void OnPacketReady(HciPacketType type, const hidl_vec<uint8_t>& packet);
 
   void OnDataReady(int fd);
 
+  const HciPacketReader::Stats& GetReadStats() const {
+    return packet_reader_.GetStats();
+  }
+
  private:
   int uart_fd_;
 
@@ -53,8 +60,7 @@ class H4Protocol : public HciProtocol {
   PacketReadCallback sco_cb_;
   PacketReadCallback iso_cb_;
 
-  HciPacketType hci_packet_type_{HCI_PACKET_TYPE_UNKNOWN};
-  hci::HciPacketizer hci_packetizer_;
+  hci::HciPacketReader packet_reader_;
 };
 
 }  // namespace hci
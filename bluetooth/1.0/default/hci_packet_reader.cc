@@ -0,0 +1,178 @@
+//
+// Copyright 2024 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hci_packet_reader.h"
+
+#define LOG_TAG "android.hardware.bluetooth.hci_packet_reader"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <utils/Log.h>
+
+namespace {
+
+const size_t preamble_size_for_type[] = {0,
+                                         HCI_COMMAND_PREAMBLE_SIZE,
+                                         HCI_ACL_PREAMBLE_SIZE,
+                                         HCI_SCO_PREAMBLE_SIZE,
+                                         HCI_EVENT_PREAMBLE_SIZE,
+                                         HCI_ISO_PREAMBLE_SIZE};
+const size_t packet_length_offset_for_type[] = {0,
+                                                HCI_LENGTH_OFFSET_CMD,
+                                                HCI_LENGTH_OFFSET_ACL,
+                                                HCI_LENGTH_OFFSET_SCO,
+                                                HCI_LENGTH_OFFSET_EVT,
+                                                HCI_LENGTH_OFFSET_ISO};
+
+// The largest packet is an ACL packet with a 16 bit length, after its type.
+const size_t kMaxPacketSize = 1 + HCI_ACL_PREAMBLE_SIZE + 0xFFFF;
+// Free space kept behind a partial packet for the next read.
+const size_t kMinReadSize = 16 * 1024;
+
+size_t HciGetPacketLengthForType(HciPacketType type, const uint8_t* preamble) {
+  size_t offset = packet_length_offset_for_type[type];
+  if (type == HCI_PACKET_TYPE_ACL_DATA) {
+    return (((preamble[offset + 1]) << 8) | preamble[offset]);
+  } else if (type == HCI_PACKET_TYPE_ISO_DATA) {
+    return ((((preamble[offset + 1]) & 0x3f) << 8) | preamble[offset]);
+  }
+  return preamble[offset];
+}
+
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace hci {
+
+HciPacketReader::HciPacketReader(PacketReadyCallback packet_cb)
+    : has_type_prefix_(true),
+      packet_type_(HCI_PACKET_TYPE_UNKNOWN),
+      packet_ready_cb_(packet_cb),
+      buffer_(kMaxPacketSize + kMinReadSize) {}
+
+HciPacketReader::HciPacketReader(HciPacketType packet_type,
+                                 PacketReadyCallback packet_cb)
+    : has_type_prefix_(false),
+      packet_type_(packet_type),
+      packet_ready_cb_(packet_cb),
+      buffer_(kMaxPacketSize + kMinReadSize) {}
+
+HciPacketReader::~HciPacketReader() {
+  if (stats_.packets == 0) {
+    return;
+  }
+  double seconds =
+      std::chrono::duration<double>(stats_.active_time).count();
+  ALOGI("%s: %" PRIu64 " packets, %" PRIu64 " bytes in %" PRIu64
+        " reads (%.3f reads per packet, %.1f kB/s)",
+        __func__, stats_.packets, stats_.bytes_read, stats_.read_calls,
+        static_cast<double>(stats_.read_calls) / stats_.packets,
+        seconds > 0 ? stats_.bytes_read / seconds / 1000 : 0.0);
+}
+
+void HciPacketReader::OnDataReady(int fd) {
+  // A partial packet is always smaller than kMaxPacketSize, so moving it to
+  // the front leaves at least kMinReadSize bytes to read into.
+  if (buffer_.size() - end_ < kMinReadSize) {
+    memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+
+  ssize_t bytes_read = TEMP_FAILURE_RETRY(
+      read(fd, buffer_.data() + end_, buffer_.size() - end_));
+  stats_.read_calls++;
+  if (bytes_read == 0) {
+    // This is only expected if the UART got closed when shutting down.
+    ALOGE("%s: Unexpected EOF reading from the UART!", __func__);
+    sleep(5);  // Expect to be shut down within 5 seconds.
+    return;
+  }
+  if (bytes_read < 0) {
+    if (errno == EAGAIN) {
+      return;
+    }
+    LOG_ALWAYS_FATAL("%s: Read error: %s", __func__, strerror(errno));
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (stats_.bytes_read == 0) {
+    first_read_time_ = now;
+  }
+  stats_.active_time = now - first_read_time_;
+  stats_.bytes_read += bytes_read;
+  end_ += bytes_read;
+
+  FramePackets();
+}
+
+void HciPacketReader::FramePackets() {
+  while (begin_ < end_) {
+    uint8_t* data = buffer_.data() + begin_;
+    size_t available = end_ - begin_;
+
+    HciPacketType packet_type = packet_type_;
+    size_t type_size = 0;
+    if (has_type_prefix_) {
+      packet_type = static_cast<HciPacketType>(data[0]);
+      type_size = 1;
+      if (packet_type == HCI_PACKET_TYPE_UNKNOWN) {
+        ALOGE("%s: Unknown packet sent", __func__);
+        begin_ += type_size;
+        continue;
+      }
+      if (packet_type != HCI_PACKET_TYPE_ACL_DATA &&
+          packet_type != HCI_PACKET_TYPE_SCO_DATA &&
+          packet_type != HCI_PACKET_TYPE_ISO_DATA &&
+          packet_type != HCI_PACKET_TYPE_EVENT) {
+        LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
+                         static_cast<int>(packet_type));
+      }
+    }
+
+    size_t preamble_size = preamble_size_for_type[packet_type];
+    if (available < type_size + preamble_size) {
+      break;
+    }
+    size_t packet_size =
+        preamble_size +
+        HciGetPacketLengthForType(packet_type, data + type_size);
+    if (available < type_size + packet_size) {
+      break;
+    }
+
+    hidl_vec<uint8_t> packet;
+    packet.setToExternal(data + type_size, packet_size);
+    stats_.packets++;
+    packet_ready_cb_(packet_type, packet);
+    begin_ += type_size + packet_size;
+  }
+
+  // Most reads end on a packet boundary; start the next one at the front.
+  if (begin_ == end_) {
+    begin_ = 0;
+    end_ = 0;
+  }
+}
+
+}  // namespace hci
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,81 @@
+//
+// Copyright 2024 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <hidl/HidlSupport.h>
+
+#include "hci_internals.h"
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace hci {
+
+using ::android::hardware::hidl_vec;
+
+// Reads HCI packets from a UART in large chunks. A single read may complete
+// several packets, which are framed in place in a reusable buffer and handed
+// to the callback without being copied.
+class HciPacketReader {
+ public:
+  // |packet| refers to the reader's buffer and is only valid during the call.
+  using PacketReadyCallback =
+      std::function<void(HciPacketType type, const hidl_vec<uint8_t>& packet)>;
+
+  struct Stats {
+    uint64_t read_calls{0};
+    uint64_t bytes_read{0};
+    uint64_t packets{0};
+    // Time between the first and the last read which returned data.
+    std::chrono::nanoseconds active_time{0};
+  };
+
+  // Reads H4 packets, each prefixed with its packet type.
+  explicit HciPacketReader(PacketReadyCallback packet_cb);
+  // Reads packets of |packet_type| without a type prefix, as sent on the
+  // dedicated channels of the multi-channel transport.
+  HciPacketReader(HciPacketType packet_type, PacketReadyCallback packet_cb);
+  ~HciPacketReader();
+
+  void OnDataReady(int fd);
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  // Delivers the complete packets in the buffer.
+  void FramePackets();
+
+  const bool has_type_prefix_;
+  const HciPacketType packet_type_;
+  PacketReadyCallback packet_ready_cb_;
+  std::vector<uint8_t> buffer_;
+  // The bytes of |buffer_| in [begin_, end_) have been read but not framed.
+  size_t begin_{0};
+  size_t end_{0};
+  Stats stats_;
+  std::chrono::steady_clock::time_point first_read_time_;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
@@ -20,7 +20,7 @@
 
 #include "bt_vendor_lib.h"
 #include "hci_internals.h"
-#include "hci_packetizer.h"
+#include "hci_packet_reader.h"
 
 namespace android {
 namespace hardware {
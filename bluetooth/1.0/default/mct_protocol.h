@@ -34,9 +34,6 @@ class MctProtocol : public HciProtocol {
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnEventPacketReady();
-  void OnAclDataPacketReady();
-
   void OnEventDataReady(int fd);
   void OnAclDataReady(int fd);
 
@@ -46,8 +43,8 @@ class MctProtocol : public HciProtocol {
   PacketReadCallback event_cb_;
   PacketReadCallback acl_cb_;
 
-  hci::HciPacketizer event_packetizer_;
-  hci::HciPacketizer acl_packetizer_;
+  hci::HciPacketReader event_reader_;
+  hci::HciPacketReader acl_reader_;
 };
 
 }  // namespace hci
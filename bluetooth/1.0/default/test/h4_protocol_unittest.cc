@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <cstring>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include <log/log.h>
@@ -66,6 +67,12 @@ MATCHER_P3(HidlVecMatches, preamble, preamble_length, payload, "") {
                 length - preamble_length) == 0;
 };
 
+ACTION_P3(CountAndNotify, mutex, condition, count) {
+  std::unique_lock<std::mutex> lock(*mutex);
+  (*count)++;
+  condition->notify_one();
+}
+
 ACTION_P2(Notify, mutex, condition) {
   ALOGD("%s", __func__);
   std::unique_lock<std::mutex> lock(*mutex);
@@ -122,17 +129,17 @@ class H4ProtocolTest : public ::testing::Test {
     preamble[3] = length & 0xFF;
     preamble[4] = (length >> 8) & 0xFF;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(acl_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
@@ -147,17 +154,17 @@ class H4ProtocolTest : public ::testing::Test {
     char preamble[4] = {HCI_PACKET_TYPE_SCO_DATA, 20, 17, 0};
     preamble[3] = strlen(payload) & 0xFF;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(sco_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
@@ -171,20 +178,23 @@ class H4ProtocolTest : public ::testing::Test {
     // h4 type[1] + event_code[1] + size[1]
     char preamble[3] = {HCI_PACKET_TYPE_EVENT, 9, 0};
     preamble[2] = strlen(payload) & 0xFF;
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(event_cb_, Call(HidlVecMatches(preamble + 1,
                                                sizeof(preamble) - 1, payload)))
         .WillOnce(Notify(&mutex, &done));
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
+    // Fail if it takes longer than 100 ms.
+    auto timeout_time =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
     {
       std::unique_lock<std::mutex> lock(mutex);
-      done.wait(lock);
+      done.wait_until(lock, timeout_time);
     }
   }
 
@@ -195,17 +205,17 @@ class H4ProtocolTest : public ::testing::Test {
     preamble[3] = length & 0xFF;
     preamble[4] = (length >> 8) & 0x3F;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(iso_cb_, Call(HidlVecMatches(preamble + 1, sizeof(preamble) - 1,
                                              payload)))
         .WillOnce(Notify(&mutex, &done));
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_, preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_, payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
@@ -215,6 +225,32 @@ class H4ProtocolTest : public ::testing::Test {
     }
   }
 
+  // Appends an H4 packet of |type| with |payload| to |uart_data|, and returns
+  // the offset of its preamble.
+  size_t AppendPacket(std::vector<char>* uart_data, uint8_t type,
+                      const char* payload) {
+    size_t length = strlen(payload);
+    uart_data->push_back(type);
+    size_t preamble_offset = uart_data->size();
+    switch (type) {
+      case HCI_PACKET_TYPE_ACL_DATA:
+        uart_data->insert(uart_data->end(), {19, 92, 0, 0});
+        (*uart_data)[preamble_offset + 2] = length & 0xFF;
+        (*uart_data)[preamble_offset + 3] = (length >> 8) & 0xFF;
+        break;
+      case HCI_PACKET_TYPE_SCO_DATA:
+        uart_data->insert(uart_data->end(), {20, 17, 0});
+        (*uart_data)[preamble_offset + 2] = length & 0xFF;
+        break;
+      case HCI_PACKET_TYPE_EVENT:
+        uart_data->insert(uart_data->end(), {9, 0});
+        (*uart_data)[preamble_offset + 1] = length & 0xFF;
+        break;
+    }
+    uart_data->insert(uart_data->end(), payload, payload + length);
+    return preamble_offset;
+  }
+
   testing::MockFunction<void(const hidl_vec<uint8_t>&)> event_cb_;
   testing::MockFunction<void(const hidl_vec<uint8_t>&)> acl_cb_;
   testing::MockFunction<void(const hidl_vec<uint8_t>&)> sco_cb_;
@@ -240,6 +276,86 @@ TEST_F(H4ProtocolTest, TestReads) {
   WriteAndExpectInboundIsoData(iso_data);
 }
 
+// Ensure all the packets completed by a single read are delivered
+TEST_F(H4ProtocolTest, TestBatchedReads) {
+  std::vector<char> uart_data;
+  size_t acl_offset =
+      AppendPacket(&uart_data, HCI_PACKET_TYPE_ACL_DATA, acl_data);
+  size_t event_offset =
+      AppendPacket(&uart_data, HCI_PACKET_TYPE_EVENT, event_data);
+  size_t sco_offset =
+      AppendPacket(&uart_data, HCI_PACKET_TYPE_SCO_DATA, sco_data);
+  size_t event2_offset =
+      AppendPacket(&uart_data, HCI_PACKET_TYPE_EVENT, sample_data1);
+
+  std::mutex mutex;
+  std::condition_variable done;
+  int packets = 0;
+  EXPECT_CALL(acl_cb_, Call(HidlVecMatches(&uart_data[acl_offset], 4,
+                                           acl_data)))
+      .WillOnce(CountAndNotify(&mutex, &done, &packets));
+  {
+    ::testing::InSequence s;
+    EXPECT_CALL(event_cb_, Call(HidlVecMatches(&uart_data[event_offset], 2,
+                                               event_data)))
+        .WillOnce(CountAndNotify(&mutex, &done, &packets));
+    EXPECT_CALL(event_cb_, Call(HidlVecMatches(&uart_data[event2_offset], 2,
+                                               sample_data1)))
+        .WillOnce(CountAndNotify(&mutex, &done, &packets));
+  }
+  EXPECT_CALL(sco_cb_, Call(HidlVecMatches(&uart_data[sco_offset], 3,
+                                           sco_data)))
+      .WillOnce(CountAndNotify(&mutex, &done, &packets));
+
+  ALOGD("%s writing", __func__);
+  TEMP_FAILURE_RETRY(write(fake_uart_, uart_data.data(), uart_data.size()));
+
+  auto timeout_time =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait_until(lock, timeout_time, [&packets] { return packets == 4; });
+    EXPECT_EQ(4, packets);
+  }
+
+  auto stats = protocol_->GetReadStats();
+  EXPECT_EQ(4u, stats.packets);
+  EXPECT_EQ(uart_data.size(), stats.bytes_read);
+  EXPECT_LT(stats.read_calls, stats.packets);
+}
+
+// Ensure a packet split across several reads is reassembled
+TEST_F(H4ProtocolTest, TestSplitRead) {
+  std::vector<char> uart_data;
+  size_t acl_offset =
+      AppendPacket(&uart_data, HCI_PACKET_TYPE_ACL_DATA, acl_data);
+
+  std::mutex mutex;
+  std::condition_variable done;
+  int packets = 0;
+  EXPECT_CALL(acl_cb_, Call(HidlVecMatches(&uart_data[acl_offset], 4,
+                                           acl_data)))
+      .WillOnce(CountAndNotify(&mutex, &done, &packets));
+
+  // Split the preamble, then the payload.
+  size_t splits[] = {3, 20, uart_data.size()};
+  size_t written = 0;
+  for (size_t split : splits) {
+    TEMP_FAILURE_RETRY(
+        write(fake_uart_, uart_data.data() + written, split - written));
+    written = split;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  auto timeout_time =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait_until(lock, timeout_time, [&packets] { return packets == 1; });
+    EXPECT_EQ(1, packets);
+  }
+}
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace bluetooth
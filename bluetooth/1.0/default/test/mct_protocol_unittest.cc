@@ -149,17 +149,17 @@ class MctProtocolTest : public ::testing::Test {
     char preamble[2] = {9, 0};
     preamble[1] = strlen(payload) & 0xFF;
 
-    ALOGD("%s writing", __func__);
-    TEMP_FAILURE_RETRY(write(fake_uart_[CH_EVT], preamble, sizeof(preamble)));
-    TEMP_FAILURE_RETRY(write(fake_uart_[CH_EVT], payload, strlen(payload)));
-
-    ALOGD("%s waiting", __func__);
     std::mutex mutex;
     std::condition_variable done;
     EXPECT_CALL(event_cb_,
                 Call(HidlVecMatches(preamble, sizeof(preamble), payload)))
         .WillOnce(Notify(&mutex, &done));
 
+    ALOGD("%s writing", __func__);
+    TEMP_FAILURE_RETRY(write(fake_uart_[CH_EVT], preamble, sizeof(preamble)));
+    TEMP_FAILURE_RETRY(write(fake_uart_[CH_EVT], payload, strlen(payload)));
+
+    ALOGD("%s waiting", __func__);
     // Fail if it takes longer than 100 ms.
     auto timeout_time =
         std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
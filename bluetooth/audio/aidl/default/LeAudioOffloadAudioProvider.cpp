@@ -22,6 +22,9 @@
 #include <BluetoothAudioSessionReport.h>
 #include <android-base/logging.h>
 
+#include <algorithm>
+#include <tuple>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -168,7 +171,7 @@ bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedContext(
   // If has no metadata, assume match
   if (!capabilities.metadata.has_value()) return true;
 
-  for (auto metadata : capabilities.metadata.value()) {
+  for (auto& metadata : capabilities.metadata.value()) {
     if (!metadata.has_value()) continue;
     if (metadata.value().getTag() == MetadataLtv::Tag::preferredAudioContexts) {
       // Check all pref audio context to see if anything matched
@@ -183,28 +186,27 @@ bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedContext(
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedSamplingFreq(
-    CodecSpecificConfigurationLtv::SamplingFrequency& cfg_freq,
-    CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies&
+    const CodecSpecificConfigurationLtv::SamplingFrequency& cfg_freq,
+    const CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies&
         capability_freq) {
-  for (auto [freq, bitmask] : freq_to_support_bitmask_map)
-    if (cfg_freq == freq) return (capability_freq.bitmask & bitmask);
-  return false;
+  auto bitmask = freq_to_support_bitmask_map.find(cfg_freq);
+  if (bitmask == freq_to_support_bitmask_map.end()) return false;
+  return capability_freq.bitmask & bitmask->second;
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedFrameDuration(
-    CodecSpecificConfigurationLtv::FrameDuration& cfg_fduration,
-    CodecSpecificCapabilitiesLtv::SupportedFrameDurations&
+    const CodecSpecificConfigurationLtv::FrameDuration& cfg_fduration,
+    const CodecSpecificCapabilitiesLtv::SupportedFrameDurations&
         capability_fduration) {
-  for (auto [fduration, bitmask] : fduration_to_support_fduration_map)
-    if (cfg_fduration == fduration)
-      return (capability_fduration.bitmask & bitmask);
-  return false;
+  auto bitmask = fduration_to_support_fduration_map.find(cfg_fduration);
+  if (bitmask == fduration_to_support_fduration_map.end()) return false;
+  return capability_fduration.bitmask & bitmask->second;
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedAudioChannel(
-    CodecSpecificConfigurationLtv::AudioChannelAllocation&
+    const CodecSpecificConfigurationLtv::AudioChannelAllocation&
     /*cfg_channel*/,
-    CodecSpecificCapabilitiesLtv::SupportedAudioChannelCounts&
+    const CodecSpecificCapabilitiesLtv::SupportedAudioChannelCounts&
     /*capability_channel*/) {
   bool isMatched = true;
   // TODO: how to match?
@@ -212,55 +214,59 @@ bool LeAudioOffloadAudioProvider::isMatchedAudioChannel(
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedCodecFramesPerSDU(
-    CodecSpecificConfigurationLtv::CodecFrameBlocksPerSDU& cfg_frame_sdu,
-    CodecSpecificCapabilitiesLtv::SupportedMaxCodecFramesPerSDU&
+    const CodecSpecificConfigurationLtv::CodecFrameBlocksPerSDU& cfg_frame_sdu,
+    const CodecSpecificCapabilitiesLtv::SupportedMaxCodecFramesPerSDU&
         capability_frame_sdu) {
   return cfg_frame_sdu.value <= capability_frame_sdu.value;
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedOctetsPerCodecFrame(
-    CodecSpecificConfigurationLtv::OctetsPerCodecFrame& cfg_octets,
-    CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame&
+    const CodecSpecificConfigurationLtv::OctetsPerCodecFrame& cfg_octets,
+    const CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame&
         capability_octets) {
   return cfg_octets.value >= capability_octets.minimum &&
          cfg_octets.value <= capability_octets.maximum;
 }
 
-bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedCodecConfiguration(
-    std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
-    std::vector<CodecSpecificCapabilitiesLtv> codec_capabilities) {
-  // Convert all codec_cfg into a map of tags -> correct data
-  std::map<CodecSpecificConfigurationLtv::Tag, CodecSpecificConfigurationLtv>
-      cfg_tag_map;
-  for (auto codec_cfg_data : codec_cfg)
-    cfg_tag_map[codec_cfg_data.getTag()] = codec_cfg_data;
+/* Find the codec configuration with |tag|. Codec configurations are short, and
+ * the last one with a tag wins. */
+static const CodecSpecificConfigurationLtv* findCodecConfiguration(
+    const std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
+    CodecSpecificConfigurationLtv::Tag tag) {
+  for (auto it = codec_cfg.rbegin(); it != codec_cfg.rend(); ++it)
+    if (it->getTag() == tag) return &*it;
+  return nullptr;
+}
 
+bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedCodecConfiguration(
+    const std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
+    const std::vector<CodecSpecificCapabilitiesLtv>& codec_capabilities) {
   for (auto& codec_capability : codec_capabilities) {
-    auto cfg = cfg_tag_map.find(cap_to_cfg_tag_map[codec_capability.getTag()]);
+    auto cfg_tag = cap_to_cfg_tag_map.find(codec_capability.getTag());
+    if (cfg_tag == cap_to_cfg_tag_map.end()) return false;
+    auto cfg = findCodecConfiguration(codec_cfg, cfg_tag->second);
     // Cannot find tag for the capability:
-    if (cfg == cfg_tag_map.end()) return false;
+    if (cfg == nullptr) return false;
 
     // Matching logic for sampling frequency
     if (codec_capability.getTag() ==
         CodecSpecificCapabilitiesLtv::Tag::supportedSamplingFrequencies) {
       if (!isMatchedSamplingFreq(
-              cfg->second
-                  .get<CodecSpecificConfigurationLtv::Tag::samplingFrequency>(),
+              cfg->get<CodecSpecificConfigurationLtv::Tag::samplingFrequency>(),
               codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
                                        supportedSamplingFrequencies>()))
         return false;
     } else if (codec_capability.getTag() ==
                CodecSpecificCapabilitiesLtv::Tag::supportedFrameDurations) {
       if (!isMatchedFrameDuration(
-              cfg->second
-                  .get<CodecSpecificConfigurationLtv::Tag::frameDuration>(),
+              cfg->get<CodecSpecificConfigurationLtv::Tag::frameDuration>(),
               codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
                                        supportedFrameDurations>()))
         return false;
     } else if (codec_capability.getTag() ==
                CodecSpecificCapabilitiesLtv::Tag::supportedAudioChannelCounts) {
       if (!isMatchedAudioChannel(
-              cfg->second.get<
+              cfg->get<
                   CodecSpecificConfigurationLtv::Tag::audioChannelAllocation>(),
               codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
                                        supportedAudioChannelCounts>()))
@@ -268,7 +274,7 @@ bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedCodecConfiguration(
     } else if (codec_capability.getTag() == CodecSpecificCapabilitiesLtv::Tag::
                                                 supportedMaxCodecFramesPerSDU) {
       if (!isMatchedCodecFramesPerSDU(
-              cfg->second.get<
+              cfg->get<
                   CodecSpecificConfigurationLtv::Tag::codecFrameBlocksPerSDU>(),
               codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
                                        supportedMaxCodecFramesPerSDU>()))
@@ -276,7 +282,7 @@ bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedCodecConfiguration(
     } else if (codec_capability.getTag() == CodecSpecificCapabilitiesLtv::Tag::
                                                 supportedOctetsPerCodecFrame) {
       if (!isMatchedOctetsPerCodecFrame(
-              cfg->second.get<
+              cfg->get<
                   CodecSpecificConfigurationLtv::Tag::octetsPerCodecFrame>(),
               codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
                                        supportedOctetsPerCodecFrame>()))
@@ -287,9 +293,37 @@ bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedCodecConfiguration(
   return true;
 }
 
+/* Check the sampling frequency and frame duration which index a group of ASE
+ * configurations against the capabilities, before matching each of them */
+bool LeAudioOffloadAudioProvider::isCapabilitiesMatchedKey(
+    const LeAudioAseConfigurationIndex::Key& key,
+    const std::vector<CodecSpecificCapabilitiesLtv>& codec_capabilities) {
+  auto& [freq, fduration] = key;
+  for (auto& codec_capability : codec_capabilities) {
+    if (codec_capability.getTag() ==
+        CodecSpecificCapabilitiesLtv::Tag::supportedSamplingFrequencies) {
+      if (!freq.has_value() ||
+          !isMatchedSamplingFreq(
+              freq.value(),
+              codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
+                                       supportedSamplingFrequencies>()))
+        return false;
+    } else if (codec_capability.getTag() ==
+               CodecSpecificCapabilitiesLtv::Tag::supportedFrameDurations) {
+      if (!fduration.has_value() ||
+          !isMatchedFrameDuration(
+              fduration.value(),
+              codec_capability.get<CodecSpecificCapabilitiesLtv::Tag::
+                                       supportedFrameDurations>()))
+        return false;
+    }
+  }
+  return true;
+}
+
 bool LeAudioOffloadAudioProvider::isMatchedAseConfiguration(
-    LeAudioAseConfiguration setting_cfg,
-    LeAudioAseConfiguration requirement_cfg) {
+    const LeAudioAseConfiguration& setting_cfg,
+    const LeAudioAseConfiguration& requirement_cfg) {
   // Check matching for codec configuration <=> requirement ASE codec
   // Also match if no CodecId requirement
   if (requirement_cfg.codecId.has_value()) {
@@ -303,17 +337,13 @@ bool LeAudioOffloadAudioProvider::isMatchedAseConfiguration(
   // Ignore PHY requirement
 
   // Check all codec configuration
-  std::map<CodecSpecificConfigurationLtv::Tag, CodecSpecificConfigurationLtv>
-      cfg_tag_map;
-  for (auto cfg : setting_cfg.codecConfiguration)
-    cfg_tag_map[cfg.getTag()] = cfg;
-
-  for (auto requirement_cfg : requirement_cfg.codecConfiguration) {
+  for (auto& requirement_codec_cfg : requirement_cfg.codecConfiguration) {
     // Directly compare CodecSpecificConfigurationLtv
-    auto cfg = cfg_tag_map.find(requirement_cfg.getTag());
-    if (cfg == cfg_tag_map.end()) return false;
+    auto cfg = findCodecConfiguration(setting_cfg.codecConfiguration,
+                                      requirement_codec_cfg.getTag());
+    if (cfg == nullptr) return false;
 
-    if (cfg->second != requirement_cfg) return false;
+    if (*cfg != requirement_codec_cfg) return false;
   }
   // Ignore vendor configuration and metadata requirement
 
@@ -321,7 +351,7 @@ bool LeAudioOffloadAudioProvider::isMatchedAseConfiguration(
 }
 
 bool LeAudioOffloadAudioProvider::isMatchedBISConfiguration(
-    LeAudioBisConfiguration bis_cfg,
+    const LeAudioBisConfiguration& bis_cfg,
     const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities) {
   if (!isMatchedValidCodec(bis_cfg.codecId, capabilities.codecId)) return false;
   if (!isCapabilitiesMatchedCodecConfiguration(
@@ -330,142 +360,74 @@ bool LeAudioOffloadAudioProvider::isMatchedBISConfiguration(
   return true;
 }
 
-void LeAudioOffloadAudioProvider::filterCapabilitiesAseDirectionConfiguration(
-    std::vector<std::optional<AseDirectionConfiguration>>&
-        direction_configurations,
-    const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities,
-    std::vector<std::optional<AseDirectionConfiguration>>&
-        valid_direction_configurations) {
-  for (auto direction_configuration : direction_configurations) {
-    if (!direction_configuration.has_value()) continue;
-    if (!direction_configuration.value().aseConfiguration.codecId.has_value())
-      continue;
-    if (!isMatchedValidCodec(
-            direction_configuration.value().aseConfiguration.codecId.value(),
-            capabilities.codecId))
-      continue;
-    // Check matching for codec configuration <=> codec capabilities
-    if (!isCapabilitiesMatchedCodecConfiguration(
-            direction_configuration.value().aseConfiguration.codecConfiguration,
-            capabilities.codecSpecificCapabilities))
-      continue;
-    valid_direction_configurations.push_back(direction_configuration);
+bool LeAudioOffloadAudioProvider::isRequirementMatchedAseConfiguration(
+    const AseDirectionConfiguration& direction_configuration,
+    const std::optional<std::vector<std::optional<AseDirectionRequirement>>>&
+        requirements) {
+  // If there's no requirement, all are valid
+  if (!requirements.has_value()) return true;
+
+  for (auto& requirement : requirements.value()) {
+    if (!requirement.has_value()) continue;
+    // Valid if match any requirement.
+    if (isMatchedAseConfiguration(direction_configuration.aseConfiguration,
+                                  requirement.value().aseConfiguration))
+      return true;
   }
+  return false;
 }
 
-void LeAudioOffloadAudioProvider::filterRequirementAseDirectionConfiguration(
-    std::vector<std::optional<AseDirectionConfiguration>>&
-        direction_configurations,
-    const std::optional<std::vector<std::optional<AseDirectionRequirement>>>&
-        requirements,
-    std::vector<std::optional<AseDirectionConfiguration>>&
-        valid_direction_configurations) {
-  for (auto direction_configuration : direction_configurations) {
-    if (!requirements.has_value()) {
-      // If there's no requirement, all are valid
-      valid_direction_configurations.push_back(direction_configuration);
+/* Find the ASE configurations of the input direction which match any of the
+ * capabilities, in the order of settings, then capabilities */
+std::vector<LeAudioOffloadAudioProvider::CapabilitiesMatchedAseConfiguration>
+LeAudioOffloadAudioProvider::getCapabilitiesMatchedAseConfigurations(
+    const LeAudioAseConfigurationIndex& index,
+    const std::vector<
+        std::optional<IBluetoothAudioProvider::LeAudioDeviceCapabilities>>&
+        capabilities_list,
+    uint8_t direction) {
+  auto& settings = index.GetSettings();
+  std::vector<CapabilitiesMatchedAseConfiguration> matched_configurations;
+  for (size_t i = 0; i < capabilities_list.size(); i++) {
+    if (!capabilities_list[i].has_value()) continue;
+    auto& capabilities = capabilities_list[i].value();
+    // Skip the codecs disabled by their priority
+    auto priority = codec_priority_map_.find(capabilities.codecId);
+    if (priority != codec_priority_map_.end() && priority->second == -1)
       continue;
-    }
-    if (!direction_configuration.has_value()) continue;
-
-    for (auto& requirement : requirements.value()) {
-      if (!requirement.has_value()) continue;
-      if (!isMatchedAseConfiguration(
-              direction_configuration.value().aseConfiguration,
-              requirement.value().aseConfiguration))
+    auto codec_entries = direction == kLeAudioDirectionSink
+                             ? index.GetSinkEntries(capabilities.codecId)
+                             : index.GetSourceEntries(capabilities.codecId);
+    if (codec_entries == nullptr) continue;
+
+    for (auto& [key, entries] : *codec_entries) {
+      if (!isCapabilitiesMatchedKey(key,
+                                    capabilities.codecSpecificCapabilities))
         continue;
-      // Valid if match any requirement.
-      valid_direction_configurations.push_back(direction_configuration);
-      break;
+      for (auto& entry : entries) {
+        // Try to match context in metadata.
+        if (!isCapabilitiesMatchedContext(
+                settings[entry.setting_index].audioContext, capabilities))
+          continue;
+        // Check matching for codec configuration <=> codec capabilities
+        if (!isCapabilitiesMatchedCodecConfiguration(
+                entry.configuration->aseConfiguration.codecConfiguration,
+                capabilities.codecSpecificCapabilities))
+          continue;
+        matched_configurations.push_back({&entry, i});
+      }
     }
   }
-}
 
-/* Get a new LeAudioAseConfigurationSetting by matching a setting with a
- * capabilities. The new setting will have a filtered list of
- * AseDirectionConfiguration that matched the capabilities */
-std::optional<LeAudioAseConfigurationSetting>
-LeAudioOffloadAudioProvider::getCapabilitiesMatchedAseConfigurationSettings(
-    IBluetoothAudioProvider::LeAudioAseConfigurationSetting& setting,
-    const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities,
-    uint8_t direction) {
-  // Try to match context in metadata.
-  if (!isCapabilitiesMatchedContext(setting.audioContext, capabilities))
-    return std::nullopt;
-
-  // Get a list of all matched AseDirectionConfiguration
-  // for the input direction
-  std::vector<std::optional<AseDirectionConfiguration>>*
-      direction_configuration = nullptr;
-  if (direction == kLeAudioDirectionSink) {
-    if (!setting.sinkAseConfiguration.has_value()) return std::nullopt;
-    direction_configuration = &setting.sinkAseConfiguration.value();
-  } else {
-    if (!setting.sourceAseConfiguration.has_value()) return std::nullopt;
-    direction_configuration = &setting.sourceAseConfiguration.value();
-  }
-  std::vector<std::optional<AseDirectionConfiguration>>
-      valid_direction_configuration;
-  filterCapabilitiesAseDirectionConfiguration(
-      *direction_configuration, capabilities, valid_direction_configuration);
-  if (valid_direction_configuration.empty()) return std::nullopt;
-
-  // Create a new LeAudioAseConfigurationSetting and return
-  LeAudioAseConfigurationSetting filtered_setting;
-  filtered_setting.audioContext = setting.audioContext;
-  filtered_setting.packing = setting.packing;
-  if (direction == kLeAudioDirectionSink) {
-    filtered_setting.sinkAseConfiguration = valid_direction_configuration;
-  } else {
-    filtered_setting.sourceAseConfiguration = valid_direction_configuration;
-  }
-  filtered_setting.flags = setting.flags;
-
-  return filtered_setting;
-}
-
-/* Get a new LeAudioAseConfigurationSetting by matching a setting with a
- * requirement. The new setting will have a filtered list of
- * AseDirectionConfiguration that matched the requirement */
-std::optional<LeAudioAseConfigurationSetting>
-LeAudioOffloadAudioProvider::getRequirementMatchedAseConfigurationSettings(
-    IBluetoothAudioProvider::LeAudioAseConfigurationSetting& setting,
-    const IBluetoothAudioProvider::LeAudioConfigurationRequirement&
-        requirement) {
-  // Try to match context in metadata.
-  if (setting.audioContext != requirement.audioContext) return std::nullopt;
-
-  // Check requirement for the correct direction
-  const std::optional<std::vector<std::optional<AseDirectionRequirement>>>*
-      direction_requirement;
-  std::vector<std::optional<AseDirectionConfiguration>>*
-      direction_configuration;
-  if (setting.sinkAseConfiguration.has_value()) {
-    direction_configuration = &setting.sinkAseConfiguration.value();
-    direction_requirement = &requirement.sinkAseRequirement;
-  } else {
-    direction_configuration = &setting.sourceAseConfiguration.value();
-    direction_requirement = &requirement.sourceAseRequirement;
-  }
-
-  std::vector<std::optional<AseDirectionConfiguration>>
-      valid_direction_configuration;
-  filterRequirementAseDirectionConfiguration(*direction_configuration,
-                                             *direction_requirement,
-                                             valid_direction_configuration);
-  if (valid_direction_configuration.empty()) return std::nullopt;
-
-  // Create a new LeAudioAseConfigurationSetting and return
-  LeAudioAseConfigurationSetting filtered_setting;
-  filtered_setting.audioContext = setting.audioContext;
-  filtered_setting.packing = setting.packing;
-  if (setting.sinkAseConfiguration.has_value())
-    filtered_setting.sinkAseConfiguration = valid_direction_configuration;
-  else
-    filtered_setting.sourceAseConfiguration = valid_direction_configuration;
-  filtered_setting.flags = setting.flags;
-
-  return filtered_setting;
+  std::sort(matched_configurations.begin(), matched_configurations.end(),
+            [](const CapabilitiesMatchedAseConfiguration& a,
+               const CapabilitiesMatchedAseConfiguration& b) {
+              return std::tie(a.entry->setting_index, a.capabilities_index,
+                              a.entry->configuration_index) <
+                     std::tie(b.entry->setting_index, b.capabilities_index,
+                              b.entry->configuration_index);
+            });
+  return matched_configurations;
 }
 
 ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseConfiguration(
@@ -479,10 +441,11 @@ ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseConfiguration(
         in_requirements,
     std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>*
         _aidl_return) {
+  _aidl_return->clear();
   // Get all configuration settings
-  std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
-      ase_configuration_settings =
-          BluetoothAudioCodecs::GetLeAudioAseConfigurationSettings();
+  std::shared_ptr<const LeAudioAseConfigurationIndex> index =
+      BluetoothAudioCodecs::GetLeAudioAseConfigurationIndex();
+  auto& settings = index->GetSettings();
 
   // Currently won't handle case where both sink and source capabilities
   // are passed in. Only handle one of them.
@@ -497,42 +460,64 @@ ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseConfiguration(
     direction = kLeAudioDirectionSource;
     in_remoteAudioCapabilities = &in_remoteSourceAudioCapabilities;
   }
+  if (!in_remoteAudioCapabilities->has_value())
+    return ndk::ScopedAStatus::ok();
 
-  std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
-      capability_matched_ase_configuration_settings;
   // Matching with remote capabilities
-  for (auto& setting : ase_configuration_settings) {
-    for (auto& capability : in_remoteAudioCapabilities->value()) {
-      if (!capability.has_value()) continue;
-      auto filtered_ase_configuration_setting =
-          getCapabilitiesMatchedAseConfigurationSettings(
-              setting, capability.value(), direction);
-      if (filtered_ase_configuration_setting.has_value()) {
-        capability_matched_ase_configuration_settings.push_back(
-            filtered_ase_configuration_setting.value());
-      }
-    }
-  }
+  auto matched_configurations = getCapabilitiesMatchedAseConfigurations(
+      *index, in_remoteAudioCapabilities->value(), direction);
+
+  // Matching with requirements, for each group of ASE configurations of a
+  // setting matched by the same capabilities
+  std::vector<std::optional<AseDirectionConfiguration>>
+      valid_direction_configuration;
+  for (auto group_begin = matched_configurations.begin();
+       group_begin != matched_configurations.end();) {
+    auto group_end = std::find_if(
+        group_begin, matched_configurations.end(),
+        [&group_begin](const CapabilitiesMatchedAseConfiguration& matched) {
+          return matched.entry->setting_index !=
+                     group_begin->entry->setting_index ||
+                 matched.capabilities_index != group_begin->capabilities_index;
+        });
+    auto& setting = settings[group_begin->entry->setting_index];
 
-  // Matching with requirements
-  std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting> result;
-  for (auto& setting : capability_matched_ase_configuration_settings) {
     for (auto& requirement : in_requirements) {
-      auto filtered_ase_configuration_setting =
-          getRequirementMatchedAseConfigurationSettings(setting, requirement);
-      if (filtered_ase_configuration_setting.has_value()) {
-        result.push_back(filtered_ase_configuration_setting.value());
+      // Try to match context in metadata.
+      if (setting.audioContext != requirement.audioContext) continue;
+      // Check requirement for the correct direction
+      auto& direction_requirement = direction == kLeAudioDirectionSink
+                                        ? requirement.sinkAseRequirement
+                                        : requirement.sourceAseRequirement;
+      valid_direction_configuration.clear();
+      for (auto matched = group_begin; matched != group_end; ++matched) {
+        if (isRequirementMatchedAseConfiguration(
+                *matched->entry->configuration, direction_requirement))
+          valid_direction_configuration.push_back(
+              *matched->entry->configuration);
       }
+      if (valid_direction_configuration.empty()) continue;
+
+      // Create a new LeAudioAseConfigurationSetting and return
+      LeAudioAseConfigurationSetting filtered_setting;
+      filtered_setting.audioContext = setting.audioContext;
+      filtered_setting.packing = setting.packing;
+      if (direction == kLeAudioDirectionSink)
+        filtered_setting.sinkAseConfiguration = valid_direction_configuration;
+      else
+        filtered_setting.sourceAseConfiguration = valid_direction_configuration;
+      filtered_setting.flags = setting.flags;
+      _aidl_return->push_back(std::move(filtered_setting));
     }
+    group_begin = group_end;
   }
 
-  *_aidl_return = result;
   return ndk::ScopedAStatus::ok();
 };
 
 bool LeAudioOffloadAudioProvider::isMatchedQosRequirement(
-    LeAudioAseQosConfiguration setting_qos,
-    AseQosDirectionRequirement requirement_qos) {
+    const LeAudioAseQosConfiguration& setting_qos,
+    const AseQosDirectionRequirement& requirement_qos) {
   if (setting_qos.retransmissionNum !=
       requirement_qos.preferredRetransmissionNum)
     return false;
@@ -548,9 +533,9 @@ ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseQosConfiguration(
     IBluetoothAudioProvider::LeAudioAseQosConfigurationPair* _aidl_return) {
   IBluetoothAudioProvider::LeAudioAseQosConfigurationPair result;
   // Get all configuration settings
-  std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
-      ase_configuration_settings =
-          BluetoothAudioCodecs::GetLeAudioAseConfigurationSettings();
+  std::shared_ptr<const LeAudioAseConfigurationIndex> index =
+      BluetoothAudioCodecs::GetLeAudioAseConfigurationIndex();
+  auto& settings = index->GetSettings();
 
   // Direction QoS matching
   // Only handle one direction input case
@@ -566,16 +551,17 @@ ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseQosConfiguration(
     direction = kLeAudioDirectionSource;
   }
 
-  for (auto& setting : ase_configuration_settings) {
-    // Context matching
-    if (setting.audioContext != in_qosRequirement.contextType) continue;
+  // Context matching
+  for (auto setting_index :
+       index->GetSettingIndices(in_qosRequirement.contextType)) {
+    auto& setting = settings[setting_index];
 
     // Match configuration flags
     // Currently configuration flags are not populated, ignore.
 
     // Get a list of all matched AseDirectionConfiguration
     // for the input direction
-    std::vector<std::optional<AseDirectionConfiguration>>*
+    const std::vector<std::optional<AseDirectionConfiguration>>*
         direction_configuration = nullptr;
     if (direction == kLeAudioDirectionSink) {
       if (!setting.sinkAseConfiguration.has_value()) continue;
@@ -585,7 +571,7 @@ ndk::ScopedAStatus LeAudioOffloadAudioProvider::getLeAudioAseQosConfiguration(
       direction_configuration = &setting.sourceAseConfiguration.value();
     }
 
-    for (auto cfg : *direction_configuration) {
+    for (auto& cfg : *direction_configuration) {
       if (!cfg.has_value()) continue;
       // If no requirement, return the first QoS
       if (!direction_qos_requirement.has_value()) {
@@ -690,7 +676,7 @@ void LeAudioOffloadAudioProvider::getBroadcastSettings() {
 std::optional<LeAudioBroadcastConfigurationSetting>
 LeAudioOffloadAudioProvider::
     getCapabilitiesMatchedBroadcastConfigurationSettings(
-        LeAudioBroadcastConfigurationSetting& setting,
+        const LeAudioBroadcastConfigurationSetting& setting,
         const IBluetoothAudioProvider::LeAudioDeviceCapabilities&
             capabilities) {
   std::vector<IBluetoothAudioProvider::LeAudioBroadcastSubgroupConfiguration>
@@ -727,7 +713,7 @@ LeAudioOffloadAudioProvider::getLeAudioBroadcastConfiguration(
         in_requirement,
     LeAudioBroadcastConfigurationSetting* _aidl_return) {
   getBroadcastSettings();
-  _aidl_return = nullptr;
+  *_aidl_return = LeAudioBroadcastConfigurationSetting();
 
   // Match and filter capability
   std::vector<LeAudioBroadcastConfigurationSetting> filtered_settings;
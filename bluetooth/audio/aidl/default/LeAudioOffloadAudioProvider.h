@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <BluetoothLeAudioAseConfigurationIndex.h>
+
 #include <map>
 
 #include "BluetoothAudioProvider.h"
@@ -100,61 +102,62 @@ class LeAudioOffloadAudioProvider : public BluetoothAudioProvider {
       AudioContext setting_context,
       const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities);
   bool isMatchedSamplingFreq(
-      CodecSpecificConfigurationLtv::SamplingFrequency& cfg_freq,
-      CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies&
+      const CodecSpecificConfigurationLtv::SamplingFrequency& cfg_freq,
+      const CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies&
           capability_freq);
   bool isMatchedFrameDuration(
-      CodecSpecificConfigurationLtv::FrameDuration& cfg_fduration,
-      CodecSpecificCapabilitiesLtv::SupportedFrameDurations&
+      const CodecSpecificConfigurationLtv::FrameDuration& cfg_fduration,
+      const CodecSpecificCapabilitiesLtv::SupportedFrameDurations&
           capability_fduration);
   bool isMatchedAudioChannel(
-      CodecSpecificConfigurationLtv::AudioChannelAllocation& cfg_channel,
-      CodecSpecificCapabilitiesLtv::SupportedAudioChannelCounts&
+      const CodecSpecificConfigurationLtv::AudioChannelAllocation& cfg_channel,
+      const CodecSpecificCapabilitiesLtv::SupportedAudioChannelCounts&
           capability_channel);
   bool isMatchedCodecFramesPerSDU(
-      CodecSpecificConfigurationLtv::CodecFrameBlocksPerSDU& cfg_frame_sdu,
-      CodecSpecificCapabilitiesLtv::SupportedMaxCodecFramesPerSDU&
+      const CodecSpecificConfigurationLtv::CodecFrameBlocksPerSDU&
+          cfg_frame_sdu,
+      const CodecSpecificCapabilitiesLtv::SupportedMaxCodecFramesPerSDU&
           capability_frame_sdu);
   bool isMatchedOctetsPerCodecFrame(
-      CodecSpecificConfigurationLtv::OctetsPerCodecFrame& cfg_octets,
-      CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame&
+      const CodecSpecificConfigurationLtv::OctetsPerCodecFrame& cfg_octets,
+      const CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame&
           capability_octets);
   bool isCapabilitiesMatchedCodecConfiguration(
-      std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
-      std::vector<CodecSpecificCapabilitiesLtv> codec_capabilities);
-  bool isMatchedAseConfiguration(LeAudioAseConfiguration setting_cfg,
-                                 LeAudioAseConfiguration requirement_cfg);
+      const std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
+      const std::vector<CodecSpecificCapabilitiesLtv>& codec_capabilities);
+  bool isCapabilitiesMatchedKey(
+      const LeAudioAseConfigurationIndex::Key& key,
+      const std::vector<CodecSpecificCapabilitiesLtv>& codec_capabilities);
+  bool isMatchedAseConfiguration(
+      const LeAudioAseConfiguration& setting_cfg,
+      const LeAudioAseConfiguration& requirement_cfg);
   bool isMatchedBISConfiguration(
-      LeAudioBisConfiguration bis_cfg,
+      const LeAudioBisConfiguration& bis_cfg,
       const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities);
-  void filterCapabilitiesAseDirectionConfiguration(
-      std::vector<std::optional<AseDirectionConfiguration>>&
-          direction_configurations,
-      const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities,
-      std::vector<std::optional<AseDirectionConfiguration>>&
-          valid_direction_configurations);
-  void filterRequirementAseDirectionConfiguration(
-      std::vector<std::optional<AseDirectionConfiguration>>&
-          direction_configurations,
+  bool isRequirementMatchedAseConfiguration(
+      const AseDirectionConfiguration& direction_configuration,
       const std::optional<std::vector<std::optional<AseDirectionRequirement>>>&
-          requirements,
-      std::vector<std::optional<AseDirectionConfiguration>>&
-          valid_direction_configurations);
-  std::optional<LeAudioAseConfigurationSetting>
-  getCapabilitiesMatchedAseConfigurationSettings(
-      IBluetoothAudioProvider::LeAudioAseConfigurationSetting& setting,
-      const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities,
+          requirements);
+
+  // An indexed ASE configuration which matched the capabilities at
+  // |capabilities_index| of the remote capabilities list
+  struct CapabilitiesMatchedAseConfiguration {
+    const LeAudioAseConfigurationIndex::Entry* entry;
+    size_t capabilities_index;
+  };
+  std::vector<CapabilitiesMatchedAseConfiguration>
+  getCapabilitiesMatchedAseConfigurations(
+      const LeAudioAseConfigurationIndex& index,
+      const std::vector<
+          std::optional<IBluetoothAudioProvider::LeAudioDeviceCapabilities>>&
+          capabilities_list,
       uint8_t direction);
-  std::optional<LeAudioAseConfigurationSetting>
-  getRequirementMatchedAseConfigurationSettings(
-      IBluetoothAudioProvider::LeAudioAseConfigurationSetting& setting,
-      const IBluetoothAudioProvider::LeAudioConfigurationRequirement&
-          requirement);
-  bool isMatchedQosRequirement(LeAudioAseQosConfiguration setting_qos,
-                               AseQosDirectionRequirement requirement_qos);
+  bool isMatchedQosRequirement(
+      const LeAudioAseQosConfiguration& setting_qos,
+      const AseQosDirectionRequirement& requirement_qos);
   std::optional<LeAudioBroadcastConfigurationSetting>
   getCapabilitiesMatchedBroadcastConfigurationSettings(
-      LeAudioBroadcastConfigurationSetting& setting,
+      const LeAudioBroadcastConfigurationSetting& setting,
       const IBluetoothAudioProvider::LeAudioDeviceCapabilities& capabilities);
   void getBroadcastSettings();
 };
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <optional>
+#include <vector>
+
+#include "LeAudioOffloadAudioProvider.h"
+
+using ::aidl::android::hardware::bluetooth::audio::AudioContext;
+using ::aidl::android::hardware::bluetooth::audio::CodecId;
+using ::aidl::android::hardware::bluetooth::audio::CodecSpecificCapabilitiesLtv;
+using ::aidl::android::hardware::bluetooth::audio::IBluetoothAudioProvider;
+using ::aidl::android::hardware::bluetooth::audio::LeAudioAseConfiguration;
+using ::aidl::android::hardware::bluetooth::audio::
+    LeAudioOffloadOutputAudioProvider;
+using ::benchmark::State;
+
+using LeAudioDeviceCapabilities =
+    IBluetoothAudioProvider::LeAudioDeviceCapabilities;
+using LeAudioConfigurationRequirement =
+    IBluetoothAudioProvider::LeAudioConfigurationRequirement;
+using AseDirectionRequirement =
+    LeAudioConfigurationRequirement::AseDirectionRequirement;
+using SamplingFrequencies =
+    CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies;
+
+namespace {
+
+// LC3 capabilities of a typical earbud, for each supported frame duration.
+std::vector<std::optional<LeAudioDeviceCapabilities>> getCapabilities() {
+  std::vector<std::optional<LeAudioDeviceCapabilities>> capabilities;
+  for (int32_t frame_durations :
+       {CodecSpecificCapabilitiesLtv::SupportedFrameDurations::US7500,
+        CodecSpecificCapabilitiesLtv::SupportedFrameDurations::US10000}) {
+    LeAudioDeviceCapabilities capability;
+    capability.codecId = CodecId::Core::LC3;
+    capability.codecSpecificCapabilities = {
+        CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies{
+            SamplingFrequencies::HZ16000 | SamplingFrequencies::HZ24000 |
+            SamplingFrequencies::HZ32000 | SamplingFrequencies::HZ48000},
+        CodecSpecificCapabilitiesLtv::SupportedFrameDurations{frame_durations},
+        CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame{26, 155},
+    };
+    capabilities.push_back(capability);
+  }
+  return capabilities;
+}
+
+std::vector<LeAudioConfigurationRequirement> getRequirements() {
+  std::vector<LeAudioConfigurationRequirement> requirements;
+  for (int32_t context : {AudioContext::MEDIA, AudioContext::CONVERSATIONAL,
+                          AudioContext::GAME}) {
+    LeAudioConfigurationRequirement requirement;
+    requirement.audioContext.bitmask = context;
+    AseDirectionRequirement direction_requirement;
+    direction_requirement.aseConfiguration.codecId = CodecId::Core::LC3;
+    direction_requirement.aseConfiguration.targetLatency =
+        context == AudioContext::MEDIA
+            ? LeAudioAseConfiguration::TargetLatency::HIGHER_RELIABILITY
+            : LeAudioAseConfiguration::TargetLatency::LOWER;
+    requirement.sinkAseRequirement = {direction_requirement};
+    requirements.push_back(requirement);
+  }
+  return requirements;
+}
+
+void BM_GetLeAudioAseConfiguration(State& state) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadOutputAudioProvider>();
+  std::optional<std::vector<std::optional<LeAudioDeviceCapabilities>>>
+      sink_capabilities = getCapabilities();
+  auto requirements = getRequirements();
+  std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting> result;
+  for (auto _ : state) {
+    provider->getLeAudioAseConfiguration(sink_capabilities, std::nullopt,
+                                        requirements, &result);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.counters["settings"] = result.size();
+}
+BENCHMARK(BM_GetLeAudioAseConfiguration);
+
+void BM_GetLeAudioAseQosConfiguration(State& state) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadOutputAudioProvider>();
+  IBluetoothAudioProvider::LeAudioAseQosConfigurationRequirement requirement;
+  requirement.contextType.bitmask = AudioContext::CONVERSATIONAL;
+  IBluetoothAudioProvider::LeAudioAseQosConfigurationRequirement::
+      AseQosDirectionRequirement direction_requirement;
+  direction_requirement.aseConfiguration.codecId = CodecId::Core::LC3;
+  direction_requirement.aseConfiguration.targetLatency =
+      LeAudioAseConfiguration::TargetLatency::LOWER;
+  direction_requirement.preferredRetransmissionNum = 2;
+  direction_requirement.maxTransportLatencyMs = 100;
+  requirement.sinkAseQosRequirement = direction_requirement;
+  IBluetoothAudioProvider::LeAudioAseQosConfigurationPair result;
+  for (auto _ : state) {
+    provider->getLeAudioAseQosConfiguration(requirement, &result);
+    benchmark::DoNotOptimize(&result);
+  }
+}
+BENCHMARK(BM_GetLeAudioAseQosConfiguration);
+
+void BM_GetLeAudioBroadcastConfiguration(State& state) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadOutputAudioProvider>();
+  std::optional<std::vector<std::optional<LeAudioDeviceCapabilities>>>
+      sink_capabilities = getCapabilities();
+  IBluetoothAudioProvider::LeAudioBroadcastConfigurationRequirement
+      requirement;
+  IBluetoothAudioProvider::LeAudioBroadcastSubgroupConfigurationRequirement
+      subgroup_requirement;
+  subgroup_requirement.context.bitmask = AudioContext::MEDIA;
+  subgroup_requirement.bisNumPerSubgroup = 1;
+  requirement.subgroupConfigurationRequirements = {subgroup_requirement};
+  IBluetoothAudioProvider::LeAudioBroadcastConfigurationSetting result;
+  for (auto _ : state) {
+    provider->getLeAudioBroadcastConfiguration(sink_capabilities, requirement,
+                                              &result);
+    benchmark::DoNotOptimize(&result);
+  }
+}
+BENCHMARK(BM_GetLeAudioBroadcastConfiguration);
+
+}  // namespace
+
+BENCHMARK_MAIN();
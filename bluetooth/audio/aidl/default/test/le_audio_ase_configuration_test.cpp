@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include "BluetoothAudioCodecs.h"
+#include "LeAudioOffloadAudioProvider.h"
+
+using ::aidl::android::hardware::bluetooth::audio::AudioContext;
+using ::aidl::android::hardware::bluetooth::audio::BluetoothAudioCodecs;
+using ::aidl::android::hardware::bluetooth::audio::CodecId;
+using ::aidl::android::hardware::bluetooth::audio::CodecSpecificCapabilitiesLtv;
+using ::aidl::android::hardware::bluetooth::audio::
+    CodecSpecificConfigurationLtv;
+using ::aidl::android::hardware::bluetooth::audio::IBluetoothAudioProvider;
+using ::aidl::android::hardware::bluetooth::audio::LeAudioAseConfiguration;
+using ::aidl::android::hardware::bluetooth::audio::LeAudioOffloadAudioProvider;
+using ::aidl::android::hardware::bluetooth::audio::
+    LeAudioOffloadInputAudioProvider;
+using ::aidl::android::hardware::bluetooth::audio::
+    LeAudioOffloadOutputAudioProvider;
+using ::aidl::android::hardware::bluetooth::audio::MetadataLtv;
+
+using LeAudioDeviceCapabilities =
+    IBluetoothAudioProvider::LeAudioDeviceCapabilities;
+using LeAudioConfigurationRequirement =
+    IBluetoothAudioProvider::LeAudioConfigurationRequirement;
+using LeAudioAseConfigurationSetting =
+    IBluetoothAudioProvider::LeAudioAseConfigurationSetting;
+using AseDirectionConfiguration =
+    LeAudioAseConfigurationSetting::AseDirectionConfiguration;
+using AseDirectionRequirement =
+    LeAudioConfigurationRequirement::AseDirectionRequirement;
+using SamplingFrequencies =
+    CodecSpecificCapabilitiesLtv::SupportedSamplingFrequencies;
+using FrameDurations = CodecSpecificCapabilitiesLtv::SupportedFrameDurations;
+using CapabilitiesList = std::vector<std::optional<LeAudioDeviceCapabilities>>;
+
+namespace {
+
+constexpr uint8_t kLeAudioDirectionSink = 0x01;
+constexpr uint8_t kLeAudioDirectionSource = 0x02;
+
+/* The exhaustive matching the provider did before indexing the settings: every
+ * direction configuration of every setting against every capability, then
+ * every filtered setting against every requirement */
+class ExhaustiveMatcher {
+ public:
+  explicit ExhaustiveMatcher(std::map<CodecId, int32_t> codec_priorities = {})
+      : codec_priorities_(std::move(codec_priorities)) {}
+
+  std::vector<LeAudioAseConfigurationSetting> match(
+      const std::vector<LeAudioAseConfigurationSetting>& settings,
+      const CapabilitiesList& capabilities_list,
+      const std::vector<LeAudioConfigurationRequirement>& requirements,
+      uint8_t direction) const {
+    std::vector<LeAudioAseConfigurationSetting> capability_matched;
+    for (auto& setting : settings) {
+      for (auto& capabilities : capabilities_list) {
+        if (!capabilities.has_value()) continue;
+        auto filtered = filterByCapabilities(setting, capabilities.value(),
+                                             direction);
+        if (filtered.has_value()) capability_matched.push_back(*filtered);
+      }
+    }
+
+    std::vector<LeAudioAseConfigurationSetting> result;
+    for (auto& setting : capability_matched) {
+      for (auto& requirement : requirements) {
+        auto filtered = filterByRequirement(setting, requirement);
+        if (filtered.has_value()) result.push_back(*filtered);
+      }
+    }
+    return result;
+  }
+
+ private:
+  bool isMatchedValidCodec(const CodecId& cfg_codec,
+                           const CodecId& req_codec) const {
+    auto priority = codec_priorities_.find(cfg_codec);
+    if (priority != codec_priorities_.end() && priority->second == -1)
+      return false;
+    return cfg_codec == req_codec;
+  }
+
+  static bool isCapabilitiesMatchedContext(
+      const AudioContext& setting_context,
+      const LeAudioDeviceCapabilities& capabilities) {
+    if (!capabilities.metadata.has_value()) return true;
+    for (auto& metadata : capabilities.metadata.value()) {
+      if (!metadata.has_value()) continue;
+      if (metadata->getTag() != MetadataLtv::Tag::preferredAudioContexts)
+        continue;
+      auto& context =
+          metadata->get<MetadataLtv::Tag::preferredAudioContexts>().values;
+      if (setting_context.bitmask & context.bitmask) return true;
+    }
+    return false;
+  }
+
+  static bool isCapabilitiesMatchedCodecConfiguration(
+      const std::vector<CodecSpecificConfigurationLtv>& codec_cfg,
+      const std::vector<CodecSpecificCapabilitiesLtv>& codec_capabilities) {
+    static const std::map<CodecSpecificCapabilitiesLtv::Tag,
+                          CodecSpecificConfigurationLtv::Tag>
+        cap_to_cfg_tag = {
+            {CodecSpecificCapabilitiesLtv::Tag::supportedSamplingFrequencies,
+             CodecSpecificConfigurationLtv::Tag::samplingFrequency},
+            {CodecSpecificCapabilitiesLtv::Tag::supportedMaxCodecFramesPerSDU,
+             CodecSpecificConfigurationLtv::Tag::codecFrameBlocksPerSDU},
+            {CodecSpecificCapabilitiesLtv::Tag::supportedFrameDurations,
+             CodecSpecificConfigurationLtv::Tag::frameDuration},
+            {CodecSpecificCapabilitiesLtv::Tag::supportedAudioChannelCounts,
+             CodecSpecificConfigurationLtv::Tag::audioChannelAllocation},
+            {CodecSpecificCapabilitiesLtv::Tag::supportedOctetsPerCodecFrame,
+             CodecSpecificConfigurationLtv::Tag::octetsPerCodecFrame},
+        };
+    // The last configuration with a tag wins
+    std::map<CodecSpecificConfigurationLtv::Tag, CodecSpecificConfigurationLtv>
+        cfg_tag_map;
+    for (auto& cfg : codec_cfg) cfg_tag_map[cfg.getTag()] = cfg;
+
+    for (auto& capability : codec_capabilities) {
+      auto cfg_tag = cap_to_cfg_tag.find(capability.getTag());
+      if (cfg_tag == cap_to_cfg_tag.end()) return false;
+      auto found = cfg_tag_map.find(cfg_tag->second);
+      if (found == cfg_tag_map.end()) return false;
+      auto& cfg = found->second;
+
+      switch (capability.getTag()) {
+        case CodecSpecificCapabilitiesLtv::Tag::supportedSamplingFrequencies:
+          if (!(capability.get<CodecSpecificCapabilitiesLtv::Tag::
+                                   supportedSamplingFrequencies>()
+                    .bitmask &
+                toSupportedBitmask(
+                    cfg.get<CodecSpecificConfigurationLtv::Tag::
+                                samplingFrequency>())))
+            return false;
+          break;
+        case CodecSpecificCapabilitiesLtv::Tag::supportedFrameDurations:
+          if (!(capability.get<CodecSpecificCapabilitiesLtv::Tag::
+                                   supportedFrameDurations>()
+                    .bitmask &
+                toSupportedBitmask(
+                    cfg.get<CodecSpecificConfigurationLtv::Tag::
+                                frameDuration>())))
+            return false;
+          break;
+        case CodecSpecificCapabilitiesLtv::Tag::supportedMaxCodecFramesPerSDU:
+          if (cfg.get<CodecSpecificConfigurationLtv::Tag::
+                          codecFrameBlocksPerSDU>()
+                  .value > capability
+                               .get<CodecSpecificCapabilitiesLtv::Tag::
+                                        supportedMaxCodecFramesPerSDU>()
+                               .value)
+            return false;
+          break;
+        case CodecSpecificCapabilitiesLtv::Tag::supportedOctetsPerCodecFrame: {
+          auto& octets = capability.get<CodecSpecificCapabilitiesLtv::Tag::
+                                            supportedOctetsPerCodecFrame>();
+          auto value =
+              cfg.get<CodecSpecificConfigurationLtv::Tag::octetsPerCodecFrame>()
+                  .value;
+          if (value < octets.minimum || value > octets.maximum) return false;
+          break;
+        }
+        default:
+          // Audio channel counts always match
+          break;
+      }
+    }
+    return true;
+  }
+
+  static uint32_t toSupportedBitmask(
+      CodecSpecificConfigurationLtv::SamplingFrequency freq) {
+    static const std::map<CodecSpecificConfigurationLtv::SamplingFrequency,
+                          uint32_t>
+        bitmasks = {
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ8000,
+             SamplingFrequencies::HZ8000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ11025,
+             SamplingFrequencies::HZ11025},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ16000,
+             SamplingFrequencies::HZ16000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ22050,
+             SamplingFrequencies::HZ22050},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ24000,
+             SamplingFrequencies::HZ24000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ32000,
+             SamplingFrequencies::HZ32000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ48000,
+             SamplingFrequencies::HZ48000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ88200,
+             SamplingFrequencies::HZ88200},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ96000,
+             SamplingFrequencies::HZ96000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ176400,
+             SamplingFrequencies::HZ176400},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ192000,
+             SamplingFrequencies::HZ192000},
+            {CodecSpecificConfigurationLtv::SamplingFrequency::HZ384000,
+             SamplingFrequencies::HZ384000},
+        };
+    auto bitmask = bitmasks.find(freq);
+    return bitmask == bitmasks.end() ? 0 : bitmask->second;
+  }
+
+  static uint32_t toSupportedBitmask(
+      CodecSpecificConfigurationLtv::FrameDuration fduration) {
+    switch (fduration) {
+      case CodecSpecificConfigurationLtv::FrameDuration::US7500:
+        return FrameDurations::US7500;
+      case CodecSpecificConfigurationLtv::FrameDuration::US10000:
+        return FrameDurations::US10000;
+      default:
+        return 0;
+    }
+  }
+
+  bool isMatchedAseConfiguration(
+      const LeAudioAseConfiguration& setting_cfg,
+      const LeAudioAseConfiguration& requirement_cfg) const {
+    if (requirement_cfg.codecId.has_value()) {
+      if (!setting_cfg.codecId.has_value()) return false;
+      if (!isMatchedValidCodec(setting_cfg.codecId.value(),
+                               requirement_cfg.codecId.value()))
+        return false;
+    }
+    if (setting_cfg.targetLatency != requirement_cfg.targetLatency)
+      return false;
+
+    std::map<CodecSpecificConfigurationLtv::Tag, CodecSpecificConfigurationLtv>
+        cfg_tag_map;
+    for (auto& cfg : setting_cfg.codecConfiguration)
+      cfg_tag_map[cfg.getTag()] = cfg;
+    for (auto& requirement_codec_cfg : requirement_cfg.codecConfiguration) {
+      auto cfg = cfg_tag_map.find(requirement_codec_cfg.getTag());
+      if (cfg == cfg_tag_map.end()) return false;
+      if (cfg->second != requirement_codec_cfg) return false;
+    }
+    return true;
+  }
+
+  std::optional<LeAudioAseConfigurationSetting> filterByCapabilities(
+      const LeAudioAseConfigurationSetting& setting,
+      const LeAudioDeviceCapabilities& capabilities, uint8_t direction) const {
+    if (!isCapabilitiesMatchedContext(setting.audioContext, capabilities))
+      return std::nullopt;
+    auto& direction_configurations = direction == kLeAudioDirectionSink
+                                         ? setting.sinkAseConfiguration
+                                         : setting.sourceAseConfiguration;
+    if (!direction_configurations.has_value()) return std::nullopt;
+
+    std::vector<std::optional<AseDirectionConfiguration>> valid;
+    for (auto& configuration : direction_configurations.value()) {
+      if (!configuration.has_value()) continue;
+      if (!configuration->aseConfiguration.codecId.has_value()) continue;
+      if (!isMatchedValidCodec(configuration->aseConfiguration.codecId.value(),
+                               capabilities.codecId))
+        continue;
+      if (!isCapabilitiesMatchedCodecConfiguration(
+              configuration->aseConfiguration.codecConfiguration,
+              capabilities.codecSpecificCapabilities))
+        continue;
+      valid.push_back(configuration);
+    }
+    if (valid.empty()) return std::nullopt;
+    return makeFilteredSetting(setting, direction, valid);
+  }
+
+  std::optional<LeAudioAseConfigurationSetting> filterByRequirement(
+      const LeAudioAseConfigurationSetting& setting,
+      const LeAudioConfigurationRequirement& requirement) const {
+    if (setting.audioContext != requirement.audioContext) return std::nullopt;
+    uint8_t direction = setting.sinkAseConfiguration.has_value()
+                            ? kLeAudioDirectionSink
+                            : kLeAudioDirectionSource;
+    auto& configurations = direction == kLeAudioDirectionSink
+                               ? setting.sinkAseConfiguration.value()
+                               : setting.sourceAseConfiguration.value();
+    auto& direction_requirements = direction == kLeAudioDirectionSink
+                                       ? requirement.sinkAseRequirement
+                                       : requirement.sourceAseRequirement;
+
+    std::vector<std::optional<AseDirectionConfiguration>> valid;
+    for (auto& configuration : configurations) {
+      if (!direction_requirements.has_value()) {
+        valid.push_back(configuration);
+        continue;
+      }
+      if (!configuration.has_value()) continue;
+      for (auto& direction_requirement : direction_requirements.value()) {
+        if (!direction_requirement.has_value()) continue;
+        if (!isMatchedAseConfiguration(
+                configuration->aseConfiguration,
+                direction_requirement->aseConfiguration))
+          continue;
+        valid.push_back(configuration);
+        break;
+      }
+    }
+    if (valid.empty()) return std::nullopt;
+    return makeFilteredSetting(setting, direction, valid);
+  }
+
+  static LeAudioAseConfigurationSetting makeFilteredSetting(
+      const LeAudioAseConfigurationSetting& setting, uint8_t direction,
+      const std::vector<std::optional<AseDirectionConfiguration>>& valid) {
+    LeAudioAseConfigurationSetting filtered_setting;
+    filtered_setting.audioContext = setting.audioContext;
+    filtered_setting.packing = setting.packing;
+    if (direction == kLeAudioDirectionSink)
+      filtered_setting.sinkAseConfiguration = valid;
+    else
+      filtered_setting.sourceAseConfiguration = valid;
+    filtered_setting.flags = setting.flags;
+    return filtered_setting;
+  }
+
+  std::map<CodecId, int32_t> codec_priorities_;
+};
+
+LeAudioDeviceCapabilities makeCapabilities(
+    int32_t frequencies, int32_t frame_durations, int32_t min_octets,
+    int32_t max_octets, std::optional<int32_t> preferred_contexts) {
+  LeAudioDeviceCapabilities capabilities;
+  capabilities.codecId = CodecId::Core::LC3;
+  capabilities.codecSpecificCapabilities = {
+      SamplingFrequencies{frequencies},
+      FrameDurations{frame_durations},
+      CodecSpecificCapabilitiesLtv::SupportedOctetsPerCodecFrame{min_octets,
+                                                                 max_octets},
+  };
+  if (preferred_contexts.has_value()) {
+    MetadataLtv::PreferredAudioContexts contexts;
+    contexts.values.bitmask = preferred_contexts.value();
+    capabilities.metadata = std::vector<std::optional<MetadataLtv>>{
+        MetadataLtv(contexts)};
+  }
+  return capabilities;
+}
+
+// Capability lists from a range of remote devices, in one direction
+std::vector<CapabilitiesList> getCapabilitiesLists() {
+  const int32_t all_frequencies =
+      SamplingFrequencies::HZ8000 | SamplingFrequencies::HZ16000 |
+      SamplingFrequencies::HZ24000 | SamplingFrequencies::HZ32000 |
+      SamplingFrequencies::HZ48000 | SamplingFrequencies::HZ96000;
+  const int32_t all_durations =
+      FrameDurations::US7500 | FrameDurations::US10000;
+
+  std::vector<CapabilitiesList> lists;
+  // A device supporting everything, and one with no metadata
+  lists.push_back({makeCapabilities(all_frequencies, all_durations, 0, 0xFFFF,
+                                    AudioContext::MEDIA |
+                                        AudioContext::CONVERSATIONAL |
+                                        AudioContext::GAME)});
+  lists.push_back({makeCapabilities(all_frequencies, all_durations, 0, 0xFFFF,
+                                    std::nullopt)});
+  // A typical earbud, one capability per frame duration
+  lists.push_back(
+      {makeCapabilities(SamplingFrequencies::HZ16000 |
+                            SamplingFrequencies::HZ24000 |
+                            SamplingFrequencies::HZ32000 |
+                            SamplingFrequencies::HZ48000,
+                        FrameDurations::US7500, 26, 155, std::nullopt),
+       std::nullopt,
+       makeCapabilities(SamplingFrequencies::HZ16000 |
+                            SamplingFrequencies::HZ24000 |
+                            SamplingFrequencies::HZ32000 |
+                            SamplingFrequencies::HZ48000,
+                        FrameDurations::US10000, 26, 155, std::nullopt)});
+  // A hearing aid with a narrow octet range and a conversational preference
+  lists.push_back({makeCapabilities(SamplingFrequencies::HZ16000,
+                                    FrameDurations::US10000, 40, 40,
+                                    AudioContext::CONVERSATIONAL)});
+  // A device whose capabilities no setting matches
+  lists.push_back({makeCapabilities(SamplingFrequencies::HZ384000,
+                                    all_durations, 0, 0xFFFF, std::nullopt)});
+  // A capability list with a capability for another codec
+  auto vendor = makeCapabilities(all_frequencies, all_durations, 0, 0xFFFF,
+                                 std::nullopt);
+  vendor.codecId = CodecId::Vendor{.id = 0xFF, .codecId = 0x01};
+  lists.push_back(
+      {vendor, makeCapabilities(SamplingFrequencies::HZ48000, all_durations,
+                                0, 0xFFFF, std::nullopt)});
+  return lists;
+}
+
+/* Requirements derived from the settings themselves, so that they match
+ * some of them: per context, with no requirement, with the latency of a
+ * configuration, and with its latency and sampling frequency */
+std::vector<std::vector<LeAudioConfigurationRequirement>> getRequirementLists(
+    const std::vector<LeAudioAseConfigurationSetting>& settings,
+    uint8_t direction) {
+  std::vector<std::vector<LeAudioConfigurationRequirement>> lists;
+  std::vector<LeAudioConfigurationRequirement> unconstrained;
+  std::vector<LeAudioConfigurationRequirement> latency;
+  std::vector<LeAudioConfigurationRequirement> latency_and_frequency;
+  std::set<int32_t> contexts;
+  for (auto& setting : settings) {
+    auto& configurations = direction == kLeAudioDirectionSink
+                               ? setting.sinkAseConfiguration
+                               : setting.sourceAseConfiguration;
+    if (!configurations.has_value()) continue;
+    for (auto& configuration : configurations.value()) {
+      if (!configuration.has_value()) continue;
+      auto& ase_configuration = configuration->aseConfiguration;
+
+      LeAudioConfigurationRequirement requirement;
+      requirement.audioContext = setting.audioContext;
+      if (contexts.insert(setting.audioContext.bitmask).second)
+        unconstrained.push_back(requirement);
+
+      AseDirectionRequirement direction_requirement;
+      direction_requirement.aseConfiguration.codecId =
+          ase_configuration.codecId;
+      direction_requirement.aseConfiguration.targetLatency =
+          ase_configuration.targetLatency;
+      auto& direction_requirements = direction == kLeAudioDirectionSink
+                                         ? requirement.sinkAseRequirement
+                                         : requirement.sourceAseRequirement;
+      direction_requirements = {direction_requirement};
+      latency.push_back(requirement);
+
+      for (auto& cfg : ase_configuration.codecConfiguration) {
+        if (cfg.getTag() !=
+            CodecSpecificConfigurationLtv::Tag::samplingFrequency)
+          continue;
+        direction_requirement.aseConfiguration.codecConfiguration = {cfg};
+        direction_requirements = {direction_requirement};
+        latency_and_frequency.push_back(requirement);
+      }
+    }
+  }
+  lists.push_back(unconstrained);
+  lists.push_back(latency);
+  lists.push_back(latency_and_frequency);
+  return lists;
+}
+
+void expectSameAsExhaustive(LeAudioOffloadAudioProvider& provider,
+                            const ExhaustiveMatcher& matcher,
+                            uint8_t direction) {
+  auto settings = BluetoothAudioCodecs::GetLeAudioAseConfigurationSettings();
+  ASSERT_FALSE(settings.empty());
+
+  size_t matched_settings = 0;
+  for (auto& capabilities : getCapabilitiesLists()) {
+    for (auto& requirements : getRequirementLists(settings, direction)) {
+      std::vector<LeAudioAseConfigurationSetting> result;
+      std::optional<CapabilitiesList> sink_capabilities;
+      std::optional<CapabilitiesList> source_capabilities;
+      if (direction == kLeAudioDirectionSink)
+        sink_capabilities = capabilities;
+      else
+        source_capabilities = capabilities;
+      ASSERT_TRUE(provider
+                      .getLeAudioAseConfiguration(sink_capabilities,
+                                                  source_capabilities,
+                                                  requirements, &result)
+                      .isOk());
+
+      auto expected =
+          matcher.match(settings, capabilities, requirements, direction);
+      ASSERT_EQ(expected.size(), result.size());
+      for (size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], result[i]) << "setting " << i;
+      matched_settings += result.size();
+    }
+  }
+  // The shipped settings must exercise the matching
+  EXPECT_GT(matched_settings, 0u);
+}
+
+TEST(LeAudioAseConfigurationTest, SinkMatchesExhaustiveMatch) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadOutputAudioProvider>();
+  expectSameAsExhaustive(*provider, ExhaustiveMatcher(),
+                         kLeAudioDirectionSink);
+}
+
+TEST(LeAudioAseConfigurationTest, SourceMatchesExhaustiveMatch) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadInputAudioProvider>();
+  expectSameAsExhaustive(*provider, ExhaustiveMatcher(),
+                         kLeAudioDirectionSource);
+}
+
+TEST(LeAudioAseConfigurationTest, DisabledCodecMatchesExhaustiveMatch) {
+  auto provider = ndk::SharedRefBase::make<LeAudioOffloadOutputAudioProvider>();
+  CodecId lc3 = CodecId::Core::LC3;
+  ASSERT_TRUE(provider->setCodecPriority(lc3, -1).isOk());
+
+  // The shipped settings are all LC3, so none is left to match
+  auto settings = BluetoothAudioCodecs::GetLeAudioAseConfigurationSettings();
+  ExhaustiveMatcher matcher({{lc3, -1}});
+  for (auto& capabilities : getCapabilitiesLists()) {
+    for (auto& requirements :
+         getRequirementLists(settings, kLeAudioDirectionSink)) {
+      std::vector<LeAudioAseConfigurationSetting> result;
+      ASSERT_TRUE(provider
+                      ->getLeAudioAseConfiguration(capabilities, std::nullopt,
+                                                   requirements, &result)
+                      .isOk());
+      EXPECT_TRUE(result.empty());
+      EXPECT_EQ(matcher.match(settings, capabilities, requirements,
+                              kLeAudioDirectionSink),
+                result);
+    }
+  }
+}
+
+}  // namespace
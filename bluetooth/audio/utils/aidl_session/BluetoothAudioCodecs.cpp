@@ -446,6 +446,11 @@ BluetoothAudioCodecs::GetLeAudioAseConfigurationSettings() {
       GetLeAudioAseConfigurationSettings();
 }
 
+std::shared_ptr<const LeAudioAseConfigurationIndex>
+BluetoothAudioCodecs::GetLeAudioAseConfigurationIndex() {
+  return AudioSetConfigurationProviderJson::GetLeAudioAseConfigurationIndex();
+}
+
 }  // namespace audio
 }  // namespace bluetooth
 }  // namespace hardware
@@ -27,8 +27,11 @@
 #include <aidl/android/hardware/bluetooth/audio/PcmConfiguration.h>
 #include <aidl/android/hardware/bluetooth/audio/SessionType.h>
 
+#include <memory>
 #include <vector>
 
+#include "BluetoothLeAudioAseConfigurationIndex.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -56,6 +59,8 @@ class BluetoothAudioCodecs {
 
   static std::vector<LeAudioAseConfigurationSetting>
   GetLeAudioAseConfigurationSettings();
+  static std::shared_ptr<const LeAudioAseConfigurationIndex>
+  GetLeAudioAseConfigurationIndex();
 
  private:
   template <typename T>
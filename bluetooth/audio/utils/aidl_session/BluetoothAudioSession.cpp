@@ -22,6 +22,9 @@
 #include <android/binder_manager.h>
 #include <hardware/audio.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "BluetoothAudioSession.h"
 
 namespace aidl {
@@ -33,8 +36,9 @@ namespace audio {
 static constexpr int kFmqSendTimeoutMs = 1000;  // 1000 ms timeout for sending
 static constexpr int kFmqReceiveTimeoutMs =
     1000;                               // 1000 ms timeout for receiving
-static constexpr int kWritePollMs = 1;  // polled non-blocking interval
-static constexpr int kReadPollMs = 1;   // polled non-blocking interval
+// shortest time to block for FMQ space or data, so a peer which does not
+// wake the EventFlag is not polled in a busy loop
+static constexpr auto kMinDataPathWait = std::chrono::milliseconds(1);
 
 BluetoothAudioSession::BluetoothAudioSession(const SessionType& session_type)
     : session_type_(session_type), stack_iface_(nullptr), data_mq_(nullptr) {}
@@ -258,18 +262,33 @@ void BluetoothAudioSession::StopStream() {
  ***/
 
 bool BluetoothAudioSession::UpdateDataPath(const DataMQDesc* mq_desc) {
+  // release PCM calls blocked on the previous data path
+  WakeDataPath(kDataMqNotEmpty | kDataMqNotFull);
+  data_mq_event_flag_ = nullptr;
+  pcm_data_path_stats_ = PcmDataPathStats();
   if (mq_desc == nullptr) {
     // usecase of reset by nullptr
     data_mq_ = nullptr;
     return true;
   }
-  std::unique_ptr<DataMQ> temp_mq;
-  temp_mq.reset(new DataMQ(*mq_desc));
+  std::shared_ptr<DataMQ> temp_mq = std::make_shared<DataMQ>(*mq_desc);
   if (!temp_mq || !temp_mq->isValid()) {
     data_mq_ = nullptr;
     return false;
   }
   data_mq_ = std::move(temp_mq);
+  EventFlag* event_flag = nullptr;
+  if (data_mq_->getEventFlagWord() != nullptr &&
+      EventFlag::createEventFlag(data_mq_->getEventFlagWord(), &event_flag) ==
+          ::android::OK) {
+    data_mq_event_flag_.reset(
+        event_flag, [data_mq = data_mq_](EventFlag* flag) {
+          EventFlag::deleteEventFlag(&flag);
+        });
+  } else {
+    LOG(WARNING) << __func__ << " - SessionType=" << toString(session_type_)
+                 << ", FMQ has no EventFlag";
+  }
   return true;
 }
 
@@ -348,15 +367,70 @@ void BluetoothAudioSession::ReportSessionStatus() {
  *
  ***/
 
+bool BluetoothAudioSession::WaitForDataPath(
+    std::unique_lock<std::recursive_mutex>& lock, uint32_t bits, size_t bytes,
+    std::chrono::steady_clock::time_point deadline) {
+  auto now = std::chrono::steady_clock::now();
+  if (now >= deadline) {
+    return false;
+  }
+  // A peer which does not wake the EventFlag needs about this long to
+  // consume or produce |bytes|.
+  std::chrono::nanoseconds timeout = kMinDataPathWait;
+  if (audio_config_ != nullptr &&
+      audio_config_->getTag() == AudioConfiguration::pcmConfig) {
+    const PcmConfiguration& pcm_config =
+        audio_config_->get<AudioConfiguration::pcmConfig>();
+    int64_t bytes_per_second =
+        static_cast<int64_t>(pcm_config.sampleRateHz) *
+        (pcm_config.channelMode == ChannelMode::MONO ? 1 : 2) *
+        (pcm_config.bitsPerSample / 8);
+    if (bytes_per_second > 0) {
+      timeout = std::max(timeout, std::chrono::nanoseconds(
+                                      bytes * 1000000000 / bytes_per_second));
+    }
+  }
+  timeout = std::min(timeout, std::chrono::nanoseconds(deadline - now));
+
+  std::shared_ptr<EventFlag> event_flag = data_mq_event_flag_;
+  lock.unlock();
+  uint32_t ef_state = 0;
+  if (event_flag != nullptr) {
+    event_flag->wait(bits, &ef_state, timeout.count(), /* retry */ true);
+  } else {
+    std::this_thread::sleep_for(timeout);
+  }
+  auto wake_latency = std::chrono::steady_clock::now() - now;
+  lock.lock();
+
+  pcm_data_path_stats_.waits++;
+  if ((ef_state & bits) == 0) {
+    pcm_data_path_stats_.wait_timeouts++;
+    return true;
+  }
+  pcm_data_path_stats_.total_wake_latency += wake_latency;
+  pcm_data_path_stats_.max_wake_latency =
+      std::max<std::chrono::nanoseconds>(pcm_data_path_stats_.max_wake_latency,
+                                         wake_latency);
+  return true;
+}
+
+void BluetoothAudioSession::WakeDataPath(uint32_t bits) {
+  if (data_mq_event_flag_ != nullptr) {
+    data_mq_event_flag_->wake(bits);
+  }
+}
+
 size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
                                               size_t bytes) {
   if (buffer == nullptr || bytes <= 0) {
     return 0;
   }
   size_t total_written = 0;
-  int timeout_ms = kFmqSendTimeoutMs;
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::milliseconds(kFmqSendTimeoutMs);
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (!IsSessionReady()) {
       break;
     }
@@ -374,13 +448,15 @@ size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
         return total_written;
       }
       total_written += num_bytes_to_write;
-    } else if (timeout_ms >= kWritePollMs) {
-      lock.unlock();
-      usleep(kWritePollMs * 1000);
-      timeout_ms -= kWritePollMs;
-    } else {
+      WakeDataPath(kDataMqNotEmpty);
+    } else if (!WaitForDataPath(lock, kDataMqNotFull, bytes - total_written,
+                                deadline)) {
+      pcm_data_path_stats_.overruns++;
       LOG(DEBUG) << "Data " << total_written << "/" << bytes << " overflow "
-                 << (kFmqSendTimeoutMs - timeout_ms) << " ms";
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count()
+                 << " ms";
       return total_written;
     }
   } while (total_written < bytes);
@@ -392,9 +468,10 @@ size_t BluetoothAudioSession::InReadPcmData(void* buffer, size_t bytes) {
     return 0;
   }
   size_t total_read = 0;
-  int timeout_ms = kFmqReceiveTimeoutMs;
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::milliseconds(kFmqReceiveTimeoutMs);
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (!IsSessionReady()) {
       break;
     }
@@ -410,14 +487,15 @@ size_t BluetoothAudioSession::InReadPcmData(void* buffer, size_t bytes) {
         return total_read;
       }
       total_read += num_bytes_to_read;
-    } else if (timeout_ms >= kReadPollMs) {
-      lock.unlock();
-      usleep(kReadPollMs * 1000);
-      timeout_ms -= kReadPollMs;
-      continue;
-    } else {
+      WakeDataPath(kDataMqNotFull);
+    } else if (!WaitForDataPath(lock, kDataMqNotEmpty, bytes - total_read,
+                                deadline)) {
+      pcm_data_path_stats_.underruns++;
       LOG(DEBUG) << "Data " << total_read << "/" << bytes << " overflow "
-                 << (kFmqReceiveTimeoutMs - timeout_ms) << " ms";
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count()
+                 << " ms";
       return total_read;
     }
   } while (total_read < bytes);
@@ -500,6 +578,18 @@ bool BluetoothAudioSession::GetPresentationPosition(
   return retval;
 }
 
+bool BluetoothAudioSession::GetPcmDataPathStats(
+    PcmDataPathStats& pcm_data_path_stats) {
+  std::lock_guard<std::recursive_mutex> guard(mutex_);
+  if (!IsSessionReady() || data_mq_ == nullptr) {
+    LOG(DEBUG) << __func__ << " - SessionType=" << toString(session_type_)
+               << " has NO data path";
+    return false;
+  }
+  pcm_data_path_stats = pcm_data_path_stats_;
+  return true;
+}
+
 void BluetoothAudioSession::UpdateSourceMetadata(
     const struct source_metadata& source_metadata) {
   ssize_t track_count = source_metadata.track_count;
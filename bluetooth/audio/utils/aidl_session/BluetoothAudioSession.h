@@ -23,7 +23,9 @@
 #include <aidl/android/hardware/bluetooth/audio/LatencyMode.h>
 #include <aidl/android/hardware/bluetooth/audio/SessionType.h>
 #include <fmq/AidlMessageQueue.h>
+#include <fmq/EventFlag.h>
 
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -41,6 +43,7 @@ namespace audio {
 using ::aidl::android::hardware::common::fmq::MQDescriptor;
 using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
 using ::android::AidlMessageQueue;
+using ::android::hardware::EventFlag;
 
 using ::aidl::android::hardware::audio::common::SinkMetadata;
 using ::aidl::android::hardware::audio::common::SourceMetadata;
@@ -52,6 +55,11 @@ using DataMQDesc =
     ::aidl::android::hardware::common::fmq::MQDescriptor<MQDataType,
                                                          MQDataMode>;
 
+// Bits of the data MQ's EventFlag, woken by the writer after writing and by
+// the reader after reading
+static constexpr uint32_t kDataMqNotEmpty = 1 << 0;
+static constexpr uint32_t kDataMqNotFull = 1 << 1;
+
 static constexpr uint16_t kObserversCookieSize = 0x0010;  // 0x0000 ~ 0x000f
 static constexpr uint16_t kObserversCookieUndefined =
     (static_cast<uint16_t>(SessionType::UNKNOWN) << 8 & 0xff00);
@@ -107,6 +115,24 @@ struct PortStatusCallbacks {
       low_latency_mode_allowed_cb_;
 };
 
+/***
+ * Statistics of the software data path (FMQ) since the session started
+ ***/
+struct PcmDataPathStats {
+  // OutWritePcmData calls which timed out before all data was written
+  uint64_t overruns = 0;
+  // InReadPcmData calls which timed out before all data was read
+  uint64_t underruns = 0;
+  // times the data path blocked waiting for FMQ space or data
+  uint64_t waits = 0;
+  // waits which timed out without the peer waking the data path
+  uint64_t wait_timeouts = 0;
+  // time from blocking until the peer woke the data path, for the waits which
+  // did not time out
+  std::chrono::nanoseconds total_wake_latency{0};
+  std::chrono::nanoseconds max_wake_latency{0};
+};
+
 class BluetoothAudioSession {
  public:
   BluetoothAudioSession(const SessionType& session_type);
@@ -184,6 +210,7 @@ class BluetoothAudioSession {
   bool SuspendStream();
   void StopStream();
   bool GetPresentationPosition(PresentationPosition& presentation_position);
+  bool GetPcmDataPathStats(PcmDataPathStats& pcm_data_path_stats);
   void UpdateSourceMetadata(const struct source_metadata& source_metadata);
   void UpdateSinkMetadata(const struct sink_metadata& sink_metadata);
   // New versions for AIDL-only clients.
@@ -209,7 +236,10 @@ class BluetoothAudioSession {
   // audio control path to use for both software and offloading
   std::shared_ptr<IBluetoothAudioPort> stack_iface_;
   // audio data path (FMQ) for software encoding
-  std::unique_ptr<DataMQ> data_mq_;
+  std::shared_ptr<DataMQ> data_mq_;
+  // EventFlag of data_mq_; it keeps data_mq_ alive while PCM calls wait on it
+  std::shared_ptr<EventFlag> data_mq_event_flag_;
+  PcmDataPathStats pcm_data_path_stats_;
   // audio data configuration for both software and offloading
   std::unique_ptr<AudioConfiguration> audio_config_;
   std::vector<LatencyMode> latency_modes_;
@@ -220,6 +250,13 @@ class BluetoothAudioSession {
       observers_;
 
   bool UpdateDataPath(const DataMQDesc* mq_desc);
+  // Blocks with mutex_ released until |bits| is woken on the data path, or
+  // for as long as the stream takes to play |bytes| of PCM. Returns false
+  // without blocking once |deadline| has passed.
+  bool WaitForDataPath(std::unique_lock<std::recursive_mutex>& lock,
+                       uint32_t bits, size_t bytes,
+                       std::chrono::steady_clock::time_point deadline);
+  void WakeDataPath(uint32_t bits);
   bool UpdateAudioConfig(const AudioConfiguration& audio_config);
   // invoking the registered session_changed_cb_
   void ReportSessionStatus();
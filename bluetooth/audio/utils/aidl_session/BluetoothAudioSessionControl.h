@@ -139,6 +139,16 @@ class BluetoothAudioSessionControl {
     return false;
   }
 
+  static bool GetPcmDataPathStats(const SessionType& session_type,
+                                  PcmDataPathStats& pcm_data_path_stats) {
+    std::shared_ptr<BluetoothAudioSession> session_ptr =
+        BluetoothAudioSessionInstance::GetSessionInstance(session_type);
+    if (session_ptr != nullptr) {
+      return session_ptr->GetPcmDataPathStats(pcm_data_path_stats);
+    }
+    return false;
+  }
+
   static void UpdateSourceMetadata(
       const SessionType& session_type,
       const struct source_metadata& source_metadata) {
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <aidl/android/hardware/bluetooth/audio/BnBluetoothAudioPort.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BluetoothAudioSession.h"
+
+using aidl::android::hardware::bluetooth::audio::AudioConfiguration;
+using aidl::android::hardware::bluetooth::audio::BluetoothAudioSession;
+using aidl::android::hardware::bluetooth::audio::BnBluetoothAudioPort;
+using aidl::android::hardware::bluetooth::audio::ChannelMode;
+using aidl::android::hardware::bluetooth::audio::DataMQ;
+using aidl::android::hardware::bluetooth::audio::kDataMqNotEmpty;
+using aidl::android::hardware::bluetooth::audio::kDataMqNotFull;
+using aidl::android::hardware::bluetooth::audio::LatencyMode;
+using aidl::android::hardware::bluetooth::audio::MQDataType;
+using aidl::android::hardware::bluetooth::audio::PcmConfiguration;
+using aidl::android::hardware::bluetooth::audio::PcmDataPathStats;
+using aidl::android::hardware::bluetooth::audio::PresentationPosition;
+using aidl::android::hardware::bluetooth::audio::SessionType;
+using aidl::android::hardware::bluetooth::audio::SinkMetadata;
+using aidl::android::hardware::bluetooth::audio::SourceMetadata;
+using ::android::hardware::EventFlag;
+using ndk::ScopedAStatus;
+
+// 48 kHz stereo 16 bit PCM
+static constexpr int kBytesPerSecond = 48000 * 2 * 2;
+// One second of PCM, so that a caller which is not woken waits for about as
+// long as its FMQ timeout.
+static constexpr size_t kDataMqSize = kBytesPerSecond;
+// How long the peer takes to consume or produce data in the tests
+static constexpr auto kPeerDelay = std::chrono::milliseconds(20);
+
+class FakeBluetoothAudioPort : public BnBluetoothAudioPort {
+ public:
+  ScopedAStatus getPresentationPosition(PresentationPosition*) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus startStream(bool) override { return ScopedAStatus::ok(); }
+  ScopedAStatus stopStream() override { return ScopedAStatus::ok(); }
+  ScopedAStatus suspendStream() override { return ScopedAStatus::ok(); }
+  ScopedAStatus updateSourceMetadata(const SourceMetadata&) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus updateSinkMetadata(const SinkMetadata&) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus setLatencyMode(LatencyMode) override {
+    return ScopedAStatus::ok();
+  }
+};
+
+// The Bluetooth stack side of a software data path: it owns the FMQ and
+// wakes the session through the FMQ's EventFlag.
+class BluetoothAudioSessionTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    data_mq_ = std::make_unique<DataMQ>(kDataMqSize,
+                                        /* configureEventFlagWord */ true);
+    ASSERT_TRUE(data_mq_->isValid());
+    ASSERT_EQ(::android::OK,
+              EventFlag::createEventFlag(data_mq_->getEventFlagWord(),
+                                         &event_flag_));
+    buffer_.resize(kDataMqSize);
+  }
+
+  void TearDown() override {
+    if (session_ != nullptr) {
+      session_->OnSessionEnded();
+    }
+    EventFlag::deleteEventFlag(&event_flag_);
+  }
+
+  void StartSession(SessionType session_type) {
+    session_ = std::make_unique<BluetoothAudioSession>(session_type);
+    PcmConfiguration pcm_config{.sampleRateHz = 48000,
+                                .channelMode = ChannelMode::STEREO,
+                                .bitsPerSample = 16,
+                                .dataIntervalUs = 10000};
+    auto mq_desc = data_mq_->dupeDesc();
+    session_->OnSessionStarted(
+        ndk::SharedRefBase::make<FakeBluetoothAudioPort>(), &mq_desc,
+        AudioConfiguration(pcm_config), {});
+    ASSERT_TRUE(session_->IsSessionReady());
+  }
+
+  // Writes PCM until the FMQ is full, which the session does without waiting
+  void FillDataMq() {
+    ASSERT_EQ(kDataMqSize,
+              session_->OutWritePcmData(buffer_.data(), kDataMqSize));
+  }
+
+  PcmDataPathStats GetStats() {
+    PcmDataPathStats stats;
+    EXPECT_TRUE(session_->GetPcmDataPathStats(stats));
+    return stats;
+  }
+
+  std::unique_ptr<DataMQ> data_mq_;
+  EventFlag* event_flag_ = nullptr;
+  std::unique_ptr<BluetoothAudioSession> session_;
+  std::vector<MQDataType> buffer_;
+};
+
+TEST_F(BluetoothAudioSessionTest, BlockedWriteIsWokenOnNotFull) {
+  StartSession(SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH);
+  FillDataMq();
+
+  size_t written = 0;
+  std::thread writer([&] {
+    written = session_->OutWritePcmData(buffer_.data(), kDataMqSize);
+  });
+  std::this_thread::sleep_for(kPeerDelay);
+  std::vector<MQDataType> peer_buffer(kDataMqSize);
+  ASSERT_TRUE(data_mq_->read(peer_buffer.data(), kDataMqSize));
+  event_flag_->wake(kDataMqNotFull);
+  writer.join();
+
+  EXPECT_EQ(kDataMqSize, written);
+  PcmDataPathStats stats = GetStats();
+  EXPECT_EQ(0u, stats.overruns);
+  EXPECT_EQ(1u, stats.waits);
+  EXPECT_EQ(0u, stats.wait_timeouts);
+  EXPECT_GT(stats.total_wake_latency.count(), 0);
+  EXPECT_EQ(stats.total_wake_latency, stats.max_wake_latency);
+}
+
+TEST_F(BluetoothAudioSessionTest, BlockedReadIsWokenOnNotEmpty) {
+  StartSession(SessionType::A2DP_SOFTWARE_DECODING_DATAPATH);
+
+  size_t read = 0;
+  std::thread reader([&] {
+    read = session_->InReadPcmData(buffer_.data(), kDataMqSize);
+  });
+  std::this_thread::sleep_for(kPeerDelay);
+  std::vector<MQDataType> peer_buffer(kDataMqSize);
+  ASSERT_TRUE(data_mq_->write(peer_buffer.data(), kDataMqSize));
+  event_flag_->wake(kDataMqNotEmpty);
+  reader.join();
+
+  EXPECT_EQ(kDataMqSize, read);
+  PcmDataPathStats stats = GetStats();
+  EXPECT_EQ(0u, stats.underruns);
+  EXPECT_EQ(1u, stats.waits);
+  EXPECT_EQ(0u, stats.wait_timeouts);
+  EXPECT_GT(stats.total_wake_latency.count(), 0);
+}
+
+TEST_F(BluetoothAudioSessionTest, TimedOutWriteIsAnOverrun) {
+  StartSession(SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH);
+  FillDataMq();
+
+  // Nothing reads the FMQ, so nothing is written.
+  EXPECT_EQ(0u, session_->OutWritePcmData(buffer_.data(), kDataMqSize));
+  PcmDataPathStats stats = GetStats();
+  EXPECT_EQ(1u, stats.overruns);
+  EXPECT_GT(stats.waits, 0u);
+  EXPECT_EQ(stats.waits, stats.wait_timeouts);
+  EXPECT_EQ(0, stats.total_wake_latency.count());
+  EXPECT_EQ(0, stats.max_wake_latency.count());
+}
+
+TEST_F(BluetoothAudioSessionTest, TimedOutReadIsAnUnderrun) {
+  StartSession(SessionType::A2DP_SOFTWARE_DECODING_DATAPATH);
+
+  // Nothing writes the FMQ, so nothing is read.
+  EXPECT_EQ(0u, session_->InReadPcmData(buffer_.data(), kDataMqSize));
+  PcmDataPathStats stats = GetStats();
+  EXPECT_EQ(1u, stats.underruns);
+  EXPECT_GT(stats.waits, 0u);
+  EXPECT_EQ(stats.waits, stats.wait_timeouts);
+  EXPECT_EQ(0, stats.total_wake_latency.count());
+}
+
+TEST_F(BluetoothAudioSessionTest, EndingSessionReleasesBlockedWrite) {
+  StartSession(SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH);
+  FillDataMq();
+
+  size_t written = kDataMqSize;
+  auto start = std::chrono::steady_clock::now();
+  std::thread writer([&] {
+    written = session_->OutWritePcmData(buffer_.data(), kDataMqSize);
+  });
+  std::this_thread::sleep_for(kPeerDelay);
+  session_->OnSessionEnded();
+  writer.join();
+
+  // The writer would otherwise wait for about a second of PCM to be read.
+  EXPECT_EQ(0u, written);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(500));
+  EXPECT_FALSE(session_->IsSessionReady());
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BTAudioAseConfigIndexAidl"
+
+#include "BluetoothLeAudioAseConfigurationIndex.h"
+
+#include <android-base/logging.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace audio {
+
+namespace {
+
+LeAudioAseConfigurationIndex::Key GetKey(
+    const std::vector<CodecSpecificConfigurationLtv>& codec_configuration) {
+  LeAudioAseConfigurationIndex::Key key;
+  for (auto& ltv : codec_configuration) {
+    if (ltv.getTag() == CodecSpecificConfigurationLtv::Tag::samplingFrequency)
+      key.first =
+          ltv.get<CodecSpecificConfigurationLtv::Tag::samplingFrequency>();
+    else if (ltv.getTag() == CodecSpecificConfigurationLtv::Tag::frameDuration)
+      key.second = ltv.get<CodecSpecificConfigurationLtv::Tag::frameDuration>();
+  }
+  return key;
+}
+
+const std::vector<size_t> kNoSettingIndices;
+
+}  // namespace
+
+LeAudioAseConfigurationIndex::LeAudioAseConfigurationIndex(
+    std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
+        settings)
+    : settings_(std::move(settings)) {
+  for (size_t i = 0; i < settings_.size(); i++) {
+    AddEntries(i, settings_[i].sinkAseConfiguration, sink_entries_);
+    AddEntries(i, settings_[i].sourceAseConfiguration, source_entries_);
+    context_setting_indices_[settings_[i].audioContext.bitmask].push_back(i);
+  }
+  LOG(INFO) << __func__ << ": Indexed " << settings_.size() << " settings, "
+            << sink_entries_.size() << " sink and " << source_entries_.size()
+            << " source codecs";
+}
+
+void LeAudioAseConfigurationIndex::AddEntries(
+    size_t setting_index,
+    const std::optional<
+        std::vector<std::optional<AseDirectionConfiguration>>>& configurations,
+    std::map<CodecId, CodecEntries>& entries) {
+  if (!configurations.has_value()) return;
+  for (size_t i = 0; i < configurations->size(); i++) {
+    auto& configuration = (*configurations)[i];
+    // Configurations without a codec never match a capability
+    if (!configuration.has_value() ||
+        !configuration->aseConfiguration.codecId.has_value())
+      continue;
+    auto& ase_configuration = configuration->aseConfiguration;
+    entries[ase_configuration.codecId.value()]
+           [GetKey(ase_configuration.codecConfiguration)]
+               .push_back({setting_index, i, &configuration.value()});
+  }
+}
+
+const LeAudioAseConfigurationIndex::CodecEntries*
+LeAudioAseConfigurationIndex::GetSinkEntries(const CodecId& codec_id) const {
+  auto it = sink_entries_.find(codec_id);
+  return it == sink_entries_.end() ? nullptr : &it->second;
+}
+
+const LeAudioAseConfigurationIndex::CodecEntries*
+LeAudioAseConfigurationIndex::GetSourceEntries(const CodecId& codec_id) const {
+  auto it = source_entries_.find(codec_id);
+  return it == source_entries_.end() ? nullptr : &it->second;
+}
+
+const std::vector<size_t>& LeAudioAseConfigurationIndex::GetSettingIndices(
+    const AudioContext& context) const {
+  auto it = context_setting_indices_.find(context.bitmask);
+  return it == context_setting_indices_.end() ? kNoSettingIndices : it->second;
+}
+
+}  // namespace audio
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
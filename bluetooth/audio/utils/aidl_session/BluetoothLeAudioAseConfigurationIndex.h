@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/bluetooth/audio/IBluetoothAudioProvider.h>
+
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace audio {
+
+/***
+ * The LE Audio ASE configuration settings, indexed so that matching them
+ * against remote capabilities and requirements only visits the candidates.
+ * The index is immutable, and refers to the settings it holds.
+ ***/
+class LeAudioAseConfigurationIndex {
+ public:
+  using AseDirectionConfiguration = IBluetoothAudioProvider::
+      LeAudioAseConfigurationSetting::AseDirectionConfiguration;
+
+  // Sampling frequency and frame duration of an ASE configuration, unset if
+  // its codec configuration has none
+  using Key =
+      std::pair<std::optional<CodecSpecificConfigurationLtv::SamplingFrequency>,
+                std::optional<CodecSpecificConfigurationLtv::FrameDuration>>;
+
+  struct Entry {
+    // index of the setting in GetSettings()
+    size_t setting_index;
+    // index of the configuration in the setting's direction configurations
+    size_t configuration_index;
+    const AseDirectionConfiguration* configuration;
+  };
+
+  // entries of one codec, by key, each list in setting order
+  using CodecEntries = std::map<Key, std::vector<Entry>>;
+
+  LeAudioAseConfigurationIndex() = default;
+  explicit LeAudioAseConfigurationIndex(
+      std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
+          settings);
+  LeAudioAseConfigurationIndex(const LeAudioAseConfigurationIndex&) = delete;
+  LeAudioAseConfigurationIndex& operator=(const LeAudioAseConfigurationIndex&) =
+      delete;
+
+  const std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>&
+  GetSettings() const {
+    return settings_;
+  }
+
+  // ASE configurations with |codec_id|, or nullptr if there are none
+  const CodecEntries* GetSinkEntries(const CodecId& codec_id) const;
+  const CodecEntries* GetSourceEntries(const CodecId& codec_id) const;
+
+  // Indices of the settings for exactly |context|, in setting order
+  const std::vector<size_t>& GetSettingIndices(
+      const AudioContext& context) const;
+
+ private:
+  void AddEntries(
+      size_t setting_index,
+      const std::optional<
+          std::vector<std::optional<AseDirectionConfiguration>>>&
+          configurations,
+      std::map<CodecId, CodecEntries>& entries);
+
+  const std::vector<IBluetoothAudioProvider::LeAudioAseConfigurationSetting>
+      settings_;
+  std::map<CodecId, CodecEntries> sink_entries_;
+  std::map<CodecId, CodecEntries> source_entries_;
+  std::map<int32_t, std::vector<size_t>> context_setting_indices_;
+};
+
+}  // namespace audio
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -64,6 +64,8 @@ std::map<std::string,
     configurations_;
 
 std::vector<LeAudioAseConfigurationSetting> ase_configuration_settings_;
+std::shared_ptr<const LeAudioAseConfigurationIndex> ase_configuration_index_;
+std::mutex load_mutex_;
 
 constexpr uint8_t kIsoDataPathHci = 0x00;
 constexpr uint8_t kIsoDataPathPlatformDefault = 0x01;
@@ -252,22 +254,48 @@ static const std::vector<
                              "aidl_audio_set_scenarios.bfbs",
                              "/vendor/etc/aidl/le_audio/"
                              "aidl_audio_set_scenarios.json"}};
+/* Flatbuffers compiled from the JSON files at build time */
+static const std::vector<const char*> kLeAudioSetConfigsBinary = {
+    "/vendor/etc/aidl/le_audio/aidl_audio_set_configurations.bin"};
+static const std::vector<const char*> kLeAudioSetScenariosBinary = {
+    "/vendor/etc/aidl/le_audio/aidl_audio_set_scenarios.bin"};
 
 /* Implementation */
 
 std::vector<LeAudioAseConfigurationSetting>
 AudioSetConfigurationProviderJson::GetLeAudioAseConfigurationSettings() {
+  std::lock_guard<std::mutex> guard(load_mutex_);
   AudioSetConfigurationProviderJson::LoadAudioSetConfigurationProviderJson();
   return ase_configuration_settings_;
 }
 
+std::shared_ptr<const LeAudioAseConfigurationIndex>
+AudioSetConfigurationProviderJson::GetLeAudioAseConfigurationIndex() {
+  std::lock_guard<std::mutex> guard(load_mutex_);
+  AudioSetConfigurationProviderJson::LoadAudioSetConfigurationProviderJson();
+  if (ase_configuration_index_ == nullptr)
+    ase_configuration_index_ = std::make_shared<LeAudioAseConfigurationIndex>(
+        ase_configuration_settings_);
+  return ase_configuration_index_;
+}
+
 void AudioSetConfigurationProviderJson::
     LoadAudioSetConfigurationProviderJson() {
   if (configurations_.empty() || ase_configuration_settings_.empty()) {
     ase_configuration_settings_.clear();
     configurations_.clear();
-    auto loaded = LoadContent(kLeAudioSetConfigs, kLeAudioSetScenarios,
-                              CodecLocation::HOST);
+    ase_configuration_index_ = nullptr;
+    auto loaded = LoadBinaryContent(kLeAudioSetConfigsBinary,
+                                    kLeAudioSetScenariosBinary,
+                                    CodecLocation::HOST);
+    if (!loaded) {
+      LOG(WARNING) << ": Unable to load compiled le audio set configuration "
+                      "files, parsing JSON.";
+      ase_configuration_settings_.clear();
+      configurations_.clear();
+      loaded = LoadContent(kLeAudioSetConfigs, kLeAudioSetScenarios,
+                           CodecLocation::HOST);
+    }
     if (!loaded)
       LOG(ERROR) << ": Unable to load le audio set configuration files.";
   } else
@@ -589,8 +617,34 @@ bool AudioSetConfigurationProviderJson::LoadConfigurationsFromFiles(
 
   /* Import from flatbuffers */
   LOG(INFO) << __func__ << ": Build flat buffer structure";
-  auto configurations_root = le_audio::GetAudioSetConfigurations(
-      configurations_parser_.builder_.GetBufferPointer());
+  return LoadConfigurations(
+      le_audio::GetAudioSetConfigurations(
+          configurations_parser_.builder_.GetBufferPointer()),
+      location);
+}
+
+bool AudioSetConfigurationProviderJson::LoadConfigurationsFromBinary(
+    const char* binary_file, CodecLocation location) {
+  std::string configurations_binary_content;
+  LOG(INFO) << __func__ << ": Loading file " << binary_file;
+  if (!flatbuffers::LoadFile(binary_file, true, &configurations_binary_content))
+    return false;
+
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(configurations_binary_content.data()),
+      configurations_binary_content.size());
+  if (!le_audio::VerifyAudioSetConfigurationsBuffer(verifier)) {
+    LOG(ERROR) << __func__ << ": Invalid file " << binary_file;
+    return false;
+  }
+  return LoadConfigurations(le_audio::GetAudioSetConfigurations(
+                                configurations_binary_content.data()),
+                            location);
+}
+
+bool AudioSetConfigurationProviderJson::LoadConfigurations(
+    const le_audio::AudioSetConfigurations* configurations_root,
+    CodecLocation location) {
   if (!configurations_root) return false;
 
   auto flat_qos_configs = configurations_root->qos_configurations();
@@ -665,8 +719,30 @@ bool AudioSetConfigurationProviderJson::LoadScenariosFromFiles(
 
   /* Import from flatbuffers */
   LOG(INFO) << __func__ << ": Build flat buffer structure";
-  auto scenarios_root = le_audio::GetAudioSetScenarios(
-      scenarios_parser_.builder_.GetBufferPointer());
+  return LoadScenarios(le_audio::GetAudioSetScenarios(
+      scenarios_parser_.builder_.GetBufferPointer()));
+}
+
+bool AudioSetConfigurationProviderJson::LoadScenariosFromBinary(
+    const char* binary_file) {
+  std::string scenarios_binary_content;
+  LOG(INFO) << __func__ << ": Loading file " << binary_file;
+  if (!flatbuffers::LoadFile(binary_file, true, &scenarios_binary_content))
+    return false;
+
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(scenarios_binary_content.data()),
+      scenarios_binary_content.size());
+  if (!le_audio::VerifyAudioSetScenariosBuffer(verifier)) {
+    LOG(ERROR) << __func__ << ": Invalid file " << binary_file;
+    return false;
+  }
+  return LoadScenarios(
+      le_audio::GetAudioSetScenarios(scenarios_binary_content.data()));
+}
+
+bool AudioSetConfigurationProviderJson::LoadScenarios(
+    const le_audio::AudioSetScenarios* scenarios_root) {
   if (!scenarios_root) return false;
 
   auto flat_scenarios = scenarios_root->scenarios();
@@ -753,6 +829,19 @@ bool AudioSetConfigurationProviderJson::LoadContent(
   return true;
 }
 
+bool AudioSetConfigurationProviderJson::LoadBinaryContent(
+    std::vector<const char*> config_files,
+    std::vector<const char*> scenario_files, CodecLocation location) {
+  for (auto file : config_files) {
+    if (!LoadConfigurationsFromBinary(file, location)) return false;
+  }
+
+  for (auto file : scenario_files) {
+    if (!LoadScenariosFromBinary(file)) return false;
+  }
+  return true;
+}
+
 }  // namespace audio
 }  // namespace bluetooth
 }  // namespace hardware
@@ -18,12 +18,14 @@
 #include <aidl/android/hardware/bluetooth/audio/IBluetoothAudioProvider.h>
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
 
+#include "BluetoothLeAudioAseConfigurationIndex.h"
 #include "audio_set_configurations_generated.h"
 #include "audio_set_scenarios_generated.h"
 
@@ -52,6 +54,8 @@ class AudioSetConfigurationProviderJson {
  public:
   static std::vector<LeAudioAseConfigurationSetting>
   GetLeAudioAseConfigurationSettings();
+  static std::shared_ptr<const LeAudioAseConfigurationIndex>
+  GetLeAudioAseConfigurationIndex();
 
  private:
   static void LoadAudioSetConfigurationProviderJson();
@@ -103,6 +107,12 @@ class AudioSetConfigurationProviderJson {
           sinkAseConfiguration,
       ConfigurationFlags& configurationFlags);
 
+  static bool LoadConfigurations(
+      const le_audio::AudioSetConfigurations* configurations_root,
+      CodecLocation location);
+
+  static bool LoadScenarios(const le_audio::AudioSetScenarios* scenarios_root);
+
   static bool LoadConfigurationsFromFiles(const char* schema_file,
                                           const char* content_file,
                                           CodecLocation location);
@@ -110,6 +120,15 @@ class AudioSetConfigurationProviderJson {
   static bool LoadScenariosFromFiles(const char* schema_file,
                                      const char* content_file);
 
+  static bool LoadConfigurationsFromBinary(const char* binary_file,
+                                           CodecLocation location);
+
+  static bool LoadScenariosFromBinary(const char* binary_file);
+
+  static bool LoadBinaryContent(std::vector<const char*> config_files,
+                                std::vector<const char*> scenario_files,
+                                CodecLocation location);
+
   static bool LoadContent(
       std::vector<std::pair<const char* /*schema*/, const char* /*content*/>>
           config_files,
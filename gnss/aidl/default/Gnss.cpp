@@ -45,7 +45,10 @@ constexpr int TTFF_MILLIS = 2200;
 
 std::shared_ptr<IGnssCallback> Gnss::sGnssCallback = nullptr;
 
-Gnss::Gnss() : mMinIntervalMs(1000), mFirstFixReceived(false) {}
+Gnss::Gnss()
+    : mMinIntervalMs(1000),
+      mFirstFixReceived(false),
+      mGnssGeofence(SharedRefBase::make<GnssGeofence>()) {}
 
 ScopedAStatus Gnss::setCallback(const std::shared_ptr<IGnssCallback>& callback) {
     ALOGD("setCallback");
@@ -163,6 +166,8 @@ ScopedAStatus Gnss::close() {
 }
 
 void Gnss::reportLocation(const GnssLocation& location) const {
+    mGnssGeofence->onLocation(location);
+
     std::unique_lock<std::mutex> lock(mMutex);
     if (sGnssCallback == nullptr) {
         ALOGE("%s: GnssCallback is null.", __func__);
@@ -345,7 +350,7 @@ ScopedAStatus Gnss::getExtensionGnssBatching(std::shared_ptr<IGnssBatching>* iGn
 ScopedAStatus Gnss::getExtensionGnssGeofence(std::shared_ptr<IGnssGeofence>* iGnssGeofence) {
     ALOGD("getExtensionGnssGeofence");
 
-    *iGnssGeofence = SharedRefBase::make<GnssGeofence>();
+    *iGnssGeofence = mGnssGeofence;
     return ScopedAStatus::ok();
 }
 
@@ -32,6 +32,7 @@
 #include <mutex>
 #include <thread>
 #include "GnssConfiguration.h"
+#include "GnssGeofence.h"
 #include "GnssMeasurementInterface.h"
 #include "GnssPowerIndication.h"
 #include "Utils.h"
@@ -111,6 +112,8 @@ class Gnss : public BnGnss {
     std::atomic<bool> mGnssMeasurementEnabled;
     std::thread mThread;
     ::android::hardware::gnss::common::ThreadBlocker mThreadBlocker;
+    // Created up front since every reported location is evaluated against its geofences.
+    const std::shared_ptr<GnssGeofence> mGnssGeofence;
 
     mutable std::mutex mMutex;
 };
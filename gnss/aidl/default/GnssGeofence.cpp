@@ -19,9 +19,92 @@
 #include "GnssGeofence.h"
 #include <aidl/android/hardware/gnss/BnGnssGeofence.h>
 #include <log/log.h>
+#include <utils/SystemClock.h>
+#include <algorithm>
+#include <cmath>
 
 namespace aidl::android::hardware::gnss {
 
+namespace {
+
+constexpr double kEarthRadiusMeters = 6371008.8;
+// Size of a grid cell, about 1.1 km of latitude.
+constexpr double kCellDegrees = 0.01;
+constexpr int64_t kLatCells = 18000;
+constexpr int64_t kLngCells = 36000;
+// Fences spanning more cells than this are evaluated on every fix instead of being indexed.
+constexpr size_t kMaxCellsPerGeofence = 64;
+// Fixes whose accuracy circle spans more cells than this are evaluated against every fence.
+constexpr size_t kMaxCellsPerLocation = 256;
+constexpr size_t kMaxGeofences = 100000;
+constexpr int kAllTransitions = IGnssGeofenceCallback::ENTERED | IGnssGeofenceCallback::EXITED |
+                                IGnssGeofenceCallback::UNCERTAIN;
+
+double toRadians(double degrees) {
+    return degrees * M_PI / 180.0;
+}
+
+double toDegrees(double radians) {
+    return radians * 180.0 / M_PI;
+}
+
+bool isValidTransition(int transition) {
+    return transition == IGnssGeofenceCallback::ENTERED ||
+           transition == IGnssGeofenceCallback::EXITED ||
+           transition == IGnssGeofenceCallback::UNCERTAIN;
+}
+
+bool isValidMonitorTransitions(int monitorTransitions) {
+    return (monitorTransitions & ~kAllTransitions) == 0;
+}
+
+double distanceMeters(double lat1, double lng1, double lat2, double lng2) {
+    double sinDLat = std::sin(toRadians(lat2 - lat1) / 2);
+    double sinDLng = std::sin(toRadians(lng2 - lng1) / 2);
+    double a = sinDLat * sinDLat +
+               std::cos(toRadians(lat1)) * std::cos(toRadians(lat2)) * sinDLng * sinDLng;
+    return 2 * kEarthRadiusMeters * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+/**
+ * Calls |fn| with every grid cell overlapping the bounding box of the circle of |radiusMeters|
+ * around the given point. Returns false without calling |fn| if there are more than |maxCells|.
+ */
+template <typename Fn>
+bool forEachCell(double latitudeDegrees, double longitudeDegrees, double radiusMeters,
+                 size_t maxCells, Fn fn) {
+    double dLat = toDegrees(radiusMeters / kEarthRadiusMeters);
+    if (std::abs(latitudeDegrees) + dLat >= 90) {
+        // The box reaches a pole and covers every longitude.
+        return false;
+    }
+    // Use the width of a degree of longitude at the edge of the box closest to a pole.
+    double dLng = toDegrees(radiusMeters / (kEarthRadiusMeters *
+                                            std::cos(toRadians(std::abs(latitudeDegrees) + dLat))));
+    auto cellOf = [](double degrees) {
+        return static_cast<int64_t>(std::floor(degrees / kCellDegrees));
+    };
+    int64_t latMin = cellOf(latitudeDegrees - dLat + 90);
+    int64_t latMax = cellOf(latitudeDegrees + dLat + 90);
+    int64_t lngMin = cellOf(longitudeDegrees - dLng + 180);
+    int64_t lngMax = cellOf(longitudeDegrees + dLng + 180);
+    latMin = std::max<int64_t>(latMin, 0);
+    latMax = std::min<int64_t>(latMax, kLatCells - 1);
+    if (lngMax - lngMin + 1 >= kLngCells ||
+        static_cast<size_t>((latMax - latMin + 1) * (lngMax - lngMin + 1)) > maxCells) {
+        return false;
+    }
+    for (int64_t lat = latMin; lat <= latMax; lat++) {
+        for (int64_t lng = lngMin; lng <= lngMax; lng++) {
+            // Wrap around the antimeridian.
+            fn(lat * kLngCells + (lng % kLngCells + kLngCells) % kLngCells);
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 std::shared_ptr<IGnssGeofenceCallback> GnssGeofence::sCallback = nullptr;
 
 ndk::ScopedAStatus GnssGeofence::setCallback(
@@ -29,6 +112,7 @@ ndk::ScopedAStatus GnssGeofence::setCallback(
     ALOGD("setCallback");
     std::unique_lock<std::mutex> lock(mMutex);
     sCallback = callback;
+    mAvailabilityReported = false;
     return ndk::ScopedAStatus::ok();
 }
 
@@ -40,22 +124,264 @@ ndk::ScopedAStatus GnssGeofence::addGeofence(int geofenceId, double latitudeDegr
           "monitorTransitions=%d, notificationResponsivenessMs=%d, unknownTimerMs=%d",
           geofenceId, latitudeDegrees, longitudeDegrees, radiusMeters, lastTransition,
           monitorTransitions, notificationResponsivenessMs, unknownTimerMs);
+    int status = IGnssGeofenceCallback::OPERATION_SUCCESS;
+    std::shared_ptr<IGnssGeofenceCallback> callback;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        callback = sCallback;
+        if (mGeofences.find(geofenceId) != mGeofences.end()) {
+            status = IGnssGeofenceCallback::ERROR_ID_EXISTS;
+        } else if (mGeofences.size() >= kMaxGeofences) {
+            status = IGnssGeofenceCallback::ERROR_TOO_MANY_GEOFENCES;
+        } else if (!isValidTransition(lastTransition) ||
+                   !isValidMonitorTransitions(monitorTransitions)) {
+            status = IGnssGeofenceCallback::ERROR_INVALID_TRANSITION;
+        } else if (!(std::abs(latitudeDegrees) <= 90) || !(std::abs(longitudeDegrees) <= 180) ||
+                   !(radiusMeters > 0) || unknownTimerMs < 0) {
+            status = IGnssGeofenceCallback::ERROR_GENERIC;
+        } else {
+            Geofence& geofence = mGeofences[geofenceId];
+            geofence = {.latitudeDegrees = latitudeDegrees,
+                        .longitudeDegrees = longitudeDegrees,
+                        .radiusMeters = radiusMeters,
+                        .monitorTransitions = monitorTransitions,
+                        .notificationResponsivenessMs = notificationResponsivenessMs,
+                        .unknownTimerMs = unknownTimerMs,
+                        .lastTransition = lastTransition,
+                        .uncertainSinceMs = -1,
+                        .lastEvaluatedMs = -1,
+                        .paused = false,
+                        .cells = {}};
+            indexGeofenceLocked(geofenceId, &geofence);
+            updateActiveLocked(geofenceId, geofence);
+        }
+    }
+    if (callback != nullptr && !callback->gnssGeofenceAddCb(geofenceId, status).isOk()) {
+        ALOGE("%s: Unable to invoke gnssGeofenceAddCb", __func__);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus GnssGeofence::pauseGeofence(int geofenceId) {
     ALOGD("pauseGeofence. id=%d", geofenceId);
+    int status = IGnssGeofenceCallback::OPERATION_SUCCESS;
+    std::shared_ptr<IGnssGeofenceCallback> callback;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        callback = sCallback;
+        auto it = mGeofences.find(geofenceId);
+        if (it == mGeofences.end()) {
+            status = IGnssGeofenceCallback::ERROR_ID_UNKNOWN;
+        } else {
+            it->second.paused = true;
+            it->second.uncertainSinceMs = -1;
+            updateActiveLocked(geofenceId, it->second);
+        }
+    }
+    if (callback != nullptr && !callback->gnssGeofencePauseCb(geofenceId, status).isOk()) {
+        ALOGE("%s: Unable to invoke gnssGeofencePauseCb", __func__);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus GnssGeofence::resumeGeofence(int geofenceId, int monitorTransitions) {
     ALOGD("resumeGeofence. id=%d, monitorTransitions=%d", geofenceId, monitorTransitions);
+    int status = IGnssGeofenceCallback::OPERATION_SUCCESS;
+    std::shared_ptr<IGnssGeofenceCallback> callback;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        callback = sCallback;
+        auto it = mGeofences.find(geofenceId);
+        if (it == mGeofences.end()) {
+            status = IGnssGeofenceCallback::ERROR_ID_UNKNOWN;
+        } else if (!isValidMonitorTransitions(monitorTransitions)) {
+            status = IGnssGeofenceCallback::ERROR_GENERIC;
+        } else {
+            it->second.paused = false;
+            it->second.monitorTransitions = monitorTransitions;
+            it->second.lastEvaluatedMs = -1;
+            // The fence may have moved while paused, so evaluate it on the next fix wherever it is.
+            mActiveGeofences.insert(geofenceId);
+        }
+    }
+    if (callback != nullptr && !callback->gnssGeofenceResumeCb(geofenceId, status).isOk()) {
+        ALOGE("%s: Unable to invoke gnssGeofenceResumeCb", __func__);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus GnssGeofence::removeGeofence(int geofenceId) {
     ALOGD("removeGeofence. id=%d", geofenceId);
+    int status = IGnssGeofenceCallback::OPERATION_SUCCESS;
+    std::shared_ptr<IGnssGeofenceCallback> callback;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        callback = sCallback;
+        auto it = mGeofences.find(geofenceId);
+        if (it == mGeofences.end()) {
+            status = IGnssGeofenceCallback::ERROR_ID_UNKNOWN;
+        } else {
+            unindexGeofenceLocked(geofenceId, it->second);
+            mActiveGeofences.erase(geofenceId);
+            mGeofences.erase(it);
+        }
+    }
+    if (callback != nullptr && !callback->gnssGeofenceRemoveCb(geofenceId, status).isOk()) {
+        ALOGE("%s: Unable to invoke gnssGeofenceRemoveCb", __func__);
+    }
     return ndk::ScopedAStatus::ok();
 }
 
+void GnssGeofence::onLocation(const GnssLocation& location) {
+    onLocation(location, ::android::elapsedRealtime());
+}
+
+void GnssGeofence::onLocation(const GnssLocation& location, int64_t nowMs) {
+    if ((location.gnssLocationFlags & GnssLocation::HAS_LAT_LONG) == 0) {
+        return;
+    }
+    const double accuracyMeters =
+            (location.gnssLocationFlags & GnssLocation::HAS_HORIZONTAL_ACCURACY) != 0
+                    ? location.horizontalAccuracyMeters
+                    : 0;
+
+    std::shared_ptr<IGnssGeofenceCallback> callback;
+    bool reportAvailability;
+    std::vector<Transition> transitions;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        callback = sCallback;
+        reportAvailability = callback != nullptr && !mAvailabilityReported;
+        mAvailabilityReported |= reportAvailability;
+        const int64_t fixIntervalMs =
+                mLastFixMs >= 0 ? std::max<int64_t>(nowMs - mLastFixMs, 0) : 0;
+        mLastFixMs = nowMs;
+
+        // Fences near the fix may change state, as may those not known to be outside. Every
+        // other fence is outside and stays outside.
+        mCandidates.assign(mActiveGeofences.begin(), mActiveGeofences.end());
+        mCandidates.insert(mCandidates.end(), mLargeGeofences.begin(), mLargeGeofences.end());
+        bool indexed = forEachCell(location.latitudeDegrees, location.longitudeDegrees,
+                                   accuracyMeters, kMaxCellsPerLocation, [this](int64_t cell) {
+                                       auto it = mGrid.find(cell);
+                                       if (it != mGrid.end()) {
+                                           mCandidates.insert(mCandidates.end(),
+                                                              it->second.begin(),
+                                                              it->second.end());
+                                       }
+                                   });
+        if (!indexed) {
+            mCandidates.clear();
+            for (const auto& [geofenceId, geofence] : mGeofences) {
+                mCandidates.push_back(geofenceId);
+            }
+        }
+        std::sort(mCandidates.begin(), mCandidates.end());
+        mCandidates.erase(std::unique(mCandidates.begin(), mCandidates.end()), mCandidates.end());
+
+        for (int geofenceId : mCandidates) {
+            Geofence& geofence = mGeofences.at(geofenceId);
+            if (geofence.paused) {
+                continue;
+            }
+            // Leave the fence to the next fix if that one still meets its responsiveness.
+            if (geofence.lastEvaluatedMs >= 0 &&
+                nowMs + fixIntervalMs <
+                        geofence.lastEvaluatedMs + geofence.notificationResponsivenessMs) {
+                continue;
+            }
+            geofence.lastEvaluatedMs = nowMs;
+            int transition = evaluateLocked(location, accuracyMeters, nowMs, &geofence);
+            updateActiveLocked(geofenceId, geofence);
+            if (transition != 0 && (geofence.monitorTransitions & transition) != 0) {
+                transitions.push_back({geofenceId, transition});
+            }
+        }
+    }
+
+    if (callback == nullptr) {
+        return;
+    }
+    if (reportAvailability &&
+        !callback->gnssGeofenceStatusCb(IGnssGeofenceCallback::AVAILABLE, location).isOk()) {
+        ALOGE("%s: Unable to invoke gnssGeofenceStatusCb", __func__);
+    }
+    for (const auto& [geofenceId, transition] : transitions) {
+        if (!callback->gnssGeofenceTransitionCb(geofenceId, location, transition,
+                                                location.timestampMillis)
+                     .isOk()) {
+            ALOGE("%s: Unable to invoke gnssGeofenceTransitionCb", __func__);
+        }
+    }
+}
+
+int GnssGeofence::evaluateLocked(const GnssLocation& location, double accuracyMeters,
+                                 int64_t nowMs, Geofence* geofence) {
+    double distance = distanceMeters(location.latitudeDegrees, location.longitudeDegrees,
+                                     geofence->latitudeDegrees, geofence->longitudeDegrees);
+    int state;
+    if (distance + accuracyMeters <= geofence->radiusMeters) {
+        state = IGnssGeofenceCallback::ENTERED;
+    } else if (distance - accuracyMeters > geofence->radiusMeters) {
+        state = IGnssGeofenceCallback::EXITED;
+    } else {
+        // The accuracy circle straddles the boundary. The fence only becomes UNCERTAIN once that
+        // has lasted for its unknown timer.
+        if (geofence->lastTransition == IGnssGeofenceCallback::UNCERTAIN) {
+            return 0;
+        }
+        if (geofence->uncertainSinceMs < 0) {
+            geofence->uncertainSinceMs = nowMs;
+        }
+        if (nowMs - geofence->uncertainSinceMs < geofence->unknownTimerMs) {
+            return 0;
+        }
+        state = IGnssGeofenceCallback::UNCERTAIN;
+    }
+
+    geofence->uncertainSinceMs = -1;
+    if (state == geofence->lastTransition) {
+        return 0;
+    }
+    geofence->lastTransition = state;
+    return state;
+}
+
+void GnssGeofence::indexGeofenceLocked(int geofenceId, Geofence* geofence) {
+    bool indexed = forEachCell(geofence->latitudeDegrees, geofence->longitudeDegrees,
+                               geofence->radiusMeters, kMaxCellsPerGeofence,
+                               [&](int64_t cell) { geofence->cells.push_back(cell); });
+    if (!indexed) {
+        mLargeGeofences.insert(geofenceId);
+        return;
+    }
+    for (int64_t cell : geofence->cells) {
+        mGrid[cell].push_back(geofenceId);
+    }
+}
+
+void GnssGeofence::unindexGeofenceLocked(int geofenceId, const Geofence& geofence) {
+    mLargeGeofences.erase(geofenceId);
+    for (int64_t cell : geofence.cells) {
+        auto it = mGrid.find(cell);
+        if (it == mGrid.end()) {
+            continue;
+        }
+        auto& ids = it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), geofenceId), ids.end());
+        if (ids.empty()) {
+            mGrid.erase(it);
+        }
+    }
+}
+
+void GnssGeofence::updateActiveLocked(int geofenceId, const Geofence& geofence) {
+    if (!geofence.paused && (geofence.lastTransition != IGnssGeofenceCallback::EXITED ||
+                             geofence.uncertainSinceMs >= 0)) {
+        mActiveGeofences.insert(geofenceId);
+    } else {
+        mActiveGeofences.erase(geofenceId);
+    }
+}
+
 }  // namespace aidl::android::hardware::gnss
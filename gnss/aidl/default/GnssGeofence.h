@@ -17,9 +17,25 @@
 #pragma once
 
 #include <aidl/android/hardware/gnss/BnGnssGeofence.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace aidl::android::hardware::gnss {
 
+/**
+ * Evaluates every reported location against the registered circular geofences.
+ *
+ * Fences are indexed in a fixed latitude/longitude grid so that a fix only looks at the fences
+ * around it, plus the fences that are not known to be outside (entered, uncertain, or waiting on
+ * their unknown timer) and those too large to be indexed. A fence that is known to be outside
+ * and is not near the fix cannot have changed state, so it is never touched.
+ *
+ * A fence that is evaluated is then skipped on the following fixes as long as a later fix still
+ * arrives within its notificationResponsivenessMs of that evaluation, assuming fixes keep their
+ * current interval.
+ */
 struct GnssGeofence : public BnGnssGeofence {
   public:
     ndk::ScopedAStatus setCallback(const std::shared_ptr<IGnssGeofenceCallback>& callback) override;
@@ -30,12 +46,61 @@ struct GnssGeofence : public BnGnssGeofence {
     ndk::ScopedAStatus resumeGeofence(int geofenceId, int monitorTransitions) override;
     ndk::ScopedAStatus removeGeofence(int geofenceId) override;
 
+    // Evaluates |location| against every fence and reports the resulting transitions.
+    void onLocation(const GnssLocation& location);
+    // As above, with |nowMs| in elapsedRealtime() time. Used directly by tests.
+    void onLocation(const GnssLocation& location, int64_t nowMs);
+
   private:
+    struct Geofence {
+        double latitudeDegrees;
+        double longitudeDegrees;
+        double radiusMeters;
+        int monitorTransitions;
+        int notificationResponsivenessMs;
+        int unknownTimerMs;
+        // The last transition reported (or given to addGeofence) for this fence.
+        int lastTransition;
+        // When the fence was first seen neither inside nor outside, or -1. It moves to UNCERTAIN
+        // once this has lasted unknownTimerMs.
+        int64_t uncertainSinceMs;
+        // When the fence was last evaluated, or -1.
+        int64_t lastEvaluatedMs;
+        bool paused;
+        // Grid cells the fence is indexed in; empty for fences in mLargeGeofences.
+        std::vector<int64_t> cells;
+    };
+
+    struct Transition {
+        int geofenceId;
+        int transition;
+    };
+
+    void indexGeofenceLocked(int geofenceId, Geofence* geofence);
+    void unindexGeofenceLocked(int geofenceId, const Geofence& geofence);
+    void updateActiveLocked(int geofenceId, const Geofence& geofence);
+    // Updates the state of |geofence| for |location| and returns the transition it made, or 0.
+    int evaluateLocked(const GnssLocation& location, double accuracyMeters, int64_t nowMs,
+                       Geofence* geofence);
+
     // Guarded by mMutex
     static std::shared_ptr<IGnssGeofenceCallback> sCallback;
 
-    // Synchronization lock for sCallback
+    // Synchronization lock for sCallback and the geofences below
     mutable std::mutex mMutex;
+
+    std::unordered_map<int, Geofence> mGeofences;
+    // Grid cell to the ids of the fences whose bounding box overlaps it.
+    std::unordered_map<int64_t, std::vector<int>> mGrid;
+    // Fences covering too many cells to be indexed; evaluated on every fix.
+    std::unordered_set<int> mLargeGeofences;
+    // Fences that are not known to be outside, which must be evaluated wherever the fix is.
+    std::unordered_set<int> mActiveGeofences;
+    // Fences to evaluate for the current fix, kept to reuse its capacity.
+    std::vector<int> mCandidates;
+    // Time of the previous fix, or -1.
+    int64_t mLastFixMs = -1;
+    bool mAvailabilityReported = false;
 };
 
 }  // namespace aidl::android::hardware::gnss
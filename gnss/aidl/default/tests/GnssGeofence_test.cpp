@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <aidl/android/hardware/gnss/BnGnssGeofenceCallback.h>
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "GnssGeofence.h"
+
+using ::aidl::android::hardware::gnss::BnGnssGeofenceCallback;
+using ::aidl::android::hardware::gnss::GnssGeofence;
+using ::aidl::android::hardware::gnss::GnssLocation;
+using ::aidl::android::hardware::gnss::IGnssGeofenceCallback;
+
+namespace {
+
+constexpr int kEntered = IGnssGeofenceCallback::ENTERED;
+constexpr int kExited = IGnssGeofenceCallback::EXITED;
+constexpr int kUncertain = IGnssGeofenceCallback::UNCERTAIN;
+constexpr int kAllTransitions = kEntered | kExited | kUncertain;
+constexpr int kGeofenceId = 1;
+// Meters per degree of latitude.
+constexpr double kMetersPerDegree = 6371008.8 * M_PI / 180.0;
+
+class TransitionRecorder : public BnGnssGeofenceCallback {
+  public:
+    ndk::ScopedAStatus gnssGeofenceTransitionCb(int geofenceId, const GnssLocation& /* location */,
+                                                int transition,
+                                                int64_t /* timestampMillis */) override {
+        transitions.push_back({geofenceId, transition});
+        return ndk::ScopedAStatus::ok();
+    }
+    ndk::ScopedAStatus gnssGeofenceStatusCb(int /* availability */,
+                                            const GnssLocation& /* lastLocation */) override {
+        return ndk::ScopedAStatus::ok();
+    }
+    ndk::ScopedAStatus gnssGeofenceAddCb(int /* geofenceId */, int status) override {
+        addStatuses.push_back(status);
+        return ndk::ScopedAStatus::ok();
+    }
+    ndk::ScopedAStatus gnssGeofenceRemoveCb(int /* geofenceId */, int /* status */) override {
+        return ndk::ScopedAStatus::ok();
+    }
+    ndk::ScopedAStatus gnssGeofencePauseCb(int /* geofenceId */, int /* status */) override {
+        return ndk::ScopedAStatus::ok();
+    }
+    ndk::ScopedAStatus gnssGeofenceResumeCb(int /* geofenceId */, int /* status */) override {
+        return ndk::ScopedAStatus::ok();
+    }
+
+    // Returns the transitions reported since the last call.
+    std::vector<std::pair<int, int>> take() {
+        std::vector<std::pair<int, int>> taken;
+        taken.swap(transitions);
+        return taken;
+    }
+
+    std::vector<std::pair<int, int>> transitions;
+    std::vector<int> addStatuses;
+};
+
+GnssLocation makeLocation(double latitudeDegrees, double longitudeDegrees,
+                          double accuracyMeters = 5) {
+    GnssLocation location;
+    location.gnssLocationFlags =
+            GnssLocation::HAS_LAT_LONG | GnssLocation::HAS_HORIZONTAL_ACCURACY;
+    location.latitudeDegrees = latitudeDegrees;
+    location.longitudeDegrees = longitudeDegrees;
+    location.horizontalAccuracyMeters = accuracyMeters;
+    return location;
+}
+
+// Returns |location| moved |meters| to the north.
+GnssLocation north(GnssLocation location, double meters) {
+    location.latitudeDegrees += meters / kMetersPerDegree;
+    return location;
+}
+
+class GnssGeofenceTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        mGeofence = ndk::SharedRefBase::make<GnssGeofence>();
+        mCallback = ndk::SharedRefBase::make<TransitionRecorder>();
+        ASSERT_TRUE(mGeofence->setCallback(mCallback).isOk());
+    }
+
+    void TearDown() override { mGeofence->setCallback(nullptr); }
+
+    void addGeofence(int geofenceId, const GnssLocation& center, double radiusMeters,
+                     int monitorTransitions = kAllTransitions, int notificationResponsivenessMs = 0,
+                     int unknownTimerMs = 0, int lastTransition = kExited) {
+        mGeofence->addGeofence(geofenceId, center.latitudeDegrees, center.longitudeDegrees,
+                               radiusMeters, lastTransition, monitorTransitions,
+                               notificationResponsivenessMs, unknownTimerMs);
+        ASSERT_EQ(IGnssGeofenceCallback::OPERATION_SUCCESS, mCallback->addStatuses.back());
+    }
+
+    std::shared_ptr<GnssGeofence> mGeofence;
+    std::shared_ptr<TransitionRecorder> mCallback;
+    // Lies in the middle of a grid cell.
+    const GnssLocation kCenter = makeLocation(37.005, -122.005);
+};
+
+using Transitions = std::vector<std::pair<int, int>>;
+
+}  // namespace
+
+TEST_F(GnssGeofenceTest, EntersAndExits) {
+    addGeofence(kGeofenceId, kCenter, 100);
+
+    mGeofence->onLocation(north(kCenter, 10), 0);
+    EXPECT_EQ((Transitions{{kGeofenceId, kEntered}}), mCallback->take());
+    mGeofence->onLocation(north(kCenter, 20), 1000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(north(kCenter, 200), 2000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kExited}}), mCallback->take());
+    // Far away fixes do not report the fence again.
+    mGeofence->onLocation(north(kCenter, 50000), 3000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, InitialStateComesFromLastTransition) {
+    addGeofence(kGeofenceId, kCenter, 100, kAllTransitions, 0, 0, kEntered);
+    mGeofence->onLocation(kCenter, 0);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(north(kCenter, 50000), 1000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kExited}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, BecomesUncertainAfterUnknownTimer) {
+    addGeofence(kGeofenceId, kCenter, 100, kAllTransitions, 0, 5000 /* unknownTimerMs */);
+
+    // The accuracy circle straddles the boundary.
+    GnssLocation boundary = north(kCenter, 100);
+    boundary.horizontalAccuracyMeters = 50;
+    mGeofence->onLocation(boundary, 0);
+    mGeofence->onLocation(boundary, 4999);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(boundary, 5000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kUncertain}}), mCallback->take());
+    mGeofence->onLocation(boundary, 10000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+
+    mGeofence->onLocation(kCenter, 11000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kEntered}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, LeavingTheBoundaryResetsUnknownTimer) {
+    addGeofence(kGeofenceId, kCenter, 100, kAllTransitions, 0, 5000 /* unknownTimerMs */);
+    GnssLocation boundary = north(kCenter, 100);
+    boundary.horizontalAccuracyMeters = 50;
+
+    mGeofence->onLocation(boundary, 0);
+    mGeofence->onLocation(north(kCenter, 500), 3000);
+    mGeofence->onLocation(boundary, 4000);
+    mGeofence->onLocation(boundary, 8000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(boundary, 9000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kUncertain}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, ReportsOnlyMonitoredTransitions) {
+    addGeofence(kGeofenceId, kCenter, 100, kExited);
+    mGeofence->onLocation(kCenter, 0);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(north(kCenter, 500), 1000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kExited}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, PausedFencesAreNotEvaluated) {
+    addGeofence(kGeofenceId, kCenter, 100);
+    mGeofence->pauseGeofence(kGeofenceId);
+    mGeofence->onLocation(kCenter, 0);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+
+    mGeofence->resumeGeofence(kGeofenceId, kAllTransitions);
+    mGeofence->onLocation(kCenter, 1000);
+    EXPECT_EQ((Transitions{{kGeofenceId, kEntered}}), mCallback->take());
+
+    mGeofence->removeGeofence(kGeofenceId);
+    mGeofence->onLocation(north(kCenter, 500), 2000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, FindsFencesAcrossCellBoundaries) {
+    // A fence centered on a grid corner overlaps four cells; enter it from each of them.
+    GnssLocation corner = makeLocation(37.0, -122.0);
+    addGeofence(kGeofenceId, corner, 300);
+    const double offset = 100 / kMetersPerDegree;
+    int64_t nowMs = 0;
+    for (double dLat : {-offset, offset}) {
+        for (double dLng : {-offset, offset}) {
+            mGeofence->onLocation(
+                    makeLocation(corner.latitudeDegrees + dLat, corner.longitudeDegrees + dLng),
+                    nowMs += 1000);
+            EXPECT_EQ((Transitions{{kGeofenceId, kEntered}}), mCallback->take());
+            mGeofence->onLocation(north(corner, 50000), nowMs += 1000);
+            EXPECT_EQ((Transitions{{kGeofenceId, kExited}}), mCallback->take());
+        }
+    }
+}
+
+TEST_F(GnssGeofenceTest, FindsFencesAcrossAntimeridian) {
+    addGeofence(kGeofenceId, makeLocation(10.0, 179.9995), 300);
+    mGeofence->onLocation(makeLocation(10.0, -179.9995), 0);
+    EXPECT_EQ((Transitions{{kGeofenceId, kEntered}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, FindsLargeAndPolarFences) {
+    addGeofence(1, kCenter, 100000);
+    addGeofence(2, makeLocation(89.99, 0), 5000);
+    mGeofence->onLocation(north(kCenter, 50000), 0);
+    EXPECT_EQ((Transitions{{1, kEntered}}), mCallback->take());
+    mGeofence->onLocation(makeLocation(89.99, 120), 1000);
+    EXPECT_EQ((Transitions{{1, kExited}, {2, kEntered}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, EvaluatesEveryFenceForInaccurateFixes) {
+    addGeofence(1, kCenter, 100);
+    addGeofence(2, north(kCenter, 50000), 100);
+    // The accuracy circle covers too many cells to be indexed, so every fence is evaluated.
+    GnssLocation inaccurate = kCenter;
+    inaccurate.horizontalAccuracyMeters = 20000;
+    mGeofence->onLocation(inaccurate, 0);
+    EXPECT_EQ((Transitions{{1, kUncertain}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, DefersEvaluationWithinResponsiveness) {
+    addGeofence(1, kCenter, 100, kAllTransitions, 5000 /* notificationResponsivenessMs */);
+    addGeofence(2, kCenter, 100);
+
+    // Outside, but near enough for both fences to be evaluated.
+    mGeofence->onLocation(north(kCenter, 300), 0);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+
+    // With a fix every second, fence 1 is left to the last fix within 5s of its evaluation.
+    mGeofence->onLocation(kCenter, 1000);
+    EXPECT_EQ((Transitions{{2, kEntered}}), mCallback->take());
+    mGeofence->onLocation(kCenter, 2000);
+    mGeofence->onLocation(kCenter, 3000);
+    EXPECT_EQ(Transitions{}, mCallback->take());
+    mGeofence->onLocation(kCenter, 4000);
+    EXPECT_EQ((Transitions{{1, kEntered}}), mCallback->take());
+}
+
+TEST_F(GnssGeofenceTest, RejectsInvalidFences) {
+    mGeofence->addGeofence(1, 0, 0, 100, 0 /* lastTransition */, kAllTransitions, 0, 0);
+    EXPECT_EQ(IGnssGeofenceCallback::ERROR_INVALID_TRANSITION, mCallback->addStatuses.back());
+    mGeofence->addGeofence(1, 91, 0, 100, kExited, kAllTransitions, 0, 0);
+    EXPECT_EQ(IGnssGeofenceCallback::ERROR_GENERIC, mCallback->addStatuses.back());
+    mGeofence->addGeofence(1, 0, 0, 0, kExited, kAllTransitions, 0, 0);
+    EXPECT_EQ(IGnssGeofenceCallback::ERROR_GENERIC, mCallback->addStatuses.back());
+    addGeofence(1, kCenter, 100);
+    mGeofence->addGeofence(1, 0, 0, 100, kExited, kAllTransitions, 0, 0);
+    EXPECT_EQ(IGnssGeofenceCallback::ERROR_ID_EXISTS, mCallback->addStatuses.back());
+}
@@ -15,105 +15,265 @@
  */
 #include "DeviceFileReader.h"
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
 namespace android {
 namespace hardware {
 namespace gnss {
 namespace common {
 
-void DeviceFileReader::getDataFromDeviceFile(const std::string& command, int mMinIntervalMs) {
-    char inputBuffer[INPUT_BUFFER_SIZE];
-    std::string deviceFilePath = "";
-    if (command == CMD_GET_LOCATION) {
-        deviceFilePath = ReplayUtils::getFixedLocationPath();
-    } else if (command == CMD_GET_RAWMEASUREMENT) {
-        deviceFilePath = ReplayUtils::getGnssPath();
-    } else {
-        // Invalid command
-        return;
-    }
+namespace {
+
+// Marks the end of each record sent by the device.
+constexpr std::string_view kEndOfRecordMark = "\n\n\n\n";
+// Bytes appended to a device buffer per read.
+constexpr size_t kReadChunkSize = 16 * INPUT_BUFFER_SIZE;
+// Requests without a response that are remembered per device.
+constexpr size_t kMaxPendingCommands = 16;
+constexpr int kMaxEpollEvents = 4;
+
+}  // namespace
 
-    int gnss_fd, epoll_fd;
-    if ((gnss_fd = open(deviceFilePath.c_str(), O_RDWR | O_NONBLOCK)) == -1) {
+DeviceFileReader::DeviceFileReader(int responseTimeoutMs)
+    : mResponseTimeoutMs(responseTimeoutMs),
+      mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (mEpollFd < 0 || mEventFd < 0) {
+        ALOGE("Failed to create the device file reader: %s", strerror(errno));
         return;
     }
-    if (write(gnss_fd, command.c_str(), command.size()) <= 0) {
-        close(gnss_fd);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &ev) == -1) {
+        ALOGE("Failed to watch the device file reader eventfd: %s", strerror(errno));
         return;
     }
+    mReaderThread = std::thread(&DeviceFileReader::readLoop, this);
+}
 
-    // Create an epoll instance.
-    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
-        close(gnss_fd);
-        return;
+DeviceFileReader::~DeviceFileReader() {
+    if (mReaderThread.joinable()) {
+        uint64_t stop = 1;
+        if (write(mEventFd, &stop, sizeof(stop)) == sizeof(stop)) {
+            mReaderThread.join();
+        } else {
+            mReaderThread.detach();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& [path, device] : mDevices) {
+            closeDeviceLocked(&device);
+        }
+    }
+    if (mEventFd >= 0) {
+        close(mEventFd);
+    }
+    if (mEpollFd >= 0) {
+        close(mEpollFd);
+    }
+}
+
+std::string DeviceFileReader::getLocationData() {
+    return getLocationData(ReplayUtils::getFixedLocationPath());
+}
+
+std::string DeviceFileReader::getGnssRawMeasurementData() {
+    return getGnssRawMeasurementData(ReplayUtils::getGnssPath());
+}
+
+std::string DeviceFileReader::getLocationData(const std::string& deviceFilePath) {
+    return getData(CMD_GET_LOCATION, deviceFilePath, &mLocation);
+}
+
+std::string DeviceFileReader::getGnssRawMeasurementData(const std::string& deviceFilePath) {
+    return getData(CMD_GET_RAWMEASUREMENT, deviceFilePath, &mRawMeasurement);
+}
+
+std::string DeviceFileReader::getData(const std::string& command,
+                                      const std::string& deviceFilePath, Snapshot* snapshot) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotMutex);
+        generation = snapshot->generation;
     }
+    bool requested = requestData(command, deviceFilePath);
+
+    // Wait for the reader thread to publish the response to this request, or any later record.
+    std::shared_ptr<const std::string> data;
+    {
+        std::unique_lock<std::mutex> lock(mSnapshotMutex);
+        if (requested) {
+            mPublishedCV.wait_for(lock, std::chrono::milliseconds(mResponseTimeoutMs),
+                                  [&] { return snapshot->generation != generation; });
+        }
+        data = snapshot->data;
+    }
+    return data != nullptr ? *data : "";
+}
 
-    // Add file descriptor to epoll instance.
-    struct epoll_event ev, events[1];
+bool DeviceFileReader::requestData(const std::string& command, const std::string& deviceFilePath) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mReaderThread.joinable()) {
+        return false;
+    }
+    Device* device = openDeviceLocked(deviceFilePath);
+    if (device == nullptr) {
+        return false;
+    }
+    if (write(device->fd, command.c_str(), command.size()) <= 0) {
+        closeDeviceLocked(device);
+        return false;
+    }
+    device->pendingCommands.push_back(command);
+    if (device->pendingCommands.size() > kMaxPendingCommands) {
+        device->pendingCommands.pop_front();
+    }
+    return true;
+}
+
+DeviceFileReader::Device* DeviceFileReader::openDeviceLocked(const std::string& deviceFilePath) {
+    Device& device = mDevices[deviceFilePath];
+    if (device.fd >= 0) {
+        return &device;
+    }
+
+    int fd = open(deviceFilePath.c_str(), O_RDWR | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    // Map entries are never erased, so the device can be handed to epoll by address.
+    struct epoll_event ev;
     memset(&ev, 0, sizeof(ev));
-    ev.data.fd = gnss_fd;
     ev.events = EPOLLIN;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, gnss_fd, &ev) == -1) {
-        close(gnss_fd);
-        close(epoll_fd);
-        return;
+    ev.data.ptr = &device;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        close(fd);
+        return nullptr;
     }
 
-    // Wait for device file event.
-    if (epoll_wait(epoll_fd, events, 1, mMinIntervalMs) == -1) {
-        close(gnss_fd);
-        close(epoll_fd);
+    device.fd = fd;
+    device.buffer.clear();
+    device.scanOffset = 0;
+    device.pendingCommands.clear();
+    return &device;
+}
+
+void DeviceFileReader::closeDeviceLocked(Device* device) {
+    if (device->fd < 0) {
         return;
     }
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, device->fd, nullptr);
+    close(device->fd);
+    device->fd = -1;
+}
 
-    // Handle event and write data to string buffer.
-    int bytes_read = -1;
-    std::string inputStr = "";
+void DeviceFileReader::readLoop() {
+    struct epoll_event events[kMaxEpollEvents];
     while (true) {
-        memset(inputBuffer, 0, INPUT_BUFFER_SIZE);
-        bytes_read = read(gnss_fd, &inputBuffer, INPUT_BUFFER_SIZE);
-        if (bytes_read <= 0) {
-            break;
+        int numEvents = epoll_wait(mEpollFd, events, kMaxEpollEvents, -1);
+        if (numEvents == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("Device file reader epoll_wait failed: %s", strerror(errno));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (int i = 0; i < numEvents; i++) {
+            if (events[i].data.ptr == nullptr) {
+                // Shutdown requested through the eventfd.
+                return;
+            }
+            readDeviceLocked(static_cast<Device*>(events[i].data.ptr));
         }
-        s_buffer_ += std::string(inputBuffer, bytes_read);
     }
-    close(gnss_fd);
-    close(epoll_fd);
+}
 
-    // Trim end of file mark(\n\n\n\n).
-    auto pos = s_buffer_.find("\n\n\n\n");
-    if (pos != std::string::npos) {
-        inputStr = s_buffer_.substr(0, pos);
-        s_buffer_ = s_buffer_.substr(pos + 4);
-    } else {
+void DeviceFileReader::readDeviceLocked(Device* device) {
+    // The device may have been closed after epoll_wait returned.
+    if (device->fd < 0) {
         return;
     }
 
-    // Cache the injected data.
-    if (command == CMD_GET_LOCATION) {
-        // TODO validate data
-        data_[CMD_GET_LOCATION] = inputStr;
-    } else if (command == CMD_GET_RAWMEASUREMENT) {
-        if (ReplayUtils::isGnssRawMeasurement(inputStr)) {
-            data_[CMD_GET_RAWMEASUREMENT] = inputStr;
+    // Drain the device straight into the tail of its buffer.
+    std::string& buffer = device->buffer;
+    while (true) {
+        size_t size = buffer.size();
+        buffer.resize(size + kReadChunkSize);
+        ssize_t bytesRead = read(device->fd, buffer.data() + size, kReadChunkSize);
+        int readErrno = errno;
+        buffer.resize(size + (bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0));
+        if (bytesRead > 0 || (bytesRead == -1 && readErrno == EINTR)) {
+            continue;
         }
+        if (bytesRead == 0 || readErrno != EAGAIN) {
+            // Reopened on the next request.
+            closeDeviceLocked(device);
+        }
+        break;
     }
-}
 
-std::string DeviceFileReader::getLocationData() {
-    std::unique_lock<std::mutex> lock(mMutex);
-    getDataFromDeviceFile(CMD_GET_LOCATION, 20);
-    return data_[CMD_GET_LOCATION];
-}
+    // Parse every complete record, only scanning bytes that have not been scanned before.
+    size_t consumed = 0;
+    while (true) {
+        size_t pos = buffer.find(kEndOfRecordMark, device->scanOffset);
+        if (pos == std::string::npos) {
+            size_t tail = buffer.size() >= kEndOfRecordMark.size() - 1
+                                  ? buffer.size() - (kEndOfRecordMark.size() - 1)
+                                  : 0;
+            device->scanOffset = std::max(consumed, tail);
+            break;
+        }
 
-std::string DeviceFileReader::getGnssRawMeasurementData() {
-    std::unique_lock<std::mutex> lock(mMutex);
-    getDataFromDeviceFile(CMD_GET_RAWMEASUREMENT, 20);
-    return data_[CMD_GET_RAWMEASUREMENT];
+        std::string_view record(buffer.data() + consumed, pos - consumed);
+        std::string command;
+        if (!device->pendingCommands.empty()) {
+            command = std::move(device->pendingCommands.front());
+            device->pendingCommands.pop_front();
+        } else {
+            command = ReplayUtils::isGnssRawMeasurement(std::string(record))
+                              ? CMD_GET_RAWMEASUREMENT
+                              : CMD_GET_LOCATION;
+        }
+        publishRecord(command, record);
+
+        consumed = pos + kEndOfRecordMark.size();
+        device->scanOffset = consumed;
+    }
+    buffer.erase(0, consumed);
+    device->scanOffset -= consumed;
 }
 
-DeviceFileReader::DeviceFileReader() {}
+void DeviceFileReader::publishRecord(const std::string& command, std::string_view record) {
+    Snapshot* snapshot = nullptr;
+    auto data = std::make_shared<const std::string>(record);
+    if (command == CMD_GET_LOCATION) {
+        // TODO validate data
+        snapshot = &mLocation;
+    } else if (command == CMD_GET_RAWMEASUREMENT) {
+        if (ReplayUtils::isGnssRawMeasurement(*data)) {
+            snapshot = &mRawMeasurement;
+        }
+    }
+    if (snapshot == nullptr) {
+        return;
+    }
 
-DeviceFileReader::~DeviceFileReader() {}
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotMutex);
+        snapshot->data.swap(data);
+        snapshot->generation++;
+    }
+    mPublishedCV.notify_all();
+}
 
 }  // namespace common
 }  // namespace gnss
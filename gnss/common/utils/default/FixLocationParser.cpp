@@ -34,14 +34,14 @@ std::unique_ptr<GnssLocation> FixLocationParser::getLocationFromInputStr(
     if (locationStr.empty()) {
         return nullptr;
     }
-    std::vector<std::string> locationStrRecords;
-    ParseUtils::splitStr(locationStr, LINE_SEPARATOR, locationStrRecords);
-    if (locationStrRecords.empty()) {
+    std::string_view input = locationStr;
+    std::string_view firstRecord;
+    if (!ParseUtils::nextLine(input, &firstRecord)) {
         return nullptr;
     }
 
-    std::vector<std::string> locationValues;
-    ParseUtils::splitStr(locationStrRecords[0], COMMA_SEPARATOR, locationValues);
+    std::vector<std::string_view> locationValues;
+    ParseUtils::splitStr(firstRecord, COMMA_SEPARATOR, locationValues);
     if (locationValues.size() < 12) {
         return nullptr;
     }
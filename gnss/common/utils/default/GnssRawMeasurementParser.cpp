@@ -16,6 +16,11 @@
 
 #include "GnssRawMeasurementParser.h"
 
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <mutex>
+
 namespace android {
 namespace hardware {
 namespace gnss {
@@ -31,101 +36,181 @@ using aidl::android::hardware::gnss::GnssSignalType;
 
 using ParseUtils = ::android::hardware::gnss::common::ParseUtils;
 
-std::unordered_map<std::string, int> GnssRawMeasurementParser::getColumnIdNameMappingFromHeader(
-        const std::string& header) {
-    std::vector<std::string> columnNames;
-    std::unordered_map<std::string, int> columnNameIdMapping;
-    std::string s = header;
-    // Trim left spaces
-    s.erase(s.begin(),
-            std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+namespace {
+
+using Column = GnssRawMeasurementParser::Column;
+using ColumnLayout = GnssRawMeasurementParser::ColumnLayout;
+
+// Header names of the required columns, indexed by Column.
+constexpr std::string_view kColumnNames[] = {"Raw",
+                                             "utcTimeMillis",
+                                             "TimeNanos",
+                                             "LeapSecond",
+                                             "TimeUncertaintyNanos",
+                                             "FullBiasNanos",
+                                             "BiasNanos",
+                                             "BiasUncertaintyNanos",
+                                             "DriftNanosPerSecond",
+                                             "DriftUncertaintyNanosPerSecond",
+                                             "HardwareClockDiscontinuityCount",
+                                             "Svid",
+                                             "TimeOffsetNanos",
+                                             "State",
+                                             "ReceivedSvTimeNanos",
+                                             "ReceivedSvTimeUncertaintyNanos",
+                                             "Cn0DbHz",
+                                             "PseudorangeRateMetersPerSecond",
+                                             "PseudorangeRateUncertaintyMetersPerSecond",
+                                             "AccumulatedDeltaRangeState",
+                                             "AccumulatedDeltaRangeMeters",
+                                             "AccumulatedDeltaRangeUncertaintyMeters",
+                                             "CarrierFrequencyHz",
+                                             "CarrierCycles",
+                                             "CarrierPhase",
+                                             "CarrierPhaseUncertainty",
+                                             "MultipathIndicator",
+                                             "SnrInDb",
+                                             "ConstellationType",
+                                             "AgcDb",
+                                             "BasebandCn0DbHz",
+                                             "FullInterSignalBiasNanos",
+                                             "FullInterSignalBiasUncertaintyNanos",
+                                             "SatelliteInterSignalBiasNanos",
+                                             "SatelliteInterSignalBiasUncertaintyNanos",
+                                             "CodeType",
+                                             "ChipsetElapsedRealtimeNanos"};
+static_assert(std::size(kColumnNames) == GnssRawMeasurementParser::NUM_COLUMNS,
+              "every column needs a header name");
+
+/**
+ * Returns the layout of |header|, only compiling it when the header differs from the previous
+ * call. Every record of a capture shares the same header, so this is normally a comparison.
+ */
+bool getCachedColumnLayout(std::string_view header, ColumnLayout* columns) {
+    static std::mutex sMutex;
+    static std::string sHeader;
+    static ColumnLayout sColumns;
+    static bool sValid = false;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (sHeader.empty() || header != sHeader) {
+        sHeader = header;
+        sValid = GnssRawMeasurementParser::getColumnLayoutFromHeader(header, &sColumns);
+    }
+    if (!sValid) {
+        return false;
+    }
+    *columns = sColumns;
+    return true;
+}
+
+}  // namespace
+
+bool GnssRawMeasurementParser::getColumnLayoutFromHeader(std::string_view header,
+                                                         ColumnLayout* columns) {
+    // Remove the comment symbol, the header starts from `Raw`.
+    size_t start = header.find(kColumnNames[RAW]);
+    if (start == std::string_view::npos) {
+        ALOGE("Missing column %s in header.", kColumnNames[RAW].data());
+        return false;
+    }
+    header.remove_prefix(start);
     // Trim right spaces
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); })
-                    .base(),
-            s.end());
-    // Remove comment symbol, start from `Raw`.
-    s = s.substr(s.find("Raw"));
+    while (!header.empty() && std::isspace(static_cast<unsigned char>(header.back()))) {
+        header.remove_suffix(1);
+    }
 
-    ParseUtils::splitStr(s, COMMA_SEPARATOR, columnNames);
-    int columnId = 0;
-    for (auto& name : columnNames) {
-        columnNameIdMapping[name] = columnId++;
+    std::vector<std::string_view> columnNames;
+    ParseUtils::splitStr(header, COMMA_SEPARATOR, columnNames);
+    columns->index.fill(-1);
+    for (size_t columnId = 0; columnId < columnNames.size(); columnId++) {
+        auto name = std::find(std::begin(kColumnNames), std::end(kColumnNames),
+                              columnNames[columnId]);
+        if (name != std::end(kColumnNames)) {
+            columns->index[name - std::begin(kColumnNames)] = static_cast<int>(columnId);
+        }
     }
 
-    return columnNameIdMapping;
+    columns->minRecordSize = 0;
+    for (int column = 0; column < NUM_COLUMNS; column++) {
+        if (columns->index[column] < 0) {
+            ALOGE("Missing column %s in header.", kColumnNames[column].data());
+            return false;
+        }
+        columns->minRecordSize =
+                std::max(columns->minRecordSize, static_cast<size_t>(columns->index[column]) + 1);
+    }
+    return true;
 }
 
 int GnssRawMeasurementParser::getClockFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columns) {
     int clockFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("LeapSecond")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, LEAP_SECOND).empty()) {
         clockFlags |= GnssClock::HAS_LEAP_SECOND;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullBiasNanos")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, FULL_BIAS_NANOS).empty()) {
         clockFlags |= GnssClock::HAS_FULL_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasNanos")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, BIAS_NANOS).empty()) {
         clockFlags |= GnssClock::HAS_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, BIAS_UNCERTAINTY_NANOS).empty()) {
         clockFlags |= GnssClock::HAS_BIAS_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, DRIFT_NANOS_PER_SECOND).empty()) {
         clockFlags |= GnssClock::HAS_DRIFT;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftUncertaintyNanosPerSecond")]
-                 .empty()) {
+    if (!columns.get(rawMeasurementRecordValues, DRIFT_UNCERTAINTY_NANOS_PER_SECOND).empty()) {
         clockFlags |= GnssClock::HAS_DRIFT_UNCERTAINTY;
     }
     return clockFlags;
 }
 
 int GnssRawMeasurementParser::getElapsedRealtimeFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columns) {
     int elapsedRealtimeFlags = ElapsedRealtime::HAS_TIMESTAMP_NS;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, TIME_UNCERTAINTY_NANOS).empty()) {
         elapsedRealtimeFlags |= ElapsedRealtime::HAS_TIME_UNCERTAINTY_NS;
     }
     return elapsedRealtimeFlags;
 }
 
 int GnssRawMeasurementParser::getRawMeasurementFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const ColumnLayout& columns) {
     int rawMeasurementFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SnrInDb")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, SNR_IN_DB).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SNR;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierFrequencyHz")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, CARRIER_FREQUENCY_HZ).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_FREQUENCY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierCycles")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, CARRIER_CYCLES).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_CYCLES;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhase")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, CARRIER_PHASE).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhaseUncertainty")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, CARRIER_PHASE_UNCERTAINTY).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("AgcDb")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, AGC_DB).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasNanos")].empty()) {
+    if (!columns.get(rawMeasurementRecordValues, FULL_INTER_SIGNAL_BIAS_NANOS).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasUncertaintyNanos")]
+    if (!columns.get(rawMeasurementRecordValues, FULL_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS)
                  .empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SatelliteInterSignalBiasNanos")]
-                 .empty()) {
+    if (!columns.get(rawMeasurementRecordValues, SATELLITE_INTER_SIGNAL_BIAS_NANOS).empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at(
-                                            "SatelliteInterSignalBiasUncertaintyNanos")]
+    if (!columns.get(rawMeasurementRecordValues, SATELLITE_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS)
                  .empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB_UNCERTAINTY;
     }
@@ -165,7 +250,7 @@ GnssConstellationType GnssRawMeasurementParser::getGnssConstellationType(int con
 }
 
 std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
-        std::string& rawMeasurementStr) {
+        const std::string& rawMeasurementStr) {
     /*
      * Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,
      * BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,
@@ -179,124 +264,110 @@ std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
      * SatelliteInterSignalBiasUncertaintyNanos,CodeType,ChipsetElapsedRealtimeNanos
      */
     ALOGD("Parsing %zu bytes rawMeasurementStr.", rawMeasurementStr.size());
-    if (rawMeasurementStr.empty()) {
-        return nullptr;
-    }
-    std::vector<std::string> rawMeasurementStrRecords;
-    ParseUtils::splitStr(rawMeasurementStr, LINE_SEPARATOR, rawMeasurementStrRecords);
-    if (rawMeasurementStrRecords.size() <= 1) {
+    std::string_view input = rawMeasurementStr;
+    std::string_view header;
+    std::string_view record;
+    if (!ParseUtils::nextLine(input, &header) || input.empty()) {
         ALOGE("Raw GNSS Measurements parser failed. (No records) ");
         return nullptr;
     }
 
-    // Get the column name mapping from the header.
-    std::unordered_map<std::string, int> columnNameIdMapping =
-            getColumnIdNameMappingFromHeader(rawMeasurementStrRecords[0]);
-
-    if (columnNameIdMapping.size() < 37 || !ParseUtils::isValidHeader(columnNameIdMapping)) {
+    // Get the column layout from the header.
+    ColumnLayout columns;
+    if (!getCachedColumnLayout(header, &columns)) {
         ALOGE("Raw GNSS Measurements parser failed. (No header or missing columns.) ");
         return nullptr;
     }
 
-    // Set GnssClock from 1st record.
-    std::size_t pointer = 1;
-    std::vector<std::string> firstRecordValues;
-    ParseUtils::splitStr(rawMeasurementStrRecords[pointer], COMMA_SEPARATOR, firstRecordValues);
-    GnssClock clock = {
-            .gnssClockFlags = getClockFlags(firstRecordValues, columnNameIdMapping),
-            .timeNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("TimeNanos")], 0),
-            .fullBiasNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("FullBiasNanos")], 0),
-            .biasNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasNanos")], 0),
-            .biasUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")], 0),
-            .driftNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .driftUncertaintyNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .hwClockDiscontinuityCount = ParseUtils::tryParseInt(
-                    firstRecordValues[columnNameIdMapping.at("HardwareClockDiscontinuityCount")],
-                    0)};
+    // Records are split into views of |rawMeasurementStr|, reusing the same vector.
+    std::vector<std::string_view> values;
+    values.reserve(columns.minRecordSize);
+    std::vector<GnssMeasurement> measurementsVec;
+    measurementsVec.reserve(std::count(input.begin(), input.end(), LINE_SEPARATOR) + 1);
+    GnssClock clock;
+    ElapsedRealtime timestamp;
+    while (ParseUtils::nextLine(input, &record)) {
+        ParseUtils::splitStr(record, COMMA_SEPARATOR, values);
+        if (values.size() < columns.minRecordSize ||
+            columns.get(values, RAW) != kColumnNames[RAW]) {
+            ALOGW("Skipping malformed raw measurement record.");
+            continue;
+        }
 
-    ElapsedRealtime timestamp = {
-            .flags = getElapsedRealtimeFlags(firstRecordValues, columnNameIdMapping),
-            .timestampNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("ChipsetElapsedRealtimeNanos")]),
-            .timeUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")], 0)};
+        // Set GnssClock from 1st record.
+        if (measurementsVec.empty()) {
+            clock = {
+                    .gnssClockFlags = getClockFlags(values, columns),
+                    .timeNs = ParseUtils::tryParseLongLong(columns.get(values, TIME_NANOS), 0),
+                    .fullBiasNs =
+                            ParseUtils::tryParseLongLong(columns.get(values, FULL_BIAS_NANOS), 0),
+                    .biasNs = ParseUtils::tryParseDouble(columns.get(values, BIAS_NANOS), 0),
+                    .biasUncertaintyNs = ParseUtils::tryParseDouble(
+                            columns.get(values, BIAS_UNCERTAINTY_NANOS), 0),
+                    .driftNsps = ParseUtils::tryParseDouble(
+                            columns.get(values, DRIFT_NANOS_PER_SECOND), 0),
+                    .driftUncertaintyNsps = ParseUtils::tryParseDouble(
+                            columns.get(values, DRIFT_UNCERTAINTY_NANOS_PER_SECOND), 0),
+                    .hwClockDiscontinuityCount = ParseUtils::tryParseInt(
+                            columns.get(values, HARDWARE_CLOCK_DISCONTINUITY_COUNT), 0)};
+
+            timestamp = {.flags = getElapsedRealtimeFlags(values, columns),
+                         .timestampNs = ParseUtils::tryParseLongLong(
+                                 columns.get(values, CHIPSET_ELAPSED_REALTIME_NANOS)),
+                         .timeUncertaintyNs = ParseUtils::tryParseDouble(
+                                 columns.get(values, TIME_UNCERTAINTY_NANOS), 0)};
+        }
 
-    std::vector<GnssMeasurement> measurementsVec;
-    for (pointer = 1; pointer < rawMeasurementStrRecords.size(); pointer++) {
-        std::vector<std::string> rawMeasurementValues;
-        std::string line = rawMeasurementStrRecords[pointer];
-        ParseUtils::splitStr(line, COMMA_SEPARATOR, rawMeasurementValues);
         GnssSignalType signalType = {
-                .constellation = getGnssConstellationType(ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("ConstellationType")], 0)),
-                .carrierFrequencyHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("CarrierFrequencyHz")], 0),
-                .codeType = rawMeasurementValues[columnNameIdMapping.at("CodeType")],
+                .constellation = getGnssConstellationType(
+                        ParseUtils::tryParseInt(columns.get(values, CONSTELLATION_TYPE), 0)),
+                .carrierFrequencyHz =
+                        ParseUtils::tryParseDouble(columns.get(values, CARRIER_FREQUENCY_HZ), 0),
+                .codeType = std::string(columns.get(values, CODE_TYPE)),
         };
-        GnssMeasurement measurement = {
-                .flags = getRawMeasurementFlags(rawMeasurementValues, columnNameIdMapping),
-                .svid = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("Svid")], 0),
-                .signalType = signalType,
-                .receivedSvTimeInNs = ParseUtils::tryParseLongLong(
-                        rawMeasurementValues[columnNameIdMapping.at("ReceivedSvTimeNanos")], 0),
-                .receivedSvTimeUncertaintyInNs =
-                        ParseUtils::tryParseLongLong(rawMeasurementValues[columnNameIdMapping.at(
-                                                             "ReceivedSvTimeUncertaintyNanos")],
-                                                     0),
-                .antennaCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("Cn0DbHz")], 0),
-                .basebandCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("BasebandCn0DbHz")], 0),
-                .agcLevelDb = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AgcDb")], 0),
-                .pseudorangeRateMps =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "PseudorangeRateMetersPerSecond")],
-                                                   0),
+        measurementsVec.push_back({
+                .flags = getRawMeasurementFlags(values, columns),
+                .svid = ParseUtils::tryParseInt(columns.get(values, SVID), 0),
+                .signalType = std::move(signalType),
+                .receivedSvTimeInNs =
+                        ParseUtils::tryParseLongLong(columns.get(values, RECEIVED_SV_TIME_NANOS), 0),
+                .receivedSvTimeUncertaintyInNs = ParseUtils::tryParseLongLong(
+                        columns.get(values, RECEIVED_SV_TIME_UNCERTAINTY_NANOS), 0),
+                .antennaCN0DbHz = ParseUtils::tryParseDouble(columns.get(values, CN0_DB_HZ), 0),
+                .basebandCN0DbHz =
+                        ParseUtils::tryParseDouble(columns.get(values, BASEBAND_CN0_DB_HZ), 0),
+                .agcLevelDb = ParseUtils::tryParseDouble(columns.get(values, AGC_DB), 0),
+                .pseudorangeRateMps = ParseUtils::tryParseDouble(
+                        columns.get(values, PSEUDORANGE_RATE_METERS_PER_SECOND), 0),
                 .pseudorangeRateUncertaintyMps = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "PseudorangeRateUncertaintyMetersPerSecond")],
-                        0),
+                        columns.get(values, PSEUDORANGE_RATE_UNCERTAINTY_METERS_PER_SECOND), 0),
                 .accumulatedDeltaRangeState = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeState")],
-                        0),
+                        columns.get(values, ACCUMULATED_DELTA_RANGE_STATE), 0),
                 .accumulatedDeltaRangeM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeMeters")],
-                        0),
+                        columns.get(values, ACCUMULATED_DELTA_RANGE_METERS), 0),
                 .accumulatedDeltaRangeUncertaintyM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "AccumulatedDeltaRangeUncertaintyMeters")],
-                        0),
+                        columns.get(values, ACCUMULATED_DELTA_RANGE_UNCERTAINTY_METERS), 0),
                 .multipathIndicator = GnssMultipathIndicator::UNKNOWN,  // Not in GnssLogger yet.
-                .state = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("State")], 0),
-                .fullInterSignalBiasNs = ParseUtils::tryParseDouble(rawMeasurementValues[31], 0),
+                .state = ParseUtils::tryParseInt(columns.get(values, STATE), 0),
+                .fullInterSignalBiasNs = ParseUtils::tryParseDouble(
+                        columns.get(values, FULL_INTER_SIGNAL_BIAS_NANOS), 0),
                 .fullInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("FullInterSignalBiasNanos")],
-                        0),
-                .satelliteInterSignalBiasNs =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "SatelliteInterSignalBiasNanos")],
-                                                   0),
+                        columns.get(values, FULL_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS), 0),
+                .satelliteInterSignalBiasNs = ParseUtils::tryParseDouble(
+                        columns.get(values, SATELLITE_INTER_SIGNAL_BIAS_NANOS), 0),
                 .satelliteInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "SatelliteInterSignalBiasUncertaintyNanos")],
-                        0),
+                        columns.get(values, SATELLITE_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS), 0),
                 .satellitePvt = {},
-                .correlationVectors = {}};
-        measurementsVec.push_back(measurement);
+                .correlationVectors = {}});
+    }
+    if (measurementsVec.empty()) {
+        ALOGE("Raw GNSS Measurements parser failed. (No records) ");
+        return nullptr;
     }
 
-    GnssData gnssData = {
-            .measurements = measurementsVec, .clock = clock, .elapsedRealtime = timestamp};
-    return std::make_unique<GnssData>(gnssData);
+    return std::make_unique<GnssData>(GnssData{.measurements = std::move(measurementsVec),
+                                               .clock = clock,
+                                               .elapsedRealtime = timestamp});
 }
 
 }  // namespace common
@@ -18,14 +18,16 @@
 
 #include <Constants.h>
 #include <NmeaFixInfo.h>
+#include <ParseUtils.h>
 #include <Utils.h>
 #include <log/log.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <utils/SystemClock.h>
+#include <charconv>
+#include <cstring>
 #include <limits>
-#include <sstream>
 #include <string>
 #include <vector>
 
@@ -43,11 +45,8 @@ float NmeaFixInfo::getAltitudeMeters() const {
     return altitudeMeters;
 }
 
-float NmeaFixInfo::checkAndConvertToFloat(const std::string& sentence) {
-    if (sentence.empty()) {
-        return std::numeric_limits<float>::quiet_NaN();
-    }
-    return std::stof(sentence);
+float NmeaFixInfo::checkAndConvertToFloat(std::string_view sentence) {
+    return ParseUtils::tryParsefloat(sentence, std::numeric_limits<float>::quiet_NaN());
 }
 
 float NmeaFixInfo::getBearingAccuracyDegrees() const {
@@ -89,7 +88,7 @@ float NmeaFixInfo::getVerticalAccuracyMeters() const {
     return kMockVerticalAccuracyMeters;
 }
 
-int64_t NmeaFixInfo::nmeaPartsToTimestamp(const std::string& timeStr, const std::string& dateStr) {
+int64_t NmeaFixInfo::nmeaPartsToTimestamp(std::string_view timeStr, std::string_view dateStr) {
     /**
      * In NMEA format, the full time can only get from the $GPRMC record, see
      * the following example:
@@ -98,14 +97,17 @@ int64_t NmeaFixInfo::nmeaPartsToTimestamp(const std::string& timeStr, const std:
      * 2019/08/29 21:32:04, however for in unix the year starts from 1900, we
      * need to add the offset.
      */
-    struct tm tm;
+    if (timeStr.size() < 6 || dateStr.size() < 6) {
+        return -1;
+    }
+    struct tm tm = {};
     const int32_t unixYearOffset = 100;
-    tm.tm_mday = std::stoi(dateStr.substr(0, 2).c_str());
-    tm.tm_mon = std::stoi(dateStr.substr(2, 2).c_str()) - 1;
-    tm.tm_year = std::stoi(dateStr.substr(4, 2).c_str()) + unixYearOffset;
-    tm.tm_hour = std::stoi(timeStr.substr(0, 2).c_str());
-    tm.tm_min = std::stoi(timeStr.substr(2, 2).c_str());
-    tm.tm_sec = std::stoi(timeStr.substr(4, 2).c_str());
+    tm.tm_mday = ParseUtils::tryParseInt(dateStr.substr(0, 2));
+    tm.tm_mon = ParseUtils::tryParseInt(dateStr.substr(2, 2)) - 1;
+    tm.tm_year = ParseUtils::tryParseInt(dateStr.substr(4, 2)) + unixYearOffset;
+    tm.tm_hour = ParseUtils::tryParseInt(timeStr.substr(0, 2));
+    tm.tm_min = ParseUtils::tryParseInt(timeStr.substr(2, 2));
+    tm.tm_sec = ParseUtils::tryParseInt(timeStr.substr(4, 2));
     return static_cast<int64_t>(mktime(&tm) - timezone);
 }
 
@@ -113,38 +115,42 @@ bool NmeaFixInfo::isValidFix() const {
     return hasGMCRecord && hasGGARecord;
 }
 
-void NmeaFixInfo::parseGGALine(const std::vector<std::string>& sentenceValues) {
-    if (sentenceValues.size() == 0 || sentenceValues[0].compare(GPGA_RECORD_TAG) != 0) {
+void NmeaFixInfo::parseGGALine(const std::vector<std::string_view>& sentenceValues) {
+    if (sentenceValues.size() < MIN_COL_NUM || sentenceValues[0] != GPGA_RECORD_TAG ||
+        sentenceValues[2].size() < 2 || sentenceValues[4].size() < 3) {
         return;
     }
     // LatDeg, need covert to degree, if it is 'N', should be negative value
-    this->latDeg = std::stof(sentenceValues[2].substr(0, 2)) +
-                   (std::stof(sentenceValues[2].substr(2)) / 60.0);
-    if (sentenceValues[3].compare("N") != 0) {
+    this->latDeg = ParseUtils::tryParsefloat(sentenceValues[2].substr(0, 2)) +
+                   (ParseUtils::tryParsefloat(sentenceValues[2].substr(2)) / 60.0);
+    if (sentenceValues[3] != "N") {
         this->latDeg *= -1;
     }
 
     // LngDeg, need covert to degree, if it is 'E', should be negative value
-    this->lngDeg = std::stof(sentenceValues[4].substr(0, 3)) +
-                   std::stof(sentenceValues[4].substr(3)) / 60.0;
-    if (sentenceValues[5].compare("E") != 0) {
+    this->lngDeg = ParseUtils::tryParsefloat(sentenceValues[4].substr(0, 3)) +
+                   ParseUtils::tryParsefloat(sentenceValues[4].substr(3)) / 60.0;
+    if (sentenceValues[5] != "E") {
         this->lngDeg *= -1;
     }
 
-    this->altitudeMeters = std::stof(sentenceValues[9]);
+    this->altitudeMeters = ParseUtils::tryParsefloat(sentenceValues[9]);
 
-    this->hDop = sentenceValues[8].empty() ? std::numeric_limits<float>::quiet_NaN()
-                                           : std::stof(sentenceValues[8]);
+    this->hDop = checkAndConvertToFloat(sentenceValues[8]);
     this->hasGGARecord = true;
 }
 
-void NmeaFixInfo::parseRMCLine(const std::vector<std::string>& sentenceValues) {
-    if (sentenceValues.size() == 0 || sentenceValues[0].compare(GPRMC_RECORD_TAG) != 0) {
+void NmeaFixInfo::parseRMCLine(const std::vector<std::string_view>& sentenceValues) {
+    if (sentenceValues.size() < MIN_COL_NUM || sentenceValues[0] != GPRMC_RECORD_TAG) {
+        return;
+    }
+    int64_t timestamp = nmeaPartsToTimestamp(sentenceValues[1], sentenceValues[9]);
+    if (timestamp < 0) {
         return;
     }
     this->speedMetersPerSec = checkAndConvertToFloat(sentenceValues[7]);
     this->bearingDegrees = checkAndConvertToFloat(sentenceValues[8]);
-    this->timestamp = nmeaPartsToTimestamp(sentenceValues[1], sentenceValues[9]);
+    this->timestamp = timestamp;
     this->hasGMCRecord = true;
 }
 
@@ -164,13 +170,32 @@ void NmeaFixInfo::reset() {
     this->timestamp = 0;
 }
 
-void NmeaFixInfo::splitStr(const std::string& line, const char& delimiter,
-                           std::vector<std::string>& out) {
-    std::istringstream iss(line);
-    std::string item;
-    while (std::getline(iss, item, delimiter)) {
-        out.push_back(item);
+/**
+ * Strips the "*hh" suffix off |sentence| after checking it against the XOR of every character
+ * between the leading '$' and the '*'. Sentences without a checksum are accepted unchanged.
+ */
+bool NmeaFixInfo::stripAndValidateChecksum(std::string_view* sentence) {
+    size_t checksumPos = sentence->rfind('*');
+    if (checksumPos == std::string_view::npos) {
+        return true;
     }
+    std::string_view checksumStr = sentence->substr(checksumPos + 1);
+    unsigned int expected;
+    auto [ptr, ec] = std::from_chars(checksumStr.data(), checksumStr.data() + checksumStr.size(),
+                                     expected, 16);
+    if (checksumStr.size() != 2 || ec != std::errc() ||
+        ptr != checksumStr.data() + checksumStr.size()) {
+        return false;
+    }
+    unsigned int checksum = 0;
+    for (size_t i = 1; i < checksumPos; i++) {
+        checksum ^= static_cast<unsigned char>((*sentence)[i]);
+    }
+    if (checksum != expected) {
+        return false;
+    }
+    sentence->remove_suffix(sentence->size() - checksumPos);
+    return true;
 }
 
 NmeaFixInfo& NmeaFixInfo::operator=(const NmeaFixInfo& rhs) {
@@ -198,23 +223,29 @@ NmeaFixInfo& NmeaFixInfo::operator=(const NmeaFixInfo& rhs) {
  */
 std::unique_ptr<V2_0::GnssLocation> NmeaFixInfo::getLocationFromInputStr(
         const std::string& inputStr) {
-    std::vector<std::string> nmeaRecords;
-    splitStr(inputStr, LINE_SEPARATOR, nmeaRecords);
+    std::string_view input = inputStr;
+    std::string_view line;
+    // Reused for every sentence so that splitting does not allocate once it has grown.
+    std::vector<std::string_view> sentenceValues;
     NmeaFixInfo nmeaFixInfo;
     NmeaFixInfo candidateFixInfo;
     uint32_t fixId = 0;
     double lastTimeStamp = 0;
-    for (const auto& line : nmeaRecords) {
-        if (line.compare(0, strlen(GPGA_RECORD_TAG), GPGA_RECORD_TAG) != 0 &&
-            line.compare(0, strlen(GPRMC_RECORD_TAG), GPRMC_RECORD_TAG) != 0) {
+    while (ParseUtils::nextLine(input, &line)) {
+        bool isGGA = line.substr(0, strlen(GPGA_RECORD_TAG)) == GPGA_RECORD_TAG;
+        bool isRMC = line.substr(0, strlen(GPRMC_RECORD_TAG)) == GPRMC_RECORD_TAG;
+        if (!isGGA && !isRMC) {
+            continue;
+        }
+        if (!stripAndValidateChecksum(&line)) {
+            ALOGW("Dropping NMEA sentence with a bad checksum.");
             continue;
         }
-        std::vector<std::string> sentenceValues;
-        splitStr(line, COMMA_SEPARATOR, sentenceValues);
+        ParseUtils::splitStr(line, COMMA_SEPARATOR, sentenceValues);
         if (sentenceValues.size() < MIN_COL_NUM) {
             continue;
         }
-        double currentTimeStamp = std::stof(sentenceValues[1]);
+        double currentTimeStamp = ParseUtils::tryParseDouble(sentenceValues[1]);
         // If see a new timestamp, report correct location.
         if ((currentTimeStamp - lastTimeStamp) > TIMESTAMP_EPSILON &&
             candidateFixInfo.isValidFix()) {
@@ -222,10 +253,10 @@ std::unique_ptr<V2_0::GnssLocation> NmeaFixInfo::getLocationFromInputStr(
             candidateFixInfo.reset();
             fixId++;
         }
-        if (line.compare(0, strlen(GPGA_RECORD_TAG), GPGA_RECORD_TAG) == 0) {
+        if (isGGA) {
             candidateFixInfo.fixId = fixId;
             candidateFixInfo.parseGGALine(sentenceValues);
-        } else if (line.compare(0, strlen(GPRMC_RECORD_TAG), GPRMC_RECORD_TAG) == 0) {
+        } else {
             candidateFixInfo.parseRMCLine(sentenceValues);
         }
     }
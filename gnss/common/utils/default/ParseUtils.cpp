@@ -15,110 +15,102 @@
  */
 
 #include <ParseUtils.h>
-#include <sstream>
-#include <stdexcept>
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "Constants.h"
 
 namespace android {
 namespace hardware {
 namespace gnss {
 namespace common {
 
-int ParseUtils::tryParseInt(const std::string& s, int defaultVal) {
-    if (s.empty()) {
+namespace {
+
+// Longest numeric field accepted by the floating point parsers.
+constexpr size_t kMaxFloatingLength = 63;
+
+template <typename T>
+T parseIntegral(std::string_view s, T defaultVal) {
+    T value;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || ptr == s.data()) {
         return defaultVal;
-    } else {
-        return std::stoi(s);
     }
+    return value;
 }
 
-float ParseUtils::tryParsefloat(const std::string& s, float defaultVal) {
-    if (s.empty()) {
+template <typename T>
+T parseFloating(std::string_view s, T defaultVal) {
+    // Floating point std::from_chars is not available in every libc++ this library is built
+    // against, so parse a NUL terminated copy on the stack instead.
+    if (s.empty() || s.size() > kMaxFloatingLength) {
         return defaultVal;
+    }
+    char buffer[kMaxFloatingLength + 1];
+    memcpy(buffer, s.data(), s.size());
+    buffer[s.size()] = '\0';
+    char* end;
+    T value;
+    if constexpr (std::is_same_v<T, float>) {
+        value = strtof(buffer, &end);
     } else {
-        return std::stof(s);
+        value = strtod(buffer, &end);
     }
+    return end == buffer ? defaultVal : value;
 }
 
-double ParseUtils::tryParseDouble(const std::string& s, double defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stod(s);
-    }
+}  // namespace
+
+int ParseUtils::tryParseInt(std::string_view s, int defaultVal) {
+    return parseIntegral(s, defaultVal);
 }
 
-long ParseUtils::tryParseLong(const std::string& s, long defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stol(s);
-    }
+float ParseUtils::tryParsefloat(std::string_view s, float defaultVal) {
+    return parseFloating(s, defaultVal);
 }
 
-long long ParseUtils::tryParseLongLong(const std::string& s, long long defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stoll(s);
-    }
+double ParseUtils::tryParseDouble(std::string_view s, double defaultVal) {
+    return parseFloating(s, defaultVal);
 }
 
-void ParseUtils::splitStr(const std::string& line, const char& delimiter,
-                          std::vector<std::string>& out) {
-    std::istringstream iss(line);
-    std::string item;
-    while (std::getline(iss, item, delimiter)) {
-        out.push_back(item);
-    }
+long ParseUtils::tryParseLong(std::string_view s, long defaultVal) {
+    return parseIntegral(s, defaultVal);
 }
 
-bool ParseUtils::isValidHeader(const std::unordered_map<std::string, int>& columnNameIdMapping) {
-    std::vector<std::string> requiredHeaderColumns = {"Raw",
-                                                      "utcTimeMillis",
-                                                      "TimeNanos",
-                                                      "LeapSecond",
-                                                      "TimeUncertaintyNanos",
-                                                      "FullBiasNanos",
-                                                      "BiasNanos",
-                                                      "BiasUncertaintyNanos",
-                                                      "DriftNanosPerSecond",
-                                                      "DriftUncertaintyNanosPerSecond",
-                                                      "HardwareClockDiscontinuityCount",
-                                                      "Svid",
-                                                      "TimeOffsetNanos",
-                                                      "State",
-                                                      "ReceivedSvTimeNanos",
-                                                      "ReceivedSvTimeUncertaintyNanos",
-                                                      "Cn0DbHz",
-                                                      "PseudorangeRateMetersPerSecond",
-                                                      "PseudorangeRateUncertaintyMetersPerSecond",
-                                                      "AccumulatedDeltaRangeState",
-                                                      "AccumulatedDeltaRangeMeters",
-                                                      "AccumulatedDeltaRangeUncertaintyMeters",
-                                                      "CarrierFrequencyHz",
-                                                      "CarrierCycles",
-                                                      "CarrierPhase",
-                                                      "CarrierPhaseUncertainty",
-                                                      "MultipathIndicator",
-                                                      "SnrInDb",
-                                                      "ConstellationType",
-                                                      "AgcDb",
-                                                      "BasebandCn0DbHz",
-                                                      "FullInterSignalBiasNanos",
-                                                      "FullInterSignalBiasUncertaintyNanos",
-                                                      "SatelliteInterSignalBiasNanos",
-                                                      "SatelliteInterSignalBiasUncertaintyNanos",
-                                                      "CodeType",
-                                                      "ChipsetElapsedRealtimeNanos"};
-
-    for (const auto& columnName : requiredHeaderColumns) {
-        if (columnNameIdMapping.find(columnName) == columnNameIdMapping.end()) {
-            ALOGE("Missing column %s in header.", columnName.c_str());
-            return false;
+long long ParseUtils::tryParseLongLong(std::string_view s, long long defaultVal) {
+    return parseIntegral(s, defaultVal);
+}
+
+void ParseUtils::splitStr(std::string_view line, char delimiter,
+                          std::vector<std::string_view>& out) {
+    out.clear();
+    while (true) {
+        size_t pos = line.find(delimiter);
+        out.push_back(line.substr(0, pos));
+        if (pos == std::string_view::npos) {
+            return;
         }
+        line.remove_prefix(pos + 1);
     }
+}
 
-    return true;
+bool ParseUtils::nextLine(std::string_view& input, std::string_view* line) {
+    while (!input.empty()) {
+        size_t pos = input.find(LINE_SEPARATOR);
+        *line = input.substr(0, pos);
+        input.remove_prefix(pos == std::string_view::npos ? input.size() : pos + 1);
+        if (!line->empty() && line->back() == '\r') {
+            line->remove_suffix(1);
+        }
+        if (!line->empty()) {
+            return true;
+        }
+    }
+    return false;
 }
 
 }  // namespace common
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <GnssRawMeasurementParser.h>
+#include <NmeaFixInfo.h>
+
+#include <cstdio>
+#include <string>
+
+using ::android::hardware::gnss::common::GnssRawMeasurementParser;
+using ::android::hardware::gnss::common::NmeaFixInfo;
+using ::benchmark::State;
+
+namespace {
+
+constexpr char kRawHeader[] =
+        "# Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,"
+        "BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,"
+        "HardwareClockDiscontinuityCount,Svid,TimeOffsetNanos,State,ReceivedSvTimeNanos,"
+        "ReceivedSvTimeUncertaintyNanos,Cn0DbHz,PseudorangeRateMetersPerSecond,"
+        "PseudorangeRateUncertaintyMetersPerSecond,AccumulatedDeltaRangeState,"
+        "AccumulatedDeltaRangeMeters,AccumulatedDeltaRangeUncertaintyMeters,CarrierFrequencyHz,"
+        "CarrierCycles,CarrierPhase,CarrierPhaseUncertainty,MultipathIndicator,SnrInDb,"
+        "ConstellationType,AgcDb,BasebandCn0DbHz,FullInterSignalBiasNanos,"
+        "FullInterSignalBiasUncertaintyNanos,SatelliteInterSignalBiasNanos,"
+        "SatelliteInterSignalBiasUncertaintyNanos,CodeType,ChipsetElapsedRealtimeNanos\n";
+
+// Builds a GnssLogger capture of |numRecords| raw measurement records.
+std::string makeRawCapture(int64_t numRecords) {
+    std::string capture = kRawHeader;
+    char record[512];
+    for (int64_t i = 0; i < numRecords; i++) {
+        snprintf(record, sizeof(record),
+                 "Raw,%lld,%lld,18,,-1300000000000000000,0.5,10.0,1.2,2.3,0,%lld,0.0,16431,"
+                 "%lld,20,%.2f,-500.25,0.05,16,10000.5,0.01,1575420030,,,,0,,1,2.5,%.2f,,,,,C,"
+                 "%lld\n",
+                 static_cast<long long>(1633026411000 + i / 32),
+                 static_cast<long long>(3000000000 + i * 1000), static_cast<long long>(i % 32 + 1),
+                 static_cast<long long>(123456789012 + i), 20.0 + (i % 30),
+                 18.0 + (i % 30), static_cast<long long>(1234567890123 + i * 1000));
+        capture += record;
+    }
+    return capture;
+}
+
+// Appends |body| as a full NMEA sentence, including its checksum.
+void appendNmeaSentence(const char* body, std::string* capture) {
+    unsigned int checksum = 0;
+    for (const char* c = body; *c != '\0'; c++) {
+        checksum ^= static_cast<unsigned char>(*c);
+    }
+    char suffix[8];
+    snprintf(suffix, sizeof(suffix), "*%02X\n", checksum);
+    *capture += '$';
+    *capture += body;
+    *capture += suffix;
+}
+
+// Builds an NMEA capture of |numFixes| $GPGGA/$GPRMC pairs.
+std::string makeNmeaCapture(int64_t numFixes) {
+    std::string capture;
+    char body[256];
+    for (int64_t i = 0; i < numFixes; i++) {
+        int hour = static_cast<int>(i / 3600 % 24);
+        int min = static_cast<int>(i / 60 % 60);
+        int sec = static_cast<int>(i % 60);
+        snprintf(body, sizeof(body),
+                 "GPGGA,%02d%02d%02d.00,3725.371240,N,12205.589239,W,1,12,0.9,10.5,M,-25.7,M,,",
+                 hour, min, sec);
+        appendNmeaSentence(body, &capture);
+        snprintf(body, sizeof(body),
+                 "GPRMC,%02d%02d%02d.00,A,3725.371240,N,12205.589239,W,000.0,000.0,290819,,,A",
+                 hour, min, sec);
+        appendNmeaSentence(body, &capture);
+    }
+    return capture;
+}
+
+void BM_ParseRawMeasurements(State& state) {
+    const std::string capture = makeRawCapture(state.range(0));
+    for (auto _ : state) {
+        auto data = GnssRawMeasurementParser::getMeasurementFromStrs(capture);
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(state.iterations() * capture.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseRawMeasurements)->Arg(64)->Arg(1 << 14)->Arg(1 << 16);
+
+void BM_ParseNmea(State& state) {
+    const std::string capture = makeNmeaCapture(state.range(0));
+    for (auto _ : state) {
+        auto location = NmeaFixInfo::getLocationFromInputStr(capture);
+        benchmark::DoNotOptimize(location);
+    }
+    state.SetBytesProcessed(state.iterations() * capture.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseNmea)->Arg(1)->Arg(1 << 14)->Arg(1 << 16);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,4 +1,3 @@
-
 /*
  * Copyright (C) 2021 The Android Open Source Project
  *
@@ -18,9 +17,14 @@
 #define android_hardware_gnss_common_default_DeviceFileReader_H_
 
 #include <log/log.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
 #include "Constants.h"
 #include "GnssReplayUtils.h"
 
@@ -28,6 +32,15 @@ namespace android {
 namespace hardware {
 namespace gnss {
 namespace common {
+
+/**
+ * Streams replayed location and raw measurement records from the GNSS device files.
+ *
+ * The device files are opened once and kept registered with a long-lived epoll instance. A
+ * reader thread splits the incoming bytes into records as they arrive and publishes the latest
+ * record of each kind. The getters write their request command and wait, for a bounded time, for
+ * the reader thread to publish a newer record, falling back to the latest one.
+ */
 class DeviceFileReader {
   public:
     static DeviceFileReader& Instance() {
@@ -36,18 +49,63 @@ class DeviceFileReader {
     }
     std::string getLocationData();
     std::string getGnssRawMeasurementData();
-    void getDataFromDeviceFile(const std::string& command, int mMinIntervalMs);
 
-  private:
-    DeviceFileReader();
+    // How long a request waits for its response before falling back to the latest record.
+    static constexpr int kDefaultResponseTimeoutMs = 20;
+
+    // Tests create their own readers on fake device files.
+    explicit DeviceFileReader(int responseTimeoutMs = kDefaultResponseTimeoutMs);
     ~DeviceFileReader();
-    std::unordered_map<std::string, std::string> data_;
-    std::string s_buffer_;
+    std::string getLocationData(const std::string& deviceFilePath);
+    std::string getGnssRawMeasurementData(const std::string& deviceFilePath);
+
+  private:
+    // The latest record of a kind.
+    struct Snapshot {
+        std::shared_ptr<const std::string> data;
+        // Incremented each time a record is published.
+        uint64_t generation = 0;
+    };
+
+    struct Device {
+        int fd = -1;
+        // Bytes received but not yet parsed into a complete record.
+        std::string buffer;
+        // Offset in |buffer| up to which no end of record mark can start.
+        size_t scanOffset = 0;
+        // Commands written to the device, oldest first, whose responses are outstanding.
+        std::deque<std::string> pendingCommands;
+    };
+
+    std::string getData(const std::string& command, const std::string& deviceFilePath,
+                        Snapshot* snapshot);
+    bool requestData(const std::string& command, const std::string& deviceFilePath);
+    Device* openDeviceLocked(const std::string& deviceFilePath);
+    void closeDeviceLocked(Device* device);
+    void readLoop();
+    void readDeviceLocked(Device* device);
+    void publishRecord(const std::string& command, std::string_view record);
+
+    // Latest records, swapped under mSnapshotMutex which is only ever held to copy a pointer.
+    Snapshot mLocation;
+    Snapshot mRawMeasurement;
+    std::mutex mSnapshotMutex;
+    // Signals a newly published record.
+    std::condition_variable mPublishedCV;
+
+    // Protects mDevices.
     std::mutex mMutex;
+    // Open device files keyed by path; the location and measurement paths may be the same.
+    std::map<std::string, Device> mDevices;
+    const int mResponseTimeoutMs;
+    int mEpollFd;
+    // Wakes the reader thread up for shutdown.
+    int mEventFd;
+    std::thread mReaderThread;
 };
 }  // namespace common
 }  // namespace gnss
 }  // namespace hardware
 }  // namespace android
 
-#endif  // android_hardware_gnss_common_default_DeviceFileReader_H_
\ No newline at end of file
+#endif  // android_hardware_gnss_common_default_DeviceFileReader_H_
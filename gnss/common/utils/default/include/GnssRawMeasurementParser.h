@@ -20,8 +20,10 @@
 #include <aidl/android/hardware/gnss/BnGnss.h>
 #include <log/log.h>
 #include <utils/SystemClock.h>
+#include <array>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 #include "Constants.h"
 #include "ParseUtils.h"
@@ -32,18 +34,73 @@ namespace gnss {
 namespace common {
 
 struct GnssRawMeasurementParser {
+    // Columns of a GnssLogger "Raw" record that the parser requires.
+    enum Column : int {
+        RAW,
+        UTC_TIME_MILLIS,
+        TIME_NANOS,
+        LEAP_SECOND,
+        TIME_UNCERTAINTY_NANOS,
+        FULL_BIAS_NANOS,
+        BIAS_NANOS,
+        BIAS_UNCERTAINTY_NANOS,
+        DRIFT_NANOS_PER_SECOND,
+        DRIFT_UNCERTAINTY_NANOS_PER_SECOND,
+        HARDWARE_CLOCK_DISCONTINUITY_COUNT,
+        SVID,
+        TIME_OFFSET_NANOS,
+        STATE,
+        RECEIVED_SV_TIME_NANOS,
+        RECEIVED_SV_TIME_UNCERTAINTY_NANOS,
+        CN0_DB_HZ,
+        PSEUDORANGE_RATE_METERS_PER_SECOND,
+        PSEUDORANGE_RATE_UNCERTAINTY_METERS_PER_SECOND,
+        ACCUMULATED_DELTA_RANGE_STATE,
+        ACCUMULATED_DELTA_RANGE_METERS,
+        ACCUMULATED_DELTA_RANGE_UNCERTAINTY_METERS,
+        CARRIER_FREQUENCY_HZ,
+        CARRIER_CYCLES,
+        CARRIER_PHASE,
+        CARRIER_PHASE_UNCERTAINTY,
+        MULTIPATH_INDICATOR,
+        SNR_IN_DB,
+        CONSTELLATION_TYPE,
+        AGC_DB,
+        BASEBAND_CN0_DB_HZ,
+        FULL_INTER_SIGNAL_BIAS_NANOS,
+        FULL_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS,
+        SATELLITE_INTER_SIGNAL_BIAS_NANOS,
+        SATELLITE_INTER_SIGNAL_BIAS_UNCERTAINTY_NANOS,
+        CODE_TYPE,
+        CHIPSET_ELAPSED_REALTIME_NANOS,
+        NUM_COLUMNS
+    };
+
+    /**
+     * Position of every required Column within a record, compiled from a header line. Records are
+     * then read by index, so no column name is looked up per record.
+     */
+    struct ColumnLayout {
+        std::array<int, NUM_COLUMNS> index;
+        // Number of fields a record needs to hold every required column.
+        size_t minRecordSize;
+
+        std::string_view get(const std::vector<std::string_view>& values, Column column) const {
+            return values[index[column]];
+        }
+    };
+
     static std::unique_ptr<aidl::android::hardware::gnss::GnssData> getMeasurementFromStrs(
-            std::string& rawMeasurementStr);
-    static int getClockFlags(const std::vector<std::string>& rawMeasurementRecordValues,
-                             const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::string& rawMeasurementStr);
+    static int getClockFlags(const std::vector<std::string_view>& rawMeasurementRecordValues,
+                             const ColumnLayout& columns);
     static int getElapsedRealtimeFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const ColumnLayout& columns);
     static int getRawMeasurementFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
-    static std::unordered_map<std::string, int> getColumnIdNameMappingFromHeader(
-            const std::string& header);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const ColumnLayout& columns);
+    static bool getColumnLayoutFromHeader(std::string_view header, ColumnLayout* columns);
     static aidl::android::hardware::gnss::GnssConstellationType getGnssConstellationType(
             int constellationType);
 };
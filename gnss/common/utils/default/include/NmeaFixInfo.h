@@ -22,6 +22,8 @@
 #include <hidl/Status.h>
 #include <ctime>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "aidl/android/hardware/gnss/IGnss.h"
 namespace android {
 namespace hardware {
@@ -50,14 +52,13 @@ class NmeaFixInfo {
             const std::string& inputStr);
 
   private:
-    static void splitStr(const std::string& line, const char& delimiter,
-                         std::vector<std::string>& out);
-    static float checkAndConvertToFloat(const std::string& sentence);
-    static int64_t nmeaPartsToTimestamp(const std::string& timeStr, const std::string& dateStr);
+    static bool stripAndValidateChecksum(std::string_view* sentence);
+    static float checkAndConvertToFloat(std::string_view sentence);
+    static int64_t nmeaPartsToTimestamp(std::string_view timeStr, std::string_view dateStr);
 
     NmeaFixInfo();
-    void parseGGALine(const std::vector<std::string>& sentenceValues);
-    void parseRMCLine(const std::vector<std::string>& sentenceValues);
+    void parseGGALine(const std::vector<std::string_view>& sentenceValues);
+    void parseRMCLine(const std::vector<std::string_view>& sentenceValues);
     std::unique_ptr<V2_0::GnssLocation> toGnssLocation() const;
 
     // Getters
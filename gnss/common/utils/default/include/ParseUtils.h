@@ -18,8 +18,7 @@
 #define android_hardware_gnss_common_default_ParseUtils_H_
 
 #include <log/log.h>
-#include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 namespace android {
@@ -27,15 +26,24 @@ namespace hardware {
 namespace gnss {
 namespace common {
 
+/**
+ * Allocation free helpers for the replayed GNSS records.
+ *
+ * The numeric parsers return |defaultVal| for empty or malformed fields instead of throwing, so a
+ * corrupt replay record cannot take the HAL down.
+ */
 struct ParseUtils {
-    static int tryParseInt(const std::string& s, int defaultVal = 0);
-    static float tryParsefloat(const std::string& s, float defaultVal = 0.0);
-    static double tryParseDouble(const std::string& s, double defaultVal = 0.0);
-    static long tryParseLong(const std::string& s, long defaultVal = 0);
-    static long long tryParseLongLong(const std::string& s, long long defaultVal = 0);
-    static void splitStr(const std::string& line, const char& delimiter,
-                         std::vector<std::string>& out);
-    static bool isValidHeader(const std::unordered_map<std::string, int>& columnNameIdMapping);
+    static int tryParseInt(std::string_view s, int defaultVal = 0);
+    static float tryParsefloat(std::string_view s, float defaultVal = 0.0);
+    static double tryParseDouble(std::string_view s, double defaultVal = 0.0);
+    static long tryParseLong(std::string_view s, long defaultVal = 0);
+    static long long tryParseLongLong(std::string_view s, long long defaultVal = 0);
+    // Splits |line| on |delimiter| into views of |line|, keeping empty fields. |out| is cleared
+    // first so that callers can reuse its capacity across lines.
+    static void splitStr(std::string_view line, char delimiter, std::vector<std::string_view>& out);
+    // Pops the next non-empty line off |input| into |line|, without its line terminator. Returns
+    // false once |input| is exhausted.
+    static bool nextLine(std::string_view& input, std::string_view* line);
 };
 
 }  // namespace common
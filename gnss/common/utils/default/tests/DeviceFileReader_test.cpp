@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "DeviceFileReader.h"
+
+using ::android::base::unique_fd;
+using ::android::hardware::gnss::common::CMD_GET_LOCATION;
+using ::android::hardware::gnss::common::CMD_GET_RAWMEASUREMENT;
+using ::android::hardware::gnss::common::DeviceFileReader;
+
+namespace {
+
+constexpr char kEndOfRecordMark[] = "\n\n\n\n";
+// Long enough for the fake device to always respond in time.
+constexpr int kResponseTimeoutMs = 1000;
+
+// A pseudo terminal standing in for the GNSS serial device. The reader opens its slave side by
+// path, and the fake device answers the commands written to it from the master side.
+class FakeDevice {
+  public:
+    FakeDevice() : mMaster(posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)) {
+        if (mMaster.get() < 0 || grantpt(mMaster.get()) != 0 || unlockpt(mMaster.get()) != 0) {
+            return;
+        }
+        mPath = ptsname(mMaster.get());
+        // Keep the slave open so that its raw mode is kept while the reader reopens it.
+        mSlave.reset(open(mPath.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC));
+        struct termios tio;
+        if (mSlave.get() < 0 || tcgetattr(mSlave.get(), &tio) != 0) {
+            return;
+        }
+        cfmakeraw(&tio);
+        if (tcsetattr(mSlave.get(), TCSANOW, &tio) != 0) {
+            return;
+        }
+    }
+
+    ~FakeDevice() { stop(); }
+
+    bool isValid() const { return mSlave.get() >= 0 && !mPath.empty(); }
+    const std::string& getPath() const { return mPath; }
+
+    // Answers each command with a record numbered after the requests received so far.
+    void start() {
+        mThread = std::thread([this] {
+            std::string commands;
+            while (!mStop) {
+                struct pollfd pfd = {.fd = mMaster.get(), .events = POLLIN, .revents = 0};
+                if (poll(&pfd, 1, 10 /* timeoutMs */) <= 0) {
+                    continue;
+                }
+                char buffer[256];
+                ssize_t size = read(mMaster.get(), buffer, sizeof(buffer));
+                if (size <= 0) {
+                    continue;
+                }
+                commands.append(buffer, size);
+                while (respondTo(&commands, CMD_GET_RAWMEASUREMENT, "Raw") ||
+                       respondTo(&commands, CMD_GET_LOCATION, "Fix")) {
+                }
+            }
+        });
+    }
+
+    void stop() {
+        mStop = true;
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+    }
+
+    void write(const std::string& data) {
+        ASSERT_EQ(static_cast<ssize_t>(data.size()),
+                  ::write(mMaster.get(), data.c_str(), data.size()));
+    }
+
+  private:
+    bool respondTo(std::string* commands, const std::string& command, const std::string& kind) {
+        if (commands->compare(0, command.size(), command) != 0) {
+            return false;
+        }
+        commands->erase(0, command.size());
+        write(kind + std::to_string(++mNumRequests) + kEndOfRecordMark);
+        return true;
+    }
+
+    unique_fd mMaster;
+    unique_fd mSlave;
+    std::string mPath;
+    std::thread mThread;
+    std::atomic<bool> mStop = false;
+    int mNumRequests = 0;
+};
+
+}  // namespace
+
+TEST(DeviceFileReaderTest, ReturnsResponseToEachRequest) {
+    FakeDevice device;
+    ASSERT_TRUE(device.isValid());
+    device.start();
+    DeviceFileReader reader(kResponseTimeoutMs);
+
+    EXPECT_EQ("Fix1", reader.getLocationData(device.getPath()));
+    EXPECT_EQ("Fix2", reader.getLocationData(device.getPath()));
+    EXPECT_EQ("Raw3", reader.getGnssRawMeasurementData(device.getPath()));
+    EXPECT_EQ("Fix4", reader.getLocationData(device.getPath()));
+}
+
+TEST(DeviceFileReaderTest, ReturnsLatestRecordWithoutResponse) {
+    FakeDevice device;
+    ASSERT_TRUE(device.isValid());
+    DeviceFileReader reader;
+
+    // Nothing was ever received.
+    EXPECT_EQ("", reader.getLocationData(device.getPath()));
+
+    // The record answers the outstanding request, the next request goes unanswered.
+    device.write(std::string("Fix1") + kEndOfRecordMark);
+    EXPECT_EQ("Fix1", reader.getLocationData(device.getPath()));
+    EXPECT_EQ("Fix1", reader.getLocationData(device.getPath()));
+}
+
+TEST(DeviceFileReaderTest, ReassemblesSplitRecords) {
+    FakeDevice device;
+    ASSERT_TRUE(device.isValid());
+    DeviceFileReader reader;
+    EXPECT_EQ("", reader.getGnssRawMeasurementData(device.getPath()));
+
+    device.write("Raw,1,2");
+    device.write(",3\n\n");
+    device.write(std::string("\n\n") + "Raw,4");
+    EXPECT_EQ("Raw,1,2,3", reader.getGnssRawMeasurementData(device.getPath()));
+}
+
+TEST(DeviceFileReaderTest, ReturnsEmptyForMissingDevice) {
+    DeviceFileReader reader;
+    EXPECT_EQ("", reader.getLocationData("/nonexistent/gnss"));
+}
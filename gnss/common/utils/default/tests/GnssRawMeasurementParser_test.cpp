@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GnssRawMeasurementParser.h"
+
+using ::aidl::android::hardware::gnss::GnssClock;
+using ::aidl::android::hardware::gnss::GnssConstellationType;
+using ::aidl::android::hardware::gnss::GnssData;
+using ::aidl::android::hardware::gnss::GnssMeasurement;
+using ::android::hardware::gnss::common::GnssRawMeasurementParser;
+
+namespace {
+
+// A GnssLogger capture where every column holds a distinct value, so that reading a field from
+// the wrong column shows up.
+class RawCapture {
+  public:
+    RawCapture()
+        : mColumns({{"Raw", "Raw"},
+                    {"utcTimeMillis", "1567114324000"},
+                    {"TimeNanos", "1000"},
+                    {"LeapSecond", "18"},
+                    {"TimeUncertaintyNanos", "1.5"},
+                    {"FullBiasNanos", "-1300000000000000000"},
+                    {"BiasNanos", "0.25"},
+                    {"BiasUncertaintyNanos", "10.5"},
+                    {"DriftNanosPerSecond", "1.25"},
+                    {"DriftUncertaintyNanosPerSecond", "2.75"},
+                    {"HardwareClockDiscontinuityCount", "3"},
+                    {"Svid", "22"},
+                    {"TimeOffsetNanos", "0.0"},
+                    {"State", "16431"},
+                    {"ReceivedSvTimeNanos", "123456789"},
+                    {"ReceivedSvTimeUncertaintyNanos", "17"},
+                    {"Cn0DbHz", "42.5"},
+                    {"PseudorangeRateMetersPerSecond", "-512.5"},
+                    {"PseudorangeRateUncertaintyMetersPerSecond", "0.125"},
+                    {"AccumulatedDeltaRangeState", "4"},
+                    {"AccumulatedDeltaRangeMeters", "8.5"},
+                    {"AccumulatedDeltaRangeUncertaintyMeters", "0.0625"},
+                    {"CarrierFrequencyHz", "1575420030"},
+                    {"CarrierCycles", "5"},
+                    {"CarrierPhase", "6.5"},
+                    {"CarrierPhaseUncertainty", "7.5"},
+                    {"MultipathIndicator", "0"},
+                    {"SnrInDb", "30.5"},
+                    {"ConstellationType", "6"},
+                    {"AgcDb", "2.5"},
+                    {"BasebandCn0DbHz", "38.5"},
+                    {"FullInterSignalBiasNanos", "11.5"},
+                    {"FullInterSignalBiasUncertaintyNanos", "12.5"},
+                    {"SatelliteInterSignalBiasNanos", "13.5"},
+                    {"SatelliteInterSignalBiasUncertaintyNanos", "14.5"},
+                    {"CodeType", "C"},
+                    {"ChipsetElapsedRealtimeNanos", "2000"}}) {}
+
+    void set(const std::string& name, const std::string& value) {
+        for (auto& column : mColumns) {
+            if (column.first == name) {
+                column.second = value;
+            }
+        }
+    }
+
+    void swapColumns(size_t first, size_t second) { std::swap(mColumns[first], mColumns[second]); }
+
+    void removeColumn(const std::string& name) {
+        for (auto it = mColumns.begin(); it != mColumns.end(); ++it) {
+            if (it->first == name) {
+                mColumns.erase(it);
+                return;
+            }
+        }
+    }
+
+    std::string header() const { return "# " + join(0) + "\n"; }
+    std::string record() const { return join(1) + "\n"; }
+
+  private:
+    std::string join(int part) const {
+        std::string line;
+        for (const auto& column : mColumns) {
+            line += (line.empty() ? "" : ",") + (part == 0 ? column.first : column.second);
+        }
+        return line;
+    }
+
+    std::vector<std::pair<std::string, std::string>> mColumns;
+};
+
+size_t indexOf(const std::string& header, const std::string& name) {
+    std::vector<std::string_view> names;
+    ::android::hardware::gnss::common::ParseUtils::splitStr(header.substr(2), ',', names);
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    return names.size();
+}
+
+}  // namespace
+
+TEST(GnssRawMeasurementParserTest, ParsesClockAndMeasurement) {
+    RawCapture capture;
+    auto data = GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                 capture.record());
+    ASSERT_NE(nullptr, data);
+
+    EXPECT_EQ(1000, data->clock.timeNs);
+    EXPECT_EQ(-1300000000000000000LL, data->clock.fullBiasNs);
+    EXPECT_DOUBLE_EQ(0.25, data->clock.biasNs);
+    EXPECT_DOUBLE_EQ(10.5, data->clock.biasUncertaintyNs);
+    EXPECT_DOUBLE_EQ(1.25, data->clock.driftNsps);
+    EXPECT_DOUBLE_EQ(2.75, data->clock.driftUncertaintyNsps);
+    EXPECT_EQ(3, data->clock.hwClockDiscontinuityCount);
+    EXPECT_EQ(GnssClock::HAS_LEAP_SECOND | GnssClock::HAS_FULL_BIAS | GnssClock::HAS_BIAS |
+                      GnssClock::HAS_BIAS_UNCERTAINTY | GnssClock::HAS_DRIFT |
+                      GnssClock::HAS_DRIFT_UNCERTAINTY,
+              data->clock.gnssClockFlags);
+    EXPECT_EQ(2000, data->elapsedRealtime.timestampNs);
+    EXPECT_DOUBLE_EQ(1.5, data->elapsedRealtime.timeUncertaintyNs);
+
+    ASSERT_EQ(1u, data->measurements.size());
+    const GnssMeasurement& measurement = data->measurements[0];
+    EXPECT_EQ(22, measurement.svid);
+    EXPECT_EQ(GnssConstellationType::GALILEO, measurement.signalType.constellation);
+    EXPECT_DOUBLE_EQ(1575420030, measurement.signalType.carrierFrequencyHz);
+    EXPECT_EQ("C", measurement.signalType.codeType);
+    EXPECT_EQ(16431, measurement.state);
+    EXPECT_EQ(123456789, measurement.receivedSvTimeInNs);
+    EXPECT_EQ(17, measurement.receivedSvTimeUncertaintyInNs);
+    EXPECT_DOUBLE_EQ(42.5, measurement.antennaCN0DbHz);
+    EXPECT_DOUBLE_EQ(38.5, measurement.basebandCN0DbHz);
+    EXPECT_DOUBLE_EQ(2.5, measurement.agcLevelDb);
+    EXPECT_DOUBLE_EQ(-512.5, measurement.pseudorangeRateMps);
+    EXPECT_DOUBLE_EQ(0.125, measurement.pseudorangeRateUncertaintyMps);
+    EXPECT_EQ(4, measurement.accumulatedDeltaRangeState);
+    EXPECT_DOUBLE_EQ(8.5, measurement.accumulatedDeltaRangeM);
+    EXPECT_DOUBLE_EQ(0.0625, measurement.accumulatedDeltaRangeUncertaintyM);
+    EXPECT_DOUBLE_EQ(11.5, measurement.fullInterSignalBiasNs);
+    EXPECT_DOUBLE_EQ(12.5, measurement.fullInterSignalBiasUncertaintyNs);
+    EXPECT_DOUBLE_EQ(13.5, measurement.satelliteInterSignalBiasNs);
+    EXPECT_DOUBLE_EQ(14.5, measurement.satelliteInterSignalBiasUncertaintyNs);
+}
+
+TEST(GnssRawMeasurementParserTest, FindsColumnsByName) {
+    RawCapture capture;
+    std::string header = capture.header();
+    capture.swapColumns(indexOf(header, "DriftNanosPerSecond"),
+                        indexOf(header, "DriftUncertaintyNanosPerSecond"));
+    capture.swapColumns(indexOf(header, "FullInterSignalBiasNanos"),
+                        indexOf(header, "SatelliteInterSignalBiasUncertaintyNanos"));
+
+    auto data = GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                 capture.record());
+    ASSERT_NE(nullptr, data);
+    EXPECT_DOUBLE_EQ(1.25, data->clock.driftNsps);
+    EXPECT_DOUBLE_EQ(2.75, data->clock.driftUncertaintyNsps);
+    ASSERT_EQ(1u, data->measurements.size());
+    EXPECT_DOUBLE_EQ(11.5, data->measurements[0].fullInterSignalBiasNs);
+    EXPECT_DOUBLE_EQ(12.5, data->measurements[0].fullInterSignalBiasUncertaintyNs);
+    EXPECT_DOUBLE_EQ(14.5, data->measurements[0].satelliteInterSignalBiasUncertaintyNs);
+}
+
+TEST(GnssRawMeasurementParserTest, ClearsFlagsOfEmptyFields) {
+    RawCapture capture;
+    capture.set("DriftUncertaintyNanosPerSecond", "");
+    capture.set("FullInterSignalBiasUncertaintyNanos", "");
+    capture.set("AgcDb", "");
+
+    auto data = GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                 capture.record());
+    ASSERT_NE(nullptr, data);
+    EXPECT_FALSE(data->clock.gnssClockFlags & GnssClock::HAS_DRIFT_UNCERTAINTY);
+    EXPECT_TRUE(data->clock.gnssClockFlags & GnssClock::HAS_DRIFT);
+    EXPECT_DOUBLE_EQ(0, data->clock.driftUncertaintyNsps);
+    ASSERT_EQ(1u, data->measurements.size());
+    int flags = data->measurements[0].flags;
+    EXPECT_FALSE(flags & GnssMeasurement::HAS_FULL_ISB_UNCERTAINTY);
+    EXPECT_TRUE(flags & GnssMeasurement::HAS_FULL_ISB);
+    EXPECT_FALSE(flags & GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL);
+}
+
+TEST(GnssRawMeasurementParserTest, SkipsMalformedRecords) {
+    RawCapture capture;
+    std::string record = capture.record();
+    std::string truncated = record.substr(0, record.rfind(',', record.size() / 2)) + "\n";
+    std::string notRaw = "Fix" + record.substr(3);
+    RawCapture other;
+    other.set("Svid", "7");
+
+    auto data = GnssRawMeasurementParser::getMeasurementFromStrs(
+            capture.header() + truncated + notRaw + "\n" + record + "\r\n" + other.record());
+    ASSERT_NE(nullptr, data);
+    ASSERT_EQ(2u, data->measurements.size());
+    EXPECT_EQ(22, data->measurements[0].svid);
+    EXPECT_EQ(7, data->measurements[1].svid);
+}
+
+TEST(GnssRawMeasurementParserTest, FailsWithoutValidRecords) {
+    RawCapture capture;
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(""));
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(capture.header()));
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                        "Raw,1,2,3\n"));
+
+    RawCapture missingColumn;
+    missingColumn.removeColumn("CodeType");
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(missingColumn.header() +
+                                                                        missingColumn.record()));
+}
+
+TEST(GnssRawMeasurementParserTest, FollowsHeaderChanges) {
+    // The layout of the previous header is cached and must not be applied to a new one.
+    RawCapture capture;
+    ASSERT_NE(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                        capture.record()));
+    std::string header = capture.header();
+    capture.swapColumns(indexOf(header, "Svid"), indexOf(header, "State"));
+    auto data = GnssRawMeasurementParser::getMeasurementFromStrs(capture.header() +
+                                                                 capture.record());
+    ASSERT_NE(nullptr, data);
+    ASSERT_EQ(1u, data->measurements.size());
+    EXPECT_EQ(22, data->measurements[0].svid);
+    EXPECT_EQ(16431, data->measurements[0].state);
+}
+
+TEST(GnssRawMeasurementParserTest, MapsConstellationTypes) {
+    EXPECT_EQ(GnssConstellationType::GPS, GnssRawMeasurementParser::getGnssConstellationType(1));
+    EXPECT_EQ(GnssConstellationType::GALILEO,
+              GnssRawMeasurementParser::getGnssConstellationType(6));
+    EXPECT_EQ(GnssConstellationType::UNKNOWN,
+              GnssRawMeasurementParser::getGnssConstellationType(0));
+    EXPECT_EQ(GnssConstellationType::UNKNOWN,
+              GnssRawMeasurementParser::getGnssConstellationType(42));
+}
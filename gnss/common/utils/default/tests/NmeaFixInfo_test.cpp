@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "NmeaFixInfo.h"
+
+using ::android::hardware::gnss::common::NmeaFixInfo;
+
+namespace {
+
+constexpr char kGgaBody[] = "GPGGA,213204.00,3725.371240,N,12205.589239,W,1,12,0.9,10.5,M,-25.7,M,,";
+constexpr char kRmcBody[] = "GPRMC,213204.00,A,3725.371240,N,12205.589239,W,001.5,090.0,290819,,,A";
+
+// Returns |body| as an NMEA sentence, with its "*hh" checksum.
+std::string toSentence(const std::string& body) {
+    unsigned int checksum = 0;
+    for (char c : body) {
+        checksum ^= static_cast<unsigned char>(c);
+    }
+    char suffix[4];
+    snprintf(suffix, sizeof(suffix), "*%02X", checksum);
+    return "$" + body + suffix;
+}
+
+}  // namespace
+
+TEST(NmeaFixInfoTest, ParsesFix) {
+    auto location = NmeaFixInfo::getLocationFromInputStr(toSentence(kGgaBody) + "\r\n" +
+                                                         toSentence(kRmcBody) + "\r\n");
+    ASSERT_NE(nullptr, location);
+    EXPECT_NEAR(37.4228540, location->v1_0.latitudeDegrees, 1e-4);
+    EXPECT_NEAR(-122.0931540, location->v1_0.longitudeDegrees, 1e-4);
+    EXPECT_FLOAT_EQ(10.5f, location->v1_0.altitudeMeters);
+    EXPECT_FLOAT_EQ(1.5f, location->v1_0.speedMetersPerSec);
+    EXPECT_FLOAT_EQ(90.0f, location->v1_0.bearingDegrees);
+    // 2019/08/29 21:32:04 UTC.
+    EXPECT_EQ(1567114324, location->v1_0.timestamp);
+}
+
+TEST(NmeaFixInfoTest, AcceptsSentencesWithoutChecksum) {
+    auto location = NmeaFixInfo::getLocationFromInputStr(std::string("$") + kGgaBody + "\n$" +
+                                                         kRmcBody + "\n");
+    ASSERT_NE(nullptr, location);
+    EXPECT_FLOAT_EQ(10.5f, location->v1_0.altitudeMeters);
+}
+
+TEST(NmeaFixInfoTest, DropsSentenceWithBadChecksum) {
+    std::string gga = toSentence(kGgaBody);
+    // Corrupt the altitude without updating the checksum.
+    gga.replace(gga.find("10.5"), 4, "99.5");
+    EXPECT_EQ(nullptr, NmeaFixInfo::getLocationFromInputStr(gga + "\n" + toSentence(kRmcBody)));
+}
+
+TEST(NmeaFixInfoTest, DropsSentenceWithMalformedChecksum) {
+    std::string rmc = toSentence(kRmcBody);
+    std::string gga = toSentence(kGgaBody);
+    for (const char* suffix : {"", "4", "491", "ZZ"}) {
+        std::string badRmc = rmc.substr(0, rmc.rfind('*') + 1) + suffix;
+        EXPECT_EQ(nullptr, NmeaFixInfo::getLocationFromInputStr(gga + "\n" + badRmc))
+                << "checksum: \"" << suffix << "\"";
+    }
+}
+
+TEST(NmeaFixInfoTest, IgnoresShortAndMalformedSentences) {
+    // Too few fields.
+    EXPECT_EQ(nullptr, NmeaFixInfo::getLocationFromInputStr(toSentence("GPGGA,213204.00,3725.3,N") +
+                                                            "\n" + toSentence(kRmcBody)));
+    // Latitude too short to hold its degrees.
+    EXPECT_EQ(nullptr,
+              NmeaFixInfo::getLocationFromInputStr(
+                      toSentence("GPGGA,213204.00,3,N,12205.589239,W,1,12,0.9,10.5,M,-25.7,M,,") +
+                      "\n" + toSentence(kRmcBody)));
+    // Date too short to hold a day, month and year.
+    EXPECT_EQ(nullptr,
+              NmeaFixInfo::getLocationFromInputStr(
+                      toSentence(kGgaBody) + "\n" +
+                      toSentence("GPRMC,213204.00,A,3725.371240,N,12205.589239,W,001.5,090.0,"
+                                 "2908,,,A")));
+    // Other sentences and garbage are skipped.
+    EXPECT_EQ(nullptr, NmeaFixInfo::getLocationFromInputStr("$GPGSV,1,1,00*79\ngarbage\n\n"));
+    EXPECT_EQ(nullptr, NmeaFixInfo::getLocationFromInputStr(""));
+}
+
+TEST(NmeaFixInfoTest, ReportsLatestCompleteFix) {
+    std::string laterGga = kGgaBody;
+    laterGga.replace(laterGga.find("213204.00"), 9, "213205.00");
+    laterGga.replace(laterGga.find("10.5"), 4, "20.5");
+    std::string laterRmc = kRmcBody;
+    laterRmc.replace(laterRmc.find("213204.00"), 9, "213205.00");
+
+    auto location = NmeaFixInfo::getLocationFromInputStr(
+            toSentence(kGgaBody) + "\n" + toSentence(kRmcBody) + "\n" + toSentence(laterGga) +
+            "\n" + toSentence(laterRmc) + "\n");
+    ASSERT_NE(nullptr, location);
+    EXPECT_FLOAT_EQ(20.5f, location->v1_0.altitudeMeters);
+    EXPECT_EQ(1567114325, location->v1_0.timestamp);
+}
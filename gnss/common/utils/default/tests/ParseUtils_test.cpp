@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+#include <vector>
+
+#include "ParseUtils.h"
+
+using ::android::hardware::gnss::common::ParseUtils;
+
+TEST(ParseUtilsTest, SplitStrKeepsEmptyFields) {
+    std::vector<std::string_view> out;
+    ParseUtils::splitStr("a,,b,", ',', out);
+    EXPECT_EQ((std::vector<std::string_view>{"a", "", "b", ""}), out);
+
+    ParseUtils::splitStr(",", ',', out);
+    EXPECT_EQ((std::vector<std::string_view>{"", ""}), out);
+
+    ParseUtils::splitStr("", ',', out);
+    EXPECT_EQ((std::vector<std::string_view>{""}), out);
+}
+
+TEST(ParseUtilsTest, SplitStrClearsOutput) {
+    std::vector<std::string_view> out;
+    ParseUtils::splitStr("a,b,c", ',', out);
+    ParseUtils::splitStr("d", ',', out);
+    EXPECT_EQ((std::vector<std::string_view>{"d"}), out);
+}
+
+TEST(ParseUtilsTest, NextLineSkipsBlankLinesAndCarriageReturns) {
+    std::string_view input = "first\r\n\n\r\nsecond\nthird";
+    std::string_view line;
+    ASSERT_TRUE(ParseUtils::nextLine(input, &line));
+    EXPECT_EQ("first", line);
+    ASSERT_TRUE(ParseUtils::nextLine(input, &line));
+    EXPECT_EQ("second", line);
+    ASSERT_TRUE(ParseUtils::nextLine(input, &line));
+    EXPECT_EQ("third", line);
+    EXPECT_FALSE(ParseUtils::nextLine(input, &line));
+
+    std::string_view blank = "\n\r\n";
+    EXPECT_FALSE(ParseUtils::nextLine(blank, &line));
+}
+
+TEST(ParseUtilsTest, ParsesNumbers) {
+    EXPECT_EQ(-42, ParseUtils::tryParseInt("-42"));
+    EXPECT_EQ(1300000000000000000LL, ParseUtils::tryParseLongLong("1300000000000000000"));
+    EXPECT_EQ(123456789L, ParseUtils::tryParseLong("123456789"));
+    EXPECT_FLOAT_EQ(0.5f, ParseUtils::tryParsefloat("0.5"));
+    EXPECT_DOUBLE_EQ(-1.25e3, ParseUtils::tryParseDouble("-1.25e3"));
+}
+
+TEST(ParseUtilsTest, ReturnsDefaultForMalformedFields) {
+    EXPECT_EQ(7, ParseUtils::tryParseInt("", 7));
+    EXPECT_EQ(7, ParseUtils::tryParseInt("abc", 7));
+    EXPECT_EQ(7, ParseUtils::tryParseInt("99999999999999999999", 7));
+    EXPECT_EQ(7LL, ParseUtils::tryParseLongLong("-", 7));
+    EXPECT_FLOAT_EQ(1.5f, ParseUtils::tryParsefloat("", 1.5f));
+    EXPECT_DOUBLE_EQ(1.5, ParseUtils::tryParseDouble("x1", 1.5));
+    EXPECT_DOUBLE_EQ(1.5, ParseUtils::tryParseDouble(std::string(64, '1'), 1.5));
+}
+
+TEST(ParseUtilsTest, ParsesFieldsOfLargerString) {
+    // Fields are views into a line and are not NUL terminated.
+    std::string_view line = "12,3.5,";
+    std::vector<std::string_view> out;
+    ParseUtils::splitStr(line, ',', out);
+    ASSERT_EQ(3u, out.size());
+    EXPECT_EQ(12, ParseUtils::tryParseInt(out[0]));
+    EXPECT_DOUBLE_EQ(3.5, ParseUtils::tryParseDouble(out[1]));
+    EXPECT_DOUBLE_EQ(-1.0, ParseUtils::tryParseDouble(out[2], -1.0));
+}
@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <inttypes.h>
@@ -54,7 +55,8 @@ using CommandQueueType = MessageQueue<uint32_t, kSynchronizedReadWrite>;
 // units of uint32_t's.
 class CommandWriterBase {
    public:
-    CommandWriterBase(uint32_t initialMaxSize) : mDataMaxSize(initialMaxSize) {
+    CommandWriterBase(uint32_t initialMaxSize)
+        : mDataMaxSize(initialMaxSize), mQueueSize(initialMaxSize) {
         mData = std::make_unique<uint32_t[]>(mDataMaxSize);
         reset();
     }
@@ -64,6 +66,9 @@ class CommandWriterBase {
     void reset() {
         mDataWritten = 0;
         mCommandEnd = 0;
+        mCurrentLayerState = nullptr;
+        mPendingSelectLayer = false;
+        mChunking = false;
 
         // handles in mDataHandles are owned by the caller
         mDataHandles.clear();
@@ -76,6 +81,36 @@ class CommandWriterBase {
         mTemporaryHandles.clear();
     }
 
+    // When enabled, layer state commands whose payload is identical to the
+    // last one written for the same display and layer are dropped.  Layer
+    // state is sticky on the composer side, so nothing needs to be re-sent
+    // until it changes.  The caller must clear the cached state of a layer
+    // when it is destroyed, and of everything when the composer restarts.
+    void setLayerStateCacheEnabled(bool enabled) {
+        mLayerStateCacheEnabled = enabled;
+        if (!enabled) {
+            clearLayerStateCache();
+        }
+    }
+
+    void clearLayerStateCache() {
+        mLayerStateCache.clear();
+        mCurrentLayerState = nullptr;
+    }
+
+    void clearLayerStateCache(Display display) {
+        mLayerStateCache.erase(display);
+        mCurrentLayerState = nullptr;
+    }
+
+    void clearLayerStateCache(Display display, Layer layer) {
+        auto displayState = mLayerStateCache.find(display);
+        if (displayState != mLayerStateCache.end()) {
+            displayState->second.erase(layer);
+        }
+        mCurrentLayerState = nullptr;
+    }
+
     IComposerClient::Command getCommand(uint32_t offset) {
         uint32_t val = (offset < mDataWritten) ? mData[offset] : 0;
         return static_cast<IComposerClient::Command>(
@@ -84,6 +119,7 @@ class CommandWriterBase {
 
     bool writeQueue(bool* outQueueChanged, uint32_t* outCommandLength,
                     hidl_vec<hidl_handle>* outCommandHandles) {
+        dropPendingSelectLayer();
         if (mDataWritten == 0) {
             *outQueueChanged = false;
             *outCommandLength = 0;
@@ -99,19 +135,14 @@ class CommandWriterBase {
         //  - the reader does not read them (because of other errors)
         //
         // Discard the stale data here.
-        size_t staleDataSize = mQueue ? mQueue->availableToRead() : 0;
-        if (staleDataSize > 0) {
-            ALOGW("discarding stale data from message queue");
-            CommandQueueType::MemTransaction tx;
-            if (mQueue->beginRead(staleDataSize, &tx)) {
-                mQueue->commitRead(staleDataSize);
-            }
-        }
+        discardStaleData();
+        updateFrameStats(1);
 
         // write data to queue, optionally resizing it
         if (mQueue && (mDataMaxSize <= mQueue->getQuantumCount())) {
             if (!mQueue->write(mData.get(), mDataWritten)) {
                 ALOGE("failed to write commands to message queue");
+                clearLayerStateCache();
                 return false;
             }
 
@@ -120,9 +151,13 @@ class CommandWriterBase {
             auto newQueue = std::make_unique<CommandQueueType>(mDataMaxSize);
             if (!newQueue->isValid() || !newQueue->write(mData.get(), mDataWritten)) {
                 ALOGE("failed to prepare a new message queue ");
+                clearLayerStateCache();
                 return false;
             }
 
+            if (mQueue) {
+                mQueueStats.queueReallocations++;
+            }
             mQueue = std::move(newQueue);
             *outQueueChanged = true;
         }
@@ -134,22 +169,200 @@ class CommandWriterBase {
         return true;
     }
 
+    // Writes the next chunk of the pending commands to the queue.  Unlike
+    // writeQueue, the queue keeps its size however many layers a frame has:
+    // a frame larger than the queue is split at command boundaries, and
+    // every chunk after the first starts by re-selecting the current display
+    // and layer.  The queue is only replaced when a single command does not
+    // fit in it.  The caller sends each chunk with executeCommands, after
+    // setInputCommandQueue if outQueueChanged is set, before asking for the
+    // next one, for as long as outHasMore is set.  Handle indices are not
+    // rewritten, so every chunk carries all of the frame's handles.
+    bool writeQueueChunk(bool* outQueueChanged, uint32_t* outCommandLength,
+                         hidl_vec<hidl_handle>* outCommandHandles, bool* outHasMore) {
+        *outQueueChanged = false;
+        *outHasMore = false;
+
+        if (!mChunking) {
+            dropPendingSelectLayer();
+            mChunking = true;
+            mChunkCount = 0;
+            mChunkNext = 0;
+            mChunkDisplayOffset = kNoOffset;
+            mChunkLayerOffset = kNoOffset;
+        }
+
+        if (mChunkNext >= mDataWritten) {
+            mChunking = false;
+            *outCommandLength = 0;
+            outCommandHandles->setToExternal(nullptr, 0);
+            return true;
+        }
+
+        discardStaleData();
+
+        // re-select the display and layer the previous chunk ended in
+        uint32_t prefix[2 * (1 + kSelectLayerLength)];
+        uint32_t prefixLength = 0;
+        uint32_t prefixDisplayOffset = kNoOffset;
+        uint32_t prefixLayerOffset = kNoOffset;
+        const auto nextCommand = getCommand(mChunkNext);
+        if (nextCommand != IComposerClient::Command::SELECT_DISPLAY) {
+            if (mChunkDisplayOffset != kNoOffset) {
+                std::copy_n(&mData[mChunkDisplayOffset], 1 + kSelectDisplayLength,
+                            &prefix[prefixLength]);
+                prefixLength += 1 + kSelectDisplayLength;
+                prefixDisplayOffset = mChunkDisplayOffset;
+            }
+            if (mChunkLayerOffset != kNoOffset &&
+                nextCommand != IComposerClient::Command::SELECT_LAYER) {
+                std::copy_n(&mData[mChunkLayerOffset], 1 + kSelectLayerLength,
+                            &prefix[prefixLength]);
+                prefixLength += 1 + kSelectLayerLength;
+                prefixLayerOffset = mChunkLayerOffset;
+            }
+        }
+
+        constexpr uint32_t lengthMask =
+                static_cast<uint32_t>(IComposerClient::Command::LENGTH_MASK);
+        const uint32_t nextLength = prefixLength + 1 + (mData[mChunkNext] & lengthMask);
+        if (!mQueue || mQueue->getQuantumCount() < nextLength) {
+            auto newQueue =
+                    std::make_unique<CommandQueueType>(std::max(mQueueSize, nextLength));
+            if (!newQueue->isValid()) {
+                ALOGE("failed to prepare a new message queue ");
+                mChunking = false;
+                clearLayerStateCache();
+                return false;
+            }
+            if (mQueue) {
+                mQueueStats.oversizedCommandReplacements++;
+            }
+            mQueue = std::move(newQueue);
+            *outQueueChanged = true;
+        }
+        const uint32_t capacity = static_cast<uint32_t>(mQueue->getQuantumCount());
+
+        uint32_t end = mChunkNext;
+        uint32_t displayOffset = mChunkDisplayOffset;
+        uint32_t layerOffset = mChunkLayerOffset;
+        while (end < mDataWritten) {
+            const uint32_t length = 1 + (mData[end] & lengthMask);
+            if (prefixLength + (end - mChunkNext) + length > capacity) {
+                break;
+            }
+
+            const auto command = getCommand(end);
+            if (command == IComposerClient::Command::SELECT_DISPLAY) {
+                displayOffset = end;
+                layerOffset = kNoOffset;
+            } else if (command == IComposerClient::Command::SELECT_LAYER) {
+                layerOffset = end;
+            }
+            end += length;
+        }
+
+        const uint32_t chunkLength = prefixLength + (end - mChunkNext);
+        if ((prefixLength > 0 && !mQueue->write(prefix, prefixLength)) ||
+            !mQueue->write(&mData[mChunkNext], end - mChunkNext)) {
+            ALOGE("failed to write commands to message queue");
+            mChunking = false;
+            clearLayerStateCache();
+            return false;
+        }
+
+        mChunkBegin = mChunkNext;
+        mChunkPrefixLength = prefixLength;
+        mChunkPrefixDisplayOffset = prefixDisplayOffset;
+        mChunkPrefixLayerOffset = prefixLayerOffset;
+        mChunkNext = end;
+        mChunkDisplayOffset = displayOffset;
+        mChunkLayerOffset = layerOffset;
+        mChunkCount++;
+
+        *outHasMore = mChunkNext < mDataWritten;
+        if (!*outHasMore) {
+            mChunking = false;
+            updateFrameStats(mChunkCount);
+        }
+
+        *outCommandLength = chunkLength;
+        outCommandHandles->setToExternal(const_cast<hidl_handle*>(mDataHandles.data()),
+                                         mDataHandles.size());
+
+        return true;
+    }
+
+    // Maps a command location reported by the composer for the last chunk
+    // (e.g. in SET_ERROR) back to an offset in the pending commands.
+    uint32_t getChunkCommandOffset(uint32_t location) const {
+        if (location < mChunkPrefixLength) {
+            // the location is that of a re-selected display or layer
+            if (mChunkPrefixDisplayOffset != kNoOffset && location < 1 + kSelectDisplayLength) {
+                return mChunkPrefixDisplayOffset;
+            }
+            return mChunkPrefixLayerOffset;
+        }
+        return mChunkBegin + location - mChunkPrefixLength;
+    }
+
+    // Queue occupancy statistics, to size the queue so that frames rarely
+    // need more than one chunk.
+    struct QueueStats {
+        // largest frame written, before chunking
+        uint32_t frameHighWaterMark = 0;
+        uint32_t frames = 0;
+        // frames that needed more than one chunk, and the most chunks a
+        // frame needed
+        uint32_t chunkedFrames = 0;
+        uint32_t maxChunksPerFrame = 0;
+        // times writeQueueChunk replaced the queue because a single command
+        // did not fit in it
+        uint32_t oversizedCommandReplacements = 0;
+        // times writeQueue replaced the queue with a larger one
+        uint32_t queueReallocations = 0;
+    };
+
+    const QueueStats& getQueueStats() const { return mQueueStats; }
+
+    // Returns a queue size, in uint32_t's, that would have held every frame
+    // written so far in one chunk.  It is never smaller than the initial
+    // size.
+    uint32_t getRecommendedQueueSize() const {
+        uint32_t size = std::max(mQueueSize, 1u);
+        while (size < mQueueStats.frameHighWaterMark &&
+               size <= (std::numeric_limits<uint32_t>::max() >> 1)) {
+            size <<= 1;
+        }
+        return size;
+    }
+
     const MQDescriptorSync<uint32_t>* getMQDescriptor() const {
         return (mQueue) ? mQueue->getDesc() : nullptr;
     }
 
     static constexpr uint16_t kSelectDisplayLength = 2;
     void selectDisplay(Display display) {
+        dropPendingSelectLayer();
         beginCommand(IComposerClient::Command::SELECT_DISPLAY, kSelectDisplayLength);
         write64(display);
         endCommand();
+
+        mCurrentDisplay = display;
+        mCurrentLayerState = nullptr;
     }
 
     static constexpr uint16_t kSelectLayerLength = 2;
     void selectLayer(Layer layer) {
+        dropPendingSelectLayer();
         beginCommand(IComposerClient::Command::SELECT_LAYER, kSelectLayerLength);
         write64(layer);
         endCommand();
+
+        if (mLayerStateCacheEnabled) {
+            mCurrentLayerState = &mLayerStateCache[mCurrentDisplay][layer];
+            mPendingSelectLayer = true;
+        }
     }
 
     static constexpr uint16_t kSetErrorLength = 2;
@@ -439,12 +652,41 @@ class CommandWriterBase {
             LOG_FATAL("endCommand was not called before command 0x%x", command);
         }
 
+        if (mDataWritten == 0) {
+            // Drop what the composer did not read of the last frame before
+            // the layer state cache is consulted for this one.
+            discardStaleData();
+        }
+
         growData(1 + length);
+        mCommandBegin = mDataWritten;
+        mCommandOpcode = static_cast<uint32_t>(command);
         write(static_cast<uint32_t>(command) | length);
 
         mCommandEnd = mDataWritten + length;
     }
 
+    // Returns true for layer commands whose state persists on the composer
+    // side until it is set again.  Composition types are excluded since
+    // acceptDisplayChanges can change them behind the writer's back.
+    virtual bool isLayerStateCommand(uint32_t command) const {
+        switch (static_cast<IComposerClient::Command>(command)) {
+            case IComposerClient::Command::SET_LAYER_SURFACE_DAMAGE:
+            case IComposerClient::Command::SET_LAYER_BLEND_MODE:
+            case IComposerClient::Command::SET_LAYER_COLOR:
+            case IComposerClient::Command::SET_LAYER_DATASPACE:
+            case IComposerClient::Command::SET_LAYER_DISPLAY_FRAME:
+            case IComposerClient::Command::SET_LAYER_PLANE_ALPHA:
+            case IComposerClient::Command::SET_LAYER_SOURCE_CROP:
+            case IComposerClient::Command::SET_LAYER_TRANSFORM:
+            case IComposerClient::Command::SET_LAYER_VISIBLE_REGION:
+            case IComposerClient::Command::SET_LAYER_Z_ORDER:
+                return true;
+            default:
+                return false;
+        }
+    }
+
     void endCommand() {
         if (!mCommandEnd) {
             LOG_FATAL("beginCommand was not called");
@@ -459,6 +701,15 @@ class CommandWriterBase {
         }
 
         mCommandEnd = 0;
+
+        if (mCurrentLayerState && isLayerStateCommand(mCommandOpcode)) {
+            if (dropIfUnchanged()) {
+                return;
+            }
+        }
+        if (mCommandOpcode != static_cast<uint32_t>(IComposerClient::Command::SELECT_LAYER)) {
+            mPendingSelectLayer = false;
+        }
     }
 
     void write(uint32_t val) { mData[mDataWritten++] = val; }
@@ -565,14 +816,86 @@ class CommandWriterBase {
         mData = std::move(newData);
     }
 
+    // Compares the payload of the command just written against the cached
+    // state of the current layer, and drops it from the buffer if unchanged.
+    bool dropIfUnchanged() {
+        const uint32_t* begin = mData.get() + mCommandBegin + 1;
+        const uint32_t* end = mData.get() + mDataWritten;
+        auto& cached = (*mCurrentLayerState)[mCommandOpcode];
+        if (cached.size() == static_cast<size_t>(end - begin) &&
+            std::equal(begin, end, cached.begin())) {
+            mDataWritten = mCommandBegin;
+            return true;
+        }
+        cached.assign(begin, end);
+        return false;
+    }
+
+    void discardStaleData() {
+        size_t staleDataSize = mQueue ? mQueue->availableToRead() : 0;
+        if (staleDataSize > 0) {
+            ALOGW("discarding stale data from message queue");
+            // the cached layer state is not known to have reached the
+            // composer either
+            clearLayerStateCache();
+            CommandQueueType::MemTransaction tx;
+            if (mQueue->beginRead(staleDataSize, &tx)) {
+                mQueue->commitRead(staleDataSize);
+            }
+        }
+    }
+
+    void updateFrameStats(uint32_t chunkCount) {
+        mQueueStats.frames++;
+        mQueueStats.frameHighWaterMark = std::max(mQueueStats.frameHighWaterMark, mDataWritten);
+        mQueueStats.maxChunksPerFrame = std::max(mQueueStats.maxChunksPerFrame, chunkCount);
+        if (chunkCount > 1) {
+            mQueueStats.chunkedFrames++;
+        }
+    }
+
+    // Removes a SELECT_LAYER that is not followed by any command.
+    void dropPendingSelectLayer() {
+        if (mPendingSelectLayer && mDataWritten >= 1 + kSelectLayerLength) {
+            mDataWritten -= 1 + kSelectLayerLength;
+        }
+        mPendingSelectLayer = false;
+    }
+
     uint32_t mDataMaxSize;
+    // begin offset and opcode of the current command
+    uint32_t mCommandBegin = 0;
+    uint32_t mCommandOpcode = 0;
     // end offset of the current command
     uint32_t mCommandEnd;
 
+    // last payload written per display, layer and command
+    using LayerState = std::unordered_map<uint32_t, std::vector<uint32_t>>;
+    bool mLayerStateCacheEnabled = false;
+    std::unordered_map<Display, std::unordered_map<Layer, LayerState>> mLayerStateCache;
+    Display mCurrentDisplay = 0;
+    LayerState* mCurrentLayerState = nullptr;
+    bool mPendingSelectLayer = false;
+
     std::vector<hidl_handle> mDataHandles;
     std::vector<native_handle_t*> mTemporaryHandles;
 
     std::unique_ptr<CommandQueueType> mQueue;
+    // size of the queue created by writeQueueChunk
+    const uint32_t mQueueSize;
+    QueueStats mQueueStats;
+
+    // state of the frame being written by writeQueueChunk
+    static constexpr uint32_t kNoOffset = std::numeric_limits<uint32_t>::max();
+    bool mChunking = false;
+    uint32_t mChunkCount = 0;
+    uint32_t mChunkBegin = 0;
+    uint32_t mChunkPrefixLength = 0;
+    uint32_t mChunkPrefixDisplayOffset = kNoOffset;
+    uint32_t mChunkPrefixLayerOffset = kNoOffset;
+    uint32_t mChunkNext = 0;
+    uint32_t mChunkDisplayOffset = kNoOffset;
+    uint32_t mChunkLayerOffset = kNoOffset;
 };
 
 // This class helps parse a command queue.  Note that all sizes/lengths are in
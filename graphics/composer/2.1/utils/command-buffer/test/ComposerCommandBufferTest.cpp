@@ -0,0 +1,490 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ComposerCommandBufferTest"
+
+#include <composer-command-buffer/2.1/ComposerCommandBuffer.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace graphics {
+namespace composer {
+namespace V2_1 {
+namespace {
+
+using Command = IComposerClient::Command;
+
+constexpr Display kDisplay = 1;
+constexpr Display kOtherDisplay = 2;
+constexpr Layer kLayer = 10;
+constexpr Layer kOtherLayer = 11;
+
+// Reads the commands back as a list of opcodes.
+class TestCommandReader : public CommandReaderBase {
+  public:
+    std::vector<Command> parse() {
+        std::vector<Command> commands;
+        while (!isEmpty()) {
+            Command command;
+            uint16_t length;
+            if (!beginCommand(&command, &length)) {
+                ADD_FAILURE() << "bad command at " << mDataRead;
+                break;
+            }
+            commands.push_back(command);
+            mDataRead += length;
+            endCommand();
+        }
+        return commands;
+    }
+};
+
+class TestCommandWriter : public CommandWriterBase {
+  public:
+    explicit TestCommandWriter(uint32_t queueSize = 1024) : CommandWriterBase(queueSize) {}
+
+    // Queues the pending commands and reads them back, like the composer
+    // does in executeCommands.
+    std::vector<Command> queueCommands() {
+        uint32_t commandLength;
+        hidl_vec<hidl_handle> commandHandles;
+        queueWithoutReading(&commandLength, &commandHandles);
+        EXPECT_TRUE(mReader.readQueue(commandLength, commandHandles));
+        auto commands = mReader.parse();
+        mReader.reset();
+        reset();
+        return commands;
+    }
+
+    // Queues the pending commands as if executeCommands failed.
+    void queueWithoutReading(uint32_t* outCommandLength = nullptr,
+                             hidl_vec<hidl_handle>* outCommandHandles = nullptr) {
+        bool queueChanged = false;
+        uint32_t commandLength;
+        hidl_vec<hidl_handle> commandHandles;
+        EXPECT_TRUE(writeQueue(&queueChanged, outCommandLength ? outCommandLength : &commandLength,
+                               outCommandHandles ? outCommandHandles : &commandHandles));
+        if (queueChanged) {
+            EXPECT_TRUE(mReader.setMQDescriptor(*getMQDescriptor()));
+        }
+    }
+
+    struct Chunk {
+        bool queueChanged;
+        uint32_t length;
+        size_t handleCount;
+        std::vector<Command> commands;
+    };
+
+    // Queues the pending commands chunk by chunk and reads each one back.
+    std::vector<Chunk> queueChunks() {
+        std::vector<Chunk> chunks;
+        bool hasMore = true;
+        while (hasMore) {
+            Chunk chunk;
+            hidl_vec<hidl_handle> commandHandles;
+            if (!writeQueueChunk(&chunk.queueChanged, &chunk.length, &commandHandles, &hasMore)) {
+                ADD_FAILURE() << "failed to write chunk " << chunks.size();
+                break;
+            }
+            if (chunk.queueChanged) {
+                EXPECT_TRUE(mReader.setMQDescriptor(*getMQDescriptor()));
+            }
+            chunk.handleCount = commandHandles.size();
+            if (chunk.length > 0) {
+                EXPECT_TRUE(mReader.readQueue(chunk.length, commandHandles));
+                chunk.commands = mReader.parse();
+                mReader.reset();
+            }
+            chunks.push_back(std::move(chunk));
+        }
+        reset();
+        return chunks;
+    }
+
+  private:
+    TestCommandReader mReader;
+};
+
+class LayerStateCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override { mWriter.setLayerStateCacheEnabled(true); }
+
+    void writeLayerState(Display display, Layer layer) {
+        mWriter.selectDisplay(display);
+        mWriter.selectLayer(layer);
+        mWriter.setLayerDisplayFrame({0, 0, 100, 100});
+        mWriter.setLayerPlaneAlpha(1.0f);
+        mWriter.setLayerZOrder(3);
+    }
+
+    TestCommandWriter mWriter;
+};
+
+const std::vector<Command> kFullLayerState = {
+        Command::SELECT_DISPLAY,          Command::SELECT_LAYER,
+        Command::SET_LAYER_DISPLAY_FRAME, Command::SET_LAYER_PLANE_ALPHA,
+        Command::SET_LAYER_Z_ORDER,
+};
+
+TEST_F(LayerStateCacheTest, UnchangedStateIsDropped) {
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+
+    // the SELECT_LAYER is dropped along with the state that followed it
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(std::vector<Command>{Command::SELECT_DISPLAY}, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, ChangedStateIsWritten) {
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueCommands();
+
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerDisplayFrame({0, 0, 100, 100});
+    mWriter.setLayerPlaneAlpha(0.5f);
+    mWriter.setLayerZOrder(3);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_PLANE_ALPHA}),
+              mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, DisabledCacheWritesEverything) {
+    mWriter.setLayerStateCacheEnabled(false);
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueCommands();
+
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, DestroyedLayerIsForgotten) {
+    writeLayerState(kDisplay, kLayer);
+    writeLayerState(kDisplay, kOtherLayer);
+    mWriter.queueCommands();
+
+    // a new layer may reuse the id of a destroyed one
+    mWriter.clearLayerStateCache(kDisplay, kLayer);
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+
+    writeLayerState(kDisplay, kOtherLayer);
+    EXPECT_EQ(std::vector<Command>{Command::SELECT_DISPLAY}, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, ClearedDisplayIsForgotten) {
+    writeLayerState(kDisplay, kLayer);
+    writeLayerState(kOtherDisplay, kLayer);
+    mWriter.queueCommands();
+
+    mWriter.clearLayerStateCache(kDisplay);
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+
+    writeLayerState(kOtherDisplay, kLayer);
+    EXPECT_EQ(std::vector<Command>{Command::SELECT_DISPLAY}, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, ClearingEverythingForgetsAllDisplays) {
+    writeLayerState(kDisplay, kLayer);
+    writeLayerState(kOtherDisplay, kLayer);
+    mWriter.queueCommands();
+
+    mWriter.clearLayerStateCache();
+    writeLayerState(kDisplay, kLayer);
+    writeLayerState(kOtherDisplay, kLayer);
+    auto expected = kFullLayerState;
+    expected.insert(expected.end(), kFullLayerState.begin(), kFullLayerState.end());
+    EXPECT_EQ(expected, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, StateIsCachedPerDisplay) {
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueCommands();
+
+    // the same layer id on another display is another layer
+    writeLayerState(kOtherDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, HandlesAndCompositionTypesAreNeverDropped) {
+    const std::vector<Command> expected = {
+            Command::SELECT_DISPLAY,
+            Command::SELECT_LAYER,
+            Command::SET_LAYER_BUFFER,
+            Command::SET_LAYER_SIDEBAND_STREAM,
+            Command::SET_LAYER_COMPOSITION_TYPE,
+    };
+    for (int i = 0; i < 2; i++) {
+        mWriter.selectDisplay(kDisplay);
+        mWriter.selectLayer(kLayer);
+        mWriter.setLayerBuffer(0, nullptr, -1);
+        mWriter.setLayerSidebandStream(nullptr);
+        mWriter.setLayerCompositionType(IComposerClient::Composition::DEVICE);
+        EXPECT_EQ(expected, mWriter.queueCommands());
+    }
+}
+
+TEST_F(LayerStateCacheTest, DisablingForgetsEverything) {
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueCommands();
+
+    mWriter.setLayerStateCacheEnabled(false);
+    mWriter.setLayerStateCacheEnabled(true);
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, UnreadFrameForgetsEverything) {
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueWithoutReading();
+    mWriter.reset();
+
+    // the state of the last frame never reached the composer
+    writeLayerState(kDisplay, kLayer);
+    EXPECT_EQ(kFullLayerState, mWriter.queueCommands());
+}
+
+TEST_F(LayerStateCacheTest, EmptySelectLayerIsDropped) {
+    writeLayerState(kDisplay, kLayer);
+    mWriter.queueCommands();
+
+    writeLayerState(kDisplay, kLayer);
+    mWriter.selectLayer(kOtherLayer);
+    mWriter.setLayerZOrder(4);
+    mWriter.selectLayer(kLayer);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER}),
+              mWriter.queueCommands());
+}
+
+constexpr uint32_t kChunkQueueSize = 16;
+
+class QueueChunkTest : public ::testing::Test {
+  protected:
+    // SELECT_LAYER, SET_LAYER_Z_ORDER and SET_LAYER_DISPLAY_FRAME take 3, 2
+    // and 5 words.
+    void writeLayer(Layer layer) {
+        mWriter.selectLayer(layer);
+        mWriter.setLayerZOrder(static_cast<uint32_t>(layer));
+        mWriter.setLayerDisplayFrame({0, 0, 100, 100});
+    }
+
+    TestCommandWriter mWriter{kChunkQueueSize};
+};
+
+TEST_F(QueueChunkTest, SmallFrameIsOneChunk) {
+    mWriter.selectDisplay(kDisplay);
+    writeLayer(kLayer);
+    mWriter.validateDisplay();
+
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_TRUE(chunks[0].queueChanged);
+    EXPECT_EQ(14u, chunks[0].length);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER, Command::SET_LAYER_DISPLAY_FRAME,
+                                    Command::VALIDATE_DISPLAY}),
+              chunks[0].commands);
+}
+
+TEST_F(QueueChunkTest, EmptyFrameIsNoChunk) {
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(0u, chunks[0].length);
+    EXPECT_TRUE(chunks[0].commands.empty());
+}
+
+TEST_F(QueueChunkTest, LargeFrameIsSplitAtCommandBoundaries) {
+    mWriter.selectDisplay(kDisplay);
+    writeLayer(kLayer);
+    writeLayer(kOtherLayer);
+    mWriter.validateDisplay();
+
+    // 3 + 10 + 10 + 1 words
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(2u, chunks.size());
+    EXPECT_EQ(16u, chunks[0].length);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER, Command::SET_LAYER_DISPLAY_FRAME,
+                                    Command::SELECT_LAYER}),
+              chunks[0].commands);
+    // the display and layer the first chunk ended in are re-selected
+    EXPECT_EQ(14u, chunks[1].length);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER, Command::SET_LAYER_DISPLAY_FRAME,
+                                    Command::VALIDATE_DISPLAY}),
+              chunks[1].commands);
+    EXPECT_FALSE(chunks[1].queueChanged);
+}
+
+TEST_F(QueueChunkTest, LayerIsNotReselectedBeforeSelectLayer) {
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerDisplayFrame({0, 0, 100, 100});
+    mWriter.setLayerDisplayFrame({0, 0, 50, 50});
+    writeLayer(kOtherLayer);
+
+    // 3 + 3 + 5 + 5 words fill the queue
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(2u, chunks.size());
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_DISPLAY_FRAME,
+                                    Command::SET_LAYER_DISPLAY_FRAME}),
+              chunks[0].commands);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER, Command::SET_LAYER_DISPLAY_FRAME}),
+              chunks[1].commands);
+    EXPECT_EQ(13u, chunks[1].length);
+}
+
+TEST_F(QueueChunkTest, ChunkLocationsMapToFrameOffsets) {
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerDisplayFrame({0, 0, 100, 100});
+    mWriter.setLayerDisplayFrame({0, 0, 50, 50});
+    mWriter.setLayerZOrder(1);
+
+    bool queueChanged;
+    uint32_t length;
+    hidl_vec<hidl_handle> handles;
+    bool hasMore;
+    ASSERT_TRUE(mWriter.writeQueueChunk(&queueChanged, &length, &handles, &hasMore));
+    ASSERT_TRUE(hasMore);
+    EXPECT_EQ(11u, mWriter.getChunkCommandOffset(11));
+
+    ASSERT_TRUE(mWriter.writeQueueChunk(&queueChanged, &length, &handles, &hasMore));
+    ASSERT_FALSE(hasMore);
+    // the re-selected display and layer map to the commands they repeat
+    EXPECT_EQ(0u, mWriter.getChunkCommandOffset(0));
+    EXPECT_EQ(3u, mWriter.getChunkCommandOffset(3));
+    // SET_LAYER_Z_ORDER follows the second SET_LAYER_DISPLAY_FRAME
+    EXPECT_EQ(16u, mWriter.getChunkCommandOffset(6));
+}
+
+TEST_F(QueueChunkTest, HandlesAreCarriedByEveryChunk) {
+    native_handle_t* buffer = native_handle_create(0, 0);
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerBuffer(0, buffer, -1);
+    writeLayer(kOtherLayer);
+
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(2u, chunks.size());
+    EXPECT_EQ(1u, chunks[0].handleCount);
+    EXPECT_EQ(1u, chunks[1].handleCount);
+    native_handle_delete(buffer);
+}
+
+TEST_F(QueueChunkTest, QueueKeepsItsSizeAcrossFrames) {
+    for (int frame = 0; frame < 2; frame++) {
+        mWriter.selectDisplay(kDisplay);
+        writeLayer(kLayer);
+        writeLayer(kOtherLayer);
+
+        auto chunks = mWriter.queueChunks();
+        ASSERT_EQ(2u, chunks.size());
+        EXPECT_EQ(frame == 0, chunks[0].queueChanged);
+        EXPECT_FALSE(chunks[1].queueChanged);
+    }
+}
+
+TEST_F(QueueChunkTest, OversizedCommandReplacesQueue) {
+    const std::vector<IComposerClient::Rect> region(8, {0, 0, 10, 10});
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerVisibleRegion(region);
+    mWriter.setLayerZOrder(1);
+
+    auto chunks = mWriter.queueChunks();
+    ASSERT_EQ(3u, chunks.size());
+    EXPECT_TRUE(chunks[0].queueChanged);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER}),
+              chunks[0].commands);
+    // SELECT_DISPLAY, SELECT_LAYER and 1 + 32 words of region
+    EXPECT_TRUE(chunks[1].queueChanged);
+    EXPECT_EQ(39u, chunks[1].length);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_VISIBLE_REGION}),
+              chunks[1].commands);
+    EXPECT_FALSE(chunks[2].queueChanged);
+    EXPECT_EQ((std::vector<Command>{Command::SELECT_DISPLAY, Command::SELECT_LAYER,
+                                    Command::SET_LAYER_Z_ORDER}),
+              chunks[2].commands);
+}
+
+TEST_F(QueueChunkTest, QueueStatsTrackFramesAndChunks) {
+    EXPECT_EQ(kChunkQueueSize, mWriter.getRecommendedQueueSize());
+
+    mWriter.selectDisplay(kDisplay);
+    writeLayer(kLayer);
+    ASSERT_EQ(1u, mWriter.queueChunks().size());
+
+    // 3 + 10 + 10 words
+    mWriter.selectDisplay(kDisplay);
+    writeLayer(kLayer);
+    writeLayer(kOtherLayer);
+    ASSERT_EQ(2u, mWriter.queueChunks().size());
+
+    const auto& stats = mWriter.getQueueStats();
+    EXPECT_EQ(2u, stats.frames);
+    EXPECT_EQ(23u, stats.frameHighWaterMark);
+    EXPECT_EQ(1u, stats.chunkedFrames);
+    EXPECT_EQ(2u, stats.maxChunksPerFrame);
+    EXPECT_EQ(0u, stats.oversizedCommandReplacements);
+    // the next power of two that holds the largest frame in one chunk
+    EXPECT_EQ(32u, mWriter.getRecommendedQueueSize());
+}
+
+TEST_F(QueueChunkTest, QueueStatsCountOversizedCommands) {
+    const std::vector<IComposerClient::Rect> region(8, {0, 0, 10, 10});
+    mWriter.selectDisplay(kDisplay);
+    mWriter.selectLayer(kLayer);
+    mWriter.setLayerVisibleRegion(region);
+    mWriter.setLayerZOrder(1);
+    ASSERT_EQ(3u, mWriter.queueChunks().size());
+
+    // the first queue is created, not replaced
+    const auto& stats = mWriter.getQueueStats();
+    EXPECT_EQ(1u, stats.oversizedCommandReplacements);
+    EXPECT_EQ(3u, stats.maxChunksPerFrame);
+    // 3 + 3 + 33 + 2 words
+    EXPECT_EQ(41u, stats.frameHighWaterMark);
+    EXPECT_EQ(64u, mWriter.getRecommendedQueueSize());
+}
+
+TEST_F(QueueChunkTest, QueueStatsCountUnchunkedFrames) {
+    mWriter.selectDisplay(kDisplay);
+    writeLayer(kLayer);
+    writeLayer(kOtherLayer);
+    mWriter.queueCommands();
+
+    const auto& stats = mWriter.getQueueStats();
+    EXPECT_EQ(1u, stats.frames);
+    EXPECT_EQ(0u, stats.chunkedFrames);
+    EXPECT_EQ(1u, stats.maxChunksPerFrame);
+    EXPECT_EQ(32u, mWriter.getRecommendedQueueSize());
+}
+
+}  // namespace
+}  // namespace V2_1
+}  // namespace composer
+}  // namespace graphics
+}  // namespace hardware
+}  // namespace android
@@ -73,6 +73,8 @@ class ComposerClientImpl : public Interface {
             ALOGE("failed to create composer resources");
             return false;
         }
+        // buffers replaced while executing commands are freed after the reply
+        mResources->setDeferredHandleRelease(true);
 
         mCommandEngine = createCommandEngine();
 
@@ -317,6 +319,7 @@ class ComposerClientImpl : public Interface {
         hidl_cb(error, outChanged, outLength, outHandles);
 
         mCommandEngine->reset();
+        mResources->freeReplacedHandles();
 
         return Void();
     }
@@ -379,6 +382,9 @@ class ComposerClientImpl : public Interface {
         } else {
             ALOGE("Can't clean output buffer cache for display %" PRIu64, display);
         }
+
+        // the replaced handles are not freed by an executeCommands call
+        resources->freeReplacedHandles();
     }
 
     void destroyResources() {
@@ -25,8 +25,10 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #include <hardware/hwcomposer.h>
@@ -108,6 +110,12 @@ HWC2On1Adapter::HWC2On1Adapter(hwc_composer_device_1_t* hwc1Device)
     mDisplays(),
     mHwc1DisplayMap()
 {
+    static_assert(HWC_NUM_DISPLAY_TYPES == kNumHwc1DisplayTypes,
+            "Unexpected number of HWC1 display types");
+    for (auto& displayId : mHwc1DisplayIds) {
+        displayId = kNoDisplayId;
+    }
+
     common.close = closeHook;
     getCapabilities = getCapabilitiesHook;
     getFunction = getFunctionHook;
@@ -328,6 +336,7 @@ Error HWC2On1Adapter::createVirtualDisplay(uint32_t width,
     mHwc1VirtualDisplay->populateConfigs(width, height);
     const auto displayId = mHwc1VirtualDisplay->getId();
     mHwc1DisplayMap[HWC_DISPLAY_VIRTUAL] = displayId;
+    setHwc1DisplayId(HWC_DISPLAY_VIRTUAL, displayId);
     mHwc1VirtualDisplay->setHwc1Id(HWC_DISPLAY_VIRTUAL);
     mDisplays.emplace(displayId, mHwc1VirtualDisplay);
     *outDisplay = displayId;
@@ -344,6 +353,7 @@ Error HWC2On1Adapter::destroyVirtualDisplay(hwc2_display_t displayId) {
 
     mHwc1VirtualDisplay.reset();
     mHwc1DisplayMap.erase(HWC_DISPLAY_VIRTUAL);
+    setHwc1DisplayId(HWC_DISPLAY_VIRTUAL, kNoDisplayId);
     mDisplays.erase(displayId);
 
     return Error::None;
@@ -424,7 +434,7 @@ Error HWC2On1Adapter::registerCallback(Callback descriptor,
     ALOGV("registerCallback(%s, %p, %p)", to_string(descriptor).c_str(),
             callbackData, pointer);
 
-    std::unique_lock<std::recursive_timed_mutex> lock(mStateMutex);
+    std::unique_lock<std::mutex> lock(mCallbackMutex);
 
     if (pointer != nullptr) {
         mCallbacks[descriptor] = {callbackData, pointer};
@@ -442,43 +452,47 @@ Error HWC2On1Adapter::registerCallback(Callback descriptor,
     if (descriptor == Callback::Refresh) {
         hasPendingInvalidate = mHasPendingInvalidate;
         if (hasPendingInvalidate) {
-            for (auto& displayPair : mDisplays) {
-                displayIds.emplace_back(displayPair.first);
+            for (int hwc1DisplayId = 0; hwc1DisplayId < kNumHwc1DisplayTypes;
+                    ++hwc1DisplayId) {
+                auto displayId = getHwc1DisplayId(hwc1DisplayId);
+                if (displayId != kNoDisplayId) {
+                    displayIds.emplace_back(displayId);
+                }
             }
         }
         mHasPendingInvalidate = false;
     } else if (descriptor == Callback::Vsync) {
         for (auto pending : mPendingVsyncs) {
             auto hwc1DisplayId = pending.first;
-            if (mHwc1DisplayMap.count(hwc1DisplayId) == 0) {
+            auto displayId = getHwc1DisplayId(hwc1DisplayId);
+            if (displayId == kNoDisplayId) {
                 ALOGE("hwc1Vsync: Couldn't find display for HWC1 id %d",
                         hwc1DisplayId);
                 continue;
             }
-            auto displayId = mHwc1DisplayMap[hwc1DisplayId];
             auto timestamp = pending.second;
             pendingVsyncs.emplace_back(displayId, timestamp);
         }
         mPendingVsyncs.clear();
     } else if (descriptor == Callback::Hotplug) {
         // Hotplug the primary display
-        pendingHotplugs.emplace_back(mHwc1DisplayMap[HWC_DISPLAY_PRIMARY],
+        pendingHotplugs.emplace_back(getHwc1DisplayId(HWC_DISPLAY_PRIMARY),
                 static_cast<int32_t>(Connection::Connected));
 
         for (auto pending : mPendingHotplugs) {
             auto hwc1DisplayId = pending.first;
-            if (mHwc1DisplayMap.count(hwc1DisplayId) == 0) {
+            auto displayId = getHwc1DisplayId(hwc1DisplayId);
+            if (displayId == kNoDisplayId) {
                 ALOGE("hwc1Hotplug: Couldn't find display for HWC1 id %d",
                         hwc1DisplayId);
                 continue;
             }
-            auto displayId = mHwc1DisplayMap[hwc1DisplayId];
             auto connected = pending.second;
             pendingHotplugs.emplace_back(displayId, connected);
         }
     }
 
-    // Call pending callbacks without the state lock held
+    // Call pending callbacks without the callback lock held
     lock.unlock();
 
     if (hasPendingInvalidate) {
@@ -511,6 +525,7 @@ HWC2On1Adapter::Display::Display(HWC2On1Adapter& device, HWC2::DisplayType type)
     mDevice(device),
     mStateMutex(),
     mHwc1RequestedContents(nullptr),
+    mHwc1RequestedContentsSize(0),
     mRetireFence(),
     mChanges(),
     mHwc1Id(-1),
@@ -562,7 +577,9 @@ Error HWC2On1Adapter::Display::acceptChanges() {
 Error HWC2On1Adapter::Display::createLayer(hwc2_layer_t* outLayerId) {
     std::unique_lock<std::recursive_mutex> lock(mStateMutex);
 
-    auto layer = *mLayers.emplace(std::make_shared<Layer>(*this));
+    auto layer = std::make_shared<Layer>(*this);
+    mLayers.insert(std::upper_bound(mLayers.begin(), mLayers.end(), layer,
+            SortLayersByZ()), layer);
     mDevice.mLayers.emplace(std::make_pair(layer->getId(), layer));
     *outLayerId = layer->getId();
     ALOGV("[%" PRIu64 "] created layer %" PRIu64, mId, *outLayerId);
@@ -581,12 +598,11 @@ Error HWC2On1Adapter::Display::destroyLayer(hwc2_layer_t layerId) {
     }
     const auto layer = mapLayer->second;
     mDevice.mLayers.erase(mapLayer);
-    const auto zRange = mLayers.equal_range(layer);
-    for (auto current = zRange.first; current != zRange.second; ++current) {
-        if (**current == *layer) {
-            current = mLayers.erase(current);
-            break;
-        }
+    const auto zRange = std::equal_range(mLayers.begin(), mLayers.end(), layer,
+            SortLayersByZ());
+    const auto current = std::find(zRange.first, zRange.second, layer);
+    if (current != zRange.second) {
+        mLayers.erase(current);
     }
     ALOGV("[%" PRIu64 "] destroyed layer %" PRIu64, mId, layerId);
     markGeometryChanged();
@@ -829,6 +845,8 @@ Error HWC2On1Adapter::Display::setActiveConfig(hwc2_config_t configId) {
             return Error::BadConfig;
         }
         mActiveConfig = config;
+        // The framebuffer target is sized after the active config
+        markGeometryChanged();
     }
 
     return Error::None;
@@ -883,7 +901,12 @@ Error HWC2On1Adapter::Display::setColorTransform(android_color_transform_t hint)
 
     ALOGV("%" PRIu64 "] setColorTransform(%d)", mId,
             static_cast<int32_t>(hint));
-    mHasColorTransform = (hint != HAL_COLOR_TRANSFORM_IDENTITY);
+    bool hasColorTransform = (hint != HAL_COLOR_TRANSFORM_IDENTITY);
+    if (hasColorTransform != mHasColorTransform) {
+        // This changes which layers HWC1 is allowed to compose
+        mHasColorTransform = hasColorTransform;
+        markGeometryChanged();
+    }
     return Error::None;
 }
 
@@ -1001,28 +1024,33 @@ Error HWC2On1Adapter::Display::updateLayerZ(hwc2_layer_t layerId, uint32_t z) {
     }
 
     const auto layer = mapLayer->second;
-    const auto zRange = mLayers.equal_range(layer);
-    bool layerOnDisplay = false;
-    for (auto current = zRange.first; current != zRange.second; ++current) {
-        if (**current == *layer) {
-            if ((*current)->getZ() == z) {
-                // Don't change anything if the Z hasn't changed
-                return Error::None;
-            }
-            current = mLayers.erase(current);
-            layerOnDisplay = true;
-            break;
-        }
-    }
-
-    if (!layerOnDisplay) {
+    const auto zRange = std::equal_range(mLayers.begin(), mLayers.end(), layer,
+            SortLayersByZ());
+    const auto current = std::find(zRange.first, zRange.second, layer);
+    if (current == zRange.second) {
         ALOGE("[%" PRIu64 "] updateLayerZ failed to find layer on display",
                 mId);
         return Error::BadLayer;
     }
 
+    if (layer->getZ() == z) {
+        // Don't change anything if the Z hasn't changed
+        return Error::None;
+    }
+
+    // Move the layer to its new position in place, placing it after any layers
+    // already at the new Z. Only the layers in between are shifted.
+    const uint32_t oldZ = layer->getZ();
     layer->setZ(z);
-    mLayers.emplace(std::move(layer));
+    if (z > oldZ) {
+        auto target = std::upper_bound(current + 1, mLayers.end(), layer,
+                SortLayersByZ());
+        std::rotate(current, current + 1, target);
+    } else {
+        auto target = std::upper_bound(mLayers.begin(), current, layer,
+                SortLayersByZ());
+        std::rotate(target, current, current + 1);
+    }
     markGeometryChanged();
 
     return Error::None;
@@ -1214,14 +1242,16 @@ bool HWC2On1Adapter::Display::prepare() {
         return false;
     }
 
+    if (!mGeometryChanged && mHwc1RequestedContents) {
+        refreshRequestedContents();
+        return true;
+    }
+
     allocateRequestedContents();
     assignHwc1LayerIds();
 
     mHwc1RequestedContents->retireFenceFd = -1;
-    mHwc1RequestedContents->flags = 0;
-    if (mGeometryChanged) {
-        mHwc1RequestedContents->flags |= HWC_GEOMETRY_CHANGED;
-    }
+    mHwc1RequestedContents->flags = HWC_GEOMETRY_CHANGED;
     mHwc1RequestedContents->outbuf = mOutputBuffer.getBuffer();
     mHwc1RequestedContents->outbufAcquireFenceFd = mOutputBuffer.getFence();
 
@@ -1242,6 +1272,32 @@ bool HWC2On1Adapter::Display::prepare() {
     return true;
 }
 
+void HWC2On1Adapter::Display::refreshRequestedContents() {
+    ATRACE_CALL();
+
+    mHwc1RequestedContents->retireFenceFd = -1;
+    mHwc1RequestedContents->flags = 0;
+    mHwc1RequestedContents->outbuf = mOutputBuffer.getBuffer();
+    mHwc1RequestedContents->outbufAcquireFenceFd = mOutputBuffer.getFence();
+
+    // The layer list is unchanged since the contents were built, so the HWC1
+    // ids assigned back then are still valid.
+    for (size_t hwc1Id = 0; hwc1Id < mHwc1LayerMap.size(); ++hwc1Id) {
+        auto& hwc1Layer = mHwc1RequestedContents->hwLayers[hwc1Id];
+        hwc1Layer.releaseFenceFd = -1;
+        hwc1Layer.acquireFenceFd = -1;
+        hwc1Layer.hints = 0;
+        mHwc1LayerMap[hwc1Id]->applyFrameState(hwc1Layer);
+    }
+
+    auto& hwc1Target = mHwc1RequestedContents->hwLayers[mHwc1LayerMap.size()];
+    hwc1Target.compositionType = HWC_FRAMEBUFFER_TARGET;
+    hwc1Target.handle = nullptr;
+    hwc1Target.hints = 0;
+    hwc1Target.releaseFenceFd = -1;
+    hwc1Target.acquireFenceFd = -1;
+}
+
 void HWC2On1Adapter::Display::generateChanges() {
     std::unique_lock<std::recursive_mutex> lock(mStateMutex);
 
@@ -1250,7 +1306,7 @@ void HWC2On1Adapter::Display::generateChanges() {
     size_t numLayers = mHwc1RequestedContents->numHwLayers;
     for (size_t hwc1Id = 0; hwc1Id < numLayers; ++hwc1Id) {
         const auto& receivedLayer = mHwc1RequestedContents->hwLayers[hwc1Id];
-        if (mHwc1LayerMap.count(hwc1Id) == 0) {
+        if (hwc1Id >= mHwc1LayerMap.size()) {
             ALOGE_IF(receivedLayer.compositionType != HWC_FRAMEBUFFER_TARGET,
                     "generateChanges: HWC1 layer %zd doesn't have a"
                     " matching HWC2 layer, and isn't the framebuffer target",
@@ -1317,7 +1373,7 @@ void HWC2On1Adapter::Display::addReleaseFences(
     size_t numLayers = hwcContents.numHwLayers;
     for (size_t hwc1Id = 0; hwc1Id < numLayers; ++hwc1Id) {
         const auto& receivedLayer = hwcContents.hwLayers[hwc1Id];
-        if (mHwc1LayerMap.count(hwc1Id) == 0) {
+        if (hwc1Id >= mHwc1LayerMap.size()) {
             if (receivedLayer.compositionType != HWC_FRAMEBUFFER_TARGET) {
                 ALOGE("addReleaseFences: HWC1 layer %zd doesn't have a"
                         " matching HWC2 layer, and isn't the framebuffer"
@@ -1807,18 +1863,23 @@ void HWC2On1Adapter::Display::allocateRequestedContents() {
     size_t size = sizeof(hwc_display_contents_1_t) +
             sizeof(hwc_layer_1_t) * numLayers +
             sizeof(hwc_rect_t) * numRects;
-    auto contents = static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1));
-    mHwc1RequestedContents.reset(contents);
+    if (mHwc1RequestedContents && size <= mHwc1RequestedContentsSize) {
+        std::memset(mHwc1RequestedContents.get(), 0, size);
+    } else {
+        auto contents = static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1));
+        mHwc1RequestedContents.reset(contents);
+        mHwc1RequestedContentsSize = size;
+    }
+    auto contents = mHwc1RequestedContents.get();
     mNextAvailableRect = reinterpret_cast<hwc_rect_t*>(&contents->hwLayers[numLayers]);
     mNumAvailableRects = numRects;
 }
 
 void HWC2On1Adapter::Display::assignHwc1LayerIds() {
-    mHwc1LayerMap.clear();
-    size_t nextHwc1Id = 0;
-    for (auto& layer : mLayers) {
-        mHwc1LayerMap[nextHwc1Id] = layer;
-        layer->setHwc1Id(nextHwc1Id++);
+    // mLayers is already sorted by Z, so a layer's HWC1 id is its index.
+    mHwc1LayerMap = mLayers;
+    for (size_t hwc1Id = 0; hwc1Id < mHwc1LayerMap.size(); ++hwc1Id) {
+        mHwc1LayerMap[hwc1Id]->setHwc1Id(hwc1Id);
     }
 }
 
@@ -2047,6 +2108,10 @@ const sp<MiniFence>& HWC2On1Adapter::Layer::getReleaseFence() const {
 
 void HWC2On1Adapter::Layer::applyState(hwc_layer_1_t& hwc1Layer) {
     applyCommonState(hwc1Layer);
+    applyFrameState(hwc1Layer);
+}
+
+void HWC2On1Adapter::Layer::applyFrameState(hwc_layer_1_t& hwc1Layer) {
     applyCompositionType(hwc1Layer);
     switch (mCompositionType) {
         case Composition::SolidColor : applySolidColorState(hwc1Layer); break;
@@ -2301,11 +2366,24 @@ std::tuple<HWC2On1Adapter::Layer*, Error> HWC2On1Adapter::getLayer(
     return std::make_tuple(layer.get(), Error::None);
 }
 
+void HWC2On1Adapter::setHwc1DisplayId(int hwc1DisplayId,
+        hwc2_display_t displayId) {
+    mHwc1DisplayIds[hwc1DisplayId] = displayId;
+}
+
+hwc2_display_t HWC2On1Adapter::getHwc1DisplayId(int hwc1DisplayId) const {
+    if (hwc1DisplayId < 0 || hwc1DisplayId >= kNumHwc1DisplayTypes) {
+        return kNoDisplayId;
+    }
+    return mHwc1DisplayIds[hwc1DisplayId];
+}
+
 void HWC2On1Adapter::populatePrimary() {
     std::unique_lock<std::recursive_timed_mutex> lock(mStateMutex);
 
     auto display = std::make_shared<Display>(*this, HWC2::DisplayType::Physical);
     mHwc1DisplayMap[HWC_DISPLAY_PRIMARY] = display->getId();
+    setHwc1DisplayId(HWC_DISPLAY_PRIMARY, display->getId());
     display->setHwc1Id(HWC_DISPLAY_PRIMARY);
     display->populateConfigs();
     mDisplays.emplace(display->getId(), std::move(display));
@@ -2529,7 +2607,7 @@ Error HWC2On1Adapter::setAllDisplays() {
 void HWC2On1Adapter::hwc1Invalidate() {
     ALOGV("Received hwc1Invalidate");
 
-    std::unique_lock<std::recursive_timed_mutex> lock(mStateMutex);
+    std::unique_lock<std::mutex> lock(mCallbackMutex);
 
     // If the HWC2-side callback hasn't been registered yet, buffer this until
     // it is registered.
@@ -2538,15 +2616,20 @@ void HWC2On1Adapter::hwc1Invalidate() {
         return;
     }
 
-    const auto& callbackInfo = mCallbacks[Callback::Refresh];
-    std::vector<hwc2_display_t> displays;
-    for (const auto& displayPair : mDisplays) {
-        displays.emplace_back(displayPair.first);
-    }
+    const auto callbackInfo = mCallbacks[Callback::Refresh];
 
-    // Call back without the state lock held.
+    // Call back without the callback lock held.
     lock.unlock();
 
+    std::vector<hwc2_display_t> displays;
+    for (int hwc1DisplayId = 0; hwc1DisplayId < kNumHwc1DisplayTypes;
+            ++hwc1DisplayId) {
+        auto displayId = getHwc1DisplayId(hwc1DisplayId);
+        if (displayId != kNoDisplayId) {
+            displays.emplace_back(displayId);
+        }
+    }
+
     auto refresh = reinterpret_cast<HWC2_PFN_REFRESH>(callbackInfo.pointer);
     for (auto display : displays) {
         refresh(callbackInfo.data, display);
@@ -2556,7 +2639,9 @@ void HWC2On1Adapter::hwc1Invalidate() {
 void HWC2On1Adapter::hwc1Vsync(int hwc1DisplayId, int64_t timestamp) {
     ALOGV("Received hwc1Vsync(%d, %" PRId64 ")", hwc1DisplayId, timestamp);
 
-    std::unique_lock<std::recursive_timed_mutex> lock(mStateMutex);
+    // Vsync only needs the callback state, so it never waits for a frame being
+    // prepared or set on HWC1.
+    std::unique_lock<std::mutex> lock(mCallbackMutex);
 
     // If the HWC2-side callback hasn't been registered yet, buffer this until
     // it is registered.
@@ -2565,15 +2650,15 @@ void HWC2On1Adapter::hwc1Vsync(int hwc1DisplayId, int64_t timestamp) {
         return;
     }
 
-    if (mHwc1DisplayMap.count(hwc1DisplayId) == 0) {
+    auto displayId = getHwc1DisplayId(hwc1DisplayId);
+    if (displayId == kNoDisplayId) {
         ALOGE("hwc1Vsync: Couldn't find display for HWC1 id %d", hwc1DisplayId);
         return;
     }
 
-    const auto& callbackInfo = mCallbacks[Callback::Vsync];
-    auto displayId = mHwc1DisplayMap[hwc1DisplayId];
+    const auto callbackInfo = mCallbacks[Callback::Vsync];
 
-    // Call back without the state lock held.
+    // Call back without the callback lock held.
     lock.unlock();
 
     auto vsync = reinterpret_cast<HWC2_PFN_VSYNC>(callbackInfo.pointer);
@@ -2604,6 +2689,7 @@ void HWC2On1Adapter::hwc1Hotplug(int hwc1DisplayId, int connected) {
         display->populateConfigs();
         displayId = display->getId();
         mHwc1DisplayMap[HWC_DISPLAY_EXTERNAL] = displayId;
+        setHwc1DisplayId(HWC_DISPLAY_EXTERNAL, displayId);
         mDisplays.emplace(displayId, std::move(display));
     } else {
         if (connected != 0) {
@@ -2615,9 +2701,14 @@ void HWC2On1Adapter::hwc1Hotplug(int hwc1DisplayId, int connected) {
         // Disconnect an existing display
         displayId = mHwc1DisplayMap[hwc1DisplayId];
         mHwc1DisplayMap.erase(HWC_DISPLAY_EXTERNAL);
+        setHwc1DisplayId(HWC_DISPLAY_EXTERNAL, kNoDisplayId);
         mDisplays.erase(displayId);
     }
 
+    // The display list is updated; the rest only needs the callback state
+    lock.unlock();
+    std::unique_lock<std::mutex> callbackLock(mCallbackMutex);
+
     // If the HWC2-side callback hasn't been registered yet, buffer this until
     // it is registered
     if (mCallbacks.count(Callback::Hotplug) == 0) {
@@ -2625,10 +2716,10 @@ void HWC2On1Adapter::hwc1Hotplug(int hwc1DisplayId, int connected) {
         return;
     }
 
-    const auto& callbackInfo = mCallbacks[Callback::Hotplug];
+    const auto callbackInfo = mCallbacks[Callback::Hotplug];
 
-    // Call back without the state lock held
-    lock.unlock();
+    // Call back without the callback lock held
+    callbackLock.unlock();
 
     auto hotplug = reinterpret_cast<HWC2_PFN_HOTPLUG>(callbackInfo.pointer);
     auto hwc2Connected = (connected == 0) ?
@@ -410,12 +410,20 @@ private:
 
             // Allocate RAM able to store all layers and rects used for
             // communication with HWC1. Place allocated RAM in variable
-            // mHwc1RequestedContents.
+            // mHwc1RequestedContents. The previous allocation is reused when
+            // it is large enough.
             void allocateRequestedContents();
 
+            // Called from prepare() when neither the layer list nor any
+            // geometry has changed since the last prepare(): only the
+            // per-frame state (buffers, fences, composition types) of the
+            // already built HWC1 contents is refreshed.
+            void refreshRequestedContents();
+
             // Array of structs exchanged between client and hwc1 device.
             // Sent to device upon calling prepare().
             std::unique_ptr<hwc_display_contents_1> mHwc1RequestedContents;
+            size_t mHwc1RequestedContentsSize;
     private:
             DeferredFence mRetireFence;
 
@@ -442,12 +450,14 @@ private:
 
             bool mHasColorTransform;
 
-            // All layers this Display is aware of.
-            std::multiset<std::shared_ptr<Layer>, SortLayersByZ> mLayers;
+            // All layers this Display is aware of, sorted by Z. Layers with
+            // the same Z keep the order in which they were placed there.
+            std::vector<std::shared_ptr<Layer>> mLayers;
 
-            // Mapping between layer index in array of hwc_display_contents_1*
-            // passed to HWC1 during validate/set and Layer object.
-            std::unordered_map<size_t, std::shared_ptr<Layer>> mHwc1LayerMap;
+            // Layer object for each layer index in array of
+            // hwc_display_contents_1* passed to HWC1 during validate/set.
+            // Only rebuilt along with the HWC1 contents.
+            std::vector<std::shared_ptr<Layer>> mHwc1LayerMap;
 
             // All communication with HWC1 via prepare/set is done with one
             // alloc. This pointer is pointing to a pool of hwc_rect_t.
@@ -563,6 +573,10 @@ private:
             // Write state to HWC1 communication struct.
             void applyState(struct hwc_layer_1& hwc1Layer);
 
+            // Write only the state which may change without a geometry
+            // change: composition type, buffer/color/sideband and fences.
+            void applyFrameState(struct hwc_layer_1& hwc1Layer);
+
             std::string dump() const;
 
             std::size_t getNumVisibleRegions() { return mVisibleRegion.size(); }
@@ -711,6 +725,12 @@ private:
     // calling prepare.
     std::recursive_timed_mutex mStateMutex;
 
+    // The callback state below is protected by this mutex instead of
+    // mStateMutex, so that vsync and invalidate callbacks from HWC1 never wait
+    // for a prepare() or set() in progress. It is never held while calling
+    // into HWC1, nor while acquiring mStateMutex.
+    std::mutex mCallbackMutex;
+
     struct CallbackInfo {
         hwc2_callback_data_t data;
         hwc2_function_pointer_t pointer;
@@ -731,6 +751,14 @@ private:
     // Map HWC1 display type (HWC_DISPLAY_PRIMARY, HWC_DISPLAY_EXTERNAL,
     // HWC_DISPLAY_VIRTUAL) to Display IDs generated by HWC2on1Adapter objects.
     std::unordered_map<int, hwc2_display_t> mHwc1DisplayMap;
+
+    // Copy of mHwc1DisplayMap readable without mStateMutex, for the HWC1
+    // callbacks. kNoDisplayId (Display IDs start at 1) for unmapped types.
+    static constexpr hwc2_display_t kNoDisplayId = 0;
+    static constexpr int kNumHwc1DisplayTypes = 3;
+    std::atomic<hwc2_display_t> mHwc1DisplayIds[kNumHwc1DisplayTypes];
+    void setHwc1DisplayId(int hwc1DisplayId, hwc2_display_t displayId);
+    hwc2_display_t getHwc1DisplayId(int hwc1DisplayId) const;
 };
 
 } // namespace android
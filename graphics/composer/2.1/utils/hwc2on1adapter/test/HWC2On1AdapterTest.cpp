@@ -0,0 +1,370 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hwc2on1adapter/HWC2On1Adapter.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <hardware/hwcomposer.h>
+
+namespace android {
+namespace {
+
+// What the fake HWC1 device was given for the primary display in prepare().
+struct PreparedFrame {
+    const hwc_display_contents_1_t* contents;
+    uint32_t flags;
+    std::vector<buffer_handle_t> handles;
+    std::vector<uint32_t> layerFlags;
+    hwc_rect_t targetFrame;
+};
+
+struct DisplayConfig {
+    int32_t width;
+    int32_t height;
+};
+
+// An HWC1.4 device with a primary display only. Layers HWC1 is allowed to
+// compose are put on overlays.
+class FakeHwc1Device : public hwc_composer_device_1_t {
+  public:
+    FakeHwc1Device() {
+        hwc_composer_device_1_t* device = this;
+        *device = {};
+        common.tag = HARDWARE_DEVICE_TAG;
+        common.version = HWC_DEVICE_API_VERSION_1_4;
+        common.close = closeHook;
+        prepare = prepareHook;
+        set = setHook;
+        query = queryHook;
+        registerProcs = registerProcsHook;
+        getDisplayConfigs = getDisplayConfigsHook;
+        getDisplayAttributes = getDisplayAttributesHook;
+        getActiveConfig = getActiveConfigHook;
+        setActiveConfig = setActiveConfigHook;
+    }
+
+    std::vector<DisplayConfig> configs = {{1080, 1920}, {720, 1280}};
+    int activeConfig = 0;
+    std::vector<PreparedFrame> preparedFrames;
+
+  private:
+    static FakeHwc1Device* getDevice(hwc_composer_device_1_t* device) {
+        return static_cast<FakeHwc1Device*>(device);
+    }
+
+    static int closeHook(hw_device_t* /*device*/) { return 0; }
+
+    static int prepareHook(hwc_composer_device_1_t* device,
+            size_t numDisplays, hwc_display_contents_1_t** displays) {
+        if (numDisplays == 0 || displays[HWC_DISPLAY_PRIMARY] == nullptr) {
+            return 0;
+        }
+
+        auto contents = displays[HWC_DISPLAY_PRIMARY];
+        PreparedFrame frame = {};
+        frame.contents = contents;
+        frame.flags = contents->flags;
+        for (size_t l = 0; l < contents->numHwLayers; ++l) {
+            auto& layer = contents->hwLayers[l];
+            if (layer.compositionType == HWC_FRAMEBUFFER_TARGET) {
+                frame.targetFrame = layer.displayFrame;
+                continue;
+            }
+            frame.handles.push_back(layer.handle);
+            frame.layerFlags.push_back(layer.flags);
+            if (layer.compositionType == HWC_FRAMEBUFFER &&
+                    (layer.flags & HWC_SKIP_LAYER) == 0) {
+                layer.compositionType = HWC_OVERLAY;
+            }
+        }
+        getDevice(device)->preparedFrames.push_back(std::move(frame));
+        return 0;
+    }
+
+    static int setHook(hwc_composer_device_1_t* /*device*/,
+            size_t numDisplays, hwc_display_contents_1_t** displays) {
+        for (size_t d = 0; d < numDisplays; ++d) {
+            if (displays[d] != nullptr) {
+                displays[d]->retireFenceFd = -1;
+            }
+        }
+        return 0;
+    }
+
+    static int queryHook(hwc_composer_device_1_t* /*device*/, int /*what*/,
+            int* /*value*/) {
+        return -EINVAL;
+    }
+
+    static void registerProcsHook(hwc_composer_device_1_t* /*device*/,
+            hwc_procs_t const* /*procs*/) {}
+
+    static int getDisplayConfigsHook(hwc_composer_device_1_t* device,
+            int /*display*/, uint32_t* configs, size_t* numConfigs) {
+        auto& deviceConfigs = getDevice(device)->configs;
+        *numConfigs = std::min(*numConfigs, deviceConfigs.size());
+        for (size_t c = 0; c < *numConfigs; ++c) {
+            configs[c] = c;
+        }
+        return 0;
+    }
+
+    static int getDisplayAttributesHook(hwc_composer_device_1_t* device,
+            int /*display*/, uint32_t config, const uint32_t* attributes,
+            int32_t* values) {
+        const auto& displayConfig = getDevice(device)->configs.at(config);
+        for (size_t a = 0; attributes[a] != HWC_DISPLAY_NO_ATTRIBUTE; ++a) {
+            switch (attributes[a]) {
+                case HWC_DISPLAY_VSYNC_PERIOD: values[a] = 16666667; break;
+                case HWC_DISPLAY_WIDTH:
+                    values[a] = displayConfig.width;
+                    break;
+                case HWC_DISPLAY_HEIGHT:
+                    values[a] = displayConfig.height;
+                    break;
+                case HWC_DISPLAY_DPI_X: values[a] = 320000; break;
+                case HWC_DISPLAY_DPI_Y: values[a] = 320000; break;
+                case HWC_DISPLAY_COLOR_TRANSFORM:
+                    values[a] = HAL_COLOR_MODE_NATIVE;
+                    break;
+                default: return -EINVAL;
+            }
+        }
+        return 0;
+    }
+
+    static int getActiveConfigHook(hwc_composer_device_1_t* device,
+            int /*display*/) {
+        return getDevice(device)->activeConfig;
+    }
+
+    static int setActiveConfigHook(hwc_composer_device_1_t* device,
+            int /*display*/, int index) {
+        getDevice(device)->activeConfig = index;
+        return 0;
+    }
+};
+
+class HWC2On1AdapterTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mAdapter = std::make_unique<HWC2On1Adapter>(&mHwc1Device);
+
+        // The primary display is reported as soon as hotplug is registered.
+        auto registerCallback = getFunction<HWC2_PFN_REGISTER_CALLBACK>(
+                HWC2_FUNCTION_REGISTER_CALLBACK);
+        ASSERT_EQ(HWC2_ERROR_NONE, registerCallback(mAdapter.get(),
+                HWC2_CALLBACK_HOTPLUG, this,
+                reinterpret_cast<hwc2_function_pointer_t>(hotplugHook)));
+        ASSERT_NE(0u, mDisplay);
+    }
+
+    template <typename PFN>
+    PFN getFunction(int32_t descriptor) {
+        auto function = mAdapter->getFunction(mAdapter.get(), descriptor);
+        EXPECT_NE(nullptr, function);
+        return reinterpret_cast<PFN>(function);
+    }
+
+    hwc2_layer_t createLayer(uint32_t z, buffer_handle_t buffer) {
+        hwc2_layer_t layer = 0;
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_CREATE_LAYER>(HWC2_FUNCTION_CREATE_LAYER)(
+                        mAdapter.get(), mDisplay, &layer));
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_SET_LAYER_COMPOSITION_TYPE>(
+                        HWC2_FUNCTION_SET_LAYER_COMPOSITION_TYPE)(
+                        mAdapter.get(), mDisplay, layer,
+                        HWC2_COMPOSITION_DEVICE));
+        setLayerZ(layer, z);
+        setLayerBuffer(layer, buffer);
+        return layer;
+    }
+
+    void setLayerZ(hwc2_layer_t layer, uint32_t z) {
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_SET_LAYER_Z_ORDER>(
+                        HWC2_FUNCTION_SET_LAYER_Z_ORDER)(
+                        mAdapter.get(), mDisplay, layer, z));
+    }
+
+    void setLayerBuffer(hwc2_layer_t layer, buffer_handle_t buffer) {
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_SET_LAYER_BUFFER>(
+                        HWC2_FUNCTION_SET_LAYER_BUFFER)(
+                        mAdapter.get(), mDisplay, layer, buffer, -1));
+    }
+
+    void setColorTransformHint(android_color_transform_t hint) {
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_SET_COLOR_TRANSFORM>(
+                        HWC2_FUNCTION_SET_COLOR_TRANSFORM)(
+                        mAdapter.get(), mDisplay, nullptr, hint));
+    }
+
+    // Validates and presents a frame, accepting the composition changes, and
+    // returns what HWC1 was asked to prepare.
+    PreparedFrame presentFrame() {
+        uint32_t numTypes = 0;
+        uint32_t numRequests = 0;
+        auto error = getFunction<HWC2_PFN_VALIDATE_DISPLAY>(
+                HWC2_FUNCTION_VALIDATE_DISPLAY)(
+                mAdapter.get(), mDisplay, &numTypes, &numRequests);
+        EXPECT_TRUE(error == HWC2_ERROR_NONE || error == HWC2_ERROR_HAS_CHANGES)
+                << error;
+        if (error == HWC2_ERROR_HAS_CHANGES) {
+            EXPECT_EQ(HWC2_ERROR_NONE,
+                    getFunction<HWC2_PFN_ACCEPT_DISPLAY_CHANGES>(
+                            HWC2_FUNCTION_ACCEPT_DISPLAY_CHANGES)(
+                            mAdapter.get(), mDisplay));
+        }
+
+        int32_t presentFence = -1;
+        EXPECT_EQ(HWC2_ERROR_NONE,
+                getFunction<HWC2_PFN_PRESENT_DISPLAY>(
+                        HWC2_FUNCTION_PRESENT_DISPLAY)(
+                        mAdapter.get(), mDisplay, &presentFence));
+        if (presentFence >= 0) {
+            close(presentFence);
+        }
+
+        EXPECT_FALSE(mHwc1Device.preparedFrames.empty());
+        if (mHwc1Device.preparedFrames.empty()) {
+            return {};
+        }
+        return mHwc1Device.preparedFrames.back();
+    }
+
+    static bool isRebuilt(const PreparedFrame& frame) {
+        return (frame.flags & HWC_GEOMETRY_CHANGED) != 0;
+    }
+
+    // The adapter only passes buffer handles through, so any distinct
+    // addresses do.
+    buffer_handle_t buffer(int index) { return &mBuffers[index]; }
+
+    FakeHwc1Device mHwc1Device;
+    std::unique_ptr<HWC2On1Adapter> mAdapter;
+    hwc2_display_t mDisplay = 0;
+
+  private:
+    static void hotplugHook(hwc2_callback_data_t callbackData,
+            hwc2_display_t display, int32_t connection) {
+        auto test = static_cast<HWC2On1AdapterTest*>(callbackData);
+        if (connection == HWC2_CONNECTION_CONNECTED && test->mDisplay == 0) {
+            test->mDisplay = display;
+        }
+    }
+
+    native_handle_t mBuffers[4] = {};
+};
+
+TEST_F(HWC2On1AdapterTest, BufferChangeReusesContents) {
+    auto bottom = createLayer(1, buffer(0));
+    createLayer(2, buffer(1));
+    auto first = presentFrame();
+    EXPECT_TRUE(isRebuilt(first));
+    EXPECT_EQ((std::vector<buffer_handle_t>{buffer(0), buffer(1)}),
+            first.handles);
+
+    setLayerBuffer(bottom, buffer(2));
+    auto second = presentFrame();
+    EXPECT_FALSE(isRebuilt(second));
+    EXPECT_EQ(first.contents, second.contents);
+    EXPECT_EQ((std::vector<buffer_handle_t>{buffer(2), buffer(1)}),
+            second.handles);
+
+    // An unchanged frame is reused as well.
+    auto third = presentFrame();
+    EXPECT_FALSE(isRebuilt(third));
+    EXPECT_EQ(second.handles, third.handles);
+}
+
+TEST_F(HWC2On1AdapterTest, ZChangeRebuildsContents) {
+    auto bottom = createLayer(1, buffer(0));
+    auto middle = createLayer(2, buffer(1));
+    createLayer(3, buffer(2));
+    presentFrame();
+
+    setLayerZ(bottom, 4);
+    auto frame = presentFrame();
+    EXPECT_TRUE(isRebuilt(frame));
+    EXPECT_EQ((std::vector<buffer_handle_t>{buffer(1), buffer(2), buffer(0)}),
+            frame.handles);
+
+    setLayerZ(bottom, 0);
+    setLayerZ(middle, 5);
+    frame = presentFrame();
+    EXPECT_TRUE(isRebuilt(frame));
+    EXPECT_EQ((std::vector<buffer_handle_t>{buffer(0), buffer(2), buffer(1)}),
+            frame.handles);
+
+    // Setting the Z a layer already has is not a geometry change.
+    setLayerZ(bottom, 0);
+    EXPECT_FALSE(isRebuilt(presentFrame()));
+}
+
+TEST_F(HWC2On1AdapterTest, ActiveConfigChangeRebuildsContents) {
+    createLayer(1, buffer(0));
+    auto frame = presentFrame();
+    EXPECT_EQ(1080, frame.targetFrame.right);
+    EXPECT_EQ(1920, frame.targetFrame.bottom);
+    ASSERT_FALSE(isRebuilt(presentFrame()));
+
+    ASSERT_EQ(HWC2_ERROR_NONE,
+            getFunction<HWC2_PFN_SET_ACTIVE_CONFIG>(
+                    HWC2_FUNCTION_SET_ACTIVE_CONFIG)(
+                    mAdapter.get(), mDisplay, 1));
+    EXPECT_EQ(1, mHwc1Device.activeConfig);
+
+    // The framebuffer target is resized to the new config.
+    frame = presentFrame();
+    EXPECT_TRUE(isRebuilt(frame));
+    EXPECT_EQ(720, frame.targetFrame.right);
+    EXPECT_EQ(1280, frame.targetFrame.bottom);
+}
+
+TEST_F(HWC2On1AdapterTest, ColorTransformHintChangeRebuildsContents) {
+    createLayer(1, buffer(0));
+    presentFrame();
+    ASSERT_FALSE(isRebuilt(presentFrame()));
+
+    // HWC1 cannot apply a color transform, so the layer is skipped.
+    setColorTransformHint(HAL_COLOR_TRANSFORM_ARBITRARY_MATRIX);
+    auto frame = presentFrame();
+    EXPECT_TRUE(isRebuilt(frame));
+    ASSERT_EQ(1u, frame.layerFlags.size());
+    EXPECT_NE(0u, frame.layerFlags[0] & HWC_SKIP_LAYER);
+
+    // Accepting client composition changed the layer again; after that the
+    // same hint is not a change.
+    presentFrame();
+    setColorTransformHint(HAL_COLOR_TRANSFORM_ARBITRARY_MATRIX);
+    EXPECT_FALSE(isRebuilt(presentFrame()));
+
+    setColorTransformHint(HAL_COLOR_TRANSFORM_IDENTITY);
+    EXPECT_TRUE(isRebuilt(presentFrame()));
+}
+
+}  // namespace
+}  // namespace android
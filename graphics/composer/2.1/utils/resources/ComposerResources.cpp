@@ -120,6 +120,67 @@ void ComposerHandleImporter::freeStream(const native_handle_t* streamHandle) {
     }
 }
 
+void ComposerHandleImporter::setDeferredRelease(bool deferred) {
+    {
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        mDeferRelease = deferred;
+    }
+    if (!deferred) {
+        freeDeferredHandles();
+    }
+}
+
+void ComposerHandleImporter::releaseBuffer(const native_handle_t* bufferHandle) {
+    release(bufferHandle, true);
+}
+
+void ComposerHandleImporter::releaseStream(const native_handle_t* streamHandle) {
+    release(streamHandle, false);
+}
+
+void ComposerHandleImporter::release(const native_handle_t* handle, bool isBuffer) {
+    if (!handle) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        if (mDeferRelease) {
+            mDeferredHandles.emplace_back(handle, isBuffer);
+            return;
+        }
+    }
+
+    if (isBuffer) {
+        freeBuffer(handle);
+    } else {
+        freeStream(handle);
+    }
+}
+
+void ComposerHandleImporter::freeDeferredHandles() {
+    std::vector<std::pair<const native_handle_t*, bool>> handles;
+    {
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        handles.swap(mDeferredHandles);
+    }
+
+    for (const auto& [handle, isBuffer] : handles) {
+        if (isBuffer) {
+            freeBuffer(handle);
+        } else {
+            freeStream(handle);
+        }
+    }
+
+    // hand the storage back so the next frame does not reallocate
+    handles.clear();
+    std::lock_guard<std::mutex> lock(mDeferredMutex);
+    if (mDeferredHandles.empty()) {
+        mDeferredHandles.swap(handles);
+    }
+}
+
 ComposerHandleCache::ComposerHandleCache(ComposerHandleImporter& importer, HandleType type,
                                          uint32_t cacheSize)
     : mImporter(importer), mHandleType(type), mHandles(cacheSize, nullptr) {}
@@ -252,28 +313,67 @@ Error ComposerDisplayResource::getOutputBuffer(uint32_t slot, bool fromCache,
 
 bool ComposerDisplayResource::addLayer(Layer layer,
                                        std::unique_ptr<ComposerLayerResource> layerResource) {
-    auto result = mLayerResources.emplace(layer, std::move(layerResource));
-    return result.second;
+    const uint32_t slot = mFreeLayerSlots.empty() ? static_cast<uint32_t>(mLayerSlots.size())
+                                                  : mFreeLayerSlots.back();
+    auto result = mLayerSlotIndices.emplace(layer, slot);
+    if (!result.second) {
+        return false;
+    }
+
+    if (slot == mLayerSlots.size()) {
+        mLayerSlots.emplace_back();
+    } else {
+        mFreeLayerSlots.pop_back();
+    }
+    mLayerSlots[slot].layer = layer;
+    mLayerSlots[slot].resource = std::move(layerResource);
+    return true;
 }
 
 bool ComposerDisplayResource::removeLayer(Layer layer) {
-    return mLayerResources.erase(layer) > 0;
+    auto iter = mLayerSlotIndices.find(layer);
+    if (iter == mLayerSlotIndices.end()) {
+        return false;
+    }
+
+    const uint32_t slot = iter->second;
+    mLayerSlotIndices.erase(iter);
+
+    // bumping the generation invalidates the last-lookup cache for this slot
+    LayerSlot& layerSlot = mLayerSlots[slot];
+    layerSlot.resource.reset();
+    layerSlot.generation++;
+    mFreeLayerSlots.push_back(slot);
+    return true;
 }
 
 ComposerLayerResource* ComposerDisplayResource::findLayerResource(Layer layer) {
-    auto layerIter = mLayerResources.find(layer);
-    if (layerIter == mLayerResources.end()) {
+    if (mLastLayerSlot != kNoSlot && mLastLayer == layer) {
+        const LayerSlot& layerSlot = mLayerSlots[mLastLayerSlot];
+        if (layerSlot.generation == mLastLayerGeneration) {
+            return layerSlot.resource.get();
+        }
+    }
+
+    auto iter = mLayerSlotIndices.find(layer);
+    if (iter == mLayerSlotIndices.end()) {
         return nullptr;
     }
 
-    return layerIter->second.get();
+    const LayerSlot& layerSlot = mLayerSlots[iter->second];
+    mLastLayer = layer;
+    mLastLayerSlot = iter->second;
+    mLastLayerGeneration = layerSlot.generation;
+    return layerSlot.resource.get();
 }
 
 std::vector<Layer> ComposerDisplayResource::getLayers() const {
     std::vector<Layer> layers;
-    layers.reserve(mLayerResources.size());
-    for (const auto& layerKey : mLayerResources) {
-        layers.push_back(layerKey.first);
+    layers.reserve(mLayerSlotIndices.size());
+    for (const auto& layerSlot : mLayerSlots) {
+        if (layerSlot.resource) {
+            layers.push_back(layerSlot.layer);
+        }
     }
     return layers;
 }
@@ -296,23 +396,28 @@ bool ComposerResources::init() {
 }
 
 void ComposerResources::clear(RemoveDisplay removeDisplay) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    for (const auto& displayKey : mDisplayResources) {
-        Display display = displayKey.first;
-        const ComposerDisplayResource& displayResource = *displayKey.second;
-        removeDisplay(display, displayResource.isVirtual(), displayResource.getLayers());
+    {
+        std::lock_guard<std::shared_mutex> lock(mDisplayResourcesMutex);
+        for (const auto& displayKey : mDisplayResources) {
+            Display display = displayKey.first;
+            ComposerDisplayResource& displayResource = *displayKey.second;
+            std::lock_guard<std::mutex> displayLock(displayResource.getLock());
+            removeDisplay(display, displayResource.isVirtual(), displayResource.getLayers());
+        }
+        mDisplayResources.clear();
     }
-    mDisplayResources.clear();
+    mImporter.freeDeferredHandles();
 }
 
 bool ComposerResources::hasDisplay(Display display) {
+    std::shared_lock<std::shared_mutex> lock(mDisplayResourcesMutex);
     return mDisplayResources.count(display) > 0;
 }
 
 Error ComposerResources::addPhysicalDisplay(Display display) {
     auto displayResource = createDisplayResource(ComposerDisplayResource::DisplayType::PHYSICAL, 0);
 
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
+    std::lock_guard<std::shared_mutex> lock(mDisplayResourcesMutex);
     auto result = mDisplayResources.emplace(display, std::move(displayResource));
     return result.second ? Error::NONE : Error::BAD_DISPLAY;
 }
@@ -321,44 +426,52 @@ Error ComposerResources::addVirtualDisplay(Display display, uint32_t outputBuffe
     auto displayResource = createDisplayResource(ComposerDisplayResource::DisplayType::VIRTUAL,
                                                  outputBufferCacheSize);
 
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
+    std::lock_guard<std::shared_mutex> lock(mDisplayResourcesMutex);
     auto result = mDisplayResources.emplace(display, std::move(displayResource));
     return result.second ? Error::NONE : Error::BAD_DISPLAY;
 }
 
 Error ComposerResources::removeDisplay(Display display) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    return mDisplayResources.erase(display) > 0 ? Error::NONE : Error::BAD_DISPLAY;
+    {
+        std::lock_guard<std::shared_mutex> lock(mDisplayResourcesMutex);
+        if (mDisplayResources.erase(display) == 0) {
+            return Error::BAD_DISPLAY;
+        }
+    }
+    // displays are removed outside of executeCommands, so do not leave the
+    // handles of the display for the next frame to free
+    mImporter.freeDeferredHandles();
+    return Error::NONE;
 }
 
 Error ComposerResources::setDisplayClientTargetCacheSize(Display display,
                                                          uint32_t clientTargetCacheSize) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (!displayResource) {
         return Error::BAD_DISPLAY;
     }
+    std::lock_guard<std::mutex> lock(displayResource->getLock());
 
     return displayResource->initClientTargetCache(clientTargetCacheSize) ? Error::NONE
                                                                          : Error::BAD_PARAMETER;
 }
 
 Error ComposerResources::getDisplayClientTargetCacheSize(Display display, size_t* outCacheSize) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (!displayResource) {
         return Error::BAD_DISPLAY;
     }
+    std::lock_guard<std::mutex> lock(displayResource->getLock());
     *outCacheSize = displayResource->getClientTargetCacheSize();
     return Error::NONE;
 }
 
 Error ComposerResources::getDisplayOutputBufferCacheSize(Display display, size_t* outCacheSize) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (!displayResource) {
         return Error::BAD_DISPLAY;
     }
+    std::lock_guard<std::mutex> lock(displayResource->getLock());
     *outCacheSize = displayResource->getOutputBufferCacheSize();
     return Error::NONE;
 }
@@ -366,22 +479,22 @@ Error ComposerResources::getDisplayOutputBufferCacheSize(Display display, size_t
 Error ComposerResources::addLayer(Display display, Layer layer, uint32_t bufferCacheSize) {
     auto layerResource = createLayerResource(bufferCacheSize);
 
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (!displayResource) {
         return Error::BAD_DISPLAY;
     }
+    std::lock_guard<std::mutex> lock(displayResource->getLock());
 
     return displayResource->addLayer(layer, std::move(layerResource)) ? Error::NONE
                                                                       : Error::BAD_LAYER;
 }
 
 Error ComposerResources::removeLayer(Display display, Layer layer) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (!displayResource) {
         return Error::BAD_DISPLAY;
     }
+    std::lock_guard<std::mutex> lock(displayResource->getLock());
 
     return displayResource->removeLayer(layer) ? Error::NONE : Error::BAD_LAYER;
 }
@@ -419,22 +532,30 @@ Error ComposerResources::getLayerSidebandStream(Display display, Layer layer,
 }
 
 void ComposerResources::setDisplayMustValidateState(Display display, bool mustValidate) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    auto* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (displayResource) {
+        std::lock_guard<std::mutex> lock(displayResource->getLock());
         displayResource->setMustValidateState(mustValidate);
     }
 }
 
 bool ComposerResources::mustValidateDisplay(Display display) {
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-    auto* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
     if (displayResource) {
+        std::lock_guard<std::mutex> lock(displayResource->getLock());
         return displayResource->mustValidate();
     }
     return false;
 }
 
+void ComposerResources::setDeferredHandleRelease(bool deferred) {
+    mImporter.setDeferredRelease(deferred);
+}
+
+void ComposerResources::freeReplacedHandles() {
+    mImporter.freeDeferredHandles();
+}
+
 std::unique_ptr<ComposerDisplayResource> ComposerResources::createDisplayResource(
         ComposerDisplayResource::DisplayType type, uint32_t outputBufferCacheSize) {
     return std::make_unique<ComposerDisplayResource>(type, mImporter, outputBufferCacheSize);
@@ -445,12 +566,13 @@ std::unique_ptr<ComposerLayerResource> ComposerResources::createLayerResource(
     return std::make_unique<ComposerLayerResource>(mImporter, bufferCacheSize);
 }
 
-ComposerDisplayResource* ComposerResources::findDisplayResourceLocked(Display display) {
+std::shared_ptr<ComposerDisplayResource> ComposerResources::findDisplayResource(Display display) {
+    std::shared_lock<std::shared_mutex> lock(mDisplayResourcesMutex);
     auto iter = mDisplayResources.find(display);
     if (iter == mDisplayResources.end()) {
         return nullptr;
     }
-    return iter->second.get();
+    return iter->second;
 }
 
 Error ComposerResources::getHandle(Display display, Layer layer, uint32_t slot, Cache cache,
@@ -470,12 +592,14 @@ Error ComposerResources::getHandle(Display display, Layer layer, uint32_t slot,
         }
     }
 
-    std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-
     // find display/layer resource
     const bool needLayerResource = (cache == ComposerResources::Cache::LAYER_BUFFER ||
                                     cache == ComposerResources::Cache::LAYER_SIDEBAND_STREAM);
-    ComposerDisplayResource* displayResource = findDisplayResourceLocked(display);
+    auto displayResource = findDisplayResource(display);
+    std::unique_lock<std::mutex> displayLock;
+    if (displayResource) {
+        displayLock = std::unique_lock<std::mutex>(displayResource->getLock());
+    }
     ComposerLayerResource* layerResource = (displayResource && needLayerResource)
                                                    ? displayResource->findLayerResource(layer)
                                                    : nullptr;
@@ -20,9 +20,12 @@
 #warning "ComposerResources.h included without LOG_TAG"
 #endif
 
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <android/hardware/graphics/composer/2.1/types.h>
@@ -42,14 +45,33 @@ namespace hal {
 // wrapper for IMapper to import buffers and sideband streams
 class ComposerHandleImporter {
   public:
+    virtual ~ComposerHandleImporter() { freeDeferredHandles(); }
+
     bool init();
 
-    Error importBuffer(const native_handle_t* rawHandle, const native_handle_t** outBufferHandle);
-    void freeBuffer(const native_handle_t* bufferHandle);
-    Error importStream(const native_handle_t* rawHandle, const native_handle_t** outStreamHandle);
-    void freeStream(const native_handle_t* streamHandle);
+    virtual Error importBuffer(const native_handle_t* rawHandle,
+                               const native_handle_t** outBufferHandle);
+    virtual void freeBuffer(const native_handle_t* bufferHandle);
+    virtual Error importStream(const native_handle_t* rawHandle,
+                               const native_handle_t** outStreamHandle);
+    virtual void freeStream(const native_handle_t* streamHandle);
+
+    // When deferred release is enabled, handles passed to releaseBuffer and
+    // releaseStream are queued and only freed by freeDeferredHandles, so that
+    // the teardown can be moved off the present path.
+    void setDeferredRelease(bool deferred);
+    void releaseBuffer(const native_handle_t* bufferHandle);
+    void releaseStream(const native_handle_t* streamHandle);
+    void freeDeferredHandles();
 
   private:
+    void release(const native_handle_t* handle, bool isBuffer);
+
+    std::mutex mDeferredMutex;
+    bool mDeferRelease = false;
+    // handles waiting to be freed, and whether they are buffers
+    std::vector<std::pair<const native_handle_t*, bool>> mDeferredHandles;
+
     sp<mapper::V2_0::IMapper> mMapper2;
     sp<mapper::V3_0::IMapper> mMapper3;
     sp<mapper::V4_0::IMapper> mMapper4;
@@ -142,13 +164,37 @@ class ComposerDisplayResource {
 
     bool mustValidate() const;
 
+    // guards the layers and the handle caches of this display
+    std::mutex& getLock() { return mLock; }
+
   protected:
     const DisplayType mType;
     ComposerHandleCache mClientTargetCache;
     ComposerHandleCache mOutputBufferCache;
     bool mMustValidate;
 
-    std::unordered_map<Layer, std::unique_ptr<ComposerLayerResource>> mLayerResources;
+    std::mutex mLock;
+
+  private:
+    // Layers live in a dense slot array.  A slot's generation is bumped
+    // whenever its layer is removed, which invalidates the cached result of
+    // the last lookup without having to track it.
+    struct LayerSlot {
+        Layer layer = 0;
+        uint32_t generation = 0;
+        std::unique_ptr<ComposerLayerResource> resource;
+    };
+
+    static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+    std::vector<LayerSlot> mLayerSlots;
+    std::vector<uint32_t> mFreeLayerSlots;
+    std::unordered_map<Layer, uint32_t> mLayerSlotIndices;
+
+    // the layer commands are addressed to repeatedly within a frame
+    Layer mLastLayer = 0;
+    uint32_t mLastLayerSlot = kNoSlot;
+    uint32_t mLastLayerGeneration = 0;
 };
 
 class ComposerResources {
@@ -181,6 +227,13 @@ class ComposerResources {
 
     bool mustValidateDisplay(Display display);
 
+    // Defers freeing replaced handles until freeReplacedHandles is called,
+    // e.g. after the reply to executeCommands has been sent.  Paths outside
+    // of executeCommands that replace handles must call it too; removeDisplay
+    // does.
+    void setDeferredHandleRelease(bool deferred);
+    void freeReplacedHandles();
+
     // When a buffer in the cache is replaced by a new one, we must keep it
     // alive until it has been replaced in ComposerHal because it is still using
     // the old buffer.
@@ -198,9 +251,9 @@ class ComposerResources {
                    const native_handle_t* handle = nullptr) {
             if (mHandle) {
                 if (mIsBuffer) {
-                    mImporter->freeBuffer(mHandle);
+                    mImporter->releaseBuffer(mHandle);
                 } else {
-                    mImporter->freeStream(mHandle);
+                    mImporter->releaseStream(mHandle);
                 }
             }
 
@@ -238,12 +291,16 @@ class ComposerResources {
 
     virtual std::unique_ptr<ComposerLayerResource> createLayerResource(uint32_t bufferCacheSize);
 
-    ComposerDisplayResource* findDisplayResourceLocked(Display display);
+    // Looks up a display with mDisplayResourcesMutex held only in shared
+    // mode; the returned reference keeps the display alive even if it is
+    // removed concurrently.  Callers then take the display's own lock.
+    std::shared_ptr<ComposerDisplayResource> findDisplayResource(Display display);
 
     ComposerHandleImporter mImporter;
 
-    std::mutex mDisplayResourcesMutex;
-    std::unordered_map<Display, std::unique_ptr<ComposerDisplayResource>> mDisplayResources;
+    // exclusive for adding and removing displays, shared for lookups
+    std::shared_mutex mDisplayResourcesMutex;
+    std::unordered_map<Display, std::shared_ptr<ComposerDisplayResource>> mDisplayResources;
 
   private:
     enum class Cache {
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ComposerResourcesTest"
+
+#include <composer-resources/2.1/ComposerResources.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace hardware {
+namespace graphics {
+namespace composer {
+namespace V2_1 {
+namespace hal {
+namespace {
+
+// Hands out the raw handles as they are and records which ones are freed,
+// so that no mapper is needed.
+class FakeImporter : public ComposerHandleImporter {
+  public:
+    ~FakeImporter() override { freeDeferredHandles(); }
+
+    Error importBuffer(const native_handle_t* rawHandle,
+                       const native_handle_t** outBufferHandle) override {
+        *outBufferHandle = rawHandle;
+        return Error::NONE;
+    }
+    void freeBuffer(const native_handle_t* bufferHandle) override {
+        if (bufferHandle) {
+            freedBuffers.push_back(bufferHandle);
+        }
+    }
+    Error importStream(const native_handle_t* rawHandle,
+                       const native_handle_t** outStreamHandle) override {
+        *outStreamHandle = rawHandle;
+        return Error::NONE;
+    }
+    void freeStream(const native_handle_t* streamHandle) override {
+        if (streamHandle) {
+            freedStreams.push_back(streamHandle);
+        }
+    }
+
+    bool isFreed(const native_handle_t* handle) const {
+        return std::find(freedBuffers.begin(), freedBuffers.end(), handle) != freedBuffers.end();
+    }
+
+    std::vector<const native_handle_t*> freedBuffers;
+    std::vector<const native_handle_t*> freedStreams;
+};
+
+constexpr uint32_t kBufferCacheSize = 2;
+
+class ComposerResourcesTest : public ::testing::Test {
+  protected:
+    std::unique_ptr<ComposerLayerResource> createLayer() {
+        return std::make_unique<ComposerLayerResource>(mImporter, kBufferCacheSize);
+    }
+
+    // Puts handle in a slot of the buffer cache of layer, the way
+    // ComposerResources::getHandle does.
+    void setBuffer(ComposerLayerResource* layer, uint32_t slot, const native_handle_t* handle,
+                   ComposerResources::ReplacedHandle* outReplacedHandle) {
+        const native_handle_t* outHandle = nullptr;
+        const native_handle_t* replacedHandle = nullptr;
+        ASSERT_EQ(Error::NONE, layer->getBuffer(slot, false, handle, &outHandle, &replacedHandle));
+        ASSERT_EQ(handle, outHandle);
+        outReplacedHandle->reset(&mImporter, replacedHandle);
+    }
+
+    const native_handle_t* getCachedBuffer(ComposerLayerResource* layer, uint32_t slot) {
+        const native_handle_t* outHandle = nullptr;
+        const native_handle_t* replacedHandle = nullptr;
+        EXPECT_EQ(Error::NONE, layer->getBuffer(slot, true, nullptr, &outHandle, &replacedHandle));
+        EXPECT_EQ(nullptr, replacedHandle);
+        return outHandle;
+    }
+
+    // The caches only compare and free the handles, so any distinct
+    // addresses do.
+    const native_handle_t* handle(int index) { return &mHandles[index]; }
+
+    FakeImporter mImporter;
+    ComposerDisplayResource mDisplay{ComposerDisplayResource::DisplayType::PHYSICAL, mImporter,
+                                     0};
+
+  private:
+    native_handle_t mHandles[4] = {};
+};
+
+TEST_F(ComposerResourcesTest, FindsLayers) {
+    auto first = createLayer();
+    auto second = createLayer();
+    ComposerLayerResource* firstResource = first.get();
+    ComposerLayerResource* secondResource = second.get();
+    ASSERT_TRUE(mDisplay.addLayer(1, std::move(first)));
+    ASSERT_TRUE(mDisplay.addLayer(2, std::move(second)));
+    EXPECT_FALSE(mDisplay.addLayer(1, createLayer()));
+
+    // Repeated lookups of the same layer hit the last-lookup cache.
+    EXPECT_EQ(firstResource, mDisplay.findLayerResource(1));
+    EXPECT_EQ(firstResource, mDisplay.findLayerResource(1));
+    EXPECT_EQ(secondResource, mDisplay.findLayerResource(2));
+    EXPECT_EQ(nullptr, mDisplay.findLayerResource(3));
+    EXPECT_EQ(firstResource, mDisplay.findLayerResource(1));
+
+    EXPECT_EQ((std::vector<Layer>{1, 2}), mDisplay.getLayers());
+}
+
+TEST_F(ComposerResourcesTest, RemovedLayerIsNotFoundInReusedSlot) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ASSERT_NE(nullptr, mDisplay.findLayerResource(1));
+
+    // The new layer takes the slot of the removed one, which the last lookup
+    // still points at.
+    ASSERT_TRUE(mDisplay.removeLayer(1));
+    EXPECT_FALSE(mDisplay.removeLayer(1));
+    auto layer = createLayer();
+    ComposerLayerResource* resource = layer.get();
+    ASSERT_TRUE(mDisplay.addLayer(2, std::move(layer)));
+
+    EXPECT_EQ(nullptr, mDisplay.findLayerResource(1));
+    EXPECT_EQ(resource, mDisplay.findLayerResource(2));
+    EXPECT_EQ(std::vector<Layer>{2}, mDisplay.getLayers());
+}
+
+TEST_F(ComposerResourcesTest, ReaddedLayerIsNotFoundInStaleSlot) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ASSERT_NE(nullptr, mDisplay.findLayerResource(1));
+
+    // A layer id may come back in the same slot, with a new resource.
+    ASSERT_TRUE(mDisplay.removeLayer(1));
+    auto layer = createLayer();
+    ComposerLayerResource* resource = layer.get();
+    ASSERT_TRUE(mDisplay.addLayer(1, std::move(layer)));
+    EXPECT_EQ(resource, mDisplay.findLayerResource(1));
+
+    // A layer removed and not replaced is gone even for the last lookup.
+    ASSERT_TRUE(mDisplay.removeLayer(1));
+    EXPECT_EQ(nullptr, mDisplay.findLayerResource(1));
+}
+
+TEST_F(ComposerResourcesTest, RemovedLayerFreesItsBuffers) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ComposerResources::ReplacedHandle replaced(true);
+    setBuffer(mDisplay.findLayerResource(1), 0, handle(0), &replaced);
+    setBuffer(mDisplay.findLayerResource(1), 1, handle(1), &replaced);
+
+    ASSERT_TRUE(mDisplay.removeLayer(1));
+    EXPECT_TRUE(mImporter.isFreed(handle(0)));
+    EXPECT_TRUE(mImporter.isFreed(handle(1)));
+}
+
+TEST_F(ComposerResourcesTest, ReplacedBufferIsFreedRightAway) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ComposerLayerResource* layer = mDisplay.findLayerResource(1);
+    {
+        ComposerResources::ReplacedHandle replaced(true);
+        setBuffer(layer, 0, handle(0), &replaced);
+        setBuffer(layer, 0, handle(1), &replaced);
+        EXPECT_EQ(handle(1), getCachedBuffer(layer, 0));
+        // The replaced buffer is kept until the composer is done with it.
+        EXPECT_FALSE(mImporter.isFreed(handle(0)));
+    }
+    EXPECT_TRUE(mImporter.isFreed(handle(0)));
+    EXPECT_FALSE(mImporter.isFreed(handle(1)));
+}
+
+TEST_F(ComposerResourcesTest, DeferredBufferIsFreedOnlyAfterFlush) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ComposerLayerResource* layer = mDisplay.findLayerResource(1);
+    mImporter.setDeferredRelease(true);
+    {
+        ComposerResources::ReplacedHandle replaced(true);
+        setBuffer(layer, 0, handle(0), &replaced);
+        setBuffer(layer, 0, handle(1), &replaced);
+        setBuffer(layer, 0, handle(2), &replaced);
+    }
+    EXPECT_TRUE(mImporter.freedBuffers.empty());
+
+    mImporter.freeDeferredHandles();
+    EXPECT_EQ((std::vector<const native_handle_t*>{handle(0), handle(1)}),
+              mImporter.freedBuffers);
+
+    // Nothing is freed twice.
+    mImporter.freeDeferredHandles();
+    EXPECT_EQ(2u, mImporter.freedBuffers.size());
+    EXPECT_EQ(handle(2), getCachedBuffer(layer, 0));
+}
+
+TEST_F(ComposerResourcesTest, DisablingDeferredReleaseFlushes) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ComposerLayerResource* layer = mDisplay.findLayerResource(1);
+    mImporter.setDeferredRelease(true);
+    {
+        ComposerResources::ReplacedHandle replaced(true);
+        setBuffer(layer, 0, handle(0), &replaced);
+        setBuffer(layer, 0, handle(1), &replaced);
+    }
+    EXPECT_TRUE(mImporter.freedBuffers.empty());
+
+    mImporter.setDeferredRelease(false);
+    EXPECT_TRUE(mImporter.isFreed(handle(0)));
+
+    {
+        ComposerResources::ReplacedHandle replaced(true);
+        setBuffer(layer, 0, handle(2), &replaced);
+    }
+    EXPECT_TRUE(mImporter.isFreed(handle(1)));
+}
+
+TEST_F(ComposerResourcesTest, DeferredStreamIsFreedOnlyAfterFlush) {
+    ASSERT_TRUE(mDisplay.addLayer(1, createLayer()));
+    ComposerLayerResource* layer = mDisplay.findLayerResource(1);
+    mImporter.setDeferredRelease(true);
+    {
+        ComposerResources::ReplacedHandle replaced(false);
+        const native_handle_t* outHandle = nullptr;
+        const native_handle_t* replacedHandle = nullptr;
+        ASSERT_EQ(Error::NONE,
+                  layer->getSidebandStream(0, false, handle(0), &outHandle, &replacedHandle));
+        replaced.reset(&mImporter, replacedHandle);
+        ASSERT_EQ(Error::NONE,
+                  layer->getSidebandStream(0, false, handle(1), &outHandle, &replacedHandle));
+        replaced.reset(&mImporter, replacedHandle);
+    }
+    EXPECT_TRUE(mImporter.freedStreams.empty());
+
+    mImporter.freeDeferredHandles();
+    EXPECT_EQ(std::vector<const native_handle_t*>{handle(0)}, mImporter.freedStreams);
+    EXPECT_TRUE(mImporter.freedBuffers.empty());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace V2_1
+}  // namespace composer
+}  // namespace graphics
+}  // namespace hardware
+}  // namespace android
@@ -39,6 +39,21 @@ void TestCommandReader::parse() {
     }
 }
 
+void TestCommandReader::parseChunk(const CommandWriterBase& writer) {
+    auto errors = std::move(mErrors);
+    auto compositionChanges = std::move(mCompositionChanges);
+    parse();
+
+    for (auto& error : mErrors) {
+        error.first = writer.getChunkCommandOffset(error.first);
+    }
+    errors.insert(errors.end(), mErrors.begin(), mErrors.end());
+    compositionChanges.insert(compositionChanges.end(), mCompositionChanges.begin(),
+                              mCompositionChanges.end());
+    mErrors = std::move(errors);
+    mCompositionChanges = std::move(compositionChanges);
+}
+
 void TestCommandReader::parseSingleCommand(int32_t commandRaw, uint16_t length) {
     IComposerClient::Command command = static_cast<IComposerClient::Command>(commandRaw);
 
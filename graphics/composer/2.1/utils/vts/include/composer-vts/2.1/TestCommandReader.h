@@ -33,6 +33,10 @@ class TestCommandReader : public CommandReaderBase {
      // Parse all commands in the return command queue.  Call GTEST_FAIL() for
      // unexpected errors or commands.
      void parse();
+     // Parse the commands returned for one chunk of a frame written with
+     // CommandWriterBase::writeQueueChunk, keeping the results of the
+     // previous chunks.  Error locations are mapped back to the frame.
+     void parseChunk(const CommandWriterBase& writer);
 
      std::vector<std::pair<uint32_t, uint32_t>> mErrors;
      std::vector<std::pair<uint64_t, uint32_t>> mCompositionChanges;
@@ -92,6 +92,16 @@ class CommandWriterBase : public V2_1::CommandWriterBase {
     }
 
    protected:
+    bool isLayerStateCommand(uint32_t command) const override {
+        switch (static_cast<IComposerClient::Command>(command)) {
+            case IComposerClient::Command::SET_LAYER_FLOAT_COLOR:
+            case IComposerClient::Command::SET_LAYER_PER_FRAME_METADATA:
+                return true;
+            default:
+                return V2_1::CommandWriterBase::isLayerStateCommand(command);
+        }
+    }
+
     void writeFloatColor(const IComposerClient::FloatColor& color) {
         writeFloat(color.r);
         writeFloat(color.g);
@@ -88,15 +88,19 @@ class ComposerClientImpl : public V2_1::hal::detail::ComposerClientImpl<Interfac
         }
 
         auto resources = static_cast<ComposerResources*>(mResources.get());
-        const native_handle_t* readbackBuffer;
-        ComposerResources::ReplacedHandle replacedReadbackBuffer(true);
-        error = resources->getDisplayReadbackBuffer(display, buffer.getNativeHandle(),
-                                                    &readbackBuffer, &replacedReadbackBuffer);
-        if (error != Error::NONE) {
-            return error;
+        {
+            const native_handle_t* readbackBuffer;
+            ComposerResources::ReplacedHandle replacedReadbackBuffer(true);
+            error = resources->getDisplayReadbackBuffer(display, buffer.getNativeHandle(),
+                                                        &readbackBuffer, &replacedReadbackBuffer);
+            if (error == Error::NONE) {
+                error = mHal->setReadbackBuffer(display, readbackBuffer, std::move(fenceFd));
+            }
         }
 
-        return mHal->setReadbackBuffer(display, readbackBuffer, std::move(fenceFd));
+        // the replaced buffer is not freed by an executeCommands call
+        resources->freeReplacedHandles();
+        return error;
     }
 
     Return<void> createVirtualDisplay_2_2(
@@ -165,6 +169,7 @@ class ComposerClientImpl : public V2_1::hal::detail::ComposerClientImpl<Interfac
         hidl_cb(error, outChanged, outLength, outHandles);
 
         mCommandEngine->reset();
+        mResources->freeReplacedHandles();
 
         return Void();
     }
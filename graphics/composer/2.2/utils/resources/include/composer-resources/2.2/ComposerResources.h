@@ -70,15 +70,14 @@ class ComposerResources : public V2_1::hal::ComposerResources {
             return error;
         }
 
-        std::lock_guard<std::mutex> lock(mDisplayResourcesMutex);
-
-        auto iter = mDisplayResources.find(display);
-        if (iter == mDisplayResources.end()) {
+        auto displayResourceRef = findDisplayResource(display);
+        if (!displayResourceRef) {
             mImporter.freeBuffer(importedHandle);
             return Error::BAD_DISPLAY;
         }
+        std::lock_guard<std::mutex> lock(displayResourceRef->getLock());
         ComposerDisplayResource& displayResource =
-                *static_cast<ComposerDisplayResource*>(iter->second.get());
+                *static_cast<ComposerDisplayResource*>(displayResourceRef.get());
 
         // update cache
         const native_handle_t* replacedHandle;
@@ -124,11 +124,26 @@ class CommandWriterBase : public V2_2::CommandWriterBase {
     }
 
    protected:
+    bool isLayerStateCommand(uint32_t command) const override {
+        switch (static_cast<IComposerClient::Command>(command)) {
+            case IComposerClient::Command::SET_LAYER_COLOR_TRANSFORM:
+            case IComposerClient::Command::SET_LAYER_PER_FRAME_METADATA_BLOBS:
+                return true;
+            default:
+                return V2_2::CommandWriterBase::isLayerStateCommand(command);
+        }
+    }
+
     void writeBlob(uint32_t length, const unsigned char* blob) {
         memcpy(&mData[mDataWritten], blob, length);
         uint32_t numElements = length / 4;
         mDataWritten += numElements;
-        mDataWritten += (length - (numElements * 4) > 0) ? 1 : 0;
+        if (length - (numElements * 4) > 0) {
+            // zero the padding so that identical blobs encode identically
+            memset(reinterpret_cast<unsigned char*>(&mData[mDataWritten]) + length % 4, 0,
+                   4 - length % 4);
+            mDataWritten++;
+        }
     }
 };
 
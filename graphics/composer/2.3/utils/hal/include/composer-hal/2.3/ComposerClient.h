@@ -167,6 +167,7 @@ class ComposerClientImpl : public V2_2::hal::detail::ComposerClientImpl<Interfac
         hidl_cb(error, outChanged, outLength, outHandles);
 
         mCommandEngine->reset();
+        mResources->freeReplacedHandles();
 
         return Void();
     }
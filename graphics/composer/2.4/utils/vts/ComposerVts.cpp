@@ -136,32 +136,47 @@ void ComposerClient::execute(TestCommandReader* reader, CommandWriterBase* write
     bool queueChanged = false;
     uint32_t commandLength = 0;
     hidl_vec<hidl_handle> commandHandles;
-    ASSERT_TRUE(writer->writeQueue(&queueChanged, &commandLength, &commandHandles));
-
-    if (queueChanged) {
-        auto ret = mClient->setInputCommandQueue(*writer->getMQDescriptor());
-        ASSERT_EQ(V2_1::Error::NONE, ret);
-    }
-
-    mClient->executeCommands_2_3(
-            commandLength, commandHandles,
-            [&](const auto& tmpError, const auto& tmpOutQueueChanged, const auto& tmpOutLength,
-                const auto& tmpOutHandles) {
-                ASSERT_EQ(V2_1::Error::NONE, tmpError);
-
-                if (tmpOutQueueChanged) {
-                    mClient->getOutputCommandQueue(
-                            [&](const auto& tmpError, const auto& tmpDescriptor) {
-                                ASSERT_EQ(V2_3::Error::NONE, tmpError);
-                                reader->setMQDescriptor(tmpDescriptor);
-                            });
-                }
-
-                ASSERT_TRUE(reader->readQueue(tmpOutLength, tmpOutHandles));
-                reader->parse();
-            });
+    bool hasMore = false;
+    uint32_t chunkCount = 0;
+    reader->mErrors.clear();
+    reader->mCompositionChanges.clear();
+    do {
+        ASSERT_TRUE(writer->writeQueueChunk(&queueChanged, &commandLength, &commandHandles,
+                                            &hasMore));
+        chunkCount++;
+
+        if (queueChanged) {
+            auto ret = mClient->setInputCommandQueue(*writer->getMQDescriptor());
+            ASSERT_EQ(V2_1::Error::NONE, ret);
+        }
+
+        mClient->executeCommands_2_3(
+                commandLength, commandHandles,
+                [&](const auto& tmpError, const auto& tmpOutQueueChanged, const auto& tmpOutLength,
+                    const auto& tmpOutHandles) {
+                    ASSERT_EQ(V2_1::Error::NONE, tmpError);
+
+                    if (tmpOutQueueChanged) {
+                        mClient->getOutputCommandQueue(
+                                [&](const auto& tmpError, const auto& tmpDescriptor) {
+                                    ASSERT_EQ(V2_3::Error::NONE, tmpError);
+                                    reader->setMQDescriptor(tmpDescriptor);
+                                });
+                    }
+
+                    ASSERT_TRUE(reader->readQueue(tmpOutLength, tmpOutHandles));
+                    reader->parseChunk(*writer);
+                });
+    } while (hasMore);
     reader->reset();
     writer->reset();
+
+    if (chunkCount > 1) {
+        const auto& stats = writer->getQueueStats();
+        ALOGI("frame needed %" PRIu32 " chunks (%" PRIu32 " of %" PRIu32
+              " frames chunked), recommended command queue size %" PRIu32,
+              chunkCount, stats.chunkedFrames, stats.frames, writer->getRecommendedQueueSize());
+    }
 }
 
 }  // namespace vts
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ComposerCommandStreamBenchmark"
+
+#include <android/binder_parcel.h>
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <android/hardware/graphics/composer3/ComposerCommandStream.h>
+#include <benchmark/benchmark.h>
+
+using aidl::android::hardware::graphics::composer3::ComposerClientWriter;
+using aidl::android::hardware::graphics::composer3::ComposerCommandStreamReader;
+using aidl::android::hardware::graphics::composer3::ComposerCommandStreamWriter;
+using aidl::android::hardware::graphics::composer3::DisplayCommand;
+using aidl::android::hardware::graphics::composer3::NativeHandle;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+static constexpr int64_t kDisplay = 1;
+
+// Builds one frame the way SurfaceFlinger does for a scene of the given layer
+// count: full geometry and region state for every layer, then present.
+static std::vector<DisplayCommand> buildFrame(int64_t layerCount) {
+    ComposerClientWriter writer(kDisplay);
+    const std::vector<Rect> damage = {{0, 0, 64, 64}, {128, 128, 256, 256}};
+    const std::vector<Rect> visible = {{0, 0, 1080, 2400}};
+    const std::vector<PerFrameMetadata> metadata = {
+            {PerFrameMetadataKey::MAX_LUMINANCE, 1000.f},
+            {PerFrameMetadataKey::MIN_LUMINANCE, 0.1f},
+    };
+
+    writer.setDisplayBrightness(kDisplay, 0.5f, 400.f);
+    for (int64_t layer = 1; layer <= layerCount; layer++) {
+        writer.setLayerBuffer(kDisplay, layer, static_cast<uint32_t>(layer % 3), nullptr, -1);
+        writer.setLayerSurfaceDamage(kDisplay, layer, damage);
+        writer.setLayerBlendMode(kDisplay, layer, BlendMode::PREMULTIPLIED);
+        writer.setLayerCompositionType(kDisplay, layer, Composition::DEVICE);
+        writer.setLayerDataspace(kDisplay, layer, Dataspace::SRGB);
+        writer.setLayerDisplayFrame(kDisplay, layer, {0, 0, 1080, 2400});
+        writer.setLayerPlaneAlpha(kDisplay, layer, 1.f);
+        writer.setLayerSourceCrop(kDisplay, layer, {0.f, 0.f, 1080.f, 2400.f});
+        writer.setLayerTransform(kDisplay, layer, Transform::NONE);
+        writer.setLayerVisibleRegion(kDisplay, layer, visible);
+        writer.setLayerZOrder(kDisplay, layer, static_cast<uint32_t>(layer));
+        writer.setLayerPerFrameMetadata(kDisplay, layer, metadata);
+        writer.setLayerBrightness(kDisplay, layer, 1.f);
+    }
+    writer.presentOrvalidateDisplay(kDisplay, ComposerClientWriter::kNoTimestamp, 8333333);
+    return writer.takePendingCommands();
+}
+
+// Both benchmarks rebuild the frame on every iteration since commands holding
+// fences are move-only; the writer cost is the same on both paths.
+static void BM_ParcelFrame(State& state) {
+    AParcel* parcel = AParcel_create();
+    size_t bytes = 0;
+
+    for (auto _ : state) {
+        std::vector<DisplayCommand> commands = buildFrame(state.range(0));
+        AParcel_reset(parcel);
+        for (const auto& command : commands) {
+            command.writeToParcel(parcel);
+        }
+        bytes = static_cast<size_t>(AParcel_getDataSize(parcel));
+
+        AParcel_setDataPosition(parcel, 0);
+        std::vector<DisplayCommand> decoded(commands.size());
+        for (auto& command : decoded) {
+            command.readFromParcel(parcel);
+        }
+        benchmark::DoNotOptimize(decoded);
+    }
+
+    AParcel_delete(parcel);
+    state.counters["bytes"] = Counter(static_cast<double>(bytes));
+}
+
+static void BM_CommandStreamFrame(State& state) {
+    ComposerCommandStreamWriter writer;
+    ComposerCommandStreamReader reader;
+    const auto desc = writer.dupeDesc();
+    if (!desc || !reader.setMQDescriptor(*desc)) {
+        state.SkipWithError("failed to set up command stream queue");
+        return;
+    }
+
+    std::vector<DisplayCommand> decoded;
+    int32_t length = 0;
+    for (auto _ : state) {
+        std::vector<DisplayCommand> commands = buildFrame(state.range(0));
+        std::vector<NativeHandle> handles;
+        std::vector<::ndk::ScopedFileDescriptor> fences;
+        if (!writer.writeQueue(commands, &length, &handles, &fences) ||
+            !reader.readQueue(length, std::move(handles), std::move(fences), &decoded)) {
+            state.SkipWithError("failed to transfer frame");
+            return;
+        }
+        benchmark::DoNotOptimize(decoded);
+    }
+
+    if (decoded != buildFrame(state.range(0))) {
+        state.SkipWithError("decoded commands differ from the parcel path");
+    }
+    state.counters["bytes"] = Counter(static_cast<double>(length * sizeof(int32_t)));
+}
+
+BENCHMARK(BM_ParcelFrame)->Arg(16)->Arg(64)->Arg(128);
+BENCHMARK(BM_CommandStreamFrame)->Arg(16)->Arg(64)->Arg(128);
+
+BENCHMARK_MAIN();
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <inttypes.h>
@@ -26,6 +27,7 @@
 
 #include <aidl/android/hardware/graphics/common/BlendMode.h>
 #include <aidl/android/hardware/graphics/composer3/Color.h>
+#include <aidl/android/hardware/graphics/composer3/CommandError.h>
 #include <aidl/android/hardware/graphics/composer3/Composition.h>
 #include <aidl/android/hardware/graphics/composer3/DisplayBrightness.h>
 #include <aidl/android/hardware/graphics/composer3/LayerBrightness.h>
@@ -71,6 +73,45 @@ class ComposerClientWriter final {
     ComposerClientWriter(const ComposerClientWriter&) = delete;
     ComposerClientWriter& operator=(const ComposerClientWriter&) = delete;
 
+    // When enabled, layer state that is identical to what was last written
+    // for the same layer is dropped from the pending commands.  Layer state
+    // is sticky on the composer side, so it only needs to be sent when it
+    // changes.  Destroying a layer through LayerLifecycleBatchCommandType
+    // clears its cached state; otherwise the caller must clear it when a
+    // layer is destroyed or when commands are not delivered.
+    //
+    // The cache assumes that the composer applied every command.  Callers
+    // MUST pass the errors of each executeCommands() call, from
+    // ComposerClientReader::takeErrors(), to clearLayerStateCache(errors).
+    // Otherwise a rejected layer field, such as a display frame, is never
+    // sent again while it does not change.
+    void setLayerStateCacheEnabled(bool enabled) {
+        mLayerStateCacheEnabled = enabled;
+        if (!enabled) {
+            clearLayerStateCache();
+        }
+    }
+
+    void clearLayerStateCache() { mLayerStateCache.clear(); }
+
+    void clearLayerStateCache(int64_t layer) { mLayerStateCache.erase(layer); }
+
+    // Clears the cached state of the layers of the failed commands, among the
+    // commands last returned by takePendingCommands().  A command error does
+    // not tell which layer was rejected, so all of the command's layers are
+    // sent in full again.
+    void clearLayerStateCache(const std::vector<CommandError>& errors) {
+        for (const auto& error : errors) {
+            if (error.commandIndex < 0 ||
+                static_cast<size_t>(error.commandIndex) >= mTakenCommandLayers.size()) {
+                continue;
+            }
+            for (int64_t layer : mTakenCommandLayers[error.commandIndex]) {
+                mLayerStateCache.erase(layer);
+            }
+        }
+    }
+
     void setColorTransform(int64_t display, const float* matrix) {
         std::vector<float> matVec;
         matVec.reserve(16);
@@ -250,14 +291,98 @@ class ComposerClientWriter final {
         flushDisplayCommand();
         std::vector<DisplayCommand> moved = std::move(mCommands);
         mCommands.clear();
+        mTakenCommandLayers.clear();
+        if (mLayerStateCacheEnabled) {
+            for (const auto& command : moved) {
+                auto& layers = mTakenCommandLayers.emplace_back();
+                for (const auto& layerCommand : command.layers) {
+                    layers.push_back(layerCommand.layer);
+                }
+            }
+        }
         return moved;
     }
 
   private:
+    // Sticky layer state last written per layer.  Composition types are not
+    // cached since acceptDisplayChanges can change them on the composer side.
+    struct LayerState {
+        decltype(LayerCommand::damage) damage;
+        decltype(LayerCommand::blendMode) blendMode;
+        decltype(LayerCommand::color) color;
+        decltype(LayerCommand::dataspace) dataspace;
+        decltype(LayerCommand::displayFrame) displayFrame;
+        decltype(LayerCommand::planeAlpha) planeAlpha;
+        decltype(LayerCommand::sourceCrop) sourceCrop;
+        decltype(LayerCommand::transform) transform;
+        decltype(LayerCommand::visibleRegion) visibleRegion;
+        decltype(LayerCommand::z) z;
+        decltype(LayerCommand::colorTransform) colorTransform;
+        decltype(LayerCommand::brightness) brightness;
+        decltype(LayerCommand::perFrameMetadata) perFrameMetadata;
+        decltype(LayerCommand::perFrameMetadataBlob) perFrameMetadataBlob;
+        decltype(LayerCommand::blockingRegion) blockingRegion;
+    };
+
     std::optional<DisplayCommand> mDisplayCommand;
     std::optional<LayerCommand> mLayerCommand;
     std::vector<DisplayCommand> mCommands;
     const int64_t mDisplay;
+    bool mLayerStateCacheEnabled = false;
+    std::unordered_map<int64_t, LayerState> mLayerStateCache;
+    // The layers of each command last returned by takePendingCommands(), to
+    // map command errors to layers.
+    std::vector<std::vector<int64_t>> mTakenCommandLayers;
+
+    template <typename T>
+    static void dropIfUnchanged(std::optional<T>& value, std::optional<T>& cached) {
+        if (!value.has_value()) {
+            return;
+        }
+        if (cached == value) {
+            value.reset();
+        } else {
+            cached = value;
+        }
+    }
+
+    // Removes unchanged state from the layer command.  Returns false if
+    // nothing is left to send for the layer.
+    bool applyLayerStateCache(LayerCommand& command) {
+        if (command.layerLifecycleBatchCommandType == LayerLifecycleBatchCommandType::DESTROY) {
+            mLayerStateCache.erase(command.layer);
+            return true;
+        }
+        if (command.layerLifecycleBatchCommandType == LayerLifecycleBatchCommandType::CREATE) {
+            mLayerStateCache.erase(command.layer);
+        }
+
+        auto& state = mLayerStateCache[command.layer];
+        dropIfUnchanged(command.damage, state.damage);
+        dropIfUnchanged(command.blendMode, state.blendMode);
+        dropIfUnchanged(command.color, state.color);
+        dropIfUnchanged(command.dataspace, state.dataspace);
+        dropIfUnchanged(command.displayFrame, state.displayFrame);
+        dropIfUnchanged(command.planeAlpha, state.planeAlpha);
+        dropIfUnchanged(command.sourceCrop, state.sourceCrop);
+        dropIfUnchanged(command.transform, state.transform);
+        dropIfUnchanged(command.visibleRegion, state.visibleRegion);
+        dropIfUnchanged(command.z, state.z);
+        dropIfUnchanged(command.colorTransform, state.colorTransform);
+        dropIfUnchanged(command.brightness, state.brightness);
+        dropIfUnchanged(command.perFrameMetadata, state.perFrameMetadata);
+        dropIfUnchanged(command.perFrameMetadataBlob, state.perFrameMetadataBlob);
+        dropIfUnchanged(command.blockingRegion, state.blockingRegion);
+
+        return command.layerLifecycleBatchCommandType != LayerLifecycleBatchCommandType::MODIFY ||
+               command.newBufferSlotCount != 0 || command.cursorPosition || command.buffer ||
+               command.damage || command.blendMode || command.color || command.composition ||
+               command.dataspace || command.displayFrame || command.planeAlpha ||
+               command.sidebandStream || command.sourceCrop || command.transform ||
+               command.visibleRegion || command.z || command.colorTransform ||
+               command.brightness || command.perFrameMetadata || command.perFrameMetadataBlob ||
+               command.blockingRegion || command.bufferSlotsToClear;
+    }
 
     Buffer getBufferCommand(uint32_t slot, const native_handle_t* bufferHandle, int fence) {
         Buffer bufferCommand;
@@ -269,7 +394,9 @@ class ComposerClientWriter final {
 
     void flushLayerCommand() {
         if (mLayerCommand.has_value()) {
-            mDisplayCommand->layers.emplace_back(std::move(*mLayerCommand));
+            if (!mLayerStateCacheEnabled || applyLayerStateCache(*mLayerCommand)) {
+                mDisplayCommand->layers.emplace_back(std::move(*mLayerCommand));
+            }
             mLayerCommand.reset();
         }
     }
@@ -0,0 +1,810 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <aidl/android/hardware/common/fmq/MQDescriptor.h>
+#include <aidl/android/hardware/common/fmq/SynchronizedReadWrite.h>
+#include <aidl/android/hardware/graphics/composer3/DisplayCommand.h>
+
+#include <fmq/AidlMessageQueue.h>
+#include <log/log.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+
+using ::aidl::android::hardware::common::NativeHandle;
+using ::aidl::android::hardware::common::fmq::MQDescriptor;
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+
+using CommandStreamQueueType = ::android::AidlMessageQueue<int32_t, SynchronizedReadWrite>;
+using CommandStreamDescriptor = MQDescriptor<int32_t, SynchronizedReadWrite>;
+
+// Packed binary encoding of std::vector<DisplayCommand>, meant to be carried
+// over a persistent FMQ instead of being marshalled as a binder parcel every
+// frame.  Native handles and fences cannot live in shared memory, so they are
+// moved into side tables and referenced by index from the stream; the caller
+// transports the side tables alongside the stream length.
+//
+// Every command starts with a header word holding the opcode in the top 8
+// bits and the payload length in the low 24 bits.  All sizes/lengths are in
+// units of int32_t.
+enum class CommandStreamOpcode : uint32_t {
+    // display(2), flags(1), frameIntervalNs(1)
+    SELECT_DISPLAY = 1,
+    EXPECTED_PRESENT_TIME,
+    COLOR_TRANSFORM,
+    DISPLAY_BRIGHTNESS,
+    CLIENT_TARGET,
+    OUTPUT_BUFFER,
+    // layer(2), layerLifecycleBatchCommandType(1), newBufferSlotCount(1)
+    SELECT_LAYER,
+    LAYER_CURSOR_POSITION,
+    LAYER_BUFFER,
+    LAYER_SURFACE_DAMAGE,
+    LAYER_BLEND_MODE,
+    LAYER_COLOR,
+    LAYER_COMPOSITION_TYPE,
+    LAYER_DATASPACE,
+    LAYER_DISPLAY_FRAME,
+    LAYER_PLANE_ALPHA,
+    LAYER_SIDEBAND_STREAM,
+    LAYER_SOURCE_CROP,
+    LAYER_TRANSFORM,
+    LAYER_VISIBLE_REGION,
+    LAYER_Z_ORDER,
+    LAYER_COLOR_TRANSFORM,
+    LAYER_BRIGHTNESS,
+    LAYER_PER_FRAME_METADATA,
+    // empty payload; starts a (possibly empty) perFrameMetadataBlob list
+    LAYER_PER_FRAME_METADATA_BLOBS,
+    // key(1), byte size(1), bytes padded to a whole number of words
+    LAYER_PER_FRAME_METADATA_BLOB,
+    LAYER_BLOCKING_REGION,
+    LAYER_BUFFER_SLOTS_TO_CLEAR,
+};
+
+constexpr uint32_t kCommandStreamOpcodeShift = 24;
+constexpr uint32_t kCommandStreamLengthMask = (1u << kCommandStreamOpcodeShift) - 1;
+
+// Index written in place of a handle or fence that is not present.
+constexpr int32_t kCommandStreamNoHandle = -1;
+
+// Bits of the flags word in SELECT_DISPLAY.
+constexpr int32_t kCommandStreamValidateDisplay = 1 << 0;
+constexpr int32_t kCommandStreamAcceptDisplayChanges = 1 << 1;
+constexpr int32_t kCommandStreamPresentDisplay = 1 << 2;
+constexpr int32_t kCommandStreamPresentOrValidateDisplay = 1 << 3;
+
+// This class encodes display commands into a packed stream and writes them to
+// a persistent command queue.
+class ComposerCommandStreamWriter {
+  public:
+    static constexpr size_t kDefaultQueueSize = 64 * 1024;
+
+    explicit ComposerCommandStreamWriter(size_t queueSize = kDefaultQueueSize)
+        : mQueue(std::make_unique<CommandStreamQueueType>(queueSize)) {
+        if (!mQueue->isValid()) {
+            ALOGE("failed to create command stream queue of %zu words", queueSize);
+            mQueue = nullptr;
+        }
+        reset();
+    }
+
+    ComposerCommandStreamWriter(const ComposerCommandStreamWriter&) = delete;
+    ComposerCommandStreamWriter& operator=(const ComposerCommandStreamWriter&) = delete;
+
+    bool isValid() const { return mQueue != nullptr; }
+
+    // The descriptor only needs to be sent to the reader once; the queue is
+    // never reallocated.
+    std::optional<CommandStreamDescriptor> dupeDesc() const {
+        if (!mQueue) {
+            return std::nullopt;
+        }
+        return mQueue->dupeDesc();
+    }
+
+    void reset() {
+        mData.clear();
+        mHandles.clear();
+        mFences.clear();
+    }
+
+    // Encodes commands into the internal buffer.  Handles and fences are left
+    // in commands and only referenced from the stream; takeHandles() moves
+    // them into the side tables once the stream has been committed.
+    void encode(std::vector<DisplayCommand>& commands) {
+        reset();
+        for (auto& displayCommand : commands) {
+            encodeDisplayCommand(displayCommand);
+        }
+    }
+
+    const int32_t* data() const { return mData.data(); }
+    size_t size() const { return mData.size(); }
+
+    // Moves the handles and fences referenced by the last encoded stream out
+    // of the commands given to encode(), which must still be alive.
+    void takeHandles(std::vector<NativeHandle>* outHandles,
+                     std::vector<::ndk::ScopedFileDescriptor>* outFences) {
+        outHandles->clear();
+        outHandles->reserve(mHandles.size());
+        for (auto* handle : mHandles) {
+            outHandles->emplace_back(std::move(**handle));
+        }
+        outFences->clear();
+        outFences->reserve(mFences.size());
+        for (auto* fence : mFences) {
+            outFences->emplace_back(std::move(*fence));
+        }
+        mHandles.clear();
+        mFences.clear();
+    }
+
+    // Encodes commands and writes the stream to the queue.  On success the
+    // handles and fences are moved out of commands into the side tables.
+    // Returns false when the queue cannot hold the frame; commands are then
+    // left untouched, and the caller should send them as a parcel instead.
+    bool writeQueue(std::vector<DisplayCommand>& commands, int32_t* outLength,
+                    std::vector<NativeHandle>* outHandles,
+                    std::vector<::ndk::ScopedFileDescriptor>* outFences) {
+        if (!mQueue) {
+            return false;
+        }
+
+        encode(commands);
+        if (mData.empty()) {
+            *outLength = 0;
+            outHandles->clear();
+            outFences->clear();
+            return true;
+        }
+        if (mData.size() > mQueue->availableToWrite() ||
+            !mQueue->write(mData.data(), mData.size())) {
+            ALOGW("command stream of %zu words does not fit the queue", mData.size());
+            reset();
+            return false;
+        }
+
+        *outLength = static_cast<int32_t>(mData.size());
+        takeHandles(outHandles, outFences);
+        return true;
+    }
+
+  private:
+    void beginCommand(CommandStreamOpcode opcode, size_t length) {
+        LOG_ALWAYS_FATAL_IF(length > kCommandStreamLengthMask,
+                            "command 0x%x is too long: %zu words", static_cast<uint32_t>(opcode),
+                            length);
+        write((static_cast<uint32_t>(opcode) << kCommandStreamOpcodeShift) |
+              static_cast<uint32_t>(length));
+    }
+
+    void write(uint32_t val) { mData.push_back(static_cast<int32_t>(val)); }
+
+    void writeSigned(int32_t val) { mData.push_back(val); }
+
+    void writeFloat(float val) {
+        int32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        mData.push_back(bits);
+    }
+
+    void write64(int64_t val) {
+        uint64_t bits = static_cast<uint64_t>(val);
+        write(static_cast<uint32_t>(bits & 0xffffffff));
+        write(static_cast<uint32_t>(bits >> 32));
+    }
+
+    void writeRect(const common::Rect& rect) {
+        writeSigned(rect.left);
+        writeSigned(rect.top);
+        writeSigned(rect.right);
+        writeSigned(rect.bottom);
+    }
+
+    void writeRegion(CommandStreamOpcode opcode, const std::vector<common::Rect>& region) {
+        beginCommand(opcode, region.size() * 4);
+        for (const auto& rect : region) {
+            writeRect(rect);
+        }
+    }
+
+    void writeFloats(CommandStreamOpcode opcode, const std::vector<float>& values) {
+        beginCommand(opcode, values.size());
+        for (float value : values) {
+            writeFloat(value);
+        }
+    }
+
+    void writeHandle(std::optional<NativeHandle>& handle) {
+        if (!handle) {
+            writeSigned(kCommandStreamNoHandle);
+            return;
+        }
+        mHandles.push_back(&handle);
+        writeSigned(static_cast<int32_t>(mHandles.size() - 1));
+    }
+
+    void writeFence(::ndk::ScopedFileDescriptor& fence) {
+        if (fence.get() < 0) {
+            writeSigned(kCommandStreamNoHandle);
+            return;
+        }
+        mFences.push_back(&fence);
+        writeSigned(static_cast<int32_t>(mFences.size() - 1));
+    }
+
+    void writeBuffer(Buffer& buffer) {
+        writeSigned(buffer.slot);
+        writeHandle(buffer.handle);
+        writeFence(buffer.fence);
+    }
+
+    void encodeDisplayCommand(DisplayCommand& command) {
+        int32_t flags = 0;
+        if (command.validateDisplay) flags |= kCommandStreamValidateDisplay;
+        if (command.acceptDisplayChanges) flags |= kCommandStreamAcceptDisplayChanges;
+        if (command.presentDisplay) flags |= kCommandStreamPresentDisplay;
+        if (command.presentOrValidateDisplay) flags |= kCommandStreamPresentOrValidateDisplay;
+
+        beginCommand(CommandStreamOpcode::SELECT_DISPLAY, 4);
+        write64(command.display);
+        writeSigned(flags);
+        writeSigned(command.frameIntervalNs);
+
+        if (command.expectedPresentTime) {
+            beginCommand(CommandStreamOpcode::EXPECTED_PRESENT_TIME, 2);
+            write64(command.expectedPresentTime->timestampNanos);
+        }
+        if (command.colorTransformMatrix) {
+            writeFloats(CommandStreamOpcode::COLOR_TRANSFORM, *command.colorTransformMatrix);
+        }
+        if (command.brightness) {
+            beginCommand(CommandStreamOpcode::DISPLAY_BRIGHTNESS, 2);
+            writeFloat(command.brightness->brightness);
+            writeFloat(command.brightness->brightnessNits);
+        }
+        if (command.clientTarget) {
+            auto& clientTarget = *command.clientTarget;
+            beginCommand(CommandStreamOpcode::CLIENT_TARGET, 5 + clientTarget.damage.size() * 4);
+            writeBuffer(clientTarget.buffer);
+            writeSigned(static_cast<int32_t>(clientTarget.dataspace));
+            writeFloat(clientTarget.hdrSdrRatio);
+            for (const auto& rect : clientTarget.damage) {
+                writeRect(rect);
+            }
+        }
+        if (command.virtualDisplayOutputBuffer) {
+            beginCommand(CommandStreamOpcode::OUTPUT_BUFFER, 3);
+            writeBuffer(*command.virtualDisplayOutputBuffer);
+        }
+
+        for (auto& layerCommand : command.layers) {
+            encodeLayerCommand(layerCommand);
+        }
+    }
+
+    void encodeLayerCommand(LayerCommand& command) {
+        beginCommand(CommandStreamOpcode::SELECT_LAYER, 4);
+        write64(command.layer);
+        writeSigned(static_cast<int32_t>(command.layerLifecycleBatchCommandType));
+        writeSigned(command.newBufferSlotCount);
+
+        if (command.cursorPosition) {
+            beginCommand(CommandStreamOpcode::LAYER_CURSOR_POSITION, 2);
+            writeSigned(command.cursorPosition->x);
+            writeSigned(command.cursorPosition->y);
+        }
+        if (command.buffer) {
+            beginCommand(CommandStreamOpcode::LAYER_BUFFER, 3);
+            writeBuffer(*command.buffer);
+        }
+        if (command.damage) {
+            writeRegion(CommandStreamOpcode::LAYER_SURFACE_DAMAGE, *command.damage);
+        }
+        if (command.blendMode) {
+            beginCommand(CommandStreamOpcode::LAYER_BLEND_MODE, 1);
+            writeSigned(static_cast<int32_t>(command.blendMode->blendMode));
+        }
+        if (command.color) {
+            beginCommand(CommandStreamOpcode::LAYER_COLOR, 4);
+            writeFloat(command.color->r);
+            writeFloat(command.color->g);
+            writeFloat(command.color->b);
+            writeFloat(command.color->a);
+        }
+        if (command.composition) {
+            beginCommand(CommandStreamOpcode::LAYER_COMPOSITION_TYPE, 1);
+            writeSigned(static_cast<int32_t>(command.composition->composition));
+        }
+        if (command.dataspace) {
+            beginCommand(CommandStreamOpcode::LAYER_DATASPACE, 1);
+            writeSigned(static_cast<int32_t>(command.dataspace->dataspace));
+        }
+        if (command.displayFrame) {
+            beginCommand(CommandStreamOpcode::LAYER_DISPLAY_FRAME, 4);
+            writeRect(*command.displayFrame);
+        }
+        if (command.planeAlpha) {
+            beginCommand(CommandStreamOpcode::LAYER_PLANE_ALPHA, 1);
+            writeFloat(command.planeAlpha->alpha);
+        }
+        if (command.sidebandStream) {
+            beginCommand(CommandStreamOpcode::LAYER_SIDEBAND_STREAM, 1);
+            writeHandle(command.sidebandStream);
+        }
+        if (command.sourceCrop) {
+            beginCommand(CommandStreamOpcode::LAYER_SOURCE_CROP, 4);
+            writeFloat(command.sourceCrop->left);
+            writeFloat(command.sourceCrop->top);
+            writeFloat(command.sourceCrop->right);
+            writeFloat(command.sourceCrop->bottom);
+        }
+        if (command.transform) {
+            beginCommand(CommandStreamOpcode::LAYER_TRANSFORM, 1);
+            writeSigned(static_cast<int32_t>(command.transform->transform));
+        }
+        if (command.visibleRegion) {
+            writeRegion(CommandStreamOpcode::LAYER_VISIBLE_REGION, *command.visibleRegion);
+        }
+        if (command.z) {
+            beginCommand(CommandStreamOpcode::LAYER_Z_ORDER, 1);
+            writeSigned(command.z->z);
+        }
+        if (command.colorTransform) {
+            writeFloats(CommandStreamOpcode::LAYER_COLOR_TRANSFORM, *command.colorTransform);
+        }
+        if (command.brightness) {
+            beginCommand(CommandStreamOpcode::LAYER_BRIGHTNESS, 1);
+            writeFloat(command.brightness->brightness);
+        }
+        if (command.perFrameMetadata) {
+            beginCommand(CommandStreamOpcode::LAYER_PER_FRAME_METADATA,
+                         command.perFrameMetadata->size() * 2);
+            for (const auto& metadata : *command.perFrameMetadata) {
+                writeSigned(static_cast<int32_t>(metadata.key));
+                writeFloat(metadata.value);
+            }
+        }
+        if (command.perFrameMetadataBlob) {
+            beginCommand(CommandStreamOpcode::LAYER_PER_FRAME_METADATA_BLOBS, 0);
+            for (const auto& metadata : *command.perFrameMetadataBlob) {
+                const size_t words = (metadata.blob.size() + sizeof(int32_t) - 1) / sizeof(int32_t);
+                beginCommand(CommandStreamOpcode::LAYER_PER_FRAME_METADATA_BLOB, 2 + words);
+                writeSigned(static_cast<int32_t>(metadata.key));
+                writeSigned(static_cast<int32_t>(metadata.blob.size()));
+                const size_t offset = mData.size();
+                mData.resize(offset + words, 0);
+                if (!metadata.blob.empty()) {
+                    memcpy(&mData[offset], metadata.blob.data(), metadata.blob.size());
+                }
+            }
+        }
+        if (command.blockingRegion) {
+            writeRegion(CommandStreamOpcode::LAYER_BLOCKING_REGION, *command.blockingRegion);
+        }
+        if (command.bufferSlotsToClear) {
+            beginCommand(CommandStreamOpcode::LAYER_BUFFER_SLOTS_TO_CLEAR,
+                         command.bufferSlotsToClear->size());
+            for (int32_t slot : *command.bufferSlotsToClear) {
+                writeSigned(slot);
+            }
+        }
+    }
+
+    std::unique_ptr<CommandStreamQueueType> mQueue;
+    std::vector<int32_t> mData;
+    // The handles and fences of the encoded commands, in stream index order.
+    std::vector<std::optional<NativeHandle>*> mHandles;
+    std::vector<::ndk::ScopedFileDescriptor*> mFences;
+};
+
+// This class reads a packed command stream in place from the command queue and
+// decodes it into display commands equivalent to the ones that were encoded.
+class ComposerCommandStreamReader {
+  public:
+    ComposerCommandStreamReader() = default;
+
+    ComposerCommandStreamReader(const ComposerCommandStreamReader&) = delete;
+    ComposerCommandStreamReader& operator=(const ComposerCommandStreamReader&) = delete;
+
+    bool setMQDescriptor(const CommandStreamDescriptor& descriptor) {
+        mQueue = std::make_unique<CommandStreamQueueType>(descriptor, false);
+        if (!mQueue->isValid()) {
+            mQueue = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Reads length words from the queue and decodes them into outCommands.
+    // The stream is decoded directly from the shared memory unless it wraps
+    // around the end of the ring.
+    bool readQueue(int32_t length, std::vector<NativeHandle>&& handles,
+                   std::vector<::ndk::ScopedFileDescriptor>&& fences,
+                   std::vector<DisplayCommand>* outCommands) {
+        outCommands->clear();
+        if (length == 0) {
+            return true;
+        }
+        if (!mQueue || length < 0) {
+            return false;
+        }
+
+        const size_t count = static_cast<size_t>(length);
+        CommandStreamQueueType::MemTransaction tx;
+        if (!mQueue->beginRead(count, &tx)) {
+            ALOGE("failed to read %zu words from command stream queue", count);
+            return false;
+        }
+
+        const auto& first = tx.getFirstRegion();
+        const int32_t* data = first.getAddress();
+        if (first.getLength() < count) {
+            const auto& second = tx.getSecondRegion();
+            mScratch.resize(count);
+            std::copy_n(first.getAddress(), first.getLength(), mScratch.data());
+            std::copy_n(second.getAddress(), count - first.getLength(),
+                        mScratch.data() + first.getLength());
+            data = mScratch.data();
+        }
+
+        const bool ok = parse(data, count, std::move(handles), std::move(fences), outCommands);
+        mQueue->commitRead(count);
+        return ok;
+    }
+
+    // Decodes a stream that is already in memory.
+    bool parse(const int32_t* data, size_t size, std::vector<NativeHandle>&& handles,
+               std::vector<::ndk::ScopedFileDescriptor>&& fences,
+               std::vector<DisplayCommand>* outCommands) {
+        mData = data;
+        mDataSize = size;
+        mDataRead = 0;
+        mHandles = std::move(handles);
+        mFences = std::move(fences);
+
+        DisplayCommand* display = nullptr;
+        LayerCommand* layer = nullptr;
+        bool ok = true;
+        while (ok && mDataRead < mDataSize) {
+            const uint32_t header = read();
+            const auto opcode =
+                    static_cast<CommandStreamOpcode>(header >> kCommandStreamOpcodeShift);
+            const uint32_t length = header & kCommandStreamLengthMask;
+            if (length > mDataSize - mDataRead) {
+                ALOGE("command 0x%x has invalid length %" PRIu32, static_cast<uint32_t>(opcode),
+                      length);
+                ok = false;
+                break;
+            }
+            const size_t commandEnd = mDataRead + length;
+
+            if (opcode == CommandStreamOpcode::SELECT_DISPLAY) {
+                ok = length == 4;
+                if (ok) {
+                    display = &outCommands->emplace_back();
+                    layer = nullptr;
+                    parseSelectDisplay(display);
+                }
+            } else if (!display) {
+                ALOGE("command 0x%x received before SELECT_DISPLAY", static_cast<uint32_t>(opcode));
+                ok = false;
+            } else if (opcode == CommandStreamOpcode::SELECT_LAYER) {
+                ok = length == 4;
+                if (ok) {
+                    layer = &display->layers.emplace_back();
+                    parseSelectLayer(layer);
+                }
+            } else if (opcode < CommandStreamOpcode::SELECT_LAYER) {
+                ok = parseDisplayCommand(opcode, length, display);
+            } else if (!layer) {
+                ALOGE("command 0x%x received before SELECT_LAYER", static_cast<uint32_t>(opcode));
+                ok = false;
+            } else {
+                ok = parseLayerCommand(opcode, length, layer);
+            }
+
+            if (ok && mDataRead != commandEnd) {
+                ALOGE("command 0x%x consumed %zu words, expected %" PRIu32,
+                      static_cast<uint32_t>(opcode), mDataRead - (commandEnd - length), length);
+                ok = false;
+            }
+        }
+
+        mData = nullptr;
+        mHandles.clear();
+        mFences.clear();
+        return ok;
+    }
+
+  private:
+    uint32_t read() { return static_cast<uint32_t>(mData[mDataRead++]); }
+
+    int32_t readSigned() { return mData[mDataRead++]; }
+
+    float readFloat() {
+        float val;
+        memcpy(&val, &mData[mDataRead++], sizeof(val));
+        return val;
+    }
+
+    int64_t read64() {
+        uint64_t lo = read();
+        uint64_t hi = read();
+        return static_cast<int64_t>((hi << 32) | lo);
+    }
+
+    common::Rect readRect() {
+        common::Rect rect;
+        rect.left = readSigned();
+        rect.top = readSigned();
+        rect.right = readSigned();
+        rect.bottom = readSigned();
+        return rect;
+    }
+
+    bool readRegion(uint32_t length, std::optional<std::vector<common::Rect>>* outRegion) {
+        if (length % 4 != 0) {
+            return false;
+        }
+        auto& region = outRegion->emplace();
+        region.reserve(length / 4);
+        for (uint32_t i = 0; i < length / 4; i++) {
+            region.push_back(readRect());
+        }
+        return true;
+    }
+
+    void readFloats(uint32_t length, std::optional<std::vector<float>>* outValues) {
+        auto& values = outValues->emplace();
+        values.reserve(length);
+        for (uint32_t i = 0; i < length; i++) {
+            values.push_back(readFloat());
+        }
+    }
+
+    bool readHandle(std::optional<NativeHandle>* outHandle) {
+        const int32_t index = readSigned();
+        if (index == kCommandStreamNoHandle) {
+            outHandle->reset();
+            return true;
+        }
+        if (index < 0 || static_cast<size_t>(index) >= mHandles.size()) {
+            ALOGE("invalid handle index %" PRId32, index);
+            return false;
+        }
+        outHandle->emplace(std::move(mHandles[index]));
+        return true;
+    }
+
+    bool readFence(::ndk::ScopedFileDescriptor* outFence) {
+        const int32_t index = readSigned();
+        if (index == kCommandStreamNoHandle) {
+            return true;
+        }
+        if (index < 0 || static_cast<size_t>(index) >= mFences.size()) {
+            ALOGE("invalid fence index %" PRId32, index);
+            return false;
+        }
+        *outFence = std::move(mFences[index]);
+        return true;
+    }
+
+    bool readBuffer(Buffer* outBuffer) {
+        outBuffer->slot = readSigned();
+        const bool handleOk = readHandle(&outBuffer->handle);
+        const bool fenceOk = readFence(&outBuffer->fence);
+        return handleOk && fenceOk;
+    }
+
+    void parseSelectDisplay(DisplayCommand* command) {
+        command->display = read64();
+        const int32_t flags = readSigned();
+        command->validateDisplay = flags & kCommandStreamValidateDisplay;
+        command->acceptDisplayChanges = flags & kCommandStreamAcceptDisplayChanges;
+        command->presentDisplay = flags & kCommandStreamPresentDisplay;
+        command->presentOrValidateDisplay = flags & kCommandStreamPresentOrValidateDisplay;
+        command->frameIntervalNs = readSigned();
+    }
+
+    void parseSelectLayer(LayerCommand* command) {
+        command->layer = read64();
+        command->layerLifecycleBatchCommandType =
+                static_cast<LayerLifecycleBatchCommandType>(readSigned());
+        command->newBufferSlotCount = readSigned();
+    }
+
+    bool parseDisplayCommand(CommandStreamOpcode opcode, uint32_t length,
+                             DisplayCommand* command) {
+        switch (opcode) {
+            case CommandStreamOpcode::EXPECTED_PRESENT_TIME:
+                if (length != 2) return false;
+                command->expectedPresentTime.emplace().timestampNanos = read64();
+                return true;
+            case CommandStreamOpcode::COLOR_TRANSFORM:
+                readFloats(length, &command->colorTransformMatrix);
+                return true;
+            case CommandStreamOpcode::DISPLAY_BRIGHTNESS: {
+                if (length != 2) return false;
+                auto& brightness = command->brightness.emplace();
+                brightness.brightness = readFloat();
+                brightness.brightnessNits = readFloat();
+                return true;
+            }
+            case CommandStreamOpcode::CLIENT_TARGET: {
+                if (length < 5 || (length - 5) % 4 != 0) return false;
+                auto& clientTarget = command->clientTarget.emplace();
+                if (!readBuffer(&clientTarget.buffer)) return false;
+                clientTarget.dataspace = static_cast<common::Dataspace>(readSigned());
+                clientTarget.hdrSdrRatio = readFloat();
+                clientTarget.damage.reserve((length - 5) / 4);
+                for (uint32_t i = 0; i < (length - 5) / 4; i++) {
+                    clientTarget.damage.push_back(readRect());
+                }
+                return true;
+            }
+            case CommandStreamOpcode::OUTPUT_BUFFER:
+                if (length != 3) return false;
+                return readBuffer(&command->virtualDisplayOutputBuffer.emplace());
+            default:
+                ALOGE("unknown display command 0x%x", static_cast<uint32_t>(opcode));
+                return false;
+        }
+    }
+
+    bool parseLayerCommand(CommandStreamOpcode opcode, uint32_t length, LayerCommand* command) {
+        switch (opcode) {
+            case CommandStreamOpcode::LAYER_CURSOR_POSITION: {
+                if (length != 2) return false;
+                auto& position = command->cursorPosition.emplace();
+                position.x = readSigned();
+                position.y = readSigned();
+                return true;
+            }
+            case CommandStreamOpcode::LAYER_BUFFER:
+                if (length != 3) return false;
+                return readBuffer(&command->buffer.emplace());
+            case CommandStreamOpcode::LAYER_SURFACE_DAMAGE:
+                return readRegion(length, &command->damage);
+            case CommandStreamOpcode::LAYER_BLEND_MODE:
+                if (length != 1) return false;
+                command->blendMode.emplace().blendMode =
+                        static_cast<common::BlendMode>(readSigned());
+                return true;
+            case CommandStreamOpcode::LAYER_COLOR: {
+                if (length != 4) return false;
+                auto& color = command->color.emplace();
+                color.r = readFloat();
+                color.g = readFloat();
+                color.b = readFloat();
+                color.a = readFloat();
+                return true;
+            }
+            case CommandStreamOpcode::LAYER_COMPOSITION_TYPE:
+                if (length != 1) return false;
+                command->composition.emplace().composition =
+                        static_cast<Composition>(readSigned());
+                return true;
+            case CommandStreamOpcode::LAYER_DATASPACE:
+                if (length != 1) return false;
+                command->dataspace.emplace().dataspace =
+                        static_cast<common::Dataspace>(readSigned());
+                return true;
+            case CommandStreamOpcode::LAYER_DISPLAY_FRAME:
+                if (length != 4) return false;
+                command->displayFrame.emplace(readRect());
+                return true;
+            case CommandStreamOpcode::LAYER_PLANE_ALPHA:
+                if (length != 1) return false;
+                command->planeAlpha.emplace().alpha = readFloat();
+                return true;
+            case CommandStreamOpcode::LAYER_SIDEBAND_STREAM:
+                if (length != 1) return false;
+                return readHandle(&command->sidebandStream);
+            case CommandStreamOpcode::LAYER_SOURCE_CROP: {
+                if (length != 4) return false;
+                auto& crop = command->sourceCrop.emplace();
+                crop.left = readFloat();
+                crop.top = readFloat();
+                crop.right = readFloat();
+                crop.bottom = readFloat();
+                return true;
+            }
+            case CommandStreamOpcode::LAYER_TRANSFORM:
+                if (length != 1) return false;
+                command->transform.emplace().transform =
+                        static_cast<common::Transform>(readSigned());
+                return true;
+            case CommandStreamOpcode::LAYER_VISIBLE_REGION:
+                return readRegion(length, &command->visibleRegion);
+            case CommandStreamOpcode::LAYER_Z_ORDER:
+                if (length != 1) return false;
+                command->z.emplace().z = readSigned();
+                return true;
+            case CommandStreamOpcode::LAYER_COLOR_TRANSFORM:
+                readFloats(length, &command->colorTransform);
+                return true;
+            case CommandStreamOpcode::LAYER_BRIGHTNESS:
+                if (length != 1) return false;
+                command->brightness.emplace().brightness = readFloat();
+                return true;
+            case CommandStreamOpcode::LAYER_PER_FRAME_METADATA: {
+                if (length % 2 != 0) return false;
+                auto& metadataVec = command->perFrameMetadata.emplace();
+                metadataVec.reserve(length / 2);
+                for (uint32_t i = 0; i < length / 2; i++) {
+                    auto& metadata = metadataVec.emplace_back();
+                    metadata.key = static_cast<PerFrameMetadataKey>(readSigned());
+                    metadata.value = readFloat();
+                }
+                return true;
+            }
+            case CommandStreamOpcode::LAYER_PER_FRAME_METADATA_BLOBS:
+                if (length != 0) return false;
+                command->perFrameMetadataBlob.emplace();
+                return true;
+            case CommandStreamOpcode::LAYER_PER_FRAME_METADATA_BLOB: {
+                if (length < 2 || !command->perFrameMetadataBlob) return false;
+                auto& metadata = command->perFrameMetadataBlob->emplace_back();
+                metadata.key = static_cast<PerFrameMetadataKey>(readSigned());
+                const int32_t size = readSigned();
+                if (size < 0 || static_cast<size_t>(size) > (length - 2) * sizeof(int32_t)) {
+                    return false;
+                }
+                const auto* bytes = reinterpret_cast<const uint8_t*>(&mData[mDataRead]);
+                metadata.blob.assign(bytes, bytes + size);
+                mDataRead += length - 2;
+                return true;
+            }
+            case CommandStreamOpcode::LAYER_BLOCKING_REGION:
+                return readRegion(length, &command->blockingRegion);
+            case CommandStreamOpcode::LAYER_BUFFER_SLOTS_TO_CLEAR: {
+                auto& slots = command->bufferSlotsToClear.emplace();
+                slots.reserve(length);
+                for (uint32_t i = 0; i < length; i++) {
+                    slots.push_back(readSigned());
+                }
+                return true;
+            }
+            default:
+                ALOGE("unknown layer command 0x%x", static_cast<uint32_t>(opcode));
+                return false;
+        }
+    }
+
+    std::unique_ptr<CommandStreamQueueType> mQueue;
+    std::vector<int32_t> mScratch;
+
+    const int32_t* mData = nullptr;
+    size_t mDataSize = 0;
+    size_t mDataRead = 0;
+
+    std::vector<NativeHandle> mHandles;
+    std::vector<::ndk::ScopedFileDescriptor> mFences;
+};
+
+}  // namespace aidl::android::hardware::graphics::composer3
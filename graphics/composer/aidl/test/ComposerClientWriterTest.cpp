@@ -0,0 +1,193 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ComposerClientWriterTest"
+
+#include <aidl/android/hardware/graphics/composer3/IComposerClient.h>
+#include <android/hardware/graphics/composer3/ComposerClientWriter.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+constexpr int64_t kDisplay = 7;
+constexpr int64_t kLayer = 1;
+constexpr int64_t kOtherLayer = 2;
+
+class LayerStateCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override { mWriter.setLayerStateCacheEnabled(true); }
+
+    void writeLayerState(int64_t layer, float alpha = 1.0f) {
+        mWriter.setLayerDisplayFrame(kDisplay, layer, Rect{0, 0, 100, 100});
+        mWriter.setLayerDataspace(kDisplay, layer, Dataspace::SRGB);
+        mWriter.setLayerPlaneAlpha(kDisplay, layer, alpha);
+        mWriter.setLayerZOrder(kDisplay, layer, 3);
+    }
+
+    // Takes the frame and returns its layer commands.
+    std::vector<LayerCommand> takeLayers() {
+        mWriter.presentDisplay(kDisplay);
+        auto commands = mWriter.takePendingCommands();
+        EXPECT_EQ(1u, commands.size());
+        return commands.empty() ? std::vector<LayerCommand>() : std::move(commands[0].layers);
+    }
+
+    static bool hasFullState(const LayerCommand& command) {
+        return command.displayFrame && command.dataspace && command.planeAlpha && command.z;
+    }
+
+    ComposerClientWriter mWriter{kDisplay};
+};
+
+TEST_F(LayerStateCacheTest, UnchangedStateIsDropped) {
+    writeLayerState(kLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_TRUE(hasFullState(layers[0]));
+
+    // The layer command is dropped along with its state; the display command stays.
+    writeLayerState(kLayer);
+    EXPECT_TRUE(takeLayers().empty());
+}
+
+TEST_F(LayerStateCacheTest, ChangedStateIsWritten) {
+    writeLayerState(kLayer);
+    takeLayers();
+
+    writeLayerState(kLayer, 0.5f);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kLayer, layers[0].layer);
+    ASSERT_TRUE(layers[0].planeAlpha);
+    EXPECT_EQ(0.5f, layers[0].planeAlpha->alpha);
+    EXPECT_FALSE(layers[0].displayFrame);
+    EXPECT_FALSE(layers[0].dataspace);
+    EXPECT_FALSE(layers[0].z);
+}
+
+TEST_F(LayerStateCacheTest, DisabledCacheWritesEverything) {
+    mWriter.setLayerStateCacheEnabled(false);
+    writeLayerState(kLayer);
+    takeLayers();
+
+    writeLayerState(kLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_TRUE(hasFullState(layers[0]));
+}
+
+TEST_F(LayerStateCacheTest, DisablingForgetsEverything) {
+    writeLayerState(kLayer);
+    takeLayers();
+
+    mWriter.setLayerStateCacheEnabled(false);
+    mWriter.setLayerStateCacheEnabled(true);
+    writeLayerState(kLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_TRUE(hasFullState(layers[0]));
+}
+
+TEST_F(LayerStateCacheTest, LayerLifecycleResetsState) {
+    writeLayerState(kLayer);
+    takeLayers();
+
+    mWriter.setLayerLifecycleBatchCommandType(kDisplay, kLayer,
+                                              LayerLifecycleBatchCommandType::DESTROY);
+    ASSERT_EQ(1u, takeLayers().size());
+
+    // A new layer may reuse the id of a destroyed one.
+    mWriter.setLayerLifecycleBatchCommandType(kDisplay, kLayer,
+                                              LayerLifecycleBatchCommandType::CREATE);
+    writeLayerState(kLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_TRUE(hasFullState(layers[0]));
+}
+
+TEST_F(LayerStateCacheTest, ClearedLayerIsForgotten) {
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    takeLayers();
+
+    mWriter.clearLayerStateCache(kLayer);
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kLayer, layers[0].layer);
+    EXPECT_TRUE(hasFullState(layers[0]));
+
+    mWriter.clearLayerStateCache();
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    EXPECT_EQ(2u, takeLayers().size());
+}
+
+TEST_F(LayerStateCacheTest, BuffersAndCompositionTypesAreNeverDropped) {
+    for (int i = 0; i < 2; i++) {
+        mWriter.setLayerBuffer(kDisplay, kLayer, 0, nullptr, -1);
+        mWriter.setLayerCompositionType(kDisplay, kLayer, Composition::DEVICE);
+        auto layers = takeLayers();
+        ASSERT_EQ(1u, layers.size());
+        EXPECT_TRUE(layers[0].buffer);
+        EXPECT_TRUE(layers[0].composition);
+    }
+}
+
+TEST_F(LayerStateCacheTest, FailedCommandIsSentAgain) {
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    takeLayers();
+
+    // The composer rejected the first frame, for one of its layers.
+    mWriter.clearLayerStateCache(
+            {CommandError{.commandIndex = 0, .errorCode = IComposerClient::EX_BAD_PARAMETER}});
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(2u, layers.size());
+    EXPECT_TRUE(hasFullState(layers[0]));
+    EXPECT_TRUE(hasFullState(layers[1]));
+
+    // Once accepted, the state is dropped again.
+    mWriter.clearLayerStateCache(std::vector<CommandError>{});
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    EXPECT_TRUE(takeLayers().empty());
+}
+
+TEST_F(LayerStateCacheTest, ErrorsOnlyClearTheLayersOfTheirCommand) {
+    writeLayerState(kLayer);
+    takeLayers();
+    writeLayerState(kOtherLayer);
+    takeLayers();
+
+    // Errors refer to the commands last taken, which only had kOtherLayer.
+    mWriter.clearLayerStateCache(
+            {CommandError{.commandIndex = 0, .errorCode = IComposerClient::EX_BAD_PARAMETER},
+             CommandError{.commandIndex = 5, .errorCode = IComposerClient::EX_BAD_LAYER}});
+    writeLayerState(kLayer);
+    writeLayerState(kOtherLayer);
+    auto layers = takeLayers();
+    ASSERT_EQ(1u, layers.size());
+    EXPECT_EQ(kOtherLayer, layers[0].layer);
+    EXPECT_TRUE(hasFullState(layers[0]));
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
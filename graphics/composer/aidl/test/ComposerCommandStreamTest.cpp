@@ -0,0 +1,186 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ComposerCommandStreamTest"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <android/binder_parcel.h>
+#include <android/hardware/graphics/composer3/ComposerCommandStream.h>
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::graphics::composer3 {
+namespace {
+
+constexpr int64_t kDisplay = 7;
+
+::ndk::ScopedFileDescriptor openNull() {
+    return ::ndk::ScopedFileDescriptor(open("/dev/null", O_RDONLY | O_CLOEXEC));
+}
+
+// A frame of |layerCount| layers, each with a buffer handle, an acquire fence
+// and some region state, followed by present.
+std::vector<DisplayCommand> buildFrame(int layerCount) {
+    std::vector<DisplayCommand> commands(1);
+    DisplayCommand& display = commands[0];
+    display.display = kDisplay;
+    display.brightness = DisplayBrightness{.brightness = 0.5f, .brightnessNits = 400.f};
+    display.presentOrValidateDisplay = true;
+    display.frameIntervalNs = 8333333;
+    for (int i = 0; i < layerCount; i++) {
+        LayerCommand& layer = display.layers.emplace_back();
+        layer.layer = i + 1;
+        NativeHandle handle;
+        handle.fds.emplace_back(openNull());
+        handle.ints = {i, 2 * i};
+        layer.buffer = Buffer{.slot = i, .handle = std::move(handle), .fence = openNull()};
+        layer.damage = std::vector<common::Rect>{{0, 0, 64, 64}, {128, 128, 256, 256}};
+        layer.planeAlpha = PlaneAlpha{.alpha = 0.5f};
+        layer.z = ZOrder{.z = i};
+        layer.perFrameMetadataBlob = std::vector<PerFrameMetadataBlob>{
+                {PerFrameMetadataKey::HDR10_PLUS_SEI, {1, 2, 3, 4, 5}}};
+    }
+    return commands;
+}
+
+// The file descriptors of the handles and fences of |commands|, in order.
+std::vector<int> getFds(const std::vector<DisplayCommand>& commands) {
+    std::vector<int> fds;
+    for (const auto& display : commands) {
+        for (const auto& layer : display.layers) {
+            if (layer.buffer) {
+                fds.push_back(layer.buffer->handle ? layer.buffer->handle->fds[0].get() : -1);
+                fds.push_back(layer.buffer->fence.get());
+            }
+        }
+    }
+    return fds;
+}
+
+class ComposerCommandStreamTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        ASSERT_NO_FATAL_FAILURE(connect(ComposerCommandStreamWriter::kDefaultQueueSize));
+    }
+
+    void connect(size_t queueSize) {
+        mWriter = std::make_unique<ComposerCommandStreamWriter>(queueSize);
+        ASSERT_TRUE(mWriter->isValid());
+        auto desc = mWriter->dupeDesc();
+        ASSERT_TRUE(desc);
+        ASSERT_TRUE(mReader.setMQDescriptor(*desc));
+    }
+
+    std::unique_ptr<ComposerCommandStreamWriter> mWriter;
+    ComposerCommandStreamReader mReader;
+};
+
+TEST_F(ComposerCommandStreamTest, RoundTrip) {
+    std::vector<DisplayCommand> commands = buildFrame(4);
+    const std::vector<int> fds = getFds(commands);
+
+    int32_t length = 0;
+    std::vector<NativeHandle> handles;
+    std::vector<::ndk::ScopedFileDescriptor> fences;
+    ASSERT_TRUE(mWriter->writeQueue(commands, &length, &handles, &fences));
+    EXPECT_GT(length, 0);
+    EXPECT_EQ(4u, handles.size());
+    EXPECT_EQ(4u, fences.size());
+
+    std::vector<DisplayCommand> decoded;
+    ASSERT_TRUE(mReader.readQueue(length, std::move(handles), std::move(fences), &decoded));
+    // The handles and fences moved along with the stream.
+    EXPECT_EQ(fds, getFds(decoded));
+
+    // Apart from the file descriptors, the frame decodes to what was encoded.
+    std::vector<DisplayCommand> expected = buildFrame(4);
+    for (auto& display : {&expected, &decoded}) {
+        for (auto& layer : (*display)[0].layers) {
+            layer.buffer->handle->fds.clear();
+            layer.buffer->fence = ::ndk::ScopedFileDescriptor();
+        }
+    }
+    EXPECT_EQ(expected, decoded);
+}
+
+TEST_F(ComposerCommandStreamTest, EmptyFrame) {
+    std::vector<DisplayCommand> commands;
+    int32_t length = -1;
+    std::vector<NativeHandle> handles;
+    std::vector<::ndk::ScopedFileDescriptor> fences;
+    ASSERT_TRUE(mWriter->writeQueue(commands, &length, &handles, &fences));
+    EXPECT_EQ(0, length);
+
+    std::vector<DisplayCommand> decoded;
+    ASSERT_TRUE(mReader.readQueue(length, std::move(handles), std::move(fences), &decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST_F(ComposerCommandStreamTest, FallbackKeepsHandlesAndFences) {
+    ASSERT_NO_FATAL_FAILURE(connect(64));
+    std::vector<DisplayCommand> commands = buildFrame(16);
+    const std::vector<int> fds = getFds(commands);
+
+    int32_t length = 0;
+    std::vector<NativeHandle> handles;
+    std::vector<::ndk::ScopedFileDescriptor> fences;
+    ASSERT_FALSE(mWriter->writeQueue(commands, &length, &handles, &fences));
+    EXPECT_TRUE(handles.empty());
+    EXPECT_TRUE(fences.empty());
+    EXPECT_EQ(fds, getFds(commands));
+
+    // The parcel path still carries the whole frame.
+    AParcel* parcel = AParcel_create();
+    for (const auto& command : commands) {
+        ASSERT_EQ(STATUS_OK, command.writeToParcel(parcel));
+    }
+    AParcel_setDataPosition(parcel, 0);
+    std::vector<DisplayCommand> decoded(commands.size());
+    for (auto& command : decoded) {
+        ASSERT_EQ(STATUS_OK, command.readFromParcel(parcel));
+    }
+    AParcel_delete(parcel);
+    ASSERT_EQ(1u, decoded.size());
+    ASSERT_EQ(16u, decoded[0].layers.size());
+    for (const auto& layer : decoded[0].layers) {
+        ASSERT_TRUE(layer.buffer);
+        ASSERT_TRUE(layer.buffer->handle);
+        EXPECT_EQ(1u, layer.buffer->handle->fds.size());
+        EXPECT_GE(layer.buffer->fence.get(), 0);
+    }
+
+    // The queue is left usable for the next frame.
+    std::vector<DisplayCommand> small = buildFrame(1);
+    ASSERT_TRUE(mWriter->writeQueue(small, &length, &handles, &fences));
+    ASSERT_TRUE(mReader.readQueue(length, std::move(handles), std::move(fences), &decoded));
+    ASSERT_EQ(1u, decoded.size());
+    EXPECT_EQ(1u, decoded[0].layers.size());
+}
+
+TEST_F(ComposerCommandStreamTest, RejectsMissingSideTables) {
+    std::vector<DisplayCommand> commands = buildFrame(1);
+    int32_t length = 0;
+    std::vector<NativeHandle> handles;
+    std::vector<::ndk::ScopedFileDescriptor> fences;
+    ASSERT_TRUE(mWriter->writeQueue(commands, &length, &handles, &fences));
+
+    std::vector<DisplayCommand> decoded;
+    EXPECT_FALSE(mReader.readQueue(length, {}, {}, &decoded));
+}
+
+}  // namespace
+}  // namespace aidl::android::hardware::graphics::composer3
@@ -343,6 +343,107 @@ TEST(MetadataProvider, outOfBounds) {
             << "100 (out of range) should have resulted in UNSUPPORTED";
 }
 
+TEST(Metadata, decodeIntoReusesStorage) {
+    using PlaneLayoutValue = StandardMetadata<StandardMetadataType::PLANE_LAYOUTS>::value;
+    using SMPTE2094_40Value = StandardMetadata<StandardMetadataType::SMPTE2094_40>::value;
+
+    std::vector<uint8_t> buffer(10000, 0);
+    std::vector<PlaneLayout> layouts = fakePlaneLayouts();
+    ASSERT_GT(PlaneLayoutValue::encode(layouts, buffer.data(), buffer.size()), 0);
+
+    std::vector<PlaneLayout> read(4);
+    read[0].components.resize(5);
+    const auto* firstPlane = read.data();
+    const auto* firstComponent = read[0].components.data();
+    ASSERT_TRUE(PlaneLayoutValue::decodeInto(buffer.data(), buffer.size(), read));
+    EXPECT_EQ(layouts, read);
+    EXPECT_EQ(firstPlane, read.data());
+    EXPECT_EQ(firstComponent, read[0].components.data());
+    EXPECT_FALSE(PlaneLayoutValue::decodeInto(buffer.data(), 0, read));
+
+    const std::vector<uint8_t> simpleBuffer{0, 1, 2, 3, 4, 5};
+    ASSERT_GT(SMPTE2094_40Value::encode(simpleBuffer, buffer.data(), buffer.size()), 0);
+    std::optional<std::vector<uint8_t>> blob{std::vector<uint8_t>(64, 0xff)};
+    const auto* blobData = blob->data();
+    ASSERT_TRUE(SMPTE2094_40Value::decodeInto(buffer.data(), buffer.size(), blob));
+    ASSERT_TRUE(blob.has_value());
+    EXPECT_EQ(simpleBuffer, *blob);
+    EXPECT_EQ(blobData, blob->data());
+    ASSERT_TRUE(SMPTE2094_40Value::decodeInto(buffer.data(), 0, blob));
+    EXPECT_FALSE(blob.has_value());
+}
+
+static int32_t provideBatchTestValues(StandardMetadataRequest* requests, size_t count,
+                                      std::vector<uint8_t>& buffer) {
+    return provideStandardMetadataBatch(
+            requests, count, buffer.data(), buffer.size(),
+            []<StandardMetadataType T>(auto&& provide) -> int32_t {
+                if constexpr (T == StandardMetadataType::BUFFER_ID) {
+                    return provide(42);
+                } else if constexpr (T == StandardMetadataType::NAME) {
+                    return provide("batched");
+                } else if constexpr (T == StandardMetadataType::DATASPACE) {
+                    return provide(Dataspace::DISPLAY_P3);
+                }
+                return -AIMAPPER_ERROR_UNSUPPORTED;
+            });
+}
+
+TEST(MetadataProvider, batch) {
+    StandardMetadataRequest requests[] = {
+            {.type = StandardMetadataType::BUFFER_ID},
+            {.type = StandardMetadataType::CROP},
+            {.type = StandardMetadataType::NAME},
+            {.type = StandardMetadataType::DATASPACE},
+    };
+
+    std::vector<uint8_t> buffer(10000, 0);
+    int32_t result = provideBatchTestValues(requests, std::size(requests), buffer);
+    EXPECT_EQ(requests[0].size + requests[2].size + requests[3].size, result);
+    EXPECT_EQ(-AIMAPPER_ERROR_UNSUPPORTED, requests[1].size);
+    EXPECT_EQ(nullptr, requests[1].data);
+    EXPECT_EQ(buffer.data(), requests[0].data);
+    EXPECT_EQ(buffer.data() + requests[0].size, requests[2].data);
+
+    auto bufferId = StandardMetadata<StandardMetadataType::BUFFER_ID>::value::decode(
+            requests[0].data, requests[0].size);
+    EXPECT_EQ(42, bufferId.value_or(0));
+    auto name = StandardMetadata<StandardMetadataType::NAME>::value::decode(requests[2].data,
+                                                                            requests[2].size);
+    EXPECT_EQ("batched", name.value_or(""));
+    auto dataspace = StandardMetadata<StandardMetadataType::DATASPACE>::value::decode(
+            requests[3].data, requests[3].size);
+    EXPECT_EQ(Dataspace::DISPLAY_P3, dataspace.value_or(Dataspace::UNKNOWN));
+
+    int applied = 0;
+    EXPECT_EQ(AIMAPPER_ERROR_NONE,
+              applyStandardMetadataBatch(requests + 2, 2, [&]<StandardMetadataType T>(auto&&) {
+                  applied++;
+                  return AIMAPPER_ERROR_NONE;
+              }));
+    EXPECT_EQ(2, applied);
+}
+
+TEST(MetadataProvider, batchTooSmall) {
+    StandardMetadataRequest requests[] = {
+            {.type = StandardMetadataType::BUFFER_ID},
+            {.type = StandardMetadataType::NAME},
+            {.type = StandardMetadataType::DATASPACE},
+    };
+
+    std::vector<uint8_t> buffer(8 + HeaderSize + 1, 0);
+    int32_t result = provideBatchTestValues(requests, std::size(requests), buffer);
+    EXPECT_EQ(buffer.data(), requests[0].data);
+    EXPECT_EQ(nullptr, requests[1].data);
+    EXPECT_EQ(nullptr, requests[2].data) << "values after the first miss must not be written";
+
+    buffer.resize(result);
+    EXPECT_EQ(result, provideBatchTestValues(requests, std::size(requests), buffer));
+    for (const auto& request : requests) {
+        EXPECT_NE(nullptr, request.data);
+    }
+}
+
 template <StandardMetadataType T>
 std::vector<uint8_t> encode(const typename StandardMetadata<T>::value_type& value) {
     using Value = typename StandardMetadata<T>::value;
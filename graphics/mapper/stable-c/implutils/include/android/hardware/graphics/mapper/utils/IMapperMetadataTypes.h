@@ -234,17 +234,30 @@ class MetadataReader {
         }
     }
 
-    [[nodiscard]] std::vector<uint8_t> readBuffer() {
-        std::vector<uint8_t> ret;
+    // Reads a length-prefixed byte buffer into dest, reusing its capacity
+    MetadataReader& read(std::vector<uint8_t>& dest) {
         size_t length = readInt<int64_t>().value_or(0);
         if (const void* src = advance(length)) {
-            ret.resize(length);
-            memcpy(ret.data(), src, length);
+            const uint8_t* begin = reinterpret_cast<const uint8_t*>(src);
+            dest.assign(begin, begin + length);
+        } else {
+            dest.clear();
         }
+        return *this;
+    }
+
+    [[nodiscard]] std::vector<uint8_t> readBuffer() {
+        std::vector<uint8_t> ret;
+        read(ret);
         return ret;
     }
 };
 
+// Every MetadataValue below provides, next to encode() and decode(), a
+// decodeInto() that decodes into caller-owned storage so that clients polling
+// the same metadata every frame can reuse their allocations. dest is left in
+// an unspecified state when decodeInto() returns false.
+
 template <typename HEADER, typename T, class Enable = void>
 struct MetadataValue {};
 
@@ -264,6 +277,14 @@ struct MetadataValue<HEADER, T, std::enable_if_t<std::is_integral_v<T>>> {
                 .template checkHeader<HEADER>()
                 .template readInt<T>();
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         T& dest) {
+        return MetadataReader{metadata, metadataSize}
+                .template checkHeader<HEADER>()
+                .read(dest)
+                .ok();
+    }
 };
 
 template <typename HEADER, typename T>
@@ -283,6 +304,16 @@ struct MetadataValue<HEADER, T, std::enable_if_t<std::is_enum_v<T>>> {
                        ? std::optional<T>(static_cast<T>(temp))
                        : std::nullopt;
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         T& dest) {
+        auto value = decode(metadata, metadataSize);
+        if (!value.has_value()) {
+            return false;
+        }
+        dest = *value;
+        return true;
+    }
 };
 
 template <typename HEADER>
@@ -301,6 +332,17 @@ struct MetadataValue<HEADER, std::string> {
         auto result = reader.readString();
         return reader.ok() ? std::optional<std::string>{result} : std::nullopt;
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         std::string& dest) {
+        auto reader = MetadataReader{metadata, metadataSize}.template checkHeader<HEADER>();
+        auto result = reader.readString();
+        if (!reader.ok()) {
+            return false;
+        }
+        dest.assign(result);
+        return true;
+    }
 };
 
 template <typename HEADER>
@@ -321,6 +363,19 @@ struct MetadataValue<HEADER, ExtendableType> {
                 .template checkHeader<HEADER>()
                 .readExtendable();
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         ExtendableType& dest) {
+        auto reader = MetadataReader{metadata, metadataSize}.template checkHeader<HEADER>();
+        auto name = reader.readString();
+        auto value = reader.readInt<int64_t>();
+        if (!reader.ok()) {
+            return false;
+        }
+        dest.name.assign(name);
+        dest.value = *value;
+        return true;
+    }
 };
 
 template <typename HEADER>
@@ -352,20 +407,32 @@ struct MetadataValue<HEADER, std::vector<PlaneLayout>> {
     using DecodeResult = std::optional<std::vector<PlaneLayout>>;
     [[nodiscard]] static DecodeResult decode(const void* _Nonnull metadata, size_t metadataSize) {
         std::vector<PlaneLayout> values;
+        return decodeInto(metadata, metadataSize, values) ? DecodeResult{std::move(values)}
+                                                          : std::nullopt;
+    }
+
+    // Planes and components already present in values are overwritten in place
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         std::vector<PlaneLayout>& values) {
         MetadataReader reader{metadata, metadataSize};
         reader.template checkHeader<HEADER>();
         auto numPlanes = reader.readInt<int64_t>().value_or(0);
-        values.reserve(numPlanes);
-        for (int i = 0; i < numPlanes && reader.ok(); i++) {
-            PlaneLayout& value = values.emplace_back();
+        int i = 0;
+        for (; i < numPlanes && reader.ok(); i++) {
+            PlaneLayout& value =
+                    static_cast<size_t>(i) < values.size() ? values[i] : values.emplace_back();
             auto numPlaneComponents = reader.readInt<int64_t>().value_or(0);
-            value.components.reserve(numPlaneComponents);
-            for (int j = 0; j < numPlaneComponents && reader.ok(); j++) {
-                PlaneLayoutComponent& component = value.components.emplace_back();
+            int j = 0;
+            for (; j < numPlaneComponents && reader.ok(); j++) {
+                PlaneLayoutComponent& component =
+                        static_cast<size_t>(j) < value.components.size()
+                                ? value.components[j]
+                                : value.components.emplace_back();
                 reader.read(component.type)
                         .read<int64_t>(component.offsetInBits)
                         .read<int64_t>(component.sizeInBits);
             }
+            value.components.resize(j);
             reader.read<int64_t>(value.offsetInBytes)
                     .read<int64_t>(value.sampleIncrementInBits)
                     .read<int64_t>(value.strideInBytes)
@@ -375,7 +442,8 @@ struct MetadataValue<HEADER, std::vector<PlaneLayout>> {
                     .read<int64_t>(value.horizontalSubsampling)
                     .read<int64_t>(value.verticalSubsampling);
         }
-        return reader.ok() ? DecodeResult{std::move(values)} : std::nullopt;
+        values.resize(i);
+        return reader.ok();
     }
 };
 
@@ -397,11 +465,17 @@ struct MetadataValue<HEADER, std::vector<Rect>> {
 
     using DecodeResult = std::optional<std::vector<Rect>>;
     [[nodiscard]] static DecodeResult decode(const void* _Nonnull metadata, size_t metadataSize) {
+        std::vector<Rect> value;
+        return decodeInto(metadata, metadataSize, value) ? DecodeResult{std::move(value)}
+                                                         : std::nullopt;
+    }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         std::vector<Rect>& value) {
         MetadataReader reader{metadata, metadataSize};
         reader.template checkHeader<HEADER>();
-        std::vector<Rect> value;
         auto numRects = reader.readInt<int64_t>().value_or(0);
-        value.reserve(numRects);
+        value.clear();
         for (int i = 0; i < numRects && reader.ok(); i++) {
             Rect& rect = value.emplace_back();
             reader.read<int32_t>(rect.left)
@@ -409,7 +483,7 @@ struct MetadataValue<HEADER, std::vector<Rect>> {
                     .read<int32_t>(rect.right)
                     .read<int32_t>(rect.bottom);
         }
-        return reader.ok() ? DecodeResult{std::move(value)} : std::nullopt;
+        return reader.ok();
     }
 };
 
@@ -455,6 +529,16 @@ struct MetadataValue<HEADER, std::optional<Smpte2086>> {
         }
         return DecodeResult{std::move(optValue)};
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nullable metadata, size_t metadataSize,
+                                         std::optional<Smpte2086>& dest) {
+        auto value = decode(metadata, metadataSize);
+        if (!value.has_value()) {
+            return false;
+        }
+        dest = *value;
+        return true;
+    }
 };
 
 template <typename HEADER>
@@ -490,6 +574,16 @@ struct MetadataValue<HEADER, std::optional<Cta861_3>> {
         }
         return DecodeResult{std::move(optValue)};
     }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nullable metadata, size_t metadataSize,
+                                         std::optional<Cta861_3>& dest) {
+        auto value = decode(metadata, metadataSize);
+        if (!value.has_value()) {
+            return false;
+        }
+        dest = *value;
+        return true;
+    }
 };
 
 template <typename HEADER>
@@ -508,17 +602,22 @@ struct MetadataValue<HEADER, std::optional<std::vector<uint8_t>>> {
     using DecodeResult = std::optional<std::optional<std::vector<uint8_t>>>;
     [[nodiscard]] static DecodeResult decode(const void* _Nonnull metadata, size_t metadataSize) {
         std::optional<std::vector<uint8_t>> optValue;
-        if (metadataSize > 0) {
-            MetadataReader reader{metadata, metadataSize};
-            reader.template checkHeader<HEADER>();
-            auto value = reader.readBuffer();
-            if (reader.ok()) {
-                optValue = std::move(value);
-            } else {
-                return std::nullopt;
-            }
+        return decodeInto(metadata, metadataSize, optValue) ? DecodeResult{std::move(optValue)}
+                                                            : std::nullopt;
+    }
+
+    [[nodiscard]] static bool decodeInto(const void* _Nonnull metadata, size_t metadataSize,
+                                         std::optional<std::vector<uint8_t>>& dest) {
+        if (metadataSize == 0) {
+            dest.reset();
+            return true;
         }
-        return DecodeResult{std::move(optValue)};
+        MetadataReader reader{metadata, metadataSize};
+        reader.template checkHeader<HEADER>();
+        if (!dest.has_value()) {
+            dest.emplace();
+        }
+        return reader.read(*dest).ok();
     }
 };
 
@@ -623,6 +722,75 @@ AIMapper_Error applyStandardMetadata(StandardMetadataType type, const void* _Non
     return retVal;
 }
 
+/**
+ * One entry of a batched standard metadata query, see provideStandardMetadataBatch.
+ */
+struct StandardMetadataRequest {
+    StandardMetadataType type = StandardMetadataType::INVALID;
+    // On return, the encoded size of the value or a negative AIMapper_Error
+    int32_t size = 0;
+    // On return, where the value was encoded in the destination buffer, or nullptr if it was
+    // not written
+    void* _Nullable data = nullptr;
+};
+
+/**
+ * Encodes several standard metadata types back to back into a single destination buffer, so
+ * that an implementation can answer a multi-key query with one buffer lookup and one lock
+ * acquisition instead of one per key. f is invoked exactly as by provideStandardMetadata.
+ *
+ * A failure to provide one type is reported in that request's size and does not affect the
+ * others. Once a value does not fit, no further values are written; the return value is the
+ * total size needed to hold every value that was provided, so a caller can retry with a buffer
+ * of that size, or -AIMAPPER_ERROR_BAD_VALUE if that size overflows.
+ */
+template <typename F>
+int32_t provideStandardMetadataBatch(StandardMetadataRequest* _Nonnull requests, size_t count,
+                                     void* _Nullable destBuffer, size_t destBufferSize, F&& f) {
+    uint8_t* dest = reinterpret_cast<uint8_t*>(destBuffer);
+    size_t remaining = destBuffer ? destBufferSize : 0;
+    int32_t desiredSize = 0;
+    for (size_t i = 0; i < count; i++) {
+        StandardMetadataRequest& request = requests[i];
+        request.size = provideStandardMetadata(request.type, dest, remaining, f);
+        request.data = nullptr;
+        if (request.size < 0) {
+            continue;
+        }
+        if (__builtin_add_overflow(desiredSize, request.size, &desiredSize)) {
+            return -AIMAPPER_ERROR_BAD_VALUE;
+        }
+        if (static_cast<size_t>(request.size) <= remaining) {
+            request.data = dest;
+            dest += request.size;
+            remaining -= request.size;
+        } else {
+            remaining = 0;
+        }
+    }
+    return desiredSize;
+}
+
+/**
+ * Decodes and applies several standard metadata values in one pass; f is invoked exactly as by
+ * applyStandardMetadata. Stops at, and returns, the first error.
+ */
+template <typename F>
+AIMapper_Error applyStandardMetadataBatch(const StandardMetadataRequest* _Nonnull requests,
+                                          size_t count, F&& f) {
+    for (size_t i = 0; i < count; i++) {
+        const StandardMetadataRequest& request = requests[i];
+        if (request.size < 0 || (request.size > 0 && !request.data)) {
+            return AIMAPPER_ERROR_BAD_VALUE;
+        }
+        AIMapper_Error error = applyStandardMetadata(request.type, request.data, request.size, f);
+        if (error != AIMAPPER_ERROR_NONE) {
+            return error;
+        }
+    }
+    return AIMAPPER_ERROR_NONE;
+}
+
 #endif
 
 }  // namespace android::hardware::graphics::mapper
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include <health/utils.h>
 
 #include "LinkedCallback.h"
+#include "StorageHealth.h"
 #include "health-convert.h"
 
 using std::string_literals::operator""s;
@@ -56,6 +57,7 @@ class MyHealth : public Health {
 Health::Health(std::string_view instance_name, std::unique_ptr<struct healthd_config>&& config)
     : instance_name_(instance_name),
       healthd_config_(std::move(config)),
+      storage_health_(std::make_unique<StorageHealth>()),
       death_recipient_(AIBinder_DeathRecipient_new(&OnCallbackDiedWrapped)) {
     battery_monitor_.init(healthd_config_.get());
 }
@@ -174,16 +176,24 @@ ndk::ScopedAStatus Health::getBatteryHealthData(BatteryHealthData* out) {
     return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Health::getDiskStats(std::vector<DiskStats>*) {
-    // This implementation does not support DiskStats. An implementation may extend this
-    // class and override this function to support disk stats.
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Health::getDiskStats(std::vector<DiskStats>* out) {
+    // An implementation may extend this class and override this function for devices that
+    // /proc/diskstats does not describe.
+    if (!storage_health_->HasDiskStats()) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    storage_health_->GetDiskStats(out);
+    return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Health::getStorageInfo(std::vector<StorageInfo>*) {
-    // This implementation does not support StorageInfo. An implementation may extend this
-    // class and override this function to support storage info.
-    return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+ndk::ScopedAStatus Health::getStorageInfo(std::vector<StorageInfo>* out) {
+    // An implementation may extend this class and override this function for storage other than
+    // eMMC and UFS.
+    if (!storage_health_->HasStorageInfo()) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    }
+    storage_health_->GetStorageInfo(out);
+    return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus Health::getHealthInfo(HealthInfo* out) {
@@ -233,6 +243,7 @@ binder_status_t Health::dump(int fd, const char**, uint32_t) {
         ::android::base::WriteStringToFd(res.getDescription(), fd);
     }
     ::android::base::WriteStringToFd("\n", fd);
+    storage_health_->Dump(fd);
 
     fsync(fd);
     return STATUS_OK;
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StorageHealth.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cinttypes>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+using ::android::base::boot_clock;
+using ::android::base::StartsWith;
+using ::android::base::StringPrintf;
+using ::android::base::unique_fd;
+
+namespace aidl::android::hardware::health {
+
+namespace {
+
+// The columns of /proc/diskstats after the device name, in order.
+constexpr int64_t DiskStats::*kDiskStatsFields[] = {
+        &DiskStats::reads,      &DiskStats::readMerges, &DiskStats::readSectors,
+        &DiskStats::readTicks,  &DiskStats::writes,     &DiskStats::writeMerges,
+        &DiskStats::writeSectors, &DiskStats::writeTicks, &DiskStats::ioInFlight,
+        &DiskStats::ioTicks,    &DiskStats::ioInQueue,
+};
+
+// /proc/diskstats is about 100 bytes per block device.
+constexpr size_t kInitialDiskStatsBufferSize = 8192;
+
+// EXT_CSD_REV of the eMMC specification versions.
+const std::map<std::string, std::string> kEmmcVersions = {
+        {"0x0", "4.0"},  {"0x1", "4.1"}, {"0x2", "4.2"}, {"0x3", "4.3"},
+        {"0x5", "4.41"}, {"0x6", "4.5"}, {"0x7", "5.0"}, {"0x8", "5.1"},
+};
+
+// Whether |name| is the whole disk of an eMMC or SD card, e.g. "mmcblk0" but not "mmcblk0boot0".
+bool IsMmcDisk(const std::string& name) {
+    return StartsWith(name, "mmcblk") && name.size() > strlen("mmcblk") &&
+           name.find_first_not_of("0123456789", strlen("mmcblk")) == std::string::npos;
+}
+
+unique_fd OpenReadOnly(const std::string& path) {
+    return unique_fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+}
+
+std::vector<std::string> ListDir(const std::string& path) {
+    std::vector<std::string> names;
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+    if (!dir) {
+        return names;
+    }
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (entry->d_name[0] != '.') {
+            names.emplace_back(entry->d_name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::string ReadTrimmed(const std::string& path) {
+    std::string value;
+    if (!::android::base::ReadFileToString(path, &value)) {
+        return "";
+    }
+    return ::android::base::Trim(value);
+}
+
+// Removes the next whitespace-separated token from |text| and returns it.
+std::string_view NextToken(std::string_view* text) {
+    size_t start = text->find_first_not_of(" \t\n");
+    if (start == std::string_view::npos) {
+        *text = {};
+        return {};
+    }
+    text->remove_prefix(start);
+    std::string_view token = text->substr(0, text->find_first_of(" \t\n"));
+    text->remove_prefix(token.size());
+    return token;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view token, T* value, int base = 10) {
+    const char* end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, *value, base);
+    return !token.empty() && ec == std::errc() && ptr == end;
+}
+
+// Reads up to |count| hexadecimal values such as "0x01" from |fd|. Returns how many were read.
+size_t ReadHexValues(int fd, int32_t* values, size_t count) {
+    char buf[64];
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf), 0));
+    if (len <= 0) {
+        return 0;
+    }
+    std::string_view text(buf, len);
+    size_t n = 0;
+    while (n < count) {
+        std::string_view token = NextToken(&text);
+        if (token.size() > 2 && token.substr(0, 2) == "0x") {
+            token.remove_prefix(2);
+        }
+        if (!ParseNumber(token, &values[n], 16)) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+}  // namespace
+
+StorageHealth::StorageHealth(const std::string& sysfs_root, const std::string& procfs_root) {
+    FindDisks(sysfs_root);
+    if (HasDiskStats()) {
+        diskstats_fd_ = OpenReadOnly(procfs_root + "/diskstats");
+        if (diskstats_fd_.ok()) {
+            std::lock_guard<std::mutex> lock(lock_);
+            buffer_.resize(kInitialDiskStatsBufferSize);
+            disk_stats_.resize(disks_.size());
+            previous_disk_stats_.resize(disks_.size());
+        } else {
+            PLOG(WARNING) << "Cannot open " << procfs_root << "/diskstats";
+            disks_.clear();
+        }
+    }
+
+    std::vector<StorageInfo> storage_infos = FindStorageDevices(sysfs_root);
+    std::lock_guard<std::mutex> lock(lock_);
+    storage_infos_ = std::move(storage_infos);
+}
+
+void StorageHealth::FindDisks(const std::string& sysfs_root) {
+    // Virtual block devices, such as loop, dm and zram, have no device. The boot partitions
+    // and the RPMB of an eMMC are part of the eMMC disk.
+    for (const auto& name : ListDir(sysfs_root + "/block")) {
+        if (access((sysfs_root + "/block/" + name + "/device").c_str(), F_OK) != 0 ||
+            (StartsWith(name, "mmcblk") && !IsMmcDisk(name))) {
+            continue;
+        }
+        disks_.push_back(name);
+    }
+}
+
+std::vector<StorageInfo> StorageHealth::FindStorageDevices(const std::string& sysfs_root) {
+    std::vector<StorageInfo> infos;
+    for (const auto& name : ListDir(sysfs_root + "/block")) {
+        if (!IsMmcDisk(name)) {
+            continue;
+        }
+        // The health of an eMMC is in the EXT_CSD of its card. SD cards have none.
+        const std::string card = sysfs_root + "/block/" + name + "/device/";
+        StorageDevice device = {.eol_fd = OpenReadOnly(card + "pre_eol_info")};
+        device.lifetime_fds.push_back(OpenReadOnly(card + "life_time"));
+        if (!device.eol_fd.ok() || !device.lifetime_fds[0].ok()) {
+            continue;
+        }
+        auto version = kEmmcVersions.find(ReadTrimmed(card + "rev"));
+        StorageInfo info = {
+                .version = "emmc " + (version != kEmmcVersions.end() ? version->second : "?"),
+        };
+        storage_devices_.push_back(std::move(device));
+        infos.push_back(std::move(info));
+    }
+
+    // The UFS host controller exposes the health descriptor of its device.
+    for (const std::string bus : {"/bus/platform/devices/", "/bus/pci/devices/"}) {
+        for (const auto& name : ListDir(sysfs_root + bus)) {
+            const std::string ufs = sysfs_root + bus + name + "/";
+            StorageDevice device = {.eol_fd = OpenReadOnly(ufs + "health_descriptor/eol_info")};
+            if (!device.eol_fd.ok()) {
+                continue;
+            }
+            device.lifetime_fds.push_back(
+                    OpenReadOnly(ufs + "health_descriptor/life_time_estimation_a"));
+            device.lifetime_fds.push_back(
+                    OpenReadOnly(ufs + "health_descriptor/life_time_estimation_b"));
+            StorageInfo info = {
+                    .version =
+                            "ufs " + ReadTrimmed(ufs + "device_descriptor/specification_version"),
+            };
+            storage_devices_.push_back(std::move(device));
+            infos.push_back(std::move(info));
+        }
+    }
+    return infos;
+}
+
+void StorageHealth::GetDiskStats(std::vector<DiskStats>* out) {
+    std::lock_guard<std::mutex> lock(lock_);
+    UpdateLocked();
+    *out = disk_stats_;
+}
+
+void StorageHealth::GetStorageInfo(std::vector<StorageInfo>* out) {
+    std::lock_guard<std::mutex> lock(lock_);
+    UpdateLocked();
+    *out = storage_infos_;
+}
+
+void StorageHealth::UpdateLocked() {
+    const auto now = boot_clock::now();
+    if (snapshot_count_ > 0 && now - snapshot_time_ < kSnapshotMaxAge) {
+        return;
+    }
+    // On a read error, the values of the previous snapshot are kept.
+    previous_disk_stats_ = disk_stats_;
+    previous_snapshot_time_ = snapshot_time_;
+    if (HasDiskStats() && !ReadDiskStatsLocked()) {
+        PLOG(WARNING) << "Cannot read /proc/diskstats";
+    }
+    ReadStorageInfoLocked();
+    snapshot_time_ = now;
+    snapshot_count_++;
+}
+
+bool StorageHealth::ReadDiskStatsLocked() {
+    size_t len = 0;
+    for (;;) {
+        if (len == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+        ssize_t n = TEMP_FAILURE_RETRY(
+                pread(diskstats_fd_.get(), buffer_.data() + len, buffer_.size() - len, len));
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+
+    std::string_view text(buffer_.data(), len);
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        ParseDiskStatsLine(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    }
+    return true;
+}
+
+void StorageHealth::ParseDiskStatsLine(std::string_view line) {
+    // <major> <minor> <name> <reads> ... <ioInQueue> [discard and flush columns]
+    NextToken(&line);
+    NextToken(&line);
+    std::string_view name = NextToken(&line);
+    auto disk = std::find(disks_.begin(), disks_.end(), name);
+    if (disk == disks_.end()) {
+        return;
+    }
+    DiskStats stats;
+    for (auto field : kDiskStatsFields) {
+        uint64_t value;
+        if (!ParseNumber(NextToken(&line), &value)) {
+            LOG(WARNING) << "Cannot parse the /proc/diskstats line of " << *disk;
+            return;
+        }
+        stats.*field = static_cast<int64_t>(value);
+    }
+    disk_stats_[disk - disks_.begin()] = stats;
+}
+
+void StorageHealth::ReadStorageInfoLocked() {
+    for (size_t i = 0; i < storage_devices_.size(); i++) {
+        const StorageDevice& device = storage_devices_[i];
+        StorageInfo& info = storage_infos_[i];
+        ReadHexValues(device.eol_fd.get(), &info.eol, 1);
+        int32_t lifetimes[2] = {info.lifetimeA, info.lifetimeB};
+        size_t count = 0;
+        for (const auto& fd : device.lifetime_fds) {
+            count += ReadHexValues(fd.get(), lifetimes + count, std::size(lifetimes) - count);
+        }
+        if (count == std::size(lifetimes)) {
+            info.lifetimeA = lifetimes[0];
+            info.lifetimeB = lifetimes[1];
+        }
+    }
+}
+
+void StorageHealth::Dump(int fd) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (snapshot_count_ < 2) {
+        return;
+    }
+    const auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  snapshot_time_ - previous_snapshot_time_)
+                                  .count();
+    for (size_t i = 0; i < disks_.size(); i++) {
+        const DiskStats& now = disk_stats_[i];
+        const DiskStats& before = previous_disk_stats_[i];
+        // Sectors are 512 bytes.
+        ::android::base::WriteStringToFd(
+                StringPrintf("%s in the last %" PRId64 " ms: %" PRId64 " reads (%" PRId64
+                             " KiB), %" PRId64 " writes (%" PRId64 " KiB), busy %" PRId64 " ms\n",
+                             disks_[i].c_str(), static_cast<int64_t>(interval),
+                             now.reads - before.reads, (now.readSectors - before.readSectors) / 2,
+                             now.writes - before.writes,
+                             (now.writeSectors - before.writeSectors) / 2,
+                             now.ioTicks - before.ioTicks),
+                fd);
+    }
+}
+
+}  // namespace aidl::android::hardware::health
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <aidl/android/hardware/health/DiskStats.h>
+#include <aidl/android/hardware/health/StorageInfo.h>
+#include <android-base/chrono_utils.h>
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+namespace aidl::android::hardware::health {
+
+// Reads the DiskStats of the block devices and the StorageInfo of the eMMC and UFS devices.
+//
+// The files are opened once, at construction, and re-read with pread() into buffers that are
+// reused. A snapshot serves all the callers within kSnapshotMaxAge, such as the update() and
+// getHealthInfo() calls of one battery update.
+class StorageHealth {
+  public:
+    static constexpr std::chrono::milliseconds kSnapshotMaxAge{1000};
+
+    // |sysfs_root| and |procfs_root| are overridden by tests.
+    explicit StorageHealth(const std::string& sysfs_root = "/sys",
+                           const std::string& procfs_root = "/proc");
+
+    bool HasDiskStats() const { return !disks_.empty(); }
+    bool HasStorageInfo() const { return !storage_devices_.empty(); }
+
+    void GetDiskStats(std::vector<DiskStats>* out);
+    void GetStorageInfo(std::vector<StorageInfo>* out);
+
+    // Writes the I/O of each disk between the last two snapshots.
+    void Dump(int fd);
+
+  private:
+    struct StorageDevice {
+        ::android::base::unique_fd eol_fd;
+        // eMMC reports both life time estimations in one file, UFS in one file each.
+        std::vector<::android::base::unique_fd> lifetime_fds;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(StorageHealth);
+
+    void FindDisks(const std::string& sysfs_root);
+    // Returns the StorageInfo of the devices, with only their version set.
+    std::vector<StorageInfo> FindStorageDevices(const std::string& sysfs_root);
+
+    void UpdateLocked() REQUIRES(lock_);
+    bool ReadDiskStatsLocked() REQUIRES(lock_);
+    void ParseDiskStatsLine(std::string_view line) REQUIRES(lock_);
+    void ReadStorageInfoLocked() REQUIRES(lock_);
+
+    // Block devices backed by hardware, e.g. "sda" or "mmcblk0".
+    std::vector<std::string> disks_;
+    ::android::base::unique_fd diskstats_fd_;
+    std::vector<StorageDevice> storage_devices_;
+
+    std::mutex lock_;
+    std::vector<char> buffer_ GUARDED_BY(lock_);
+    int snapshot_count_ GUARDED_BY(lock_) = 0;
+    ::android::base::boot_clock::time_point snapshot_time_ GUARDED_BY(lock_);
+    ::android::base::boot_clock::time_point previous_snapshot_time_ GUARDED_BY(lock_);
+    // Indexed like disks_.
+    std::vector<DiskStats> disk_stats_ GUARDED_BY(lock_);
+    std::vector<DiskStats> previous_disk_stats_ GUARDED_BY(lock_);
+    // Indexed like storage_devices_.
+    std::vector<StorageInfo> storage_infos_ GUARDED_BY(lock_);
+};
+
+}  // namespace aidl::android::hardware::health
@@ -29,6 +29,7 @@
 namespace aidl::android::hardware::health {
 
 class LinkedCallback;
+class StorageHealth;
 
 // AIDL version of android::hardware::health::V2_1::implementation::Health and BinderHealth.
 // There's no need to separate the two in AIDL because AIDL does not support passthrough transport.
@@ -68,7 +69,8 @@ class Health : public BnHealth, public HalHealthLoopCallback {
     ndk::ScopedAStatus getEnergyCounterNwh(int64_t* out) override;
 
     // A subclass may override these for a specific device.
-    // The default implementations return nothing in |out|.
+    // The default implementations read /proc/diskstats and the health attributes of eMMC and UFS
+    // devices in sysfs, and return EX_UNSUPPORTED_OPERATION if there are none.
     ndk::ScopedAStatus getDiskStats(std::vector<DiskStats>* out) override;
     ndk::ScopedAStatus getStorageInfo(std::vector<StorageInfo>* out) override;
 
@@ -108,6 +110,7 @@ class Health : public BnHealth, public HalHealthLoopCallback {
     std::string instance_name_;
     ::android::BatteryMonitor battery_monitor_;
     std::unique_ptr<struct healthd_config> healthd_config_;
+    std::unique_ptr<StorageHealth> storage_health_;
 
     ndk::ScopedAIBinder_DeathRecipient death_recipient_;
     int binder_fd_ = -1;
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StorageHealth.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+using ::android::base::ReadFdToString;
+using ::android::base::TemporaryDir;
+using ::android::base::unique_fd;
+using ::android::base::WriteStringToFile;
+
+namespace aidl::android::hardware::health {
+
+// A /sys and /proc with the block devices and storage health of a device.
+class StorageHealthTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        for (const std::string dir : {"/sys", "/sys/block", "/sys/bus", "/sys/bus/platform",
+                                      "/sys/bus/platform/devices", "/sys/bus/pci",
+                                      "/sys/bus/pci/devices", "/proc"}) {
+            MakeDir(dir);
+        }
+    }
+
+    void MakeDir(const std::string& path) {
+        ASSERT_EQ(0, mkdir((root_ + path).c_str(), 0700)) << path;
+    }
+
+    void WriteFile(const std::string& path, const std::string& content) {
+        ASSERT_TRUE(WriteStringToFile(content, root_ + path)) << path;
+    }
+
+    // Virtual block devices have no device.
+    void AddBlockDevice(const std::string& name, bool has_device = true) {
+        MakeDir("/sys/block/" + name);
+        if (has_device) MakeDir("/sys/block/" + name + "/device");
+    }
+
+    void AddEmmc(const std::string& name, const std::string& rev, const std::string& pre_eol_info,
+                 const std::string& life_time) {
+        AddBlockDevice(name);
+        const std::string card = "/sys/block/" + name + "/device/";
+        WriteFile(card + "rev", rev);
+        WriteFile(card + "pre_eol_info", pre_eol_info);
+        WriteFile(card + "life_time", life_time);
+    }
+
+    void AddUfs(const std::string& bus, const std::string& name, const std::string& version,
+                const std::string& eol_info, const std::string& lifetime_a,
+                const std::string& lifetime_b) {
+        const std::string ufs = "/sys/bus/" + bus + "/devices/" + name;
+        MakeDir(ufs);
+        MakeDir(ufs + "/device_descriptor");
+        MakeDir(ufs + "/health_descriptor");
+        WriteFile(ufs + "/device_descriptor/specification_version", version);
+        WriteFile(ufs + "/health_descriptor/eol_info", eol_info);
+        WriteFile(ufs + "/health_descriptor/life_time_estimation_a", lifetime_a);
+        WriteFile(ufs + "/health_descriptor/life_time_estimation_b", lifetime_b);
+    }
+
+    StorageHealth Create() { return StorageHealth(root_ + "/sys", root_ + "/proc"); }
+
+    std::vector<DiskStats> GetDiskStats(StorageHealth& storage) {
+        std::vector<DiskStats> stats;
+        storage.GetDiskStats(&stats);
+        return stats;
+    }
+
+    std::vector<StorageInfo> GetStorageInfo(StorageHealth& storage) {
+        std::vector<StorageInfo> infos;
+        storage.GetStorageInfo(&infos);
+        return infos;
+    }
+
+    std::string Dump(StorageHealth& storage) {
+        int fds[2];
+        EXPECT_EQ(0, pipe(fds));
+        unique_fd read_fd(fds[0]);
+        unique_fd write_fd(fds[1]);
+        storage.Dump(write_fd.get());
+        write_fd.reset();
+        std::string output;
+        EXPECT_TRUE(ReadFdToString(read_fd.get(), &output));
+        return output;
+    }
+
+    TemporaryDir dir_;
+    const std::string root_ = dir_.path;
+};
+
+TEST_F(StorageHealthTest, FindsHardwareDisksOnly) {
+    AddBlockDevice("loop0", false);
+    AddBlockDevice("dm-0", false);
+    AddBlockDevice("sda");
+    AddBlockDevice("mmcblk0");
+    AddBlockDevice("mmcblk0boot0");
+    AddBlockDevice("mmcblk0rpmb");
+    WriteFile("/proc/diskstats",
+              "   7       0 loop0 1 0 2 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+              " 179       0 mmcblk0 10 0 20 0 0 0 0 0 0 0 0\n"
+              " 179       8 mmcblk0boot0 30 0 40 0 0 0 0 0 0 0 0\n"
+              "   8       0 sda 50 0 60 0 0 0 0 0 0 0 0\n");
+    StorageHealth storage = Create();
+    ASSERT_TRUE(storage.HasDiskStats());
+
+    // Disks are in the order of their names.
+    const auto stats = GetDiskStats(storage);
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ(10, stats[0].reads);
+    EXPECT_EQ(20, stats[0].readSectors);
+    EXPECT_EQ(50, stats[1].reads);
+    EXPECT_EQ(60, stats[1].readSectors);
+}
+
+TEST_F(StorageHealthTest, ParsesEveryDiskStatsColumn) {
+    AddBlockDevice("sda");
+    // Newer kernels append discard and flush columns, which are ignored.
+    WriteFile("/proc/diskstats",
+              "   8       0 sda 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17\n"
+              "   8       1 sda1 101 102 103 104 105 106 107 108 109 110 111\n");
+    StorageHealth storage = Create();
+
+    const auto stats = GetDiskStats(storage);
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(1, stats[0].reads);
+    EXPECT_EQ(2, stats[0].readMerges);
+    EXPECT_EQ(3, stats[0].readSectors);
+    EXPECT_EQ(4, stats[0].readTicks);
+    EXPECT_EQ(5, stats[0].writes);
+    EXPECT_EQ(6, stats[0].writeMerges);
+    EXPECT_EQ(7, stats[0].writeSectors);
+    EXPECT_EQ(8, stats[0].writeTicks);
+    EXPECT_EQ(9, stats[0].ioInFlight);
+    EXPECT_EQ(10, stats[0].ioTicks);
+    EXPECT_EQ(11, stats[0].ioInQueue);
+}
+
+TEST_F(StorageHealthTest, IgnoresMalformedDiskStatsLines) {
+    AddBlockDevice("sda");
+    AddBlockDevice("sdb");
+    AddBlockDevice("sdc");
+    WriteFile("/proc/diskstats",
+              "   8       0 sda 1 2 3\n"
+              "   8      16 sdb 1 2 x 4 5 6 7 8 9 10 11\n"
+              "   8      32 sdc 1 2 3 4 5 6 7 8 9 10 11");
+    StorageHealth storage = Create();
+
+    const auto stats = GetDiskStats(storage);
+    ASSERT_EQ(3u, stats.size());
+    EXPECT_EQ(DiskStats(), stats[0]);
+    EXPECT_EQ(DiskStats(), stats[1]);
+    // The last line needs no newline.
+    EXPECT_EQ(11, stats[2].ioInQueue);
+}
+
+TEST_F(StorageHealthTest, NoDiskStatsWithoutDiskstatsFile) {
+    AddBlockDevice("sda");
+    StorageHealth storage = Create();
+    EXPECT_FALSE(storage.HasDiskStats());
+    EXPECT_TRUE(GetDiskStats(storage).empty());
+}
+
+TEST_F(StorageHealthTest, ReadsEmmcHealth) {
+    AddEmmc("mmcblk0", "0x8\n", "0x01\n", "0x02 0x0b\n");
+    AddEmmc("mmcblk1", "0x42\n", "0x03\n", "0x0A 0x01\n");
+    // SD cards have no health.
+    AddBlockDevice("mmcblk2");
+    StorageHealth storage = Create();
+    ASSERT_TRUE(storage.HasStorageInfo());
+
+    const auto infos = GetStorageInfo(storage);
+    ASSERT_EQ(2u, infos.size());
+    EXPECT_EQ("emmc 5.1", infos[0].version);
+    EXPECT_EQ(1, infos[0].eol);
+    EXPECT_EQ(2, infos[0].lifetimeA);
+    EXPECT_EQ(11, infos[0].lifetimeB);
+    EXPECT_EQ("emmc ?", infos[1].version);
+    EXPECT_EQ(3, infos[1].eol);
+    EXPECT_EQ(10, infos[1].lifetimeA);
+    EXPECT_EQ(1, infos[1].lifetimeB);
+}
+
+TEST_F(StorageHealthTest, ReadsUfsHealth) {
+    AddUfs("platform", "1d84000.ufshc", "0x0310\n", "0x02\n", "0x0A\n", "0x0b\n");
+    AddUfs("pci", "0000:00:12.5", "0x0220\n", "0x01\n", "0x01\n", "0x02\n");
+    // Other devices have no health descriptor.
+    MakeDir("/sys/bus/platform/devices/soc:gpu");
+    StorageHealth storage = Create();
+
+    const auto infos = GetStorageInfo(storage);
+    ASSERT_EQ(2u, infos.size());
+    EXPECT_EQ("ufs 0x0310", infos[0].version);
+    EXPECT_EQ(2, infos[0].eol);
+    EXPECT_EQ(10, infos[0].lifetimeA);
+    EXPECT_EQ(11, infos[0].lifetimeB);
+    EXPECT_EQ("ufs 0x0220", infos[1].version);
+    EXPECT_EQ(1, infos[1].eol);
+}
+
+TEST_F(StorageHealthTest, IgnoresIncompleteLifeTimes) {
+    AddEmmc("mmcblk0", "0x8\n", "0x01\n", "0x02\n");
+    StorageHealth storage = Create();
+
+    const auto infos = GetStorageInfo(storage);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ(1, infos[0].eol);
+    EXPECT_EQ(0, infos[0].lifetimeA);
+    EXPECT_EQ(0, infos[0].lifetimeB);
+}
+
+TEST_F(StorageHealthTest, NoStorageInfoWithoutHealth) {
+    AddBlockDevice("sda");
+    StorageHealth storage = Create();
+    EXPECT_FALSE(storage.HasStorageInfo());
+    EXPECT_TRUE(GetStorageInfo(storage).empty());
+}
+
+TEST_F(StorageHealthTest, SnapshotIsReusedUntilItExpires) {
+    AddBlockDevice("sda");
+    AddEmmc("mmcblk0", "0x8\n", "0x01\n", "0x01 0x01\n");
+    WriteFile("/proc/diskstats",
+              "   8       0 sda 10 0 100 0 20 0 400 0 0 30 0\n"
+              " 179       0 mmcblk0 0 0 0 0 0 0 0 0 0 0 0\n");
+    StorageHealth storage = Create();
+    ASSERT_EQ(10, GetDiskStats(storage)[1].reads);
+    EXPECT_EQ("", Dump(storage));
+
+    WriteFile("/proc/diskstats",
+              "   8       0 sda 15 0 120 0 30 0 600 0 0 45 0\n"
+              " 179       0 mmcblk0 0 0 0 0 0 0 0 0 0 0 0\n");
+    WriteFile("/sys/block/mmcblk0/device/pre_eol_info", "0x02\n");
+    EXPECT_EQ(10, GetDiskStats(storage)[1].reads);
+    EXPECT_EQ(1, GetStorageInfo(storage)[0].eol);
+
+    std::this_thread::sleep_for(StorageHealth::kSnapshotMaxAge);
+    EXPECT_EQ(15, GetDiskStats(storage)[1].reads);
+    EXPECT_EQ(2, GetStorageInfo(storage)[0].eol);
+
+    const std::string dump = Dump(storage);
+    EXPECT_NE(std::string::npos, dump.find("mmcblk0 in the last ")) << dump;
+    EXPECT_NE(std::string::npos,
+              dump.find(" ms: 5 reads (10 KiB), 10 writes (100 KiB), busy 15 ms\n"))
+            << dump;
+}
+
+}  // namespace aidl::android::hardware::health
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DmaBufTracker.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+using ::android::base::ParseInt;
+using ::android::base::ParseUint;
+using ::android::base::ReadFileToString;
+using ::android::base::StartsWith;
+using ::android::base::StringPrintf;
+using ::android::base::Trim;
+using ::android::base::unique_fd;
+
+namespace {
+
+// Prefix of the path of DMA-BUF files, in /proc/<pid>/fd and /proc/<pid>/maps.
+const char kDmaBufPathPrefix[] = "/dmabuf";
+
+// How long the buffers of the processes are reused, for the queries of other processes and types.
+constexpr auto kSnapshotValidity = std::chrono::seconds(1);
+// How often buffers which were freed are dropped from the cache.
+constexpr auto kBuffersPruneInterval = std::chrono::seconds(10);
+
+struct ExporterType {
+    const char* prefix;
+    MemtrackType type;
+};
+
+// Exporters by name prefix, the first match wins. Buffers of DMA-BUF heaps (and ION) are mostly
+// gralloc buffers.
+const ExporterType kExporterTypes[] = {
+        {"cam", MemtrackType::CAMERA},
+        {"isp", MemtrackType::CAMERA},
+        {"codec", MemtrackType::MULTIMEDIA},
+        {"video", MemtrackType::MULTIMEDIA},
+        {"vpu", MemtrackType::MULTIMEDIA},
+        {"mfc", MemtrackType::MULTIMEDIA},
+        {"virtio_gpu", MemtrackType::GL},
+        {"virtio-gpu", MemtrackType::GL},
+        {"mali", MemtrackType::GL},
+        {"kgsl", MemtrackType::GL},
+        {"msm_drm", MemtrackType::GL},
+        {"i915", MemtrackType::GL},
+        {"amdgpu", MemtrackType::GL},
+        {"panfrost", MemtrackType::GL},
+        {"system", MemtrackType::GRAPHICS},
+        {"ion", MemtrackType::GRAPHICS},
+        {"reserved", MemtrackType::GRAPHICS},
+        {"linux,cma", MemtrackType::GRAPHICS},
+};
+
+std::unique_ptr<DIR, decltype(&closedir)> openDir(int dirFd, const char* path) {
+    int fd = openat(dirFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return {nullptr, closedir};
+    DIR* dir = fdopendir(fd);
+    if (dir == nullptr) close(fd);
+    return {dir, closedir};
+}
+
+struct FdInfo {
+    std::string exporter;
+    std::optional<ino_t> inode;
+    std::optional<uint64_t> size;
+};
+
+// Reads the exporter of a DMA-BUF from its fdinfo, along with its inode (since Linux 5.14) and size.
+FdInfo readFdinfo(int fdinfoDirFd, const char* fd) {
+    FdInfo info;
+    unique_fd fdinfo(openat(fdinfoDirFd, fd, O_RDONLY | O_CLOEXEC));
+    std::string content;
+    if (fdinfo < 0 || !::android::base::ReadFdToString(fdinfo, &content)) return info;
+    for (auto& line : ::android::base::Split(content, "\n")) {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        const auto key = line.substr(0, colon);
+        const auto value = Trim(line.substr(colon + 1));
+        uint64_t number;
+        if (key == "exp_name") {
+            info.exporter = value;
+        } else if (key == "ino" && ParseUint(value, &number)) {
+            info.inode = number;
+        } else if (key == "size" && ParseUint(value, &number)) {
+            info.size = number;
+        }
+    }
+    return info;
+}
+
+}  // namespace
+
+MemtrackType DmaBufTracker::typeOfExporter(const std::string& exporter) {
+    for (auto& exporterType : kExporterTypes) {
+        if (StartsWith(exporter, exporterType.prefix)) return exporterType.type;
+    }
+    return MemtrackType::OTHER;
+}
+
+DmaBufTracker::DmaBufTracker(const std::string& procfsRoot, const std::string& dmabufSysfsRoot)
+    : mProcfsRoot(procfsRoot), mDmaBufSysfsRoot(dmabufSysfsRoot) {}
+
+std::vector<MemtrackRecord> DmaBufTracker::getMemory(pid_t pid, MemtrackType type) {
+    std::lock_guard<std::mutex> lock(mLock);
+    const auto now = std::chrono::steady_clock::now();
+    constexpr int kFlags = MemtrackRecord::FLAG_SMAPS_UNACCOUNTED | MemtrackRecord::FLAG_SHARED_PSS;
+
+    if (pid == 0) {
+        pruneBuffers(now);
+        // Only GL has a system wide total, the GPU private memory.
+        const auto size = type == MemtrackType::GL ? getTotalSize(MemtrackType::GL) : 0;
+        return {{.flags = kFlags, .sizeInBytes = static_cast<int64_t>(size)}};
+    }
+
+    if (!mSnapshotTime || now - *mSnapshotTime > kSnapshotValidity) {
+        pruneBuffers(now);
+        takeSnapshot(now);
+    }
+    auto process = mProcesses.find(pid);
+    if (process == mProcesses.end()) {
+        // Started since the snapshot, or not readable.
+        ProcessBuffers buffers;
+        if (!readProcessBuffers(pid, buffers)) return {};
+        addProcess(pid, std::move(buffers));
+        process = mProcesses.find(pid);
+    }
+
+    auto pss = [this](const std::pair<ino_t, Buffer>& buffer) {
+        return buffer.second.size / std::max(mHolders[buffer.first], 1u);
+    };
+    uint64_t size = 0;
+    if (type == MemtrackType::GRAPHICS) {
+        for (auto& buffer : process->second.mapped) size += pss(buffer);
+    }
+    for (auto& buffer : process->second.held) {
+        if (buffer.second.type == type) size += pss(buffer);
+    }
+    return {{.flags = kFlags, .sizeInBytes = static_cast<int64_t>(size)}};
+}
+
+void DmaBufTracker::takeSnapshot(std::chrono::steady_clock::time_point now) {
+    mProcesses.clear();
+    mHolders.clear();
+    mSnapshotTime = now;
+
+    auto dir = openDir(AT_FDCWD, mProcfsRoot.c_str());
+    if (!dir) {
+        PLOG(ERROR) << "Can't read " << mProcfsRoot;
+        return;
+    }
+    while (auto entry = readdir(dir.get())) {
+        pid_t pid;
+        if (!ParseInt(entry->d_name, &pid, 1)) continue;
+        ProcessBuffers buffers;
+        // Processes may exit while being read.
+        if (readProcessBuffers(pid, buffers)) addProcess(pid, std::move(buffers));
+    }
+}
+
+void DmaBufTracker::addProcess(pid_t pid, ProcessBuffers buffers) {
+    for (auto& buffer : buffers.mapped) mHolders[buffer.first]++;
+    for (auto& buffer : buffers.held) mHolders[buffer.first]++;
+    mProcesses.insert_or_assign(pid, std::move(buffers));
+}
+
+bool DmaBufTracker::readProcessBuffers(pid_t pid, ProcessBuffers& buffers) {
+    const auto procPath = StringPrintf("%s/%d", mProcfsRoot.c_str(), pid);
+    unique_fd procFd(open(procPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (procFd < 0) return false;
+
+    // Each buffer counts once, even if both mapped and held by several descriptors.
+    std::unordered_set<ino_t> seen;
+
+    std::string maps;
+    unique_fd mapsFd(openat(procFd, "maps", O_RDONLY | O_CLOEXEC));
+    if (mapsFd < 0 || !::android::base::ReadFdToString(mapsFd, &maps)) {
+        PLOG(DEBUG) << "Can't read " << procPath << "/maps";
+        return false;
+    }
+    for (size_t begin = 0, end; begin < maps.size(); begin = end + 1) {
+        end = maps.find('\n', begin);
+        if (end == std::string::npos) end = maps.size();
+        const std::string_view line(maps.data() + begin, end - begin);
+        if (line.find(kDmaBufPathPrefix) == std::string_view::npos) continue;
+
+        // start-end perms offset dev inode path
+        uint64_t start, last;
+        unsigned long long inode;
+        int pathOffset = 0;
+        if (sscanf(line.data(), "%" SCNx64 "-%" SCNx64 " %*s %*s %*s %llu %n", &start, &last,
+                   &inode, &pathOffset) != 3 ||
+            static_cast<size_t>(pathOffset) > line.size() ||
+            !line.substr(pathOffset).starts_with(kDmaBufPathPrefix)) {
+            continue;
+        }
+        if (!seen.insert(inode).second) continue;
+
+        const auto buffer = findBuffer(inode);
+        // Without the buffer stats, only the mapped part of the buffer is known.
+        buffers.mapped.emplace_back(
+                inode, buffer ? *buffer : Buffer{.size = last - start, .type = MemtrackType::OTHER});
+    }
+
+    unique_fd fdDirFd(openat(procFd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    unique_fd fdinfoDirFd(openat(procFd, "fdinfo", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    auto fdDir = openDir(procFd, "fd");
+    if (fdDirFd < 0 || fdinfoDirFd < 0 || !fdDir) {
+        PLOG(DEBUG) << "Can't read " << procPath << "/fd";
+        return false;
+    }
+    std::array<char, sizeof(kDmaBufPathPrefix)> link;
+    while (auto entry = readdir(fdDir.get())) {
+        if (entry->d_name[0] == '.') continue;
+        // Most descriptors are not DMA-BUFs, which readlink(2) tells without opening fdinfo.
+        const auto linkSize = readlinkat(fdDirFd, entry->d_name, link.data(), link.size());
+        if (linkSize < static_cast<ssize_t>(strlen(kDmaBufPathPrefix)) ||
+            strncmp(link.data(), kDmaBufPathPrefix, strlen(kDmaBufPathPrefix)) != 0) {
+            continue;
+        }
+
+        // The size of a DMA-BUF is the size of its inode. If the descriptor can't be stat'ed, as
+        // in a recorded /proc, fdinfo gives both.
+        std::optional<FdInfo> fdinfo;
+        struct stat st;
+        if (fstatat(fdDirFd, entry->d_name, &st, 0) != 0) {
+            fdinfo = readFdinfo(fdinfoDirFd, entry->d_name);
+            if (!fdinfo->inode || !fdinfo->size) continue;
+            st.st_ino = *fdinfo->inode;
+            st.st_size = *fdinfo->size;
+        }
+        if (!seen.insert(st.st_ino).second) continue;
+
+        auto buffer = findBuffer(st.st_ino);
+        if (buffer == nullptr) {
+            if (!fdinfo) fdinfo = readFdinfo(fdinfoDirFd, entry->d_name);
+            buffer = addBuffer(st.st_ino, st.st_size, fdinfo->exporter);
+        }
+        buffers.held.emplace_back(st.st_ino, *buffer);
+    }
+
+    return true;
+}
+
+uint64_t DmaBufTracker::getTotalSize(MemtrackType type) {
+    auto dir = openDir(AT_FDCWD, mDmaBufSysfsRoot.c_str());
+    if (!dir) return 0;
+    uint64_t size = 0;
+    while (auto entry = readdir(dir.get())) {
+        unsigned long long inode;
+        if (!ParseUint(entry->d_name, &inode)) continue;
+        const auto buffer = findBuffer(inode);
+        if (buffer != nullptr && buffer->type == type) size += buffer->size;
+    }
+    return size;
+}
+
+const DmaBufTracker::Buffer* DmaBufTracker::findBuffer(ino_t inode) {
+    auto buffer = mBuffers.find(inode);
+    if (buffer != mBuffers.end()) return &buffer->second;
+
+    const auto path = StringPrintf("%s/%llu/", mDmaBufSysfsRoot.c_str(),
+                                   static_cast<unsigned long long>(inode));
+    std::string size;
+    std::string exporter;
+    uint64_t sizeValue;
+    if (!ReadFileToString(path + "size", &size) ||
+        !ParseUint(Trim(size), &sizeValue) ||
+        !ReadFileToString(path + "exporter_name", &exporter)) {
+        return nullptr;
+    }
+    return addBuffer(inode, sizeValue, Trim(exporter));
+}
+
+const DmaBufTracker::Buffer* DmaBufTracker::addBuffer(ino_t inode, uint64_t size,
+                                                      const std::string& exporter) {
+    Buffer buffer = {.size = size, .type = typeOfExporter(exporter)};
+    return &mBuffers.insert_or_assign(inode, buffer).first->second;
+}
+
+void DmaBufTracker::pruneBuffers(std::chrono::steady_clock::time_point now) {
+    if (now - mLastBuffersPrune < kBuffersPruneInterval) return;
+    mLastBuffersPrune = now;
+
+    auto dir = openDir(AT_FDCWD, mDmaBufSysfsRoot.c_str());
+    if (!dir) {
+        // Without the buffer stats, inodes can't be told apart from reused ones. Start over.
+        mBuffers.clear();
+        return;
+    }
+    std::unordered_set<ino_t> live;
+    while (auto entry = readdir(dir.get())) {
+        unsigned long long inode;
+        if (ParseUint(entry->d_name, &inode)) live.insert(inode);
+    }
+    std::erase_if(mBuffers, [&live](const auto& buffer) { return !live.contains(buffer.first); });
+}
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
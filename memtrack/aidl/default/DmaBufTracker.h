@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/memtrack/MemtrackRecord.h>
+#include <aidl/android/hardware/memtrack/MemtrackType.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+/**
+ * Attributes DMA-BUF memory to processes, by memory type.
+ *
+ * A process uses a buffer if it holds a file descriptor to it (/proc/<pid>/fdinfo) or has it
+ * mapped (/proc/<pid>/maps). Buffers are identified by their inode, and their size and exporter
+ * (which gives the memory type) are kept in a cache shared by all processes, filled from the file
+ * descriptors and /sys/kernel/dmabuf/buffers as new buffers are seen.
+ *
+ * Each process is charged the PSS of its buffers: their size divided by the number of processes
+ * using them. Counting those takes the buffers of every process, so they are read for all the
+ * processes at once and kept for a short while, which also serves the queries for the other
+ * processes and memory types that dumpsys meminfo makes in a row.
+ *
+ * As IMemtrack describes, buffers mapped by a process are reported as GRAPHICS, and the ones it
+ * only holds a descriptor to by the type of their exporter, e.g. GL for GPU private buffers.
+ */
+class DmaBufTracker {
+  public:
+    /** |procfsRoot| and |dmabufSysfsRoot| are overridden by tests. */
+    explicit DmaBufTracker(const std::string& procfsRoot = "/proc",
+                           const std::string& dmabufSysfsRoot = "/sys/kernel/dmabuf/buffers");
+
+    /**
+     * Get the DMA-BUF memory of a process.
+     *
+     * \param pid Process to query, or 0 for the GPU private memory of the whole system
+     * \param type Memory type to report
+     * \return Record of the PSS of the buffers, none of which is accounted in smaps; empty if the
+     *         process can't be read
+     */
+    std::vector<MemtrackRecord> getMemory(pid_t pid, MemtrackType type);
+
+    /** Memory type of the buffers of an exporter. */
+    static MemtrackType typeOfExporter(const std::string& exporter);
+
+  private:
+    struct Buffer {
+        uint64_t size;
+        MemtrackType type;
+    };
+
+    struct ProcessBuffers {
+        // Each buffer is in one of the lists, as mapped if the process both maps it and holds it.
+        std::vector<std::pair<ino_t, Buffer>> mapped;
+        std::vector<std::pair<ino_t, Buffer>> held;
+    };
+
+    void takeSnapshot(std::chrono::steady_clock::time_point now);
+    void addProcess(pid_t pid, ProcessBuffers buffers);
+    bool readProcessBuffers(pid_t pid, ProcessBuffers& buffers);
+    uint64_t getTotalSize(MemtrackType type);
+    const Buffer* findBuffer(ino_t inode);
+    const Buffer* addBuffer(ino_t inode, uint64_t size, const std::string& exporter);
+    void pruneBuffers(std::chrono::steady_clock::time_point now);
+
+    const std::string mProcfsRoot;
+    const std::string mDmaBufSysfsRoot;
+
+    std::mutex mLock;
+    std::unordered_map<ino_t, Buffer> mBuffers;
+    std::chrono::steady_clock::time_point mLastBuffersPrune;
+    // Buffers of every process, and by how many processes each buffer is used.
+    std::unordered_map<pid_t, ProcessBuffers> mProcesses;
+    std::unordered_map<ino_t, uint32_t> mHolders;
+    std::optional<std::chrono::steady_clock::time_point> mSnapshotTime;
+};
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -30,7 +30,7 @@ ndk::ScopedAStatus Memtrack::getMemory(int pid, MemtrackType type,
         type != MemtrackType::MULTIMEDIA && type != MemtrackType::CAMERA) {
         return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_UNSUPPORTED_OPERATION));
     }
-    _aidl_return->clear();
+    *_aidl_return = mDmaBufTracker.getMemory(pid, type);
     return ndk::ScopedAStatus::ok();
 }
 
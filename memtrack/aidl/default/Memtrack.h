@@ -21,6 +21,8 @@
 #include <aidl/android/hardware/memtrack/MemtrackRecord.h>
 #include <aidl/android/hardware/memtrack/MemtrackType.h>
 
+#include "DmaBufTracker.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -31,6 +33,9 @@ class Memtrack : public BnMemtrack {
                                  std::vector<MemtrackRecord>* _aidl_return) override;
 
     ndk::ScopedAStatus getGpuDeviceInfo(std::vector<DeviceInfo>* _aidl_return) override;
+
+  private:
+    DmaBufTracker mDmaBufTracker;
 };
 
 }  // namespace memtrack
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DmaBufTracker.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace memtrack {
+
+using ::android::base::StringPrintf;
+using ::android::base::TemporaryDir;
+using ::android::base::WriteStringToFile;
+
+constexpr int kFlags = MemtrackRecord::FLAG_SMAPS_UNACCOUNTED | MemtrackRecord::FLAG_SHARED_PSS;
+
+TEST(DmaBufTrackerTypeTest, TypeOfExporter) {
+    EXPECT_EQ(MemtrackType::GRAPHICS, DmaBufTracker::typeOfExporter("system"));
+    EXPECT_EQ(MemtrackType::GRAPHICS, DmaBufTracker::typeOfExporter("system-uncached"));
+    EXPECT_EQ(MemtrackType::GRAPHICS, DmaBufTracker::typeOfExporter("linux,cma"));
+    EXPECT_EQ(MemtrackType::GL, DmaBufTracker::typeOfExporter("mali"));
+    EXPECT_EQ(MemtrackType::GL, DmaBufTracker::typeOfExporter("virtio_gpu"));
+    EXPECT_EQ(MemtrackType::MULTIMEDIA, DmaBufTracker::typeOfExporter("video-decoder"));
+    EXPECT_EQ(MemtrackType::CAMERA, DmaBufTracker::typeOfExporter("camera"));
+    EXPECT_EQ(MemtrackType::OTHER, DmaBufTracker::typeOfExporter("unknown"));
+    EXPECT_EQ(MemtrackType::OTHER, DmaBufTracker::typeOfExporter(""));
+}
+
+/* A /proc and /sys/kernel/dmabuf/buffers with the DMA-BUFs of a few processes. */
+class DmaBufTrackerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mProcfsRoot = std::string(mRoot.path) + "/proc";
+        mSysfsRoot = std::string(mRoot.path) + "/buffers";
+        ASSERT_EQ(0, mkdir(mProcfsRoot.c_str(), 0700));
+        ASSERT_EQ(0, mkdir(mSysfsRoot.c_str(), 0700));
+    }
+
+    void addBuffer(ino_t inode, uint64_t size, const std::string& exporter) {
+        const auto path = StringPrintf("%s/%llu", mSysfsRoot.c_str(),
+                                       static_cast<unsigned long long>(inode));
+        ASSERT_EQ(0, mkdir(path.c_str(), 0700));
+        ASSERT_TRUE(WriteStringToFile(StringPrintf("%" PRIu64 "\n", size), path + "/size"));
+        ASSERT_TRUE(WriteStringToFile(exporter + "\n", path + "/exporter_name"));
+    }
+
+    void addProcess(pid_t pid, const std::string& maps = "") {
+        const auto path = StringPrintf("%s/%d", mProcfsRoot.c_str(), pid);
+        ASSERT_EQ(0, mkdir(path.c_str(), 0700));
+        ASSERT_EQ(0, mkdir((path + "/fd").c_str(), 0700));
+        ASSERT_EQ(0, mkdir((path + "/fdinfo").c_str(), 0700));
+        ASSERT_TRUE(WriteStringToFile(
+                "5c5e0000-5c5e2000 r--p 00000000 fe:00 1234  /system/bin/app_process64\n" + maps,
+                path + "/maps"));
+    }
+
+    /* A mapping of |size| bytes of a DMA-BUF. */
+    static std::string dmaBufMapping(ino_t inode, uint64_t size) {
+        return StringPrintf("7f000000-%" PRIx64 " rw-s 00000000 00:0a %llu  /dmabuf:\n",
+                            0x7f000000 + size, static_cast<unsigned long long>(inode));
+    }
+
+    /* A descriptor to a DMA-BUF. It can't be stat'ed, so its fdinfo tells the inode and size. */
+    void addDescriptor(pid_t pid, int fd, ino_t inode, uint64_t size, const std::string& exporter) {
+        const auto path = StringPrintf("%s/%d", mProcfsRoot.c_str(), pid);
+        ASSERT_EQ(0, symlink("/dmabuf:", StringPrintf("%s/fd/%d", path.c_str(), fd).c_str()));
+        ASSERT_TRUE(WriteStringToFile(
+                StringPrintf("pos:\t0\nflags:\t02000002\nmnt_id:\t9\nino:\t%llu\nsize:\t%" PRIu64
+                             "\ncount:\t1\nexp_name:\t%s\nname:\t\n",
+                             static_cast<unsigned long long>(inode), size, exporter.c_str()),
+                StringPrintf("%s/fdinfo/%d", path.c_str(), fd)));
+    }
+
+    void addOtherDescriptor(pid_t pid, int fd) {
+        const auto path = StringPrintf("%s/%d/fd/%d", mProcfsRoot.c_str(), pid, fd);
+        ASSERT_EQ(0, symlink("/dev/null", path.c_str()));
+    }
+
+    int64_t getSize(DmaBufTracker& tracker, pid_t pid, MemtrackType type) {
+        const auto records = tracker.getMemory(pid, type);
+        EXPECT_EQ(1u, records.size());
+        if (records.size() != 1) return -1;
+        EXPECT_EQ(kFlags, records[0].flags);
+        return records[0].sizeInBytes;
+    }
+
+    TemporaryDir mRoot;
+    std::string mProcfsRoot;
+    std::string mSysfsRoot;
+};
+
+TEST_F(DmaBufTrackerTest, MappedBuffersAreGraphics) {
+    addBuffer(10, 8192, "mali");
+    addProcess(100, dmaBufMapping(10, 4096));
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    // The whole buffer counts, not only its mapped part.
+    EXPECT_EQ(8192, getSize(tracker, 100, MemtrackType::GRAPHICS));
+    EXPECT_EQ(0, getSize(tracker, 100, MemtrackType::GL));
+    EXPECT_EQ(0, getSize(tracker, 100, MemtrackType::OTHER));
+}
+
+TEST_F(DmaBufTrackerTest, MappingWithoutStatsCountsTheMappedPart) {
+    addProcess(100, dmaBufMapping(10, 4096));
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    EXPECT_EQ(4096, getSize(tracker, 100, MemtrackType::GRAPHICS));
+}
+
+TEST_F(DmaBufTrackerTest, HeldBuffersAreTypedByExporter) {
+    addProcess(100);
+    addDescriptor(100, 3, 10, 4096, "mali");
+    addDescriptor(100, 4, 11, 8192, "system");
+    addDescriptor(100, 5, 12, 16384, "camera");
+    addOtherDescriptor(100, 6);
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    EXPECT_EQ(4096, getSize(tracker, 100, MemtrackType::GL));
+    EXPECT_EQ(8192, getSize(tracker, 100, MemtrackType::GRAPHICS));
+    EXPECT_EQ(16384, getSize(tracker, 100, MemtrackType::CAMERA));
+    EXPECT_EQ(0, getSize(tracker, 100, MemtrackType::MULTIMEDIA));
+}
+
+TEST_F(DmaBufTrackerTest, BufferMappedAndHeldCountsOnce) {
+    addBuffer(10, 4096, "mali");
+    addProcess(100, dmaBufMapping(10, 4096) + dmaBufMapping(10, 4096));
+    addDescriptor(100, 3, 10, 4096, "mali");
+    addDescriptor(100, 4, 10, 4096, "mali");
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    EXPECT_EQ(4096, getSize(tracker, 100, MemtrackType::GRAPHICS));
+    EXPECT_EQ(0, getSize(tracker, 100, MemtrackType::GL));
+}
+
+TEST_F(DmaBufTrackerTest, SharedBuffersAreSplitBetweenHolders) {
+    addBuffer(10, 12288, "system");
+    addProcess(100, dmaBufMapping(10, 12288));
+    addProcess(200);
+    addDescriptor(200, 3, 10, 12288, "system");
+    addProcess(300);
+    addDescriptor(300, 3, 10, 12288, "system");
+    addDescriptor(300, 4, 11, 4096, "mali");
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    EXPECT_EQ(4096, getSize(tracker, 100, MemtrackType::GRAPHICS));
+    EXPECT_EQ(4096, getSize(tracker, 200, MemtrackType::GRAPHICS));
+    EXPECT_EQ(4096, getSize(tracker, 300, MemtrackType::GRAPHICS));
+    EXPECT_EQ(4096, getSize(tracker, 300, MemtrackType::GL));
+}
+
+TEST_F(DmaBufTrackerTest, ProcessStartedAfterSnapshot) {
+    addBuffer(10, 8192, "system");
+    addProcess(100, dmaBufMapping(10, 8192));
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+    EXPECT_EQ(8192, getSize(tracker, 100, MemtrackType::GRAPHICS));
+
+    addProcess(200, dmaBufMapping(10, 8192));
+    EXPECT_EQ(4096, getSize(tracker, 200, MemtrackType::GRAPHICS));
+}
+
+TEST_F(DmaBufTrackerTest, UnknownProcessHasNoRecords) {
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+    EXPECT_TRUE(tracker.getMemory(100, MemtrackType::GRAPHICS).empty());
+}
+
+TEST_F(DmaBufTrackerTest, PidZeroReportsTotalGpuMemory) {
+    addBuffer(10, 4096, "mali");
+    addBuffer(11, 8192, "mali");
+    addBuffer(12, 16384, "system");
+    DmaBufTracker tracker(mProcfsRoot, mSysfsRoot);
+
+    EXPECT_EQ(4096 + 8192, getSize(tracker, 0, MemtrackType::GL));
+    EXPECT_EQ(0, getSize(tracker, 0, MemtrackType::GRAPHICS));
+    EXPECT_EQ(0, getSize(tracker, 0, MemtrackType::OTHER));
+}
+
+}  // namespace memtrack
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
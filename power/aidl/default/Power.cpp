@@ -57,14 +57,15 @@ ScopedAStatus Power::isBoostSupported(Boost type, bool* _aidl_return) {
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus Power::createHintSession(int32_t, int32_t, const std::vector<int32_t>& tids, int64_t,
+ScopedAStatus Power::createHintSession(int32_t, int32_t, const std::vector<int32_t>& tids,
+                                       int64_t durationNanos,
                                        std::shared_ptr<IPowerHintSession>* _aidl_return) {
     if (tids.size() == 0) {
         *_aidl_return = nullptr;
         return ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
     std::shared_ptr<IPowerHintSession> powerHintSession =
-            ndk::SharedRefBase::make<PowerHintSession>();
+            ndk::SharedRefBase::make<PowerHintSession>(tids, durationNanos);
     mPowerHintSessions.push_back(powerHintSession);
     *_aidl_return = powerHintSession;
     return ScopedAStatus::ok();
@@ -16,38 +16,123 @@
 
 #include "PowerHintSession.h"
 
+#include <linux/sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
 #include <android-base/logging.h>
 
 namespace aidl::android::hardware::power::impl::example {
 
 using ndk::ScopedAStatus;
 
-PowerHintSession::PowerHintSession() {}
+namespace {
+
+// Resets a clamp of a thread, which then follows the system default and its cgroup again.
+constexpr int kUclampReset = -1;
+
+bool setUclamp(int32_t tid, int min, int max) {
+    // There is no sched_setattr() wrapper in bionic.
+    struct {
+        uint32_t size;
+        uint32_t sched_policy;
+        uint64_t sched_flags;
+        int32_t sched_nice;
+        uint32_t sched_priority;
+        uint64_t sched_runtime;
+        uint64_t sched_deadline;
+        uint64_t sched_period;
+        uint32_t sched_util_min;
+        uint32_t sched_util_max;
+    } attr{
+            .size = sizeof(attr),
+            .sched_flags = SCHED_FLAG_KEEP_ALL | SCHED_FLAG_UTIL_CLAMP_MIN |
+                           SCHED_FLAG_UTIL_CLAMP_MAX,
+            .sched_util_min = static_cast<uint32_t>(min),
+            .sched_util_max = static_cast<uint32_t>(max),
+    };
+    return syscall(__NR_sched_setattr, tid, &attr, 0 /* flags */) == 0;
+}
+
+}  // namespace
+
+PowerHintSession::PowerHintSession(const std::vector<int32_t>& threadIds,
+                                   int64_t targetDurationNanos)
+    : mThreadIds(threadIds), mController(targetDurationNanos) {
+    std::lock_guard<std::mutex> lock(mLock);
+    updateUclampLocked();
+}
+
+PowerHintSession::~PowerHintSession() {
+    close();
+}
 
 ScopedAStatus PowerHintSession::updateTargetWorkDuration(int64_t targetDurationNanos) {
     LOG(VERBOSE) << __func__ << "target duration in nanoseconds: " << targetDurationNanos;
+    std::lock_guard<std::mutex> lock(mLock);
+    mController.setTargetDuration(targetDurationNanos);
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus PowerHintSession::reportActualWorkDuration(
-        const std::vector<WorkDuration>& /* durations */) {
+        const std::vector<WorkDuration>& durations) {
     LOG(VERBOSE) << __func__;
+    std::lock_guard<std::mutex> lock(mLock);
+    for (const auto& duration : durations) {
+        mController.addActualDuration(duration.durationNanos);
+    }
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus PowerHintSession::pause() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mPaused = true;
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus PowerHintSession::resume() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mPaused = false;
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus PowerHintSession::close() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mClosed = true;
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus PowerHintSession::sendHint(SessionHint /* hint */) {
+ScopedAStatus PowerHintSession::sendHint(SessionHint hint) {
+    LOG(VERBOSE) << __func__ << " " << toString(hint);
+    std::lock_guard<std::mutex> lock(mLock);
+    switch (hint) {
+        case SessionHint::CPU_LOAD_UP:
+            mController.loadUp();
+            break;
+        case SessionHint::CPU_LOAD_DOWN:
+            mController.loadDown();
+            break;
+        case SessionHint::CPU_LOAD_RESET:
+            mController.loadReset();
+            break;
+        case SessionHint::CPU_LOAD_RESUME:
+            mController.loadResume();
+            break;
+        case SessionHint::POWER_EFFICIENCY:
+            mController.setPowerEfficiency(true);
+            break;
+        default:
+            // The GPU is not controlled.
+            return ScopedAStatus::ok();
+    }
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
@@ -56,11 +141,53 @@ ScopedAStatus PowerHintSession::setThreads(const std::vector<int32_t>& threadIds
         LOG(ERROR) << "Error: threadIds.size() shouldn't be " << threadIds.size();
         return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
     }
+    std::lock_guard<std::mutex> lock(mLock);
+    for (int32_t tid : mThreadIds) {
+        if (std::find(threadIds.begin(), threadIds.end(), tid) == threadIds.end()) {
+            setUclampLocked(tid, kUclampReset, kUclampReset);
+        }
+    }
+    mThreadIds = threadIds;
+    mUclampApplied = false;
+    updateUclampLocked();
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus PowerHintSession::setMode(SessionMode /* mode */, bool /* enabled */) {
+ScopedAStatus PowerHintSession::setMode(SessionMode mode, bool enabled) {
+    LOG(VERBOSE) << __func__ << " " << toString(mode) << " to: " << enabled;
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mode == SessionMode::POWER_EFFICIENCY) {
+        mController.setPowerEfficiency(enabled);
+        updateUclampLocked();
+    }
     return ScopedAStatus::ok();
 }
 
+void PowerHintSession::updateUclampLocked() {
+    int min = kUclampReset;
+    int max = kUclampReset;
+    if (!mPaused && !mClosed) {
+        min = mController.uclampMin();
+        max = mController.uclampMax();
+    }
+    if (mUclampApplied && min == mUclampMin && max == mUclampMax) {
+        return;
+    }
+    for (int32_t tid : mThreadIds) {
+        setUclampLocked(tid, min, max);
+    }
+    mUclampMin = min;
+    mUclampMax = max;
+    mUclampApplied = true;
+}
+
+void PowerHintSession::setUclampLocked(int32_t tid, int min, int max) {
+    // Threads may exit before the session is updated.
+    if (!setUclamp(tid, min, max) && errno != ESRCH && !mUclampErrorLogged) {
+        PLOG(ERROR) << "Failed to set uclamp of tid " << tid << " to [" << min << ", " << max
+                    << "]";
+        mUclampErrorLogged = true;
+    }
+}
+
 }  // namespace aidl::android::hardware::power::impl::example
@@ -16,16 +16,25 @@
 
 #pragma once
 
+#include <mutex>
+#include <vector>
+
 #include <aidl/android/hardware/power/BnPowerHintSession.h>
 #include <aidl/android/hardware/power/SessionHint.h>
 #include <aidl/android/hardware/power/SessionMode.h>
 #include <aidl/android/hardware/power/WorkDuration.h>
+#include <android-base/thread_annotations.h>
+
+#include "UclampController.h"
 
 namespace aidl::android::hardware::power::impl::example {
 
+// Boosts the threads of the session through their uclamp values, so that the reported work
+// durations meet the target.
 class PowerHintSession : public BnPowerHintSession {
   public:
-    explicit PowerHintSession();
+    PowerHintSession(const std::vector<int32_t>& threadIds, int64_t targetDurationNanos);
+    ~PowerHintSession();
     ndk::ScopedAStatus updateTargetWorkDuration(int64_t targetDurationNanos) override;
     ndk::ScopedAStatus reportActualWorkDuration(
             const std::vector<WorkDuration>& durations) override;
@@ -35,6 +44,23 @@ class PowerHintSession : public BnPowerHintSession {
     ndk::ScopedAStatus sendHint(SessionHint hint) override;
     ndk::ScopedAStatus setThreads(const std::vector<int32_t>& threadIds) override;
     ndk::ScopedAStatus setMode(SessionMode mode, bool enabled) override;
+
+  private:
+    // Applies the uclamp values of the controller to the threads, or resets them if the session is
+    // inactive, when they differ from the values last applied.
+    void updateUclampLocked() REQUIRES(mLock);
+    void setUclampLocked(int32_t tid, int min, int max) REQUIRES(mLock);
+
+    std::mutex mLock;
+    std::vector<int32_t> mThreadIds GUARDED_BY(mLock);
+    UclampController mController GUARDED_BY(mLock);
+    bool mPaused GUARDED_BY(mLock) = false;
+    bool mClosed GUARDED_BY(mLock) = false;
+    // The values last applied to mThreadIds, if mUclampApplied.
+    int mUclampMin GUARDED_BY(mLock) = 0;
+    int mUclampMax GUARDED_BY(mLock) = 0;
+    bool mUclampApplied GUARDED_BY(mLock) = false;
+    bool mUclampErrorLogged GUARDED_BY(mLock) = false;
 };
 
 }  // namespace aidl::android::hardware::power::impl::example
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UclampController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidl::android::hardware::power::impl::example {
+
+namespace {
+
+// The controller aims below the target so that the noise of the work does not miss it.
+constexpr double kSetpoint = 0.8;
+// Errors are relative to the target; outliers such as a stalled cycle are limited.
+constexpr double kMinError = -1.0;
+constexpr double kMaxError = 2.0;
+constexpr double kEwmaAlpha = 0.5;
+
+// Gains, in units of kUclampMax per unit of error. Late cycles are corrected faster than early
+// ones are relaxed.
+constexpr double kProportionalGainLate = 1.0;
+constexpr double kProportionalGainEarly = 0.1;
+constexpr double kIntegralGain = 0.5;
+constexpr double kDerivativeGain = 0.3;
+
+constexpr int kLoadChangeStep = UclampController::kUclampMax / 4;
+constexpr int kLoadResetUclampMin = UclampController::kUclampMax / 2;
+constexpr int kPowerEfficiencyUclampMin = UclampController::kUclampMax / 2;
+constexpr int kPowerEfficiencyUclampMax = UclampController::kUclampMax * 3 / 4;
+
+}  // namespace
+
+UclampController::UclampController(int64_t targetDurationNanos)
+    : mTargetDurationNanos(targetDurationNanos) {}
+
+void UclampController::setTargetDuration(int64_t targetDurationNanos) {
+    mTargetDurationNanos = targetDurationNanos;
+}
+
+void UclampController::addActualDuration(int64_t actualDurationNanos) {
+    if (mTargetDurationNanos <= 0 || actualDurationNanos <= 0) {
+        return;
+    }
+    const double ratio = static_cast<double>(actualDurationNanos) / mTargetDurationNanos;
+    const double error = std::clamp(ratio - kSetpoint, kMinError, kMaxError);
+    State& s = mState;
+    const double ewma = s.hasError ? s.ewmaError + kEwmaAlpha * (error - s.ewmaError) : error;
+    s.derivative = s.hasError ? ewma - s.ewmaError : 0;
+    s.ewmaError = ewma;
+    s.hasError = true;
+
+    // Only integrate towards the limits while the output has not reached them.
+    const double out = output();
+    if ((error > 0 && out < uclampMinLimit()) || (error < 0 && out > 0)) {
+        s.integral += error;
+    }
+    s.integral = std::clamp(s.integral, 0.0, 1.0 / kIntegralGain);
+}
+
+void UclampController::loadUp() {
+    shiftOutput(kLoadChangeStep);
+}
+
+void UclampController::loadDown() {
+    shiftOutput(-kLoadChangeStep);
+}
+
+void UclampController::loadReset() {
+    mStateBeforeReset = mState;
+    const int boost = std::max(uclampMin(), kLoadResetUclampMin);
+    mState = State();
+    shiftOutput(boost);
+}
+
+void UclampController::loadResume() {
+    if (mStateBeforeReset) {
+        mState = *mStateBeforeReset;
+        mStateBeforeReset.reset();
+    }
+}
+
+void UclampController::setPowerEfficiency(bool enabled) {
+    mPowerEfficiency = enabled;
+}
+
+void UclampController::shiftOutput(int delta) {
+    mState.integral = std::clamp(mState.integral + delta / (kIntegralGain * kUclampMax), 0.0,
+                                 1.0 / kIntegralGain);
+}
+
+double UclampController::output() const {
+    const double gain = mState.ewmaError > 0 ? kProportionalGainLate : kProportionalGainEarly;
+    return (gain * mState.ewmaError + kIntegralGain * mState.integral +
+            kDerivativeGain * mState.derivative) *
+           kUclampMax;
+}
+
+int UclampController::uclampMin() const {
+    if (mTargetDurationNanos <= 0) {
+        return 0;
+    }
+    return std::clamp(static_cast<int>(std::lround(output())), 0, uclampMinLimit());
+}
+
+int UclampController::uclampMinLimit() const {
+    return mPowerEfficiency ? kPowerEfficiencyUclampMin : kUclampMax;
+}
+
+int UclampController::uclampMax() const {
+    return mPowerEfficiency ? kPowerEfficiencyUclampMax : kUclampMax;
+}
+
+}  // namespace aidl::android::hardware::power::impl::example
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace aidl::android::hardware::power::impl::example {
+
+// Computes the uclamp values of the threads of a hint session from the work durations it reports.
+//
+// A PID controller drives the normalized error between the actual duration and a setpoint
+// below the target duration to zero. The proportional and derivative terms act on an EWMA of the
+// error, the integral term on the raw error. The output is the uclamp.min of the threads, in the
+// [0, kUclampMax] capacity scale of the kernel.
+class UclampController {
+  public:
+    static constexpr int kUclampMax = 1024;
+
+    explicit UclampController(int64_t targetDurationNanos);
+
+    // A target of 0 or less disables the controller, which then leaves the threads unclamped.
+    void setTargetDuration(int64_t targetDurationNanos);
+    void addActualDuration(int64_t actualDurationNanos);
+
+    // SessionHint::CPU_LOAD_UP and CPU_LOAD_DOWN: the next cycles have more or less work.
+    void loadUp();
+    void loadDown();
+    // SessionHint::CPU_LOAD_RESET: the next cycles have unknown work, so the history is dropped
+    // and the threads are boosted. CPU_LOAD_RESUME goes back to the state before the last reset.
+    void loadReset();
+    void loadResume();
+    // Caps the uclamp values in favour of power over meeting the target.
+    void setPowerEfficiency(bool enabled);
+
+    int uclampMin() const;
+    int uclampMax() const;
+
+  private:
+    struct State {
+        double integral = 0;
+        double ewmaError = 0;
+        double derivative = 0;
+        bool hasError = false;
+    };
+
+    // Moves the output by |delta| through the integral term, so that it persists.
+    void shiftOutput(int delta);
+    double output() const;
+    int uclampMinLimit() const;
+
+    int64_t mTargetDurationNanos;
+    bool mPowerEfficiency = false;
+    State mState;
+    std::optional<State> mStateBeforeReset;
+};
+
+}  // namespace aidl::android::hardware::power::impl::example
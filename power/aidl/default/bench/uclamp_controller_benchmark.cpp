@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the uclamp controller of the example Power HAL against a simulated 60 fps frame workload.
+//
+// The simulated CPU runs at the capacity a schedutil-like governor picks from the utilization of
+// the previous frames, raised to the uclamp.min and capped at the uclamp.max of the controller.
+// Each benchmark reports the share of frames missing their deadline and an energy proxy: dynamic
+// power grows with the cube of the capacity, so the energy of a frame is capacity^2 * work,
+// relative to running all the work at full capacity.
+
+#include <algorithm>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "../UclampController.h"
+
+using aidl::android::hardware::power::impl::example::UclampController;
+
+namespace {
+
+constexpr int64_t kFramePeriodNanos = 16'666'667;
+constexpr int kFrames = 6000;
+
+// Work of a frame at full capacity. The load alternates between light and heavy scenes.
+constexpr double kLightWorkNanos = 5'000'000;
+constexpr double kHeavyWorkNanos = 12'000'000;
+constexpr double kWorkNoise = 0.1;
+constexpr int kLightSceneFrames = 480;
+constexpr int kHeavySceneFrames = 120;
+
+// Governor model: utilization is averaged over frames, and the capacity keeps some headroom.
+constexpr double kUtilizationDecay = 0.8;
+constexpr double kGovernorHeadroom = 1.25;
+constexpr double kMinCapacity = 0.1;
+
+enum class Policy {
+    // Only the governor picks the capacity.
+    kGovernor,
+    kController,
+    // The controller also gets CPU_LOAD_UP and CPU_LOAD_DOWN hints at scene changes.
+    kControllerWithHints,
+    // The threads are boosted to full capacity.
+    kMaxBoost,
+};
+
+struct Result {
+    int missedFrames = 0;
+    double energy = 0;
+    double work = 0;
+    double uclampMin = 0;
+};
+
+Result runFrames(Policy policy) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(1.0, kWorkNoise);
+    UclampController controller(kFramePeriodNanos);
+    double utilization = 0;
+    bool heavy = false;
+    Result result;
+    for (int frame = 0; frame < kFrames; frame++) {
+        const int sceneFrame = frame % (kLightSceneFrames + kHeavySceneFrames);
+        const bool heavyScene = sceneFrame >= kLightSceneFrames;
+        if (heavyScene != heavy && policy == Policy::kControllerWithHints) {
+            heavyScene ? controller.loadUp() : controller.loadDown();
+        }
+        heavy = heavyScene;
+
+        int uclampMin = 0;
+        int uclampMax = UclampController::kUclampMax;
+        if (policy == Policy::kMaxBoost) {
+            uclampMin = UclampController::kUclampMax;
+        } else if (policy != Policy::kGovernor) {
+            uclampMin = controller.uclampMin();
+            uclampMax = controller.uclampMax();
+        }
+        const double capacity = std::clamp(
+                std::max(kGovernorHeadroom * utilization,
+                         static_cast<double>(uclampMin) / UclampController::kUclampMax),
+                kMinCapacity, static_cast<double>(uclampMax) / UclampController::kUclampMax);
+
+        const double work =
+                std::max(0.0, (heavy ? kHeavyWorkNanos : kLightWorkNanos) * noise(rng));
+        const double duration = work / capacity;
+        if (duration > kFramePeriodNanos) {
+            result.missedFrames++;
+        }
+        result.energy += capacity * capacity * work;
+        result.work += work;
+        result.uclampMin += uclampMin;
+
+        // A late frame keeps the CPU busy for the whole period.
+        const double busy = std::min(1.0, duration / kFramePeriodNanos);
+        utilization = kUtilizationDecay * utilization + (1 - kUtilizationDecay) * busy * capacity;
+        controller.addActualDuration(static_cast<int64_t>(duration));
+    }
+    return result;
+}
+
+void BM_FrameWorkload(benchmark::State& state, Policy policy) {
+    Result result;
+    for (auto _ : state) {
+        result = runFrames(policy);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["missed_pct"] = 100.0 * result.missedFrames / kFrames;
+    state.counters["energy"] = result.energy / result.work;
+    state.counters["uclamp_min"] = result.uclampMin / kFrames;
+    state.SetItemsProcessed(state.iterations() * kFrames);
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_FrameWorkload, governor, Policy::kGovernor);
+BENCHMARK_CAPTURE(BM_FrameWorkload, controller, Policy::kController);
+BENCHMARK_CAPTURE(BM_FrameWorkload, controller_with_hints, Policy::kControllerWithHints);
+BENCHMARK_CAPTURE(BM_FrameWorkload, max_boost, Policy::kMaxBoost);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UclampController.h"
+
+#include <gtest/gtest.h>
+
+namespace aidl::android::hardware::power::impl::example {
+
+static constexpr int64_t kTargetNanos = 16'666'666;
+static constexpr int kUclampMax = UclampController::kUclampMax;
+
+static void reportCycles(UclampController& controller, double ratio, int count) {
+    for (int i = 0; i < count; i++) {
+        controller.addActualDuration(static_cast<int64_t>(kTargetNanos * ratio));
+    }
+}
+
+TEST(UclampControllerTest, StartsUnclamped) {
+    UclampController controller(kTargetNanos);
+    EXPECT_EQ(0, controller.uclampMin());
+    EXPECT_EQ(kUclampMax, controller.uclampMax());
+}
+
+TEST(UclampControllerTest, LateCyclesRaiseUclampMin) {
+    UclampController controller(kTargetNanos);
+    reportCycles(controller, 1.5, 1);
+    EXPECT_GT(controller.uclampMin(), 0);
+
+    // Cycles well ahead of the target relax the boost completely.
+    reportCycles(controller, 0.2, 20);
+    EXPECT_EQ(0, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, DisabledWithoutTarget) {
+    UclampController controller(0);
+    reportCycles(controller, 1.5, 5);
+    controller.loadUp();
+    EXPECT_EQ(0, controller.uclampMin());
+
+    controller.setTargetDuration(kTargetNanos);
+    EXPECT_GT(controller.uclampMin(), 0);
+    controller.setTargetDuration(0);
+    EXPECT_EQ(0, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, LoadChangesShiftUclampMin) {
+    UclampController controller(kTargetNanos);
+    controller.loadUp();
+    EXPECT_EQ(kUclampMax / 4, controller.uclampMin());
+    controller.loadUp();
+    EXPECT_EQ(kUclampMax / 2, controller.uclampMin());
+    controller.loadDown();
+    controller.loadDown();
+    controller.loadDown();
+    EXPECT_EQ(0, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, LoadResetBoostsToAtLeastHalf) {
+    UclampController controller(kTargetNanos);
+    controller.loadReset();
+    EXPECT_EQ(kUclampMax / 2, controller.uclampMin());
+
+    // A higher boost is kept.
+    controller.loadUp();
+    controller.loadUp();
+    controller.loadUp();
+    const int boosted = controller.uclampMin();
+    ASSERT_GT(boosted, kUclampMax / 2);
+    controller.loadReset();
+    EXPECT_EQ(boosted, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, LoadResetDropsTheHistory) {
+    UclampController controller(kTargetNanos);
+    reportCycles(controller, 1.5, 10);
+    controller.loadReset();
+    EXPECT_EQ(kUclampMax, controller.uclampMin());
+
+    // Only the cycles after the reset count.
+    reportCycles(controller, 0.2, 20);
+    EXPECT_EQ(0, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, LoadResumeRestoresTheStateBeforeReset) {
+    UclampController controller(kTargetNanos);
+    controller.loadUp();
+    reportCycles(controller, 0.9, 3);
+    const int before = controller.uclampMin();
+    ASSERT_GT(before, 0);
+
+    controller.loadReset();
+    reportCycles(controller, 0.2, 20);
+    ASSERT_NE(before, controller.uclampMin());
+    controller.loadResume();
+    EXPECT_EQ(before, controller.uclampMin());
+
+    // Resuming again, or without a reset, changes nothing.
+    reportCycles(controller, 0.2, 20);
+    const int after = controller.uclampMin();
+    controller.loadResume();
+    EXPECT_EQ(after, controller.uclampMin());
+}
+
+TEST(UclampControllerTest, PowerEfficiencyCapsUclamp) {
+    UclampController controller(kTargetNanos);
+    reportCycles(controller, 2.0, 10);
+    ASSERT_EQ(kUclampMax, controller.uclampMin());
+
+    controller.setPowerEfficiency(true);
+    EXPECT_EQ(kUclampMax / 2, controller.uclampMin());
+    EXPECT_EQ(kUclampMax * 3 / 4, controller.uclampMax());
+
+    // Neither late cycles nor load hints raise the boost past the cap.
+    reportCycles(controller, 2.0, 10);
+    controller.loadUp();
+    EXPECT_EQ(kUclampMax / 2, controller.uclampMin());
+    EXPECT_EQ(kUclampMax * 3 / 4, controller.uclampMax());
+
+    controller.setPowerEfficiency(false);
+    EXPECT_EQ(kUclampMax, controller.uclampMin());
+    EXPECT_EQ(kUclampMax, controller.uclampMax());
+}
+
+TEST(UclampControllerTest, PowerEfficiencyDoesNotWindUp) {
+    UclampController controller(kTargetNanos);
+    controller.setPowerEfficiency(true);
+    reportCycles(controller, 2.0, 20);
+    ASSERT_EQ(kUclampMax / 2, controller.uclampMin());
+
+    // The integral stopped growing at the cap, so early cycles relax the boost right away.
+    reportCycles(controller, 0.5, 3);
+    EXPECT_LT(controller.uclampMin(), kUclampMax / 2);
+}
+
+}  // namespace aidl::android::hardware::power::impl::example
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuFreqStateResidencyDataProvider.h"
+
+#include <android-base/logging.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+namespace {
+
+// time_in_state counts in clock ticks (USER_HZ).
+constexpr uint64_t kMsPerTick = 10;
+
+// Calls |fn| with each "<frequency in kHz> <ticks>" line of a time_in_state, in one pass.
+template <typename Fn>
+void parseTimeInState(const char* pos, const char* end, Fn fn) {
+    uint64_t frequency;
+    uint64_t ticks;
+    while (SysfsFile::parseUint(&pos, end, &frequency) && SysfsFile::parseUint(&pos, end, &ticks)) {
+        fn(frequency, ticks);
+    }
+}
+
+}  // namespace
+
+CpuFreqStateResidencyDataProvider::CpuFreqStateResidencyDataProvider(
+        const std::string& cpufreqPath)
+    : mBuffer(SysfsFile::kMaxSize) {
+    for (const auto& policyDir : SysfsFile::listDir(cpufreqPath, "policy")) {
+        Policy policy = {
+                .name = "CPUFREQ_POLICY" + policyDir.substr(strlen("policy")),
+                .timeInState = SysfsFile(cpufreqPath + "/" + policyDir + "/stats/time_in_state"),
+        };
+        ssize_t len = policy.timeInState.read(mBuffer.data(), mBuffer.size());
+        if (len <= 0) {
+            // cpufreq statistics are not enabled.
+            continue;
+        }
+        parseTimeInState(mBuffer.data(), mBuffer.data() + len, [&](uint64_t frequency, uint64_t) {
+            policy.states.push_back({.id = static_cast<int32_t>(policy.states.size()),
+                                     .name = std::to_string(frequency)});
+            policy.frequencies.push_back(frequency);
+        });
+        if (!policy.states.empty()) {
+            mPolicies.push_back(std::move(policy));
+        }
+    }
+}
+
+bool CpuFreqStateResidencyDataProvider::getStateResidencies(
+        std::unordered_map<std::string, std::vector<StateResidency>>* residencies) {
+    bool success = true;
+    for (const auto& policy : mPolicies) {
+        ssize_t len = policy.timeInState.read(mBuffer.data(), mBuffer.size());
+        if (len <= 0) {
+            PLOG(ERROR) << "Failed to read the time_in_state of " << policy.name;
+            success = false;
+            continue;
+        }
+        std::vector<StateResidency> stateResidencies(policy.states.size());
+        for (size_t i = 0; i < policy.states.size(); i++) {
+            stateResidencies[i].id = policy.states[i].id;
+        }
+        // The frequencies are listed in the same order every time.
+        size_t i = 0;
+        parseTimeInState(mBuffer.data(), mBuffer.data() + len,
+                         [&](uint64_t frequency, uint64_t ticks) {
+                             if (i >= policy.frequencies.size() ||
+                                 policy.frequencies[i] != frequency) {
+                                 auto it = std::find(policy.frequencies.begin(),
+                                                     policy.frequencies.end(), frequency);
+                                 if (it == policy.frequencies.end()) {
+                                     return;
+                                 }
+                                 i = it - policy.frequencies.begin();
+                             }
+                             stateResidencies[i++].totalTimeInStateMs = ticks * kMsPerTick;
+                         });
+        residencies->emplace(policy.name, std::move(stateResidencies));
+    }
+    return success;
+}
+
+std::unordered_map<std::string, std::vector<State>> CpuFreqStateResidencyDataProvider::getInfo() {
+    std::unordered_map<std::string, std::vector<State>> info;
+    for (const auto& policy : mPolicies) {
+        info.emplace(policy.name, policy.states);
+    }
+    return info;
+}
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
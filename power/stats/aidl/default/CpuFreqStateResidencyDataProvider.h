@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <PowerStats.h>
+
+#include "SysfsFile.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+// Reports the time spent at each frequency of each cpufreq policy, from its time_in_state, as a
+// power entity named after the policy, e.g. "CPUFREQ_POLICY0". The states are the frequencies in
+// kHz.
+class CpuFreqStateResidencyDataProvider : public PowerStats::IStateResidencyDataProvider {
+  public:
+    explicit CpuFreqStateResidencyDataProvider(const std::string& cpufreqPath);
+    ~CpuFreqStateResidencyDataProvider() = default;
+
+    // Methods from PowerStats::IStateResidencyDataProvider
+    bool getStateResidencies(
+            std::unordered_map<std::string, std::vector<StateResidency>>* residencies) override;
+    std::unordered_map<std::string, std::vector<State>> getInfo() override;
+
+  private:
+    struct Policy {
+        std::string name;
+        std::vector<State> states;
+        std::vector<uint64_t> frequencies;
+        SysfsFile timeInState;
+    };
+
+    std::vector<Policy> mPolicies;
+    // Scratch buffer for reading time_in_state.
+    std::vector<char> mBuffer;
+};
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
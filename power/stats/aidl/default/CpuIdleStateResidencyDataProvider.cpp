@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuIdleStateResidencyDataProvider.h"
+
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+CpuIdleStateResidencyDataProvider::CpuIdleStateResidencyDataProvider(const std::string& cpuPath) {
+    for (const auto& cpuDir : SysfsFile::listDir(cpuPath, "cpu")) {
+        int cpuIndex;
+        if (!::android::base::ParseInt(cpuDir.substr(3), &cpuIndex, 0)) {
+            continue;
+        }
+        const std::string idlePath = cpuPath + "/" + cpuDir + "/cpuidle/";
+        Cpu cpu = {.name = "CPU" + std::to_string(cpuIndex)};
+        for (const auto& stateDir : SysfsFile::listDir(idlePath, "state")) {
+            const std::string statePath = idlePath + stateDir + "/";
+            IdleState files = {
+                    .time = SysfsFile(statePath + "time"),
+                    .usage = SysfsFile(statePath + "usage"),
+            };
+            std::string name = SysfsFile::readString(statePath + "name");
+            if (!files.time.isOpen() || !files.usage.isOpen() || name.empty()) {
+                LOG(WARNING) << "Skipping cpuidle state " << statePath;
+                continue;
+            }
+            if (std::any_of(cpu.states.begin(), cpu.states.end(),
+                            [&name](const State& s) { return s.name == name; })) {
+                name += "-" + stateDir;
+            }
+            cpu.states.push_back({.id = static_cast<int32_t>(cpu.states.size()), .name = name});
+            cpu.files.push_back(std::move(files));
+        }
+        if (!cpu.states.empty()) {
+            mCpus.push_back(std::move(cpu));
+        }
+    }
+}
+
+bool CpuIdleStateResidencyDataProvider::getStateResidencies(
+        std::unordered_map<std::string, std::vector<StateResidency>>* residencies) {
+    bool success = true;
+    for (const auto& cpu : mCpus) {
+        std::vector<StateResidency> stateResidencies(cpu.states.size());
+        bool cpuSuccess = true;
+        for (size_t i = 0; i < cpu.states.size() && cpuSuccess; i++) {
+            uint64_t timeUs = 0;
+            uint64_t usage = 0;
+            cpuSuccess = cpu.files[i].time.readUint(&timeUs) && cpu.files[i].usage.readUint(&usage);
+            stateResidencies[i] = {
+                    .id = cpu.states[i].id,
+                    .totalTimeInStateMs = static_cast<int64_t>(timeUs / 1000),
+                    .totalStateEntryCount = static_cast<int64_t>(usage),
+            };
+        }
+        if (cpuSuccess) {
+            residencies->emplace(cpu.name, std::move(stateResidencies));
+        } else {
+            PLOG(ERROR) << "Failed to read the cpuidle states of " << cpu.name;
+            success = false;
+        }
+    }
+    return success;
+}
+
+std::unordered_map<std::string, std::vector<State>> CpuIdleStateResidencyDataProvider::getInfo() {
+    std::unordered_map<std::string, std::vector<State>> info;
+    for (const auto& cpu : mCpus) {
+        info.emplace(cpu.name, cpu.states);
+    }
+    return info;
+}
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <PowerStats.h>
+
+#include "SysfsFile.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+// Reports the cpuidle states of each CPU as a power entity named after the CPU, e.g. "CPU0".
+class CpuIdleStateResidencyDataProvider : public PowerStats::IStateResidencyDataProvider {
+  public:
+    explicit CpuIdleStateResidencyDataProvider(const std::string& cpuPath);
+    ~CpuIdleStateResidencyDataProvider() = default;
+
+    // Methods from PowerStats::IStateResidencyDataProvider
+    bool getStateResidencies(
+            std::unordered_map<std::string, std::vector<StateResidency>>* residencies) override;
+    std::unordered_map<std::string, std::vector<State>> getInfo() override;
+
+  private:
+    struct IdleState {
+        // Total time in the state, in microseconds.
+        SysfsFile time;
+        // Number of times the state was entered.
+        SysfsFile usage;
+    };
+
+    struct Cpu {
+        std::string name;
+        std::vector<State> states;
+        std::vector<IdleState> files;
+    };
+
+    std::vector<Cpu> mCpus;
+};
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -85,22 +85,28 @@ ndk::ScopedAStatus PowerStats::getStateResidency(const std::vector<int32_t>& in_
         return getStateResidency(v, _aidl_return);
     }
 
-    std::unordered_map<std::string, std::vector<StateResidency>> stateResidencies;
-
     for (const int32_t id : in_powerEntityIds) {
         // check for invalid ids
         if (id < 0 || id >= mPowerEntityInfos.size()) {
             return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_ILLEGAL_ARGUMENT));
         }
+    }
 
-        // Check to see if we already have data for the given id
-        std::string powerEntityName = mPowerEntityInfos[id].name;
-        if (stateResidencies.find(powerEntityName) == stateResidencies.end()) {
-            mStateResidencyDataProviders.at(mStateResidencyDataProviderIndex.at(id))
-                    ->getStateResidencies(&stateResidencies);
+    // Query each provider once, so that all the entities it serves come from the same snapshot.
+    std::unordered_map<std::string, std::vector<StateResidency>> stateResidencies;
+    std::vector<bool> queried(mStateResidencyDataProviders.size());
+    for (const int32_t id : in_powerEntityIds) {
+        size_t index = mStateResidencyDataProviderIndex.at(id);
+        if (!queried[index]) {
+            mStateResidencyDataProviders[index]->getStateResidencies(&stateResidencies);
+            queried[index] = true;
         }
+    }
 
+    _aidl_return->reserve(_aidl_return->size() + in_powerEntityIds.size());
+    for (const int32_t id : in_powerEntityIds) {
         // Append results if we have them
+        const std::string& powerEntityName = mPowerEntityInfos[id].name;
         auto stateResidency = stateResidencies.find(powerEntityName);
         if (stateResidency != stateResidencies.end()) {
             StateResidencyResult res = {
@@ -140,7 +146,9 @@ ndk::ScopedAStatus PowerStats::getEnergyConsumed(const std::vector<int32_t>& in_
         if (id < 0 || id >= mEnergyConsumers.size()) {
             return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_ILLEGAL_ARGUMENT));
         }
+    }
 
+    for (const auto id : in_energyConsumerIds) {
         auto optionalResult = mEnergyConsumers[id]->getEnergyConsumed();
         if (optionalResult) {
             EnergyConsumerResult result = optionalResult.value();
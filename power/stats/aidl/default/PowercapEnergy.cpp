@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PowercapEnergy.h"
+
+#include <android-base/chrono_utils.h>
+#include <android-base/logging.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+namespace {
+
+// Subsystems of the RAPL domains, matched by the end of the zone name.
+const std::vector<std::pair<std::string, std::string>> kSubsystems = {
+        {"package", "CPU"}, {"core", "CPU"},       {"uncore", "GPU"},
+        {"dram", "Memory"}, {"psys", "Platform"},
+};
+
+std::string getLeafName(const std::string& name) {
+    size_t pos = name.rfind(':');
+    return pos == std::string::npos ? name : name.substr(pos + 1);
+}
+
+int64_t nowMs() {
+    return std::chrono::time_point_cast<std::chrono::milliseconds>(
+                   ::android::base::boot_clock::now())
+            .time_since_epoch()
+            .count();
+}
+
+}  // namespace
+
+std::vector<std::shared_ptr<PowercapZone>> PowercapZone::findZones(
+        const std::string& powercapPath) {
+    std::vector<std::shared_ptr<PowercapZone>> zones;
+    std::vector<std::string> zoneDirs;
+    // Zones are named <control type>:<index>[:<subzone index>...]; parents come first.
+    for (const auto& dir : SysfsFile::listDir(powercapPath, "")) {
+        if (dir.find(':') == std::string::npos) {
+            continue;
+        }
+        const std::string path = powercapPath + "/" + dir + "/";
+        SysfsFile energy(path + "energy_uj");
+        uint64_t maxEnergyRangeUj;
+        std::string name = SysfsFile::readString(path + "name");
+        if (!energy.isOpen()) {
+            // energy_uj is only readable by root on recent kernels.
+            PLOG(WARNING) << "Skipping powercap zone " << dir;
+            continue;
+        }
+        if (name.empty() ||
+            !SysfsFile(path + "max_energy_range_uj").readUint(&maxEnergyRangeUj)) {
+            LOG(WARNING) << "Skipping powercap zone " << dir << " without a name or energy range";
+            continue;
+        }
+
+        const std::string parentDir = dir.substr(0, dir.rfind(':'));
+        auto parent = std::find(zoneDirs.begin(), zoneDirs.end(), parentDir);
+        if (parent != zoneDirs.end()) {
+            name = zones[parent - zoneDirs.begin()]->getName() + ":" + name;
+        }
+        // The same domain may be exposed by several control types, e.g. intel-rapl-mmio.
+        if (std::any_of(zones.begin(), zones.end(),
+                        [&](const auto& zone) { return zone->getName() == name; })) {
+            name = dir;
+        }
+        zones.push_back(
+                std::make_shared<PowercapZone>(name, std::move(energy), maxEnergyRangeUj));
+        zoneDirs.push_back(dir);
+    }
+    return zones;
+}
+
+PowercapZone::PowercapZone(std::string name, SysfsFile energy, uint64_t maxEnergyRangeUj)
+    : mName(std::move(name)), mEnergy(std::move(energy)), mMaxEnergyRangeUj(maxEnergyRangeUj) {}
+
+std::optional<int64_t> PowercapZone::readEnergyUWs() {
+    uint64_t energyUj;
+    if (!mEnergy.readUint(&energyUj)) {
+        PLOG(ERROR) << "Failed to read the energy of " << mName;
+        return std::nullopt;
+    }
+    if (mEnergyUWs < 0) {
+        mEnergyUWs = energyUj;
+    } else if (energyUj >= mLastEnergyUj) {
+        mEnergyUWs += energyUj - mLastEnergyUj;
+    } else {
+        mEnergyUWs += mMaxEnergyRangeUj - mLastEnergyUj + energyUj;
+    }
+    mLastEnergyUj = energyUj;
+    return mEnergyUWs;
+}
+
+PowercapEnergyMeter::PowercapEnergyMeter(std::vector<std::shared_ptr<PowercapZone>> zones)
+    : mZones(std::move(zones)) {
+    for (const auto& zone : mZones) {
+        const std::string leaf = getLeafName(zone->getName());
+        auto subsystem = std::find_if(kSubsystems.begin(), kSubsystems.end(), [&](const auto& s) {
+            return ::android::base::StartsWith(leaf, s.first);
+        });
+        mChannels.push_back({.id = static_cast<int32_t>(mChannels.size()),
+                             .name = zone->getName(),
+                             .subsystem = subsystem != kSubsystems.end() ? subsystem->second
+                                                                         : "Other"});
+    }
+}
+
+ndk::ScopedAStatus PowercapEnergyMeter::readEnergyMeter(
+        const std::vector<int32_t>& in_channelIds, std::vector<EnergyMeasurement>* _aidl_return) {
+    for (int32_t id : in_channelIds) {
+        // check for invalid ids
+        if (id < 0 || id >= mZones.size()) {
+            return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_ILLEGAL_ARGUMENT));
+        }
+    }
+
+    // All the channels of a read share its timestamp.
+    const int64_t now = nowMs();
+    auto read = [&](int32_t id) {
+        std::optional<int64_t> energy = mZones[id]->readEnergyUWs();
+        if (energy) {
+            _aidl_return->push_back(
+                    {.id = id, .timestampMs = now, .durationMs = now, .energyUWs = *energy});
+        }
+    };
+    if (in_channelIds.empty()) {
+        _aidl_return->reserve(mZones.size());
+        for (int32_t id = 0; id < mZones.size(); id++) {
+            read(id);
+        }
+    } else {
+        _aidl_return->reserve(in_channelIds.size());
+        for (int32_t id : in_channelIds) {
+            read(id);
+        }
+    }
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus PowercapEnergyMeter::getEnergyMeterInfo(std::vector<Channel>* _aidl_return) {
+    *_aidl_return = mChannels;
+    return ndk::ScopedAStatus::ok();
+}
+
+EnergyConsumerType PowercapEnergyConsumer::getType() {
+    return getLeafName(mZone->getName()) == "core" ? EnergyConsumerType::CPU_CLUSTER
+                                                   : EnergyConsumerType::OTHER;
+}
+
+std::optional<EnergyConsumerResult> PowercapEnergyConsumer::getEnergyConsumed() {
+    std::optional<int64_t> energy = mZone->readEnergyUWs();
+    if (!energy) {
+        return std::nullopt;
+    }
+    return EnergyConsumerResult{.timestampMs = nowMs(), .energyUWs = *energy};
+}
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <PowerStats.h>
+
+#include "SysfsFile.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+// The energy counter of a powercap zone, e.g. an Intel RAPL domain, extended to 64 bits.
+class PowercapZone {
+  public:
+    // Returns the zones under |powercapPath| whose energy counter can be read.
+    static std::vector<std::shared_ptr<PowercapZone>> findZones(const std::string& powercapPath);
+
+    PowercapZone(std::string name, SysfsFile energy, uint64_t maxEnergyRangeUj);
+
+    // Zone names are qualified by their parent zone, e.g. "package-0:core".
+    const std::string& getName() const { return mName; }
+    std::optional<int64_t> readEnergyUWs();
+
+  private:
+    const std::string mName;
+    const SysfsFile mEnergy;
+    const uint64_t mMaxEnergyRangeUj;
+    // The last value of the counter, which wraps at mMaxEnergyRangeUj.
+    uint64_t mLastEnergyUj = 0;
+    int64_t mEnergyUWs = -1;
+};
+
+class PowercapEnergyMeter : public PowerStats::IEnergyMeter {
+  public:
+    explicit PowercapEnergyMeter(std::vector<std::shared_ptr<PowercapZone>> zones);
+    ~PowercapEnergyMeter() = default;
+
+    ndk::ScopedAStatus readEnergyMeter(const std::vector<int32_t>& in_channelIds,
+                                       std::vector<EnergyMeasurement>* _aidl_return) override;
+    ndk::ScopedAStatus getEnergyMeterInfo(std::vector<Channel>* _aidl_return) override;
+
+  private:
+    const std::vector<std::shared_ptr<PowercapZone>> mZones;
+    std::vector<Channel> mChannels;
+};
+
+class PowercapEnergyConsumer : public PowerStats::IEnergyConsumer {
+  public:
+    explicit PowercapEnergyConsumer(std::shared_ptr<PowercapZone> zone) : mZone(std::move(zone)) {}
+    ~PowercapEnergyConsumer() = default;
+
+    std::string getName() override { return mZone->getName(); }
+    EnergyConsumerType getType() override;
+    std::optional<EnergyConsumerResult> getEnergyConsumed() override;
+
+  private:
+    const std::shared_ptr<PowercapZone> mZone;
+};
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace stats {
+
+// A sysfs attribute kept open, so that sampling it again only costs a pread().
+class SysfsFile {
+  public:
+    // Sysfs attributes are at most a page long.
+    static constexpr size_t kMaxSize = 4096;
+
+    SysfsFile() = default;
+    explicit SysfsFile(const std::string& path)
+        : mFd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC))) {}
+
+    bool isOpen() const { return mFd.ok(); }
+
+    // Reads the attribute into |buf|. Returns the length read, or -1.
+    ssize_t read(char* buf, size_t size) const {
+        return TEMP_FAILURE_RETRY(pread(mFd.get(), buf, size, 0));
+    }
+
+    bool readUint(uint64_t* value) const {
+        char buf[32];
+        ssize_t len = read(buf, sizeof(buf));
+        const char* pos = buf;
+        return len > 0 && parseUint(&pos, buf + len, value);
+    }
+
+    // Parses the next unsigned decimal number in [*pos, end), skipping the characters before it,
+    // and moves *pos past it. Returns false if there is none.
+    static bool parseUint(const char** pos, const char* end, uint64_t* value) {
+        const char* p = std::find_if(*pos, end, [](char c) { return c >= '0' && c <= '9'; });
+        if (p == end) {
+            *pos = end;
+            return false;
+        }
+        uint64_t v = 0;
+        for (; p != end && *p >= '0' && *p <= '9'; p++) {
+            v = v * 10 + (*p - '0');
+        }
+        *value = v;
+        *pos = p;
+        return true;
+    }
+
+    // Returns the trimmed content of a small attribute, for discovery.
+    static std::string readString(const std::string& path) {
+        std::string value;
+        if (!::android::base::ReadFileToString(path, &value)) {
+            return "";
+        }
+        return ::android::base::Trim(value);
+    }
+
+    // Returns the names of the entries of |dir| which start with |prefix|, shortest first, so that
+    // numbered entries are in numeric order.
+    static std::vector<std::string> listDir(const std::string& dir, const std::string& prefix) {
+        std::vector<std::string> names;
+        std::unique_ptr<DIR, decltype(&closedir)> d(opendir(dir.c_str()), closedir);
+        if (!d) {
+            return names;
+        }
+        while (struct dirent* entry = readdir(d.get())) {
+            if (::android::base::StartsWith(entry->d_name, prefix)) {
+                names.emplace_back(entry->d_name);
+            }
+        }
+        std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+            return a.size() != b.size() ? a.size() < b.size() : a < b;
+        });
+        return names;
+    }
+
+  private:
+    ::android::base::unique_fd mFd;
+};
+
+}  // namespace stats
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
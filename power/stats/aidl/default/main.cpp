@@ -16,18 +16,26 @@
 
 #include "PowerStats.h"
 
+#include "CpuFreqStateResidencyDataProvider.h"
+#include "CpuIdleStateResidencyDataProvider.h"
 #include "FakeEnergyConsumer.h"
 #include "FakeEnergyMeter.h"
 #include "FakeStateResidencyDataProvider.h"
+#include "PowercapEnergy.h"
 
 #include <android-base/logging.h>
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 
+using aidl::android::hardware::power::stats::CpuFreqStateResidencyDataProvider;
+using aidl::android::hardware::power::stats::CpuIdleStateResidencyDataProvider;
 using aidl::android::hardware::power::stats::EnergyConsumerType;
 using aidl::android::hardware::power::stats::FakeEnergyConsumer;
 using aidl::android::hardware::power::stats::FakeEnergyMeter;
 using aidl::android::hardware::power::stats::FakeStateResidencyDataProvider;
+using aidl::android::hardware::power::stats::PowercapEnergyConsumer;
+using aidl::android::hardware::power::stats::PowercapEnergyMeter;
+using aidl::android::hardware::power::stats::PowercapZone;
 using aidl::android::hardware::power::stats::PowerStats;
 using aidl::android::hardware::power::stats::State;
 
@@ -59,17 +67,53 @@ void addFakeEnergyConsumer2(std::shared_ptr<PowerStats> p) {
             std::make_unique<FakeEnergyConsumer>(EnergyConsumerType::MOBILE_RADIO, "MODEM"));
 }
 
+// Returns whether the kernel exposes CPU idle or frequency statistics.
+bool addCpuStateResidencyDataProviders(std::shared_ptr<PowerStats> p) {
+    auto cpuIdle =
+            std::make_unique<CpuIdleStateResidencyDataProvider>("/sys/devices/system/cpu");
+    auto cpuFreq = std::make_unique<CpuFreqStateResidencyDataProvider>(
+            "/sys/devices/system/cpu/cpufreq");
+    bool found = false;
+    if (!cpuIdle->getInfo().empty()) {
+        p->addStateResidencyDataProvider(std::move(cpuIdle));
+        found = true;
+    }
+    if (!cpuFreq->getInfo().empty()) {
+        p->addStateResidencyDataProvider(std::move(cpuFreq));
+        found = true;
+    }
+    return found;
+}
+
+// Returns whether the kernel exposes powercap energy counters, e.g. Intel RAPL.
+bool addPowercapEnergy(std::shared_ptr<PowerStats> p) {
+    auto zones = PowercapZone::findZones("/sys/class/powercap");
+    if (zones.empty()) {
+        return false;
+    }
+    for (const auto& zone : zones) {
+        p->addEnergyConsumer(std::make_unique<PowercapEnergyConsumer>(zone));
+    }
+    p->setEnergyMeter(std::make_unique<PowercapEnergyMeter>(std::move(zones)));
+    return true;
+}
+
 int main() {
     ABinderProcess_setThreadPoolMaxThreadCount(0);
     std::shared_ptr<PowerStats> p = ndk::SharedRefBase::make<PowerStats>();
 
-    setFakeEnergyMeter(p);
+    // The fakes stand in for what the device does not expose.
+    if (!addPowercapEnergy(p)) {
+        setFakeEnergyMeter(p);
 
-    addFakeStateResidencyDataProvider1(p);
-    addFakeStateResidencyDataProvider2(p);
+        addFakeEnergyConsumer1(p);
+        addFakeEnergyConsumer2(p);
+    }
 
-    addFakeEnergyConsumer1(p);
-    addFakeEnergyConsumer2(p);
+    if (!addCpuStateResidencyDataProviders(p)) {
+        addFakeStateResidencyDataProvider1(p);
+    }
+    addFakeStateResidencyDataProvider2(p);
 
     const std::string instance = std::string() + PowerStats::descriptor + "/default";
     binder_status_t status = AServiceManager_addService(p->asBinder().get(), instance.c_str());
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuFreqStateResidencyDataProvider.h"
+#include "CpuIdleStateResidencyDataProvider.h"
+#include "PowerStats.h"
+#include "PowercapEnergy.h"
+
+#include <sys/stat.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <gtest/gtest.h>
+
+using ::android::base::TemporaryDir;
+using ::android::base::WriteStringToFile;
+
+namespace aidl::android::hardware::power::stats {
+
+// A sysfs with the cpuidle, cpufreq and powercap attributes of a device.
+class PowerStatsTest : public ::testing::Test {
+  protected:
+    void MakeDirs(const std::string& path) {
+        std::string dir = root_;
+        for (const auto& name : ::android::base::Split(path.substr(1), "/")) {
+            dir += "/" + name;
+            mkdir(dir.c_str(), 0700);
+        }
+    }
+
+    void WriteFile(const std::string& path, const std::string& content) {
+        MakeDirs(path.substr(0, path.rfind('/')));
+        ASSERT_TRUE(WriteStringToFile(content, root_ + path)) << path;
+    }
+
+    void AddIdleState(int cpu, int state, const std::string& name, const std::string& time,
+                      const std::string& usage) {
+        const std::string dir =
+                "/cpu/cpu" + std::to_string(cpu) + "/cpuidle/state" + std::to_string(state) + "/";
+        WriteFile(dir + "name", name + "\n");
+        WriteFile(dir + "time", time + "\n");
+        WriteFile(dir + "usage", usage + "\n");
+    }
+
+    void AddPowercapZone(const std::string& dir, const std::string& name,
+                         const std::string& energy, const std::string& maxEnergyRange) {
+        WriteFile("/powercap/" + dir + "/name", name + "\n");
+        WriteFile("/powercap/" + dir + "/energy_uj", energy + "\n");
+        WriteFile("/powercap/" + dir + "/max_energy_range_uj", maxEnergyRange + "\n");
+    }
+
+    std::unordered_map<std::string, std::vector<StateResidency>> GetStateResidencies(
+            PowerStats::IStateResidencyDataProvider& provider) {
+        std::unordered_map<std::string, std::vector<StateResidency>> residencies;
+        EXPECT_TRUE(provider.getStateResidencies(&residencies));
+        return residencies;
+    }
+
+    TemporaryDir dir_;
+    const std::string root_ = dir_.path;
+};
+
+TEST_F(PowerStatsTest, FindsCpuIdleStates) {
+    AddIdleState(0, 0, "WFI", "1500", "3");
+    AddIdleState(0, 1, "cpu-sleep", "20000", "4");
+    // State names are not unique on every platform.
+    AddIdleState(0, 2, "cpu-sleep", "30000", "5");
+    AddIdleState(10, 0, "WFI", "7000", "8");
+    AddIdleState(2, 0, "WFI", "9000", "10");
+    // States which cannot be read are skipped, and CPUs without any.
+    WriteFile("/cpu/cpu2/cpuidle/state1/name", "incomplete\n");
+    MakeDirs("/cpu/cpu3");
+    MakeDirs("/cpu/cpuidle");
+    CpuIdleStateResidencyDataProvider provider(root_ + "/cpu");
+
+    auto info = provider.getInfo();
+    ASSERT_EQ(3u, info.size());
+    ASSERT_EQ(3u, info["CPU0"].size());
+    EXPECT_EQ(0, info["CPU0"][0].id);
+    EXPECT_EQ("WFI", info["CPU0"][0].name);
+    EXPECT_EQ(2, info["CPU0"][2].id);
+    EXPECT_EQ("cpu-sleep", info["CPU0"][1].name);
+    EXPECT_EQ("cpu-sleep-state2", info["CPU0"][2].name);
+    EXPECT_EQ(1u, info["CPU2"].size());
+    EXPECT_EQ(1u, info["CPU10"].size());
+
+    auto residencies = GetStateResidencies(provider);
+    ASSERT_EQ(3u, residencies.size());
+    ASSERT_EQ(3u, residencies["CPU0"].size());
+    EXPECT_EQ(1, residencies["CPU0"][0].totalTimeInStateMs);
+    EXPECT_EQ(3, residencies["CPU0"][0].totalStateEntryCount);
+    EXPECT_EQ(30, residencies["CPU0"][2].totalTimeInStateMs);
+    EXPECT_EQ(5, residencies["CPU0"][2].totalStateEntryCount);
+    EXPECT_EQ(7, residencies["CPU10"][0].totalTimeInStateMs);
+
+    // The attributes are read again on each call.
+    WriteFile("/cpu/cpu10/cpuidle/state0/time", "12000\n");
+    EXPECT_EQ(12, GetStateResidencies(provider)["CPU10"][0].totalTimeInStateMs);
+}
+
+TEST_F(PowerStatsTest, ParsesTimeInStateOfEachPolicy) {
+    WriteFile("/cpufreq/policy0/stats/time_in_state", "300000 10\n600000 20\n1200000 30\n");
+    WriteFile("/cpufreq/policy4/stats/time_in_state", "1000000 5\n2000000 7\n");
+    // Policies without cpufreq statistics are skipped.
+    MakeDirs("/cpufreq/policy6");
+    CpuFreqStateResidencyDataProvider provider(root_ + "/cpufreq");
+
+    auto info = provider.getInfo();
+    ASSERT_EQ(2u, info.size());
+    ASSERT_EQ(3u, info["CPUFREQ_POLICY0"].size());
+    EXPECT_EQ("300000", info["CPUFREQ_POLICY0"][0].name);
+    EXPECT_EQ(2, info["CPUFREQ_POLICY0"][2].id);
+    EXPECT_EQ("1200000", info["CPUFREQ_POLICY0"][2].name);
+    ASSERT_EQ(2u, info["CPUFREQ_POLICY4"].size());
+    EXPECT_EQ("2000000", info["CPUFREQ_POLICY4"][1].name);
+
+    auto residencies = GetStateResidencies(provider);
+    ASSERT_EQ(2u, residencies.size());
+    ASSERT_EQ(3u, residencies["CPUFREQ_POLICY0"].size());
+    EXPECT_EQ(100, residencies["CPUFREQ_POLICY0"][0].totalTimeInStateMs);
+    EXPECT_EQ(300, residencies["CPUFREQ_POLICY0"][2].totalTimeInStateMs);
+    ASSERT_EQ(2u, residencies["CPUFREQ_POLICY4"].size());
+    EXPECT_EQ(1, residencies["CPUFREQ_POLICY4"][1].id);
+    EXPECT_EQ(70, residencies["CPUFREQ_POLICY4"][1].totalTimeInStateMs);
+
+    // Frequencies out of order are matched by value, and unknown ones ignored.
+    WriteFile("/cpufreq/policy0/stats/time_in_state", "1200000 31\n300000 11\n900000 99\n");
+    residencies = GetStateResidencies(provider);
+    ASSERT_EQ(3u, residencies["CPUFREQ_POLICY0"].size());
+    EXPECT_EQ(110, residencies["CPUFREQ_POLICY0"][0].totalTimeInStateMs);
+    EXPECT_EQ(0, residencies["CPUFREQ_POLICY0"][1].totalTimeInStateMs);
+    EXPECT_EQ(310, residencies["CPUFREQ_POLICY0"][2].totalTimeInStateMs);
+}
+
+TEST_F(PowerStatsTest, FindsPowercapZones) {
+    AddPowercapZone("intel-rapl:0", "package-0", "100", "1000");
+    AddPowercapZone("intel-rapl:0:0", "core", "200", "1000");
+    AddPowercapZone("intel-rapl:1", "psys", "300", "1000");
+    // The same domain exposed by another control type keeps its directory name.
+    AddPowercapZone("intel-rapl-mmio:0", "package-0", "400", "1000");
+    // Control types and incomplete zones are skipped.
+    MakeDirs("/powercap/intel-rapl");
+    WriteFile("/powercap/intel-rapl:2/energy_uj", "500\n");
+    auto zones = PowercapZone::findZones(root_ + "/powercap");
+
+    ASSERT_EQ(4u, zones.size());
+    EXPECT_EQ("package-0", zones[0]->getName());
+    EXPECT_EQ("psys", zones[1]->getName());
+    EXPECT_EQ("package-0:core", zones[2]->getName());
+    EXPECT_EQ("intel-rapl-mmio:0", zones[3]->getName());
+
+    PowercapEnergyMeter meter(zones);
+    std::vector<Channel> channels;
+    ASSERT_TRUE(meter.getEnergyMeterInfo(&channels).isOk());
+    ASSERT_EQ(4u, channels.size());
+    EXPECT_EQ("CPU", channels[0].subsystem);
+    EXPECT_EQ("Platform", channels[1].subsystem);
+    EXPECT_EQ("CPU", channels[2].subsystem);
+    EXPECT_EQ(EnergyConsumerType::CPU_CLUSTER, PowercapEnergyConsumer(zones[2]).getType());
+    EXPECT_EQ(EnergyConsumerType::OTHER, PowercapEnergyConsumer(zones[0]).getType());
+}
+
+TEST_F(PowerStatsTest, EnergyCounterWrapsAtMaxEnergyRange) {
+    AddPowercapZone("intel-rapl:0", "package-0", "900", "1000");
+    auto zones = PowercapZone::findZones(root_ + "/powercap");
+    ASSERT_EQ(1u, zones.size());
+    PowercapEnergyConsumer consumer(zones[0]);
+
+    auto energy = consumer.getEnergyConsumed();
+    ASSERT_TRUE(energy);
+    EXPECT_EQ(900, energy->energyUWs);
+
+    WriteFile("/powercap/intel-rapl:0/energy_uj", "950\n");
+    EXPECT_EQ(950, consumer.getEnergyConsumed()->energyUWs);
+
+    // The counter wrapped past max_energy_range_uj.
+    WriteFile("/powercap/intel-rapl:0/energy_uj", "100\n");
+    EXPECT_EQ(1100, consumer.getEnergyConsumed()->energyUWs);
+    WriteFile("/powercap/intel-rapl:0/energy_uj", "600\n");
+    EXPECT_EQ(1600, consumer.getEnergyConsumed()->energyUWs);
+}
+
+TEST_F(PowerStatsTest, RejectsInvalidIds) {
+    AddIdleState(0, 0, "WFI", "1000", "1");
+    AddIdleState(1, 0, "WFI", "2000", "2");
+    AddPowercapZone("intel-rapl:0", "package-0", "100", "1000");
+    AddPowercapZone("intel-rapl:0:0", "core", "200", "1000");
+    auto powerStats = ndk::SharedRefBase::make<PowerStats>();
+    powerStats->addStateResidencyDataProvider(
+            std::make_unique<CpuIdleStateResidencyDataProvider>(root_ + "/cpu"));
+    auto zones = PowercapZone::findZones(root_ + "/powercap");
+    for (const auto& zone : zones) {
+        powerStats->addEnergyConsumer(std::make_unique<PowercapEnergyConsumer>(zone));
+    }
+    powerStats->setEnergyMeter(std::make_unique<PowercapEnergyMeter>(std::move(zones)));
+
+    std::vector<StateResidencyResult> residencies;
+    ASSERT_TRUE(powerStats->getStateResidency({}, &residencies).isOk());
+    EXPECT_EQ(2u, residencies.size());
+    for (const std::vector<int32_t>& ids :
+         std::vector<std::vector<int32_t>>{{-1}, {2}, {0, 2}}) {
+        residencies.clear();
+        EXPECT_EQ(EX_ILLEGAL_ARGUMENT,
+                  powerStats->getStateResidency(ids, &residencies).getExceptionCode());
+        EXPECT_TRUE(residencies.empty());
+    }
+    residencies.clear();
+    ASSERT_TRUE(powerStats->getStateResidency({1}, &residencies).isOk());
+    ASSERT_EQ(1u, residencies.size());
+    EXPECT_EQ(1, residencies[0].id);
+
+    std::vector<EnergyConsumerResult> energies;
+    ASSERT_TRUE(powerStats->getEnergyConsumed({}, &energies).isOk());
+    EXPECT_EQ(2u, energies.size());
+    for (const std::vector<int32_t>& ids :
+         std::vector<std::vector<int32_t>>{{-1}, {2}, {1, 2}}) {
+        energies.clear();
+        EXPECT_EQ(EX_ILLEGAL_ARGUMENT,
+                  powerStats->getEnergyConsumed(ids, &energies).getExceptionCode());
+        EXPECT_TRUE(energies.empty());
+    }
+
+    std::vector<EnergyMeasurement> measurements;
+    EXPECT_EQ(EX_ILLEGAL_ARGUMENT,
+              powerStats->readEnergyMeter({2}, &measurements).getExceptionCode());
+    EXPECT_TRUE(measurements.empty());
+}
+
+}  // namespace aidl::android::hardware::power::stats
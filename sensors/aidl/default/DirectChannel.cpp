@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SensorsDirectChannel"
+
+#include "sensors-impl/DirectChannel.h"
+
+#include <aidl/sensors/convert.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+using ::android::base::unique_fd;
+using ::android::hardware::sensors::implementation::convertToSensorEvent;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+namespace {
+
+constexpr size_t kOffsetSize = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_FIELD;
+constexpr size_t kOffsetToken = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_REPORT_TOKEN;
+constexpr size_t kOffsetType = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_SENSOR_TYPE;
+constexpr size_t kOffsetAtomicCounter =
+        ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_ATOMIC_COUNTER;
+constexpr size_t kOffsetTimestamp = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_TIMESTAMP;
+constexpr size_t kOffsetData = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA;
+constexpr size_t kOffsetReserved = ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_RESERVED;
+constexpr size_t kDataSize = kOffsetReserved - kOffsetData;
+
+static_assert(kDataSize == sizeof(sensors_event_t::data), "direct report data size mismatch");
+
+}  // namespace
+
+std::unique_ptr<DirectChannel> DirectChannel::create(const SharedMemInfo& mem, int32_t* error) {
+    *error = EX_ILLEGAL_ARGUMENT;
+    if (mem.format != SharedMemInfo::SharedMemFormat::SENSORS_EVENT ||
+        mem.size < static_cast<int32_t>(kEventSize) || mem.memoryHandle.fds.empty()) {
+        return nullptr;
+    }
+    if (mem.type != SharedMemInfo::SharedMemType::ASHMEM &&
+        mem.type != SharedMemInfo::SharedMemType::GRALLOC) {
+        return nullptr;
+    }
+
+    // Both ashmem regions and gralloc BLOB buffers allocated with SENSOR_DIRECT_DATA usage are
+    // backed by a single mappable fd, so they share the same path.
+    unique_fd fd(dup(mem.memoryHandle.fds[0].get()));
+    if (fd.get() < 0) {
+        ALOGE("Failed to dup direct channel fd: %s", strerror(errno));
+        *error = ISensors::ERROR_NO_MEMORY;
+        return nullptr;
+    }
+
+    const size_t size = static_cast<size_t>(mem.size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (base == MAP_FAILED) {
+        ALOGE("Failed to map %zu byte direct channel: %s", size, strerror(errno));
+        *error = ISensors::ERROR_NO_MEMORY;
+        return nullptr;
+    }
+
+    *error = 0;
+    return std::unique_ptr<DirectChannel>(
+            new DirectChannel(mem.type, std::move(fd), static_cast<uint8_t*>(base), size));
+}
+
+DirectChannel::DirectChannel(SharedMemInfo::SharedMemType type, unique_fd fd, uint8_t* base,
+                             size_t size)
+    : mType(type), mFd(std::move(fd)), mBase(base), mSize(size), mWriteOffset(0), mCounter(0) {
+    // The HAL is responsible for resetting the memory content on registration.
+    memset(mBase, 0, mSize);
+}
+
+DirectChannel::~DirectChannel() {
+    munmap(mBase, mSize);
+}
+
+void DirectChannel::write(const Event& event, int32_t reportToken) {
+    sensors_event_t legacy;
+    convertToSensorEvent(event, &legacy);
+
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    if (mWriteOffset + kEventSize > mSize) {
+        mWriteOffset = 0;
+    }
+    uint8_t* record = mBase + mWriteOffset;
+
+    const int32_t size = static_cast<int32_t>(kEventSize);
+    const int32_t type = static_cast<int32_t>(event.sensorType);
+    memcpy(record + kOffsetSize, &size, sizeof(size));
+    memcpy(record + kOffsetToken, &reportToken, sizeof(reportToken));
+    memcpy(record + kOffsetType, &type, sizeof(type));
+    memcpy(record + kOffsetTimestamp, &event.timestamp, sizeof(event.timestamp));
+    memcpy(record + kOffsetData, legacy.data, kDataSize);
+    memset(record + kOffsetReserved, 0, kEventSize - kOffsetReserved);
+
+    if (++mCounter == 0) {
+        mCounter = 1;
+    }
+    // Publish the record: readers load the counter first and must then observe every field above.
+    __atomic_store_n(reinterpret_cast<uint32_t*>(record + kOffsetAtomicCounter), mCounter,
+                     __ATOMIC_RELEASE);
+
+    mWriteOffset += kEventSize;
+}
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -16,8 +16,7 @@
 
 #include "sensors-impl/Sensor.h"
 
-#include "utils/SystemClock.h"
-
+#include <algorithm>
 #include <cmath>
 
 using ::ndk::ScopedAStatus;
@@ -29,51 +28,93 @@ namespace sensors {
 
 static constexpr int32_t kDefaultMaxDelayUs = 10 * 1000 * 1000;
 
+// Continuous sensors buffer up to this many events while batching. A full FIFO is posted in one
+// write, and the framework may size the event queue to MAX_RECEIVE_BUFFER_EVENT_COUNT (256)
+// events, so the FIFOs of the four batching sensors, along with their flush complete events,
+// must fit in it together.
+static constexpr int32_t kFifoMaxEventCount = 60;
+
+// Direct channel support advertised by the continuous IMU sensors.  Their
+// minDelayUs of 10ms caps them at 100Hz, within the range of RateLevel::NORMAL
+// but below that of RateLevel::FAST.
+static constexpr uint32_t kDirectReportFlags =
+        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM) |
+        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_GRALLOC) |
+        (static_cast<uint32_t>(ISensors::RateLevel::NORMAL)
+         << static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT));
+
+// Nominal report period of each direct report rate level, see ISensors::RateLevel.
+static int64_t getDirectReportPeriodNs(ISensors::RateLevel rate) {
+    switch (rate) {
+        case ISensors::RateLevel::NORMAL:
+            return 1000 * 1000 * 1000 / 50;
+        case ISensors::RateLevel::FAST:
+            return 1000 * 1000 * 1000 / 200;
+        case ISensors::RateLevel::VERY_FAST:
+            return 1000 * 1000 * 1000 / 800;
+        default:
+            return 0;
+    }
+}
+
 Sensor::Sensor(ISensorsEventCallback* callback)
     : mIsEnabled(false),
       mSamplingPeriodNs(0),
+      mMaxReportLatencyNs(0),
       mLastSampleTimeNs(0),
       mCallback(callback),
-      mMode(OperationMode::NORMAL) {
-    mRunThread = std::thread(startThread, this);
-}
+      mMode(OperationMode::NORMAL) {}
 
-Sensor::~Sensor() {
-    std::unique_lock<std::mutex> lock(mRunMutex);
-    mStopThread = true;
-    mIsEnabled = false;
-    mWaitCV.notify_all();
-    lock.release();
-    mRunThread.join();
-}
+Sensor::~Sensor() {}
 
 const SensorInfo& Sensor::getSensorInfo() const {
     return mSensorInfo;
 }
 
-void Sensor::batch(int64_t samplingPeriodNs) {
+void Sensor::batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs) {
     if (samplingPeriodNs < mSensorInfo.minDelayUs * 1000LL) {
         samplingPeriodNs = mSensorInfo.minDelayUs * 1000LL;
     } else if (samplingPeriodNs > mSensorInfo.maxDelayUs * 1000LL) {
         samplingPeriodNs = mSensorInfo.maxDelayUs * 1000LL;
     }
+    // Sensors without a FIFO report every event as soon as it is sampled.
+    if (mSensorInfo.fifoMaxEventCount == 0 || maxReportLatencyNs < 0) {
+        maxReportLatencyNs = 0;
+    }
 
-    if (mSamplingPeriodNs != samplingPeriodNs) {
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mSamplingPeriodNs == samplingPeriodNs && mMaxReportLatencyNs == maxReportLatencyNs) {
+            return;
+        }
         mSamplingPeriodNs = samplingPeriodNs;
-        // Wake up the 'run' thread to check if a new event should be generated now
-        mWaitCV.notify_all();
+        mMaxReportLatencyNs = maxReportLatencyNs;
+        if (mMaxReportLatencyNs == 0) {
+            postFifoLocked();
+        } else {
+            mFifo.reserve(mSensorInfo.fifoMaxEventCount);
+        }
     }
+    // Wake up the scheduler to check if a new event should be generated now
+    SensorScheduler::getInstance().wake();
 }
 
 void Sensor::activate(bool enable) {
-    if (mIsEnabled != enable) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mIsEnabled == enable) {
+            return;
+        }
         mIsEnabled = enable;
-        mWaitCV.notify_all();
+        if (!enable) {
+            postFifoLocked();
+        }
     }
+    SensorScheduler::getInstance().wake();
 }
 
 ScopedAStatus Sensor::flush() {
+    std::lock_guard<std::mutex> lock(mRunMutex);
     // Only generate a flush complete event if the sensor is enabled and if the sensor is not a
     // one-shot sensor.
     if (!mIsEnabled ||
@@ -82,8 +123,10 @@ ScopedAStatus Sensor::flush() {
                 static_cast<int32_t>(BnSensors::ERROR_BAD_VALUE));
     }
 
-    // Note: If a sensor supports batching, write all of the currently batched events for the sensor
-    // to the Event FMQ prior to writing the flush complete event.
+    // Write all of the currently batched events for the sensor to the Event FMQ prior to writing
+    // the flush complete event.
+    postFifoLocked();
+
     Event ev;
     ev.sensorHandle = mSensorInfo.sensorHandle;
     ev.sensorType = SensorType::META_DATA;
@@ -97,33 +140,63 @@ ScopedAStatus Sensor::flush() {
     return ScopedAStatus::ok();
 }
 
-void Sensor::startThread(Sensor* sensor) {
-    sensor->run();
-}
-
-void Sensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
-    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
-
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
-        } else {
-            timespec curTime;
-            clock_gettime(CLOCK_BOOTTIME, &curTime);
-            int64_t now = (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
-            int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-
-            if (now >= nextSampleTime) {
-                mLastSampleTimeNs = now;
-                nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
+int64_t Sensor::poll(int64_t nowNs) {
+    std::lock_guard<std::mutex> lock(mRunMutex);
+    if (mMode != OperationMode::NORMAL) {
+        return SensorScheduler::kNever;
+    }
+    int64_t nextWakeTime = SensorScheduler::kNever;
+
+    if (mIsEnabled) {
+        int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
+        if (nowNs >= nextSampleTime) {
+            mLastSampleTimeNs = nowNs;
+            nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
+            std::vector<Event> events = readEvents(nowNs);
+            if (mMaxReportLatencyNs == 0) {
+                if (!events.empty()) {
+                    mCallback->postEvents(events, isWakeUpSensor());
+                }
+            } else {
+                mFifo.insert(mFifo.end(), events.begin(), events.end());
+                if (mFifo.size() >= static_cast<size_t>(mSensorInfo.fifoMaxEventCount)) {
+                    postFifoLocked();
+                }
             }
+        }
+        nextWakeTime = nextSampleTime;
+
+        if (!mFifo.empty()) {
+            int64_t reportTime = mFifo.front().timestamp + mMaxReportLatencyNs;
+            if (nowNs >= reportTime) {
+                postFifoLocked();
+            } else {
+                nextWakeTime = std::min(nextWakeTime, reportTime);
+            }
+        }
+    }
 
-            mWaitCV.wait_for(runLock, std::chrono::nanoseconds(nextSampleTime - now));
+    // Direct reports bypass the event FMQ and are written straight into each channel at the
+    // period of its rate level, independently of activate() and batch().
+    for (auto& [channelHandle, report] : mDirectReports) {
+        int64_t nextReportTime = report.lastSampleTimeNs + report.periodNs;
+        if (nowNs >= nextReportTime) {
+            report.lastSampleTimeNs = nowNs;
+            nextReportTime = nowNs + report.periodNs;
+            for (const Event& event : Sensor::readEvents(nowNs)) {
+                report.channel->write(event, mSensorInfo.sensorHandle);
+            }
         }
+        nextWakeTime = std::min(nextWakeTime, nextReportTime);
+    }
+
+    return nextWakeTime;
+}
+
+void Sensor::postFifoLocked() {
+    if (!mFifo.empty()) {
+        mCallback->postEvents(mFifo, isWakeUpSensor());
+        mFifo.clear();
     }
 }
 
@@ -131,12 +204,12 @@ bool Sensor::isWakeUpSensor() {
     return mSensorInfo.flags & static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_WAKE_UP);
 }
 
-std::vector<Event> Sensor::readEvents() {
+std::vector<Event> Sensor::readEvents(int64_t timestampNs) {
     std::vector<Event> events;
     Event event;
     event.sensorHandle = mSensorInfo.sensorHandle;
     event.sensorType = mSensorInfo.type;
-    event.timestamp = ::android::elapsedRealtimeNano();
+    event.timestamp = timestampNs;
     memset(&event.payload, 0, sizeof(event.payload));
     readEventPayload(event.payload);
     events.push_back(event);
@@ -144,11 +217,14 @@ std::vector<Event> Sensor::readEvents() {
 }
 
 void Sensor::setOperationMode(OperationMode mode) {
-    if (mMode != mode) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mMode == mode) {
+            return;
+        }
         mMode = mode;
-        mWaitCV.notify_all();
     }
+    SensorScheduler::getInstance().wake();
 }
 
 bool Sensor::supportsDataInjection() const {
@@ -175,6 +251,42 @@ ScopedAStatus Sensor::injectEvent(const Event& event) {
             static_cast<int32_t>(BnSensors::ERROR_BAD_VALUE));
 }
 
+bool Sensor::configDirectReport(int32_t channelHandle, const std::shared_ptr<DirectChannel>& channel,
+                                RateLevel rate) {
+    std::unique_lock<std::mutex> lock(mRunMutex);
+    if (rate == RateLevel::STOP) {
+        mDirectReports.erase(channelHandle);
+        return true;
+    }
+
+    uint32_t maxRate = (mSensorInfo.flags &
+                        static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_MASK_DIRECT_REPORT)) >>
+                       static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT);
+    uint32_t typeFlag = channel->getType() == ISensors::SharedMemInfo::SharedMemType::ASHMEM
+                                ? static_cast<uint32_t>(
+                                          SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM)
+                                : static_cast<uint32_t>(
+                                          SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_GRALLOC);
+    int64_t periodNs = getDirectReportPeriodNs(rate);
+    if (static_cast<uint32_t>(rate) > maxRate || !(mSensorInfo.flags & typeFlag) ||
+        periodNs == 0) {
+        return false;
+    }
+
+    auto report = mDirectReports.find(channelHandle);
+    if (report != mDirectReports.end() && report->second.periodNs == periodNs) {
+        return true;
+    }
+    mDirectReports[channelHandle] = {
+            .channel = channel,
+            .periodNs = periodNs,
+            .lastSampleTimeNs = 0,
+    };
+    lock.unlock();
+    SensorScheduler::getInstance().wake();
+    return true;
+}
+
 OnChangeSensor::OnChangeSensor(ISensorsEventCallback* callback)
     : Sensor(callback), mPreviousEventSet(false) {}
 
@@ -185,8 +297,8 @@ void OnChangeSensor::activate(bool enable) {
     }
 }
 
-std::vector<Event> OnChangeSensor::readEvents() {
-    std::vector<Event> events = Sensor::readEvents();
+std::vector<Event> OnChangeSensor::readEvents(int64_t timestampNs) {
+    std::vector<Event> events = Sensor::readEvents(timestampNs);
     std::vector<Event> outputEvents;
 
     for (auto iter = events.begin(); iter != events.end(); ++iter) {
@@ -214,9 +326,10 @@ AccelSensor::AccelSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
     mSensorInfo.minDelayUs = 10 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags =
+            static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) | kDirectReportFlags;
 };
 
 void AccelSensor::readEventPayload(EventPayload& payload) {
@@ -243,7 +356,7 @@ PressureSensor::PressureSensor(int32_t sensorHandle, ISensorsEventCallback* call
     mSensorInfo.minDelayUs = 100 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
 };
@@ -266,7 +379,7 @@ MagnetometerSensor::MagnetometerSensor(int32_t sensorHandle, ISensorsEventCallba
     mSensorInfo.minDelayUs = 20 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
 };
@@ -341,9 +454,10 @@ GyroSensor::GyroSensor(int32_t sensorHandle, ISensorsEventCallback* callback) :
     mSensorInfo.minDelayUs = 10 * 1000;  // microseconds
     mSensorInfo.maxDelayUs = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
-    mSensorInfo.flags = static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION);
+    mSensorInfo.flags =
+            static_cast<uint32_t>(SensorInfo::SENSOR_FLAG_BITS_DATA_INJECTION) | kDirectReportFlags;
 };
 
 void GyroSensor::readEventPayload(EventPayload& payload) {
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/sensors/BnSensors.h>
+#include <android-base/unique_fd.h>
+
+#include <memory>
+#include <mutex>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace sensors {
+
+/**
+ * A direct report channel registered through ISensors::registerDirectChannel.
+ *
+ * The client's shared memory is mapped once and treated as a ring of
+ * DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH byte records in the SENSORS_EVENT
+ * format. Each record is filled in before its atomic counter is published, so a
+ * reader that observes a counter larger than the last one it consumed is
+ * guaranteed to see the complete record.
+ */
+class DirectChannel {
+  public:
+    using Event = ::aidl::android::hardware::sensors::Event;
+    using SharedMemInfo = ::aidl::android::hardware::sensors::ISensors::SharedMemInfo;
+
+    static constexpr size_t kEventSize =
+            static_cast<size_t>(ISensors::DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH);
+
+    // Maps the memory described by |mem|. Returns nullptr and sets |error| to
+    // EX_ILLEGAL_ARGUMENT or ISensors::ERROR_NO_MEMORY on failure.
+    static std::unique_ptr<DirectChannel> create(const SharedMemInfo& mem, int32_t* error);
+
+    ~DirectChannel();
+
+    // Appends |event| to the ring, tagged with |reportToken|.
+    void write(const Event& event, int32_t reportToken);
+
+    SharedMemInfo::SharedMemType getType() const { return mType; }
+
+  private:
+    DirectChannel(SharedMemInfo::SharedMemType type, ::android::base::unique_fd fd, uint8_t* base,
+                  size_t size);
+
+    const SharedMemInfo::SharedMemType mType;
+    const ::android::base::unique_fd mFd;
+    uint8_t* const mBase;
+    const size_t mSize;
+
+    // Protects the write position and counter; channels are shared by the
+    // threads of every sensor reporting into them.
+    std::mutex mWriteLock;
+    size_t mWriteOffset;
+    // The counter of the last record written. Starts at 1 and skips 0 on
+    // wrap-around, since 0 marks a record that has never been written.
+    uint32_t mCounter;
+};
+
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -14,10 +14,15 @@
  * limitations under the License.
  */
 
-#include <thread>
+#include <map>
+#include <mutex>
+#include <vector>
 
+#include <SensorScheduler.h>
 #include <aidl/android/hardware/sensors/BnSensors.h>
 
+#include "DirectChannel.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -31,9 +36,12 @@ class ISensorsEventCallback {
     virtual void postEvents(const std::vector<Event>& events, bool wakeup) = 0;
 };
 
-class Sensor {
+using ::android::hardware::sensors::common::SensorScheduler;
+
+class Sensor : public SensorScheduler::PolledSensor {
   public:
     using OperationMode = ::aidl::android::hardware::sensors::ISensors::OperationMode;
+    using RateLevel = ::aidl::android::hardware::sensors::ISensors::RateLevel;
     using Event = ::aidl::android::hardware::sensors::Event;
     using EventPayload = ::aidl::android::hardware::sensors::Event::EventPayload;
     using SensorInfo = ::aidl::android::hardware::sensors::SensorInfo;
@@ -45,7 +53,7 @@ class Sensor {
     virtual ~Sensor();
 
     const SensorInfo& getSensorInfo() const;
-    void batch(int64_t samplingPeriodNs);
+    void batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs);
     virtual void activate(bool enable);
     ndk::ScopedAStatus flush();
 
@@ -53,27 +61,49 @@ class Sensor {
     bool supportsDataInjection() const;
     ndk::ScopedAStatus injectEvent(const Event& event);
 
+    // Starts, retunes or, for RateLevel::STOP, stops direct reports of this sensor into the
+    // channel registered as |channelHandle|. Returns false if the sensor does not support the
+    // channel's memory type or the requested rate.
+    bool configDirectReport(int32_t channelHandle, const std::shared_ptr<DirectChannel>& channel,
+                            RateLevel rate);
+
+    // Samples the sensor if a sample is due at |nowNs|, batching it in the FIFO when a report
+    // latency is configured, and delivers the FIFO once it fills up or its oldest event reaches
+    // the latency. Direct reports are written here as well. Returns the time of the next
+    // deadline, or SensorScheduler::kNever if idle. Called by the SensorScheduler the owner
+    // registered the sensor with, or directly by tests.
+    int64_t poll(int64_t nowNs) override;
+
   protected:
-    void run();
-    virtual std::vector<Event> readEvents();
+    struct DirectReport {
+        std::shared_ptr<DirectChannel> channel;
+        int64_t periodNs;
+        int64_t lastSampleTimeNs;
+    };
+
+    void postFifoLocked();
+    // Returns the events sampled at |timestampNs|.
+    virtual std::vector<Event> readEvents(int64_t timestampNs);
     virtual void readEventPayload(EventPayload&) = 0;
-    static void startThread(Sensor* sensor);
 
     bool isWakeUpSensor();
 
     bool mIsEnabled;
     int64_t mSamplingPeriodNs;
+    int64_t mMaxReportLatencyNs;
     int64_t mLastSampleTimeNs;
     SensorInfo mSensorInfo;
 
-    std::atomic_bool mStopThread;
-    std::condition_variable mWaitCV;
+    // Events batched while a report latency is configured, bounded by fifoMaxEventCount.
+    std::vector<Event> mFifo;
     std::mutex mRunMutex;
-    std::thread mRunThread;
 
     ISensorsEventCallback* mCallback;
 
     OperationMode mMode;
+
+    // Active direct reports keyed by channel handle, guarded by mRunMutex.
+    std::map<int32_t, DirectReport> mDirectReports;
 };
 
 class OnChangeSensor : public Sensor {
@@ -83,7 +113,7 @@ class OnChangeSensor : public Sensor {
     virtual void activate(bool enable) override;
 
   protected:
-    virtual std::vector<Event> readEvents() override;
+    virtual std::vector<Event> readEvents(int64_t timestampNs) override;
 
   protected:
     Event mPreviousEvent;
@@ -41,6 +41,7 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     Sensors()
         : mEventQueueFlag(nullptr),
           mNextHandle(1),
+          mNextDirectChannelHandle(1),
           mOutstandingWakeUpEvents(0),
           mReadWakeLockQueueRun(false),
           mAutoReleaseWakeLockTime(0),
@@ -57,9 +58,15 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     }
 
     virtual ~Sensors() {
+        // Stop polling the sensors before they, and the queues they post to, are torn down.
+        for (const auto& sensor : mSensors) {
+            SensorScheduler::getInstance().removeSensor(sensor.second.get());
+        }
         deleteEventFlag();
         mReadWakeLockQueueRun = false;
-        mWakeLockThread.join();
+        if (mWakeLockThread.joinable()) {
+            mWakeLockThread.join();
+        }
     }
 
     ::ndk::ScopedAStatus activate(int32_t in_sensorHandle, bool in_enabled) override;
@@ -115,6 +122,8 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
         std::shared_ptr<SensorType> sensor =
                 std::make_shared<SensorType>(mNextHandle++ /* sensorHandle */, this /* callback */);
         mSensors[sensor->getSensorInfo().sensorHandle] = sensor;
+        // Only poll the sensor once it is fully constructed.
+        SensorScheduler::getInstance().addSensor(sensor.get());
     }
 
     // Utility function to delete the Event Flag
@@ -194,6 +203,12 @@ class Sensors : public BnSensors, public ISensorsEventCallback {
     std::map<int32_t, std::shared_ptr<Sensor>> mSensors;
     // The next available sensor handle.
     int32_t mNextHandle;
+    // Registered direct channels keyed by channel handle.
+    std::map<int32_t, std::shared_ptr<DirectChannel>> mDirectChannels;
+    // The next available direct channel handle.
+    int32_t mNextDirectChannelHandle;
+    // Lock to protect the direct channels.
+    std::mutex mDirectChannelLock;
     // Lock to protect writes to the FMQs.
     std::mutex mWriteLock;
     // Lock to protect acquiring and releasing the wake lock
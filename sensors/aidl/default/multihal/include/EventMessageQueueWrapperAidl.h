@@ -31,6 +31,10 @@ namespace implementation {
 class EventMessageQueueWrapperAidl
     : public ::android::hardware::sensors::V2_1::implementation::EventMessageQueueWrapperBase {
   public:
+    using EventMessageQueue =
+            ::android::AidlMessageQueue<::aidl::android::hardware::sensors::Event,
+                                        ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>;
+
     EventMessageQueueWrapperAidl(
             std::unique_ptr<::android::AidlMessageQueue<
                     ::aidl::android::hardware::sensors::Event,
@@ -80,6 +84,20 @@ class EventMessageQueueWrapperAidl
                                      writeNotification, timeOutNanos, evFlag);
     }
 
+    size_t writeAvailable(const ::android::hardware::sensors::V2_1::Event* events,
+                          size_t count) override {
+        // Events are converted in place in the queue, so no intermediate buffer is needed.
+        size_t numToWrite = std::min(count, mQueue->availableToWrite());
+        EventMessageQueue::MemTransaction tx;
+        if (numToWrite == 0 || !mQueue->beginWrite(numToWrite, &tx)) {
+            return 0;
+        }
+        for (size_t i = 0; i < numToWrite; ++i) {
+            convertToAidlEvent(events[i], tx.getSlot(i));
+        }
+        return mQueue->commitWrite(numToWrite) ? numToWrite : 0;
+    }
+
     size_t getQuantumCount() override { return mQueue->getQuantumCount(); }
 
   private:
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+
+#include "sensors-impl/Sensor.h"
+#include "sensors-impl/Sensors.h"
+
+using ::aidl::android::hardware::sensors::AccelSensor;
+using ::aidl::android::hardware::sensors::Event;
+using ::aidl::android::hardware::sensors::ISensorsEventCallback;
+using ::aidl::android::hardware::sensors::LightSensor;
+using ::aidl::android::hardware::sensors::SensorInfo;
+using ::aidl::android::hardware::sensors::Sensors;
+using ::aidl::android::hardware::sensors::SensorScheduler;
+using ::aidl::android::hardware::sensors::SensorType;
+
+namespace {
+
+constexpr int64_t kMillisecondsInNanoseconds = 1000 * 1000;
+constexpr int64_t kSamplingPeriodNs = 10 * kMillisecondsInNanoseconds;
+// The sensors below are not registered with the SensorScheduler; the tests drive them by calling
+// poll() with the time of a fake clock starting here.
+constexpr int64_t kStartTimeNs = 1000 * kMillisecondsInNanoseconds;
+// The framework reads at most this many events at a time, see MAX_RECEIVE_BUFFER_EVENT_COUNT.
+constexpr int32_t kMaxReceiveBufferEventCount = 256;
+
+class EventRecorder : public ISensorsEventCallback {
+  public:
+    void postEvents(const std::vector<Event>& events, bool /* wakeup */) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mBatchSizes.push_back(events.size());
+        mEvents.insert(mEvents.end(), events.begin(), events.end());
+    }
+
+    std::vector<size_t> getBatchSizes() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mBatchSizes;
+    }
+
+    std::vector<Event> getEvents() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mEvents;
+    }
+
+  private:
+    std::mutex mLock;
+    std::vector<size_t> mBatchSizes;
+    std::vector<Event> mEvents;
+};
+
+}  // namespace
+
+TEST(BatchingTest, ReportsImmediatelyWithoutLatency) {
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    sensor.batch(kSamplingPeriodNs, 0 /* maxReportLatencyNs */);
+    sensor.activate(true);
+
+    int64_t now = kStartTimeNs;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(now + kSamplingPeriodNs, sensor.poll(now));
+        EXPECT_EQ(static_cast<size_t>(i + 1), recorder.getEvents().size());
+        now += kSamplingPeriodNs;
+    }
+    sensor.activate(false);
+
+    EXPECT_EQ(std::vector<size_t>(3, 1u), recorder.getBatchSizes());
+    EXPECT_EQ(SensorScheduler::kNever, sensor.poll(now));
+}
+
+TEST(BatchingTest, BatchesUntilLatencyExpires) {
+    constexpr int64_t kLatencyNs = 100 * kMillisecondsInNanoseconds;
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    sensor.batch(kSamplingPeriodNs, kLatencyNs);
+    sensor.activate(true);
+
+    int64_t now = kStartTimeNs;
+    for (; now < kStartTimeNs + kLatencyNs; now += kSamplingPeriodNs) {
+        EXPECT_EQ(now + kSamplingPeriodNs, sensor.poll(now));
+    }
+    EXPECT_TRUE(recorder.getEvents().empty());
+
+    // The oldest event reaches the latency along with the 11th sample.
+    sensor.poll(now);
+    EXPECT_EQ(std::vector<size_t>{11}, recorder.getBatchSizes());
+    sensor.activate(false);
+
+    std::vector<Event> events = recorder.getEvents();
+    for (size_t i = 0; i < events.size(); i++) {
+        EXPECT_EQ(kStartTimeNs + static_cast<int64_t>(i) * kSamplingPeriodNs, events[i].timestamp);
+    }
+}
+
+TEST(BatchingTest, PollWakesUpForLatency) {
+    constexpr int64_t kLatencyNs = 15 * kMillisecondsInNanoseconds;
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    sensor.batch(kSamplingPeriodNs, kLatencyNs);
+    sensor.activate(true);
+
+    EXPECT_EQ(kStartTimeNs + kSamplingPeriodNs, sensor.poll(kStartTimeNs));
+    // The next sample is due after the batched one must be delivered.
+    EXPECT_EQ(kStartTimeNs + kLatencyNs, sensor.poll(kStartTimeNs + kSamplingPeriodNs));
+    sensor.poll(kStartTimeNs + kLatencyNs);
+    EXPECT_EQ(std::vector<size_t>{2}, recorder.getBatchSizes());
+}
+
+TEST(BatchingTest, FullFifoIsPostedInOneWrite) {
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    const int32_t fifoMaxEventCount = sensor.getSensorInfo().fifoMaxEventCount;
+    ASSERT_GT(fifoMaxEventCount, 0);
+    sensor.batch(kSamplingPeriodNs, 1000 * 1000 * kMillisecondsInNanoseconds);
+    sensor.activate(true);
+
+    int64_t now = kStartTimeNs;
+    for (int32_t i = 0; i < fifoMaxEventCount - 1; i++, now += kSamplingPeriodNs) {
+        sensor.poll(now);
+    }
+    EXPECT_TRUE(recorder.getEvents().empty());
+
+    sensor.poll(now);
+    std::vector<size_t> batchSizes = recorder.getBatchSizes();
+    ASSERT_EQ(1u, batchSizes.size());
+    EXPECT_EQ(static_cast<size_t>(fifoMaxEventCount), batchSizes[0]);
+    EXPECT_LE(fifoMaxEventCount, kMaxReceiveBufferEventCount);
+}
+
+TEST(BatchingTest, FifosFitInEventQueueTogether) {
+    std::shared_ptr<Sensors> sensors = ndk::SharedRefBase::make<Sensors>();
+    std::vector<SensorInfo> sensorList;
+    ASSERT_TRUE(sensors->getSensorsList(&sensorList).isOk());
+
+    // Every FIFO may be posted at once, each along with a flush complete event.
+    int32_t total = 0;
+    for (const SensorInfo& info : sensorList) {
+        if (info.fifoMaxEventCount > 0) {
+            total += info.fifoMaxEventCount + 1;
+        }
+    }
+    EXPECT_GT(total, 0);
+    EXPECT_LE(total, kMaxReceiveBufferEventCount);
+}
+
+TEST(BatchingTest, FlushDeliversFifoBeforeFlushComplete) {
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    sensor.batch(kSamplingPeriodNs, 10 * 1000 * kMillisecondsInNanoseconds);
+    sensor.activate(true);
+    for (int i = 0; i < 5; i++) {
+        sensor.poll(kStartTimeNs + i * kSamplingPeriodNs);
+    }
+    EXPECT_TRUE(recorder.getEvents().empty());
+    ASSERT_TRUE(sensor.flush().isOk());
+
+    std::vector<Event> events = recorder.getEvents();
+    ASSERT_EQ(6u, events.size());
+    EXPECT_EQ(SensorType::META_DATA, events.back().sensorType);
+    for (size_t i = 0; i + 1 < events.size(); i++) {
+        EXPECT_EQ(SensorType::ACCELEROMETER, events[i].sensorType);
+    }
+}
+
+TEST(BatchingTest, DeactivationDeliversFifo) {
+    EventRecorder recorder;
+    AccelSensor sensor(1 /* sensorHandle */, &recorder);
+    sensor.batch(kSamplingPeriodNs, 10 * 1000 * kMillisecondsInNanoseconds);
+    sensor.activate(true);
+    for (int i = 0; i < 3; i++) {
+        sensor.poll(kStartTimeNs + i * kSamplingPeriodNs);
+    }
+    EXPECT_TRUE(recorder.getEvents().empty());
+
+    sensor.activate(false);
+    EXPECT_EQ(std::vector<size_t>{3}, recorder.getBatchSizes());
+}
+
+TEST(BatchingTest, IgnoresLatencyWithoutFifo) {
+    EventRecorder recorder;
+    LightSensor sensor(1 /* sensorHandle */, &recorder);
+    ASSERT_EQ(0, sensor.getSensorInfo().fifoMaxEventCount);
+    sensor.batch(200 * kMillisecondsInNanoseconds, 10 * 1000 * kMillisecondsInNanoseconds);
+    sensor.activate(true);
+    sensor.poll(kStartTimeNs);
+
+    // On-change sensors report their first sample right away.
+    EXPECT_EQ(1u, recorder.getEvents().size());
+}
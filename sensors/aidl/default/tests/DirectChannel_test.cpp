@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android-base/unique_fd.h>
+#include <cutils/ashmem.h>
+#include <sys/mman.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "sensors-impl/DirectChannel.h"
+#include "sensors-impl/Sensor.h"
+#include "sensors-impl/Sensors.h"
+
+using ::aidl::android::hardware::common::NativeHandle;
+using ::aidl::android::hardware::sensors::AccelSensor;
+using ::aidl::android::hardware::sensors::DirectChannel;
+using ::aidl::android::hardware::sensors::Event;
+using ::aidl::android::hardware::sensors::ISensors;
+using ::aidl::android::hardware::sensors::ISensorsEventCallback;
+using ::aidl::android::hardware::sensors::SensorInfo;
+using ::aidl::android::hardware::sensors::Sensors;
+using ::aidl::android::hardware::sensors::SensorStatus;
+using ::aidl::android::hardware::sensors::SensorType;
+using ::android::base::unique_fd;
+
+namespace {
+
+constexpr size_t kEventSize = DirectChannel::kEventSize;
+constexpr int64_t kMillisecondsInNanoseconds = 1000 * 1000;
+
+struct DirectReportRecord {
+    int32_t size;
+    int32_t token;
+    int32_t type;
+    uint32_t counter;
+    int64_t timestamp;
+    float data[16];
+};
+
+// Maps an ashmem region the way a direct channel client does and parses the records written into
+// it, following the atomic counter from the start of the ring.
+class AshmemReader {
+  public:
+    explicit AshmemReader(size_t size)
+        : mFd(ashmem_create_region("DirectChannelTest", size)), mSize(size) {
+        mBase = static_cast<uint8_t*>(
+                mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd.get(), 0));
+    }
+
+    ~AshmemReader() {
+        if (mBase != MAP_FAILED) {
+            munmap(mBase, mSize);
+        }
+    }
+
+    bool isValid() const { return mFd.get() >= 0 && mBase != MAP_FAILED; }
+
+    ISensors::SharedMemInfo getSharedMemInfo() const {
+        NativeHandle handle;
+        handle.fds.emplace_back(dup(mFd.get()));
+        return {
+                .type = ISensors::SharedMemInfo::SharedMemType::ASHMEM,
+                .format = ISensors::SharedMemInfo::SharedMemFormat::SENSORS_EVENT,
+                .size = static_cast<int32_t>(mSize),
+                .memoryHandle = std::move(handle),
+        };
+    }
+
+    DirectReportRecord readRecord(size_t index) const {
+        DirectReportRecord record;
+        const uint8_t* src = mBase + index * kEventSize;
+        memcpy(&record.size, src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_FIELD, 4);
+        memcpy(&record.token, src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_REPORT_TOKEN,
+               4);
+        memcpy(&record.type, src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_SENSOR_TYPE, 4);
+        record.counter = __atomic_load_n(
+                reinterpret_cast<const uint32_t*>(
+                        src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_ATOMIC_COUNTER),
+                __ATOMIC_ACQUIRE);
+        memcpy(&record.timestamp, src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_TIMESTAMP,
+               8);
+        memcpy(record.data, src + ISensors::DIRECT_REPORT_SENSOR_EVENT_OFFSET_SIZE_DATA,
+               sizeof(record.data));
+        return record;
+    }
+
+    // Returns the records with consecutive counters starting at the beginning of the ring.
+    std::vector<DirectReportRecord> readRecords() const {
+        std::vector<DirectReportRecord> records;
+        uint32_t lastCounter = 0;
+        for (size_t i = 0; i < mSize / kEventSize; i++) {
+            DirectReportRecord record = readRecord(i);
+            if (record.counter != lastCounter + 1) {
+                break;
+            }
+            records.push_back(record);
+            lastCounter = record.counter;
+        }
+        return records;
+    }
+
+    void fill(uint8_t value) { memset(mBase, value, mSize); }
+
+  private:
+    unique_fd mFd;
+    size_t mSize;
+    uint8_t* mBase;
+};
+
+class NullEventCallback : public ISensorsEventCallback {
+  public:
+    void postEvents(const std::vector<Event>& /* events */, bool /* wakeup */) override {}
+};
+
+Event makeAccelEvent(int64_t timestamp, float x) {
+    Event event;
+    event.sensorHandle = 1;
+    event.sensorType = SensorType::ACCELEROMETER;
+    event.timestamp = timestamp;
+    event.payload.set<Event::EventPayload::Tag::vec3>(Event::EventPayload::Vec3{
+            .x = x, .y = 2.0f, .z = 3.0f, .status = SensorStatus::ACCURACY_HIGH});
+    return event;
+}
+
+}  // namespace
+
+TEST(DirectChannelTest, RejectsInvalidMemInfo) {
+    AshmemReader reader(kEventSize * 4);
+    ASSERT_TRUE(reader.isValid());
+    int32_t error = 0;
+
+    ISensors::SharedMemInfo tooSmall = reader.getSharedMemInfo();
+    tooSmall.size = kEventSize - 1;
+    EXPECT_EQ(nullptr, DirectChannel::create(tooSmall, &error));
+    EXPECT_EQ(EX_ILLEGAL_ARGUMENT, error);
+
+    ISensors::SharedMemInfo noHandle = reader.getSharedMemInfo();
+    noHandle.memoryHandle.fds.clear();
+    EXPECT_EQ(nullptr, DirectChannel::create(noHandle, &error));
+    EXPECT_EQ(EX_ILLEGAL_ARGUMENT, error);
+}
+
+TEST(DirectChannelTest, ClearsMemoryOnRegistration) {
+    AshmemReader reader(kEventSize * 4);
+    ASSERT_TRUE(reader.isValid());
+    reader.fill(0xff);
+
+    int32_t error;
+    auto channel = DirectChannel::create(reader.getSharedMemInfo(), &error);
+    ASSERT_NE(nullptr, channel);
+    EXPECT_EQ(0u, reader.readRecord(0).counter);
+    EXPECT_TRUE(reader.readRecords().empty());
+}
+
+TEST(DirectChannelTest, WritesDirectReportFormat) {
+    AshmemReader reader(kEventSize * 4);
+    ASSERT_TRUE(reader.isValid());
+    int32_t error;
+    auto channel = DirectChannel::create(reader.getSharedMemInfo(), &error);
+    ASSERT_NE(nullptr, channel);
+
+    channel->write(makeAccelEvent(100, 1.0f), 7 /* reportToken */);
+    channel->write(makeAccelEvent(200, 4.0f), 7 /* reportToken */);
+
+    std::vector<DirectReportRecord> records = reader.readRecords();
+    ASSERT_EQ(2u, records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(ISensors::DIRECT_REPORT_SENSOR_EVENT_TOTAL_LENGTH, records[i].size);
+        EXPECT_EQ(7, records[i].token);
+        EXPECT_EQ(static_cast<int32_t>(SensorType::ACCELEROMETER), records[i].type);
+        EXPECT_EQ(i + 1, records[i].counter);
+    }
+    EXPECT_EQ(100, records[0].timestamp);
+    EXPECT_EQ(200, records[1].timestamp);
+    EXPECT_EQ(1.0f, records[0].data[0]);
+    EXPECT_EQ(4.0f, records[1].data[0]);
+    EXPECT_EQ(2.0f, records[1].data[1]);
+    EXPECT_EQ(3.0f, records[1].data[2]);
+}
+
+TEST(DirectChannelTest, WrapsAroundRing) {
+    // The trailing partial record must never be written.
+    AshmemReader reader(kEventSize * 3 + kEventSize / 2);
+    ASSERT_TRUE(reader.isValid());
+    int32_t error;
+    auto channel = DirectChannel::create(reader.getSharedMemInfo(), &error);
+    ASSERT_NE(nullptr, channel);
+
+    for (int64_t i = 1; i <= 5; i++) {
+        channel->write(makeAccelEvent(i, 0.0f), 1 /* reportToken */);
+    }
+
+    // Records 4 and 5 overwrote slots 0 and 1.
+    EXPECT_EQ(4u, reader.readRecord(0).counter);
+    EXPECT_EQ(4, reader.readRecord(0).timestamp);
+    EXPECT_EQ(5u, reader.readRecord(1).counter);
+    EXPECT_EQ(3u, reader.readRecord(2).counter);
+}
+
+TEST(DirectChannelTest, SensorsReportIntoChannel) {
+    std::shared_ptr<Sensors> sensors = ndk::SharedRefBase::make<Sensors>();
+    std::vector<SensorInfo> sensorList;
+    ASSERT_TRUE(sensors->getSensorsList(&sensorList).isOk());
+
+    const SensorInfo* accel = nullptr;
+    for (const SensorInfo& info : sensorList) {
+        if (info.type == SensorType::ACCELEROMETER) {
+            accel = &info;
+        }
+    }
+    ASSERT_NE(nullptr, accel);
+    ASSERT_TRUE(accel->flags & SensorInfo::SENSOR_FLAG_BITS_DIRECT_CHANNEL_ASHMEM);
+
+    AshmemReader reader(kEventSize * 256);
+    ASSERT_TRUE(reader.isValid());
+    int32_t channelHandle = 0;
+    ASSERT_TRUE(sensors->registerDirectChannel(reader.getSharedMemInfo(), &channelHandle).isOk());
+    EXPECT_GT(channelHandle, 0);
+
+    // The advertised rate level must not be faster than minDelayUs allows.
+    int32_t maxRate = (accel->flags & SensorInfo::SENSOR_FLAG_BITS_MASK_DIRECT_REPORT) >>
+                      SensorInfo::SENSOR_FLAG_SHIFT_DIRECT_REPORT;
+    EXPECT_EQ(static_cast<int32_t>(ISensors::RateLevel::NORMAL), maxRate);
+    EXPECT_LE(accel->minDelayUs, 1000 * 1000 / 50);
+
+    int32_t reportToken = 0;
+    EXPECT_FALSE(sensors->configDirectReport(accel->sensorHandle, channelHandle,
+                                             ISensors::RateLevel::FAST, &reportToken)
+                         .isOk());
+    ASSERT_TRUE(sensors->configDirectReport(accel->sensorHandle, channelHandle,
+                                            ISensors::RateLevel::NORMAL, &reportToken)
+                        .isOk());
+
+    // Wait, for at most a second, until the SensorScheduler has written a few records.
+    std::vector<DirectReportRecord> records;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((records = reader.readRecords()).size() < 3 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(sensors->configDirectReport(-1 /* sensorHandle */, channelHandle,
+                                            ISensors::RateLevel::STOP, &reportToken)
+                        .isOk());
+    ASSERT_GE(records.size(), 3u);
+    int64_t lastTimestamp = 0;
+    for (const DirectReportRecord& record : records) {
+        EXPECT_EQ(accel->sensorHandle, record.token);
+        EXPECT_EQ(static_cast<int32_t>(SensorType::ACCELEROMETER), record.type);
+        EXPECT_GT(record.timestamp, lastTimestamp);
+        lastTimestamp = record.timestamp;
+    }
+
+
+    EXPECT_TRUE(sensors->unregisterDirectChannel(channelHandle).isOk());
+    EXPECT_FALSE(sensors->configDirectReport(accel->sensorHandle, channelHandle,
+                                             ISensors::RateLevel::NORMAL, &reportToken)
+                         .isOk());
+}
+
+TEST(DirectChannelTest, SensorReportsAtRateLevelPeriod) {
+    AshmemReader reader(kEventSize * 16);
+    ASSERT_TRUE(reader.isValid());
+    int32_t error;
+    std::shared_ptr<DirectChannel> channel = DirectChannel::create(reader.getSharedMemInfo(), &error);
+    ASSERT_NE(nullptr, channel);
+
+    // The sensor is not registered with the SensorScheduler; poll() is driven with a fake clock.
+    NullEventCallback callback;
+    AccelSensor sensor(1 /* sensorHandle */, &callback);
+    ASSERT_TRUE(sensor.configDirectReport(1 /* channelHandle */, channel,
+                                          ISensors::RateLevel::NORMAL));
+
+    // RateLevel::NORMAL is 50Hz.
+    constexpr int64_t kPeriodNs = 20 * kMillisecondsInNanoseconds;
+    int64_t now = 1000 * kMillisecondsInNanoseconds;
+    EXPECT_EQ(now + kPeriodNs, sensor.poll(now));
+    EXPECT_EQ(now + kPeriodNs, sensor.poll(now + kPeriodNs / 2));
+    EXPECT_EQ(now + 2 * kPeriodNs, sensor.poll(now + kPeriodNs));
+
+    std::vector<DirectReportRecord> records = reader.readRecords();
+    ASSERT_EQ(2u, records.size());
+    EXPECT_EQ(1, records[0].token);
+    EXPECT_EQ(now, records[0].timestamp);
+    EXPECT_EQ(now + kPeriodNs, records[1].timestamp);
+
+    // No more records are written once the report is stopped.
+    ASSERT_TRUE(sensor.configDirectReport(1 /* channelHandle */, channel,
+                                          ISensors::RateLevel::STOP));
+    sensor.poll(now + 2 * kPeriodNs);
+    EXPECT_EQ(2u, reader.readRecords().size());
+}
@@ -16,8 +16,7 @@
 
 #include "Sensor.h"
 
-#include <utils/SystemClock.h>
-
+#include <algorithm>
 #include <cmath>
 
 namespace android {
@@ -36,60 +35,79 @@ using ::android::hardware::sensors::V2_1::Event;
 using ::android::hardware::sensors::V2_1::SensorInfo;
 using ::android::hardware::sensors::V2_1::SensorType;
 
+// Continuous sensors buffer up to this many events while batching. Each FIFO is posted in a
+// single write, so the FIFOs of all four batching sensors must fit together in an event queue of
+// MAX_RECEIVE_BUFFER_EVENT_COUNT (256) events.
+static constexpr uint32_t kFifoMaxEventCount = 60;
+
 Sensor::Sensor(ISensorsEventCallback* callback)
     : mIsEnabled(false),
       mSamplingPeriodNs(0),
+      mMaxReportLatencyNs(0),
       mLastSampleTimeNs(0),
-      mStopThread(false),
       mCallback(callback),
-      mMode(OperationMode::NORMAL) {
-    mRunThread = std::thread(startThread, this);
-}
+      mMode(OperationMode::NORMAL) {}
 
-Sensor::~Sensor() {
-    std::unique_lock<std::mutex> lock(mRunMutex);
-    mStopThread = true;
-    mIsEnabled = false;
-    mWaitCV.notify_all();
-    lock.release();
-    mRunThread.join();
-}
+Sensor::~Sensor() {}
 
 const SensorInfo& Sensor::getSensorInfo() const {
     return mSensorInfo;
 }
 
-void Sensor::batch(int64_t samplingPeriodNs) {
+void Sensor::batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs) {
     if (samplingPeriodNs < mSensorInfo.minDelay * 1000LL) {
         samplingPeriodNs = mSensorInfo.minDelay * 1000LL;
     } else if (samplingPeriodNs > mSensorInfo.maxDelay * 1000LL) {
         samplingPeriodNs = mSensorInfo.maxDelay * 1000LL;
     }
+    // Sensors without a FIFO report every event as soon as it is sampled.
+    if (mSensorInfo.fifoMaxEventCount == 0 || maxReportLatencyNs < 0) {
+        maxReportLatencyNs = 0;
+    }
 
-    if (mSamplingPeriodNs != samplingPeriodNs) {
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mSamplingPeriodNs == samplingPeriodNs && mMaxReportLatencyNs == maxReportLatencyNs) {
+            return;
+        }
         mSamplingPeriodNs = samplingPeriodNs;
-        // Wake up the 'run' thread to check if a new event should be generated now
-        mWaitCV.notify_all();
+        mMaxReportLatencyNs = maxReportLatencyNs;
+        if (mMaxReportLatencyNs == 0) {
+            postFifoLocked();
+        } else {
+            mFifo.reserve(mSensorInfo.fifoMaxEventCount);
+        }
     }
+    // Wake up the scheduler to check if a new event should be generated now
+    SensorScheduler::getInstance().wake();
 }
 
 void Sensor::activate(bool enable) {
-    if (mIsEnabled != enable) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mIsEnabled == enable) {
+            return;
+        }
         mIsEnabled = enable;
-        mWaitCV.notify_all();
+        if (!enable) {
+            postFifoLocked();
+        }
     }
+    SensorScheduler::getInstance().wake();
 }
 
 Result Sensor::flush() {
+    std::lock_guard<std::mutex> lock(mRunMutex);
     // Only generate a flush complete event if the sensor is enabled and if the sensor is not a
     // one-shot sensor.
     if (!mIsEnabled || (mSensorInfo.flags & static_cast<uint32_t>(SensorFlagBits::ONE_SHOT_MODE))) {
         return Result::BAD_VALUE;
     }
 
-    // Note: If a sensor supports batching, write all of the currently batched events for the sensor
-    // to the Event FMQ prior to writing the flush complete event.
+    // Write all of the currently batched events for the sensor to the Event FMQ prior to writing
+    // the flush complete event.
+    postFifoLocked();
+
     Event ev;
     ev.sensorHandle = mSensorInfo.sensorHandle;
     ev.sensorType = SensorType::META_DATA;
@@ -100,46 +118,57 @@ Result Sensor::flush() {
     return Result::OK;
 }
 
-void Sensor::startThread(Sensor* sensor) {
-    sensor->run();
-}
-
-void Sensor::run() {
-    std::unique_lock<std::mutex> runLock(mRunMutex);
-    constexpr int64_t kNanosecondsInSeconds = 1000 * 1000 * 1000;
+int64_t Sensor::poll(int64_t nowNs) {
+    std::lock_guard<std::mutex> lock(mRunMutex);
+    if (!mIsEnabled || mMode != OperationMode::NORMAL) {
+        return SensorScheduler::kNever;
+    }
 
-    while (!mStopThread) {
-        if (!mIsEnabled || mMode == OperationMode::DATA_INJECTION) {
-            mWaitCV.wait(runLock, [&] {
-                return ((mIsEnabled && mMode == OperationMode::NORMAL) || mStopThread);
-            });
+    int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
+    if (nowNs >= nextSampleTime) {
+        mLastSampleTimeNs = nowNs;
+        nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
+        std::vector<Event> events = readEvents(nowNs);
+        if (mMaxReportLatencyNs == 0) {
+            if (!events.empty()) {
+                mCallback->postEvents(events, isWakeUpSensor());
+            }
         } else {
-            timespec curTime;
-            clock_gettime(CLOCK_BOOTTIME, &curTime);
-            int64_t now = (curTime.tv_sec * kNanosecondsInSeconds) + curTime.tv_nsec;
-            int64_t nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-
-            if (now >= nextSampleTime) {
-                mLastSampleTimeNs = now;
-                nextSampleTime = mLastSampleTimeNs + mSamplingPeriodNs;
-                mCallback->postEvents(readEvents(), isWakeUpSensor());
+            mFifo.insert(mFifo.end(), events.begin(), events.end());
+            if (mFifo.size() >= mSensorInfo.fifoMaxEventCount) {
+                postFifoLocked();
             }
-
-            mWaitCV.wait_for(runLock, std::chrono::nanoseconds(nextSampleTime - now));
         }
     }
+
+    if (mFifo.empty()) {
+        return nextSampleTime;
+    }
+    int64_t reportTime = mFifo.front().timestamp + mMaxReportLatencyNs;
+    if (nowNs >= reportTime) {
+        postFifoLocked();
+        return nextSampleTime;
+    }
+    return std::min(nextSampleTime, reportTime);
+}
+
+void Sensor::postFifoLocked() {
+    if (!mFifo.empty()) {
+        mCallback->postEvents(mFifo, isWakeUpSensor());
+        mFifo.clear();
+    }
 }
 
 bool Sensor::isWakeUpSensor() {
     return mSensorInfo.flags & static_cast<uint32_t>(SensorFlagBits::WAKE_UP);
 }
 
-std::vector<Event> Sensor::readEvents() {
+std::vector<Event> Sensor::readEvents(int64_t timestampNs) {
     std::vector<Event> events;
     Event event;
     event.sensorHandle = mSensorInfo.sensorHandle;
     event.sensorType = mSensorInfo.type;
-    event.timestamp = ::android::elapsedRealtimeNano();
+    event.timestamp = timestampNs;
     memset(&event.u, 0, sizeof(event.u));
     readEventPayload(event.u);
     events.push_back(event);
@@ -147,11 +176,14 @@ std::vector<Event> Sensor::readEvents() {
 }
 
 void Sensor::setOperationMode(OperationMode mode) {
-    if (mMode != mode) {
-        std::unique_lock<std::mutex> lock(mRunMutex);
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        if (mMode == mode) {
+            return;
+        }
         mMode = mode;
-        mWaitCV.notify_all();
     }
+    SensorScheduler::getInstance().wake();
 }
 
 bool Sensor::supportsDataInjection() const {
@@ -183,8 +215,8 @@ void OnChangeSensor::activate(bool enable) {
     }
 }
 
-std::vector<Event> OnChangeSensor::readEvents() {
-    std::vector<Event> events = Sensor::readEvents();
+std::vector<Event> OnChangeSensor::readEvents(int64_t timestampNs) {
+    std::vector<Event> events = Sensor::readEvents(timestampNs);
     std::vector<Event> outputEvents;
 
     for (auto iter = events.begin(); iter != events.end(); ++iter) {
@@ -211,7 +243,7 @@ AccelSensor::AccelSensor(int32_t sensorHandle, ISensorsEventCallback* callback)
     mSensorInfo.minDelay = 10 * 1000;  // microseconds
     mSensorInfo.maxDelay = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = static_cast<uint32_t>(SensorFlagBits::DATA_INJECTION);
 };
@@ -237,7 +269,7 @@ PressureSensor::PressureSensor(int32_t sensorHandle, ISensorsEventCallback* call
     mSensorInfo.minDelay = 100 * 1000;  // microseconds
     mSensorInfo.maxDelay = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
 };
@@ -260,7 +292,7 @@ MagnetometerSensor::MagnetometerSensor(int32_t sensorHandle, ISensorsEventCallba
     mSensorInfo.minDelay = 20 * 1000;  // microseconds
     mSensorInfo.maxDelay = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
 };
@@ -317,7 +349,7 @@ GyroSensor::GyroSensor(int32_t sensorHandle, ISensorsEventCallback* callback) :
     mSensorInfo.minDelay = 10 * 1000;  // microseconds
     mSensorInfo.maxDelay = kDefaultMaxDelayUs;
     mSensorInfo.fifoReservedEventCount = 0;
-    mSensorInfo.fifoMaxEventCount = 0;
+    mSensorInfo.fifoMaxEventCount = kFifoMaxEventCount;
     mSensorInfo.requiredPermission = "";
     mSensorInfo.flags = 0;
 };
@@ -17,13 +17,12 @@
 #ifndef ANDROID_HARDWARE_SENSORS_V2_X_SENSOR_H
 #define ANDROID_HARDWARE_SENSORS_V2_X_SENSOR_H
 
+#include <SensorScheduler.h>
 #include <android/hardware/sensors/1.0/types.h>
 #include <android/hardware/sensors/2.1/types.h>
 
-#include <condition_variable>
 #include <memory>
 #include <mutex>
-#include <thread>
 #include <vector>
 
 namespace android {
@@ -42,7 +41,9 @@ class ISensorsEventCallback {
     virtual void postEvents(const std::vector<Event>& events, bool wakeup) = 0;
 };
 
-class Sensor {
+using ::android::hardware::sensors::common::SensorScheduler;
+
+class Sensor : public SensorScheduler::PolledSensor {
   public:
     using OperationMode = ::android::hardware::sensors::V1_0::OperationMode;
     using Result = ::android::hardware::sensors::V1_0::Result;
@@ -55,7 +56,7 @@ class Sensor {
     virtual ~Sensor();
 
     const SensorInfo& getSensorInfo() const;
-    void batch(int64_t samplingPeriodNs);
+    void batch(int64_t samplingPeriodNs, int64_t maxReportLatencyNs);
     virtual void activate(bool enable);
     Result flush();
 
@@ -63,23 +64,29 @@ class Sensor {
     bool supportsDataInjection() const;
     Result injectEvent(const Event& event);
 
+    // Samples the sensor if a sample is due at |nowNs|, batching it in the FIFO when a report
+    // latency is configured, and delivers the FIFO once it fills up or its oldest event reaches
+    // the latency. Returns the time of the next deadline, or SensorScheduler::kNever if idle.
+    // Called by the SensorScheduler the owner registered the sensor with.
+    int64_t poll(int64_t nowNs) override;
+
   protected:
-    void run();
-    virtual std::vector<Event> readEvents();
+    void postFifoLocked();
+    // Returns the events sampled at |timestampNs|.
+    virtual std::vector<Event> readEvents(int64_t timestampNs);
     virtual void readEventPayload(EventPayload&) {}
-    static void startThread(Sensor* sensor);
 
     bool isWakeUpSensor();
 
     bool mIsEnabled;
     int64_t mSamplingPeriodNs;
+    int64_t mMaxReportLatencyNs;
     int64_t mLastSampleTimeNs;
     SensorInfo mSensorInfo;
 
-    std::atomic_bool mStopThread;
-    std::condition_variable mWaitCV;
+    // Events batched while a report latency is configured, bounded by fifoMaxEventCount.
+    std::vector<Event> mFifo;
     std::mutex mRunMutex;
-    std::thread mRunThread;
 
     ISensorsEventCallback* mCallback;
 
@@ -93,7 +100,7 @@ class OnChangeSensor : public Sensor {
     virtual void activate(bool enable) override;
 
   protected:
-    virtual std::vector<Event> readEvents() override;
+    virtual std::vector<Event> readEvents(int64_t timestampNs) override;
 
   protected:
     Event mPreviousEvent;
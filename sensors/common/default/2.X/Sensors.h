@@ -72,9 +72,15 @@ struct Sensors : public ISensorsInterface, public ISensorsEventCallback {
     }
 
     virtual ~Sensors() {
+        // Stop polling the sensors before they, and the queues they post to, are torn down.
+        for (const auto& sensor : mSensors) {
+            SensorScheduler::getInstance().removeSensor(sensor.second.get());
+        }
         deleteEventFlag();
         mReadWakeLockQueueRun = false;
-        mWakeLockThread.join();
+        if (mWakeLockThread.joinable()) {
+            mWakeLockThread.join();
+        }
     }
 
     // Methods from ::android::hardware::sensors::V2_0::ISensors follow.
@@ -154,10 +160,10 @@ struct Sensors : public ISensorsInterface, public ISensorsEventCallback {
     }
 
     Return<Result> batch(int32_t sensorHandle, int64_t samplingPeriodNs,
-                         int64_t /* maxReportLatencyNs */) override {
+                         int64_t maxReportLatencyNs) override {
         auto sensor = mSensors.find(sensorHandle);
         if (sensor != mSensors.end()) {
-            sensor->second->batch(samplingPeriodNs);
+            sensor->second->batch(samplingPeriodNs, maxReportLatencyNs);
             return Result::OK;
         }
         return Result::BAD_VALUE;
@@ -219,6 +225,8 @@ struct Sensors : public ISensorsInterface, public ISensorsEventCallback {
         std::shared_ptr<SensorType> sensor =
                 std::make_shared<SensorType>(mNextHandle++ /* sensorHandle */, this /* callback */);
         mSensors[sensor->getSensorInfo().sensorHandle] = sensor;
+        // Only poll the sensor once it is fully constructed.
+        SensorScheduler::getInstance().addSensor(sensor.get());
     }
 
     /**
@@ -23,6 +23,7 @@
 
 #include <dlfcn.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cmath>
 #include <fstream>
@@ -223,9 +224,13 @@ Return<Result> HalProxy::initializeCommon(
     // again we do not get new events until after initialize resets the subhals.
     disableAllSensors();
 
-    // Clears the queue if any events were pending write before.
-    mPendingWriteEventsQueue = std::queue<std::pair<std::vector<V2_1::Event>, size_t>>();
-    mSizePendingWriteEventsQueue = 0;
+    {
+        // Clears the queue if any events were pending write before, keeping its storage.
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        mPendingWriteEventsQueueHead = 0;
+        mSizePendingWriteEventsQueue = 0;
+        mSubHalEventStats.resize(mSubHalList.size());
+    }
 
     // Clears previously connected dynamic sensors
     mDynamicSensors.clear();
@@ -374,15 +379,23 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
            << std::endl;
     stream << " Most events seen on pending write events queue: "
            << mMostEventsObservedPendingWriteEventsQueue << std::endl;
-    if (!mPendingWriteEventsQueue.empty()) {
-        stream << "  Size of events list on front of pending writes queue: "
-               << mPendingWriteEventsQueue.front().first.size() << std::endl;
-    }
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
     stream << "SubHals (" << mSubHalList.size() << "):" << std::endl;
-    for (auto& subHal : mSubHalList) {
+    for (size_t i = 0; i < mSubHalList.size(); i++) {
+        auto& subHal = mSubHalList[i];
         stream << "  Name: " << subHal->getName() << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+            if (i < mSubHalEventStats.size()) {
+                const SubHalEventStats& stats = mSubHalEventStats[i];
+                stream << "  Events deferred to pending write queue: " << stats.eventsDeferred
+                       << std::endl;
+                stream << "  Events dropped: " << stats.eventsDropped << std::endl;
+                stream << "  Event fmq stall time: " << msFromNs(stats.stallTimeNs) << " ms"
+                       << std::endl;
+            }
+        }
         stream << "  Debug dump: " << std::endl;
         android::base::WriteStringToFd(stream.str(), writeFd);
         subHal->debug(fd, args);
@@ -570,43 +583,36 @@ void HalProxy::startPendingWritesThread(HalProxy* halProxy) {
 }
 
 void HalProxy::handlePendingWrites() {
-    // TODO(b/143302327): Find a way to optimize locking strategy maybe using two mutexes instead of
-    // one.
     std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
     while (mThreadsRun.load()) {
         mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
+                lock, [&] { return mSizePendingWriteEventsQueue > 0 || !mThreadsRun.load(); });
         if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
-            size_t eventQueueSize = mEventQueue->getQuantumCount();
-            size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
+            // Write the contiguous run of events at the head of the ring. Producers only append
+            // behind it while the lock is released, so it stays valid until it is consumed below.
+            size_t numToWrite = std::min({mSizePendingWriteEventsQueue,
+                                          mPendingWriteEventsQueue.size() -
+                                                  mPendingWriteEventsQueueHead,
+                                          mEventQueue->getQuantumCount()});
+            const Event* pendingWriteEvents =
+                    mPendingWriteEventsQueue.data() + mPendingWriteEventsQueueHead;
             lock.unlock();
-            if (!mEventQueue->writeBlocking(
-                        pendingWriteEvents.data(), numToWrite,
-                        static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
-                        static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
-                        kPendingWriteTimeoutNs, mEventQueueFlag)) {
+            int64_t writeStartTime = getTimeNow();
+            bool success = mEventQueue->writeBlocking(
+                    pendingWriteEvents, numToWrite,
+                    static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+                    static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
+                    kPendingWriteTimeoutNs, mEventQueueFlag);
+            int64_t stallTimeNs = getTimeNow() - writeStartTime;
+            lock.lock();
+            addStallTimeLocked(pendingWriteEvents, numToWrite, stallTimeNs);
+            if (!success) {
                 ALOGE("Dropping %zu events after blockingWrite failed.", numToWrite);
-                if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
-                        decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
-                    } else {
-                        decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
-                    }
-                }
+                dropEventsLocked(pendingWriteEvents, numToWrite, true /* releaseWakelock */);
             }
-            lock.lock();
+            mPendingWriteEventsQueueHead =
+                    (mPendingWriteEventsQueueHead + numToWrite) % mPendingWriteEventsQueue.size();
             mSizePendingWriteEventsQueue -= numToWrite;
-            if (pendingWriteEvents.size() > eventQueueSize) {
-                // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
-                // all the events ahead of it down to fill gap off array at front after the erase.
-                pendingWriteEvents.erase(pendingWriteEvents.begin(),
-                                         pendingWriteEvents.begin() + eventQueueSize);
-            } else {
-                mPendingWriteEventsQueue.pop();
-            }
         }
     }
 }
@@ -660,35 +666,96 @@ void HalProxy::resetSharedWakelock() {
 
 void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                         V2_0::implementation::ScopedWakelock wakelock) {
-    size_t numToWrite = 0;
+    size_t numWritten = 0;
     std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
     if (wakelock.isLocked()) {
         incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
     }
-    if (mPendingWriteEventsQueue.empty()) {
-        numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
-        if (numToWrite > 0) {
-            if (mEventQueue->write(events.data(), numToWrite)) {
-                // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
-                // in more writes immediately
-                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
-            } else {
-                numToWrite = 0;
+    if (mSizePendingWriteEventsQueue == 0) {
+        // Keep filling while the framework frees up space, so that a burst only overflows once
+        // the fmq is actually full.
+        while (numWritten < events.size()) {
+            size_t numToWrite = mEventQueue->writeAvailable(events.data() + numWritten,
+                                                            events.size() - numWritten);
+            if (numToWrite == 0) {
+                break;
             }
+            numWritten += numToWrite;
+        }
+        if (numWritten > 0) {
+            mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
         }
     }
-    size_t numLeft = events.size() - numToWrite;
-    if (numToWrite < events.size() &&
-        mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
-        mSizePendingWriteEventsQueue += numLeft;
+    size_t numLeft = events.size() - numWritten;
+    if (numLeft == 0) {
+        return;
+    }
+    if (mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
+        pushPendingWriteEventsLocked(events.data() + numWritten, numLeft);
         mMostEventsObservedPendingWriteEventsQueue =
                 std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
         mEventQueueWriteCV.notify_one();
+    } else {
+        dropEventsLocked(events.data() + numWritten, numLeft, wakelock.isLocked());
+    }
+}
+
+void HalProxy::pushPendingWriteEventsLocked(const Event* events, size_t n) {
+    if (mPendingWriteEventsQueue.empty()) {
+        mPendingWriteEventsQueue.resize(kMaxSizePendingWriteEventsQueue);
+    }
+    size_t capacity = mPendingWriteEventsQueue.size();
+    size_t tail = (mPendingWriteEventsQueueHead + mSizePendingWriteEventsQueue) % capacity;
+    size_t firstPart = std::min(n, capacity - tail);
+    std::copy(events, events + firstPart, mPendingWriteEventsQueue.begin() + tail);
+    std::copy(events + firstPart, events + n, mPendingWriteEventsQueue.begin());
+    mSizePendingWriteEventsQueue += n;
+
+    for (size_t i = 0; i < n; i++) {
+        SubHalEventStats* stats = getSubHalEventStatsLocked(events[i].sensorHandle);
+        if (stats != nullptr) {
+            stats->eventsDeferred++;
+        }
     }
 }
 
+void HalProxy::dropEventsLocked(const Event* events, size_t n, bool releaseWakelock) {
+    for (size_t i = 0; i < n; i++) {
+        SubHalEventStats* stats = getSubHalEventStatsLocked(events[i].sensorHandle);
+        if (stats != nullptr) {
+            stats->eventsDropped++;
+        }
+    }
+    if (releaseWakelock) {
+        size_t numWakeupEvents = countNumWakeupEvents(events, n);
+        if (numWakeupEvents > 0) {
+            decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
+        }
+    }
+}
+
+void HalProxy::addStallTimeLocked(const Event* events, size_t n, int64_t stallTimeNs) {
+    if (n == 0) {
+        return;
+    }
+    std::vector<size_t> numEventsPerSubHal(mSubHalEventStats.size());
+    for (size_t i = 0; i < n; i++) {
+        size_t subHalIndex = extractSubHalIndex(events[i].sensorHandle);
+        if (subHalIndex < numEventsPerSubHal.size()) {
+            numEventsPerSubHal[subHalIndex]++;
+        }
+    }
+    for (size_t i = 0; i < numEventsPerSubHal.size(); i++) {
+        mSubHalEventStats[i].stallTimeNs +=
+                stallTimeNs * static_cast<int64_t>(numEventsPerSubHal[i]) / static_cast<int64_t>(n);
+    }
+}
+
+HalProxy::SubHalEventStats* HalProxy::getSubHalEventStatsLocked(int32_t sensorHandle) {
+    size_t subHalIndex = extractSubHalIndex(sensorHandle);
+    return subHalIndex < mSubHalEventStats.size() ? &mSubHalEventStats[subHalIndex] : nullptr;
+}
+
 bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
                                                         int64_t* timeoutStart /* = nullptr */) {
     if (!mThreadsRun.load()) return false;
@@ -744,7 +811,7 @@ bool HalProxy::isSubHalIndexValid(int32_t sensorHandle) {
     return extractSubHalIndex(sensorHandle) < mSubHalList.size();
 }
 
-size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t n) {
+size_t HalProxy::countNumWakeupEvents(const Event* events, size_t n) {
     size_t numWakeupEvents = 0;
     for (size_t i = 0; i < n; i++) {
         int32_t sensorHandle = events[i].sensorHandle;
@@ -37,7 +37,6 @@
 #include <condition_variable>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 
@@ -202,10 +201,27 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     static constexpr int32_t kSensorHandleSubHalIndexMask = 0xFF000000;
 
     /**
-     * A FIFO queue of pairs of vector of events and the number of wakeup events in that vector
-     * which are waiting to be written to the events fmq in the background thread.
+     * Per subhal accounting of events that could not be written to the event fmq directly, for
+     * debug purposes.
      */
-    std::queue<std::pair<std::vector<Event>, size_t>> mPendingWriteEventsQueue;
+    struct SubHalEventStats {
+        //! Events that went through the pending write events queue.
+        uint64_t eventsDeferred = 0;
+        //! Events dropped because the queue was full or a blocking write timed out.
+        uint64_t eventsDropped = 0;
+        //! Time spent blocked writing this subhal's events to the event fmq.
+        int64_t stallTimeNs = 0;
+    };
+
+    /**
+     * A ring buffer of the events waiting to be written to the events fmq in the background
+     * thread. It is allocated with kMaxSizePendingWriteEventsQueue capacity on the first overflow
+     * and reused afterwards.
+     */
+    std::vector<Event> mPendingWriteEventsQueue;
+
+    //! The index of the oldest event in the pending write events queue.
+    size_t mPendingWriteEventsQueueHead = 0;
 
     //! The most events observed on the pending write events queue for debug purposes.
     size_t mMostEventsObservedPendingWriteEventsQueue = 0;
@@ -216,6 +232,9 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     //! The number of events in the pending write events queue
     size_t mSizePendingWriteEventsQueue = 0;
 
+    //! Event stats indexed by subhal index.
+    std::vector<SubHalEventStats> mSubHalEventStats;
+
     //! The mutex protecting writing to the fmq and the pending events queue
     std::mutex mEventQueueWriteMutex;
 
@@ -357,14 +376,52 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     bool isSubHalIndexValid(int32_t sensorHandle);
 
     /**
-     * Count the number of wakeup events in the first n events of the vector.
+     * Count the number of wakeup events in the first n events of the array.
      *
-     * @param events The vector of Event objects.
+     * @param events The array of Event objects.
      * @param n The end index not inclusive of events to consider.
      *
      * @return The number of wakeup events of the considered events.
      */
-    size_t countNumWakeupEvents(const std::vector<Event>& events, size_t n);
+    size_t countNumWakeupEvents(const Event* events, size_t n);
+
+    /**
+     * Append events to the pending write events queue, which must have room for them. Must be
+     * called with mEventQueueWriteMutex held.
+     *
+     * @param events The array of Event objects.
+     * @param n The number of events to append.
+     */
+    void pushPendingWriteEventsLocked(const Event* events, size_t n);
+
+    /**
+     * Account for events dropped before reaching the event fmq and release the wakelock ref
+     * counts held for them. Must be called with mEventQueueWriteMutex held.
+     *
+     * @param events The array of dropped Event objects.
+     * @param n The number of dropped events.
+     * @param releaseWakelock Whether wakeup events among them hold a wakelock ref count.
+     */
+    void dropEventsLocked(const Event* events, size_t n, bool releaseWakelock);
+
+    /**
+     * Split the time spent blocked writing events to the event fmq across the subhals owning
+     * them, in proportion to their number of events. Must be called with mEventQueueWriteMutex
+     * held.
+     *
+     * @param events The array of Event objects that were written.
+     * @param n The number of events written.
+     * @param stallTimeNs The time the write was blocked for.
+     */
+    void addStallTimeLocked(const Event* events, size_t n, int64_t stallTimeNs);
+
+    /**
+     * Get the event stats of the subhal owning a sensor handle, or nullptr if the subhal index
+     * is invalid. Must be called with mEventQueueWriteMutex held.
+     *
+     * @param sensorHandle The sensor handle whose subhal stats to get.
+     */
+    SubHalEventStats* getSubHalEventStatsLocked(int32_t sensorHandle);
 
     /*
      * Clear out the subhal index bytes from a sensorHandle.
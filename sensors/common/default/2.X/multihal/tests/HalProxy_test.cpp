@@ -25,14 +25,21 @@
 #include "V2_0/ScopedWakelock.h"
 #include "convertV2_1.h"
 
+#include <android-base/file.h>
+#include <cutils/native_handle.h>
+#include <unistd.h>
+
 #include <chrono>
 #include <set>
+#include <string>
 #include <thread>
 #include <vector>
 
 namespace {
 
 using ::android::hardware::EventFlag;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::MessageQueue;
 using ::android::hardware::Return;
@@ -205,6 +212,60 @@ std::vector<EventV1_0> makeMultipleProximityEvents(size_t numEvents);
  */
 std::vector<EventV1_0> makeMultipleAccelerometerEvents(size_t numEvents);
 
+/**
+ * Make a certain number of accelerometer type events with consecutive timestamps, so that the
+ * order they are read back in can be checked.
+ *
+ * @param numEvents The number of events to make.
+ * @param firstTimestamp The timestamp of the first event.
+ *
+ * @return The created list of events.
+ */
+std::vector<EventV1_0> makeTimestampedAccelerometerEvents(size_t numEvents,
+                                                          int64_t firstTimestamp);
+
+/**
+ * Read a certain number of events out of the event queue, blocking until they are written.
+ *
+ * @param numEvents The number of events to read.
+ * @param eventQueue The event queue to read from.
+ * @param eventQueueFlag The event flag of the event queue.
+ *
+ * @return The events read, or an empty list if they were not written in time.
+ */
+std::vector<EventV1_0> takeEventsOutOfQueue(size_t numEvents,
+                                            std::unique_ptr<EventMessageQueueV2_0>& eventQueue,
+                                            EventFlag* eventQueueFlag);
+
+/**
+ * Check that events have consecutive timestamps.
+ *
+ * @param events The events to check.
+ * @param firstTimestamp The expected timestamp of the first event.
+ *
+ * @return Whether every event has the expected timestamp.
+ */
+bool hasConsecutiveTimestamps(const std::vector<EventV1_0>& events, int64_t firstTimestamp);
+
+/**
+ * Get the output of a proxy.debug call.
+ *
+ * @param proxy The HalProxy object to dump.
+ *
+ * @return The debug output.
+ */
+std::string getDebugDump(HalProxy& proxy);
+
+/**
+ * Get the values following each occurrence of a label in a debug dump, in order.
+ *
+ * @param dump The debug output of the proxy.
+ * @param label The label of the values, including its trailing ": ".
+ *
+ * @return The values, one per occurrence of the label.
+ */
+std::vector<int64_t> getDebugValues(const std::string& dump, const std::string& label);
+
 /**
  * Given a SensorInfo vector and a sensor handles vector populate 'sensors' with SensorInfo
  * objects that have the sensorHandle property set to int32_ts from start to start + size
@@ -827,6 +888,183 @@ TEST(HalProxyTest, PostEventsMultipleSubhalsThreadedV2_1) {
     EXPECT_EQ(eventQueue->availableToRead(), kNumEvents * 2);
 }
 
+TEST(HalProxyTest, PostEventsWrapAroundEventQueue) {
+    constexpr size_t kQueueSize = 5;
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal;
+    std::vector<ISensorsSubHal*> subHals{&subHal};
+    HalProxy proxy(subHals);
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    std::vector<EventV1_0> events = makeTimestampedAccelerometerEvents(3, 0);
+    subHal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    std::vector<EventV1_0> eventsOut(kQueueSize);
+    ASSERT_TRUE(eventQueue->read(eventsOut.data(), 3));
+
+    // The write position is now 3 slots into the queue, so these events are split across the end
+    // and the start of the queue. They all fit and must be written directly.
+    events = makeTimestampedAccelerometerEvents(4, 3);
+    subHal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    ASSERT_EQ(eventQueue->availableToRead(), 4u);
+    eventsOut.resize(4);
+    ASSERT_TRUE(eventQueue->read(eventsOut.data(), 4));
+    EXPECT_TRUE(hasConsecutiveTimestamps(eventsOut, 3));
+}
+
+TEST(HalProxyTest, PostEventsWrapAroundEventQueueV2_1) {
+    constexpr size_t kQueueSize = 5;
+    AllSensorsSubHal<SensorsSubHalV2_1> subHal;
+    std::vector<::android::hardware::sensors::V2_0::implementation::ISensorsSubHal*> subHalsV2_0;
+    std::vector<::android::hardware::sensors::V2_1::implementation::ISensorsSubHal*> subHalsV2_1{
+            &subHal};
+    HalProxy proxy(subHalsV2_0, subHalsV2_1);
+    std::unique_ptr<EventMessageQueueV2_1> eventQueue =
+            std::make_unique<EventMessageQueueV2_1>(kQueueSize, true);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_1> callback = new SensorsCallbackV2_1();
+    proxy.initialize_2_1(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    std::vector<EventV1_0> events = makeTimestampedAccelerometerEvents(4, 0);
+    subHal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    std::vector<EventV2_1> eventsOut(kQueueSize);
+    ASSERT_TRUE(eventQueue->read(eventsOut.data(), 4));
+
+    events = makeTimestampedAccelerometerEvents(5, 4);
+    subHal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    ASSERT_EQ(eventQueue->availableToRead(), 5u);
+    ASSERT_TRUE(eventQueue->read(eventsOut.data(), 5));
+    for (size_t i = 0; i < eventsOut.size(); i++) {
+        EXPECT_EQ(eventsOut[i].timestamp, static_cast<int64_t>(4 + i));
+    }
+}
+
+TEST(HalProxyTest, PendingQueueWrapsAround) {
+    constexpr size_t kQueueSize = 100;
+    // TODO: Make this constant linked to same limit in HalProxy.h
+    constexpr size_t kMaxPendingQueueSize = 100000;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Fill the event queue, then the pending queue up to two events short of its end
+    int64_t timestamp = 0;
+    std::vector<EventV1_0> events = makeTimestampedAccelerometerEvents(kQueueSize, timestamp);
+    subhal.postEvents(convertToNewEvents(events), false);
+    events = makeTimestampedAccelerometerEvents(kMaxPendingQueueSize - 2, timestamp + kQueueSize);
+    subhal.postEvents(convertToNewEvents(events), false);
+
+    size_t numLeft = kQueueSize + kMaxPendingQueueSize - 2;
+    while (numLeft > 0) {
+        size_t numToRead = std::min(numLeft, kQueueSize);
+        std::vector<EventV1_0> eventsOut =
+                takeEventsOutOfQueue(numToRead, eventQueue, eventQueueFlag);
+        ASSERT_EQ(eventsOut.size(), numToRead);
+        ASSERT_TRUE(hasConsecutiveTimestamps(eventsOut, timestamp));
+        timestamp += numToRead;
+        numLeft -= numToRead;
+    }
+
+    // The events that do not fit in the event queue are copied to the last two slots of the
+    // pending queue and then to its start.
+    events = makeTimestampedAccelerometerEvents(kQueueSize + 5, timestamp);
+    subhal.postEvents(convertToNewEvents(events), false);
+    std::vector<EventV1_0> eventsOut = takeEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag);
+    EXPECT_TRUE(hasConsecutiveTimestamps(eventsOut, timestamp));
+    eventsOut = takeEventsOutOfQueue(5, eventQueue, eventQueueFlag);
+    ASSERT_EQ(eventsOut.size(), 5u);
+    EXPECT_TRUE(hasConsecutiveTimestamps(eventsOut, timestamp + kQueueSize));
+}
+
+TEST(HalProxyTest, DropsEventsThatDoNotFitInPendingQueue) {
+    constexpr size_t kQueueSize = 5;
+    // TODO: Make this constant linked to same limit in HalProxy.h
+    constexpr size_t kMaxPendingQueueSize = 100000;
+    AllSensorsSubHal<SensorsSubHalV2_0> subhal;
+    std::vector<ISensorsSubHal*> subHals{&subhal};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    // Fill the event queue with wakeup events, which hold the wakelock until acked
+    std::vector<EventV1_0> events = makeMultipleProximityEvents(kQueueSize);
+    subhal.postEvents(convertToNewEvents(events), true /* wakeup */);
+    events = makeMultipleAccelerometerEvents(3);
+    subhal.postEvents(convertToNewEvents(events), false /* wakeup */);
+
+    // These would overflow the pending queue, so all of them are dropped and the wakelock ref
+    // counts taken for them are given back right away.
+    events = makeMultipleProximityEvents(kMaxPendingQueueSize - 2);
+    subhal.postEvents(convertToNewEvents(events), true /* wakeup */);
+
+    std::string dump = getDebugDump(proxy);
+    EXPECT_EQ(getDebugValues(dump, "Wakelock ref count: "), std::vector<int64_t>{kQueueSize});
+    EXPECT_EQ(getDebugValues(dump, "Events deferred to pending write queue: "),
+              std::vector<int64_t>{3});
+    EXPECT_EQ(getDebugValues(dump, "Events dropped: "),
+              std::vector<int64_t>{kMaxPendingQueueSize - 2});
+
+    // The events that were queued before are still delivered
+    EXPECT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+    EXPECT_TRUE(readEventsOutOfQueue(3, eventQueue, eventQueueFlag));
+}
+
+TEST(HalProxyTest, DebugReportsEventStatsPerSubHal) {
+    constexpr size_t kQueueSize = 5;
+    // TODO: Make this constant linked to same limit in HalProxy.h
+    constexpr size_t kMaxPendingQueueSize = 100000;
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal1, subHal2;
+    std::vector<ISensorsSubHal*> subHals{&subHal1, &subHal2};
+
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+    HalProxy proxy(subHals);
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    std::string dump = getDebugDump(proxy);
+    EXPECT_EQ(getDebugValues(dump, "Events deferred to pending write queue: "),
+              (std::vector<int64_t>{0, 0}));
+    EXPECT_EQ(getDebugValues(dump, "Events dropped: "), (std::vector<int64_t>{0, 0}));
+
+    // Events queued behind others are deferred even if they are from another subhal
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(kQueueSize + 3);
+    subHal1.postEvents(convertToNewEvents(events), false /* wakeup */);
+    events = makeMultipleAccelerometerEvents(2);
+    subHal2.postEvents(convertToNewEvents(events), false /* wakeup */);
+    events = makeMultipleAccelerometerEvents(kMaxPendingQueueSize);
+    subHal2.postEvents(convertToNewEvents(events), false /* wakeup */);
+
+    // The background thread is blocked writing subHal1's events until there is room
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+    EXPECT_TRUE(readEventsOutOfQueue(5, eventQueue, eventQueueFlag));
+
+    dump = getDebugDump(proxy);
+    EXPECT_EQ(getDebugValues(dump, "Events deferred to pending write queue: "),
+              (std::vector<int64_t>{3, 2}));
+    EXPECT_EQ(getDebugValues(dump, "Events dropped: "),
+              (std::vector<int64_t>{0, kMaxPendingQueueSize}));
+    std::vector<int64_t> stallTimes = getDebugValues(dump, "Event fmq stall time: ");
+    ASSERT_EQ(stallTimes.size(), 2u);
+    EXPECT_GT(stallTimes[0], 0);
+}
+
 // Helper implementations follow
 void testSensorsListFromProxyAndSubHal(const std::vector<SensorInfo>& proxySensorsList,
                                        const std::vector<SensorInfo>& subHalSensorsList) {
@@ -919,6 +1157,64 @@ std::vector<EventV1_0> makeMultipleAccelerometerEvents(size_t numEvents) {
     return events;
 }
 
+std::vector<EventV1_0> makeTimestampedAccelerometerEvents(size_t numEvents,
+                                                          int64_t firstTimestamp) {
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(numEvents);
+    for (size_t i = 0; i < numEvents; i++) {
+        events[i].timestamp = firstTimestamp + static_cast<int64_t>(i);
+    }
+    return events;
+}
+
+std::vector<EventV1_0> takeEventsOutOfQueue(size_t numEvents,
+                                            std::unique_ptr<EventMessageQueueV2_0>& eventQueue,
+                                            EventFlag* eventQueueFlag) {
+    constexpr int64_t kReadBlockingTimeout = INT64_C(500000000);
+    std::vector<EventV1_0> events(numEvents);
+    if (!eventQueue->readBlocking(events.data(), numEvents,
+                                  static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+                                  static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
+                                  kReadBlockingTimeout, eventQueueFlag)) {
+        events.clear();
+    }
+    return events;
+}
+
+bool hasConsecutiveTimestamps(const std::vector<EventV1_0>& events, int64_t firstTimestamp) {
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].timestamp != firstTimestamp + static_cast<int64_t>(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string getDebugDump(HalProxy& proxy) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return "";
+    }
+    native_handle_t* nativeHandle = native_handle_create(1 /* numFds */, 0 /* numInts */);
+    nativeHandle->data[0] = fds[1];
+    proxy.debug(hidl_handle(nativeHandle), hidl_vec<hidl_string>());
+    native_handle_close(nativeHandle);
+    native_handle_delete(nativeHandle);
+
+    std::string dump;
+    ::android::base::ReadFdToString(fds[0], &dump);
+    close(fds[0]);
+    return dump;
+}
+
+std::vector<int64_t> getDebugValues(const std::string& dump, const std::string& label) {
+    std::vector<int64_t> values;
+    for (size_t pos = dump.find(label); pos != std::string::npos;
+         pos = dump.find(label, pos + label.size())) {
+        values.push_back(std::stoll(dump.substr(pos + label.size())));
+    }
+    return values;
+}
+
 void makeSensorsAndSensorHandlesStartingAndOfSize(int32_t start, size_t size,
                                                   std::vector<SensorInfo>& sensors,
                                                   std::vector<int32_t>& sensorHandles) {
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SensorScheduler.h"
+
+#include <utils/SystemClock.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace common {
+
+SensorScheduler& SensorScheduler::getInstance() {
+    // Intentionally leaked so that the timer thread never outlives its scheduler.
+    static SensorScheduler* scheduler = new SensorScheduler();
+    return *scheduler;
+}
+
+SensorScheduler::SensorScheduler() : mWakePending(false) {
+    mThread = std::thread(&SensorScheduler::run, this);
+}
+
+void SensorScheduler::addSensor(PolledSensor* sensor) {
+    {
+        std::lock_guard<std::mutex> pollLock(mPollLock);
+        std::lock_guard<std::mutex> lock(mLock);
+        mSensors.push_back(sensor);
+    }
+    wake();
+}
+
+void SensorScheduler::removeSensor(PolledSensor* sensor) {
+    std::lock_guard<std::mutex> pollLock(mPollLock);
+    std::lock_guard<std::mutex> lock(mLock);
+    mSensors.erase(std::remove(mSensors.begin(), mSensors.end(), sensor), mSensors.end());
+}
+
+void SensorScheduler::wake() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mWakePending = true;
+    mWakeCV.notify_one();
+}
+
+void SensorScheduler::run() {
+    while (true) {
+        int64_t nextWakeTime = kNever;
+        {
+            std::lock_guard<std::mutex> pollLock(mPollLock);
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                mWakePending = false;
+            }
+            int64_t now = ::android::elapsedRealtimeNano();
+            for (PolledSensor* sensor : mSensors) {
+                nextWakeTime = std::min(nextWakeTime, sensor->poll(now));
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mLock);
+        if (nextWakeTime == kNever) {
+            mWakeCV.wait(lock, [&] { return mWakePending; });
+        } else {
+            int64_t now = ::android::elapsedRealtimeNano();
+            mWakeCV.wait_for(lock, std::chrono::nanoseconds(nextWakeTime - now),
+                             [&] { return mWakePending; });
+        }
+    }
+}
+
+}  // namespace common
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace common {
+
+// Drives sensors from a single timer thread. Each pass polls the registered sensors, which
+// sample, batch and deliver whatever is due, and then sleeps until the earliest deadline any of
+// them reported or until a sensor's configuration changes.
+class SensorScheduler {
+  public:
+    static constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+    class PolledSensor {
+      public:
+        virtual ~PolledSensor() = default;
+
+        // Does whatever is due at |nowNs|, in elapsedRealtimeNano() time, and returns the time of
+        // the next deadline, or kNever if idle.
+        virtual int64_t poll(int64_t nowNs) = 0;
+    };
+
+    static SensorScheduler& getInstance();
+
+    // Sensors are added by their owner once fully constructed, and must be removed before their
+    // destruction starts.
+    void addSensor(PolledSensor* sensor);
+    // Returns once any polling pass that may be using |sensor| has completed.
+    void removeSensor(PolledSensor* sensor);
+    // Re-evaluates every deadline. Must not be called with a sensor's lock held.
+    void wake();
+
+  private:
+    SensorScheduler();
+    void run();
+
+    // Held for a whole polling pass; mSensors may only change while holding both locks.
+    std::mutex mPollLock;
+    std::mutex mLock;
+    std::condition_variable mWakeCV;
+    std::vector<PolledSensor*> mSensors;
+    bool mWakePending;
+    std::thread mThread;
+};
+
+}  // namespace common
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
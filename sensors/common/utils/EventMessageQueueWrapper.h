@@ -25,6 +25,7 @@
 #include <hidl/Status.h>
 #include <log/log.h>
 
+#include <algorithm>
 #include <atomic>
 
 namespace android {
@@ -46,6 +47,9 @@ class EventMessageQueueWrapperBase {
     virtual bool writeBlocking(const V2_1::Event* events, size_t count, uint32_t readNotification,
                                uint32_t writeNotification, int64_t timeOutNanos,
                                android::hardware::EventFlag* evFlag) = 0;
+    // Writes as many of |events| as currently fit, copying them straight into the queue's
+    // contiguous regions with a two-phase beginWrite/commitWrite. Returns the number written.
+    virtual size_t writeAvailable(const V2_1::Event* events, size_t count) = 0;
     virtual size_t getQuantumCount() = 0;
 };
 
@@ -88,6 +92,18 @@ class EventMessageQueueWrapperV1_0 : public EventMessageQueueWrapperBase {
                                      readNotification, writeNotification, timeOutNanos, evFlag);
     }
 
+    size_t writeAvailable(const V2_1::Event* events, size_t count) override {
+        size_t numToWrite = std::min(count, mQueue->availableToWrite());
+        EventMessageQueue::MemTransaction tx;
+        if (numToWrite == 0 || !mQueue->beginWrite(numToWrite, &tx) ||
+            !tx.copyTo(reinterpret_cast<const V1_0::Event*>(events), 0 /* startIdx */,
+                       numToWrite) ||
+            !mQueue->commitWrite(numToWrite)) {
+            return 0;
+        }
+        return numToWrite;
+    }
+
     size_t getQuantumCount() override { return mQueue->getQuantumCount(); }
 
   private:
@@ -130,6 +146,16 @@ class EventMessageQueueWrapperV2_1 : public EventMessageQueueWrapperBase {
                                      timeOutNanos, evFlag);
     }
 
+    size_t writeAvailable(const V2_1::Event* events, size_t count) override {
+        size_t numToWrite = std::min(count, mQueue->availableToWrite());
+        EventMessageQueue::MemTransaction tx;
+        if (numToWrite == 0 || !mQueue->beginWrite(numToWrite, &tx) ||
+            !tx.copyTo(events, 0 /* startIdx */, numToWrite) || !mQueue->commitWrite(numToWrite)) {
+            return 0;
+        }
+        return numToWrite;
+    }
+
     size_t getQuantumCount() override { return mQueue->getQuantumCount(); }
 
   private:
@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "thermal_service_example"
+
+#include "SysfsThermal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/thermal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string_view>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+namespace aidl::android::hardware::thermal::impl::example {
+
+using ::android::base::ReadFileToString;
+using ::android::base::unique_fd;
+
+namespace {
+
+constexpr char kZonePrefix[] = "thermal_zone";
+constexpr char kCoolingDevicePrefix[] = "cooling_device";
+
+// Without kernel events, zones are polled every kMaxPollInterval when they are at least
+// kSlowPollDistance away from a severity change, and up to every kMinPollInterval closer to it.
+// Kernel events report trip crossings, so polling only backs them up.
+constexpr std::chrono::milliseconds kMinPollInterval(1000);
+constexpr std::chrono::milliseconds kMaxPollInterval(10000);
+constexpr std::chrono::milliseconds kMaxPollIntervalWithEvents(30000);
+constexpr float kSlowPollDistance = 10.0f;
+
+// Trip points often have no hysteresis; keep a little so that the severity does not flap.
+constexpr float kMinHysteresis = 2.0f;
+
+// Severity entered at each kind of trip point. The lowest trip point of a kind is used.
+const std::map<std::string, ThrottlingSeverity> kTripTypeSeverities = {
+        {"active", ThrottlingSeverity::LIGHT},
+        {"passive", ThrottlingSeverity::MODERATE},
+        {"hot", ThrottlingSeverity::CRITICAL},
+        {"critical", ThrottlingSeverity::SHUTDOWN},
+};
+
+// Zone and cooling device types are matched by substring, in order.
+const std::vector<std::pair<std::string_view, TemperatureType>> kTemperatureTypes = {
+        {"battery", TemperatureType::BATTERY}, {"skin", TemperatureType::SKIN},
+        {"usb", TemperatureType::USB_PORT},    {"gpu", TemperatureType::GPU},
+        {"npu", TemperatureType::NPU},         {"tpu", TemperatureType::TPU},
+        {"modem", TemperatureType::MODEM},     {"wifi", TemperatureType::WIFI},
+        {"wlan", TemperatureType::WIFI},       {"camera", TemperatureType::CAMERA},
+        {"flash", TemperatureType::FLASHLIGHT}, {"speaker", TemperatureType::SPEAKER},
+        {"display", TemperatureType::DISPLAY}, {"pogo", TemperatureType::POGO},
+        {"ambient", TemperatureType::AMBIENT}, {"cpu", TemperatureType::CPU},
+        {"x86_pkg", TemperatureType::CPU},     {"soc", TemperatureType::SOC},
+        {"acpitz", TemperatureType::SOC},
+};
+
+const std::vector<std::pair<std::string_view, CoolingType>> kCoolingTypes = {
+        {"fan", CoolingType::FAN},         {"processor", CoolingType::CPU},
+        {"cpu", CoolingType::CPU},         {"powerclamp", CoolingType::CPU},
+        {"gpu", CoolingType::GPU},         {"battery", CoolingType::BATTERY},
+        {"charger", CoolingType::BATTERY}, {"modem", CoolingType::MODEM},
+        {"npu", CoolingType::NPU},         {"tpu", CoolingType::TPU},
+        {"display", CoolingType::DISPLAY}, {"backlight", CoolingType::DISPLAY},
+        {"speaker", CoolingType::SPEAKER}, {"wifi", CoolingType::WIFI},
+        {"wlan", CoolingType::WIFI},       {"camera", CoolingType::CAMERA},
+        {"flash", CoolingType::FLASHLIGHT}, {"usb", CoolingType::USB_PORT},
+};
+
+template <typename T>
+T matchType(const std::vector<std::pair<std::string_view, T>>& table, std::string name,
+            T default_type) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    for (const auto& [pattern, type] : table) {
+        if (name.find(pattern) != std::string::npos) {
+            return type;
+        }
+    }
+    return default_type;
+}
+
+// Returns the indices of the |prefix|<index> entries of |root|, in increasing order.
+std::vector<int> listNodes(const std::string& root, const std::string& prefix) {
+    std::vector<int> indices;
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(root.c_str()), closedir);
+    if (!dir) {
+        PLOG(ERROR) << "Failed to open " << root;
+        return indices;
+    }
+    while (struct dirent* entry = readdir(dir.get())) {
+        int index;
+        if (::android::base::StartsWith(entry->d_name, prefix) &&
+            ::android::base::ParseInt(entry->d_name + prefix.size(), &index, 0)) {
+            indices.push_back(index);
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+std::string readAttribute(const std::string& path) {
+    std::string value;
+    if (!ReadFileToString(path, &value)) {
+        return "";
+    }
+    return ::android::base::Trim(value);
+}
+
+// Reads an integer attribute through a descriptor kept open, without allocating.
+bool readInt(int fd, int64_t* value) {
+    char buf[32];
+    ssize_t n = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+    char* end;
+    errno = 0;
+    *value = strtoll(buf, &end, 10);
+    return errno == 0 && end != buf;
+}
+
+bool readTemperature(int fd, float* celsius) {
+    int64_t millicelsius;
+    if (!readInt(fd, &millicelsius)) {
+        return false;
+    }
+    *celsius = millicelsius / 1000.0f;
+    return true;
+}
+
+unique_fd openAttribute(const std::string& path) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd < 0) {
+        PLOG(WARNING) << "Failed to open " << path;
+    }
+    return fd;
+}
+
+// Calls |fn| for each attribute in [data, data + len).
+template <typename Fn>
+void forEachAttr(const void* data, size_t len, Fn fn) {
+    const char* pos = static_cast<const char*>(data);
+    while (len >= NLA_HDRLEN) {
+        const auto* attr = reinterpret_cast<const struct nlattr*>(pos);
+        if (attr->nla_len < NLA_HDRLEN || attr->nla_len > len) {
+            return;
+        }
+        fn(attr, pos + NLA_HDRLEN, attr->nla_len - NLA_HDRLEN);
+        size_t aligned = std::min<size_t>(NLA_ALIGN(attr->nla_len), len);
+        pos += aligned;
+        len -= aligned;
+    }
+}
+
+// Returns the id of |group| in a CTRL_ATTR_MCAST_GROUPS attribute, or -1.
+int findMcastGroup(const void* groups, size_t len, std::string_view group) {
+    int group_id = -1;
+    forEachAttr(groups, len, [&](const struct nlattr*, const void* data, size_t len) {
+        std::string_view name;
+        int id = -1;
+        forEachAttr(data, len, [&](const struct nlattr* attr, const void* value, size_t value_len) {
+            if ((attr->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_MCAST_GRP_NAME) {
+                const char* str = static_cast<const char*>(value);
+                name = std::string_view(str, strnlen(str, value_len));
+            } else if ((attr->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_MCAST_GRP_ID &&
+                       value_len >= sizeof(uint32_t)) {
+                id = *static_cast<const uint32_t*>(value);
+            }
+        });
+        if (name == group) {
+            group_id = id;
+        }
+    });
+    return group_id;
+}
+
+// Resolves the multicast group |group| of the generic netlink family |family| through the
+// generic netlink controller. Returns -1 if the kernel does not have it.
+int resolveGenlGroup(int fd, const char* family, const char* group) {
+    struct {
+        struct nlmsghdr hdr;
+        struct genlmsghdr genl;
+        char attrs[64];
+    } req = {};
+    size_t name_len = strlen(family) + 1;
+    auto* attr = reinterpret_cast<struct nlattr*>(req.attrs);
+    attr->nla_type = CTRL_ATTR_FAMILY_NAME;
+    attr->nla_len = NLA_HDRLEN + name_len;
+    memcpy(req.attrs + NLA_HDRLEN, family, name_len);
+    req.hdr.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(attr->nla_len));
+    req.hdr.nlmsg_type = GENL_ID_CTRL;
+    req.hdr.nlmsg_flags = NLM_F_REQUEST;
+    req.genl.cmd = CTRL_CMD_GETFAMILY;
+    req.genl.version = 1;
+    if (TEMP_FAILURE_RETRY(send(fd, &req, req.hdr.nlmsg_len, 0)) < 0) {
+        PLOG(ERROR) << "Failed to query generic netlink family " << family;
+        return -1;
+    }
+
+    // The controller replies before send() returns.
+    alignas(struct nlmsghdr) char buf[4096];
+    ssize_t n = TEMP_FAILURE_RETRY(recv(fd, buf, sizeof(buf), MSG_DONTWAIT));
+    const auto* hdr = reinterpret_cast<const struct nlmsghdr*>(buf);
+    if (n < 0 || !NLMSG_OK(hdr, n) || hdr->nlmsg_type != GENL_ID_CTRL ||
+        hdr->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+        return -1;
+    }
+
+    int group_id = -1;
+    const char* attrs = static_cast<const char*>(NLMSG_DATA(hdr)) + GENL_HDRLEN;
+    forEachAttr(attrs, hdr->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN),
+                [&](const struct nlattr* attr, const void* data, size_t len) {
+                    if ((attr->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_MCAST_GROUPS) {
+                        group_id = findMcastGroup(data, len, group);
+                    }
+                });
+    return group_id;
+}
+
+bool isTripEvent(const struct nlmsghdr* hdr) {
+    if (hdr->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+        return false;
+    }
+    const auto* genl = static_cast<const struct genlmsghdr*>(NLMSG_DATA(hdr));
+    return genl->cmd == THERMAL_GENL_EVENT_TZ_TRIP_UP ||
+           genl->cmd == THERMAL_GENL_EVENT_TZ_TRIP_DOWN ||
+           genl->cmd == THERMAL_GENL_EVENT_TZ_ENABLE;
+}
+
+}  // namespace
+
+SysfsThermal::SysfsThermal(const std::string& root, ThrottlingCallback callback, bool watch)
+    : callback_(std::move(callback)) {
+    scanZones(root);
+    scanCoolingDevices(root);
+    severities_.assign(zones_.size(), ThrottlingSeverity::NONE);
+    LOG(INFO) << "Found " << zones_.size() << " thermal zones and " << cooling_devices_.size()
+              << " cooling devices in " << root;
+    if (zones_.empty() || !watch) {
+        return;
+    }
+
+    openEventSocket();
+    stop_fd_.reset(eventfd(0, EFD_CLOEXEC));
+    if (stop_fd_ < 0) {
+        PLOG(ERROR) << "Failed to create eventfd, thermal zones are not watched";
+        return;
+    }
+    watcher_ = std::thread(&SysfsThermal::watch, this);
+}
+
+SysfsThermal::~SysfsThermal() {
+    if (watcher_.joinable()) {
+        uint64_t value = 1;
+        TEMP_FAILURE_RETRY(write(stop_fd_, &value, sizeof(value)));
+        watcher_.join();
+    }
+}
+
+void SysfsThermal::scanZones(const std::string& root) {
+    for (int index : listNodes(root, kZonePrefix)) {
+        const std::string path = root + "/" + kZonePrefix + std::to_string(index) + "/";
+        Zone zone;
+        zone.name = readAttribute(path + "type");
+        if (zone.name.empty()) {
+            zone.name = kZonePrefix + std::to_string(index);
+        }
+        // Zone types are not unique, e.g. for several ACPI zones.
+        if (std::any_of(zones_.begin(), zones_.end(),
+                        [&](const Zone& z) { return z.name == zone.name; })) {
+            zone.name += "-" + std::to_string(index);
+        }
+        zone.type = matchType(kTemperatureTypes, zone.name, TemperatureType::UNKNOWN);
+        zone.temp_fd = openAttribute(path + "temp");
+        float value;
+        if (zone.temp_fd < 0 || !readTemperature(zone.temp_fd, &value)) {
+            LOG(WARNING) << "Skipping thermal zone " << zone.name << " without a temperature";
+            continue;
+        }
+
+        zone.hot_thresholds.fill(NAN);
+        zone.hysteresis.fill(0.0f);
+        for (int trip = 0;; trip++) {
+            const std::string trip_path = path + "trip_point_" + std::to_string(trip) + "_";
+            const std::string trip_type = readAttribute(trip_path + "type");
+            if (trip_type.empty()) {
+                break;
+            }
+            auto severity = kTripTypeSeverities.find(trip_type);
+            int64_t temp;
+            if (severity == kTripTypeSeverities.end() ||
+                !::android::base::ParseInt(readAttribute(trip_path + "temp"), &temp) ||
+                temp <= 0) {
+                continue;
+            }
+            int64_t hyst = 0;
+            ::android::base::ParseInt(readAttribute(trip_path + "hyst"), &hyst);
+            size_t i = static_cast<size_t>(severity->second);
+            float threshold = temp / 1000.0f;
+            if (std::isnan(zone.hot_thresholds[i]) || threshold < zone.hot_thresholds[i]) {
+                zone.hot_thresholds[i] = threshold;
+                zone.hysteresis[i] = std::max(hyst / 1000.0f, kMinHysteresis);
+            }
+        }
+        zones_.push_back(std::move(zone));
+    }
+}
+
+void SysfsThermal::scanCoolingDevices(const std::string& root) {
+    for (int index : listNodes(root, kCoolingDevicePrefix)) {
+        const std::string path = root + "/" + kCoolingDevicePrefix + std::to_string(index) + "/";
+        CoolingDeviceNode cdev;
+        cdev.name = readAttribute(path + "type");
+        if (cdev.name.empty()) {
+            cdev.name = kCoolingDevicePrefix + std::to_string(index);
+        }
+        if (std::any_of(cooling_devices_.begin(), cooling_devices_.end(),
+                        [&](const CoolingDeviceNode& c) { return c.name == cdev.name; })) {
+            cdev.name += "-" + std::to_string(index);
+        }
+        cdev.type = matchType(kCoolingTypes, cdev.name, CoolingType::COMPONENT);
+        cdev.cur_state_fd = openAttribute(path + "cur_state");
+        if (cdev.cur_state_fd < 0) {
+            continue;
+        }
+        cooling_devices_.push_back(std::move(cdev));
+    }
+}
+
+void SysfsThermal::openEventSocket() {
+    unique_fd fd(socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC));
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+    if (fd >= 0 && bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        int group =
+                resolveGenlGroup(fd, THERMAL_GENL_FAMILY_NAME, THERMAL_GENL_EVENT_GROUP_NAME);
+        if (group >= 0 &&
+            setsockopt(fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group, sizeof(group)) == 0) {
+            LOG(INFO) << "Watching thermal genetlink events";
+            event_fd_ = std::move(fd);
+            return;
+        }
+    }
+
+    // Older kernels only send uevents, and only for zones using the user_space governor.
+    fd.reset(socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT));
+    addr.nl_groups = 1;
+    if (fd >= 0 && bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        LOG(INFO) << "Watching thermal uevents";
+        event_fd_ = std::move(fd);
+        event_fd_is_uevent_ = true;
+        return;
+    }
+    PLOG(WARNING) << "No kernel thermal events, polling thermal zones";
+}
+
+bool SysfsThermal::drainEvents() {
+    bool thermal_event = false;
+    alignas(struct nlmsghdr) char buf[8192];
+    while (true) {
+        ssize_t n = TEMP_FAILURE_RETRY(recv(event_fd_, buf, sizeof(buf) - 1, MSG_DONTWAIT));
+        if (n < 0) {
+            if (errno == ENOBUFS) {
+                // Events were dropped, resample to be safe.
+                thermal_event = true;
+                continue;
+            }
+            if (errno != EAGAIN) {
+                PLOG(ERROR) << "Failed to receive thermal events";
+            }
+            return thermal_event;
+        }
+        if (event_fd_is_uevent_) {
+            // A uevent is a sequence of NUL terminated KEY=VALUE strings.
+            buf[n] = '\0';
+            for (const char* s = buf; s < buf + n; s += strlen(s) + 1) {
+                if (strcmp(s, "SUBSYSTEM=thermal") == 0) {
+                    thermal_event = true;
+                }
+            }
+            continue;
+        }
+        size_t len = n;
+        for (auto* hdr = reinterpret_cast<struct nlmsghdr*>(buf); NLMSG_OK(hdr, len);
+             hdr = NLMSG_NEXT(hdr, len)) {
+            if (isTripEvent(hdr)) {
+                thermal_event = true;
+            }
+        }
+    }
+}
+
+void SysfsThermal::watch() {
+    auto next_update = std::chrono::steady_clock::now();
+    bool event_pending = false;
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (event_pending || now >= next_update) {
+            next_update = now + update();
+        }
+        auto timeout =
+                std::chrono::duration_cast<std::chrono::milliseconds>(next_update - now).count();
+        struct pollfd fds[] = {
+                {.fd = stop_fd_, .events = POLLIN},
+                // poll() ignores negative descriptors.
+                {.fd = event_fd_.get(), .events = POLLIN},
+        };
+        if (TEMP_FAILURE_RETRY(poll(fds, std::size(fds), std::max<int64_t>(timeout, 0))) < 0) {
+            PLOG(ERROR) << "Failed to poll thermal events, stop watching thermal zones";
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+        event_pending = (fds[1].revents & (POLLIN | POLLERR)) != 0 && drainEvents();
+    }
+}
+
+std::chrono::milliseconds SysfsThermal::update() {
+    std::vector<Temperature> changes;
+    float distance = kSlowPollDistance;
+    {
+        std::lock_guard<std::mutex> lock(severity_mutex_);
+        for (size_t z = 0; z < zones_.size(); z++) {
+            const Zone& zone = zones_[z];
+            float value;
+            if (!readTemperature(zone.temp_fd, &value)) {
+                continue;
+            }
+            // Severities are entered at their threshold and left below it by their hysteresis.
+            const size_t current = static_cast<size_t>(severities_[z]);
+            size_t entered = 0;
+            size_t held = 0;
+            for (size_t i = 1; i < kSeverityCount; i++) {
+                if (std::isnan(zone.hot_thresholds[i])) {
+                    continue;
+                }
+                if (value >= zone.hot_thresholds[i]) {
+                    entered = i;
+                }
+                if (value > zone.hot_thresholds[i] - zone.hysteresis[i]) {
+                    held = i;
+                }
+            }
+            const size_t severity = entered > current ? entered : std::min(held, current);
+
+            // How far the zone is from the next severity change either way.
+            for (size_t i = severity + 1; i < kSeverityCount; i++) {
+                if (!std::isnan(zone.hot_thresholds[i])) {
+                    distance = std::min(distance, zone.hot_thresholds[i] - value);
+                }
+            }
+            if (severity > 0) {
+                const float release = zone.hot_thresholds[severity] - zone.hysteresis[severity];
+                distance = std::min(distance, value - release);
+            }
+
+            if (severity != current) {
+                severities_[z] = static_cast<ThrottlingSeverity>(severity);
+                changes.push_back({.type = zone.type,
+                                   .name = zone.name,
+                                   .value = value,
+                                   .throttlingStatus = severities_[z]});
+            }
+        }
+    }
+    for (const auto& temperature : changes) {
+        LOG(INFO) << "Thermal zone " << temperature.name << " at " << temperature.value
+                  << "C, throttling " << toString(temperature.throttlingStatus);
+        callback_(temperature);
+    }
+
+    const auto max_interval = event_fd_ >= 0 ? kMaxPollIntervalWithEvents : kMaxPollInterval;
+    const float ratio = std::clamp(distance / kSlowPollDistance, 0.0f, 1.0f);
+    return kMinPollInterval + std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      (max_interval - kMinPollInterval) * ratio);
+}
+
+std::vector<Temperature> SysfsThermal::getTemperatures(std::optional<TemperatureType> type) {
+    std::vector<Temperature> temperatures;
+    std::lock_guard<std::mutex> lock(severity_mutex_);
+    for (size_t z = 0; z < zones_.size(); z++) {
+        const Zone& zone = zones_[z];
+        float value;
+        if ((type && zone.type != *type) || !readTemperature(zone.temp_fd, &value)) {
+            continue;
+        }
+        temperatures.push_back({.type = zone.type,
+                                .name = zone.name,
+                                .value = value,
+                                .throttlingStatus = severities_[z]});
+    }
+    return temperatures;
+}
+
+std::vector<TemperatureThreshold> SysfsThermal::getTemperatureThresholds(
+        std::optional<TemperatureType> type) const {
+    std::vector<TemperatureThreshold> thresholds;
+    for (const auto& zone : zones_) {
+        if (type && zone.type != *type) {
+            continue;
+        }
+        thresholds.push_back({.type = zone.type,
+                              .name = zone.name,
+                              .hotThrottlingThresholds = std::vector<float>(
+                                      zone.hot_thresholds.begin(), zone.hot_thresholds.end())});
+    }
+    return thresholds;
+}
+
+std::vector<CoolingDevice> SysfsThermal::getCoolingDevices(std::optional<CoolingType> type) const {
+    std::vector<CoolingDevice> devices;
+    for (const auto& cdev : cooling_devices_) {
+        int64_t state;
+        if ((type && cdev.type != *type) || !readInt(cdev.cur_state_fd, &state)) {
+            continue;
+        }
+        devices.push_back({.type = cdev.type, .name = cdev.name, .value = state});
+    }
+    return devices;
+}
+
+}  // namespace aidl::android::hardware::thermal::impl::example
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <aidl/android/hardware/thermal/CoolingDevice.h>
+#include <aidl/android/hardware/thermal/Temperature.h>
+#include <aidl/android/hardware/thermal/TemperatureThreshold.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+namespace example {
+
+// Thermal zones and cooling devices of the Linux thermal framework, read from sysfs.
+//
+// The trip points of each zone are mapped to throttling severities. A watcher thread samples the
+// zones when the kernel reports a trip crossing (thermal genetlink, or uevents on older kernels)
+// and otherwise polls them, more often the closer a zone is to a severity change. Severity
+// changes are reported to the callback with hysteresis.
+class SysfsThermal {
+  public:
+    using ThrottlingCallback = std::function<void(const Temperature&)>;
+
+    // |root| is normally /sys/class/thermal. |callback| is invoked on the watcher thread. Without
+    // |watch| there is no watcher thread, and the zones are only sampled by update().
+    SysfsThermal(const std::string& root, ThrottlingCallback callback, bool watch = true);
+    ~SysfsThermal();
+
+    // Samples every zone, reports the severity changes and returns the time until the next sample.
+    std::chrono::milliseconds update();
+
+    // Return the entries of |type|, or all of them if |type| is not set.
+    std::vector<Temperature> getTemperatures(std::optional<TemperatureType> type);
+    std::vector<TemperatureThreshold> getTemperatureThresholds(
+            std::optional<TemperatureType> type) const;
+    std::vector<CoolingDevice> getCoolingDevices(std::optional<CoolingType> type) const;
+
+  private:
+    static constexpr size_t kSeverityCount = static_cast<size_t>(ThrottlingSeverity::SHUTDOWN) + 1;
+
+    struct Zone {
+        std::string name;
+        TemperatureType type;
+        ::android::base::unique_fd temp_fd;
+        // Temperature at which each severity is entered, NaN if it has no trip point.
+        std::array<float, kSeverityCount> hot_thresholds;
+        // How far below its threshold the temperature must fall to leave each severity.
+        std::array<float, kSeverityCount> hysteresis;
+    };
+
+    struct CoolingDeviceNode {
+        std::string name;
+        CoolingType type;
+        ::android::base::unique_fd cur_state_fd;
+    };
+
+    void scanZones(const std::string& root);
+    void scanCoolingDevices(const std::string& root);
+    void openEventSocket();
+    // Returns true if the pending kernel events concern the thermal framework.
+    bool drainEvents();
+    void watch();
+
+    const ThrottlingCallback callback_;
+    // Immutable after construction.
+    std::vector<Zone> zones_;
+    std::vector<CoolingDeviceNode> cooling_devices_;
+
+    std::mutex severity_mutex_;
+    std::vector<ThrottlingSeverity> severities_ GUARDED_BY(severity_mutex_);
+
+    ::android::base::unique_fd event_fd_;
+    bool event_fd_is_uevent_ = false;
+    ::android::base::unique_fd stop_fd_;
+    std::thread watcher_;
+};
+
+}  // namespace example
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
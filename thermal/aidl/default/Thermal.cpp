@@ -26,6 +26,8 @@ using ndk::ScopedAStatus;
 
 namespace {
 
+constexpr char kThermalSysfsRoot[] = "/sys/class/thermal";
+
 bool interfacesEqual(const std::shared_ptr<::ndk::ICInterface>& left,
                      const std::shared_ptr<::ndk::ICInterface>& right) {
     if (left == nullptr || right == nullptr || !left->isRemote() || !right->isRemote()) {
@@ -36,82 +38,65 @@ bool interfacesEqual(const std::shared_ptr<::ndk::ICInterface>& left,
 
 }  // namespace
 
-ScopedAStatus Thermal::getCoolingDevices(std::vector<CoolingDevice>* /* out_devices */) {
+Thermal::Thermal() : Thermal(kThermalSysfsRoot, true) {}
+
+Thermal::Thermal(const std::string& sysfs_root, bool watch_sysfs)
+    : sysfs_(
+              sysfs_root,
+              [this](const Temperature& temperature) { notifyThrottling(temperature); },
+              watch_sysfs) {}
+
+ScopedAStatus Thermal::getCoolingDevices(std::vector<CoolingDevice>* out_devices) {
     LOG(VERBOSE) << __func__;
+    *out_devices = sysfs_.getCoolingDevices(std::nullopt);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Thermal::getCoolingDevicesWithType(CoolingType in_type,
-                                                 std::vector<CoolingDevice>* /* out_devices */) {
+                                                 std::vector<CoolingDevice>* out_devices) {
     LOG(VERBOSE) << __func__ << " CoolingType: " << static_cast<int32_t>(in_type);
+    *out_devices = sysfs_.getCoolingDevices(in_type);
     return ScopedAStatus::ok();
 }
 
-ScopedAStatus Thermal::getTemperatures(std::vector<Temperature>* /* out_temperatures */) {
+ScopedAStatus Thermal::getTemperatures(std::vector<Temperature>* out_temperatures) {
     LOG(VERBOSE) << __func__;
+    *out_temperatures = sysfs_.getTemperatures(std::nullopt);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Thermal::getTemperaturesWithType(TemperatureType in_type,
-                                               std::vector<Temperature>* /* out_temperatures */) {
+                                               std::vector<Temperature>* out_temperatures) {
     LOG(VERBOSE) << __func__ << " TemperatureType: " << static_cast<int32_t>(in_type);
+    *out_temperatures = sysfs_.getTemperatures(in_type);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Thermal::getTemperatureThresholds(
-        std::vector<TemperatureThreshold>* /* out_temperatureThresholds */) {
+        std::vector<TemperatureThreshold>* out_temperatureThresholds) {
     LOG(VERBOSE) << __func__;
+    *out_temperatureThresholds = sysfs_.getTemperatureThresholds(std::nullopt);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Thermal::getTemperatureThresholdsWithType(
-        TemperatureType in_type,
-        std::vector<TemperatureThreshold>* /* out_temperatureThresholds */) {
+        TemperatureType in_type, std::vector<TemperatureThreshold>* out_temperatureThresholds) {
     LOG(VERBOSE) << __func__ << " TemperatureType: " << static_cast<int32_t>(in_type);
+    *out_temperatureThresholds = sysfs_.getTemperatureThresholds(in_type);
     return ScopedAStatus::ok();
 }
 
 ScopedAStatus Thermal::registerThermalChangedCallback(
         const std::shared_ptr<IThermalChangedCallback>& in_callback) {
     LOG(VERBOSE) << __func__ << " IThermalChangedCallback: " << in_callback;
-    if (in_callback == nullptr) {
-        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
-                                                                "Invalid nullptr callback");
-    }
-    {
-        std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
-        if (std::any_of(thermal_callbacks_.begin(), thermal_callbacks_.end(),
-                        [&](const std::shared_ptr<IThermalChangedCallback>& c) {
-                            return interfacesEqual(c, in_callback);
-                        })) {
-            return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
-                                                                    "Callback already registered");
-        }
-        thermal_callbacks_.push_back(in_callback);
-    }
-    return ScopedAStatus::ok();
+    return registerCallback(in_callback, std::nullopt);
 }
 
 ScopedAStatus Thermal::registerThermalChangedCallbackWithType(
         const std::shared_ptr<IThermalChangedCallback>& in_callback, TemperatureType in_type) {
     LOG(VERBOSE) << __func__ << " IThermalChangedCallback: " << in_callback
                  << ", TemperatureType: " << static_cast<int32_t>(in_type);
-    if (in_callback == nullptr) {
-        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
-                                                                "Invalid nullptr callback");
-    }
-    {
-        std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
-        if (std::any_of(thermal_callbacks_.begin(), thermal_callbacks_.end(),
-                        [&](const std::shared_ptr<IThermalChangedCallback>& c) {
-                            return interfacesEqual(c, in_callback);
-                        })) {
-            return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
-                                                                    "Callback already registered");
-        }
-        thermal_callbacks_.push_back(in_callback);
-    }
-    return ScopedAStatus::ok();
+    return registerCallback(in_callback, in_type);
 }
 
 ScopedAStatus Thermal::unregisterThermalChangedCallback(
@@ -126,8 +111,8 @@ ScopedAStatus Thermal::unregisterThermalChangedCallback(
         bool removed = false;
         thermal_callbacks_.erase(
                 std::remove_if(thermal_callbacks_.begin(), thermal_callbacks_.end(),
-                               [&](const std::shared_ptr<IThermalChangedCallback>& c) {
-                                   if (interfacesEqual(c, in_callback)) {
+                               [&](const CallbackSetting& c) {
+                                   if (interfacesEqual(c.callback, in_callback)) {
                                        removed = true;
                                        return true;
                                    }
@@ -142,4 +127,51 @@ ScopedAStatus Thermal::unregisterThermalChangedCallback(
     return ScopedAStatus::ok();
 }
 
+ScopedAStatus Thermal::registerCallback(
+        const std::shared_ptr<IThermalChangedCallback>& in_callback,
+        std::optional<TemperatureType> in_type) {
+    if (in_callback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                "Invalid nullptr callback");
+    }
+    {
+        std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
+        if (std::any_of(thermal_callbacks_.begin(), thermal_callbacks_.end(),
+                        [&](const CallbackSetting& c) {
+                            return interfacesEqual(c.callback, in_callback);
+                        })) {
+            return ndk::ScopedAStatus::fromExceptionCodeWithMessage(EX_ILLEGAL_ARGUMENT,
+                                                                    "Callback already registered");
+        }
+        thermal_callbacks_.push_back({in_callback, in_type});
+    }
+    // Report the zones which are already throttling, as they will not change soon.
+    for (const auto& temperature : sysfs_.getTemperatures(in_type)) {
+        if (temperature.throttlingStatus != ThrottlingSeverity::NONE) {
+            in_callback->notifyThrottling(temperature);
+        }
+    }
+    return ScopedAStatus::ok();
+}
+
+void Thermal::notifyThrottling(const Temperature& temperature) {
+    std::vector<std::shared_ptr<IThermalChangedCallback>> callbacks;
+    {
+        std::lock_guard<std::mutex> _lock(thermal_callback_mutex_);
+        for (const auto& c : thermal_callbacks_) {
+            if (!c.type || *c.type == temperature.type) {
+                callbacks.push_back(c.callback);
+            }
+        }
+    }
+    // The callbacks are oneway, but are called without the lock in case they are local.
+    for (const auto& callback : callbacks) {
+        ScopedAStatus status = callback->notifyThrottling(temperature);
+        if (!status.isOk()) {
+            LOG(ERROR) << "Failed to notify throttling of " << temperature.name << ": "
+                       << status.getMessage();
+        }
+    }
+}
+
 }  // namespace aidl::android::hardware::thermal::impl::example
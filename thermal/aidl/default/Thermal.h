@@ -16,10 +16,13 @@
 
 #pragma once
 
+#include <optional>
 #include <set>
 
 #include <aidl/android/hardware/thermal/BnThermal.h>
 
+#include "SysfsThermal.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -29,6 +32,10 @@ namespace example {
 
 class Thermal : public BnThermal {
   public:
+    Thermal();
+    // Reads the thermal zones from |sysfs_root| rather than /sys/class/thermal.
+    Thermal(const std::string& sysfs_root, bool watch_sysfs);
+
     ndk::ScopedAStatus getCoolingDevices(std::vector<CoolingDevice>* out_devices) override;
     ndk::ScopedAStatus getCoolingDevicesWithType(CoolingType in_type,
                                                  std::vector<CoolingDevice>* out_devices) override;
@@ -54,8 +61,22 @@ class Thermal : public BnThermal {
             const std::shared_ptr<IThermalChangedCallback>& in_callback) override;
 
   private:
+    friend class ThermalTest;
+
+    struct CallbackSetting {
+        std::shared_ptr<IThermalChangedCallback> callback;
+        // Only temperatures of this type are reported, if set.
+        std::optional<TemperatureType> type;
+    };
+
+    ndk::ScopedAStatus registerCallback(const std::shared_ptr<IThermalChangedCallback>& in_callback,
+                                        std::optional<TemperatureType> in_type);
+    void notifyThrottling(const Temperature& temperature);
+
     std::mutex thermal_callback_mutex_;
-    std::vector<std::shared_ptr<IThermalChangedCallback>> thermal_callbacks_;
+    std::vector<CallbackSetting> thermal_callbacks_;
+    // Declared last so that its watcher thread stops before the callbacks are destroyed.
+    SysfsThermal sysfs_;
 };
 
 }  // namespace example
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SysfsThermal.h"
+#include "Thermal.h"
+
+#include <aidl/android/hardware/thermal/BnThermalChangedCallback.h>
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace thermal {
+namespace impl {
+namespace example {
+
+using ::android::base::TemporaryDir;
+using ::android::base::WriteStringToFile;
+
+struct TripPoint {
+    std::string type;
+    int temp;
+    int hyst;
+};
+
+/* A /sys/class/thermal tree, whose zones are sampled when the test calls update(). */
+class FakeThermalTree {
+  public:
+    const std::string& root() const { return mRoot; }
+
+    void addZone(int index, const std::string& type, int temp,
+                 const std::vector<TripPoint>& trips = {}) {
+        const std::string path = zonePath(index);
+        ASSERT_EQ(0, mkdir(path.c_str(), 0700));
+        ASSERT_TRUE(WriteStringToFile(type + "\n", path + "/type"));
+        setTemperature(index, temp);
+        for (size_t i = 0; i < trips.size(); i++) {
+            const std::string trip = path + "/trip_point_" + std::to_string(i) + "_";
+            ASSERT_TRUE(WriteStringToFile(trips[i].type + "\n", trip + "type"));
+            ASSERT_TRUE(WriteStringToFile(std::to_string(trips[i].temp) + "\n", trip + "temp"));
+            ASSERT_TRUE(WriteStringToFile(std::to_string(trips[i].hyst) + "\n", trip + "hyst"));
+        }
+    }
+
+    void addCoolingDevice(int index, const std::string& type, int state) {
+        const std::string path = mRoot + "/cooling_device" + std::to_string(index);
+        ASSERT_EQ(0, mkdir(path.c_str(), 0700));
+        ASSERT_TRUE(WriteStringToFile(type + "\n", path + "/type"));
+        ASSERT_TRUE(WriteStringToFile(std::to_string(state) + "\n", path + "/cur_state"));
+    }
+
+    /* |temp| is in millidegrees Celsius, as in sysfs. */
+    void setTemperature(int index, int temp) {
+        ASSERT_TRUE(WriteStringToFile(std::to_string(temp) + "\n", zonePath(index) + "/temp"));
+    }
+
+  private:
+    std::string zonePath(int index) const {
+        return mRoot + "/thermal_zone" + std::to_string(index);
+    }
+
+    TemporaryDir mDir;
+    const std::string mRoot = mDir.path;
+};
+
+class SysfsThermalTest : public ::testing::Test {
+  protected:
+    void start() {
+        mSysfs = std::make_unique<SysfsThermal>(
+                mTree.root(),
+                [this](const Temperature& temperature) { mNotified.push_back(temperature); },
+                false);
+    }
+
+    /* Samples the zones at |temp| and returns the severity changes reported. */
+    std::vector<Temperature> sample(int index, int temp) {
+        mTree.setTemperature(index, temp);
+        mNotified.clear();
+        mSysfs->update();
+        return mNotified;
+    }
+
+    ThrottlingSeverity severityOf(const std::string& name) {
+        for (const auto& temperature : mSysfs->getTemperatures(std::nullopt)) {
+            if (temperature.name == name) return temperature.throttlingStatus;
+        }
+        ADD_FAILURE() << "No zone " << name;
+        return ThrottlingSeverity::NONE;
+    }
+
+    FakeThermalTree mTree;
+    std::unique_ptr<SysfsThermal> mSysfs;
+    std::vector<Temperature> mNotified;
+};
+
+TEST_F(SysfsThermalTest, TripPointsMapToSeverities) {
+    mTree.addZone(0, "cpu-little", 40000,
+                  {{"passive", 85000, 0},
+                   {"active", 75000, 0},
+                   {"active", 70000, 0},
+                   {"hot", 95000, 0},
+                   {"critical", 105000, 0},
+                   {"unknown", 60000, 0},
+                   {"passive", 0, 0}});
+    start();
+
+    const auto thresholds = mSysfs->getTemperatureThresholds(std::nullopt);
+    ASSERT_EQ(1u, thresholds.size());
+    EXPECT_EQ(TemperatureType::CPU, thresholds[0].type);
+    EXPECT_EQ("cpu-little", thresholds[0].name);
+    const auto& hot = thresholds[0].hotThrottlingThresholds;
+    ASSERT_EQ(7u, hot.size());
+    EXPECT_TRUE(std::isnan(hot[static_cast<size_t>(ThrottlingSeverity::NONE)]));
+    // The lowest trip point of a kind wins, and unknown or unset ones are ignored.
+    EXPECT_FLOAT_EQ(70.0f, hot[static_cast<size_t>(ThrottlingSeverity::LIGHT)]);
+    EXPECT_FLOAT_EQ(85.0f, hot[static_cast<size_t>(ThrottlingSeverity::MODERATE)]);
+    EXPECT_TRUE(std::isnan(hot[static_cast<size_t>(ThrottlingSeverity::SEVERE)]));
+    EXPECT_FLOAT_EQ(95.0f, hot[static_cast<size_t>(ThrottlingSeverity::CRITICAL)]);
+    EXPECT_TRUE(std::isnan(hot[static_cast<size_t>(ThrottlingSeverity::EMERGENCY)]));
+    EXPECT_FLOAT_EQ(105.0f, hot[static_cast<size_t>(ThrottlingSeverity::SHUTDOWN)]);
+}
+
+TEST_F(SysfsThermalTest, SeverityRisesAtTripPoints) {
+    mTree.addZone(0, "soc", 40000,
+                  {{"active", 70000, 0}, {"passive", 85000, 0}, {"critical", 105000, 0}});
+    start();
+
+    EXPECT_TRUE(sample(0, 69999).empty());
+    auto changes = sample(0, 70000);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(TemperatureType::SOC, changes[0].type);
+    EXPECT_EQ("soc", changes[0].name);
+    EXPECT_FLOAT_EQ(70.0f, changes[0].value);
+    EXPECT_EQ(ThrottlingSeverity::LIGHT, changes[0].throttlingStatus);
+
+    // Crossing several trip points at once reports the highest.
+    changes = sample(0, 110000);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(ThrottlingSeverity::SHUTDOWN, changes[0].throttlingStatus);
+    EXPECT_EQ(ThrottlingSeverity::SHUTDOWN, severityOf("soc"));
+}
+
+TEST_F(SysfsThermalTest, HysteresisOnTheWayDown) {
+    mTree.addZone(0, "gpu", 40000, {{"active", 70000, 0}, {"passive", 85000, 5000}});
+    start();
+
+    ASSERT_EQ(1u, sample(0, 90000).size());
+    EXPECT_EQ(ThrottlingSeverity::MODERATE, severityOf("gpu"));
+
+    // Below the trip point, but within its hysteresis.
+    EXPECT_TRUE(sample(0, 84000).empty());
+    EXPECT_TRUE(sample(0, 80500).empty());
+    EXPECT_EQ(ThrottlingSeverity::MODERATE, severityOf("gpu"));
+
+    auto changes = sample(0, 79500);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(ThrottlingSeverity::LIGHT, changes[0].throttlingStatus);
+
+    // Rising again within the hysteresis does not re-enter the severity.
+    EXPECT_TRUE(sample(0, 84000).empty());
+    EXPECT_EQ(ThrottlingSeverity::LIGHT, severityOf("gpu"));
+}
+
+TEST_F(SysfsThermalTest, TripPointsWithoutHysteresisKeepSome) {
+    mTree.addZone(0, "battery", 30000, {{"passive", 45000, 0}});
+    start();
+
+    ASSERT_EQ(1u, sample(0, 45000).size());
+    EXPECT_TRUE(sample(0, 43500).empty());
+    auto changes = sample(0, 42500);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(TemperatureType::BATTERY, changes[0].type);
+    EXPECT_EQ(ThrottlingSeverity::NONE, changes[0].throttlingStatus);
+}
+
+TEST_F(SysfsThermalTest, LowerSeveritiesKeepTheirHysteresis) {
+    mTree.addZone(0, "cpu", 40000,
+                  {{"active", 70000, 2000}, {"passive", 85000, 2000}, {"hot", 95000, 2000}});
+    start();
+
+    ASSERT_EQ(1u, sample(0, 96000).size());
+    EXPECT_EQ(ThrottlingSeverity::CRITICAL, severityOf("cpu"));
+
+    // Leaves CRITICAL, but is still within the hysteresis of MODERATE.
+    auto changes = sample(0, 84000);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(ThrottlingSeverity::MODERATE, changes[0].throttlingStatus);
+
+    changes = sample(0, 60000);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(ThrottlingSeverity::NONE, changes[0].throttlingStatus);
+}
+
+TEST_F(SysfsThermalTest, EntriesAreFilteredByType) {
+    mTree.addZone(0, "cpu", 40000, {{"passive", 85000, 0}});
+    mTree.addZone(1, "gpu", 50000, {{"passive", 90000, 0}});
+    mTree.addZone(2, "mystery", 30000);
+    mTree.addCoolingDevice(0, "thermal-cpufreq-0", 2);
+    mTree.addCoolingDevice(1, "Fan", 1);
+    mTree.addCoolingDevice(2, "mystery", 0);
+    start();
+
+    EXPECT_EQ(3u, mSysfs->getTemperatures(std::nullopt).size());
+    auto temperatures = mSysfs->getTemperatures(TemperatureType::GPU);
+    ASSERT_EQ(1u, temperatures.size());
+    EXPECT_EQ("gpu", temperatures[0].name);
+    EXPECT_FLOAT_EQ(50.0f, temperatures[0].value);
+    temperatures = mSysfs->getTemperatures(TemperatureType::UNKNOWN);
+    ASSERT_EQ(1u, temperatures.size());
+    EXPECT_EQ("mystery", temperatures[0].name);
+    EXPECT_TRUE(mSysfs->getTemperatures(TemperatureType::SKIN).empty());
+
+    const auto thresholds = mSysfs->getTemperatureThresholds(TemperatureType::CPU);
+    ASSERT_EQ(1u, thresholds.size());
+    EXPECT_EQ("cpu", thresholds[0].name);
+
+    EXPECT_EQ(3u, mSysfs->getCoolingDevices(std::nullopt).size());
+    auto devices = mSysfs->getCoolingDevices(CoolingType::CPU);
+    ASSERT_EQ(1u, devices.size());
+    EXPECT_EQ("thermal-cpufreq-0", devices[0].name);
+    EXPECT_EQ(2, devices[0].value);
+    devices = mSysfs->getCoolingDevices(CoolingType::FAN);
+    ASSERT_EQ(1u, devices.size());
+    EXPECT_EQ("Fan", devices[0].name);
+    devices = mSysfs->getCoolingDevices(CoolingType::COMPONENT);
+    ASSERT_EQ(1u, devices.size());
+    EXPECT_EQ("mystery", devices[0].name);
+}
+
+class RecordingCallback : public BnThermalChangedCallback {
+  public:
+    ndk::ScopedAStatus notifyThrottling(const Temperature& temperature) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNames.push_back(temperature.name);
+        return ndk::ScopedAStatus::ok();
+    }
+
+    std::vector<std::string> takeNames() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return std::move(mNames);
+    }
+
+  private:
+    std::mutex mMutex;
+    std::vector<std::string> mNames;
+};
+
+class ThermalTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mTree.addZone(0, "cpu", 40000, {{"passive", 85000, 0}});
+        mTree.addZone(1, "gpu", 40000, {{"passive", 85000, 0}});
+        mThermal = ndk::SharedRefBase::make<Thermal>(mTree.root(), false);
+    }
+
+    void sample(int index, int temp) {
+        mTree.setTemperature(index, temp);
+        mThermal->sysfs_.update();
+    }
+
+    FakeThermalTree mTree;
+    std::shared_ptr<Thermal> mThermal;
+};
+
+TEST_F(ThermalTest, CallbacksOnlyReceiveTheirType) {
+    auto cpu = ndk::SharedRefBase::make<RecordingCallback>();
+    auto all = ndk::SharedRefBase::make<RecordingCallback>();
+    ASSERT_TRUE(mThermal->registerThermalChangedCallbackWithType(cpu, TemperatureType::CPU).isOk());
+    ASSERT_TRUE(mThermal->registerThermalChangedCallback(all).isOk());
+
+    sample(0, 90000);
+    EXPECT_EQ(std::vector<std::string>{"cpu"}, cpu->takeNames());
+    EXPECT_EQ(std::vector<std::string>{"cpu"}, all->takeNames());
+
+    sample(1, 90000);
+    EXPECT_TRUE(cpu->takeNames().empty());
+    EXPECT_EQ(std::vector<std::string>{"gpu"}, all->takeNames());
+
+    ASSERT_TRUE(mThermal->unregisterThermalChangedCallback(all).isOk());
+    sample(1, 40000);
+    EXPECT_TRUE(all->takeNames().empty());
+}
+
+TEST_F(ThermalTest, RegistrationReportsThrottlingZonesOfItsType) {
+    sample(0, 90000);
+    sample(1, 90000);
+
+    auto gpu = ndk::SharedRefBase::make<RecordingCallback>();
+    ASSERT_TRUE(mThermal->registerThermalChangedCallbackWithType(gpu, TemperatureType::GPU).isOk());
+    EXPECT_EQ(std::vector<std::string>{"gpu"}, gpu->takeNames());
+
+    auto all = ndk::SharedRefBase::make<RecordingCallback>();
+    ASSERT_TRUE(mThermal->registerThermalChangedCallback(all).isOk());
+    EXPECT_EQ((std::vector<std::string>{"cpu", "gpu"}), all->takeNames());
+}
+
+}  // namespace example
+}  // namespace impl
+}  // namespace thermal
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
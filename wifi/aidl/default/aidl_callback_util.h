@@ -65,10 +65,12 @@ class AidlCallbackHandler {
         return true;
     }
 
-    const std::set<std::shared_ptr<CallbackType>>& getCallbacks() {
+    // Returns a snapshot of the callbacks, since they are iterated from the
+    // legacy HAL's event loop while the AIDL threads add and remove them.
+    std::set<std::shared_ptr<CallbackType>> getCallbacks() {
         std::unique_lock<std::mutex> lk(callback_handler_lock_);
-        // unique_lock unlocked here
         return cb_set_;
+        // unique_lock unlocked here
     }
 
     void invalidate() {
@@ -35,13 +35,17 @@ using aidl::android::hardware::wifi::aidl_sync_util::acquireGlobalLock;
  * a) If valid, Invokes the corresponding internal implementation function of
  * the AIDL method.
  * b) If invalid, return without calling the internal implementation function.
+ *
+ * The implementation function runs under the lock returned by the object's
+ * |acquireLock()| method: the global lock for |Wifi|, and the chip lock for
+ * the chip and its child objects.
  */
 
 // Use for AIDL methods which return only an AIDL status.
 template <typename ObjT, typename WorkFuncT, typename... Args>
 ::ndk::ScopedAStatus validateAndCall(ObjT* obj, WifiStatusCode status_code_if_invalid,
                                      WorkFuncT&& work, Args&&... args) {
-    const auto lock = acquireGlobalLock();
+    const auto lock = obj->acquireLock();
     if (obj->isValid()) {
         return (obj->*work)(std::forward<Args>(args)...);
     } else {
@@ -49,12 +53,16 @@ template <typename ObjT, typename WorkFuncT, typename... Args>
     }
 }
 
-// Use for AIDL methods which return only an AIDL status.
-// This version passes the global lock acquired to the body of the method.
+// Use for AIDL methods which return only an AIDL status and restart the
+// legacy HAL.
+// This version also holds the global lock, and passes the object's lock to the
+// body of the method so that it can be released while waiting for the legacy
+// HAL to stop.
 template <typename ObjT, typename WorkFuncT, typename... Args>
 ::ndk::ScopedAStatus validateAndCallWithLock(ObjT* obj, WifiStatusCode status_code_if_invalid,
                                              WorkFuncT&& work, Args&&... args) {
-    auto lock = acquireGlobalLock();
+    const auto global_lock = acquireGlobalLock();
+    auto lock = obj->acquireLock();
     if (obj->isValid()) {
         return (obj->*work)(&lock, std::forward<Args>(args)...);
     } else {
@@ -66,10 +74,10 @@ template <typename ObjT, typename WorkFuncT, typename... Args>
 template <typename ObjT, typename WorkFuncT, typename ReturnT, typename... Args>
 ::ndk::ScopedAStatus validateAndCall(ObjT* obj, WifiStatusCode status_code_if_invalid,
                                      WorkFuncT&& work, ReturnT* ret_val, Args&&... args) {
-    const auto lock = acquireGlobalLock();
+    const auto lock = obj->acquireLock();
     if (obj->isValid()) {
         auto call_pair = (obj->*work)(std::forward<Args>(args)...);
-        *ret_val = call_pair.first;
+        *ret_val = std::move(call_pair.first);
         return std::forward<::ndk::ScopedAStatus>(call_pair.second);
     } else {
         return ndk::ScopedAStatus::fromServiceSpecificError(
@@ -857,42 +857,86 @@ bool convertLegacyVectorOfDebugRxPacketFateToAidl(
     return true;
 }
 
-bool convertLegacyLinkLayerRadioStatsToAidl(
-        const legacy_hal::LinkLayerRadioStats& legacy_radio_stat,
-        StaLinkLayerRadioStats* aidl_radio_stat) {
-    if (!aidl_radio_stat) {
-        return false;
-    }
-    *aidl_radio_stat = {};
-
-    aidl_radio_stat->radioId = legacy_radio_stat.stats.radio;
-    aidl_radio_stat->onTimeInMs = legacy_radio_stat.stats.on_time;
-    aidl_radio_stat->txTimeInMs = legacy_radio_stat.stats.tx_time;
-    aidl_radio_stat->rxTimeInMs = legacy_radio_stat.stats.rx_time;
-    aidl_radio_stat->onTimeInMsForScan = legacy_radio_stat.stats.on_time_scan;
-    aidl_radio_stat->txTimeInMsPerLevel = uintToIntVec(legacy_radio_stat.tx_time_per_levels);
-    aidl_radio_stat->onTimeInMsForNanScan = legacy_radio_stat.stats.on_time_nbd;
-    aidl_radio_stat->onTimeInMsForBgScan = legacy_radio_stat.stats.on_time_gscan;
-    aidl_radio_stat->onTimeInMsForRoamScan = legacy_radio_stat.stats.on_time_roam_scan;
-    aidl_radio_stat->onTimeInMsForPnoScan = legacy_radio_stat.stats.on_time_pno_scan;
-    aidl_radio_stat->onTimeInMsForHs20Scan = legacy_radio_stat.stats.on_time_hs20;
-
-    std::vector<WifiChannelStats> aidl_channel_stats;
-
-    for (const auto& channel_stat : legacy_radio_stat.channel_stats) {
-        WifiChannelStats aidl_channel_stat;
+// The link layer stats helpers below assign every field of their AIDL output,
+// so that a |StaLinkLayerStats| can be converted into repeatedly and its
+// vectors keep their capacity.
+void convertLegacyWmeAcStatToAidl(const legacy_hal::wifi_wmm_ac_stat& legacy_ac_stat,
+                                  StaLinkLayerIfacePacketStats* aidl_pkt_stats,
+                                  StaLinkLayerIfaceContentionTimeStats* aidl_contention_stats) {
+    aidl_pkt_stats->rxMpdu = legacy_ac_stat.rx_mpdu;
+    aidl_pkt_stats->txMpdu = legacy_ac_stat.tx_mpdu;
+    aidl_pkt_stats->lostMpdu = legacy_ac_stat.mpdu_lost;
+    aidl_pkt_stats->retries = legacy_ac_stat.retries;
+    aidl_contention_stats->contentionTimeMinInUsec = legacy_ac_stat.contention_time_min;
+    aidl_contention_stats->contentionTimeMaxInUsec = legacy_ac_stat.contention_time_max;
+    aidl_contention_stats->contentionTimeAvgInUsec = legacy_ac_stat.contention_time_avg;
+    aidl_contention_stats->contentionNumSamples = legacy_ac_stat.contention_num_samples;
+}
+
+void convertLegacyWmeAcStatsToAidl(const legacy_hal::wifi_wmm_ac_stat* legacy_ac_stats,
+                                   StaLinkLayerLinkStats* aidl_link_stats) {
+    convertLegacyWmeAcStatToAidl(legacy_ac_stats[legacy_hal::WIFI_AC_BE],
+                                 &aidl_link_stats->wmeBePktStats,
+                                 &aidl_link_stats->wmeBeContentionTimeStats);
+    convertLegacyWmeAcStatToAidl(legacy_ac_stats[legacy_hal::WIFI_AC_BK],
+                                 &aidl_link_stats->wmeBkPktStats,
+                                 &aidl_link_stats->wmeBkContentionTimeStats);
+    convertLegacyWmeAcStatToAidl(legacy_ac_stats[legacy_hal::WIFI_AC_VI],
+                                 &aidl_link_stats->wmeViPktStats,
+                                 &aidl_link_stats->wmeViContentionTimeStats);
+    convertLegacyWmeAcStatToAidl(legacy_ac_stats[legacy_hal::WIFI_AC_VO],
+                                 &aidl_link_stats->wmeVoPktStats,
+                                 &aidl_link_stats->wmeVoContentionTimeStats);
+}
+
+bool convertLegacyPeerInfoToAidl(const legacy_hal::wifi_peer_info& legacy_peer_info,
+                                 const legacy_hal::wifi_rate_stat* legacy_rate_stats,
+                                 uint32_t num_rate, StaPeerInfo* aidl_peer_info_stats) {
+    aidl_peer_info_stats->staCount = legacy_peer_info.bssload.sta_count;
+    aidl_peer_info_stats->chanUtil = legacy_peer_info.bssload.chan_util;
+    aidl_peer_info_stats->rateStats.resize(num_rate);
+    for (uint32_t i = 0; i < num_rate; i++) {
+        const legacy_hal::wifi_rate_stat& legacy_rate_stat = legacy_rate_stats[i];
+        StaRateStat& rate_stat = aidl_peer_info_stats->rateStats[i];
+        if (!convertLegacyWifiRateInfoToAidl(legacy_rate_stat.rate, &rate_stat.rateInfo)) {
+            return false;
+        }
+        rate_stat.txMpdu = legacy_rate_stat.tx_mpdu;
+        rate_stat.rxMpdu = legacy_rate_stat.rx_mpdu;
+        rate_stat.mpduLost = legacy_rate_stat.mpdu_lost;
+        rate_stat.retries = legacy_rate_stat.retries;
+    }
+    return true;
+}
+
+void convertLegacyRadioStatToAidl(const legacy_hal::wifi_radio_stat& legacy_radio_stat,
+                                  const uint32_t* tx_time_per_levels, uint32_t num_tx_levels,
+                                  const legacy_hal::wifi_channel_stat* channel_stats,
+                                  uint32_t num_channels, StaLinkLayerRadioStats* aidl_radio_stat) {
+    aidl_radio_stat->radioId = legacy_radio_stat.radio;
+    aidl_radio_stat->onTimeInMs = legacy_radio_stat.on_time;
+    aidl_radio_stat->txTimeInMs = legacy_radio_stat.tx_time;
+    aidl_radio_stat->rxTimeInMs = legacy_radio_stat.rx_time;
+    aidl_radio_stat->onTimeInMsForScan = legacy_radio_stat.on_time_scan;
+    aidl_radio_stat->txTimeInMsPerLevel.assign(tx_time_per_levels,
+                                               tx_time_per_levels + num_tx_levels);
+    aidl_radio_stat->onTimeInMsForNanScan = legacy_radio_stat.on_time_nbd;
+    aidl_radio_stat->onTimeInMsForBgScan = legacy_radio_stat.on_time_gscan;
+    aidl_radio_stat->onTimeInMsForRoamScan = legacy_radio_stat.on_time_roam_scan;
+    aidl_radio_stat->onTimeInMsForPnoScan = legacy_radio_stat.on_time_pno_scan;
+    aidl_radio_stat->onTimeInMsForHs20Scan = legacy_radio_stat.on_time_hs20;
+
+    aidl_radio_stat->channelStats.resize(num_channels);
+    for (uint32_t i = 0; i < num_channels; i++) {
+        const legacy_hal::wifi_channel_stat& channel_stat = channel_stats[i];
+        WifiChannelStats& aidl_channel_stat = aidl_radio_stat->channelStats[i];
         aidl_channel_stat.onTimeInMs = channel_stat.on_time;
         aidl_channel_stat.ccaBusyTimeInMs = channel_stat.cca_busy_time;
         aidl_channel_stat.channel.width = WifiChannelWidthInMhz::WIDTH_20;
         aidl_channel_stat.channel.centerFreq = channel_stat.channel.center_freq;
         aidl_channel_stat.channel.centerFreq0 = channel_stat.channel.center_freq0;
         aidl_channel_stat.channel.centerFreq1 = channel_stat.channel.center_freq1;
-        aidl_channel_stats.push_back(aidl_channel_stat);
     }
-
-    aidl_radio_stat->channelStats = aidl_channel_stats;
-
-    return true;
 }
 
 StaLinkLayerLinkStats::StaLinkState convertLegacyMlLinkStateToAidl(wifi_link_state state) {
@@ -904,209 +948,123 @@ StaLinkLayerLinkStats::StaLinkState convertLegacyMlLinkStateToAidl(wifi_link_sta
     return StaLinkLayerLinkStats::StaLinkState::UNKNOWN;
 }
 
-bool convertLegacyLinkLayerMlStatsToAidl(const legacy_hal::LinkLayerMlStats& legacy_ml_stats,
-                                         StaLinkLayerStats* aidl_stats) {
-    if (!aidl_stats) {
-        return false;
-    }
-    *aidl_stats = {};
-    std::vector<StaLinkLayerLinkStats> links;
-    // Iterate over each links
-    for (const auto& link : legacy_ml_stats.links) {
-        StaLinkLayerLinkStats linkStats = {};
-        linkStats.linkId = link.stat.link_id;
-        linkStats.state = convertLegacyMlLinkStateToAidl(link.stat.state);
-        linkStats.radioId = link.stat.radio;
-        linkStats.frequencyMhz = link.stat.frequency;
-        linkStats.beaconRx = link.stat.beacon_rx;
-        linkStats.avgRssiMgmt = link.stat.rssi_mgmt;
-        linkStats.wmeBePktStats.rxMpdu = link.stat.ac[legacy_hal::WIFI_AC_BE].rx_mpdu;
-        linkStats.wmeBePktStats.txMpdu = link.stat.ac[legacy_hal::WIFI_AC_BE].tx_mpdu;
-        linkStats.wmeBePktStats.lostMpdu = link.stat.ac[legacy_hal::WIFI_AC_BE].mpdu_lost;
-        linkStats.wmeBePktStats.retries = link.stat.ac[legacy_hal::WIFI_AC_BE].retries;
-        linkStats.wmeBeContentionTimeStats.contentionTimeMinInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BE].contention_time_min;
-        linkStats.wmeBeContentionTimeStats.contentionTimeMaxInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BE].contention_time_max;
-        linkStats.wmeBeContentionTimeStats.contentionTimeAvgInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BE].contention_time_avg;
-        linkStats.wmeBeContentionTimeStats.contentionNumSamples =
-                link.stat.ac[legacy_hal::WIFI_AC_BE].contention_num_samples;
-        linkStats.wmeBkPktStats.rxMpdu = link.stat.ac[legacy_hal::WIFI_AC_BK].rx_mpdu;
-        linkStats.wmeBkPktStats.txMpdu = link.stat.ac[legacy_hal::WIFI_AC_BK].tx_mpdu;
-        linkStats.wmeBkPktStats.lostMpdu = link.stat.ac[legacy_hal::WIFI_AC_BK].mpdu_lost;
-        linkStats.wmeBkPktStats.retries = link.stat.ac[legacy_hal::WIFI_AC_BK].retries;
-        linkStats.wmeBkContentionTimeStats.contentionTimeMinInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BK].contention_time_min;
-        linkStats.wmeBkContentionTimeStats.contentionTimeMaxInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BK].contention_time_max;
-        linkStats.wmeBkContentionTimeStats.contentionTimeAvgInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_BK].contention_time_avg;
-        linkStats.wmeBkContentionTimeStats.contentionNumSamples =
-                link.stat.ac[legacy_hal::WIFI_AC_BK].contention_num_samples;
-        linkStats.wmeViPktStats.rxMpdu = link.stat.ac[legacy_hal::WIFI_AC_VI].rx_mpdu;
-        linkStats.wmeViPktStats.txMpdu = link.stat.ac[legacy_hal::WIFI_AC_VI].tx_mpdu;
-        linkStats.wmeViPktStats.lostMpdu = link.stat.ac[legacy_hal::WIFI_AC_VI].mpdu_lost;
-        linkStats.wmeViPktStats.retries = link.stat.ac[legacy_hal::WIFI_AC_VI].retries;
-        linkStats.wmeViContentionTimeStats.contentionTimeMinInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VI].contention_time_min;
-        linkStats.wmeViContentionTimeStats.contentionTimeMaxInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VI].contention_time_max;
-        linkStats.wmeViContentionTimeStats.contentionTimeAvgInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VI].contention_time_avg;
-        linkStats.wmeViContentionTimeStats.contentionNumSamples =
-                link.stat.ac[legacy_hal::WIFI_AC_VI].contention_num_samples;
-        linkStats.wmeVoPktStats.rxMpdu = link.stat.ac[legacy_hal::WIFI_AC_VO].rx_mpdu;
-        linkStats.wmeVoPktStats.txMpdu = link.stat.ac[legacy_hal::WIFI_AC_VO].tx_mpdu;
-        linkStats.wmeVoPktStats.lostMpdu = link.stat.ac[legacy_hal::WIFI_AC_VO].mpdu_lost;
-        linkStats.wmeVoPktStats.retries = link.stat.ac[legacy_hal::WIFI_AC_VO].retries;
-        linkStats.wmeVoContentionTimeStats.contentionTimeMinInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VO].contention_time_min;
-        linkStats.wmeVoContentionTimeStats.contentionTimeMaxInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VO].contention_time_max;
-        linkStats.wmeVoContentionTimeStats.contentionTimeAvgInUsec =
-                link.stat.ac[legacy_hal::WIFI_AC_VO].contention_time_avg;
-        linkStats.wmeVoContentionTimeStats.contentionNumSamples =
-                link.stat.ac[legacy_hal::WIFI_AC_VO].contention_num_samples;
-        linkStats.timeSliceDutyCycleInPercent = link.stat.time_slicing_duty_cycle_percent;
-        // peer info legacy_stats conversion.
-        std::vector<StaPeerInfo> aidl_peers_info_stats;
-        for (const auto& legacy_peer_info_stats : link.peers) {
-            StaPeerInfo aidl_peer_info_stats;
-            if (!convertLegacyPeerInfoStatsToAidl(legacy_peer_info_stats, &aidl_peer_info_stats)) {
-                return false;
-            }
-            aidl_peers_info_stats.push_back(aidl_peer_info_stats);
-        }
-        linkStats.peers = aidl_peers_info_stats;
-        // Push link stats to aidl stats.
-        links.push_back(linkStats);
-    }
-    aidl_stats->iface.links = links;
-    // radio legacy_stats conversion.
-    std::vector<StaLinkLayerRadioStats> aidl_radios_stats;
-    for (const auto& legacy_radio_stats : legacy_ml_stats.radios) {
-        StaLinkLayerRadioStats aidl_radio_stats;
-        if (!convertLegacyLinkLayerRadioStatsToAidl(legacy_radio_stats, &aidl_radio_stats)) {
+void convertLegacyIfaceStatToAidl(const legacy_hal::wifi_iface_stat& legacy_iface_stat,
+                                  StaLinkLayerLinkStats* aidl_link_stats) {
+    aidl_link_stats->linkId = 0;
+    aidl_link_stats->state = StaLinkLayerLinkStats::StaLinkState::UNKNOWN;
+    aidl_link_stats->radioId = 0;
+    aidl_link_stats->frequencyMhz = 0;
+    aidl_link_stats->beaconRx = legacy_iface_stat.beacon_rx;
+    aidl_link_stats->avgRssiMgmt = legacy_iface_stat.rssi_mgmt;
+    convertLegacyWmeAcStatsToAidl(legacy_iface_stat.ac, aidl_link_stats);
+    aidl_link_stats->timeSliceDutyCycleInPercent =
+            legacy_iface_stat.info.time_slicing_duty_cycle_percent;
+}
+
+void convertLegacyLinkStatToAidl(const legacy_hal::wifi_link_stat& legacy_link_stat,
+                                 StaLinkLayerLinkStats* aidl_link_stats) {
+    aidl_link_stats->linkId = legacy_link_stat.link_id;
+    aidl_link_stats->state = convertLegacyMlLinkStateToAidl(legacy_link_stat.state);
+    aidl_link_stats->radioId = legacy_link_stat.radio;
+    aidl_link_stats->frequencyMhz = legacy_link_stat.frequency;
+    aidl_link_stats->beaconRx = legacy_link_stat.beacon_rx;
+    aidl_link_stats->avgRssiMgmt = legacy_link_stat.rssi_mgmt;
+    convertLegacyWmeAcStatsToAidl(legacy_link_stat.ac, aidl_link_stats);
+    aidl_link_stats->timeSliceDutyCycleInPercent = legacy_link_stat.time_slicing_duty_cycle_percent;
+}
+
+// Converts |num_peers| peers packed back to back, each followed by its rate
+// stats, and advances |legacy_peer_ptr| past them.
+bool convertLegacyPackedPeerInfosToAidl(const legacy_hal::wifi_peer_info** legacy_peer_ptr,
+                                        uint32_t num_peers, std::vector<StaPeerInfo>* aidl_peers) {
+    const legacy_hal::wifi_peer_info* peer = *legacy_peer_ptr;
+    aidl_peers->resize(num_peers);
+    for (uint32_t i = 0; i < num_peers; i++) {
+        if (!convertLegacyPeerInfoToAidl(*peer, peer->rate_stats, peer->num_rate,
+                                         &(*aidl_peers)[i])) {
             return false;
         }
-        aidl_radios_stats.push_back(aidl_radio_stats);
+        peer = reinterpret_cast<const legacy_hal::wifi_peer_info*>(
+                reinterpret_cast<const uint8_t*>(peer) + sizeof(legacy_hal::wifi_peer_info) +
+                sizeof(legacy_hal::wifi_rate_stat) * peer->num_rate);
     }
-    aidl_stats->radios = aidl_radios_stats;
-    aidl_stats->timeStampInMs = ::android::uptimeMillis();
-
+    *legacy_peer_ptr = peer;
     return true;
 }
 
-bool convertLegacyLinkLayerStatsToAidl(const legacy_hal::LinkLayerStats& legacy_stats,
-                                       StaLinkLayerStats* aidl_stats) {
+// Converts |num_radios| radio stats packed back to back, each followed by its
+// channel stats.
+void convertLegacyPackedRadioStatsToAidl(int num_radios,
+                                         const legacy_hal::wifi_radio_stat* legacy_radio_stats,
+                                         std::vector<StaLinkLayerRadioStats>* aidl_radios) {
+    if (num_radios <= 0 || legacy_radio_stats == nullptr) {
+        LOG(ERROR) << "Invalid radio stats in link layer stats";
+        aidl_radios->clear();
+        return;
+    }
+    const legacy_hal::wifi_radio_stat* radio = legacy_radio_stats;
+    aidl_radios->resize(num_radios);
+    for (int i = 0; i < num_radios; i++) {
+        uint32_t num_tx_levels = radio->tx_time_per_levels != nullptr ? radio->num_tx_levels : 0;
+        convertLegacyRadioStatToAidl(*radio, radio->tx_time_per_levels, num_tx_levels,
+                                     radio->channels, radio->num_channels, &(*aidl_radios)[i]);
+        radio = reinterpret_cast<const legacy_hal::wifi_radio_stat*>(
+                reinterpret_cast<const uint8_t*>(radio) + sizeof(legacy_hal::wifi_radio_stat) +
+                sizeof(legacy_hal::wifi_channel_stat) * radio->num_channels);
+    }
+}
+
+bool convertLegacyPackedLinkLayerStatsToAidl(const legacy_hal::wifi_iface_stat* iface_stats,
+                                             int num_radios,
+                                             const legacy_hal::wifi_radio_stat* radio_stats,
+                                             StaLinkLayerStats* aidl_stats) {
     if (!aidl_stats) {
         return false;
     }
-    *aidl_stats = {};
-    std::vector<StaLinkLayerLinkStats> links;
-    StaLinkLayerLinkStats linkStats = {};
-    // iface legacy_stats conversion.
-    linkStats.linkId = 0;
-    linkStats.beaconRx = legacy_stats.iface.beacon_rx;
-    linkStats.avgRssiMgmt = legacy_stats.iface.rssi_mgmt;
-    linkStats.wmeBePktStats.rxMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].rx_mpdu;
-    linkStats.wmeBePktStats.txMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].tx_mpdu;
-    linkStats.wmeBePktStats.lostMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].mpdu_lost;
-    linkStats.wmeBePktStats.retries = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].retries;
-    linkStats.wmeBeContentionTimeStats.contentionTimeMinInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].contention_time_min;
-    linkStats.wmeBeContentionTimeStats.contentionTimeMaxInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].contention_time_max;
-    linkStats.wmeBeContentionTimeStats.contentionTimeAvgInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].contention_time_avg;
-    linkStats.wmeBeContentionTimeStats.contentionNumSamples =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].contention_num_samples;
-    linkStats.wmeBkPktStats.rxMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].rx_mpdu;
-    linkStats.wmeBkPktStats.txMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].tx_mpdu;
-    linkStats.wmeBkPktStats.lostMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].mpdu_lost;
-    linkStats.wmeBkPktStats.retries = legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].retries;
-    linkStats.wmeBkContentionTimeStats.contentionTimeMinInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].contention_time_min;
-    linkStats.wmeBkContentionTimeStats.contentionTimeMaxInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].contention_time_max;
-    linkStats.wmeBkContentionTimeStats.contentionTimeAvgInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].contention_time_avg;
-    linkStats.wmeBkContentionTimeStats.contentionNumSamples =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_BK].contention_num_samples;
-    linkStats.wmeViPktStats.rxMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].rx_mpdu;
-    linkStats.wmeViPktStats.txMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].tx_mpdu;
-    linkStats.wmeViPktStats.lostMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].mpdu_lost;
-    linkStats.wmeViPktStats.retries = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].retries;
-    linkStats.wmeViContentionTimeStats.contentionTimeMinInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].contention_time_min;
-    linkStats.wmeViContentionTimeStats.contentionTimeMaxInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].contention_time_max;
-    linkStats.wmeViContentionTimeStats.contentionTimeAvgInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].contention_time_avg;
-    linkStats.wmeViContentionTimeStats.contentionNumSamples =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VI].contention_num_samples;
-    linkStats.wmeVoPktStats.rxMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].rx_mpdu;
-    linkStats.wmeVoPktStats.txMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].tx_mpdu;
-    linkStats.wmeVoPktStats.lostMpdu = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].mpdu_lost;
-    linkStats.wmeVoPktStats.retries = legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].retries;
-    linkStats.wmeVoContentionTimeStats.contentionTimeMinInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].contention_time_min;
-    linkStats.wmeVoContentionTimeStats.contentionTimeMaxInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].contention_time_max;
-    linkStats.wmeVoContentionTimeStats.contentionTimeAvgInUsec =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].contention_time_avg;
-    linkStats.wmeVoContentionTimeStats.contentionNumSamples =
-            legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].contention_num_samples;
-    linkStats.timeSliceDutyCycleInPercent = legacy_stats.iface.info.time_slicing_duty_cycle_percent;
-    // peer info legacy_stats conversion.
-    std::vector<StaPeerInfo> aidl_peers_info_stats;
-    for (const auto& legacy_peer_info_stats : legacy_stats.peers) {
-        StaPeerInfo aidl_peer_info_stats;
-        if (!convertLegacyPeerInfoStatsToAidl(legacy_peer_info_stats, &aidl_peer_info_stats)) {
+    std::vector<StaLinkLayerLinkStats>& links = aidl_stats->iface.links;
+    links.resize(1);
+    if (iface_stats != nullptr) {
+        convertLegacyIfaceStatToAidl(*iface_stats, &links[0]);
+        const legacy_hal::wifi_peer_info* peer = iface_stats->peer_info;
+        if (!convertLegacyPackedPeerInfosToAidl(&peer, iface_stats->num_peers,
+                                                &links[0].peers)) {
             return false;
         }
-        aidl_peers_info_stats.push_back(aidl_peer_info_stats);
-    }
-    linkStats.peers = aidl_peers_info_stats;
-    links.push_back(linkStats);
-    aidl_stats->iface.links = links;
-    // radio legacy_stats conversion.
-    std::vector<StaLinkLayerRadioStats> aidl_radios_stats;
-    for (const auto& legacy_radio_stats : legacy_stats.radios) {
-        StaLinkLayerRadioStats aidl_radio_stats;
-        if (!convertLegacyLinkLayerRadioStatsToAidl(legacy_radio_stats, &aidl_radio_stats)) {
-            return false;
-        }
-        aidl_radios_stats.push_back(aidl_radio_stats);
+    } else {
+        LOG(ERROR) << "Invalid iface stats in link layer stats";
+        links[0] = {};
     }
-    aidl_stats->radios = aidl_radios_stats;
+    convertLegacyPackedRadioStatsToAidl(num_radios, radio_stats, &aidl_stats->radios);
     aidl_stats->timeStampInMs = ::android::uptimeMillis();
     return true;
 }
 
-bool convertLegacyPeerInfoStatsToAidl(const legacy_hal::WifiPeerInfo& legacy_peer_info_stats,
-                                      StaPeerInfo* aidl_peer_info_stats) {
-    if (!aidl_peer_info_stats) {
+bool convertLegacyPackedLinkLayerMlStatsToAidl(const legacy_hal::wifi_iface_ml_stat* iface_ml_stats,
+                                               int num_radios,
+                                               const legacy_hal::wifi_radio_stat* radio_stats,
+                                               StaLinkLayerStats* aidl_stats) {
+    if (!aidl_stats) {
         return false;
     }
-    *aidl_peer_info_stats = {};
-    aidl_peer_info_stats->staCount = legacy_peer_info_stats.peer_info.bssload.sta_count;
-    aidl_peer_info_stats->chanUtil = legacy_peer_info_stats.peer_info.bssload.chan_util;
-
-    std::vector<StaRateStat> aidlRateStats;
-    for (const auto& legacy_rate_stats : legacy_peer_info_stats.rate_stats) {
-        StaRateStat rateStat;
-        if (!convertLegacyWifiRateInfoToAidl(legacy_rate_stats.rate, &rateStat.rateInfo)) {
-            return false;
+    std::vector<StaLinkLayerLinkStats>& links = aidl_stats->iface.links;
+    if (iface_ml_stats != nullptr && iface_ml_stats->num_links > 0) {
+        // Each link is followed by its peers, and each peer by its rate stats.
+        const legacy_hal::wifi_link_stat* link = iface_ml_stats->links;
+        links.resize(iface_ml_stats->num_links);
+        for (int l = 0; l < iface_ml_stats->num_links; l++) {
+            convertLegacyLinkStatToAidl(*link, &links[l]);
+            const legacy_hal::wifi_peer_info* peer = link->peer_info;
+            if (!convertLegacyPackedPeerInfosToAidl(&peer, link->num_peers, &links[l].peers)) {
+                return false;
+            }
+            link = reinterpret_cast<const legacy_hal::wifi_link_stat*>(peer);
         }
-        rateStat.txMpdu = legacy_rate_stats.tx_mpdu;
-        rateStat.rxMpdu = legacy_rate_stats.rx_mpdu;
-        rateStat.mpduLost = legacy_rate_stats.mpdu_lost;
-        rateStat.retries = legacy_rate_stats.retries;
-        aidlRateStats.push_back(rateStat);
+    } else {
+        LOG(ERROR) << "Invalid iface stats in link layer stats";
+        links.clear();
     }
-    aidl_peer_info_stats->rateStats = aidlRateStats;
+    convertLegacyPackedRadioStatsToAidl(num_radios, radio_stats, &aidl_stats->radios);
+    aidl_stats->timeStampInMs = ::android::uptimeMillis();
     return true;
 }
 
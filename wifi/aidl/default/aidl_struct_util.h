@@ -90,10 +90,17 @@ bool convertLegacyGscanResultToAidl(const legacy_hal::wifi_scan_result& legacy_s
 bool convertLegacyVectorOfCachedGscanResultsToAidl(
         const std::vector<legacy_hal::wifi_cached_scan_results>& legacy_cached_scan_results,
         std::vector<StaScanData>* aidl_scan_datas);
-bool convertLegacyLinkLayerMlStatsToAidl(const legacy_hal::LinkLayerMlStats& legacy_ml_stats,
-                                         StaLinkLayerStats* aidl_stats);
-bool convertLegacyLinkLayerStatsToAidl(const legacy_hal::LinkLayerStats& legacy_stats,
-                                       StaLinkLayerStats* aidl_stats);
+// Convert the packed stats buffers reported by the legacy HAL in a single pass.
+// |aidl_stats| is overwritten in place, so reusing it across calls reuses the
+// memory of its vectors.
+bool convertLegacyPackedLinkLayerStatsToAidl(const legacy_hal::wifi_iface_stat* iface_stats,
+                                             int num_radios,
+                                             const legacy_hal::wifi_radio_stat* radio_stats,
+                                             StaLinkLayerStats* aidl_stats);
+bool convertLegacyPackedLinkLayerMlStatsToAidl(const legacy_hal::wifi_iface_ml_stat* iface_ml_stats,
+                                               int num_radios,
+                                               const legacy_hal::wifi_radio_stat* radio_stats,
+                                               StaLinkLayerStats* aidl_stats);
 bool convertLegacyRoamingCapabilitiesToAidl(
         const legacy_hal::wifi_roaming_capabilities& legacy_caps,
         StaRoamingCapabilities* aidl_caps);
@@ -184,8 +191,6 @@ uint32_t convertAidlUsableChannelFilterToLegacy(uint32_t aidl_filter_mask);
 bool convertLegacyWifiUsableChannelsToAidl(
         const std::vector<legacy_hal::wifi_usable_channel>& legacy_usable_channels,
         std::vector<WifiUsableChannel>* aidl_usable_channels);
-bool convertLegacyPeerInfoStatsToAidl(const legacy_hal::WifiPeerInfo& legacy_peer_info_stats,
-                                      StaPeerInfo* aidl_peer_info_stats);
 bool convertLegacyWifiRateInfoToAidl(const legacy_hal::wifi_rate& legacy_rate,
                                      WifiRateInfo* aidl_rate);
 bool convertLegacyWifiChipCapabilitiesToAidl(
@@ -17,16 +17,90 @@
 #ifndef AIDL_SYNC_UTIL_H_
 #define AIDL_SYNC_UTIL_H_
 
+#include <functional>
+#include <memory>
 #include <mutex>
 
-// Utility that provides a global lock to synchronize access between
-// the AIDL thread and the legacy HAL's event loop.
+// Synchronization utilities shared by the AIDL threads and the legacy HAL's
+// event loop. Refer to THREADING.README for the locking model.
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace wifi {
 namespace aidl_sync_util {
+// Lock serializing the lifecycle of the HAL (|IWifi| methods and chip
+// reconfiguration).
 std::unique_lock<std::recursive_mutex> acquireGlobalLock();
+
+// Holds a std::function that is replaced from the AIDL threads and invoked
+// from the legacy HAL's event loop.
+//
+// The held function is swapped as a whole under a private mutex which is
+// never held while the function runs. An invocation keeps its own reference
+// to the function, so the slot may be cleared or replaced (including from
+// within the function itself) while a previous function is still running.
+template <typename Signature>
+class CallbackSlot {
+  public:
+    using Function = std::function<Signature>;
+    using FunctionPtr = std::shared_ptr<const Function>;
+
+    CallbackSlot() = default;
+
+    CallbackSlot& operator=(Function function) {
+        FunctionPtr function_ptr;
+        if (function) {
+            function_ptr = std::make_shared<const Function>(std::move(function));
+        }
+        // Destroy the previous function outside the lock.
+        swap(&function_ptr);
+        return *this;
+    }
+
+    CallbackSlot& operator=(std::nullptr_t) {
+        FunctionPtr function_ptr;
+        swap(&function_ptr);
+        return *this;
+    }
+
+    explicit operator bool() const { return load() != nullptr; }
+
+    // Returns the function currently held, or nullptr.
+    FunctionPtr load() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return function_;
+    }
+
+    // Clears the slot and returns the function it held, or nullptr.
+    FunctionPtr take() {
+        FunctionPtr function_ptr;
+        swap(&function_ptr);
+        return function_ptr;
+    }
+
+    // Invokes the held function, if any. Returns true if a function was held.
+    template <typename... Args>
+    bool invoke(Args&&... args) const {
+        const FunctionPtr function_ptr = load();
+        if (!function_ptr) {
+            return false;
+        }
+        (*function_ptr)(std::forward<Args>(args)...);
+        return true;
+    }
+
+  private:
+    void swap(FunctionPtr* function_ptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        function_.swap(*function_ptr);
+    }
+
+    mutable std::mutex mutex_;
+    FunctionPtr function_;
+
+    CallbackSlot(const CallbackSlot&) = delete;
+    CallbackSlot& operator=(const CallbackSlot&) = delete;
+};
 }  // namespace aidl_sync_util
 }  // namespace wifi
 }  // namespace hardware
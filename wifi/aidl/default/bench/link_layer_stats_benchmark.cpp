@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "aidl_struct_util.h"
+
+using ::aidl::android::hardware::wifi::StaLinkLayerStats;
+using ::benchmark::State;
+
+namespace aidl_struct_util = ::aidl::android::hardware::wifi::aidl_struct_util;
+namespace legacy_hal = ::aidl::android::hardware::wifi::legacy_hal;
+
+namespace {
+
+constexpr int kNumRadios = 2;
+constexpr int kNumRatesPerPeer = 16;
+constexpr int kNumTxLevels = 8;
+
+// Multi link stats of an interface, as the packed buffers reported by the
+// legacy HAL.
+struct MlStats {
+    std::vector<uint64_t> iface_buffer;
+    std::vector<uint64_t> radio_buffer;
+    std::vector<uint32_t> tx_time_per_levels;
+
+    const legacy_hal::wifi_iface_ml_stat* iface() const {
+        return reinterpret_cast<const legacy_hal::wifi_iface_ml_stat*>(iface_buffer.data());
+    }
+    const legacy_hal::wifi_radio_stat* radios() const {
+        return reinterpret_cast<const legacy_hal::wifi_radio_stat*>(radio_buffer.data());
+    }
+};
+
+void fillPeer(int index, legacy_hal::wifi_peer_info* peer) {
+    peer->bssload.sta_count = index;
+    peer->bssload.chan_util = index % 100;
+    peer->num_rate = kNumRatesPerPeer;
+    for (int r = 0; r < kNumRatesPerPeer; r++) {
+        legacy_hal::wifi_rate_stat& rate_stat = peer->rate_stats[r];
+        rate_stat.rate.preamble = 2;
+        rate_stat.rate.nss = 1;
+        rate_stat.rate.bw = 2;
+        rate_stat.rate.rateMcsIdx = r % 12;
+        rate_stat.rate.bitrate = 1000 * r;
+        rate_stat.tx_mpdu = index + r;
+        rate_stat.rx_mpdu = index * r;
+    }
+}
+
+void fillRadio(int index, int num_channels, uint32_t* tx_time_per_levels,
+               legacy_hal::wifi_radio_stat* radio) {
+    radio->radio = index;
+    radio->on_time = 1000;
+    radio->tx_time = 100;
+    radio->rx_time = 200;
+    radio->num_tx_levels = kNumTxLevels;
+    radio->tx_time_per_levels = tx_time_per_levels;
+    radio->num_channels = num_channels;
+    for (int c = 0; c < num_channels; c++) {
+        legacy_hal::wifi_channel_stat& channel_stat = radio->channels[c];
+        channel_stat.channel.width = legacy_hal::WIFI_CHAN_WIDTH_20;
+        channel_stat.channel.center_freq = 5180 + 20 * c;
+        channel_stat.channel.center_freq0 = 5180 + 20 * c;
+        channel_stat.on_time = 100 + c;
+        channel_stat.cca_busy_time = c;
+    }
+}
+
+// Builds the stats of |state.range(0)| links with |state.range(1)| peers each,
+// on radios with |state.range(2)| channels each, laid out the way the legacy
+// HAL reports them: each link is followed by its peers, each peer by its rate
+// stats and each radio by its channel stats.
+MlStats makeMlStats(const State& state) {
+    const int num_links = state.range(0);
+    const int num_peers = state.range(1);
+    const int num_channels = state.range(2);
+    const size_t peer_size = sizeof(legacy_hal::wifi_peer_info) +
+                             sizeof(legacy_hal::wifi_rate_stat) * kNumRatesPerPeer;
+    const size_t link_size = sizeof(legacy_hal::wifi_link_stat) + peer_size * num_peers;
+    const size_t radio_size = sizeof(legacy_hal::wifi_radio_stat) +
+                              sizeof(legacy_hal::wifi_channel_stat) * num_channels;
+
+    MlStats stats;
+    stats.iface_buffer.assign(
+            (sizeof(legacy_hal::wifi_iface_ml_stat) + link_size * num_links) / sizeof(uint64_t) + 1,
+            0);
+    auto* iface = reinterpret_cast<legacy_hal::wifi_iface_ml_stat*>(stats.iface_buffer.data());
+    iface->num_links = num_links;
+    uint8_t* next = reinterpret_cast<uint8_t*>(iface->links);
+    for (int l = 0; l < num_links; l++) {
+        auto* link = reinterpret_cast<legacy_hal::wifi_link_stat*>(next);
+        link->link_id = l;
+        link->radio = l % kNumRadios;
+        link->frequency = 5180 + 20 * l;
+        link->num_peers = num_peers;
+        next = reinterpret_cast<uint8_t*>(link->peer_info);
+        for (int p = 0; p < num_peers; p++) {
+            fillPeer(p, reinterpret_cast<legacy_hal::wifi_peer_info*>(next));
+            next += peer_size;
+        }
+    }
+
+    stats.tx_time_per_levels.assign(kNumTxLevels, 10);
+    stats.radio_buffer.assign(radio_size * kNumRadios / sizeof(uint64_t) + 1, 0);
+    next = reinterpret_cast<uint8_t*>(stats.radio_buffer.data());
+    for (int i = 0; i < kNumRadios; i++) {
+        fillRadio(i, num_channels, stats.tx_time_per_levels.data(),
+                  reinterpret_cast<legacy_hal::wifi_radio_stat*>(next));
+        next += radio_size;
+    }
+    return stats;
+}
+
+void setItemsProcessed(State& state) {
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+// Single pass conversion into a new AIDL structure, as done for each AIDL call.
+void BM_ConvertPackedMlStats(State& state) {
+    const MlStats stats = makeMlStats(state);
+    for (auto _ : state) {
+        StaLinkLayerStats aidl_stats;
+        aidl_struct_util::convertLegacyPackedLinkLayerMlStatsToAidl(
+                stats.iface(), kNumRadios, stats.radios(), &aidl_stats);
+        benchmark::DoNotOptimize(aidl_stats);
+    }
+    setItemsProcessed(state);
+}
+BENCHMARK(BM_ConvertPackedMlStats)->Args({1, 1, 8})->Args({3, 32, 32})->Args({3, 128, 64});
+
+// Single pass conversion into a reused AIDL structure, which does not allocate
+// once its vectors have grown to the size of the stats.
+void BM_ConvertPackedMlStatsReused(State& state) {
+    const MlStats stats = makeMlStats(state);
+    StaLinkLayerStats aidl_stats;
+    for (auto _ : state) {
+        aidl_struct_util::convertLegacyPackedLinkLayerMlStatsToAidl(
+                stats.iface(), kNumRadios, stats.radios(), &aidl_stats);
+        benchmark::DoNotOptimize(aidl_stats);
+    }
+    setItemsProcessed(state);
+}
+BENCHMARK(BM_ConvertPackedMlStatsReused)->Args({1, 1, 8})->Args({3, 32, 32})->Args({3, 128, 64});
+
+}  // namespace
+
+BENCHMARK_MAIN();
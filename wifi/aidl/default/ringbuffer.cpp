@@ -18,42 +18,108 @@
 
 #include <android-base/logging.h>
 
+#include <algorithm>
+
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace wifi {
 
-Ringbuffer::Ringbuffer(size_t maxSize) : size_(0), maxSize_(maxSize) {}
+Ringbuffer::Ringbuffer(size_t maxSize)
+    : capacity_(maxSize + std::max(maxSize / kMinExpectedRecordSize, kMinFrames) *
+                                  kFrameHeaderSize),
+      head_(0),
+      used_(0),
+      size_(0),
+      numRecords_(0),
+      firstSequence_(0),
+      maxSize_(maxSize) {}
 
-enum Ringbuffer::AppendStatus Ringbuffer::append(const std::vector<uint8_t>& input) {
-    if (input.size() == 0) {
+enum Ringbuffer::AppendStatus Ringbuffer::append(const uint8_t* data, size_t size) {
+    if (size == 0) {
         return AppendStatus::FAIL_IP_BUFFER_ZERO;
     }
-    if (input.size() > maxSize_) {
-        LOG(INFO) << "Oversized message of " << input.size() << " bytes is dropped";
+    if (size > maxSize_) {
+        LOG(INFO) << "Oversized message of " << size << " bytes is dropped";
         return AppendStatus::FAIL_IP_BUFFER_EXCEEDED_MAXSIZE;
     }
-    data_.push_back(input);
-    size_ += input.size() * sizeof(input[0]);
-    while (size_ > maxSize_) {
-        if (data_.front().size() <= 0 || data_.front().size() > maxSize_) {
-            LOG(ERROR) << "First buffer in the ring buffer is Invalid. Size: "
-                       << data_.front().size();
+    if (!data_) {
+        // Allocated on first use, since most rings are never written to.
+        data_ = std::make_unique<uint8_t[]>(capacity_);
+    }
+    const size_t frameSize = kFrameHeaderSize + size;
+    while (numRecords_ > 0 && (size_ + size > maxSize_ || used_ + frameSize > capacity_)) {
+        if (!popFront()) {
             return AppendStatus::FAIL_RING_BUFFER_CORRUPTED;
         }
-        size_ -= data_.front().size() * sizeof(data_.front()[0]);
-        data_.pop_front();
     }
+    const size_t tail = (head_ + used_) % capacity_;
+    const uint32_t header = static_cast<uint32_t>(size);
+    copyIn(tail, &header, kFrameHeaderSize);
+    copyIn((tail + kFrameHeaderSize) % capacity_, data, size);
+    used_ += frameSize;
+    size_ += size;
+    numRecords_++;
     return AppendStatus::SUCCESS;
 }
 
-const std::list<std::vector<uint8_t>>& Ringbuffer::getData() const {
-    return data_;
+enum Ringbuffer::AppendStatus Ringbuffer::append(const std::vector<uint8_t>& input) {
+    return append(input.data(), input.size());
+}
+
+void Ringbuffer::snapshot(std::vector<uint8_t>* out) const {
+    out->resize(used_);
+    if (used_ > 0) {
+        copyOut(head_, out->data(), used_);
+    }
+}
+
+void Ringbuffer::dropBefore(uint64_t sequence) {
+    if (sequence >= getEndSequence()) {
+        clear();
+        return;
+    }
+    while (firstSequence_ < sequence) {
+        if (!popFront()) {
+            clear();
+            return;
+        }
+    }
 }
 
 void Ringbuffer::clear() {
-    data_.clear();
+    head_ = 0;
+    used_ = 0;
     size_ = 0;
+    firstSequence_ += numRecords_;
+    numRecords_ = 0;
+}
+
+bool Ringbuffer::popFront() {
+    uint32_t frontSize;
+    copyOut(head_, &frontSize, kFrameHeaderSize);
+    if (frontSize == 0 || frontSize > maxSize_ || frontSize > size_) {
+        LOG(ERROR) << "First buffer in the ring buffer is Invalid. Size: " << frontSize;
+        return false;
+    }
+    head_ = (head_ + kFrameHeaderSize + frontSize) % capacity_;
+    used_ -= kFrameHeaderSize + frontSize;
+    size_ -= frontSize;
+    numRecords_--;
+    firstSequence_++;
+    return true;
+}
+
+void Ringbuffer::copyIn(size_t offset, const void* src, size_t size) {
+    const size_t first = std::min(size, capacity_ - offset);
+    memcpy(data_.get() + offset, src, first);
+    memcpy(data_.get(), static_cast<const uint8_t*>(src) + first, size - first);
+}
+
+void Ringbuffer::copyOut(size_t offset, void* dst, size_t size) const {
+    const size_t first = std::min(size, capacity_ - offset);
+    memcpy(dst, data_.get() + offset, first);
+    memcpy(static_cast<uint8_t*>(dst) + first, data_.get(), size - first);
 }
 
 }  // namespace wifi
@@ -17,7 +17,10 @@
 #ifndef RINGBUFFER_H_
 #define RINGBUFFER_H_
 
-#include <list>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
 #include <vector>
 
 namespace aidl {
@@ -27,6 +30,16 @@ namespace wifi {
 
 /**
  * Ringbuffer object used to store debug data.
+ *
+ * Records are framed in one contiguous byte ring, each as a native endian
+ * uint32_t payload length followed by the payload, so appending never
+ * allocates once the ring has been allocated on first use. The ring holds up
+ * to |maxSize| payload bytes, plus room for the frame headers of records of
+ * kMinExpectedRecordSize bytes (and at least kMinFrames headers). The oldest
+ * records are also dropped if headers from smaller records exhaust that room.
+ *
+ * Records are numbered in append order, so that a caller can drop the records
+ * of a snapshot once it has been written out, keeping those appended since.
  */
 class Ringbuffer {
   public:
@@ -38,17 +51,72 @@ class Ringbuffer {
         FAIL_IP_BUFFER_EXCEEDED_MAXSIZE,
         FAIL_RING_BUFFER_CORRUPTED
     };
+    static constexpr size_t kFrameHeaderSize = sizeof(uint32_t);
+    static constexpr size_t kMinFrames = 16;
+    // Smallest record whose frame header is accounted for, a wifi_ring_buffer_entry
+    // header plus a few payload bytes.
+    static constexpr size_t kMinExpectedRecordSize = 16;
+
     explicit Ringbuffer(size_t maxSize);
 
     // Appends the data buffer and deletes from the front until buffer is
     // within |maxSize_|.
+    enum AppendStatus append(const uint8_t* data, size_t size);
     enum AppendStatus append(const std::vector<uint8_t>& input);
-    const std::list<std::vector<uint8_t>>& getData() const;
+    // Copies every record, oldest first and still framed, into |out|. This is a
+    // plain copy of at most two contiguous ranges, cheap enough to do under
+    // the lock that serializes appends.
+    void snapshot(std::vector<uint8_t>* out) const;
+    bool empty() const { return numRecords_ == 0; }
+    size_t getNumRecords() const { return numRecords_; }
+    // Sequence number of the next record to be appended.
+    uint64_t getEndSequence() const { return firstSequence_ + numRecords_; }
+    // Drops the records appended before |sequence|, e.g. those of a snapshot
+    // taken along with getEndSequence().
+    void dropBefore(uint64_t sequence);
     void clear();
 
+    // Calls |fn(payload, size)| for every record of a snapshot, oldest first.
+    // Returns false if a frame is invalid or |fn| returns false.
+    template <typename Fn>
+    static bool forEachRecord(const std::vector<uint8_t>& snapshot, size_t maxSize, Fn fn) {
+        size_t offset = 0;
+        while (offset < snapshot.size()) {
+            uint32_t size;
+            if (snapshot.size() - offset < kFrameHeaderSize) {
+                return false;
+            }
+            memcpy(&size, snapshot.data() + offset, kFrameHeaderSize);
+            offset += kFrameHeaderSize;
+            if (size == 0 || size > maxSize || size > snapshot.size() - offset) {
+                return false;
+            }
+            if (!fn(snapshot.data() + offset, static_cast<size_t>(size))) {
+                return false;
+            }
+            offset += size;
+        }
+        return true;
+    }
+
   private:
-    std::list<std::vector<uint8_t>> data_;
+    // Drops the oldest record. Returns false if its frame is invalid.
+    bool popFront();
+    void copyIn(size_t offset, const void* src, size_t size);
+    void copyOut(size_t offset, void* dst, size_t size) const;
+
+    std::unique_ptr<uint8_t[]> data_;
+    // Size of |data_|, including the space reserved for frame headers.
+    size_t capacity_;
+    // Offset of the oldest frame.
+    size_t head_;
+    // Bytes of |data_| in use, frame headers included.
+    size_t used_;
+    // Payload bytes in use.
     size_t size_;
+    size_t numRecords_;
+    // Sequence number of the oldest record.
+    uint64_t firstSequence_;
     size_t maxSize_;
 };
 
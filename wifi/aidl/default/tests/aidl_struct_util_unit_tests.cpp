@@ -48,6 +48,174 @@ namespace android {
 namespace hardware {
 namespace wifi {
 
+namespace {
+// The link layer stats of an interface as separate elements, which the
+// helpers below lay out in the packed buffers reported by the legacy HAL.
+struct LinkLayerRadioStats {
+    legacy_hal::wifi_radio_stat stats;
+    std::vector<uint32_t> tx_time_per_levels;
+    std::vector<legacy_hal::wifi_channel_stat> channel_stats;
+};
+
+struct WifiPeerInfo {
+    legacy_hal::wifi_peer_info peer_info;
+    std::vector<legacy_hal::wifi_rate_stat> rate_stats;
+};
+
+struct LinkLayerStats {
+    legacy_hal::wifi_iface_stat iface;
+    std::vector<LinkLayerRadioStats> radios;
+    std::vector<WifiPeerInfo> peers;
+};
+
+struct LinkStats {
+    legacy_hal::wifi_link_stat stat;
+    std::vector<WifiPeerInfo> peers;
+};
+
+struct LinkLayerMlStats {
+    legacy_hal::wifi_iface_ml_stat iface;
+    std::vector<LinkStats> links;
+    std::vector<LinkLayerRadioStats> radios;
+};
+
+// Lays out |legacy_stats| the way the legacy HAL reports it, with each peer
+// followed by its rate stats.
+const legacy_hal::wifi_iface_stat* packIfaceStats(const LinkLayerStats& legacy_stats,
+                                                  std::vector<uint64_t>* buffer) {
+    size_t size = sizeof(legacy_hal::wifi_iface_stat);
+    for (const auto& peer : legacy_stats.peers) {
+        size += sizeof(legacy_hal::wifi_peer_info) +
+                sizeof(legacy_hal::wifi_rate_stat) * peer.rate_stats.size();
+    }
+    buffer->assign(size / sizeof(uint64_t) + 1, 0);
+    auto* iface = reinterpret_cast<legacy_hal::wifi_iface_stat*>(buffer->data());
+    *iface = legacy_stats.iface;
+    iface->num_peers = legacy_stats.peers.size();
+    uint8_t* next = reinterpret_cast<uint8_t*>(iface->peer_info);
+    for (const auto& peer : legacy_stats.peers) {
+        auto* peer_info = reinterpret_cast<legacy_hal::wifi_peer_info*>(next);
+        *peer_info = peer.peer_info;
+        peer_info->num_rate = peer.rate_stats.size();
+        std::copy(peer.rate_stats.begin(), peer.rate_stats.end(), peer_info->rate_stats);
+        next += sizeof(legacy_hal::wifi_peer_info) +
+                sizeof(legacy_hal::wifi_rate_stat) * peer.rate_stats.size();
+    }
+    return iface;
+}
+
+// Same as above for multi link stats, where each link is followed by its peers.
+const legacy_hal::wifi_iface_ml_stat* packIfaceMlStats(
+        const LinkLayerMlStats& legacy_ml_stats, std::vector<uint64_t>* buffer) {
+    size_t size = sizeof(legacy_hal::wifi_iface_ml_stat);
+    for (const auto& link : legacy_ml_stats.links) {
+        size += sizeof(legacy_hal::wifi_link_stat);
+        for (const auto& peer : link.peers) {
+            size += sizeof(legacy_hal::wifi_peer_info) +
+                    sizeof(legacy_hal::wifi_rate_stat) * peer.rate_stats.size();
+        }
+    }
+    buffer->assign(size / sizeof(uint64_t) + 1, 0);
+    auto* iface = reinterpret_cast<legacy_hal::wifi_iface_ml_stat*>(buffer->data());
+    *iface = legacy_ml_stats.iface;
+    iface->num_links = legacy_ml_stats.links.size();
+    uint8_t* next = reinterpret_cast<uint8_t*>(iface->links);
+    for (const auto& link : legacy_ml_stats.links) {
+        auto* link_stat = reinterpret_cast<legacy_hal::wifi_link_stat*>(next);
+        *link_stat = link.stat;
+        link_stat->num_peers = link.peers.size();
+        next = reinterpret_cast<uint8_t*>(link_stat->peer_info);
+        for (const auto& peer : link.peers) {
+            auto* peer_info = reinterpret_cast<legacy_hal::wifi_peer_info*>(next);
+            *peer_info = peer.peer_info;
+            peer_info->num_rate = peer.rate_stats.size();
+            std::copy(peer.rate_stats.begin(), peer.rate_stats.end(), peer_info->rate_stats);
+            next += sizeof(legacy_hal::wifi_peer_info) +
+                    sizeof(legacy_hal::wifi_rate_stat) * peer.rate_stats.size();
+        }
+    }
+    return iface;
+}
+
+// Lays out |radios| the way the legacy HAL reports them, with each radio
+// followed by its channel stats. The tx levels stay in |radios|.
+const legacy_hal::wifi_radio_stat* packRadioStats(
+        const std::vector<LinkLayerRadioStats>& radios,
+        std::vector<uint64_t>* buffer) {
+    size_t size = 0;
+    for (const auto& radio : radios) {
+        size += sizeof(legacy_hal::wifi_radio_stat) +
+                sizeof(legacy_hal::wifi_channel_stat) * radio.channel_stats.size();
+    }
+    buffer->assign(size / sizeof(uint64_t) + 1, 0);
+    uint8_t* next = reinterpret_cast<uint8_t*>(buffer->data());
+    for (const auto& radio : radios) {
+        auto* radio_stat = reinterpret_cast<legacy_hal::wifi_radio_stat*>(next);
+        *radio_stat = radio.stats;
+        radio_stat->num_tx_levels = radio.tx_time_per_levels.size();
+        radio_stat->tx_time_per_levels = const_cast<uint32_t*>(radio.tx_time_per_levels.data());
+        radio_stat->num_channels = radio.channel_stats.size();
+        std::copy(radio.channel_stats.begin(), radio.channel_stats.end(), radio_stat->channels);
+        next += sizeof(legacy_hal::wifi_radio_stat) +
+                sizeof(legacy_hal::wifi_channel_stat) * radio.channel_stats.size();
+    }
+    return reinterpret_cast<const legacy_hal::wifi_radio_stat*>(buffer->data());
+}
+
+void fillPeers(int num_peers, std::vector<WifiPeerInfo>* peers) {
+    peers->resize(num_peers);
+    for (int p = 0; p < num_peers; p++) {
+        WifiPeerInfo& peer = (*peers)[p];
+        peer.peer_info.bssload.sta_count = p + 1;
+        peer.peer_info.bssload.chan_util = p + 10;
+        peer.rate_stats.clear();
+        for (int r = 0; r < p + 1; r++) {
+            peer.rate_stats.push_back({.rate = {2, 1, 2, static_cast<uint32_t>(r), 0, 1000},
+                                       .tx_mpdu = static_cast<uint32_t>(p * 100 + r),
+                                       .rx_mpdu = static_cast<uint32_t>(r),
+                                       .mpdu_lost = 1,
+                                       .retries = 2});
+        }
+    }
+}
+
+void fillRadios(int num_radios, std::vector<LinkLayerRadioStats>* radios) {
+    radios->resize(num_radios);
+    for (int i = 0; i < num_radios; i++) {
+        LinkLayerRadioStats& radio = (*radios)[i];
+        radio.stats.radio = i;
+        radio.stats.on_time = 1000 + i;
+        radio.stats.tx_time = 200 + i;
+        radio.stats.rx_time = 300 + i;
+        radio.tx_time_per_levels = {1, 2, 3, 4};
+        radio.channel_stats.clear();
+        for (int c = 0; c < 3; c++) {
+            radio.channel_stats.push_back(
+                    {.channel = {legacy_hal::WIFI_CHAN_WIDTH_20, 5180 + 20 * c, 5180 + 20 * c, 0},
+                     .on_time = static_cast<uint32_t>(100 * c),
+                     .cca_busy_time = static_cast<uint32_t>(10 * c)});
+        }
+    }
+}
+
+bool convertLinkLayerStats(const LinkLayerStats& legacy_stats, StaLinkLayerStats* aidl_stats) {
+    std::vector<uint64_t> iface_buffer;
+    std::vector<uint64_t> radio_buffer;
+    return aidl_struct_util::convertLegacyPackedLinkLayerStatsToAidl(
+            packIfaceStats(legacy_stats, &iface_buffer), legacy_stats.radios.size(),
+            packRadioStats(legacy_stats.radios, &radio_buffer), aidl_stats);
+}
+
+bool convertLinkLayerMlStats(const LinkLayerMlStats& legacy_ml_stats,
+                             StaLinkLayerStats* aidl_stats) {
+    std::vector<uint64_t> iface_buffer;
+    std::vector<uint64_t> radio_buffer;
+    return aidl_struct_util::convertLegacyPackedLinkLayerMlStatsToAidl(
+            packIfaceMlStats(legacy_ml_stats, &iface_buffer), legacy_ml_stats.radios.size(),
+            packRadioStats(legacy_ml_stats.radios, &radio_buffer), aidl_stats);
+}
+}  // namespace
+
 class AidlStructUtilTest : public Test {};
 
 TEST_F(AidlStructUtilTest, CanConvertLegacyWifiMacInfosToAidlWithOneMac) {
@@ -125,20 +293,20 @@ TEST_F(AidlStructUtilTest, CanConvertLegacyWifiMacInfosToAidlWithTwoMac) {
 }
 
 TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerMlStatsToAidl) {
-    legacy_hal::LinkLayerMlStats legacy_ml_stats{};
+    LinkLayerMlStats legacy_ml_stats{};
     // Add two radio stats
-    legacy_ml_stats.radios.push_back(legacy_hal::LinkLayerRadioStats{});
-    legacy_ml_stats.radios.push_back(legacy_hal::LinkLayerRadioStats{});
+    legacy_ml_stats.radios.push_back(LinkLayerRadioStats{});
+    legacy_ml_stats.radios.push_back(LinkLayerRadioStats{});
     wifi_link_state states[sizeof(wifi_link_state)] = {wifi_link_state::WIFI_LINK_STATE_UNKNOWN,
                                                        wifi_link_state::WIFI_LINK_STATE_NOT_IN_USE,
                                                        wifi_link_state::WIFI_LINK_STATE_IN_USE};
     // Add two links.
-    legacy_ml_stats.links.push_back(legacy_hal::LinkStats{});
-    legacy_ml_stats.links.push_back(legacy_hal::LinkStats{});
+    legacy_ml_stats.links.push_back(LinkStats{});
+    legacy_ml_stats.links.push_back(LinkStats{});
     // Set stats for each link.
-    for (legacy_hal::LinkStats& link : legacy_ml_stats.links) {
-        link.peers.push_back(legacy_hal::WifiPeerInfo{});
-        link.peers.push_back(legacy_hal::WifiPeerInfo{});
+    for (LinkStats& link : legacy_ml_stats.links) {
+        link.peers.push_back(WifiPeerInfo{});
+        link.peers.push_back(WifiPeerInfo{});
         link.stat.beacon_rx = rand();
         // MLO link id: 0 - 15
         link.stat.link_id = rand() % 16;
@@ -246,10 +414,10 @@ TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerMlStatsToAidl) {
     }
     // Convert to AIDL
     StaLinkLayerStats converted{};
-    aidl_struct_util::convertLegacyLinkLayerMlStatsToAidl(legacy_ml_stats, &converted);
+    ASSERT_TRUE(convertLinkLayerMlStats(legacy_ml_stats, &converted));
     // Validate
     int l = 0;
-    for (legacy_hal::LinkStats& link : legacy_ml_stats.links) {
+    for (LinkStats& link : legacy_ml_stats.links) {
         EXPECT_EQ(link.stat.link_id, (uint8_t)converted.iface.links[l].linkId);
         StaLinkLayerLinkStats::StaLinkState expectedState;
         switch (link.stat.state) {
@@ -430,11 +598,11 @@ TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerMlStatsToAidl) {
 }
 
 TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerStatsToAidl) {
-    legacy_hal::LinkLayerStats legacy_stats{};
-    legacy_stats.radios.push_back(legacy_hal::LinkLayerRadioStats{});
-    legacy_stats.radios.push_back(legacy_hal::LinkLayerRadioStats{});
-    legacy_stats.peers.push_back(legacy_hal::WifiPeerInfo{});
-    legacy_stats.peers.push_back(legacy_hal::WifiPeerInfo{});
+    LinkLayerStats legacy_stats{};
+    legacy_stats.radios.push_back(LinkLayerRadioStats{});
+    legacy_stats.radios.push_back(LinkLayerRadioStats{});
+    legacy_stats.peers.push_back(WifiPeerInfo{});
+    legacy_stats.peers.push_back(WifiPeerInfo{});
     legacy_stats.iface.beacon_rx = rand();
     // RSSI: 0 to -127
     legacy_stats.iface.rssi_mgmt = rand() % 128;
@@ -534,7 +702,7 @@ TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerStatsToAidl) {
     }
 
     StaLinkLayerStats converted{};
-    aidl_struct_util::convertLegacyLinkLayerStatsToAidl(legacy_stats, &converted);
+    ASSERT_TRUE(convertLinkLayerStats(legacy_stats, &converted));
     EXPECT_EQ(0, converted.iface.links[0].linkId);
     EXPECT_EQ(legacy_stats.iface.beacon_rx, (uint32_t)converted.iface.links[0].beaconRx);
     EXPECT_EQ(legacy_stats.iface.rssi_mgmt, converted.iface.links[0].avgRssiMgmt);
@@ -679,6 +847,60 @@ TEST_F(AidlStructUtilTest, canConvertLegacyLinkLayerStatsToAidl) {
     }
 }
 
+TEST_F(AidlStructUtilTest, CanConvertLegacyLinkLayerStatsIntoReusedAidlStats) {
+    LinkLayerStats legacy_stats{};
+    legacy_stats.iface.beacon_rx = 12;
+    legacy_stats.iface.rssi_mgmt = -60;
+    legacy_stats.iface.ac[legacy_hal::WIFI_AC_BE].rx_mpdu = 34;
+    legacy_stats.iface.ac[legacy_hal::WIFI_AC_VO].contention_time_avg = 56;
+    legacy_stats.iface.info.time_slicing_duty_cycle_percent = 50;
+    fillPeers(3, &legacy_stats.peers);
+    fillRadios(2, &legacy_stats.radios);
+    StaLinkLayerStats converted{};
+    ASSERT_TRUE(convertLinkLayerStats(legacy_stats, &converted));
+
+    // Converting fewer peers and radios into the same object must not leave
+    // any stale entries behind.
+    fillPeers(1, &legacy_stats.peers);
+    fillRadios(1, &legacy_stats.radios);
+    ASSERT_TRUE(convertLinkLayerStats(legacy_stats, &converted));
+    StaLinkLayerStats expected{};
+    ASSERT_TRUE(convertLinkLayerStats(legacy_stats, &expected));
+    expected.timeStampInMs = converted.timeStampInMs;
+    EXPECT_TRUE(expected == converted);
+}
+
+TEST_F(AidlStructUtilTest, CanConvertLegacyLinkLayerMlStatsIntoReusedAidlStats) {
+    LinkLayerMlStats legacy_ml_stats{};
+    legacy_ml_stats.links.resize(2);
+    for (int l = 0; l < 2; l++) {
+        LinkStats& link = legacy_ml_stats.links[l];
+        link.stat.link_id = l;
+        link.stat.state = wifi_link_state::WIFI_LINK_STATE_IN_USE;
+        link.stat.radio = l;
+        link.stat.frequency = 5180 + 20 * l;
+        link.stat.beacon_rx = 100 + l;
+        link.stat.rssi_mgmt = -50 - l;
+        link.stat.ac[legacy_hal::WIFI_AC_BK].tx_mpdu = 7 + l;
+        link.stat.time_slicing_duty_cycle_percent = 40 + l;
+        fillPeers(3 + l, &link.peers);
+    }
+    fillRadios(2, &legacy_ml_stats.radios);
+    StaLinkLayerStats converted{};
+    ASSERT_TRUE(convertLinkLayerMlStats(legacy_ml_stats, &converted));
+
+    // Converting fewer links, peers and radios into the same object must not
+    // leave any stale entries behind.
+    legacy_ml_stats.links.pop_back();
+    fillPeers(1, &legacy_ml_stats.links[0].peers);
+    fillRadios(1, &legacy_ml_stats.radios);
+    ASSERT_TRUE(convertLinkLayerMlStats(legacy_ml_stats, &converted));
+    StaLinkLayerStats expected{};
+    ASSERT_TRUE(convertLinkLayerMlStats(legacy_ml_stats, &expected));
+    expected.timeStampInMs = converted.timeStampInMs;
+    EXPECT_TRUE(expected == converted);
+}
+
 TEST_F(AidlStructUtilTest, CanConvertLegacyFeaturesToAidl) {
     using AidlChipCaps = IWifiChip::FeatureSetMask;
 
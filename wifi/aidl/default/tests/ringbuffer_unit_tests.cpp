@@ -30,10 +30,23 @@ class RingbufferTest : public Test {
   public:
     const uint32_t maxBufferSize_ = 10;
     Ringbuffer buffer_{maxBufferSize_};
+
+    // Decodes the records held by |buffer_|, oldest first.
+    std::vector<std::vector<uint8_t>> getRecords() const {
+        std::vector<uint8_t> snapshot;
+        buffer_.snapshot(&snapshot);
+        std::vector<std::vector<uint8_t>> records;
+        EXPECT_TRUE(Ringbuffer::forEachRecord(snapshot, maxBufferSize_,
+                                              [&](const uint8_t* data, size_t size) {
+                                                  records.emplace_back(data, data + size);
+                                                  return true;
+                                              }));
+        return records;
+    }
 };
 
 TEST_F(RingbufferTest, CreateEmptyBuffer) {
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(getRecords().empty());
 }
 
 TEST_F(RingbufferTest, CanUseFullBufferCapacity) {
@@ -41,9 +54,9 @@ TEST_F(RingbufferTest, CanUseFullBufferCapacity) {
     const std::vector<uint8_t> input2(maxBufferSize_ / 2, '1');
     buffer_.append(input);
     buffer_.append(input2);
-    ASSERT_EQ(2u, buffer_.getData().size());
-    EXPECT_EQ(input, buffer_.getData().front());
-    EXPECT_EQ(input2, buffer_.getData().back());
+    ASSERT_EQ(2u, getRecords().size());
+    EXPECT_EQ(input, getRecords().front());
+    EXPECT_EQ(input2, getRecords().back());
 }
 
 TEST_F(RingbufferTest, OldDataIsRemovedOnOverflow) {
@@ -53,9 +66,9 @@ TEST_F(RingbufferTest, OldDataIsRemovedOnOverflow) {
     buffer_.append(input);
     buffer_.append(input2);
     buffer_.append(input3);
-    ASSERT_EQ(2u, buffer_.getData().size());
-    EXPECT_EQ(input2, buffer_.getData().front());
-    EXPECT_EQ(input3, buffer_.getData().back());
+    ASSERT_EQ(2u, getRecords().size());
+    EXPECT_EQ(input2, getRecords().front());
+    EXPECT_EQ(input3, getRecords().back());
 }
 
 TEST_F(RingbufferTest, MultipleOldDataIsRemovedOnOverflow) {
@@ -65,20 +78,20 @@ TEST_F(RingbufferTest, MultipleOldDataIsRemovedOnOverflow) {
     buffer_.append(input);
     buffer_.append(input2);
     buffer_.append(input3);
-    ASSERT_EQ(1u, buffer_.getData().size());
-    EXPECT_EQ(input3, buffer_.getData().front());
+    ASSERT_EQ(1u, getRecords().size());
+    EXPECT_EQ(input3, getRecords().front());
 }
 
 TEST_F(RingbufferTest, AppendingEmptyBufferDoesNotAddGarbage) {
     const std::vector<uint8_t> input = {};
     buffer_.append(input);
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(getRecords().empty());
 }
 
 TEST_F(RingbufferTest, OversizedAppendIsDropped) {
     const std::vector<uint8_t> input(maxBufferSize_ + 1, '0');
     buffer_.append(input);
-    ASSERT_TRUE(buffer_.getData().empty());
+    ASSERT_TRUE(getRecords().empty());
 }
 
 TEST_F(RingbufferTest, OversizedAppendDoesNotDropExistingData) {
@@ -86,8 +99,98 @@ TEST_F(RingbufferTest, OversizedAppendDoesNotDropExistingData) {
     const std::vector<uint8_t> input2(maxBufferSize_ + 1, '1');
     buffer_.append(input);
     buffer_.append(input2);
-    ASSERT_EQ(1u, buffer_.getData().size());
-    EXPECT_EQ(input, buffer_.getData().front());
+    ASSERT_EQ(1u, getRecords().size());
+    EXPECT_EQ(input, getRecords().front());
+}
+
+TEST_F(RingbufferTest, RecordsWrapAroundTheRing) {
+    // Odd sized records end up split across the end of the ring.
+    for (uint8_t i = 0; i < 100; i++) {
+        ASSERT_EQ(Ringbuffer::AppendStatus::SUCCESS,
+                  buffer_.append(std::vector<uint8_t>(3, i)));
+        const auto records = getRecords();
+        ASSERT_EQ(std::min<size_t>(i + 1, maxBufferSize_ / 3), records.size());
+        EXPECT_EQ(std::vector<uint8_t>(3, i), records.back());
+    }
+}
+
+TEST_F(RingbufferTest, SmallRecordsAreBoundedByFrameSpace) {
+    const size_t maxSize = 1000;
+    const size_t frameSize = Ringbuffer::kFrameHeaderSize + 1;
+    // 1000 payload bytes plus room for the headers of kMinExpectedRecordSize records.
+    const size_t headerSpace =
+            maxSize / Ringbuffer::kMinExpectedRecordSize * Ringbuffer::kFrameHeaderSize;
+    const size_t maxFrames = (maxSize + headerSpace) / frameSize;
+    Ringbuffer buffer(maxSize);
+    for (size_t i = 0; i < maxSize; i++) {
+        ASSERT_EQ(Ringbuffer::AppendStatus::SUCCESS,
+                  buffer.append(std::vector<uint8_t>(1, static_cast<uint8_t>(i))));
+    }
+    EXPECT_EQ(maxFrames, buffer.getNumRecords());
+}
+
+TEST_F(RingbufferTest, ExpectedRecordsFillThePayloadBudget) {
+    const size_t maxSize = 1000;
+    const size_t recordSize = Ringbuffer::kMinExpectedRecordSize;
+    Ringbuffer buffer(maxSize);
+    for (size_t i = 0; i < maxSize; i++) {
+        ASSERT_EQ(Ringbuffer::AppendStatus::SUCCESS,
+                  buffer.append(std::vector<uint8_t>(recordSize, static_cast<uint8_t>(i))));
+    }
+    EXPECT_EQ(maxSize / recordSize, buffer.getNumRecords());
+}
+
+TEST_F(RingbufferTest, DropBeforeKeepsRecordsAppendedAfterTheSnapshot) {
+    const std::vector<uint8_t> first(maxBufferSize_ / 4, '0');
+    const std::vector<uint8_t> second(maxBufferSize_ / 4, '1');
+    const std::vector<uint8_t> third(maxBufferSize_ / 4, '2');
+    buffer_.append(first);
+    buffer_.append(second);
+    const uint64_t snapshotEnd = buffer_.getEndSequence();
+    buffer_.append(third);
+    buffer_.dropBefore(snapshotEnd);
+    ASSERT_EQ(1u, getRecords().size());
+    EXPECT_EQ(third, getRecords().front());
+}
+
+TEST_F(RingbufferTest, DropBeforeSkipsRecordsAlreadyOverwritten) {
+    const std::vector<uint8_t> input(maxBufferSize_ / 2, '0');
+    buffer_.append(input);
+    const uint64_t snapshotEnd = buffer_.getEndSequence();
+    // Pushes the snapshotted record out of the ring.
+    const std::vector<uint8_t> newer1(maxBufferSize_ / 2, '1');
+    const std::vector<uint8_t> newer2(maxBufferSize_ / 2, '2');
+    buffer_.append(newer1);
+    buffer_.append(newer2);
+    buffer_.dropBefore(snapshotEnd);
+    ASSERT_EQ(2u, getRecords().size());
+    EXPECT_EQ(newer1, getRecords().front());
+    EXPECT_EQ(newer2, getRecords().back());
+}
+
+TEST_F(RingbufferTest, SequenceContinuesAfterClear) {
+    buffer_.append(std::vector<uint8_t>(maxBufferSize_ / 2, '0'));
+    buffer_.append(std::vector<uint8_t>(maxBufferSize_ / 2, '1'));
+    EXPECT_EQ(2u, buffer_.getEndSequence());
+    buffer_.clear();
+    EXPECT_EQ(2u, buffer_.getEndSequence());
+    // A stale sequence from before the clear drops nothing appended since.
+    const std::vector<uint8_t> input(maxBufferSize_ / 2, '2');
+    buffer_.append(input);
+    buffer_.dropBefore(1);
+    ASSERT_EQ(1u, getRecords().size());
+    EXPECT_EQ(input, getRecords().front());
+}
+
+TEST_F(RingbufferTest, ClearDropsAllRecords) {
+    buffer_.append(std::vector<uint8_t>(maxBufferSize_ / 2, '0'));
+    buffer_.clear();
+    ASSERT_TRUE(buffer_.empty());
+    ASSERT_TRUE(getRecords().empty());
+    const std::vector<uint8_t> input(maxBufferSize_, '1');
+    buffer_.append(input);
+    ASSERT_EQ(1u, getRecords().size());
+    EXPECT_EQ(input, getRecords().front());
 }
 
 }  // namespace wifi
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "aidl_sync_util.h"
+#include "wifi_ap_iface.h"
+#include "wifi_legacy_hal_stubs.h"
+#include "wifi_nan_iface.h"
+#include "wifi_sta_iface.h"
+
+#include "mock_interface_tool.h"
+#include "mock_wifi_iface_util.h"
+#include "mock_wifi_legacy_hal.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Test;
+
+namespace {
+constexpr char kStaIfaceName[] = "mockWlan0";
+constexpr char kApIfaceName[] = "mockWlan1";
+constexpr char kNanIfaceName[] = "mockWlan2";
+constexpr int kNumCallsPerThread = 2000;
+constexpr int kNumEvents = 2000;
+constexpr auto kEventDeliveryTimeout = std::chrono::seconds(5);
+
+// NAN event handlers registered with the fake legacy HAL, i.e. the "C" style
+// callbacks of wifi_legacy_hal.cpp.
+NanCallbackHandler g_nan_handlers;
+
+wifi_error captureNanHandlers(wifi_interface_handle /* iface */, NanCallbackHandler handlers) {
+    g_nan_handlers = handlers;
+    return WIFI_SUCCESS;
+}
+}  // namespace
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace wifi {
+
+// NAN iface which counts the events delivered to it.
+class CountingNanIface : public WifiNanIface {
+  public:
+    CountingNanIface(const std::string& ifname, bool is_dedicated_iface,
+                     const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
+                     const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util)
+        : WifiNanIface(ifname, is_dedicated_iface, legacy_hal, iface_util) {}
+
+    static std::shared_ptr<CountingNanIface> createCounting(
+            const std::string& ifname, const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
+            const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util) {
+        std::shared_ptr<CountingNanIface> ptr =
+                ndk::SharedRefBase::make<CountingNanIface>(ifname, false, legacy_hal, iface_util);
+        std::weak_ptr<CountingNanIface> weak_ptr_this(ptr);
+        ptr->setWeakPtr(weak_ptr_this);
+        ptr->registerCallbackHandlers();
+        return ptr;
+    }
+
+    // Invoked by the NAN event callbacks once they are done with validation.
+    std::set<std::shared_ptr<IWifiNanIfaceEventCallback>> getEventCallbacks() override {
+        if (num_events_.fetch_add(1) == 0) {
+            first_event_.set_value();
+        }
+        return {};
+    }
+
+    void reregisterCallbackHandlers() { registerCallbackHandlers(); }
+    int getNumEvents() { return num_events_; }
+    std::future<void> getFirstEventFuture() { return first_event_.get_future(); }
+
+  private:
+    std::atomic<int> num_events_{0};
+    std::promise<void> first_event_;
+};
+
+class WifiThreadingTest : public Test {
+  protected:
+    void SetUp() override {
+        // Route the NAN handler registration to the real legacy HAL code, so
+        // that events are delivered through its callback slots.
+        ON_CALL(*legacy_hal_, nanRegisterCallbackHandlers(_, _))
+                .WillByDefault(Invoke([this](const std::string& iface_name,
+                                             const legacy_hal::NanCallbackHandlers& handlers) {
+                    return legacy_hal_->WifiLegacyHal::nanRegisterCallbackHandlers(iface_name,
+                                                                                   handlers);
+                }));
+        sta_iface_ = WifiStaIface::create(kStaIfaceName, legacy_hal_, iface_util_);
+        ap_iface_ = ndk::SharedRefBase::make<WifiApIface>(
+                kApIfaceName, std::vector<std::string>{}, legacy_hal_, iface_util_);
+        nan_iface_ = CountingNanIface::createCounting(kNanIfaceName, legacy_hal_, iface_util_);
+    }
+
+    void TearDown() override {
+        sta_iface_->invalidate();
+        ap_iface_->invalidate();
+        nan_iface_->invalidate();
+    }
+
+    // Posts a NAN match event the way the legacy HAL's event loop does.
+    static void postNanMatchEvent() {
+        legacy_hal::NanMatchInd event = {};
+        g_nan_handlers.EventMatch(&event);
+    }
+
+    static legacy_hal::wifi_hal_fn createFakeFuncTable() {
+        legacy_hal::wifi_hal_fn fn;
+        legacy_hal::initHalFuncTableWithStubs(&fn);
+        fn.wifi_nan_register_handler = captureNanHandlers;
+        return fn;
+    }
+
+    legacy_hal::wifi_hal_fn fake_func_table_ = createFakeFuncTable();
+    std::shared_ptr<NiceMock<::android::wifi_system::MockInterfaceTool>> iface_tool_{
+            new NiceMock<::android::wifi_system::MockInterfaceTool>};
+    std::shared_ptr<NiceMock<legacy_hal::MockWifiLegacyHal>> legacy_hal_{
+            new NiceMock<legacy_hal::MockWifiLegacyHal>(iface_tool_, fake_func_table_, true)};
+    std::shared_ptr<NiceMock<iface_util::MockWifiIfaceUtil>> iface_util_{
+            new NiceMock<iface_util::MockWifiIfaceUtil>(iface_tool_, legacy_hal_)};
+    std::shared_ptr<WifiStaIface> sta_iface_;
+    std::shared_ptr<WifiApIface> ap_iface_;
+    std::shared_ptr<CountingNanIface> nan_iface_;
+};
+
+TEST(CallbackSlotTest, ReplaceWhileInvoking) {
+    aidl_sync_util::CallbackSlot<void(int)> slot;
+    std::atomic<int> sum{0};
+    std::atomic<bool> done{false};
+
+    std::thread invoker([&]() {
+        while (!done) {
+            slot.invoke(1);
+        }
+    });
+    for (int i = 0; i < kNumCallsPerThread; i++) {
+        slot = [&sum](int value) { sum += value; };
+        slot = nullptr;
+    }
+    done = true;
+    invoker.join();
+
+    EXPECT_FALSE(slot);
+    EXPECT_FALSE(slot.invoke(1));
+}
+
+TEST(CallbackSlotTest, ResetFromWithinCallback) {
+    aidl_sync_util::CallbackSlot<void()> slot;
+    auto token = std::make_shared<int>(0);
+    std::weak_ptr<int> weak_token = token;
+    slot = [&slot, token]() {
+        slot = nullptr;
+        // The function must outlive its own removal from the slot.
+        (*token)++;
+    };
+    token.reset();
+
+    EXPECT_TRUE(slot.invoke());
+    EXPECT_FALSE(slot);
+    EXPECT_TRUE(weak_token.expired());
+}
+
+TEST_F(WifiThreadingTest, EventDeliveredDuringSlowCall) {
+    std::promise<void> call_started;
+    auto first_event = nan_iface_->getFirstEventFuture();
+    // Block a STA call inside the legacy HAL until an event reaches the NAN
+    // iface of the same chip.
+    ON_CALL(*legacy_hal_, getSupportedFeatureSet(_))
+            .WillByDefault(Invoke([&call_started, &first_event](const std::string&) {
+                call_started.set_value();
+                EXPECT_EQ(std::future_status::ready, first_event.wait_for(kEventDeliveryTimeout));
+                return std::pair<legacy_hal::wifi_error, uint64_t>{legacy_hal::WIFI_SUCCESS, 0};
+            }));
+
+    std::thread aidl_thread([this]() {
+        int32_t feature_set;
+        EXPECT_TRUE(sta_iface_->getFeatureSet(&feature_set).isOk());
+    });
+    call_started.get_future().wait();
+    std::thread event_loop_thread([]() { postNanMatchEvent(); });
+    event_loop_thread.join();
+    aidl_thread.join();
+
+    EXPECT_EQ(1, nan_iface_->getNumEvents());
+}
+
+TEST_F(WifiThreadingTest, ConcurrentStaApNanTraffic) {
+    std::vector<std::thread> threads;
+    threads.emplace_back([this]() {
+        for (int i = 0; i < kNumCallsPerThread; i++) {
+            int32_t feature_set;
+            EXPECT_TRUE(sta_iface_->getFeatureSet(&feature_set).isOk());
+            std::string name;
+            EXPECT_TRUE(sta_iface_->getName(&name).isOk());
+            EXPECT_EQ(kStaIfaceName, name);
+        }
+    });
+    threads.emplace_back([this]() {
+        for (int i = 0; i < kNumCallsPerThread; i++) {
+            std::string name;
+            EXPECT_TRUE(ap_iface_->getName(&name).isOk());
+            EXPECT_EQ(kApIfaceName, name);
+        }
+    });
+    threads.emplace_back([this]() {
+        for (int i = 0; i < kNumCallsPerThread; i++) {
+            std::string name;
+            EXPECT_TRUE(nan_iface_->getName(&name).isOk());
+            EXPECT_EQ(kNanIfaceName, name);
+        }
+    });
+    // Replace the NAN callbacks while events are being delivered, as happens
+    // when a NAN iface is recreated.
+    threads.emplace_back([this]() {
+        for (int i = 0; i < kNumCallsPerThread; i++) {
+            const auto lock = nan_iface_->acquireLock();
+            nan_iface_->reregisterCallbackHandlers();
+        }
+    });
+    threads.emplace_back([]() {
+        for (int i = 0; i < kNumEvents; i++) {
+            postNanMatchEvent();
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(kNumEvents, nan_iface_->getNumEvents());
+
+    // No event is delivered once the iface is invalidated.
+    nan_iface_->invalidate();
+    postNanMatchEvent();
+    EXPECT_EQ(kNumEvents, nan_iface_->getNumEvents());
+}
+
+}  // namespace wifi
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -170,7 +170,6 @@ namespace android {
 namespace hardware {
 namespace wifi {
 using aidl_return_util::validateAndCall;
-using aidl_return_util::validateAndCallWithLock;
 using aidl_sync_util::acquireGlobalLock;
 
 Wifi::Wifi(const std::shared_ptr<::android::wifi_system::InterfaceTool> iface_tool,
@@ -188,6 +187,10 @@ bool Wifi::isValid() {
     return true;
 }
 
+std::unique_lock<std::recursive_mutex> Wifi::acquireLock() {
+    return acquireGlobalLock();
+}
+
 ndk::ScopedAStatus Wifi::registerEventCallback(
         const std::shared_ptr<IWifiEventCallback>& in_callback) {
     return validateAndCall(this, WifiStatusCode::ERROR_UNKNOWN,
@@ -204,7 +207,7 @@ ndk::ScopedAStatus Wifi::start() {
 }
 
 ndk::ScopedAStatus Wifi::stop() {
-    return validateAndCallWithLock(this, WifiStatusCode::ERROR_UNKNOWN, &Wifi::stopInternal);
+    return validateAndCall(this, WifiStatusCode::ERROR_UNKNOWN, &Wifi::stopInternal);
 }
 
 ndk::ScopedAStatus Wifi::getChipIds(std::vector<int32_t>* _aidl_return) {
@@ -299,8 +302,7 @@ ndk::ScopedAStatus Wifi::startInternal() {
     return wifi_status;
 }
 
-ndk::ScopedAStatus Wifi::stopInternal(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock) {
+ndk::ScopedAStatus Wifi::stopInternal() {
     if (run_state_ == RunState::STOPPED) {
         return ndk::ScopedAStatus::ok();
     } else if (run_state_ == RunState::STOPPING) {
@@ -315,7 +317,7 @@ ndk::ScopedAStatus Wifi::stopInternal(
         }
     }
     chips_.clear();
-    ndk::ScopedAStatus wifi_status = stopLegacyHalAndDeinitializeModeController(lock);
+    ndk::ScopedAStatus wifi_status = stopLegacyHalAndDeinitializeModeController();
     if (wifi_status.isOk()) {
         for (const auto& callback : event_cb_handler_.getCallbacks()) {
             if (!callback->onStop().isOk()) {
@@ -382,14 +384,16 @@ ndk::ScopedAStatus Wifi::initializeModeControllerAndLegacyHal() {
     return ndk::ScopedAStatus::ok();
 }
 
-ndk::ScopedAStatus Wifi::stopLegacyHalAndDeinitializeModeController(
-        /* NONNULL */ std::unique_lock<std::recursive_mutex>* lock) {
+ndk::ScopedAStatus Wifi::stopLegacyHalAndDeinitializeModeController() {
     legacy_hal::wifi_error legacy_status = legacy_hal::WIFI_SUCCESS;
     int index = 0;
 
     run_state_ = RunState::STOPPING;
     for (auto& hal : legacy_hals_) {
-        legacy_hal::wifi_error tmp = hal->stop(lock, [&]() {});
+        // |stop| releases the chip lock while the event loop completes the stop.
+        const auto chip_lock_ptr = hal->getChipLock();
+        std::unique_lock<std::recursive_mutex> chip_lock(*chip_lock_ptr);
+        legacy_hal::wifi_error tmp = hal->stop(&chip_lock, [&]() {});
         if (tmp != legacy_hal::WIFI_SUCCESS) {
             LOG(ERROR) << "Failed to stop legacy HAL index: " << index
                        << " error: " << legacyErrorToString(legacy_status);
@@ -46,6 +46,8 @@ class Wifi : public BnWifi {
          const std::shared_ptr<feature_flags::WifiFeatureFlags> feature_flags);
 
     bool isValid();
+    // |IWifi| methods run under the global lock.
+    std::unique_lock<std::recursive_mutex> acquireLock();
 
     // AIDL methods exposed.
     ndk::ScopedAStatus registerEventCallback(
@@ -65,13 +67,12 @@ class Wifi : public BnWifi {
     ndk::ScopedAStatus registerEventCallbackInternal(
             const std::shared_ptr<IWifiEventCallback>& event_callback __unused);
     ndk::ScopedAStatus startInternal();
-    ndk::ScopedAStatus stopInternal(std::unique_lock<std::recursive_mutex>* lock);
+    ndk::ScopedAStatus stopInternal();
     std::pair<std::vector<int32_t>, ndk::ScopedAStatus> getChipIdsInternal();
     std::pair<std::shared_ptr<IWifiChip>, ndk::ScopedAStatus> getChipInternal(int32_t chip_id);
 
     ndk::ScopedAStatus initializeModeControllerAndLegacyHal();
-    ndk::ScopedAStatus stopLegacyHalAndDeinitializeModeController(
-            std::unique_lock<std::recursive_mutex>* lock);
+    ndk::ScopedAStatus stopLegacyHalAndDeinitializeModeController();
     int32_t getChipIdFromWifiChip(std::shared_ptr<WifiChip>& chip);
 
     // Instance is created in this root level |IWifi| AIDL interface object
@@ -34,6 +34,7 @@ WifiApIface::WifiApIface(const std::string& ifname, const std::vector<std::strin
     : ifname_(ifname),
       instances_(instances),
       legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
       iface_util_(iface_util),
       is_valid_(true) {}
 
@@ -46,6 +47,10 @@ bool WifiApIface::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiApIface::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 std::string WifiApIface::getName() {
     return ifname_;
 }
@@ -20,6 +20,9 @@
 #include <aidl/android/hardware/wifi/BnWifiApIface.h>
 #include <android-base/macros.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
 
@@ -39,6 +42,8 @@ class WifiApIface : public BnWifiApIface {
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
+    // Refer to |WifiChip::acquireLock()|.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::string getName();
     void removeInstance(std::string instance);
 
@@ -63,8 +68,9 @@ class WifiApIface : public BnWifiApIface {
     std::string ifname_;
     std::vector<std::string> instances_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     std::weak_ptr<iface_util::WifiIfaceUtil> iface_util_;
-    bool is_valid_;
+    std::atomic<bool> is_valid_;
 
     DISALLOW_COPY_AND_ASSIGN(WifiApIface);
 };
@@ -21,9 +21,11 @@
 #include <cutils/properties.h>
 #include <fcntl.h>
 #include <hardware_legacy/wifi_hal.h>
+#include <limits.h>
 #include <net/if.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
+#include <sys/uio.h>
 
 #include "aidl_return_util.h"
 #include "aidl_struct_util.h"
@@ -211,6 +213,36 @@ bool removeOldFilesInternal() {
     return success;
 }
 
+// Writes the payload of every record in a ring buffer snapshot to |fd|, batching
+// up to IOV_MAX records per writev(). Returns false if the file could not be
+// written; a corrupted snapshot is written up to the corruption.
+bool writeRingbufferSnapshot(int fd, const std::string& ring_name,
+                             const std::vector<uint8_t>& snapshot) {
+    std::vector<struct iovec> iovs;
+    iovs.reserve(IOV_MAX);
+    bool success = true;
+    const auto flush = [&]() {
+        if (!iovs.empty() && writev(fd, iovs.data(), iovs.size()) == -1) {
+            PLOG(ERROR) << "Error writing to file";
+            success = false;
+        }
+        iovs.clear();
+    };
+    const bool valid = aidl::android::hardware::wifi::Ringbuffer::forEachRecord(
+            snapshot, kMaxBufferSizeBytes, [&](const uint8_t* data, size_t size) {
+                iovs.push_back({const_cast<uint8_t*>(data), size});
+                if (iovs.size() == IOV_MAX) {
+                    flush();
+                }
+                return true;
+            });
+    flush();
+    if (!valid) {
+        LOG(ERROR) << "Ring buffer: " << ring_name << " is corrupted";
+    }
+    return success;
+}
+
 // Helper function to create a non-const char*.
 std::vector<char> makeCharVec(const std::string& str) {
     std::vector<char> vec(str.size() + 1);
@@ -237,6 +269,7 @@ WifiChip::WifiChip(int32_t chip_id, bool is_primary,
                    bool using_dynamic_iface_combination)
     : chip_id_(chip_id),
       legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
       mode_controller_(mode_controller),
       iface_util_(iface_util),
       is_valid_(true),
@@ -292,6 +325,8 @@ std::shared_ptr<WifiChip> WifiChip::create(
 }
 
 void WifiChip::invalidate() {
+    // Wait for the AIDL calls in progress on this chip and its child objects.
+    const auto lock = acquireLock();
     if (!writeRingbufferFilesInternal()) {
         LOG(ERROR) << "Error writing files to flash";
     }
@@ -310,6 +345,10 @@ bool WifiChip::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiChip::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 std::set<std::shared_ptr<IWifiChipEventCallback>> WifiChip::getEventCallbacks() {
     return event_cb_handler_.getCallbacks();
 }
@@ -528,6 +567,7 @@ ndk::ScopedAStatus WifiChip::setLatencyMode(IWifiChip::LatencyMode in_mode) {
 
 binder_status_t WifiChip::dump(int fd __unused, const char**, uint32_t) {
     {
+        const auto chip_lock = acquireLock();
         std::unique_lock<std::mutex> lk(lock_t);
         for (const auto& item : ringbuffer_map_) {
             forceDumpToDebugRingBufferInternal(item.first);
@@ -1448,7 +1488,7 @@ ndk::ScopedAStatus WifiChip::registerDebugRingBufferCallback() {
 
     std::weak_ptr<WifiChip> weak_ptr_this = weak_ptr_this_;
     const auto& on_ring_buffer_data_callback =
-            [weak_ptr_this](const std::string& name, const std::vector<uint8_t>& data,
+            [weak_ptr_this](const std::string& name, const uint8_t* data, size_t size,
                             const legacy_hal::wifi_ring_buffer_status& status) {
                 const auto shared_ptr_this = weak_ptr_this.lock();
                 if (!shared_ptr_this.get() || !shared_ptr_this->isValid()) {
@@ -1467,7 +1507,7 @@ ndk::ScopedAStatus WifiChip::registerDebugRingBufferCallback() {
                     const auto& target = shared_ptr_this->ringbuffer_map_.find(name);
                     if (target != shared_ptr_this->ringbuffer_map_.end()) {
                         Ringbuffer& cur_buffer = target->second;
-                        appendstatus = cur_buffer.append(data);
+                        appendstatus = cur_buffer.append(data, size);
                     } else {
                         LOG(ERROR) << "Ringname " << name << " not found";
                         return;
@@ -1801,41 +1841,57 @@ std::string WifiChip::allocateStaIfaceName() {
 }
 
 bool WifiChip::writeRingbufferFilesInternal() {
+    // Serializes flushes from dump(), flushRingBufferToFile() and the ring
+    // buffer corruption handler, so that they neither delete each other's
+    // files nor drop records another flush has not written yet.
+    std::unique_lock<std::mutex> flush_lk(ringbuffer_flush_lock_);
     if (!removeOldFilesInternal()) {
         LOG(ERROR) << "Error occurred while deleting old tombstone files";
         return false;
     }
-    // write ringbuffers to file
+    // Snapshot the ringbuffers under the lock and write them to file without
+    // it, so that the ring buffer data callbacks are not blocked on file I/O.
+    struct RingSnapshot {
+        std::string ring_name;
+        std::vector<uint8_t> data;
+        uint64_t end_sequence;
+    };
+    std::vector<RingSnapshot> snapshots;
     {
         std::unique_lock<std::mutex> lk(lock_t);
         for (auto& item : ringbuffer_map_) {
             Ringbuffer& cur_buffer = item.second;
-            if (cur_buffer.getData().empty()) {
+            if (cur_buffer.empty()) {
                 continue;
             }
-            const std::string file_path_raw = kTombstoneFolderPath + item.first + "XXXXXXXXXX";
-            const int dump_fd = mkstemp(makeCharVec(file_path_raw).data());
-            if (dump_fd == -1) {
-                PLOG(ERROR) << "create file failed";
-                return false;
-            }
-            unique_fd file_auto_closer(dump_fd);
-            for (const auto& cur_block : cur_buffer.getData()) {
-                if (cur_block.size() <= 0 || cur_block.size() > kMaxBufferSizeBytes) {
-                    PLOG(ERROR) << "Ring buffer: " << item.first
-                                << " is corrupted. Invalid block size: " << cur_block.size();
-                    break;
-                }
-                if (write(dump_fd, cur_block.data(), sizeof(cur_block[0]) * cur_block.size()) ==
-                    -1) {
-                    PLOG(ERROR) << "Error writing to file";
-                }
-            }
-            cur_buffer.clear();
+            snapshots.push_back({item.first, {}, cur_buffer.getEndSequence()});
+            cur_buffer.snapshot(&snapshots.back().data);
         }
         // unique_lock unlocked here
     }
-    return true;
+    bool success = true;
+    for (const auto& snapshot : snapshots) {
+        const std::string file_path_raw =
+                kTombstoneFolderPath + snapshot.ring_name + "XXXXXXXXXX";
+        const int dump_fd = mkstemp(makeCharVec(file_path_raw).data());
+        if (dump_fd == -1) {
+            PLOG(ERROR) << "create file failed";
+            success = false;
+            continue;
+        }
+        unique_fd file_auto_closer(dump_fd);
+        if (!writeRingbufferSnapshot(dump_fd, snapshot.ring_name, snapshot.data)) {
+            success = false;
+            continue;
+        }
+        // Only drop the records once written, keeping those appended since the snapshot.
+        std::unique_lock<std::mutex> lk(lock_t);
+        const auto& target = ringbuffer_map_.find(snapshot.ring_name);
+        if (target != ringbuffer_map_.end()) {
+            target->second.dropBefore(snapshot.end_sequence);
+        }
+    }
+    return success;
 }
 
 std::string WifiChip::getWlanIfaceNameWithType(IfaceType type, unsigned idx) {
@@ -22,6 +22,7 @@
 #include <aidl/android/hardware/wifi/common/OuiKeyedData.h>
 #include <android-base/macros.h>
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <mutex>
@@ -82,6 +83,8 @@ class WifiChip : public BnWifiChip {
     // marked valid before processing them.
     void invalidate();
     bool isValid();
+    // AIDL methods of the chip and its child objects run under the chip lock.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::set<std::shared_ptr<IWifiChipEventCallback>> getEventCallbacks();
 
     // AIDL methods exposed.
@@ -276,6 +279,7 @@ class WifiChip : public BnWifiChip {
 
     int32_t chip_id_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     std::weak_ptr<mode_controller::WifiModeController> mode_controller_;
     std::shared_ptr<iface_util::WifiIfaceUtil> iface_util_;
     std::vector<std::shared_ptr<WifiApIface>> ap_ifaces_;
@@ -284,10 +288,12 @@ class WifiChip : public BnWifiChip {
     std::vector<std::shared_ptr<WifiStaIface>> sta_ifaces_;
     std::vector<std::shared_ptr<WifiRttController>> rtt_controllers_;
     std::map<std::string, Ringbuffer> ringbuffer_map_;
-    bool is_valid_;
+    std::atomic<bool> is_valid_;
     // Members pertaining to chip configuration.
     int32_t current_mode_id_;
     std::mutex lock_t;
+    // Held across a whole flush of the ring buffers to file; taken before lock_t.
+    std::mutex ringbuffer_flush_lock_;
     std::vector<IWifiChip::ChipMode> modes_;
     // The legacy ring buffer callback API has only a global callback
     // registration mechanism. Use this to check if we have already
@@ -43,6 +43,11 @@ static constexpr uint32_t kMaxSupportedRadioCombinationsMatrixLength = 256;
 static constexpr uint32_t kMaxStopCompleteWaitMs = 1000;
 static constexpr char kDriverPropName[] = "wlan.driver.status";
 
+// Serializes the requests whose results are returned through the synchronous
+// callbacks below. Each legacy HAL instance is only serialized by its own chip
+// lock, but the callbacks are shared by all of them.
+std::mutex g_sync_callback_mutex;
+
 // Helper function to create a non-const char* for legacy Hal API's.
 std::vector<char> makeCharVec(const std::string& str) {
     std::vector<char> vec(str.size() + 1);
@@ -57,133 +62,108 @@ namespace android {
 namespace hardware {
 namespace wifi {
 namespace legacy_hal {
+using aidl_sync_util::CallbackSlot;
 
 // Legacy HAL functions accept "C" style function pointers, so use global
 // functions to pass to the legacy HAL function and store the corresponding
 // std::function methods to be invoked.
 //
+// The std::function methods are held in |CallbackSlot|s, which lets the event
+// loop invoke them without any lock while the AIDL threads replace them.
+//
 // Callback to be invoked once |stop| is complete
-std::function<void(wifi_handle handle)> on_stop_complete_internal_callback;
+CallbackSlot<void(wifi_handle handle)> on_stop_complete_internal_callback;
 void onAsyncStopComplete(wifi_handle handle) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_stop_complete_internal_callback) {
-        on_stop_complete_internal_callback(handle);
-        // Invalidate this callback since we don't want this firing again.
-        on_stop_complete_internal_callback = nullptr;
+    // Invalidate this callback since we don't want this firing again.
+    const auto callback = on_stop_complete_internal_callback.take();
+    if (callback) {
+        (*callback)(handle);
     }
 }
 
 // Callback to be invoked for driver dump.
-std::function<void(char*, int)> on_driver_memory_dump_internal_callback;
+CallbackSlot<void(char*, int)> on_driver_memory_dump_internal_callback;
 void onSyncDriverMemoryDump(char* buffer, int buffer_size) {
-    if (on_driver_memory_dump_internal_callback) {
-        on_driver_memory_dump_internal_callback(buffer, buffer_size);
-    }
+    on_driver_memory_dump_internal_callback.invoke(buffer, buffer_size);
 }
 
 // Callback to be invoked for firmware dump.
-std::function<void(char*, int)> on_firmware_memory_dump_internal_callback;
+CallbackSlot<void(char*, int)> on_firmware_memory_dump_internal_callback;
 void onSyncFirmwareMemoryDump(char* buffer, int buffer_size) {
-    if (on_firmware_memory_dump_internal_callback) {
-        on_firmware_memory_dump_internal_callback(buffer, buffer_size);
-    }
+    on_firmware_memory_dump_internal_callback.invoke(buffer, buffer_size);
 }
 
 // Callback to be invoked for Gscan events.
-std::function<void(wifi_request_id, wifi_scan_event)> on_gscan_event_internal_callback;
+CallbackSlot<void(wifi_request_id, wifi_scan_event)> on_gscan_event_internal_callback;
 void onAsyncGscanEvent(wifi_request_id id, wifi_scan_event event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_gscan_event_internal_callback) {
-        on_gscan_event_internal_callback(id, event);
-    }
+    on_gscan_event_internal_callback.invoke(id, event);
 }
 
 // Callback to be invoked for Gscan full results.
-std::function<void(wifi_request_id, wifi_scan_result*, uint32_t)>
+CallbackSlot<void(wifi_request_id, wifi_scan_result*, uint32_t)>
         on_gscan_full_result_internal_callback;
 void onAsyncGscanFullResult(wifi_request_id id, wifi_scan_result* result,
                             uint32_t buckets_scanned) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_gscan_full_result_internal_callback) {
-        on_gscan_full_result_internal_callback(id, result, buckets_scanned);
-    }
+    on_gscan_full_result_internal_callback.invoke(id, result, buckets_scanned);
 }
 
 // Callback to be invoked for link layer stats results.
-std::function<void((wifi_request_id, wifi_iface_stat*, int, wifi_radio_stat*))>
+CallbackSlot<void((wifi_request_id, wifi_iface_stat*, int, wifi_radio_stat*))>
         on_link_layer_stats_result_internal_callback;
 void onSyncLinkLayerStatsResult(wifi_request_id id, wifi_iface_stat* iface_stat, int num_radios,
                                 wifi_radio_stat* radio_stat) {
-    if (on_link_layer_stats_result_internal_callback) {
-        on_link_layer_stats_result_internal_callback(id, iface_stat, num_radios, radio_stat);
-    }
+    on_link_layer_stats_result_internal_callback.invoke(id, iface_stat, num_radios, radio_stat);
 }
 
 // Callback to be invoked for Multi link layer stats results.
-std::function<void((wifi_request_id, wifi_iface_ml_stat*, int, wifi_radio_stat*))>
+CallbackSlot<void((wifi_request_id, wifi_iface_ml_stat*, int, wifi_radio_stat*))>
         on_link_layer_ml_stats_result_internal_callback;
 void onSyncLinkLayerMlStatsResult(wifi_request_id id, wifi_iface_ml_stat* iface_ml_stat,
                                   int num_radios, wifi_radio_stat* radio_stat) {
-    if (on_link_layer_ml_stats_result_internal_callback) {
-        on_link_layer_ml_stats_result_internal_callback(id, iface_ml_stat, num_radios, radio_stat);
-    }
+    on_link_layer_ml_stats_result_internal_callback.invoke(id, iface_ml_stat, num_radios,
+                                                           radio_stat);
 }
 
 // Callback to be invoked for rssi threshold breach.
-std::function<void((wifi_request_id, uint8_t*, int8_t))>
+CallbackSlot<void((wifi_request_id, uint8_t*, int8_t))>
         on_rssi_threshold_breached_internal_callback;
 void onAsyncRssiThresholdBreached(wifi_request_id id, uint8_t* bssid, int8_t rssi) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_rssi_threshold_breached_internal_callback) {
-        on_rssi_threshold_breached_internal_callback(id, bssid, rssi);
-    }
+    on_rssi_threshold_breached_internal_callback.invoke(id, bssid, rssi);
 }
 
 // Callback to be invoked for ring buffer data indication.
-std::function<void(char*, char*, int, wifi_ring_buffer_status*)>
+CallbackSlot<void(char*, char*, int, wifi_ring_buffer_status*)>
         on_ring_buffer_data_internal_callback;
 void onAsyncRingBufferData(char* ring_name, char* buffer, int buffer_size,
                            wifi_ring_buffer_status* status) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_ring_buffer_data_internal_callback) {
-        on_ring_buffer_data_internal_callback(ring_name, buffer, buffer_size, status);
-    }
+    on_ring_buffer_data_internal_callback.invoke(ring_name, buffer, buffer_size, status);
 }
 
 // Callback to be invoked for error alert indication.
-std::function<void(wifi_request_id, char*, int, int)> on_error_alert_internal_callback;
+CallbackSlot<void(wifi_request_id, char*, int, int)> on_error_alert_internal_callback;
 void onAsyncErrorAlert(wifi_request_id id, char* buffer, int buffer_size, int err_code) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_error_alert_internal_callback) {
-        on_error_alert_internal_callback(id, buffer, buffer_size, err_code);
-    }
+    on_error_alert_internal_callback.invoke(id, buffer, buffer_size, err_code);
 }
 
 // Callback to be invoked for radio mode change indication.
-std::function<void(wifi_request_id, uint32_t, wifi_mac_info*)>
+CallbackSlot<void(wifi_request_id, uint32_t, wifi_mac_info*)>
         on_radio_mode_change_internal_callback;
 void onAsyncRadioModeChange(wifi_request_id id, uint32_t num_macs, wifi_mac_info* mac_infos) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_radio_mode_change_internal_callback) {
-        on_radio_mode_change_internal_callback(id, num_macs, mac_infos);
-    }
+    on_radio_mode_change_internal_callback.invoke(id, num_macs, mac_infos);
 }
 
 // Callback to be invoked to report subsystem restart
-std::function<void(const char*)> on_subsystem_restart_internal_callback;
+CallbackSlot<void(const char*)> on_subsystem_restart_internal_callback;
 void onAsyncSubsystemRestart(const char* error) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_subsystem_restart_internal_callback) {
-        on_subsystem_restart_internal_callback(error);
-    }
+    on_subsystem_restart_internal_callback.invoke(error);
 }
 
 // Callback to be invoked for rtt results results.
-std::function<void(wifi_request_id, unsigned num_results, wifi_rtt_result* rtt_results[])>
+CallbackSlot<void(wifi_request_id, unsigned num_results, wifi_rtt_result* rtt_results[])>
         on_rtt_results_internal_callback;
-std::function<void(wifi_request_id, unsigned num_results, wifi_rtt_result_v2* rtt_results_v2[])>
+CallbackSlot<void(wifi_request_id, unsigned num_results, wifi_rtt_result_v2* rtt_results_v2[])>
         on_rtt_results_internal_callback_v2;
-std::function<void(wifi_request_id, unsigned num_results, wifi_rtt_result_v3* rtt_results_v3[])>
+CallbackSlot<void(wifi_request_id, unsigned num_results, wifi_rtt_result_v3* rtt_results_v3[])>
         on_rtt_results_internal_callback_v3;
 
 void invalidateRttResultsCallbacks() {
@@ -192,29 +172,32 @@ void invalidateRttResultsCallbacks() {
     on_rtt_results_internal_callback_v3 = nullptr;
 };
 
+// The results of a range request are only delivered once, so the callbacks
+// are invalidated before invoking the user callback. This lets the next range
+// request be started as soon as the results are reported.
 void onAsyncRttResults(wifi_request_id id, unsigned num_results, wifi_rtt_result* rtt_results[]) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_rtt_results_internal_callback) {
-        on_rtt_results_internal_callback(id, num_results, rtt_results);
+    const auto callback = on_rtt_results_internal_callback.take();
+    if (callback) {
         invalidateRttResultsCallbacks();
+        (*callback)(id, num_results, rtt_results);
     }
 }
 
 void onAsyncRttResultsV2(wifi_request_id id, unsigned num_results,
                          wifi_rtt_result_v2* rtt_results_v2[]) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_rtt_results_internal_callback_v2) {
-        on_rtt_results_internal_callback_v2(id, num_results, rtt_results_v2);
+    const auto callback = on_rtt_results_internal_callback_v2.take();
+    if (callback) {
         invalidateRttResultsCallbacks();
+        (*callback)(id, num_results, rtt_results_v2);
     }
 }
 
 void onAsyncRttResultsV3(wifi_request_id id, unsigned num_results,
                          wifi_rtt_result_v3* rtt_results_v3[]) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_rtt_results_internal_callback_v3) {
-        on_rtt_results_internal_callback_v3(id, num_results, rtt_results_v3);
+    const auto callback = on_rtt_results_internal_callback_v3.take();
+    if (callback) {
         invalidateRttResultsCallbacks();
+        (*callback)(id, num_results, rtt_results_v3);
     }
 }
 
@@ -222,309 +205,256 @@ void onAsyncRttResultsV3(wifi_request_id id, unsigned num_results,
 // NOTE: These have very little conversions to perform before invoking the user
 // callbacks.
 // So, handle all of them here directly to avoid adding an unnecessary layer.
-std::function<void(transaction_id, const NanResponseMsg&)> on_nan_notify_response_user_callback;
+CallbackSlot<void(transaction_id, const NanResponseMsg&)> on_nan_notify_response_user_callback;
 void onAsyncNanNotifyResponse(transaction_id id, NanResponseMsg* msg) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_notify_response_user_callback && msg) {
-        on_nan_notify_response_user_callback(id, *msg);
+    if (msg) {
+        on_nan_notify_response_user_callback.invoke(id, *msg);
     }
 }
 
-std::function<void(const NanPublishRepliedInd&)> on_nan_event_publish_replied_user_callback;
+CallbackSlot<void(const NanPublishRepliedInd&)> on_nan_event_publish_replied_user_callback;
 void onAsyncNanEventPublishReplied(NanPublishRepliedInd* /* event */) {
     LOG(ERROR) << "onAsyncNanEventPublishReplied triggered";
 }
 
-std::function<void(const NanPublishTerminatedInd&)> on_nan_event_publish_terminated_user_callback;
+CallbackSlot<void(const NanPublishTerminatedInd&)> on_nan_event_publish_terminated_user_callback;
 void onAsyncNanEventPublishTerminated(NanPublishTerminatedInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_publish_terminated_user_callback && event) {
-        on_nan_event_publish_terminated_user_callback(*event);
+    if (event) {
+        on_nan_event_publish_terminated_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanMatchInd&)> on_nan_event_match_user_callback;
+CallbackSlot<void(const NanMatchInd&)> on_nan_event_match_user_callback;
 void onAsyncNanEventMatch(NanMatchInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_match_user_callback && event) {
-        on_nan_event_match_user_callback(*event);
+    if (event) {
+        on_nan_event_match_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanMatchExpiredInd&)> on_nan_event_match_expired_user_callback;
+CallbackSlot<void(const NanMatchExpiredInd&)> on_nan_event_match_expired_user_callback;
 void onAsyncNanEventMatchExpired(NanMatchExpiredInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_match_expired_user_callback && event) {
-        on_nan_event_match_expired_user_callback(*event);
+    if (event) {
+        on_nan_event_match_expired_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanSubscribeTerminatedInd&)>
+CallbackSlot<void(const NanSubscribeTerminatedInd&)>
         on_nan_event_subscribe_terminated_user_callback;
 void onAsyncNanEventSubscribeTerminated(NanSubscribeTerminatedInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_subscribe_terminated_user_callback && event) {
-        on_nan_event_subscribe_terminated_user_callback(*event);
+    if (event) {
+        on_nan_event_subscribe_terminated_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanFollowupInd&)> on_nan_event_followup_user_callback;
+CallbackSlot<void(const NanFollowupInd&)> on_nan_event_followup_user_callback;
 void onAsyncNanEventFollowup(NanFollowupInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_followup_user_callback && event) {
-        on_nan_event_followup_user_callback(*event);
+    if (event) {
+        on_nan_event_followup_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanDiscEngEventInd&)> on_nan_event_disc_eng_event_user_callback;
+CallbackSlot<void(const NanDiscEngEventInd&)> on_nan_event_disc_eng_event_user_callback;
 void onAsyncNanEventDiscEngEvent(NanDiscEngEventInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_disc_eng_event_user_callback && event) {
-        on_nan_event_disc_eng_event_user_callback(*event);
+    if (event) {
+        on_nan_event_disc_eng_event_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanDisabledInd&)> on_nan_event_disabled_user_callback;
+CallbackSlot<void(const NanDisabledInd&)> on_nan_event_disabled_user_callback;
 void onAsyncNanEventDisabled(NanDisabledInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_disabled_user_callback && event) {
-        on_nan_event_disabled_user_callback(*event);
+    if (event) {
+        on_nan_event_disabled_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanTCAInd&)> on_nan_event_tca_user_callback;
+CallbackSlot<void(const NanTCAInd&)> on_nan_event_tca_user_callback;
 void onAsyncNanEventTca(NanTCAInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_tca_user_callback && event) {
-        on_nan_event_tca_user_callback(*event);
+    if (event) {
+        on_nan_event_tca_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanBeaconSdfPayloadInd&)> on_nan_event_beacon_sdf_payload_user_callback;
+CallbackSlot<void(const NanBeaconSdfPayloadInd&)> on_nan_event_beacon_sdf_payload_user_callback;
 void onAsyncNanEventBeaconSdfPayload(NanBeaconSdfPayloadInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_beacon_sdf_payload_user_callback && event) {
-        on_nan_event_beacon_sdf_payload_user_callback(*event);
+    if (event) {
+        on_nan_event_beacon_sdf_payload_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanDataPathRequestInd&)> on_nan_event_data_path_request_user_callback;
+CallbackSlot<void(const NanDataPathRequestInd&)> on_nan_event_data_path_request_user_callback;
 void onAsyncNanEventDataPathRequest(NanDataPathRequestInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_data_path_request_user_callback && event) {
-        on_nan_event_data_path_request_user_callback(*event);
+    if (event) {
+        on_nan_event_data_path_request_user_callback.invoke(*event);
     }
 }
-std::function<void(const NanDataPathConfirmInd&)> on_nan_event_data_path_confirm_user_callback;
+CallbackSlot<void(const NanDataPathConfirmInd&)> on_nan_event_data_path_confirm_user_callback;
 void onAsyncNanEventDataPathConfirm(NanDataPathConfirmInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_data_path_confirm_user_callback && event) {
-        on_nan_event_data_path_confirm_user_callback(*event);
+    if (event) {
+        on_nan_event_data_path_confirm_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanDataPathEndInd&)> on_nan_event_data_path_end_user_callback;
+CallbackSlot<void(const NanDataPathEndInd&)> on_nan_event_data_path_end_user_callback;
 void onAsyncNanEventDataPathEnd(NanDataPathEndInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_data_path_end_user_callback && event) {
-        on_nan_event_data_path_end_user_callback(*event);
+    if (event) {
+        on_nan_event_data_path_end_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanTransmitFollowupInd&)> on_nan_event_transmit_follow_up_user_callback;
+CallbackSlot<void(const NanTransmitFollowupInd&)> on_nan_event_transmit_follow_up_user_callback;
 void onAsyncNanEventTransmitFollowUp(NanTransmitFollowupInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_transmit_follow_up_user_callback && event) {
-        on_nan_event_transmit_follow_up_user_callback(*event);
+    if (event) {
+        on_nan_event_transmit_follow_up_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanRangeRequestInd&)> on_nan_event_range_request_user_callback;
+CallbackSlot<void(const NanRangeRequestInd&)> on_nan_event_range_request_user_callback;
 void onAsyncNanEventRangeRequest(NanRangeRequestInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_range_request_user_callback && event) {
-        on_nan_event_range_request_user_callback(*event);
+    if (event) {
+        on_nan_event_range_request_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanRangeReportInd&)> on_nan_event_range_report_user_callback;
+CallbackSlot<void(const NanRangeReportInd&)> on_nan_event_range_report_user_callback;
 void onAsyncNanEventRangeReport(NanRangeReportInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_range_report_user_callback && event) {
-        on_nan_event_range_report_user_callback(*event);
+    if (event) {
+        on_nan_event_range_report_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanDataPathScheduleUpdateInd&)> on_nan_event_schedule_update_user_callback;
+CallbackSlot<void(const NanDataPathScheduleUpdateInd&)> on_nan_event_schedule_update_user_callback;
 void onAsyncNanEventScheduleUpdate(NanDataPathScheduleUpdateInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_schedule_update_user_callback && event) {
-        on_nan_event_schedule_update_user_callback(*event);
+    if (event) {
+        on_nan_event_schedule_update_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanSuspensionModeChangeInd&)>
+CallbackSlot<void(const NanSuspensionModeChangeInd&)>
         on_nan_event_suspension_mode_change_user_callback;
 void onAsyncNanEventSuspensionModeChange(NanSuspensionModeChangeInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_suspension_mode_change_user_callback && event) {
-        on_nan_event_suspension_mode_change_user_callback(*event);
+    if (event) {
+        on_nan_event_suspension_mode_change_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanPairingRequestInd&)> on_nan_event_pairing_request_user_callback;
+CallbackSlot<void(const NanPairingRequestInd&)> on_nan_event_pairing_request_user_callback;
 void onAsyncNanEventPairingRequest(NanPairingRequestInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_pairing_request_user_callback && event) {
-        on_nan_event_pairing_request_user_callback(*event);
+    if (event) {
+        on_nan_event_pairing_request_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanPairingConfirmInd&)> on_nan_event_pairing_confirm_user_callback;
+CallbackSlot<void(const NanPairingConfirmInd&)> on_nan_event_pairing_confirm_user_callback;
 void onAsyncNanEventPairingConfirm(NanPairingConfirmInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_pairing_confirm_user_callback && event) {
-        on_nan_event_pairing_confirm_user_callback(*event);
+    if (event) {
+        on_nan_event_pairing_confirm_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanBootstrappingRequestInd&)>
+CallbackSlot<void(const NanBootstrappingRequestInd&)>
         on_nan_event_bootstrapping_request_user_callback;
 void onAsyncNanEventBootstrappingRequest(NanBootstrappingRequestInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_bootstrapping_request_user_callback && event) {
-        on_nan_event_bootstrapping_request_user_callback(*event);
+    if (event) {
+        on_nan_event_bootstrapping_request_user_callback.invoke(*event);
     }
 }
 
-std::function<void(const NanBootstrappingConfirmInd&)>
+CallbackSlot<void(const NanBootstrappingConfirmInd&)>
         on_nan_event_bootstrapping_confirm_user_callback;
 void onAsyncNanEventBootstrappingConfirm(NanBootstrappingConfirmInd* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_nan_event_bootstrapping_confirm_user_callback && event) {
-        on_nan_event_bootstrapping_confirm_user_callback(*event);
+    if (event) {
+        on_nan_event_bootstrapping_confirm_user_callback.invoke(*event);
     }
 }
 
 // Callbacks for the various TWT operations.
-std::function<void(const TwtSetupResponse&)> on_twt_event_setup_response_callback;
+CallbackSlot<void(const TwtSetupResponse&)> on_twt_event_setup_response_callback;
 void onAsyncTwtEventSetupResponse(TwtSetupResponse* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_event_setup_response_callback && event) {
-        on_twt_event_setup_response_callback(*event);
+    if (event) {
+        on_twt_event_setup_response_callback.invoke(*event);
     }
 }
 
-std::function<void(const TwtTeardownCompletion&)> on_twt_event_teardown_completion_callback;
+CallbackSlot<void(const TwtTeardownCompletion&)> on_twt_event_teardown_completion_callback;
 void onAsyncTwtEventTeardownCompletion(TwtTeardownCompletion* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_event_teardown_completion_callback && event) {
-        on_twt_event_teardown_completion_callback(*event);
+    if (event) {
+        on_twt_event_teardown_completion_callback.invoke(*event);
     }
 }
 
-std::function<void(const TwtInfoFrameReceived&)> on_twt_event_info_frame_received_callback;
+CallbackSlot<void(const TwtInfoFrameReceived&)> on_twt_event_info_frame_received_callback;
 void onAsyncTwtEventInfoFrameReceived(TwtInfoFrameReceived* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_event_info_frame_received_callback && event) {
-        on_twt_event_info_frame_received_callback(*event);
+    if (event) {
+        on_twt_event_info_frame_received_callback.invoke(*event);
     }
 }
 
-std::function<void(const TwtDeviceNotify&)> on_twt_event_device_notify_callback;
+CallbackSlot<void(const TwtDeviceNotify&)> on_twt_event_device_notify_callback;
 void onAsyncTwtEventDeviceNotify(TwtDeviceNotify* event) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_event_device_notify_callback && event) {
-        on_twt_event_device_notify_callback(*event);
+    if (event) {
+        on_twt_event_device_notify_callback.invoke(*event);
     }
 }
 
 // Callback to report current CHRE NAN state
-std::function<void(chre_nan_rtt_state)> on_chre_nan_rtt_internal_callback;
+CallbackSlot<void(chre_nan_rtt_state)> on_chre_nan_rtt_internal_callback;
 void onAsyncChreNanRttState(chre_nan_rtt_state state) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_chre_nan_rtt_internal_callback) {
-        on_chre_nan_rtt_internal_callback(state);
-    }
+    on_chre_nan_rtt_internal_callback.invoke(state);
 }
 
 // Callback to report cached scan results
-std::function<void(wifi_cached_scan_report*)> on_cached_scan_results_internal_callback;
+CallbackSlot<void(wifi_cached_scan_report*)> on_cached_scan_results_internal_callback;
 void onSyncCachedScanResults(wifi_cached_scan_report* cache_report) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_cached_scan_results_internal_callback) {
-        on_cached_scan_results_internal_callback(cache_report);
-    }
+    on_cached_scan_results_internal_callback.invoke(cache_report);
 }
 
 // Callback to be invoked for TWT failure
-std::function<void((wifi_request_id, wifi_twt_error_code error_code))>
+CallbackSlot<void((wifi_request_id, wifi_twt_error_code error_code))>
         on_twt_failure_internal_callback;
 void onAsyncTwtError(wifi_request_id id, wifi_twt_error_code error_code) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_failure_internal_callback) {
-        on_twt_failure_internal_callback(id, error_code);
-    }
+    on_twt_failure_internal_callback.invoke(id, error_code);
 }
 
 // Callback to be invoked for TWT session creation
-std::function<void((wifi_request_id, wifi_twt_session twt_session))>
+CallbackSlot<void((wifi_request_id, wifi_twt_session twt_session))>
         on_twt_session_create_internal_callback;
 void onAsyncTwtSessionCreate(wifi_request_id id, wifi_twt_session twt_session) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_create_internal_callback) {
-        on_twt_session_create_internal_callback(id, twt_session);
-    }
+    on_twt_session_create_internal_callback.invoke(id, twt_session);
 }
 
 // Callback to be invoked for TWT session update
-std::function<void((wifi_request_id, wifi_twt_session twt_session))>
+CallbackSlot<void((wifi_request_id, wifi_twt_session twt_session))>
         on_twt_session_update_internal_callback;
 void onAsyncTwtSessionUpdate(wifi_request_id id, wifi_twt_session twt_session) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_update_internal_callback) {
-        on_twt_session_update_internal_callback(id, twt_session);
-    }
+    on_twt_session_update_internal_callback.invoke(id, twt_session);
 }
 
 // Callback to be invoked for TWT session teardown
-std::function<void(
+CallbackSlot<void(
         (wifi_request_id, int twt_session_id, wifi_twt_teardown_reason_code reason_code))>
         on_twt_session_teardown_internal_callback;
 void onAsyncTwtSessionTeardown(wifi_request_id id, int twt_session_id,
                                wifi_twt_teardown_reason_code reason_code) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_teardown_internal_callback) {
-        on_twt_session_teardown_internal_callback(id, twt_session_id, reason_code);
-    }
+    on_twt_session_teardown_internal_callback.invoke(id, twt_session_id, reason_code);
 }
 
 // Callback to be invoked for TWT session get stats
-std::function<void((wifi_request_id, int twt_session_id, wifi_twt_session_stats stats))>
+CallbackSlot<void((wifi_request_id, int twt_session_id, wifi_twt_session_stats stats))>
         on_twt_session_stats_internal_callback;
 void onAsyncTwtSessionStats(wifi_request_id id, int twt_session_id, wifi_twt_session_stats stats) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_stats_internal_callback) {
-        on_twt_session_stats_internal_callback(id, twt_session_id, stats);
-    }
+    on_twt_session_stats_internal_callback.invoke(id, twt_session_id, stats);
 }
 
 // Callback to be invoked for TWT session suspend
-std::function<void((wifi_request_id, int twt_session_id))> on_twt_session_suspend_internal_callback;
+CallbackSlot<void((wifi_request_id, int twt_session_id))> on_twt_session_suspend_internal_callback;
 void onAsyncTwtSessionSuspend(wifi_request_id id, int twt_session_id) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_suspend_internal_callback) {
-        on_twt_session_suspend_internal_callback(id, twt_session_id);
-    }
+    on_twt_session_suspend_internal_callback.invoke(id, twt_session_id);
 }
 
 // Callback to be invoked for TWT session resume
-std::function<void((wifi_request_id, int twt_session_id))> on_twt_session_resume_internal_callback;
+CallbackSlot<void((wifi_request_id, int twt_session_id))> on_twt_session_resume_internal_callback;
 void onAsyncTwtSessionResume(wifi_request_id id, int twt_session_id) {
-    const auto lock = aidl_sync_util::acquireGlobalLock();
-    if (on_twt_session_resume_internal_callback) {
-        on_twt_session_resume_internal_callback(id, twt_session_id);
-    }
+    on_twt_session_resume_internal_callback.invoke(id, twt_session_id);
 }
 
 // End of the free-standing "C" style callbacks.
@@ -533,6 +463,7 @@ WifiLegacyHal::WifiLegacyHal(const std::weak_ptr<::android::wifi_system::Interfa
                              const wifi_hal_fn& fn, bool is_primary)
     : global_func_table_(fn),
       global_handle_(nullptr),
+      chip_lock_(std::make_shared<std::recursive_mutex>()),
       awaiting_event_loop_termination_(false),
       is_started_(false),
       iface_tool_(iface_tool),
@@ -597,6 +528,8 @@ wifi_error WifiLegacyHal::stop(
     LOG(DEBUG) << "Stopping legacy HAL";
     on_stop_complete_internal_callback = [on_stop_complete_user_callback,
                                           this](wifi_handle handle) {
+        // |stop| releases the chip lock while it waits for this callback.
+        const std::lock_guard<std::recursive_mutex> chip_lock(*chip_lock_);
         CHECK_EQ(global_handle_, handle) << "Handle mismatch";
         LOG(INFO) << "Legacy HAL stop complete callback received";
         // Invalidate all the internal pointers now that the HAL is
@@ -646,6 +579,7 @@ std::pair<wifi_error, std::string> WifiLegacyHal::getFirmwareVersion(
 
 std::pair<wifi_error, std::vector<uint8_t>> WifiLegacyHal::requestDriverMemoryDump(
         const std::string& iface_name) {
+    const std::lock_guard<std::mutex> sync_callback_lock(g_sync_callback_mutex);
     std::vector<uint8_t> driver_dump;
     on_driver_memory_dump_internal_callback = [&driver_dump](char* buffer, int buffer_size) {
         driver_dump.insert(driver_dump.end(), reinterpret_cast<uint8_t*>(buffer),
@@ -659,6 +593,7 @@ std::pair<wifi_error, std::vector<uint8_t>> WifiLegacyHal::requestDriverMemoryDu
 
 std::pair<wifi_error, std::vector<uint8_t>> WifiLegacyHal::requestFirmwareMemoryDump(
         const std::string& iface_name) {
+    const std::lock_guard<std::mutex> sync_callback_lock(g_sync_callback_mutex);
     std::vector<uint8_t> firmware_dump;
     on_firmware_memory_dump_internal_callback = [&firmware_dump](char* buffer, int buffer_size) {
         firmware_dump.insert(firmware_dump.end(), reinterpret_cast<uint8_t*>(buffer),
@@ -748,7 +683,11 @@ wifi_error WifiLegacyHal::startGscan(
             case WIFI_SCAN_THRESHOLD_PERCENT: {
                 wifi_error status;
                 std::vector<wifi_cached_scan_results> cached_scan_results;
-                std::tie(status, cached_scan_results) = getGscanCachedResults(iface_name);
+                {
+                    // Serialize with the AIDL calls made into this HAL.
+                    const std::lock_guard<std::recursive_mutex> chip_lock(*chip_lock_);
+                    std::tie(status, cached_scan_results) = getGscanCachedResults(iface_name);
+                }
                 if (status == WIFI_SUCCESS) {
                     on_results_user_callback(id, cached_scan_results);
                     return;
@@ -835,164 +774,23 @@ wifi_error WifiLegacyHal::disableLinkLayerStats(const std::string& iface_name) {
                                                     &clear_mask_rsp, 1, &stop_rsp);
 }
 
-// Copies wifi_peer_info* to vector<WifiPeerInfo> and returns poiner to next element.
-wifi_peer_info* WifiLegacyHal::copyPeerInfo(wifi_peer_info* peer_ptr,
-                                            std::vector<WifiPeerInfo>& peers) {
-    WifiPeerInfo peer;
-    peer.peer_info = *peer_ptr;
-    if (peer_ptr->num_rate > 0) {
-        // Copy the rate stats.
-        peer.rate_stats.assign(peer_ptr->rate_stats, peer_ptr->rate_stats + peer_ptr->num_rate);
-    }
-    peer.peer_info.num_rate = 0;
-    // Push peer info.
-    peers.push_back(peer);
-    // Return the address of next peer info.
-    return (wifi_peer_info*)((u8*)peer_ptr + sizeof(wifi_peer_info) +
-                             (sizeof(wifi_rate_stat) * peer_ptr->num_rate));
-}
-// Copies wifi_link_stat* to vector<LinkStats> and returns poiner to next element.
-wifi_link_stat* WifiLegacyHal::copyLinkStat(wifi_link_stat* stat_ptr,
-                                            std::vector<LinkStats>& stats) {
-    LinkStats linkStat;
-    linkStat.stat = *stat_ptr;
-    wifi_peer_info* l_peer_info_stats_ptr = stat_ptr->peer_info;
-    for (uint32_t i = 0; i < linkStat.stat.num_peers; i++) {
-        l_peer_info_stats_ptr = copyPeerInfo(l_peer_info_stats_ptr, linkStat.peers);
-    }
-    // Copied all peers to linkStat.peers.
-    linkStat.stat.num_peers = 0;
-    // Push link stat.
-    stats.push_back(linkStat);
-    // Read all peers, return the address of next wifi_link_stat.
-    return (wifi_link_stat*)l_peer_info_stats_ptr;
-}
-
-wifi_error WifiLegacyHal::getLinkLayerStats(const std::string& iface_name,
-                                            LinkLayerStats& link_stats,
-                                            LinkLayerMlStats& link_ml_stats) {
-    LinkLayerStats* link_stats_ptr = &link_stats;
-    link_stats_ptr->valid = false;
-
-    on_link_layer_stats_result_internal_callback = [&link_stats_ptr](
-                                                           wifi_request_id /* id */,
-                                                           wifi_iface_stat* iface_stats_ptr,
-                                                           int num_radios,
-                                                           wifi_radio_stat* radio_stats_ptr) {
-        wifi_radio_stat* l_radio_stats_ptr;
-        wifi_peer_info* l_peer_info_stats_ptr;
-        link_stats_ptr->valid = true;
-
-        if (iface_stats_ptr != nullptr) {
-            link_stats_ptr->iface = *iface_stats_ptr;
-            l_peer_info_stats_ptr = iface_stats_ptr->peer_info;
-            for (uint32_t i = 0; i < iface_stats_ptr->num_peers; i++) {
-                WifiPeerInfo peer;
-                peer.peer_info = *l_peer_info_stats_ptr;
-                if (l_peer_info_stats_ptr->num_rate > 0) {
-                    /* Copy the rate stats */
-                    peer.rate_stats.assign(
-                            l_peer_info_stats_ptr->rate_stats,
-                            l_peer_info_stats_ptr->rate_stats + l_peer_info_stats_ptr->num_rate);
-                }
-                peer.peer_info.num_rate = 0;
-                link_stats_ptr->peers.push_back(peer);
-                l_peer_info_stats_ptr =
-                        (wifi_peer_info*)((u8*)l_peer_info_stats_ptr + sizeof(wifi_peer_info) +
-                                          (sizeof(wifi_rate_stat) *
-                                           l_peer_info_stats_ptr->num_rate));
-            }
-            link_stats_ptr->iface.num_peers = 0;
-        } else {
-            LOG(ERROR) << "Invalid iface stats in link layer stats";
-        }
-        if (num_radios <= 0 || radio_stats_ptr == nullptr) {
-            LOG(ERROR) << "Invalid radio stats in link layer stats";
-            return;
-        }
-        l_radio_stats_ptr = radio_stats_ptr;
-        for (int i = 0; i < num_radios; i++) {
-            LinkLayerRadioStats radio;
-
-            radio.stats = *l_radio_stats_ptr;
-            // Copy over the tx level array to the separate vector.
-            if (l_radio_stats_ptr->num_tx_levels > 0 &&
-                l_radio_stats_ptr->tx_time_per_levels != nullptr) {
-                radio.tx_time_per_levels.assign(
-                        l_radio_stats_ptr->tx_time_per_levels,
-                        l_radio_stats_ptr->tx_time_per_levels + l_radio_stats_ptr->num_tx_levels);
-            }
-            radio.stats.num_tx_levels = 0;
-            radio.stats.tx_time_per_levels = nullptr;
-            /* Copy over the channel stat to separate vector */
-            if (l_radio_stats_ptr->num_channels > 0) {
-                /* Copy the channel stats */
-                radio.channel_stats.assign(
-                        l_radio_stats_ptr->channels,
-                        l_radio_stats_ptr->channels + l_radio_stats_ptr->num_channels);
-            }
-            link_stats_ptr->radios.push_back(radio);
-            l_radio_stats_ptr =
-                    (wifi_radio_stat*)((u8*)l_radio_stats_ptr + sizeof(wifi_radio_stat) +
-                                       (sizeof(wifi_channel_stat) *
-                                        l_radio_stats_ptr->num_channels));
-        }
-    };
-
-    LinkLayerMlStats* link_ml_stats_ptr = &link_ml_stats;
-    link_ml_stats_ptr->valid = false;
-
+wifi_error WifiLegacyHal::getLinkLayerStats(
+        const std::string& iface_name,
+        const on_link_layer_stats_result_callback& on_stats_callback,
+        const on_link_layer_ml_stats_result_callback& on_ml_stats_callback) {
+    const std::lock_guard<std::mutex> sync_callback_lock(g_sync_callback_mutex);
+    // The stats are handed over in the packed buffers of the legacy HAL, so
+    // that the caller can convert them without intermediate copies.
+    on_link_layer_stats_result_internal_callback =
+            [&on_stats_callback](wifi_request_id /* id */, wifi_iface_stat* iface_stats_ptr,
+                                 int num_radios, wifi_radio_stat* radio_stats_ptr) {
+                on_stats_callback(iface_stats_ptr, num_radios, radio_stats_ptr);
+            };
     on_link_layer_ml_stats_result_internal_callback =
-            [this, &link_ml_stats_ptr](wifi_request_id /* id */,
-                                       wifi_iface_ml_stat* iface_ml_stats_ptr, int num_radios,
-                                       wifi_radio_stat* radio_stats_ptr) {
-                wifi_radio_stat* l_radio_stats_ptr;
-                wifi_link_stat* l_link_stat_ptr;
-                link_ml_stats_ptr->valid = true;
-
-                if (iface_ml_stats_ptr != nullptr && iface_ml_stats_ptr->num_links > 0) {
-                    // Copy stats from wifi_iface_ml_stat to LinkLayerMlStats,
-                    //  - num_links * links[] to vector of links.
-                    //  - num_peers * peer_info[] to vector of links[i].peers.
-                    link_ml_stats_ptr->iface = *iface_ml_stats_ptr;
-                    l_link_stat_ptr = iface_ml_stats_ptr->links;
-                    for (int l = 0; l < iface_ml_stats_ptr->num_links; ++l) {
-                        l_link_stat_ptr = copyLinkStat(l_link_stat_ptr, link_ml_stats_ptr->links);
-                    }
-                } else {
-                    LOG(ERROR) << "Invalid iface stats in link layer stats";
-                }
-                if (num_radios <= 0 || radio_stats_ptr == nullptr) {
-                    LOG(ERROR) << "Invalid radio stats in link layer stats";
-                    return;
-                }
-                l_radio_stats_ptr = radio_stats_ptr;
-                for (int i = 0; i < num_radios; i++) {
-                    LinkLayerRadioStats radio;
-
-                    radio.stats = *l_radio_stats_ptr;
-                    // Copy over the tx level array to the separate vector.
-                    if (l_radio_stats_ptr->num_tx_levels > 0 &&
-                        l_radio_stats_ptr->tx_time_per_levels != nullptr) {
-                        radio.tx_time_per_levels.assign(l_radio_stats_ptr->tx_time_per_levels,
-                                                        l_radio_stats_ptr->tx_time_per_levels +
-                                                                l_radio_stats_ptr->num_tx_levels);
-                    }
-                    radio.stats.num_tx_levels = 0;
-                    radio.stats.tx_time_per_levels = nullptr;
-                    /* Copy over the channel stat to separate vector */
-                    if (l_radio_stats_ptr->num_channels > 0) {
-                        /* Copy the channel stats */
-                        radio.channel_stats.assign(
-                                l_radio_stats_ptr->channels,
-                                l_radio_stats_ptr->channels + l_radio_stats_ptr->num_channels);
-                    }
-                    link_ml_stats_ptr->radios.push_back(radio);
-                    l_radio_stats_ptr =
-                            (wifi_radio_stat*)((u8*)l_radio_stats_ptr + sizeof(wifi_radio_stat) +
-                                               (sizeof(wifi_channel_stat) *
-                                                l_radio_stats_ptr->num_channels));
-                }
+            [&on_ml_stats_callback](wifi_request_id /* id */,
+                                    wifi_iface_ml_stat* iface_ml_stats_ptr, int num_radios,
+                                    wifi_radio_stat* radio_stats_ptr) {
+                on_ml_stats_callback(iface_ml_stats_ptr, num_radios, radio_stats_ptr);
             };
 
     wifi_error status = global_func_table_.wifi_get_link_stats(
@@ -1204,10 +1002,9 @@ wifi_error WifiLegacyHal::registerRingBufferCallbackHandler(
     on_ring_buffer_data_internal_callback = [on_user_data_callback](
                                                     char* ring_name, char* buffer, int buffer_size,
                                                     wifi_ring_buffer_status* status) {
-        if (status && buffer) {
-            std::vector<uint8_t> buffer_vector(reinterpret_cast<uint8_t*>(buffer),
-                                               reinterpret_cast<uint8_t*>(buffer) + buffer_size);
-            on_user_data_callback(ring_name, buffer_vector, *status);
+        if (status && buffer && buffer_size >= 0) {
+            on_user_data_callback(ring_name, reinterpret_cast<const uint8_t*>(buffer),
+                                  static_cast<size_t>(buffer_size), *status);
         }
     };
     wifi_error status = global_func_table_.wifi_set_log_handler(0, getIfaceHandle(iface_name),
@@ -1764,7 +1561,7 @@ wifi_interface_handle WifiLegacyHal::getIfaceHandle(const std::string& iface_nam
 void WifiLegacyHal::runEventLoop() {
     LOG(DEBUG) << "Starting legacy HAL event loop";
     global_func_table_.wifi_event_loop(global_handle_);
-    const auto lock = aidl_sync_util::acquireGlobalLock();
+    const std::lock_guard<std::recursive_mutex> chip_lock(*chip_lock_);
     if (!awaiting_event_loop_termination_) {
         LOG(FATAL) << "Legacy HAL event loop terminated, but HAL was not stopping";
     }
@@ -2080,6 +1877,7 @@ wifi_error WifiLegacyHal::enableWifiTxPowerLimits(const std::string& iface_name,
 
 wifi_error WifiLegacyHal::getWifiCachedScanResults(const std::string& iface_name,
                                                    WifiCachedScanReport& report) {
+    const std::lock_guard<std::mutex> sync_callback_lock(g_sync_callback_mutex);
     on_cached_scan_results_internal_callback = [&report](wifi_cached_scan_report* report_ptr) {
         report.results.assign(report_ptr->results, report_ptr->results + report_ptr->result_cnt);
         report.scanned_freqs.assign(report_ptr->scanned_freq_list,
@@ -23,6 +23,7 @@
 #include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -295,8 +296,11 @@ using ::WIFI_ERROR_UNKNOWN;
 using ::wifi_gscan_capabilities;
 using ::wifi_hal_fn;
 using ::wifi_iface_concurrency_matrix;
+using ::wifi_iface_ml_stat;
+using ::wifi_iface_stat;
 using ::WIFI_INDOOR_CHANNEL;
 using ::wifi_information_element;
+using ::wifi_link_stat;
 using ::WIFI_INTERFACE_IBSS;
 using ::WIFI_INTERFACE_MESH;
 using ::wifi_interface_mode;
@@ -329,6 +333,7 @@ using ::WIFI_MOTION_NOT_EXPECTED;
 using ::wifi_motion_pattern;
 using ::WIFI_MOTION_UNKNOWN;
 using ::wifi_multi_sta_use_case;
+using ::wifi_peer_info;
 using ::wifi_power_scenario;
 using ::WIFI_POWER_SCENARIO_ON_BODY_CELL_OFF;
 using ::WIFI_POWER_SCENARIO_ON_BODY_CELL_ON;
@@ -338,7 +343,9 @@ using ::WIFI_POWER_SCENARIO_VOICE_CALL;
 using ::wifi_radio_combination;
 using ::wifi_radio_combination_matrix;
 using ::wifi_radio_configuration;
+using ::wifi_radio_stat;
 using ::wifi_rate;
+using ::wifi_rate_stat;
 using ::wifi_request_id;
 using ::wifi_ring_buffer_status;
 using ::wifi_roaming_capabilities;
@@ -388,6 +395,7 @@ using ::wifi_tx_report;
 using ::wifi_usable_channel;
 using ::WIFI_USABLE_CHANNEL_FILTER_CELLULAR_COEXISTENCE;
 using ::WIFI_USABLE_CHANNEL_FILTER_CONCURRENCY;
+using ::wifi_wmm_ac_stat;
 using ::WLAN_MAC_2_4_BAND;
 using ::WLAN_MAC_5_0_BAND;
 using ::WLAN_MAC_60_0_BAND;
@@ -404,39 +412,6 @@ struct PacketFilterCapabilities {
 // to escape the compiler warnings regarding this.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wgnu-variable-sized-type-not-at-end"
-// The |wifi_radio_stat.tx_time_per_levels| stats is provided as a pointer in
-// |wifi_radio_stat| structure in the legacy HAL API. Separate that out
-// into a separate return element to avoid passing pointers around.
-struct LinkLayerRadioStats {
-    wifi_radio_stat stats;
-    std::vector<uint32_t> tx_time_per_levels;
-    std::vector<wifi_channel_stat> channel_stats;
-};
-
-struct WifiPeerInfo {
-    wifi_peer_info peer_info;
-    std::vector<wifi_rate_stat> rate_stats;
-};
-
-struct LinkLayerStats {
-    wifi_iface_stat iface;
-    std::vector<LinkLayerRadioStats> radios;
-    std::vector<WifiPeerInfo> peers;
-    bool valid;
-};
-
-struct LinkStats {
-    wifi_link_stat stat;
-    std::vector<WifiPeerInfo> peers;
-};
-
-struct LinkLayerMlStats {
-    wifi_iface_ml_stat iface;
-    std::vector<LinkStats> links;
-    std::vector<LinkLayerRadioStats> radios;
-    bool valid;
-};
-
 struct WifiCachedScanReport {
     uint64_t ts;
     std::vector<int> scanned_freqs;
@@ -494,6 +469,14 @@ using on_gscan_full_result_callback =
 using on_gscan_results_callback =
         std::function<void(wifi_request_id, const std::vector<wifi_cached_scan_results>&)>;
 
+// Link layer stats results. The packed stats buffers are owned by the legacy
+// HAL and only valid for the duration of the callback, which is invoked
+// synchronously. Callee must not retain the pointers.
+using on_link_layer_stats_result_callback =
+        std::function<void(const wifi_iface_stat*, int, const wifi_radio_stat*)>;
+using on_link_layer_ml_stats_result_callback =
+        std::function<void(const wifi_iface_ml_stat*, int, const wifi_radio_stat*)>;
+
 // Invoked when the rssi value breaches the thresholds set.
 using on_rssi_threshold_breached_callback =
         std::function<void(wifi_request_id, std::array<uint8_t, ETH_ALEN>, int8_t)>;
@@ -509,9 +492,9 @@ using on_rtt_results_callback_v2 =
 using on_rtt_results_callback_v3 =
         std::function<void(wifi_request_id, const std::vector<const wifi_rtt_result_v3*>&)>;
 
-// Callback for ring buffer data.
+// Callback for ring buffer data. The data is only valid for the duration of the call.
 using on_ring_buffer_data_callback = std::function<void(
-        const std::string&, const std::vector<uint8_t>&, const wifi_ring_buffer_status&)>;
+        const std::string&, const uint8_t*, size_t, const wifi_ring_buffer_status&)>;
 
 // Callback for alerts.
 using on_error_alert_callback = std::function<void(int32_t, const std::vector<uint8_t>&)>;
@@ -590,12 +573,16 @@ class WifiLegacyHal {
     // Start the legacy HAL and the event looper thread.
     virtual wifi_error start();
     // Deinitialize the legacy HAL and wait for the event loop thread to exit
-    // using a predefined timeout.
+    // using a predefined timeout. |lock| must hold the chip lock exactly once;
+    // it is released while waiting.
     virtual wifi_error stop(std::unique_lock<std::recursive_mutex>* lock,
                             const std::function<void()>& on_complete_callback);
     virtual wifi_error waitForDriverReady();
     // Checks if legacy HAL has successfully started
     bool isStarted();
+    // Returns the lock serializing the calls into this HAL. It is shared by
+    // the chip backed by this HAL and all of its child objects.
+    std::shared_ptr<std::recursive_mutex> getChipLock() { return chip_lock_; }
     // Wrappers for all the functions in the legacy HAL function table.
     virtual std::pair<wifi_error, std::string> getDriverVersion(const std::string& iface_name);
     virtual std::pair<wifi_error, std::string> getFirmwareVersion(const std::string& iface_name);
@@ -636,9 +623,10 @@ class WifiLegacyHal {
     // Link layer stats functions.
     wifi_error enableLinkLayerStats(const std::string& iface_name, bool debug);
     wifi_error disableLinkLayerStats(const std::string& iface_name);
-    wifi_error getLinkLayerStats(const std::string& iface_name,
-                                 legacy_hal::LinkLayerStats& legacy_stats,
-                                 legacy_hal::LinkLayerMlStats& legacy_ml_stats);
+    wifi_error getLinkLayerStats(
+            const std::string& iface_name,
+            const on_link_layer_stats_result_callback& on_stats_callback,
+            const on_link_layer_ml_stats_result_callback& on_ml_stats_callback);
     // RSSI monitor functions.
     wifi_error startRssiMonitoring(
             const std::string& iface_name, wifi_request_id id, int8_t max_rssi, int8_t min_rssi,
@@ -856,13 +844,13 @@ class WifiLegacyHal {
     // Handles wifi (error) status of Virtual interface create/delete
     wifi_error handleVirtualInterfaceCreateOrDeleteStatus(const std::string& ifname,
                                                           wifi_error status);
-    wifi_link_stat* copyLinkStat(wifi_link_stat* stat_ptr, std::vector<LinkStats>& stats);
-    wifi_peer_info* copyPeerInfo(wifi_peer_info* peer_ptr, std::vector<WifiPeerInfo>& peers);
 
     // Global function table of legacy HAL.
     wifi_hal_fn global_func_table_;
     // Opaque handle to be used for all global operations.
     wifi_handle global_handle_;
+    // Refer to |getChipLock()|.
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     // Map of interface name to handle that is to be used for all interface
     // specific operations.
     std::map<std::string, wifi_interface_handle> iface_name_to_handle_;
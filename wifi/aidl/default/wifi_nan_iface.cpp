@@ -34,6 +34,7 @@ WifiNanIface::WifiNanIface(const std::string& ifname, bool is_dedicated_iface,
     : ifname_(ifname),
       is_dedicated_iface_(is_dedicated_iface),
       legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
       iface_util_(iface_util),
       is_valid_(true) {}
 
@@ -668,6 +669,10 @@ bool WifiNanIface::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiNanIface::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 std::string WifiNanIface::getName() {
     return ifname_;
 }
@@ -21,6 +21,9 @@
 #include <aidl/android/hardware/wifi/IWifiNanIfaceEventCallback.h>
 #include <android-base/macros.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "aidl_callback_util.h"
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
@@ -48,6 +51,8 @@ class WifiNanIface : public BnWifiNanIface {
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
+    // Refer to |WifiChip::acquireLock()|.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::string getName();
 
     // AIDL methods exposed.
@@ -140,8 +145,9 @@ class WifiNanIface : public BnWifiNanIface {
     std::string ifname_;
     bool is_dedicated_iface_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     std::weak_ptr<iface_util::WifiIfaceUtil> iface_util_;
-    bool is_valid_;
+    std::atomic<bool> is_valid_;
     std::weak_ptr<WifiNanIface> weak_ptr_this_;
     aidl_callback_util::AidlCallbackHandler<IWifiNanIfaceEventCallback> event_cb_handler_;
 
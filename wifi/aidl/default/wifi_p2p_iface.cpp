@@ -29,7 +29,10 @@ using aidl_return_util::validateAndCall;
 
 WifiP2pIface::WifiP2pIface(const std::string& ifname,
                            const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal)
-    : ifname_(ifname), legacy_hal_(legacy_hal), is_valid_(true) {}
+    : ifname_(ifname),
+      legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
+      is_valid_(true) {}
 
 void WifiP2pIface::invalidate() {
     legacy_hal_.reset();
@@ -40,6 +43,10 @@ bool WifiP2pIface::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiP2pIface::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 std::string WifiP2pIface::getName() {
     return ifname_;
 }
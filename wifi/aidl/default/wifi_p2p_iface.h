@@ -20,6 +20,9 @@
 #include <aidl/android/hardware/wifi/BnWifiP2pIface.h>
 #include <android-base/macros.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "wifi_legacy_hal.h"
 
 namespace aidl {
@@ -37,6 +40,8 @@ class WifiP2pIface : public BnWifiP2pIface {
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
+    // Refer to |WifiChip::acquireLock()|.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::string getName();
 
     // AIDL methods exposed.
@@ -48,7 +53,8 @@ class WifiP2pIface : public BnWifiP2pIface {
 
     std::string ifname_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
-    bool is_valid_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
+    std::atomic<bool> is_valid_;
 
     DISALLOW_COPY_AND_ASSIGN(WifiP2pIface);
 };
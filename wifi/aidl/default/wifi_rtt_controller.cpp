@@ -31,7 +31,11 @@ using aidl_return_util::validateAndCall;
 WifiRttController::WifiRttController(const std::string& iface_name,
                                      const std::shared_ptr<IWifiStaIface>& bound_iface,
                                      const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal)
-    : ifname_(iface_name), bound_iface_(bound_iface), legacy_hal_(legacy_hal), is_valid_(true) {}
+    : ifname_(iface_name),
+      bound_iface_(bound_iface),
+      legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
+      is_valid_(true) {}
 
 std::shared_ptr<WifiRttController> WifiRttController::create(
         const std::string& iface_name, const std::shared_ptr<IWifiStaIface>& bound_iface,
@@ -53,6 +57,10 @@ bool WifiRttController::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiRttController::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 void WifiRttController::setWeakPtr(std::weak_ptr<WifiRttController> ptr) {
     weak_ptr_this_ = ptr;
 }
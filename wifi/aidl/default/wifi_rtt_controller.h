@@ -22,6 +22,9 @@
 #include <aidl/android/hardware/wifi/IWifiStaIface.h>
 #include <android-base/macros.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "wifi_legacy_hal.h"
 
 namespace aidl {
@@ -45,6 +48,8 @@ class WifiRttController : public BnWifiRttController {
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
+    // Refer to |WifiChip::acquireLock()|.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::vector<std::shared_ptr<IWifiRttControllerEventCallback>> getEventCallbacks();
     std::string getIfaceName();
 
@@ -87,9 +92,10 @@ class WifiRttController : public BnWifiRttController {
     std::string ifname_;
     std::shared_ptr<IWifiStaIface> bound_iface_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     std::vector<std::shared_ptr<IWifiRttControllerEventCallback>> event_callbacks_;
     std::weak_ptr<WifiRttController> weak_ptr_this_;
-    bool is_valid_;
+    std::atomic<bool> is_valid_;
 
     DISALLOW_COPY_AND_ASSIGN(WifiRttController);
 };
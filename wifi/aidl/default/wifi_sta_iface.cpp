@@ -31,7 +31,11 @@ using aidl_return_util::validateAndCall;
 WifiStaIface::WifiStaIface(const std::string& ifname,
                            const std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal,
                            const std::weak_ptr<iface_util::WifiIfaceUtil> iface_util)
-    : ifname_(ifname), legacy_hal_(legacy_hal), iface_util_(iface_util), is_valid_(true) {
+    : ifname_(ifname),
+      legacy_hal_(legacy_hal),
+      chip_lock_(legacy_hal.lock()->getChipLock()),
+      iface_util_(iface_util),
+      is_valid_(true) {
     // Turn on DFS channel usage for STA iface.
     legacy_hal::wifi_error legacy_status = legacy_hal_.lock()->setDfsFlag(ifname_, true);
     if (legacy_status != legacy_hal::WIFI_SUCCESS) {
@@ -63,6 +67,10 @@ bool WifiStaIface::isValid() {
     return is_valid_;
 }
 
+std::unique_lock<std::recursive_mutex> WifiStaIface::acquireLock() {
+    return std::unique_lock<std::recursive_mutex>(*chip_lock_);
+}
+
 std::string WifiStaIface::getName() {
     return ifname_;
 }
@@ -416,26 +424,37 @@ ndk::ScopedAStatus WifiStaIface::disableLinkLayerStatsCollectionInternal() {
 }
 
 std::pair<StaLinkLayerStats, ndk::ScopedAStatus> WifiStaIface::getLinkLayerStatsInternal() {
-    legacy_hal::wifi_error legacy_status;
-    legacy_hal::LinkLayerStats legacy_stats{};
-    legacy_hal::LinkLayerMlStats legacy_ml_stats{};
-    legacy_status = legacy_hal_.lock()->getLinkLayerStats(ifname_, legacy_stats, legacy_ml_stats);
+    // The stats are converted straight from the buffers of the legacy HAL. If
+    // both kinds of stats are reported, the single link stats take precedence.
+    StaLinkLayerStats aidl_stats;
+    bool stats_valid = false;
+    bool ml_stats_valid = false;
+    bool conversion_ok = true;
+    const auto& on_stats_callback = [&](const legacy_hal::wifi_iface_stat* iface_stats,
+                                        int num_radios,
+                                        const legacy_hal::wifi_radio_stat* radio_stats) {
+        stats_valid = true;
+        conversion_ok = aidl_struct_util::convertLegacyPackedLinkLayerStatsToAidl(
+                iface_stats, num_radios, radio_stats, &aidl_stats);
+    };
+    const auto& on_ml_stats_callback = [&](const legacy_hal::wifi_iface_ml_stat* iface_ml_stats,
+                                           int num_radios,
+                                           const legacy_hal::wifi_radio_stat* radio_stats) {
+        ml_stats_valid = true;
+        if (!stats_valid) {
+            conversion_ok = aidl_struct_util::convertLegacyPackedLinkLayerMlStatsToAidl(
+                    iface_ml_stats, num_radios, radio_stats, &aidl_stats);
+        }
+    };
+    legacy_hal::wifi_error legacy_status = legacy_hal_.lock()->getLinkLayerStats(
+            ifname_, on_stats_callback, on_ml_stats_callback);
     if (legacy_status != legacy_hal::WIFI_SUCCESS) {
         return {StaLinkLayerStats{}, createWifiStatusFromLegacyError(legacy_status)};
     }
-    StaLinkLayerStats aidl_stats;
-    if (legacy_stats.valid) {
-        if (!aidl_struct_util::convertLegacyLinkLayerStatsToAidl(legacy_stats, &aidl_stats)) {
-            return {StaLinkLayerStats{}, createWifiStatus(WifiStatusCode::ERROR_UNKNOWN)};
-        }
-    } else if (legacy_ml_stats.valid) {
-        if (!aidl_struct_util::convertLegacyLinkLayerMlStatsToAidl(legacy_ml_stats, &aidl_stats)) {
-            return {StaLinkLayerStats{}, createWifiStatus(WifiStatusCode::ERROR_UNKNOWN)};
-        }
-    } else {
+    if ((!stats_valid && !ml_stats_valid) || !conversion_ok) {
         return {StaLinkLayerStats{}, createWifiStatus(WifiStatusCode::ERROR_UNKNOWN)};
     }
-    return {aidl_stats, ndk::ScopedAStatus::ok()};
+    return {std::move(aidl_stats), ndk::ScopedAStatus::ok()};
 }
 
 ndk::ScopedAStatus WifiStaIface::startRssiMonitoringInternal(int32_t cmd_id, int32_t max_rssi,
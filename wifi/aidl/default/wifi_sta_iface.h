@@ -21,6 +21,9 @@
 #include <aidl/android/hardware/wifi/IWifiStaIfaceEventCallback.h>
 #include <android-base/macros.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "aidl_callback_util.h"
 #include "wifi_iface_util.h"
 #include "wifi_legacy_hal.h"
@@ -47,6 +50,8 @@ class WifiStaIface : public BnWifiStaIface {
     // Refer to |WifiChip::invalidate()|.
     void invalidate();
     bool isValid();
+    // Refer to |WifiChip::acquireLock()|.
+    std::unique_lock<std::recursive_mutex> acquireLock();
     std::set<std::shared_ptr<IWifiStaIfaceEventCallback>> getEventCallbacks();
     std::string getName();
 
@@ -153,9 +158,10 @@ class WifiStaIface : public BnWifiStaIface {
 
     std::string ifname_;
     std::weak_ptr<legacy_hal::WifiLegacyHal> legacy_hal_;
+    const std::shared_ptr<std::recursive_mutex> chip_lock_;
     std::weak_ptr<iface_util::WifiIfaceUtil> iface_util_;
     std::weak_ptr<WifiStaIface> weak_ptr_this_;
-    bool is_valid_;
+    std::atomic<bool> is_valid_;
     aidl_callback_util::AidlCallbackHandler<IWifiStaIfaceEventCallback> event_cb_handler_;
 
     DISALLOW_COPY_AND_ASSIGN(WifiStaIface);